@@ -85,6 +85,9 @@ enum GromacsFileType
     efRND,
     efCSV,
     efQMI,
+    efMRC,
+    efH5MD,
+    efAMT,
     efNR
 };
 
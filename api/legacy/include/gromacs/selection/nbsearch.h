@@ -486,6 +486,27 @@ public:
      *     no reference position is within the cutoff.
      */
     AnalysisNeighborhoodPair nearestPoint(const AnalysisNeighborhoodPositions& positions) const;
+    /*! \brief
+     * Finds all reference positions within the cutoff from a set of test
+     * positions.
+     *
+     * \param[in]  positions   Set of test positions to use.
+     * \param[out] pairs       Receives all pairs within the cutoff.
+     * \param[in]  threadCount Number of OpenMP threads to split the test
+     *     positions over.
+     * \throws    std::bad_alloc if out of memory.
+     *
+     * Returns the same pairs, in the same order, as a loop over
+     * AnalysisNeighborhoodPairSearch::findNextPair() with a search from
+     * startPairSearch(), independent of \p threadCount.  The grid cells
+     * are scanned with SIMD distance filtering, which makes this faster
+     * than the pair-by-pair interface when all pairs are needed.
+     * \p pairs is cleared first, but its capacity is kept, so reusing the
+     * same buffer between calls avoids reallocation.
+     */
+    void findAllPairs(const AnalysisNeighborhoodPositions&   positions,
+                      std::vector<AnalysisNeighborhoodPair>* pairs,
+                      int                                    threadCount = 1) const;
 
     /*! \brief
      * Starts a search to find all reference position pairs within a cutoff.
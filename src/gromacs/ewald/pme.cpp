@@ -790,6 +790,8 @@ gmx_pme_t* gmx_pme_init(const t_commrec*                 cr,
     pme->nky       = ir->nky;
     pme->nkz       = ir->nkz;
     pme->bP3M = (ir->coulombtype == CoulombInteractionType::P3mAD || getenv("GMX_PME_P3M") != nullptr);
+    /* In double precision, bfloat16 would cut the grid values to an 8-bit mantissa */
+    pme->useBfloat16GridComm = (!GMX_DOUBLE && getenv("GMX_PME_GRID_COMM_BF16") != nullptr);
     pme->pme_order     = ir->pme_order;
     pme->ewaldcoeff_q  = ewaldcoeff_q;
     pme->ewaldcoeff_lj = ewaldcoeff_lj;
@@ -889,6 +891,25 @@ gmx_pme_t* gmx_pme_init(const t_commrec*                 cr,
                             pme->nkz,
                             pme->nnodes_minor);
         }
+
+        if (pme->useBfloat16GridComm && pme->nodeid_major == 0 && pme->nodeid_minor == 0)
+        {
+            GMX_LOG(mdlog.info)
+                    .asParagraph()
+                    .appendText(
+                            "The PME grid overlap and FFT transpose communication uses bfloat16.\n"
+                            "This reduces the accuracy of the PME mesh forces, gmx pme_error\n"
+                            "-bf16comm estimates the resulting error.");
+        }
+        if (GMX_DOUBLE && getenv("GMX_PME_GRID_COMM_BF16") != nullptr && pme->nodeid_major == 0
+            && pme->nodeid_minor == 0)
+        {
+            GMX_LOG(mdlog.warning)
+                    .asParagraph()
+                    .appendText(
+                            "GMX_PME_GRID_COMM_BF16 is ignored in double precision, since\n"
+                            "bfloat16 only has an 8-bit mantissa.");
+        }
     }
 
     /* For non-divisible grid we need pme_order iso pme_order-1 */
@@ -69,6 +69,8 @@ using namespace gmx; // TODO: Remove when this file is moved into gmx namespace
    For SIMD4 with unaligned load/store support:
      order 4 uses the order 4 unaligned SIMD template
      order 5 uses the order 4+5 aligned SIMD template
+   For SIMD with unaligned load/store support:
+     order 6 to 8 use the full-width SIMD template along z
  */
 struct do_fspline
 {
@@ -275,6 +277,80 @@ struct do_fspline
         return { reduce(fx_S), reduce(fy_S), reduce(fz_S) };
     }
 #endif
+
+#if PME_SIMD_HIGH_ORDER_SPREAD_GATHER
+    /* Gather for one charge with pme_order 6 to 8 with full-width SIMD along z.
+     * The z-splines are copied to zero-padded buffers, so grid values in lanes
+     * beyond the order do not contribute. This code does not assume any memory
+     * alignment for the grid, but requires c_pmeSimdGridPadding reals after the grid.
+     */
+    template<int Order>
+    std::enable_if_t<Order >= c_pmeSimdHighOrderMin && Order <= c_pmeSimdHighOrderMax, RVec>
+    operator()(std::integral_constant<int, Order> order) const
+    {
+        constexpr int c_numZSimd = (Order + GMX_SIMD_REAL_WIDTH - 1) / GMX_SIMD_REAL_WIDTH;
+
+        const int norder = nn_ * order;
+        /* Pointer arithmetic alert, next six statements */
+        const real* const gmx_restrict thx  = spline_->theta.coefficients[XX] + norder;
+        const real* const gmx_restrict thy  = spline_->theta.coefficients[YY] + norder;
+        const real* const gmx_restrict thz  = spline_->theta.coefficients[ZZ] + norder;
+        const real* const gmx_restrict dthx = spline_->dtheta.coefficients[XX] + norder;
+        const real* const gmx_restrict dthy = spline_->dtheta.coefficients[YY] + norder;
+        const real* const gmx_restrict dthz = spline_->dtheta.coefficients[ZZ] + norder;
+
+        alignas(GMX_SIMD_ALIGNMENT) real thzPadded[c_numZSimd * GMX_SIMD_REAL_WIDTH];
+        alignas(GMX_SIMD_ALIGNMENT) real dthzPadded[c_numZSimd * GMX_SIMD_REAL_WIDTH];
+        for (int i = 0; i < c_numZSimd * GMX_SIMD_REAL_WIDTH; i++)
+        {
+            thzPadded[i]  = (i < Order ? thz[i] : 0);
+            dthzPadded[i] = (i < Order ? dthz[i] : 0);
+        }
+
+        SimdReal tz_S[c_numZSimd];
+        SimdReal dz_S[c_numZSimd];
+        for (int s = 0; s < c_numZSimd; s++)
+        {
+            tz_S[s] = load<SimdReal>(thzPadded + s * GMX_SIMD_REAL_WIDTH);
+            dz_S[s] = load<SimdReal>(dthzPadded + s * GMX_SIMD_REAL_WIDTH);
+        }
+
+        SimdReal fx_S = setZero();
+        SimdReal fy_S = setZero();
+        SimdReal fz_S = setZero();
+
+        for (int ithx = 0; ithx < Order; ithx++)
+        {
+            const int      index_x = (idxX + ithx) * gridNY * gridNZ;
+            const SimdReal tx_S    = SimdReal(thx[ithx]);
+            const SimdReal dx_S    = SimdReal(dthx[ithx]);
+
+            for (int ithy = 0; ithy < Order; ithy++)
+            {
+                const int      index_xy = index_x + (idxY + ithy) * gridNZ;
+                const SimdReal ty_S     = SimdReal(thy[ithy]);
+                const SimdReal dy_S     = SimdReal(dthy[ithy]);
+
+                SimdReal fxy1_S = setZero();
+                SimdReal fz1_S  = setZero();
+                for (int s = 0; s < c_numZSimd; s++)
+                {
+                    const SimdReal gval_S =
+                            loadU<SimdReal>(grid_ + index_xy + idxZ + s * GMX_SIMD_REAL_WIDTH);
+
+                    fxy1_S = fma(tz_S[s], gval_S, fxy1_S);
+                    fz1_S  = fma(dz_S[s], gval_S, fz1_S);
+                }
+
+                fx_S = fma(dx_S * ty_S, fxy1_S, fx_S);
+                fy_S = fma(tx_S * dy_S, fxy1_S, fy_S);
+                fz_S = fma(tx_S * ty_S, fz1_S, fz_S);
+            }
+        }
+
+        return { reduce(fx_S), reduce(fy_S), reduce(fz_S) };
+    }
+#endif
 private:
     const gmx_pme_t* const                 pme_;
     const real* const gmx_restrict         grid_;
@@ -341,6 +417,11 @@ void gather_f_bsplines(const gmx_pme_t*          pme,
             {
                 case 4: f = spline_func(std::integral_constant<int, 4>()); break;
                 case 5: f = spline_func(std::integral_constant<int, 5>()); break;
+#if PME_SIMD_HIGH_ORDER_SPREAD_GATHER
+                case 6: f = spline_func(std::integral_constant<int, 6>()); break;
+                case 7: f = spline_func(std::integral_constant<int, 7>()); break;
+                case 8: f = spline_func(std::integral_constant<int, 8>()); break;
+#endif
                 default: f = spline_func(order); break;
             }
 
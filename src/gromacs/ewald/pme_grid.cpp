@@ -40,8 +40,11 @@
 
 #include <cstdlib>
 
+#include <algorithm>
+
 #include "gromacs/ewald/pme.h"
 #include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/math/bfloat16.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/timing/cyclecounter.h"
 #include "gromacs/utility/fatalerror.h"
@@ -56,13 +59,74 @@
 
 #include "pme_simd.h"
 
+void pmeGridSendRecv(pme_overlap_t* overlap,
+                     bool           useBfloat16,
+                     const real*    sendptr,
+                     int            sendCount,
+                     int            sendId,
+                     real*          recvptr,
+                     int            recvCount,
+                     int            recvId,
+                     int            tag)
+{
+#if GMX_MPI
+    MPI_Status stat;
+
+    if (!useBfloat16)
+    {
+        MPI_Sendrecv(sendptr,
+                     sendCount,
+                     GMX_MPI_REAL,
+                     sendId,
+                     tag,
+                     recvptr,
+                     recvCount,
+                     GMX_MPI_REAL,
+                     recvId,
+                     tag,
+                     overlap->mpi_comm,
+                     &stat);
+        return;
+    }
+
+    overlap->sendbufBfloat16.resize(std::max(overlap->sendbufBfloat16.size(), size_t(sendCount)));
+    overlap->recvbufBfloat16.resize(std::max(overlap->recvbufBfloat16.size(), size_t(recvCount)));
+
+    gmx::packToBfloat16(sendptr, sendCount, overlap->sendbufBfloat16.data());
+    MPI_Sendrecv(overlap->sendbufBfloat16.data(),
+                 sendCount,
+                 MPI_UNSIGNED_SHORT,
+                 sendId,
+                 tag,
+                 overlap->recvbufBfloat16.data(),
+                 recvCount,
+                 MPI_UNSIGNED_SHORT,
+                 recvId,
+                 tag,
+                 overlap->mpi_comm,
+                 &stat);
+    gmx::unpackFromBfloat16(overlap->recvbufBfloat16.data(), recvCount, recvptr);
+#else
+    GMX_UNUSED_VALUE(overlap);
+    GMX_UNUSED_VALUE(useBfloat16);
+    GMX_UNUSED_VALUE(sendptr);
+    GMX_UNUSED_VALUE(sendCount);
+    GMX_UNUSED_VALUE(sendId);
+    GMX_UNUSED_VALUE(recvptr);
+    GMX_UNUSED_VALUE(recvCount);
+    GMX_UNUSED_VALUE(recvId);
+    GMX_UNUSED_VALUE(tag);
+
+    GMX_RELEASE_ASSERT(false, "pmeGridSendRecv() should not be called without MPI");
+#endif
+}
+
 void gmx_sum_qgrid_dd(gmx_pme_t* pme, gmx::ArrayRef<real> grid, const int direction)
 {
 #if GMX_MPI
     pme_overlap_t* overlap;
     int            send_index0, send_nindex;
     int            recv_index0, recv_nindex;
-    MPI_Status     stat;
     int            i, j, k, ix, iy, iz, icnt;
     int            send_id, recv_id, datasize;
     real*          p;
@@ -125,18 +189,15 @@ void gmx_sum_qgrid_dd(gmx_pme_t* pme, gmx::ArrayRef<real> grid, const int direct
 
         datasize = pme->pmegrid_nx * pme->nkz;
 
-        MPI_Sendrecv(overlap->sendbuf.data(),
-                     send_nindex * datasize,
-                     GMX_MPI_REAL,
-                     send_id,
-                     ipulse,
-                     overlap->recvbuf.data(),
-                     recv_nindex * datasize,
-                     GMX_MPI_REAL,
-                     recv_id,
-                     ipulse,
-                     overlap->mpi_comm,
-                     &stat);
+        pmeGridSendRecv(overlap,
+                        pme->useBfloat16GridComm,
+                        overlap->sendbuf.data(),
+                        send_nindex * datasize,
+                        send_id,
+                        overlap->recvbuf.data(),
+                        recv_nindex * datasize,
+                        recv_id,
+                        ipulse);
 
         /* Get data from contiguous recv buffer */
         if (debug)
@@ -229,18 +290,15 @@ void gmx_sum_qgrid_dd(gmx_pme_t* pme, gmx::ArrayRef<real> grid, const int direct
                     recv_index0 - pme->pmegrid_start_ix + recv_nindex);
         }
 
-        MPI_Sendrecv(sendptr,
-                     send_nindex * datasize,
-                     GMX_MPI_REAL,
-                     send_id,
-                     ipulse,
-                     recvptr,
-                     recv_nindex * datasize,
-                     GMX_MPI_REAL,
-                     recv_id,
-                     ipulse,
-                     overlap->mpi_comm,
-                     &stat);
+        pmeGridSendRecv(overlap,
+                        pme->useBfloat16GridComm,
+                        sendptr,
+                        send_nindex * datasize,
+                        send_id,
+                        recvptr,
+                        recv_nindex * datasize,
+                        recv_id,
+                        ipulse);
 
         /* ADD data from contiguous recv buffer */
         if (direction == GMX_SUM_GRID_FORWARD)
@@ -606,16 +664,16 @@ static void pmegrid_init(pmegrid_t*           grid,
     if (gridStorage->empty())
     {
         // Allocate new padded memory and point grid to that
-        gridStorage->resize(gridsize);
+        gridStorage->resize(gridsize + c_pmeSimdGridPadding);
 
-        grid->grid = *gridStorage;
+        grid->grid = gmx::ArrayRef<real>(*gridStorage).subArray(0, gridsize);
     }
     else
     {
         // Use already allocated memory
         gmx::ArrayRef<real> memoryView = *gridStorage;
 
-        GMX_RELEASE_ASSERT(memoryView.ssize() >= gridsize,
+        GMX_RELEASE_ASSERT(memoryView.ssize() >= gridsize + c_pmeSimdGridPadding,
                            "memoryView should be sufficiently large");
 
         // When using aligned SIMD4 operations, check the alignment of the memory
@@ -760,11 +818,11 @@ void pmegrids_init(pmegrids_t*                        grids,
             AlignedVector<real>& gridStorage = gridsStorage[1 + thread];
             if (gridStorage.empty())
             {
-                gridStorage.resize(threadGridSize);
+                gridStorage.resize(threadGridSize + c_pmeSimdGridPadding);
             }
             else
             {
-                GMX_RELEASE_ASSERT(gmx::ssize(gridStorage) >= threadGridSize,
+                GMX_RELEASE_ASSERT(gmx::ssize(gridStorage) >= threadGridSize + c_pmeSimdGridPadding,
                                    "Passed storage should be sufficiently large");
             }
 
@@ -43,6 +43,7 @@
 #include "gromacs/utility/real.h"
 
 struct gmx_pme_t;
+struct pme_overlap_t;
 struct PmeAndFftGrids;
 
 namespace gmx
@@ -71,6 +72,22 @@ struct pmegrids_t;
 
 void gmx_sum_qgrid_dd(gmx_pme_t* pme, gmx::ArrayRef<real> grid, int direction);
 
+/*! \brief Sends and receives grid data over the communicator of \p overlap
+ *
+ * With \p useBfloat16, the data is converted to bfloat16 for the communication,
+ * which halves the communication volume in single precision, at the cost of
+ * a relative rounding error of up to 2^-8 in the received values.
+ */
+void pmeGridSendRecv(pme_overlap_t* overlap,
+                     bool           useBfloat16,
+                     const real*    sendptr,
+                     int            sendCount,
+                     int            sendId,
+                     real*          recvptr,
+                     int            recvCount,
+                     int            recvId,
+                     int            tag);
+
 int copy_pmegrid_to_fftgrid(const gmx_pme_t* pme, PmeAndFftGrids* grids);
 
 int copy_fftgrid_to_pmegrid(const gmx_pme_t* pme, PmeAndFftGrids* grids, int nthread, int thread);
@@ -52,6 +52,8 @@
 
 #include "config.h"
 
+#include <cstdint>
+
 #include <memory>
 #include <vector>
 
@@ -145,6 +147,8 @@ struct pme_overlap_t
     std::vector<pme_grid_comm_t> comm_data; //!< All the individual communication data for each rank
     std::vector<real>            sendbuf;   //!< Shared buffer for sending
     std::vector<real>            recvbuf;   //!< Shared buffer for receiving
+    std::vector<uint16_t>        sendbufBfloat16; //!< Send buffer for bfloat16 communication
+    std::vector<uint16_t>        recvbufBfloat16; //!< Receive buffer for bfloat16 communication
 };
 
 /*! \brief Data structure for organizing particle allocation to threads */
@@ -356,6 +360,7 @@ struct gmx_pme_t
     bool bFEP_lj;
     int  nkx, nky, nkz; /* Grid dimensions */
     bool bP3M;          /* Do P3M: optimize the influence function */
+    bool useBfloat16GridComm; /* Communicate grid overlap data as bfloat16 */
     int  pme_order;
     real ewaldcoeff_q;  /* Ewald splitting coefficient for Coulomb */
     real ewaldcoeff_lj; /* Ewald splitting coefficient for r^-6 */
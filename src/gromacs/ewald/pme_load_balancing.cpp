@@ -48,6 +48,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <string>
 
 #include "gromacs/domdec/dlb.h"
 #include "gromacs/domdec/domdec.h"
@@ -58,10 +59,12 @@
 #include "gromacs/ewald/pme.h"
 #include "gromacs/fft/calcgrid.h"
 #include "gromacs/gmxlib/network.h"
+#include "gromacs/hardware/cpuinfo.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/dispersioncorrection.h"
 #include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/mdtypes/forcerec.h"
 #include "gromacs/mdtypes/inputrec.h"
@@ -75,6 +78,7 @@
 #include "gromacs/timing/walltime_accounting.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/enumerationhelpers.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/logger.h"
@@ -82,6 +86,7 @@
 
 #include "pme_internal.h"
 #include "pme_pp.h"
+#include "pme_tuning_cache.h"
 
 /*! \brief Parameters and settings for one PP-PME setup */
 struct pme_setup_t
@@ -97,6 +102,9 @@ struct pme_setup_t
     struct gmx_pme_t* pmedata; /**< the data structure used in the PME code      */
     int               count;   /**< number of times this setup has been timed    */
     double            cycles;  /**< the fastest time for this setup in cycles    */
+
+    double ppCycles;  /**< PP part of cycles from the PME/PP ratio, 0 when unknown  */
+    double pmeCycles; /**< PME part of cycles from the PME/PP ratio, 0 when unknown */
 };
 
 /*! \brief After 50 nstlist periods of not observing imbalance: never tune PME */
@@ -126,6 +134,10 @@ const real maxRelativeSlowdownAccepted = 1.12;
  * choosing a slower setup due to acceleration or fluctuations.
  */
 const real maxFluctuationAccepted = 1.02;
+/*! \brief With the model-guided search, only jump to an untimed setup when
+ * it is predicted to be at least 1% faster than the fastest timed setup.
+ */
+const real c_modelMinimumPredictedGain = 0.99;
 
 //! \brief Number of nstlist long tuning intervals to skip before starting
 //         load-balancing at the beginning of the run.
@@ -195,6 +207,20 @@ struct pme_load_balancing_t
     int    cycles_n;  /**< step cycle counter cumulative count */
     double cycles_c;  /**< step cycle counter cumulative cycles */
     double startTime; /**< time stamp when the balancing was started on the main rank (relative to the UNIX epoch start).*/
+
+    bool        useModel;           /**< use the model-guided search instead of a full scan */
+    bool        allSetupsGenerated; /**< have all setups within the limits been generated? */
+    bool        isMainRank;         /**< does this rank read and write the tuning cache? */
+    std::string cacheFile;          /**< PME tuning cache file name, empty when not used */
+    std::string cacheKey;           /**< key for this hardware and system in the cache */
+    bool        haveCachedSetup;    /**< did the cache contain a setup for this system? */
+    ivec        cachedGrid;         /**< PME grid of the cached setup */
+    real        cachedRcoulomb;     /**< Coulomb cut-off of the cached setup */
+    int         cachedSetupIndex;   /**< index in setup of the cached setup, -1 when absent */
+    bool        haveOptimalSetup;   /**< has the balancing selected an optimal setup? */
+    std::string runCacheKey;        /**< key for the settings of the whole run in the cache */
+    int         numPmeRanks;        /**< the number of separate PME ranks */
+    bool        rvdwIsRcoulomb;     /**< is rvdw changed along with rcoulomb (LJ-PME)? */
 };
 
 /* TODO The code in this file should call this getter, rather than
@@ -204,6 +230,70 @@ bool pme_loadbal_is_active(const pme_load_balancing_t* pme_lb)
     return pme_lb != nullptr && pme_lb->bActive;
 }
 
+/*! \brief Read the setup selected by an earlier run on the same hardware and system
+ *
+ * The cache key combines the CPU model, the rank and thread layout and the
+ * initial cut-off, PME grid and box, so a cached setup is only used when
+ * the balancing starts from the same conditions.
+ */
+static void pme_loadbal_read_cache(pme_load_balancing_t* pme_lb,
+                                   const t_commrec*      cr,
+                                   const gmx::MDLogger&  mdlog,
+                                   const t_inputrec&     ir,
+                                   gmx_bool              bUseGPU)
+{
+    if (pme_lb->isMainRank)
+    {
+        const std::string description = gmx::formatString(
+                "cpu '%s' ranks %d pme-ranks %d threads %d gpu %d grid %d %d %d rc %.4f rvdw %.4f "
+                "order %d nstlist %d box %.3f %.3f %.3f",
+                gmx::CpuInfo::detect().brandString().c_str(),
+                cr->nnodes,
+                cr->npmenodes,
+                gmx_omp_nthreads_get(ModuleMultiThread::Default),
+                bUseGPU ? 1 : 0,
+                ir.nkx,
+                ir.nky,
+                ir.nkz,
+                ir.rcoulomb,
+                ir.rvdw,
+                ir.pme_order,
+                ir.nstlist,
+                pme_lb->box_start[XX][XX],
+                pme_lb->box_start[YY][YY],
+                pme_lb->box_start[ZZ][ZZ]);
+        pme_lb->cacheKey = gmx::makePmeTuningLoadBalancingKey(description);
+
+        const auto settings = gmx::readPmeTuningRunSettings(pme_lb->cacheFile, pme_lb->cacheKey);
+        if (settings)
+        {
+            pme_lb->cachedGrid[XX]  = settings->nkx;
+            pme_lb->cachedGrid[YY]  = settings->nky;
+            pme_lb->cachedGrid[ZZ]  = settings->nkz;
+            pme_lb->cachedRcoulomb  = settings->rcoulomb;
+            pme_lb->haveCachedSetup = true;
+        }
+        if (pme_lb->haveCachedSetup)
+        {
+            GMX_LOG(mdlog.info)
+                    .appendTextFormatted(
+                            "PME load balancing will first try pme grid %d %d %d, coulomb "
+                            "cutoff %.3f from the tuning cache %s",
+                            pme_lb->cachedGrid[XX],
+                            pme_lb->cachedGrid[YY],
+                            pme_lb->cachedGrid[ZZ],
+                            pme_lb->cachedRcoulomb,
+                            pme_lb->cacheFile.c_str());
+        }
+    }
+    if (haveDDAtomOrdering(*cr))
+    {
+        dd_bcast(cr->dd, sizeof(bool), &pme_lb->haveCachedSetup);
+        dd_bcast(cr->dd, sizeof(ivec), pme_lb->cachedGrid);
+        dd_bcast(cr->dd, sizeof(real), &pme_lb->cachedRcoulomb);
+    }
+}
+
 // TODO Return a unique_ptr to pme_load_balancing_t
 void pme_loadbal_init(pme_load_balancing_t**         pme_lb_p,
                       t_commrec*                     cr,
@@ -213,7 +303,8 @@ void pme_loadbal_init(pme_load_balancing_t**         pme_lb_p,
                       const interaction_const_t&     ic,
                       const gmx::nonbonded_verlet_t& nbv,
                       gmx_pme_t*                     pmedata,
-                      gmx_bool                       bUseGPU)
+                      gmx_bool                       bUseGPU,
+                      const std::string&             pmeTuningCacheKey)
 {
 
     pme_load_balancing_t* pme_lb;
@@ -292,11 +383,35 @@ void pme_loadbal_init(pme_load_balancing_t**         pme_lb_p,
     pme_lb->cycles_n = 0;
     pme_lb->cycles_c = 0;
     // only main ranks do timing
-    if (!PAR(cr) || (haveDDAtomOrdering(*cr) && DDMAIN(cr->dd)))
+    pme_lb->isMainRank = (!PAR(cr) || (haveDDAtomOrdering(*cr) && DDMAIN(cr->dd)));
+    if (pme_lb->isMainRank)
     {
         pme_lb->startTime = gmx_gettime();
     }
 
+    /* With separate PME ranks the PME/PP load ratio tells us how the time
+     * per step splits into PP and PME work. This allows fitting a cost model
+     * and searching directly for the optimum instead of scanning all setups.
+     */
+    pme_lb->useModel = (pme_lb->bSepPMERanks && getenv("GMX_PME_LOADBAL_FULL_SCAN") == nullptr);
+    pme_lb->allSetupsGenerated = false;
+    pme_lb->haveCachedSetup    = false;
+    clear_ivec(pme_lb->cachedGrid);
+    pme_lb->cachedRcoulomb   = 0;
+    pme_lb->cachedSetupIndex = -1;
+    pme_lb->haveOptimalSetup = false;
+
+    pme_lb->runCacheKey    = pmeTuningCacheKey;
+    pme_lb->numPmeRanks    = cr->npmenodes;
+    pme_lb->rvdwIsRcoulomb = usingLJPme(ic.vdwtype);
+
+    const char* cacheFile = getenv("GMX_PME_TUNING_CACHE");
+    if (cacheFile != nullptr && cacheFile[0] != '\0')
+    {
+        pme_lb->cacheFile = cacheFile;
+        pme_loadbal_read_cache(pme_lb, cr, mdlog, ir, bUseGPU);
+    }
+
     if (!wallcycle_have_counter())
     {
         GMX_LOG(mdlog.warning)
@@ -349,7 +464,7 @@ static gmx_bool pme_loadbal_increase_cutoff(pme_load_balancing_t* pme_lb, int pm
     int  d;
     bool grid_ok;
 
-    /* Try to add a new setup with next larger cut-off to the list */
+    /* Try to add a new setup with cut-off larger than the last one to the list */
     pme_setup_t set;
 
     set.pmedata = nullptr;
@@ -373,7 +488,7 @@ static gmx_bool pme_loadbal_increase_cutoff(pme_load_balancing_t* pme_lb, int pm
         clear_ivec(set.grid);
         sp = calcFftGrid(nullptr,
                          pme_lb->box_start,
-                         fac * pme_lb->setup[pme_lb->cur].spacing,
+                         fac * pme_lb->setup.back().spacing,
                          minimalPmeGridSize(pme_order),
                          &set.grid[XX],
                          &set.grid[YY],
@@ -386,7 +501,7 @@ static gmx_bool pme_loadbal_increase_cutoff(pme_load_balancing_t* pme_lb, int pm
          */
         grid_ok = gmx_pme_check_restrictions(
                 pme_order, set.grid[XX], set.grid[YY], set.grid[ZZ], numPmeDomains.x, numPmeDomains.y, 0, false, true, false);
-    } while (sp <= 1.001 * pme_lb->setup[pme_lb->cur].spacing || !grid_ok);
+    } while (sp <= 1.001 * pme_lb->setup.back().spacing || !grid_ok);
 
     set.rcut_coulomb = pme_lb->cut_spacing * sp;
     if (set.rcut_coulomb < pme_lb->rcut_coulomb_start)
@@ -432,8 +547,10 @@ static gmx_bool pme_loadbal_increase_cutoff(pme_load_balancing_t* pme_lb, int pm
     /* We set ewaldcoeff_lj in set, even when LJ-PME is not used */
     set.ewaldcoeff_lj = pme_lb->setup[0].ewaldcoeff_lj * pme_lb->setup[0].rcut_coulomb / set.rcut_coulomb;
 
-    set.count  = 0;
-    set.cycles = 0;
+    set.count     = 0;
+    set.cycles    = 0;
+    set.ppCycles  = 0;
+    set.pmeCycles = 0;
 
     if (debug)
     {
@@ -473,6 +590,12 @@ static void print_grid(FILE* fp_err, FILE* fp_log, const char* pre, const char*
     }
 }
 
+/*! \brief Return product of the number of PME grid points in each dimension */
+static int pme_grid_points(const pme_setup_t* setup)
+{
+    return setup->grid[XX] * setup->grid[YY] * setup->grid[ZZ];
+}
+
 /*! \brief Return the index of the last setup used in PME load balancing */
 static int pme_loadbal_end(pme_load_balancing_t* pme_lb)
 {
@@ -549,6 +672,225 @@ static void switch_to_stage1(pme_load_balancing_t* pme_lb)
     pme_lb->cur = pme_lb->end;
 }
 
+/*! \brief Generate all setups within the PME grid, grid scaling and box limits
+ *
+ * The DD limit is not checked here, as it can change during the run.
+ */
+static void pme_loadbal_generate_setups(pme_load_balancing_t* pme_lb,
+                                        const t_inputrec&     ir,
+                                        const gmx_domdec_t*   dd,
+                                        const matrix          box)
+{
+    while (!pme_lb->allSetupsGenerated)
+    {
+        if (!pme_loadbal_increase_cutoff(pme_lb, ir.pme_order, dd))
+        {
+            pme_lb->elimited           = PmeLoadBalancingLimit::PmeGrid;
+            pme_lb->allSetupsGenerated = true;
+        }
+        else if (pme_lb->setup.back().spacing > c_maxSpacingScaling * pme_lb->setup[0].spacing)
+        {
+            pme_lb->elimited           = PmeLoadBalancingLimit::MaxScaling;
+            pme_lb->allSetupsGenerated = true;
+        }
+        else if (ir.pbcType != PbcType::No
+                 && gmx::square(pme_lb->setup.back().rlistOuter) > max_cutoff2(ir.pbcType, box))
+        {
+            pme_lb->elimited           = PmeLoadBalancingLimit::Box;
+            pme_lb->allSetupsGenerated = true;
+        }
+
+        if (pme_lb->allSetupsGenerated && pme_lb->elimited != PmeLoadBalancingLimit::PmeGrid)
+        {
+            /* The last setup exceeds a limit */
+            pme_lb->setup.pop_back();
+        }
+    }
+}
+
+/*! \brief Return the index of the setup to time next with the model-guided search, -1 when done
+ *
+ * The PP cost is modelled as proportional to the volume of the inner
+ * pair-list sphere and the PME cost as proportional to the number of
+ * PME grid points. As PP and PME run concurrently on different ranks,
+ * the predicted time is the maximum of the two. The two coefficients
+ * are fitted to all setups timed so far. When an untimed setup is
+ * predicted to be faster than the fastest timed setup, we switch to it.
+ * Otherwise we time the untimed neighbors of the fastest setup.
+ */
+static int pme_loadbal_model_next_setup(pme_load_balancing_t* pme_lb)
+{
+    const int numSetups = gmx::ssize(pme_lb->setup);
+
+    /* First try the setup that was optimal in a previous run */
+    if (pme_lb->haveCachedSetup)
+    {
+        pme_lb->haveCachedSetup = false;
+        for (int i = pme_lb->lower_limit; i < numSetups; i++)
+        {
+            const pme_setup_t& set = pme_lb->setup[i];
+            if (set.grid[XX] == pme_lb->cachedGrid[XX] && set.grid[YY] == pme_lb->cachedGrid[YY]
+                && set.grid[ZZ] == pme_lb->cachedGrid[ZZ]
+                && std::abs(set.rcut_coulomb - pme_lb->cachedRcoulomb) < 1e-3)
+            {
+                pme_lb->cachedSetupIndex = i;
+                if (set.count == 0)
+                {
+                    return i;
+                }
+            }
+        }
+    }
+
+    /* Least-squares fit through the origin of both cost components */
+    double sumPpVolume = 0, sumVolume2 = 0, sumPmeGrid = 0, sumGrid2 = 0;
+    for (const pme_setup_t& set : pme_lb->setup)
+    {
+        if (set.ppCycles > 0)
+        {
+            const double volume    = gmx::power3(set.rlistInner);
+            const double numPoints = pme_grid_points(&set);
+            sumPpVolume += set.ppCycles * volume;
+            sumVolume2 += volume * volume;
+            sumPmeGrid += set.pmeCycles * numPoints;
+            sumGrid2 += numPoints * numPoints;
+        }
+    }
+    /* Assuming the cost is unimodal in the cut-off, the optimum lies
+     * between the timed setups closest to the fastest setup.
+     */
+    int rangeStart = pme_lb->lower_limit;
+    int rangeEnd   = numSetups;
+    for (int i = pme_lb->lower_limit; i < numSetups; i++)
+    {
+        if (pme_lb->setup[i].count > 0 && i < pme_lb->fastest)
+        {
+            rangeStart = i + 1;
+        }
+        if (pme_lb->setup[i].count > 0 && i > pme_lb->fastest)
+        {
+            rangeEnd = std::min(rangeEnd, i);
+        }
+    }
+
+    if (sumVolume2 > 0)
+    {
+        const double ppCoefficient  = sumPpVolume / sumVolume2;
+        const double pmeCoefficient = sumPmeGrid / sumGrid2;
+
+        int    next          = -1;
+        double predictedBest = pme_lb->setup[pme_lb->fastest].cycles * c_modelMinimumPredictedGain;
+        for (int i = rangeStart; i < rangeEnd; i++)
+        {
+            const pme_setup_t& set = pme_lb->setup[i];
+            if (set.count == 0)
+            {
+                const double predicted = std::max(ppCoefficient * gmx::power3(set.rlistInner),
+                                                  pmeCoefficient * pme_grid_points(&set));
+                if (predicted < predictedBest)
+                {
+                    next          = i;
+                    predictedBest = predicted;
+                }
+            }
+        }
+        if (next >= 0)
+        {
+            if (debug)
+            {
+                fprintf(debug,
+                        "PME loadbal: model predicts %.1f M-cycles for grid %d %d %d\n",
+                        predictedBest * 1e-6,
+                        pme_lb->setup[next].grid[XX],
+                        pme_lb->setup[next].grid[YY],
+                        pme_lb->setup[next].grid[ZZ]);
+            }
+            return next;
+        }
+    }
+
+    /* When the fastest setup is the one that was cached, we trust it.
+     * Otherwise we refine by timing the neighbors of the fastest setup.
+     */
+    if (pme_lb->fastest != pme_lb->cachedSetupIndex)
+    {
+        for (int i : { pme_lb->fastest + 1, pme_lb->fastest - 1 })
+        {
+            if (i >= rangeStart && i < rangeEnd && pme_lb->setup[i].count == 0)
+            {
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/*! \brief Choose the next setup with the model-guided search, or finish the search
+ *
+ * Instead of scanning all setups in order, we generate all setups up
+ * front and use a cost model fitted to the timings to jump to the
+ * predicted optimum. This usually requires timing only a few setups.
+ */
+static void pme_loadbal_model_search(pme_load_balancing_t*          pme_lb,
+                                     t_commrec*                     cr,
+                                     FILE*                          fp_err,
+                                     FILE*                          fp_log,
+                                     const t_inputrec&              ir,
+                                     const matrix                   box,
+                                     gmx::ArrayRef<const gmx::RVec> x,
+                                     int64_t                        step)
+{
+    pme_loadbal_generate_setups(pme_lb, ir, cr->dd, box);
+
+    int next = pme_loadbal_model_next_setup(pme_lb);
+    while (next >= 0 && haveDDAtomOrdering(*cr))
+    {
+        const bool checkGpuDdLimitation = true;
+        if (change_dd_cutoff(cr, box, x, pme_lb->setup[next].rlistOuter, checkGpuDdLimitation))
+        {
+            break;
+        }
+        if (next < pme_lb->fastest || next < pme_lb->cur)
+        {
+            /* The DD limit is lower than the cut-off of timed setups,
+             * stop searching and let the generic code handle this.
+             */
+            next = -1;
+        }
+        else
+        {
+            /* This and all setups with longer cut-offs are not supported by DD */
+            pme_lb->setup.resize(next);
+            pme_lb->elimited = PmeLoadBalancingLimit::DD;
+            print_loadbal_limited(fp_err, fp_log, step, pme_lb);
+
+            next = pme_loadbal_model_next_setup(pme_lb);
+        }
+    }
+
+    if (next >= 0)
+    {
+        pme_lb->cur = next;
+    }
+    else
+    {
+        /* We are done, limit any later rescan to the fastest setup and its neighbors */
+        pme_lb->cur   = pme_lb->fastest;
+        pme_lb->start = std::max(pme_lb->lower_limit, pme_lb->fastest - 1);
+        pme_lb->end   = std::min(static_cast<int>(pme_lb->setup.size()), pme_lb->fastest + 2);
+        pme_lb->stage = pme_lb->nstage;
+
+        /* A DD limit has already been reported when we encountered it */
+        if (pme_lb->elimited != PmeLoadBalancingLimit::No
+            && pme_lb->elimited != PmeLoadBalancingLimit::DD
+            && pme_lb->fastest == gmx::ssize(pme_lb->setup) - 1)
+        {
+            print_loadbal_limited(fp_err, fp_log, step, pme_lb);
+        }
+    }
+}
+
 /*! \brief Process the timings and try to adjust the PME grid and Coulomb cut-off
  *
  * The adjustment is done to generate a different non-bonded PP and PME load.
@@ -560,6 +902,8 @@ static void switch_to_stage1(pme_load_balancing_t* pme_lb)
  * times and acquiring enough statistics, the best performing setup is chosen.
  * Here we try to take into account fluctuations and changes due to external
  * factors as well as DD load balancing.
+ * When the PME/PP load ratio \p pmePpRatio is available (>0) and the model
+ * is enabled, the initial scan is replaced by a model-guided search.
  */
 static void pme_load_balance(pme_load_balancing_t*          pme_lb,
                              t_commrec*                     cr,
@@ -570,6 +914,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
                              const matrix                   box,
                              gmx::ArrayRef<const gmx::RVec> x,
                              double                         cycles,
+                             double                         pmePpRatio,
                              interaction_const_t*           ic,
                              gmx::nonbonded_verlet_t*       nbv,
                              struct gmx_pme_t**             pmedata,
@@ -633,6 +978,15 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
         set->cycles = std::min(set->cycles, cycles);
     }
 
+    if (pmePpRatio > 0 && set->cycles == cycles)
+    {
+        /* The slowest of PP and PME determines the time per step */
+        const double bottleneckRatio = std::max(pmePpRatio, 1.0);
+        set->ppCycles                = cycles / bottleneckRatio;
+        set->pmeCycles               = cycles * pmePpRatio / bottleneckRatio;
+    }
+    const bool useModelSearch = (pme_lb->useModel && pmePpRatio > 0);
+
     if (set->cycles < pme_lb->setup[pme_lb->fastest].cycles)
     {
         pme_lb->fastest = pme_lb->cur;
@@ -659,7 +1013,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
     /* Check in stage 0 if we should stop scanning grids.
      * Stop when the time is more than maxRelativeSlowDownAccepted longer than the fastest.
      */
-    if (pme_lb->stage == 0 && pme_lb->cur > 0
+    if (pme_lb->stage == 0 && !useModelSearch && pme_lb->cur > 0
         && cycles > pme_lb->setup[pme_lb->fastest].cycles * maxRelativeSlowdownAccepted)
     {
         pme_lb->setup.resize(pme_lb->cur + 1);
@@ -667,7 +1021,11 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
         switch_to_stage1(pme_lb);
     }
 
-    if (pme_lb->stage == 0)
+    if (pme_lb->stage == 0 && useModelSearch)
+    {
+        pme_loadbal_model_search(pme_lb, cr, fp_err, fp_log, ir, box, x, step);
+    }
+    else if (pme_lb->stage == 0)
     {
         int gridsize_start;
 
@@ -680,6 +1038,11 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
                 /* We had already generated the next setup */
                 OK = TRUE;
             }
+            else if (pme_lb->allSetupsGenerated)
+            {
+                /* The model-guided search already found the limit */
+                OK = FALSE;
+            }
             else
             {
                 /* Find the next setup */
@@ -893,6 +1256,8 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
     if (pme_lb->stage == pme_lb->nstage)
     {
         print_grid(fp_err, fp_log, "", "optimal", set, -1);
+
+        pme_lb->haveOptimalSetup = true;
     }
 }
 
@@ -1059,6 +1424,19 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
          * since init_step might not be a multiple of nstlist,
          * but the first data collected is skipped anyhow.
          */
+        /* The ratio is not reliable with direct GPU PME-PP communication
+         * due to CPU-GPU asynchronicity, then we can not use the model.
+         */
+        double pmePpRatio = -1;
+        if (pme_lb->useModel && !useGpuPmePpCommunication)
+        {
+            if (DDMAIN(cr->dd))
+            {
+                pmePpRatio = dd_pme_f_ratio(cr->dd);
+            }
+            dd_bcast(cr->dd, sizeof(double), &pmePpRatio);
+        }
+
         pme_load_balance(pme_lb,
                          cr,
                          fp_err,
@@ -1068,6 +1446,7 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
                          box,
                          x,
                          pme_lb->cycles_c - cycles_prev,
+                         pmePpRatio,
                          fr->ic.get(),
                          fr->nbv.get(),
                          &fr->pmedata,
@@ -1102,12 +1481,6 @@ void pme_loadbal_do(pme_load_balancing_t*          pme_lb,
     *bPrinting = pme_lb->bBalance;
 }
 
-/*! \brief Return product of the number of PME grid points in each dimension */
-static int pme_grid_points(const pme_setup_t* setup)
-{
-    return setup->grid[XX] * setup->grid[YY] * setup->grid[ZZ];
-}
-
 /*! \brief Print one load-balancing setting */
 static void print_pme_loadbal_setting(FILE* fplog, const char* name, const pme_setup_t* setup)
 {
@@ -1180,6 +1553,30 @@ static void print_pme_loadbal_settings(pme_load_balancing_t* pme_lb,
 
 void pme_loadbal_done(pme_load_balancing_t* pme_lb, FILE* fplog, const gmx::MDLogger& mdlog, gmx_bool bNonBondedOnGPU)
 {
+    if (pme_lb->isMainRank && !pme_lb->cacheFile.empty() && pme_lb->haveOptimalSetup)
+    {
+        const pme_setup_t& set = pme_lb->setup[pme_lb->cur];
+        try
+        {
+            gmx::PmeTuningRunSettings settings;
+            settings.numPmeRanks = pme_lb->numPmeRanks;
+            settings.nkx         = set.grid[XX];
+            settings.nky         = set.grid[YY];
+            settings.nkz         = set.grid[ZZ];
+            settings.rcoulomb    = set.rcut_coulomb;
+            settings.rvdw        = pme_lb->rvdwIsRcoulomb ? set.rcut_coulomb : pme_lb->rcut_vdw;
+            gmx::writePmeTuningRunSettings(pme_lb->cacheFile, pme_lb->cacheKey, settings);
+            if (!pme_lb->runCacheKey.empty())
+            {
+                gmx::writePmeTuningRunSettings(pme_lb->cacheFile, pme_lb->runCacheKey, settings);
+            }
+        }
+        catch (const gmx::FileIOError& ex)
+        {
+            GMX_LOG(mdlog.warning).asParagraph().appendText(ex.what());
+        }
+    }
+
     if (fplog != nullptr && (pme_lb->cur > 0 || pme_lb->elimited != PmeLoadBalancingLimit::No))
     {
         print_pme_loadbal_settings(pme_lb, fplog, mdlog, bNonBondedOnGPU);
@@ -45,6 +45,8 @@
 #ifndef GMX_EWALD_PME_LOAD_BALANCING_H
 #define GMX_EWALD_PME_LOAD_BALANCING_H
 
+#include <string>
+
 #include "gromacs/math/vectypes.h"
 #include "gromacs/timing/wallcycle.h"
 
@@ -75,7 +77,8 @@ bool pme_loadbal_is_active(const pme_load_balancing_t* pme_lb);
  * Initialize the PP-PME load balacing data and infrastructure.
  * The actual load balancing might start right away, later or never.
  * The PME grid in pmedata is reused for smaller grids to lower the memory
- * usage.
+ * usage. When \p pmeTuningCacheKey is not empty, the selected setup is
+ * stored under this key in the PME tuning cache at the end of the run.
  */
 void pme_loadbal_init(pme_load_balancing_t**         pme_lb_p,
                       t_commrec*                     cr,
@@ -85,7 +88,8 @@ void pme_loadbal_init(pme_load_balancing_t**         pme_lb_p,
                       const interaction_const_t&     ic,
                       const gmx::nonbonded_verlet_t& nbv,
                       gmx_pme_t*                     pmedata,
-                      gmx_bool                       bUseGPU);
+                      gmx_bool                       bUseGPU,
+                      const std::string&             pmeTuningCacheKey);
 
 /*! \brief Process cycles and PME load balance when necessary
  *
@@ -66,4 +66,25 @@
 #    define PME_4NSIMD_GATHER 0
 #endif
 
+/* Check if we can use full-width SIMD along z for spread and gather with higher orders */
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+#    define PME_SIMD_HIGH_ORDER_SPREAD_GATHER 1
+#else
+#    define PME_SIMD_HIGH_ORDER_SPREAD_GATHER 0
+#endif
+
+#if PME_SIMD_HIGH_ORDER_SPREAD_GATHER
+/* The range of PME orders that use full-width SIMD spread and gather */
+static constexpr int c_pmeSimdHighOrderMin = 6;
+static constexpr int c_pmeSimdHighOrderMax = 8;
+/* The high-order kernels operate on whole SIMD registers along z, starting
+ * at the first grid point touched by the spline. The lanes beyond the order
+ * have zero weight, but they can access up to a SIMD width of reals beyond
+ * the end of the last grid line, so the grid storage needs this padding.
+ */
+static constexpr int c_pmeSimdGridPadding = GMX_SIMD_REAL_WIDTH;
+#else
+static constexpr int c_pmeSimdGridPadding = 0;
+#endif
+
 #endif
@@ -291,6 +291,9 @@ static void make_bsplines(gmx::ArrayRef<real*> theta,
             {
                 case 4: CALC_SPLINE(4) break;
                 case 5: CALC_SPLINE(5) break;
+                case 6: CALC_SPLINE(6) break;
+                case 7: CALC_SPLINE(7) break;
+                case 8: CALC_SPLINE(8) break;
                 default: CALC_SPLINE(order) break;
             }
         }
@@ -319,6 +322,73 @@ static void make_bsplines(gmx::ArrayRef<real*> theta,
         }                                             \
     }
 
+#if PME_SIMD_HIGH_ORDER_SPREAD_GATHER
+/* Spread one coefficient with full-width SIMD along z for pme_order > 5.
+ * The z-spline is copied to a zero-padded buffer, so lanes beyond the order
+ * add zero to the grid. This code does not assume any memory alignment
+ * for the grid, but requires c_pmeSimdGridPadding reals after the grid.
+ */
+template<int order>
+static inline void spreadCoefficientSimdHighOrder(real* gmx_restrict grid,
+                                                  const int          pny,
+                                                  const int          pnz,
+                                                  const int          i0,
+                                                  const int          j0,
+                                                  const int          k0,
+                                                  const real         coefficient,
+                                                  const real*        thx,
+                                                  const real*        thy,
+                                                  const real*        thz)
+{
+    using namespace gmx;
+
+    static_assert(order >= c_pmeSimdHighOrderMin && order <= c_pmeSimdHighOrderMax,
+                  "Only orders 6 to 8 are supported by this kernel");
+
+    constexpr int c_numZSimd = (order + GMX_SIMD_REAL_WIDTH - 1) / GMX_SIMD_REAL_WIDTH;
+
+    alignas(GMX_SIMD_ALIGNMENT) real thzPadded[c_numZSimd * GMX_SIMD_REAL_WIDTH];
+    for (int i = 0; i < order; i++)
+    {
+        thzPadded[i] = thz[i];
+    }
+    for (int i = order; i < c_numZSimd * GMX_SIMD_REAL_WIDTH; i++)
+    {
+        thzPadded[i] = 0;
+    }
+
+    SimdReal tz_S[c_numZSimd];
+    for (int s = 0; s < c_numZSimd; s++)
+    {
+        tz_S[s] = load<SimdReal>(thzPadded + s * GMX_SIMD_REAL_WIDTH);
+    }
+
+    for (int ithx = 0; ithx < order; ithx++)
+    {
+        const int index_x = (i0 + ithx) * pny * pnz + j0 * pnz + k0;
+
+        SimdReal vx_tz_S[c_numZSimd];
+        for (int s = 0; s < c_numZSimd; s++)
+        {
+            vx_tz_S[s] = SimdReal(coefficient * thx[ithx]) * tz_S[s];
+        }
+
+        for (int ithy = 0; ithy < order; ithy++)
+        {
+            real* gridLine = grid + index_x + ithy * pnz;
+
+            const SimdReal ty_S(thy[ithy]);
+
+            for (int s = 0; s < c_numZSimd; s++)
+            {
+                SimdReal gri_S = loadU<SimdReal>(gridLine + s * GMX_SIMD_REAL_WIDTH);
+                gri_S          = fma(vx_tz_S[s], ty_S, gri_S);
+                storeU(gridLine + s * GMX_SIMD_REAL_WIDTH, gri_S);
+            }
+        }
+    }
+}
+#endif
 
 static void spread_coefficients_bsplines_thread(pmegrid_t*            pmegrid,
                                                 const PmeAtomComm*    atc,
@@ -399,6 +469,20 @@ static void spread_coefficients_bsplines_thread(pmegrid_t*            pmegrid,
                     DO_BSPLINE(5)
 #endif
                     break;
+#if PME_SIMD_HIGH_ORDER_SPREAD_GATHER
+                case 6:
+                    spreadCoefficientSimdHighOrder<6>(
+                            grid, pny, pnz, i0, j0, k0, coefficient, thx, thy, thz);
+                    break;
+                case 7:
+                    spreadCoefficientSimdHighOrder<7>(
+                            grid, pny, pnz, i0, j0, k0, coefficient, thx, thy, thz);
+                    break;
+                case 8:
+                    spreadCoefficientSimdHighOrder<8>(
+                            grid, pny, pnz, i0, j0, k0, coefficient, thx, thy, thz);
+                    break;
+#endif
                 default: DO_BSPLINE(order) break;
             }
         }
@@ -716,16 +800,13 @@ static void reduce_threadgrid_overlap(const gmx_pme_t* pme,
 }
 
 
-static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
+static void sum_fftgrid_dd(gmx_pme_t* pme, PmeAndFftGrids* grids)
 {
     real* fftgrid = grids->fftgrid;
 
     ivec local_fft_ndata, local_fft_offset, local_fft_size;
     int  send_index0, send_nindex;
     int  recv_nindex;
-#if GMX_MPI
-    MPI_Status stat;
-#endif
     int recv_size_y;
     int size_yx;
     int x, y, z, indg, indb;
@@ -743,7 +824,7 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
     if (pme->nnodes_minor > 1)
     {
         /* Major dimension */
-        const pme_overlap_t* overlap = &pme->overlap[1];
+        pme_overlap_t* overlap = &pme->overlap[1];
 
         if (pme->nnodes_major > 1)
         {
@@ -767,9 +848,8 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
             recv_nindex = overlap->comm_data[ipulse].recv_nindex;
             recv_size_y = overlap->comm_data[ipulse].recv_size;
 
-            auto* sendptr =
-                    const_cast<real*>(overlap->sendbuf.data()) + send_index0 * local_fft_ndata[ZZ];
-            auto* recvptr = const_cast<real*>(overlap->recvbuf.data());
+            real* sendptr = overlap->sendbuf.data() + send_index0 * local_fft_ndata[ZZ];
+            real* recvptr = overlap->recvbuf.data();
 
             if (debug != nullptr)
             {
@@ -783,18 +863,15 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
 #if GMX_MPI
             int send_id = overlap->comm_data[ipulse].send_id;
             int recv_id = overlap->comm_data[ipulse].recv_id;
-            MPI_Sendrecv(sendptr,
-                         send_size_y * datasize,
-                         GMX_MPI_REAL,
-                         send_id,
-                         ipulse,
-                         recvptr,
-                         recv_size_y * datasize,
-                         GMX_MPI_REAL,
-                         recv_id,
-                         ipulse,
-                         overlap->mpi_comm,
-                         &stat);
+            pmeGridSendRecv(overlap,
+                            pme->useBfloat16GridComm,
+                            sendptr,
+                            send_size_y * datasize,
+                            send_id,
+                            recvptr,
+                            recv_size_y * datasize,
+                            recv_id,
+                            ipulse);
 #endif
 
             for (x = 0; x < local_fft_ndata[XX]; x++)
@@ -813,7 +890,7 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
             if (pme->nnodes_major > 1)
             {
                 /* Copy from the received buffer to the send buffer for dim 0 */
-                sendptr = const_cast<real*>(pme->overlap[0].sendbuf.data());
+                sendptr = pme->overlap[0].sendbuf.data();
                 for (x = 0; x < size_yx; x++)
                 {
                     for (y = 0; y < recv_nindex; y++)
@@ -837,7 +914,7 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
     if (pme->nnodes_major > 1)
     {
         /* Major dimension */
-        const pme_overlap_t* overlap = &pme->overlap[0];
+        pme_overlap_t* overlap = &pme->overlap[0];
 
         size_t ipulse = 0;
 
@@ -858,20 +935,17 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
         int   datasize = local_fft_ndata[YY] * local_fft_ndata[ZZ];
         int   send_id  = overlap->comm_data[ipulse].send_id;
         int   recv_id  = overlap->comm_data[ipulse].recv_id;
-        auto* sendptr  = const_cast<real*>(overlap->sendbuf.data());
-        auto* recvptr  = const_cast<real*>(overlap->recvbuf.data());
-        MPI_Sendrecv(sendptr,
-                     send_nindex * datasize,
-                     GMX_MPI_REAL,
-                     send_id,
-                     ipulse,
-                     recvptr,
-                     recv_nindex * datasize,
-                     GMX_MPI_REAL,
-                     recv_id,
-                     ipulse,
-                     overlap->mpi_comm,
-                     &stat);
+        real* sendptr  = overlap->sendbuf.data();
+        real* recvptr  = overlap->recvbuf.data();
+        pmeGridSendRecv(overlap,
+                        pme->useBfloat16GridComm,
+                        sendptr,
+                        send_nindex * datasize,
+                        send_id,
+                        recvptr,
+                        recv_nindex * datasize,
+                        recv_id,
+                        ipulse);
 #endif
 
         for (x = 0; x < recv_nindex; x++)
@@ -889,12 +963,12 @@ static void sum_fftgrid_dd(const gmx_pme_t* pme, PmeAndFftGrids* grids)
     }
 }
 
-void spread_on_grid(const gmx_pme_t* pme,
-                    PmeAtomComm*     atc,
-                    PmeAndFftGrids*  grids,
-                    const bool       calculateSplines,
-                    const bool       doSpreading,
-                    const bool       computeAllSplineCoefficients)
+void spread_on_grid(gmx_pme_t*      pme,
+                    PmeAtomComm*    atc,
+                    PmeAndFftGrids* grids,
+                    const bool      calculateSplines,
+                    const bool      doSpreading,
+                    const bool      computeAllSplineCoefficients)
 {
 #ifdef PME_TIME_THREADS
     gmx_cycles_t  c1, c2, c3, ct1a, ct1b, ct1c;
@@ -1021,8 +1095,8 @@ void spread_on_grid(const gmx_pme_t* pme,
                 reduce_threadgrid_overlap(pme,
                                           grids,
                                           thread,
-                                          const_cast<real*>(pme->overlap[0].sendbuf.data()),
-                                          const_cast<real*>(pme->overlap[1].sendbuf.data()));
+                                          pme->overlap[0].sendbuf.data(),
+                                          pme->overlap[1].sendbuf.data());
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
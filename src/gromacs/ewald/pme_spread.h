@@ -42,18 +42,18 @@ class PmeAtomComm;
 
 /*! \brief Spread coefficients on the grid
  *
- * \param[in]     pme    PME data
+ * \param[in,out] pme    PME data, its overlap buffers are used for the communication
  * \param[in,out] atc    Local and/or communicated atom to spread and their spline data
  * \param[in,out] grids  The grids
  * \param[in]     calculateSplines  Whether to calculate the splines
  * \param[in]     doSpreading       Whether to spead on the grid
  * \param[in]     computeAllSplineCoefficients  When false, only compute spline coefficients for atoms with non-zero coefficient
  */
-void spread_on_grid(const gmx_pme_t* pme,
-                    PmeAtomComm*     atc,
-                    PmeAndFftGrids*  grids,
-                    bool             calculateSplines,
-                    bool             doSpreading,
-                    bool             computeAllSplineCoefficients);
+void spread_on_grid(gmx_pme_t*      pme,
+                    PmeAtomComm*    atc,
+                    PmeAndFftGrids* grids,
+                    bool            calculateSplines,
+                    bool            doSpreading,
+                    bool            computeAllSplineCoefficients);
 
 #endif
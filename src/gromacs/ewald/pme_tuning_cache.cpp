@@ -0,0 +1,260 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Implements functions for a small on-disk database of PME tuning results.
+ *
+ * \ingroup module_ewald
+ */
+
+#include "gmxpre.h"
+
+#include "pme_tuning_cache.h"
+
+#include <cstdio>
+
+#include <array>
+#include <exception>
+#include <string>
+#include <system_error>
+
+#include "gromacs/fileio/md5.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/strconvert.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/sysinfo.h"
+#include "gromacs/utility/textreader.h"
+#include "gromacs/utility/textwriter.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Reads all non-comment lines of \p cacheFile, returns an empty list when it can not be read
+std::vector<std::string> readCacheLines(const std::filesystem::path& cacheFile)
+{
+    std::vector<std::string> lines;
+
+    std::error_code errorCode;
+    if (!std::filesystem::is_regular_file(cacheFile, errorCode))
+    {
+        return lines;
+    }
+    try
+    {
+        TextReader reader(cacheFile);
+        reader.setTrimLeadingWhiteSpace(true);
+        reader.setTrimTrailingWhiteSpace(true);
+        reader.setTrimTrailingComment(true, '#');
+        std::string line;
+        while (reader.readLine(&line))
+        {
+            if (!line.empty())
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+    catch (const FileIOError&)
+    {
+        // An unreadable database is treated as an empty one
+        lines.clear();
+    }
+    return lines;
+}
+
+//! Returns \p digest as a hexadecimal string
+std::string digestToString(const std::array<unsigned char, 16>& digest)
+{
+    std::string result;
+    for (const unsigned char byte : digest)
+    {
+        result += formatString("%02x", byte);
+    }
+    return result;
+}
+
+//! Returns the key of a database line
+std::string lineKey(const std::string& line)
+{
+    return line.substr(0, line.find_first_of(" \t"));
+}
+
+} // namespace
+
+std::string pmeTuningFingerprint(const std::string& description)
+{
+    md5_state_t state;
+    gmx_md5_init(&state);
+    gmx_md5_append(&state,
+                   reinterpret_cast<const md5_byte_t*>(description.data()),
+                   static_cast<int>(description.size()));
+    return digestToString(gmx_md5_finish(&state));
+}
+
+std::string pmeTuningFileHash(const std::filesystem::path& fileName)
+{
+    FILE* fp = std::fopen(fileName.string().c_str(), "rb");
+    if (fp == nullptr)
+    {
+        GMX_THROW(FileIOError("Could not open " + fileName.string() + " for hashing"));
+    }
+    md5_state_t state;
+    gmx_md5_init(&state);
+    std::array<md5_byte_t, 65536> buffer;
+    size_t                        numBytes;
+    while ((numBytes = std::fread(buffer.data(), 1, buffer.size(), fp)) > 0)
+    {
+        gmx_md5_append(&state, buffer.data(), static_cast<int>(numBytes));
+    }
+    std::fclose(fp);
+
+    return digestToString(gmx_md5_finish(&state));
+}
+
+std::string makePmeTuningRunKey(const std::string& inputFileHash,
+                                const std::string& hardwareFingerprint,
+                                int                numRanks,
+                                int                numPmeRanksRequested,
+                                int                numThreadsRequested)
+{
+    const std::string description = formatString("%s ranks %d pme-ranks %d threads %d",
+                                                 hardwareFingerprint.c_str(),
+                                                 numRanks,
+                                                 numPmeRanksRequested,
+                                                 numThreadsRequested);
+    return "run-" + inputFileHash + "-" + pmeTuningFingerprint(description);
+}
+
+std::string makePmeTuningLoadBalancingKey(const std::string& description)
+{
+    return "loadbal-" + pmeTuningFingerprint(description);
+}
+
+std::optional<std::vector<std::string>>
+readPmeTuningCacheEntry(const std::filesystem::path& cacheFile, const std::string& key)
+{
+    std::optional<std::vector<std::string>> values;
+    for (const std::string& line : readCacheLines(cacheFile))
+    {
+        std::vector<std::string> fields = splitString(line);
+        if (!fields.empty() && fields[0] == key)
+        {
+            fields.erase(fields.begin());
+            values = std::move(fields);
+        }
+    }
+    return values;
+}
+
+void writePmeTuningCacheEntry(const std::filesystem::path&    cacheFile,
+                              const std::string&              key,
+                              const std::vector<std::string>& values)
+{
+    std::string contents = "# GROMACS PME tuning database, one entry per line: key values...\n";
+    for (const std::string& line : readCacheLines(cacheFile))
+    {
+        if (lineKey(line) != key)
+        {
+            contents += line + "\n";
+        }
+    }
+    contents += key;
+    for (const std::string& value : values)
+    {
+        contents += " " + value;
+    }
+    contents += "\n";
+
+    std::filesystem::path tempFile = cacheFile;
+    tempFile += formatString(".%d.tmp", gmx_getpid());
+    TextWriter::writeFileFromString(tempFile, contents);
+
+    std::error_code errorCode;
+    std::filesystem::rename(tempFile, cacheFile, errorCode);
+    if (errorCode)
+    {
+        std::filesystem::remove(tempFile, errorCode);
+        GMX_THROW(FileIOError("Could not write the PME tuning database " + cacheFile.string()));
+    }
+}
+
+std::optional<PmeTuningRunSettings> readPmeTuningRunSettings(const std::filesystem::path& cacheFile,
+                                                             const std::string&           key)
+{
+    const auto values = readPmeTuningCacheEntry(cacheFile, key);
+    if (!values || values->size() != 6)
+    {
+        return std::nullopt;
+    }
+
+    PmeTuningRunSettings settings;
+    try
+    {
+        settings.numPmeRanks = std::stoi((*values)[0]);
+        settings.nkx         = std::stoi((*values)[1]);
+        settings.nky         = std::stoi((*values)[2]);
+        settings.nkz         = std::stoi((*values)[3]);
+        settings.rcoulomb    = std::stod((*values)[4]);
+        settings.rvdw        = std::stod((*values)[5]);
+    }
+    catch (const std::exception&)
+    {
+        return std::nullopt;
+    }
+    if (settings.nkx <= 0 || settings.nky <= 0 || settings.nkz <= 0 || settings.rcoulomb <= 0
+        || settings.rvdw <= 0)
+    {
+        return std::nullopt;
+    }
+    return settings;
+}
+
+void writePmeTuningRunSettings(const std::filesystem::path& cacheFile,
+                               const std::string&           key,
+                               const PmeTuningRunSettings&  settings)
+{
+    writePmeTuningCacheEntry(cacheFile,
+                             key,
+                             { toString(settings.numPmeRanks),
+                               toString(settings.nkx),
+                               toString(settings.nky),
+                               toString(settings.nkz),
+                               formatString("%.6f", settings.rcoulomb),
+                               formatString("%.6f", settings.rvdw) });
+}
+
+} // namespace gmx
@@ -0,0 +1,151 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares functions for a small on-disk database of PME tuning results.
+ *
+ * The database is a text file with one entry per line. Each entry
+ * consists of a key followed by whitespace-separated values. Lines
+ * starting with '#' are comments. Keys are typically fingerprints
+ * obtained with pmeTuningFingerprint(), prefixed with a short tag
+ * naming the kind of entry, so that different users of the database
+ * can share one file.
+ *
+ * Both kinds of entries store a PmeTuningRunSettings. Settings for a
+ * complete run are stored with keys created by makePmeTuningRunKey()
+ * from a hash of the run input file, a hardware fingerprint and the
+ * requested rank and thread layout. These are written by mdrun after PME
+ * load balancing and by gmx tune_pme, and read by mdrun at startup.
+ * The setup selected by PME load balancing is also stored with a key
+ * created by makePmeTuningLoadBalancingKey() from the conditions the
+ * balancing started from, and is tried first by later balancing runs.
+ *
+ * \ingroup module_ewald
+ */
+
+#ifndef GMX_EWALD_PME_TUNING_CACHE_H
+#define GMX_EWALD_PME_TUNING_CACHE_H
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace gmx
+{
+
+/*! \brief PP-PME settings, as selected by load balancing or gmx tune_pme */
+struct PmeTuningRunSettings
+{
+    //! Number of separate PME ranks, -1 lets mdrun choose
+    int numPmeRanks = -1;
+    //! PME grid dimensions
+    int nkx = 0;
+    //! PME grid dimensions
+    int nky = 0;
+    //! PME grid dimensions
+    int nkz = 0;
+    //! Coulomb cut-off
+    double rcoulomb = 0;
+    //! Van der Waals cut-off
+    double rvdw = 0;
+};
+
+/*! \brief Returns a hexadecimal MD5 hash of \p description for use as a cache key */
+std::string pmeTuningFingerprint(const std::string& description);
+
+/*! \brief Returns a hexadecimal MD5 hash of the contents of \p fileName
+ *
+ * \throws FileIOError when the file cannot be read.
+ */
+std::string pmeTuningFileHash(const std::filesystem::path& fileName);
+
+/*! \brief Returns the cache key for run settings
+ *
+ * \param[in] inputFileHash        Hash of the run input file, from pmeTuningFileHash()
+ * \param[in] hardwareFingerprint  Description of the hardware of a node
+ * \param[in] numRanks             The total number of ranks
+ * \param[in] numPmeRanksRequested The requested number of PME ranks, -1 for automated
+ * \param[in] numThreadsRequested  The requested number of OpenMP threads, 0 for automated
+ */
+std::string makePmeTuningRunKey(const std::string& inputFileHash,
+                                const std::string& hardwareFingerprint,
+                                int                numRanks,
+                                int                numPmeRanksRequested,
+                                int                numThreadsRequested);
+
+/*! \brief Returns the cache key for the setup selected by PME load balancing
+ *
+ * \param[in] description  Description of the hardware, the rank and thread
+ *                         layout and the setup the balancing started from
+ */
+std::string makePmeTuningLoadBalancingKey(const std::string& description);
+
+/*! \brief Returns the settings stored for \p key, empty when absent or malformed */
+std::optional<PmeTuningRunSettings> readPmeTuningRunSettings(const std::filesystem::path& cacheFile,
+                                                             const std::string&           key);
+
+/*! \brief Stores \p settings for \p key
+ *
+ * \throws FileIOError when the file cannot be written.
+ */
+void writePmeTuningRunSettings(const std::filesystem::path& cacheFile,
+                               const std::string&           key,
+                               const PmeTuningRunSettings&  settings);
+
+/*! \brief Returns the values stored for \p key in \p cacheFile
+ *
+ * Returns an empty optional when the file does not exist, cannot be
+ * read or does not contain \p key. When a key occurs multiple times,
+ * the last occurrence is returned.
+ */
+std::optional<std::vector<std::string>>
+readPmeTuningCacheEntry(const std::filesystem::path& cacheFile, const std::string& key);
+
+/*! \brief Stores \p values for \p key in \p cacheFile
+ *
+ * An existing entry for \p key is replaced, all other entries are kept.
+ * The file is created when it does not exist. The new contents are
+ * written to a temporary file that is then renamed, so concurrent
+ * readers never see a partially written database.
+ *
+ * \throws FileIOError when the file cannot be written.
+ */
+void writePmeTuningCacheEntry(const std::filesystem::path&    cacheFile,
+                              const std::string&              key,
+                              const std::vector<std::string>& values);
+
+} // namespace gmx
+
+#endif
@@ -44,9 +44,14 @@
 #include "gromacs/ewald/pme.h"
 
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/ewald/pme_grid.h"
+#include "gromacs/ewald/pme_internal.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/stringcompare.h"
 
@@ -119,6 +124,48 @@ TEST_F(SeparatePmeRanksPermittedTest, EmptyDisableReasonText)
     EXPECT_TRUE(separatePmeRanksPermitted_.reasonsWhyDisabled().empty());
 }
 
+//! Test fixture for setting up thread-local PME grids, parametrized on the PME order
+class PmeThreadGridsTest : public ::testing::TestWithParam<int>
+{
+};
+
+TEST_P(PmeThreadGridsTest, ThreadGridsHaveSimdPadding)
+{
+    const int pmeOrder   = GetParam();
+    const int numThreads = 4;
+    const int gridSize   = 28;
+
+    std::vector<AlignedVector<real>> gridsStorage(1 + numThreads);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        // The second pass reuses the storage allocated in the first pass.
+        // Both passes assert that the storage has the padding needed by
+        // the SIMD spread and gather kernels.
+        pmegrids_t grids;
+        pmegrids_init(&grids,
+                      gridSize + pmeOrder - 1,
+                      gridSize + pmeOrder - 1,
+                      gridSize + pmeOrder - 1,
+                      gridSize,
+                      pmeOrder,
+                      TRUE,
+                      numThreads,
+                      pmeOrder - 1,
+                      pmeOrder - 1,
+                      gridsStorage);
+
+        ASSERT_EQ(numThreads, gmx::ssize(grids.grid_th));
+        for (int thread = 0; thread < numThreads; thread++)
+        {
+            const pmegrid_t& grid = grids.grid_th[thread];
+            EXPECT_EQ(grid.s[XX] * grid.s[YY] * grid.s[ZZ], grid.grid.ssize());
+            EXPECT_GE(gmx::ssize(gridsStorage[1 + thread]), grid.grid.ssize());
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(WithAllOrders, PmeThreadGridsTest, ::testing::Range(4, 9));
+
 } // namespace test
 
 } // namespace gmx
@@ -81,6 +81,8 @@ namespace
 
 //! A couple of valid inputs for grid sizes
 std::vector<IVec> const c_inputGridSizes{ IVec{ 16, 12, 14 }, IVec{ 13, 15, 11 } };
+//! Grid sizes for the PME orders in c_inputHighPmeOrders
+std::vector<IVec> const c_inputGridSizesHighOrder{ IVec{ 16, 14, 15 }, IVec{ 15, 17, 14 } };
 
 //! A structure for all the spline data which depends in size both on the PME order and atom count
 struct SplineData
@@ -454,6 +456,16 @@ void registerDynamicalPmeGatherTests(const Range<int> hardwareContextIndexRange)
             ::testing::Range(*hardwareContextIndexRange.begin(), *hardwareContextIndexRange.end()));
     gmx::test::registerTests<GatherTest, GatherTestBody, decltype(testCombinations)>(
             "Pme_GatherTest", nameOfTest, fullNameOfTest, testCombinations);
+
+    const auto highOrderTestCombinations = ::testing::Combine(
+            c_inputBoxNames,
+            ::testing::ValuesIn(c_inputHighPmeOrders),
+            ::testing::ValuesIn(c_inputGridSizesHighOrder),
+            c_inputGridNames,
+            c_inputTestSystemNames,
+            ::testing::Range(*hardwareContextIndexRange.begin(), *hardwareContextIndexRange.end()));
+    gmx::test::registerTests<GatherTest, GatherTestBody, decltype(highOrderTestCombinations)>(
+            "Pme_GatherTest", nameOfTest, fullNameOfTest, highOrderTestCombinations);
 }
 
 } // namespace test
@@ -85,6 +85,8 @@ namespace
 
 //! A couple of valid inputs for grid sizes
 std::vector<IVec> const c_inputGridSizes{ IVec{ 16, 12, 14 }, IVec{ 19, 17, 11 } };
+//! Grid sizes for the PME orders in c_inputHighPmeOrders
+std::vector<IVec> const c_inputGridSizesHighOrder{ IVec{ 16, 14, 15 }, IVec{ 19, 17, 14 } };
 
 //! PME spline and spread code path being tested
 enum class SplineAndSpreadOptions
@@ -438,6 +440,20 @@ void registerDynamicalPmeSplineSpreadTests(const Range<int> hardwareContextIndex
                               SplineAndSpreadOptions::SplineAndSpreadUnified));
     gmx::test::registerTests<SplineAndSpreadTest, SplineAndSpreadTestBody, decltype(testCombinations)>(
             "Pme_SplineAndSpreadTest", nameOfTest, fullNameOfTest, testCombinations);
+
+    const auto highOrderTestCombinations = ::testing::Combine(
+            c_inputBoxNames,
+            ::testing::ValuesIn(c_inputHighPmeOrders),
+            ::testing::ValuesIn(c_inputGridSizesHighOrder),
+            c_inputTestSystemNames,
+            ::testing::Range(*hardwareContextIndexRange.begin(), *hardwareContextIndexRange.end()),
+            ::testing::Values(SplineAndSpreadOptions::SplineOnly,
+                              SplineAndSpreadOptions::SpreadOnly,
+                              SplineAndSpreadOptions::SplineAndSpreadUnified));
+    gmx::test::registerTests<SplineAndSpreadTest,
+                             SplineAndSpreadTestBody,
+                             decltype(highOrderTestCombinations)>(
+            "Pme_SplineAndSpreadTest", nameOfTest, fullNameOfTest, highOrderTestCombinations);
 }
 
 } // namespace test
@@ -102,7 +102,10 @@ const std::map<std::string, Matrix3x3> c_inputBoxes = {
 };
 
 //! Valid PME orders for testing
-std::vector<int> c_inputPmeOrders{ 3, 4, 5 };
+std::vector<int> c_inputPmeOrders{ 3, 4, 5, 6 };
+
+//! PME orders that need larger grids than the other tests use
+std::vector<int> c_inputHighPmeOrders{ 7, 8 };
 
 MessageStringCollector getSkipMessagesIfNecessary(const t_inputrec& inputRec, const CodePath codePath)
 {
@@ -295,6 +295,9 @@ extern const std::map<std::string, Matrix3x3> c_inputBoxes;
 //! Valid PME orders for testing
 extern std::vector<int> c_inputPmeOrders;
 
+//! PME orders that need at least 2*(order-1) = 14 grid points along each dimension
+extern std::vector<int> c_inputHighPmeOrders;
+
 } // namespace test
 } // namespace gmx
 
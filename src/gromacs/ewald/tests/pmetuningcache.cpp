@@ -0,0 +1,164 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the PME tuning cache.
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include "gromacs/ewald/pme_tuning_cache.h"
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+TEST(PmeTuningCacheTest, FingerprintIsStableAndDistinguishesInput)
+{
+    const std::string fingerprint = pmeTuningFingerprint("cpu 'A' ranks 4");
+    EXPECT_EQ(32U, fingerprint.size());
+    EXPECT_EQ(fingerprint, pmeTuningFingerprint("cpu 'A' ranks 4"));
+    EXPECT_NE(fingerprint, pmeTuningFingerprint("cpu 'A' ranks 8"));
+}
+
+TEST(PmeTuningCacheTest, MissingFileHasNoEntries)
+{
+    TestFileManager fileManager;
+    EXPECT_FALSE(readPmeTuningCacheEntry(fileManager.getTemporaryFilePath("cache.dat"), "key"));
+}
+
+TEST(PmeTuningCacheTest, WritesAndReplacesEntries)
+{
+    TestFileManager fileManager;
+    const auto      cacheFile = fileManager.getTemporaryFilePath("cache.dat");
+
+    writePmeTuningCacheEntry(cacheFile, "first", { "1", "2" });
+    writePmeTuningCacheEntry(cacheFile, "second", { "3" });
+    writePmeTuningCacheEntry(cacheFile, "first", { "4", "5", "6" });
+
+    const auto first  = readPmeTuningCacheEntry(cacheFile, "first");
+    const auto second = readPmeTuningCacheEntry(cacheFile, "second");
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_THAT(*first, ::testing::ElementsAre("4", "5", "6"));
+    EXPECT_THAT(*second, ::testing::ElementsAre("3"));
+    EXPECT_FALSE(readPmeTuningCacheEntry(cacheFile, "third"));
+}
+
+TEST(PmeTuningCacheTest, IgnoresCommentsAndEmptyLines)
+{
+    TestFileManager fileManager;
+    const auto      cacheFile = fileManager.getTemporaryFilePath("cache.dat");
+    TextWriter::writeFileFromString(cacheFile, "# comment\n\n  key 1 2 # trailing\n");
+
+    const auto values = readPmeTuningCacheEntry(cacheFile, "key");
+    ASSERT_TRUE(values);
+    EXPECT_THAT(*values, ::testing::ElementsAre("1", "2"));
+}
+
+TEST(PmeTuningCacheTest, RunKeyDistinguishesLayout)
+{
+    const std::string key = makePmeTuningRunKey("abc", "cpu 'A'", 4, -1, 0);
+    EXPECT_EQ(key, makePmeTuningRunKey("abc", "cpu 'A'", 4, -1, 0));
+    EXPECT_NE(key, makePmeTuningRunKey("abd", "cpu 'A'", 4, -1, 0));
+    EXPECT_NE(key, makePmeTuningRunKey("abc", "cpu 'B'", 4, -1, 0));
+    EXPECT_NE(key, makePmeTuningRunKey("abc", "cpu 'A'", 8, -1, 0));
+    EXPECT_NE(key, makePmeTuningRunKey("abc", "cpu 'A'", 4, 1, 0));
+    EXPECT_NE(key, makePmeTuningRunKey("abc", "cpu 'A'", 4, -1, 2));
+}
+
+TEST(PmeTuningCacheTest, LoadBalancingKeyDiffersFromRunKey)
+{
+    const std::string key = makePmeTuningLoadBalancingKey("cpu 'A' ranks 4");
+    EXPECT_EQ(key, makePmeTuningLoadBalancingKey("cpu 'A' ranks 4"));
+    EXPECT_NE(key, makePmeTuningLoadBalancingKey("cpu 'A' ranks 8"));
+    EXPECT_NE(key, makePmeTuningRunKey("abc", "cpu 'A'", 4, -1, 0));
+}
+
+TEST(PmeTuningCacheTest, WritesAndReadsRunSettings)
+{
+    TestFileManager fileManager;
+    const auto      cacheFile = fileManager.getTemporaryFilePath("cache.dat");
+
+    PmeTuningRunSettings settings;
+    settings.numPmeRanks = 2;
+    settings.nkx         = 48;
+    settings.nky         = 40;
+    settings.nkz         = 36;
+    settings.rcoulomb    = 1.125;
+    settings.rvdw        = 1.0;
+    writePmeTuningRunSettings(cacheFile, "run", settings);
+
+    const auto stored = readPmeTuningRunSettings(cacheFile, "run");
+    ASSERT_TRUE(stored);
+    EXPECT_EQ(2, stored->numPmeRanks);
+    EXPECT_EQ(48, stored->nkx);
+    EXPECT_EQ(40, stored->nky);
+    EXPECT_EQ(36, stored->nkz);
+    EXPECT_DOUBLE_EQ(1.125, stored->rcoulomb);
+    EXPECT_DOUBLE_EQ(1.0, stored->rvdw);
+    EXPECT_FALSE(readPmeTuningRunSettings(cacheFile, "other"));
+}
+
+TEST(PmeTuningCacheTest, RejectsMalformedRunSettings)
+{
+    TestFileManager fileManager;
+    const auto      cacheFile = fileManager.getTemporaryFilePath("cache.dat");
+    TextWriter::writeFileFromString(cacheFile, "short 1 48 40\nbad 1 48 x 36 1.0 1.0\n");
+
+    EXPECT_FALSE(readPmeTuningRunSettings(cacheFile, "short"));
+    EXPECT_FALSE(readPmeTuningRunSettings(cacheFile, "bad"));
+}
+
+} // namespace
+
+} // namespace test
+
+} // namespace gmx
@@ -48,6 +48,7 @@
 
 #include "gromacs/gpu_utils/gpu_utils.h"
 #include "gromacs/gpu_utils/hostallocator.h"
+#include "gromacs/math/bfloat16.h"
 #include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
@@ -144,6 +145,7 @@ static constexpr bool allocatePmeGpuMixedMode = (GMX_GPU && !GMX_GPU_OPENCL);
  * P0 number of processor in 1st axes (can be null for automatic)
  * lin is allocated by fft5d because size of array is only known after planning phase
  * rlout2 is only used as intermediate buffer - only returned after allocation to reuse for back transform - should not be used by caller
+ * numPipelineChunks>1 splits the transposes into chunks which are overlapped with the 1D FFTs
  */
 fft5d_plan fft5d_plan_3d(int                NG,
                          int                MG,
@@ -155,7 +157,8 @@ fft5d_plan fft5d_plan_3d(int                NG,
                          t_complex**        rlout2,
                          t_complex**        rlout3,
                          int                nthreads,
-                         gmx::PinningPolicy realGridAllocationPinningPolicy)
+                         gmx::PinningPolicy realGridAllocationPinningPolicy,
+                         int                numPipelineChunks)
 {
 
     int  P[2], prank[2], i;
@@ -438,9 +441,10 @@ fft5d_plan fft5d_plan_3d(int                NG,
             snew_aligned(lin, lsize, 32);
         }
         snew_aligned(lout, lsize, 32);
-        if (nthreads > 1)
+        if (nthreads > 1 || numPipelineChunks > 1)
         {
-            /* We need extra transpose buffers to avoid OpenMP barriers */
+            /* We need extra transpose buffers to avoid OpenMP barriers
+             * and to overlap the FFTs with the communication of the transposes */
             snew_aligned(lout2, lsize, 32);
             snew_aligned(lout3, lsize, 32);
         }
@@ -455,7 +459,7 @@ fft5d_plan fft5d_plan_3d(int                NG,
     {
         lin  = *rlin;
         lout = *rlout;
-        if (nthreads > 1)
+        if (nthreads > 1 || numPipelineChunks > 1)
         {
             lout2 = *rlout2;
             lout3 = *rlout3;
@@ -664,6 +668,68 @@ fft5d_plan fft5d_plan_3d(int                NG,
 #if GMX_FFT_FFTW3
     }
 #endif
+
+    /* With pipelining, the FFTs in the parallel dimensions are done per chunk of
+       the transpose, so we need a set of plans for each chunk */
+    plan->numPipelineChunks = std::max(numPipelineChunks, 1);
+    for (s = 0; s < 2; s++)
+    {
+        if (plan->numPipelineChunks == 1 || nP[s] == 1)
+        {
+            continue;
+        }
+        plan->p1dChunk[s] = static_cast<gmx_fft_t*>(
+                malloc(sizeof(gmx_fft_t) * plan->numPipelineChunks * nthreads));
+        for (int c = 0; c < plan->numPipelineChunks; c++)
+        {
+            const int zStart = (c * K[s]) / plan->numPipelineChunks;
+            const int zEnd   = std::min(((c + 1) * K[s]) / plan->numPipelineChunks, pK[s]);
+            const int nlines = pM[s] * std::max(zEnd - zStart, 0);
+#pragma omp parallel for num_threads(nthreads) schedule(static) ordered
+            for (int t = 0; t < nthreads; t++)
+            {
+#pragma omp ordered
+                {
+                    try
+                    {
+                        int tsize = ((t + 1) * nlines / nthreads) - (t * nlines / nthreads);
+
+                        if ((flags & FFT5D_REALCOMPLEX) && !(flags & FFT5D_BACKWARD) && s == 0)
+                        {
+                            gmx_fft_init_many_1d_real(
+                                    &plan->p1dChunk[s][c * nthreads + t],
+                                    rC[s],
+                                    tsize,
+                                    (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                        }
+                        else
+                        {
+                            gmx_fft_init_many_1d(&plan->p1dChunk[s][c * nthreads + t],
+                                                 C[s],
+                                                 tsize,
+                                                 (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                        }
+                    }
+                    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+                }
+            }
+        }
+    }
+    if (plan->numPipelineChunks > 1)
+    {
+        plan->chunkRequests = static_cast<MPI_Request*>(
+                malloc(sizeof(MPI_Request) * 2 * std::max(nP[0], nP[1]) * plan->numPipelineChunks));
+    }
+    if ((flags & FFT5D_BF16_COMM) && (nP[0] > 1 || nP[1] > 1))
+    {
+        /* The transposes are communicated as bfloat16 through these buffers */
+        for (s = 0; s < 2; s++)
+        {
+            plan->bf16Buf[s] = static_cast<uint16_t*>(
+                    malloc(sizeof(uint16_t) * lsize * sizeof(t_complex) / sizeof(real)));
+        }
+    }
+
     if ((flags & FFT5D_ORDER_YZ)) /*plan->cart is in the order of transposes */
     {
         plan->cart[0] = comm[0];
@@ -802,7 +868,8 @@ static void splitaxes(t_complex*       lout,
    variables see above
    the major, middle, minor order is only correct for x,y,z (N,M,K) for the input
    N,M,K local dimensions
-   KG global size*/
+   KG global size
+   only the z range startz-endz of each received block is joined*/
 static void joinAxesTrans13(t_complex*       lout,
                             const t_complex* lin,
                             int              maxN,
@@ -816,7 +883,9 @@ static void joinAxesTrans13(t_complex*       lout,
                             int              starty,
                             int              startx,
                             int              endy,
-                            int              endx)
+                            int              endx,
+                            int              startz,
+                            int              endz)
 {
     int i, x, y, z;
     int out_i, in_i, out_x, in_x, out_z, in_z;
@@ -848,7 +917,7 @@ static void joinAxesTrans13(t_complex*       lout,
         {
             out_i = out_x + oK[i];
             in_i  = in_x + i * maxM * maxN * maxK;
-            for (z = 0; z < K[i]; z++) /*3.l*/
+            for (z = startz; z < std::min(endz, K[i]); z++) /*3.l*/
             {
                 out_z = out_i + z;
                 in_z  = in_i + z * maxM * maxN;
@@ -1084,6 +1153,239 @@ static void print_localdata(const t_complex* lin, const char* txt, int s, fft5d_
     }
 }
 
+#if GMX_MPI
+/*All-to-all transpose of count reals per rank from sendbuf to recvbuf,
+   with FFT5D_BF16_COMM the data is communicated as bfloat16*/
+static void fft5d_alltoall(fft5d_plan       plan,
+                           int              s,
+                           const t_complex* sendbuf,
+                           t_complex*       recvbuf,
+                           int              count)
+{
+    if (plan->flags & FFT5D_BF16_COMM)
+    {
+        const int total = count * plan->P[s];
+        gmx::packToBfloat16(reinterpret_cast<const real*>(sendbuf), total, plan->bf16Buf[0]);
+        MPI_Alltoall(plan->bf16Buf[0],
+                     count,
+                     MPI_UNSIGNED_SHORT,
+                     plan->bf16Buf[1],
+                     count,
+                     MPI_UNSIGNED_SHORT,
+                     plan->cart[s]);
+        gmx::unpackFromBfloat16(plan->bf16Buf[1], total, reinterpret_cast<real*>(recvbuf));
+    }
+    else
+    {
+        MPI_Alltoall(reinterpret_cast<const real*>(sendbuf),
+                     count,
+                     GMX_MPI_REAL,
+                     reinterpret_cast<real*>(recvbuf),
+                     count,
+                     GMX_MPI_REAL,
+                     plan->cart[s]);
+    }
+}
+#endif
+
+/*FFT, split, transpose and join for step s in a parallel dimension with pipelining.
+   The data is split along the major dimension of the transpose blocks (z) into chunks.
+   Each chunk is transposed with non-blocking communication as soon as its 1D FFTs
+   are done, so the FFTs of the later chunks run while the earlier chunks are in flight.
+   The received chunks are joined in chunk order once their communication has completed.
+   Needs separate lout2 and lout3 buffers, which are allocated when pipelining.*/
+static void fft5d_execute_pipelined(fft5d_plan plan, int s, int thread, fft5d_time gmx_unused times)
+{
+    t_complex* lin   = plan->lin;
+    t_complex* lout  = plan->lout;
+    t_complex* lout2 = plan->lout2;
+    t_complex* lout3 = plan->lout3;
+
+    int *N = plan->N, *M = plan->M, *K = plan->K, *pN = plan->pN, *pM = plan->pM, *pK = plan->pK,
+        *C = plan->C, **iNin = plan->iNin, **oNin = plan->oNin, **iNout = plan->iNout,
+        **oNout = plan->oNout;
+
+    const int numChunks = plan->numPipelineChunks;
+    const int nthreads  = plan->nthreads;
+    const int P         = plan->P[s];
+    /* Each block to/from a rank has the same size, z is the major dimension of a block */
+    const int  planeSize = N[s] * M[s];
+    const int  blockSize = planeSize * K[s];
+    const bool bTrans13  = ((s == 0 && !(plan->flags & FFT5D_ORDER_YZ))
+                           || (s == 1 && (plan->flags & FFT5D_ORDER_YZ)));
+
+    GMX_RELEASE_ASSERT(lout2 != lin && lout3 != lout,
+                       "Pipelined transposes need separate transpose buffers");
+    GMX_ASSERT(bTrans13 ? M[s] == pM[s] : K[s] == pK[s],
+               "The transpose blocks should have the same size for all ranks");
+
+    /* The lines of the chunks are distributed differently over the threads than
+       in the join of the previous step, which does not end with a barrier */
+#pragma omp barrier
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        const int zStart = (c * K[s]) / numChunks;
+        const int zEnd   = ((c + 1) * K[s]) / numChunks;
+        const int nlines = pM[s] * std::max(std::min(zEnd, pK[s]) - zStart, 0);
+        const int tstart = zStart * pM[s] + (thread * nlines / nthreads);
+        const int tend   = zStart * pM[s] + ((thread + 1) * nlines / nthreads);
+
+        /* ---------- FFT of the lines in this chunk ------------ */
+        if (tend > tstart)
+        {
+            gmx_fft_t p1d = plan->p1dChunk[s][c * nthreads + thread];
+            if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
+            {
+                gmx_fft_many_1d_real(
+                        p1d, GMX_FFT_REAL_TO_COMPLEX, lin + tstart * C[s], lout + tstart * C[s]);
+            }
+            else
+            {
+                gmx_fft_many_1d(p1d,
+                                (plan->flags & FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD,
+                                lin + tstart * C[s],
+                                lout + tstart * C[s]);
+            }
+
+            /* ---------- SPLIT of the lines in this chunk ------------ */
+            splitaxes(lout2,
+                      lout,
+                      N[s],
+                      M[s],
+                      K[s],
+                      pM[s],
+                      P,
+                      C[s],
+                      iNout[s],
+                      oNout[s],
+                      tstart % pM[s],
+                      tstart / pM[s],
+                      tend % pM[s],
+                      tend / pM[s]);
+        }
+#pragma omp barrier /*all data of this chunk has to be split before sending*/
+
+        /* ---------- START TRANSPOSE of this chunk ------------ */
+        if (thread == 0)
+        {
+#ifndef NOGMX
+            wallcycle_start(times, WallCycleCounter::PmeFftComm);
+#endif
+#if GMX_MPI
+            const int    count    = (zEnd - zStart) * planeSize * sizeof(t_complex) / sizeof(real);
+            MPI_Request* requests = plan->chunkRequests + 2 * P * c;
+            for (int i = 0; i < P; i++)
+            {
+                const int offset = i * blockSize + zStart * planeSize;
+                void*        sendPtr  = lout2 + offset;
+                void*        recvPtr  = lout3 + offset;
+                MPI_Datatype datatype = GMX_MPI_REAL;
+                if (plan->flags & FFT5D_BF16_COMM)
+                {
+                    const int realOffset = offset * sizeof(t_complex) / sizeof(real);
+                    gmx::packToBfloat16(reinterpret_cast<const real*>(lout2 + offset),
+                                        count,
+                                        plan->bf16Buf[0] + realOffset);
+                    sendPtr  = plan->bf16Buf[0] + realOffset;
+                    recvPtr  = plan->bf16Buf[1] + realOffset;
+                    datatype = MPI_UNSIGNED_SHORT;
+                }
+                MPI_Irecv(recvPtr, count, datatype, i, c, plan->cart[s], &requests[2 * i]);
+                MPI_Isend(sendPtr, count, datatype, i, c, plan->cart[s], &requests[2 * i + 1]);
+            }
+#else
+            GMX_RELEASE_ASSERT(false, "Invalid call to fft5d_execute_pipelined");
+#endif
+#ifndef NOGMX
+            wallcycle_stop(times, WallCycleCounter::PmeFftComm);
+#endif
+        }
+    }
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        const int zStart = (c * K[s]) / numChunks;
+        const int zEnd   = ((c + 1) * K[s]) / numChunks;
+
+        if (thread == 0)
+        {
+#ifndef NOGMX
+            wallcycle_start(times, WallCycleCounter::PmeFftComm);
+#endif
+#if GMX_MPI
+            MPI_Waitall(2 * P, plan->chunkRequests + 2 * P * c, MPI_STATUSES_IGNORE);
+            if (plan->flags & FFT5D_BF16_COMM)
+            {
+                const int count = (zEnd - zStart) * planeSize * sizeof(t_complex) / sizeof(real);
+                for (int i = 0; i < P; i++)
+                {
+                    const int realOffset =
+                            (i * blockSize + zStart * planeSize) * sizeof(t_complex) / sizeof(real);
+                    gmx::unpackFromBfloat16(plan->bf16Buf[1] + realOffset,
+                                            count,
+                                            reinterpret_cast<real*>(lout3) + realOffset);
+                }
+            }
+#endif
+#ifndef NOGMX
+            wallcycle_stop(times, WallCycleCounter::PmeFftComm);
+#endif
+        }
+#pragma omp barrier /*wait for the data of this chunk*/
+
+        /* ---------- JOIN of this chunk ------------ */
+        if (bTrans13)
+        {
+            if (pM[s] > 0)
+            {
+                const int tstart = (thread * pM[s] * pN[s] / nthreads);
+                const int tend   = ((thread + 1) * pM[s] * pN[s] / nthreads);
+                joinAxesTrans13(lin,
+                                lout3,
+                                N[s],
+                                pM[s],
+                                K[s],
+                                pM[s],
+                                P,
+                                C[s + 1],
+                                iNin[s + 1],
+                                oNin[s + 1],
+                                tstart % pM[s],
+                                tstart / pM[s],
+                                tend % pM[s],
+                                tend / pM[s],
+                                zStart,
+                                zEnd);
+            }
+        }
+        else
+        {
+            const int nlines = pN[s] * std::max(std::min(zEnd, pK[s]) - zStart, 0);
+            if (nlines > 0)
+            {
+                const int tstart = zStart * pN[s] + (thread * nlines / nthreads);
+                const int tend   = zStart * pN[s] + ((thread + 1) * nlines / nthreads);
+                joinAxesTrans12(lin,
+                                lout3,
+                                N[s],
+                                M[s],
+                                pK[s],
+                                pN[s],
+                                P,
+                                C[s + 1],
+                                iNin[s + 1],
+                                oNin[s + 1],
+                                tstart % pN[s],
+                                tstart / pN[s],
+                                tend % pN[s],
+                                tend / pN[s]);
+            }
+        }
+    }
+#pragma omp barrier /*the joins are not distributed over threads as the following FFT*/
+}
+
 void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
 {
     t_complex* lin   = plan->lin;
@@ -1150,6 +1452,16 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
             bParallelDim = 0;
         }
 
+        if (bParallelDim && plan->numPipelineChunks > 1)
+        {
+            fft5d_execute_pipelined(plan, s, thread, times);
+            if ((plan->flags & FFT5D_DEBUG) && thread == 0)
+            {
+                print_localdata(lin, "%d %d: transposed\n", s + 1, plan);
+            }
+            continue;
+        }
+
         /* ---------- START FFT ------------ */
 #ifdef NOGMX
         if (times != 0 && thread == 0)
@@ -1259,23 +1571,19 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
                 if ((s == 0 && !(plan->flags & FFT5D_ORDER_YZ))
                     || (s == 1 && (plan->flags & FFT5D_ORDER_YZ)))
                 {
-                    MPI_Alltoall(reinterpret_cast<real*>(lout2),
-                                 N[s] * pM[s] * K[s] * sizeof(t_complex) / sizeof(real),
-                                 GMX_MPI_REAL,
-                                 reinterpret_cast<real*>(lout3),
-                                 N[s] * pM[s] * K[s] * sizeof(t_complex) / sizeof(real),
-                                 GMX_MPI_REAL,
-                                 cart[s]);
+                    fft5d_alltoall(plan,
+                                   s,
+                                   lout2,
+                                   lout3,
+                                   N[s] * pM[s] * K[s] * sizeof(t_complex) / sizeof(real));
                 }
                 else
                 {
-                    MPI_Alltoall(reinterpret_cast<real*>(lout2),
-                                 N[s] * M[s] * pK[s] * sizeof(t_complex) / sizeof(real),
-                                 GMX_MPI_REAL,
-                                 reinterpret_cast<real*>(lout3),
-                                 N[s] * M[s] * pK[s] * sizeof(t_complex) / sizeof(real),
-                                 GMX_MPI_REAL,
-                                 cart[s]);
+                    fft5d_alltoall(plan,
+                                   s,
+                                   lout2,
+                                   lout3,
+                                   N[s] * M[s] * pK[s] * sizeof(t_complex) / sizeof(real));
                 }
 #else
                 GMX_RELEASE_ASSERT(false, "Invalid call to fft5d_execute");
@@ -1334,7 +1642,9 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
                                 tstart % pM[s],
                                 tstart / pM[s],
                                 tend % pM[s],
-                                tend / pM[s]);
+                                tend / pM[s],
+                                0,
+                                K[s]);
             }
         }
         else
@@ -1434,6 +1744,14 @@ void fft5d_destroy(fft5d_plan plan)
             }
             free(plan->p1d[s]);
         }
+        if (s < 2 && plan->p1dChunk[s])
+        {
+            for (t = 0; t < plan->numPipelineChunks * plan->nthreads; t++)
+            {
+                gmx_many_fft_destroy(plan->p1dChunk[s][t]);
+            }
+            free(plan->p1dChunk[s]);
+        }
         if (plan->iNin[s])
         {
             free(plan->iNin[s]);
@@ -1482,7 +1800,7 @@ void fft5d_destroy(fft5d_plan plan)
             sfree_aligned(plan->lin);
         }
         sfree_aligned(plan->lout);
-        if (plan->nthreads > 1)
+        if (plan->nthreads > 1 || plan->numPipelineChunks > 1)
         {
             sfree_aligned(plan->lout2);
             sfree_aligned(plan->lout3);
@@ -1495,5 +1813,8 @@ void fft5d_destroy(fft5d_plan plan)
 #    endif
 #endif
 
+    free(plan->chunkRequests);
+    free(plan->bf16Buf[0]);
+    free(plan->bf16Buf[1]);
     free(plan);
 }
@@ -37,6 +37,8 @@
 
 #include "config.h"
 
+#include <cstdint>
+
 #ifdef NOGMX
 /*#define GMX_MPI*/
 /*#define GMX_FFT_FFTW3*/
@@ -87,7 +89,8 @@ typedef enum fft5d_flags_t
     FFT5D_DEBUG       = 8,
     FFT5D_NOMEASURE   = 16,
     FFT5D_INPLACE     = 32,
-    FFT5D_NOMALLOC    = 64
+    FFT5D_NOMALLOC    = 64,
+    FFT5D_BF16_COMM   = 128
 } fft5d_flags;
 
 struct fft5d_plan_t
@@ -119,6 +122,10 @@ struct fft5d_plan_t
     int                coor[2];
     int                nthreads;
     gmx::PinningPolicy pinningPolicy;
+    int numPipelineChunks; /*number of chunks the transposes are split into, 1 means no pipelining*/
+    gmx_fft_t*   p1dChunk[2];   /*1D plans per chunk and thread for the pipelined transposes*/
+    MPI_Request* chunkRequests; /*send and receive requests per chunk and rank*/
+    uint16_t*    bf16Buf[2]; /*send and receive buffers for transposes with FFT5D_BF16_COMM*/
 };
 
 typedef struct fft5d_plan_t* fft5d_plan;
@@ -134,7 +141,8 @@ fft5d_plan fft5d_plan_3d(int         N,
                          t_complex** lout2,
                          t_complex** lout3,
                          int         nthreads,
-                         gmx::PinningPolicy realGridAllocationPinningPolicy = gmx::PinningPolicy::CannotBePinned);
+                         gmx::PinningPolicy realGridAllocationPinningPolicy = gmx::PinningPolicy::CannotBePinned,
+                         int                numPipelineChunks = 1);
 void       fft5d_destroy(fft5d_plan plan);
 
 #endif
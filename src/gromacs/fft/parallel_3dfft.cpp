@@ -35,10 +35,13 @@
 
 #include "parallel_3dfft.h"
 
+#include "config.h"
+
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
 #include <filesystem>
 
 #include "gromacs/fft/fft.h"
@@ -74,6 +77,22 @@ int gmx_parallel_3dfft_init(gmx_parallel_3dfft_t* pfft_setup,
         flags |= FFT5D_NOMEASURE;
     }
 
+    /* Optionally communicate the transposes in reduced precision,
+     * which is only useful in mixed precision
+     */
+    if (!GMX_DOUBLE && getenv("GMX_PME_GRID_COMM_BF16") != nullptr)
+    {
+        flags |= FFT5D_BF16_COMM;
+    }
+
+    /* Optionally split the transposes into chunks to overlap communication with the FFTs */
+    int         numPipelineChunks = 1;
+    const char* pipelineEnv       = getenv("GMX_PME_FFT_PIPELINE_CHUNKS");
+    if (pipelineEnv != nullptr)
+    {
+        numPipelineChunks = std::max(1, static_cast<int>(strtol(pipelineEnv, nullptr, 10)));
+    }
+
     if (!(flags & FFT5D_ORDER_YZ))
     {
         Nb = M;
@@ -87,8 +106,18 @@ int gmx_parallel_3dfft_init(gmx_parallel_3dfft_t* pfft_setup,
         Kb = M; /* currently always true because ORDER_YZ always set */
     }
 
-    (*pfft_setup)->p1 = fft5d_plan_3d(
-            rN, M, K, rcomm, flags, reinterpret_cast<t_complex**>(real_data), complex_data, &buf1, &buf2, nthreads, realGridAllocation);
+    (*pfft_setup)->p1 = fft5d_plan_3d(rN,
+                                      M,
+                                      K,
+                                      rcomm,
+                                      flags,
+                                      reinterpret_cast<t_complex**>(real_data),
+                                      complex_data,
+                                      &buf1,
+                                      &buf2,
+                                      nthreads,
+                                      realGridAllocation,
+                                      numPipelineChunks);
 
     (*pfft_setup)->p2 = fft5d_plan_3d(Nb,
                                       Mb,
@@ -99,7 +128,9 @@ int gmx_parallel_3dfft_init(gmx_parallel_3dfft_t* pfft_setup,
                                       reinterpret_cast<t_complex**>(real_data),
                                       &buf1,
                                       &buf2,
-                                      nthreads);
+                                      nthreads,
+                                      gmx::PinningPolicy::CannotBePinned,
+                                      numPipelineChunks);
 
     return static_cast<int>((*pfft_setup)->p1 != nullptr && (*pfft_setup)->p2 != nullptr);
 }
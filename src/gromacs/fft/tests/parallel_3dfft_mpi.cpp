@@ -0,0 +1,258 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2026- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the pipelined transposes of the decomposed 3D FFT on the CPU.
+ *
+ * \ingroup module_fft
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+#include "testutils/testmatchers.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Environment variable that sets the number of chunks of the pipelined transposes
+const char* const c_pipelineEnvVar = "GMX_PME_FFT_PIPELINE_CHUNKS";
+
+//! Grids on this rank after the forward and backward transform
+struct LocalFftGrids
+{
+    //! The input real grid, only the local, unpadded part
+    std::vector<real> input;
+    //! The complex grid after the forward transform
+    std::vector<real> complexGrid;
+    //! The real grid after the backward transform
+    std::vector<real> realGrid;
+};
+
+//! Returns a smooth, non-periodic test function of the global grid indices
+real testFunction(int x, int y, int z)
+{
+    return std::sin(0.3 * x + 1.1) * std::cos(0.7 * y - 0.2) + 0.05 * z * z - 0.3 * x * y;
+}
+
+/*! \brief Runs a forward and a backward transform with \p numChunks pipeline chunks
+ *
+ * The number of chunks can only be set through the environment, so it is set here
+ * before the plans are created and removed again afterwards. With thread-MPI the
+ * ranks share the environment, so only one rank modifies it.
+ */
+LocalFftGrids runTransforms(MPI_Comm comm[2], const ivec gridSize, int numChunks, int numThreads)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const bool modifiesEnvironment = (!GMX_THREAD_MPI || rank == 0);
+
+    if (modifiesEnvironment && numChunks > 1)
+    {
+        setenv(c_pipelineEnvVar, std::to_string(numChunks).c_str(), 1);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    gmx_parallel_3dfft_t fft;
+    real*                rdata;
+    t_complex*           cdata;
+    gmx_parallel_3dfft_init(&fft, gridSize, &rdata, &cdata, comm, TRUE, numThreads);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (modifiesEnvironment && numChunks > 1)
+    {
+        unsetenv(c_pipelineEnvVar);
+    }
+
+    ivec realNData, realOffset, realSize;
+    gmx_parallel_3dfft_real_limits(fft, realNData, realOffset, realSize);
+    ivec complexOrder, complexNData, complexOffset, complexSize;
+    gmx_parallel_3dfft_complex_limits(fft, complexOrder, complexNData, complexOffset, complexSize);
+
+    LocalFftGrids grids;
+    for (int x = 0; x < realNData[XX]; x++)
+    {
+        for (int y = 0; y < realNData[YY]; y++)
+        {
+            for (int z = 0; z < realNData[ZZ]; z++)
+            {
+                const real value = testFunction(
+                        realOffset[XX] + x, realOffset[YY] + y, realOffset[ZZ] + z);
+                rdata[(x * realSize[YY] + y) * realSize[ZZ] + z] = value;
+                grids.input.push_back(value);
+            }
+        }
+    }
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        try
+        {
+            gmx_parallel_3dfft_execute(
+                    fft, GMX_FFT_REAL_TO_COMPLEX, gmx_omp_get_thread_num(), nullptr);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    for (int x = 0; x < complexNData[XX]; x++)
+    {
+        for (int y = 0; y < complexNData[YY]; y++)
+        {
+            for (int z = 0; z < complexNData[ZZ]; z++)
+            {
+                const t_complex& value = cdata[(x * complexSize[YY] + y) * complexSize[ZZ] + z];
+                grids.complexGrid.push_back(value.re);
+                grids.complexGrid.push_back(value.im);
+            }
+        }
+    }
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        try
+        {
+            gmx_parallel_3dfft_execute(
+                    fft, GMX_FFT_COMPLEX_TO_REAL, gmx_omp_get_thread_num(), nullptr);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    const real normalization = 1.0 / (gridSize[XX] * gridSize[YY] * gridSize[ZZ]);
+    for (int x = 0; x < realNData[XX]; x++)
+    {
+        for (int y = 0; y < realNData[YY]; y++)
+        {
+            for (int z = 0; z < realNData[ZZ]; z++)
+            {
+                grids.realGrid.push_back(normalization
+                                         * rdata[(x * realSize[YY] + y) * realSize[ZZ] + z]);
+            }
+        }
+    }
+
+    gmx_parallel_3dfft_destroy(fft);
+
+    return grids;
+}
+
+//! Test parameters: grid size, number of domains along x, number of chunks, number of threads
+using PipelinedFftTestParams = std::tuple<IVec, int, int, int>;
+
+class PipelinedFftTest : public ::testing::TestWithParam<PipelinedFftTestParams>
+{
+};
+
+TEST_P(PipelinedFftTest, MatchesBlockingTransposes)
+{
+    GMX_MPI_TEST(RequireRankCount<4>);
+
+    const auto [gridSizeVec, numDomainsX, numChunks, numThreads] = GetParam();
+    const ivec gridSize = { gridSizeVec[XX], gridSizeVec[YY], gridSizeVec[ZZ] };
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const int numDomainsY = numRanks / numDomainsX;
+
+    // Set up the communicators the same way as PME does
+    MPI_Comm comm[2] = { MPI_COMM_NULL, MPI_COMM_NULL };
+    if (numDomainsY == 1)
+    {
+        comm[0] = MPI_COMM_WORLD;
+    }
+    else if (numDomainsX == 1)
+    {
+        comm[1] = MPI_COMM_WORLD;
+    }
+    else
+    {
+        MPI_Comm_split(MPI_COMM_WORLD, rank % numDomainsY, rank, &comm[0]);
+        MPI_Comm_split(MPI_COMM_WORLD, rank / numDomainsY, rank, &comm[1]);
+    }
+
+    const LocalFftGrids blocking  = runTransforms(comm, gridSize, 1, numThreads);
+    const LocalFftGrids pipelined = runTransforms(comm, gridSize, numChunks, numThreads);
+
+    // The 1D FFTs in the pipelined code are planned per chunk, so the
+    // results can differ in the last bits
+    const auto tolerance = relativeToleranceAsFloatingPoint(100, 5e-6);
+    EXPECT_THAT(pipelined.complexGrid, Pointwise(RealEq(tolerance), blocking.complexGrid));
+    EXPECT_THAT(pipelined.realGrid, Pointwise(RealEq(tolerance), blocking.realGrid));
+    // Check that the transposes did not lose or misplace data
+    EXPECT_THAT(pipelined.realGrid, Pointwise(RealEq(tolerance), pipelined.input));
+
+    for (auto& c : comm)
+    {
+        if (c != MPI_COMM_NULL && c != MPI_COMM_WORLD)
+        {
+            MPI_Comm_free(&c);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Works,
+                         PipelinedFftTest,
+                         ::testing::Combine(::testing::Values(IVec{ 12, 10, 14 },
+                                                              IVec{ 9, 11, 13 }),
+                                            ::testing::Values(4, 1, 2),
+                                            ::testing::Values(2, 3),
+                                            ::testing::Values(1, 2)));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,573 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements writing and reading of atom-major trajectory files.
+ *
+ * The file starts with a header: the magic number, the format version,
+ * the number of atoms, the precision and the global atom indices. It is
+ * followed by segments, each holding a segment magic number, the number
+ * of frames, the number of atoms per block, the offset of the next
+ * segment, the steps, times and boxes of the frames, a table with the
+ * offsets of the blocks and the blocks themselves. A block holds the time
+ * series of consecutive atoms, compressed as one XTC coordinate set.
+ * All data is stored in XDR format.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "atommajortrajectory.h"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/gmxfio_xdr.h"
+#include "gromacs/fileio/xdrf.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Magic number at the start of an atom-major trajectory file
+constexpr int32_t c_fileMagic = 0x414d5452;
+//! Magic number at the start of each segment
+constexpr int32_t c_segmentMagic = 0x41534547;
+//! The version of the file format
+constexpr int32_t c_fileVersion = 1;
+//! The size in bytes of the fixed part of a segment header
+constexpr gmx_off_t c_segmentHeaderBytes = 3 * sizeof(int32_t) + sizeof(int64_t);
+//! The minimum number of positions in a block, smaller blocks compress worse
+constexpr int c_minPositionsPerBlock = 1024;
+//! The maximum number of frames in a segment
+constexpr int c_maxFramesPerSegment = 1 << 20;
+
+//! Returns the XTC compression magic number for a block of \p numPositions
+int compressionMagic(int numPositions)
+{
+    return numPositions > XTC_1995_MAX_NATOMS ? XTC_NEW_MAGIC : XTC_MAGIC;
+}
+
+//! Reads or writes \p value, throws FileIOError on failure
+void serialize(XDR* xd, int32_t* value)
+{
+    if (xdr_int32(xd, value) == 0)
+    {
+        GMX_THROW(FileIOError("Could not read or write an atom-major trajectory file"));
+    }
+}
+
+//! Reads or writes \p value, throws FileIOError on failure
+void serialize(XDR* xd, int64_t* value)
+{
+    if (xdr_int64(xd, value) == 0)
+    {
+        GMX_THROW(FileIOError("Could not read or write an atom-major trajectory file"));
+    }
+}
+
+//! Reads or writes \p value as float, throws FileIOError on failure
+void serialize(XDR* xd, real* value)
+{
+    if (xdr_real(xd, value) == 0)
+    {
+        GMX_THROW(FileIOError("Could not read or write an atom-major trajectory file"));
+    }
+}
+
+//! Seeks to \p offset, throws FileIOError on failure
+void seek(t_fileio* fio, gmx_off_t offset)
+{
+    if (gmx_fio_seek(fio, offset) != 0)
+    {
+        GMX_THROW(FileIOError("Could not seek in an atom-major trajectory file"));
+    }
+}
+
+} // namespace
+
+/********************************************************************
+ * AtomMajorTrajectoryWriter
+ */
+
+/*! \internal \brief Implementation class for AtomMajorTrajectoryWriter.
+ */
+class AtomMajorTrajectoryWriter::Impl
+{
+public:
+    Impl(const std::filesystem::path& filename,
+         ArrayRef<const int>          atomIndices,
+         real                         precision,
+         size_t                       maxSegmentBytes);
+    ~Impl();
+
+    //! Adds a frame to the segment, writes the segment when it is full
+    void writeFrame(int64_t step, real time, const matrix box, ArrayRef<const RVec> x);
+    //! Writes the collected frames as a segment
+    void writeSegment();
+
+    //! The file
+    t_fileio* fio_;
+    //! The number of stored atoms
+    int numAtoms_;
+    //! The precision of the positions
+    real precision_;
+    //! The maximum number of frames in a segment
+    int framesPerSegment_;
+    //! The steps of the frames collected in the segment
+    std::vector<int64_t> steps_;
+    //! The times of the frames collected in the segment
+    std::vector<real> times_;
+    //! The boxes of the frames collected in the segment
+    std::vector<Matrix3x3> boxes_;
+    //! The positions of the frames collected in the segment, frame by frame
+    std::vector<RVec> positions_;
+    //! The time series of the atoms of one block, used for compressing the segment
+    std::vector<RVec> blockPositions_;
+};
+
+AtomMajorTrajectoryWriter::Impl::Impl(const std::filesystem::path& filename,
+                                      ArrayRef<const int>          atomIndices,
+                                      real                         precision,
+                                      size_t                       maxSegmentBytes) :
+    fio_(gmx_fio_open(filename, "w")), numAtoms_(atomIndices.ssize()), precision_(precision)
+{
+    const size_t frameBytes = std::max<size_t>(numAtoms_, 1) * sizeof(RVec);
+    // The buffers grow with the collected frames, as short trajectories need much less
+    framesPerSegment_ = std::clamp<size_t>(maxSegmentBytes / frameBytes, 1, c_maxFramesPerSegment);
+
+    XDR*    xd      = gmx_fio_getxdr(fio_);
+    int32_t magic   = c_fileMagic;
+    int32_t version = c_fileVersion;
+    int32_t natoms  = numAtoms_;
+    serialize(xd, &magic);
+    serialize(xd, &version);
+    serialize(xd, &natoms);
+    serialize(xd, &precision_);
+    for (int32_t index : atomIndices)
+    {
+        serialize(xd, &index);
+    }
+}
+
+AtomMajorTrajectoryWriter::Impl::~Impl()
+{
+    gmx_fio_close(fio_);
+}
+
+void AtomMajorTrajectoryWriter::Impl::writeFrame(int64_t              step,
+                                                 real                 time,
+                                                 const matrix         box,
+                                                 ArrayRef<const RVec> x)
+{
+    GMX_RELEASE_ASSERT(x.ssize() == numAtoms_, "Need positions of all stored atoms");
+
+    positions_.insert(positions_.end(), x.begin(), x.end());
+    steps_.push_back(step);
+    times_.push_back(time);
+    boxes_.push_back(createMatrix3x3FromLegacyMatrix(box));
+    if (steps_.size() == static_cast<size_t>(framesPerSegment_))
+    {
+        writeSegment();
+    }
+}
+
+void AtomMajorTrajectoryWriter::Impl::writeSegment()
+{
+    const int numFrames = steps_.size();
+    if (numFrames == 0)
+    {
+        return;
+    }
+    const int minAtomsPerBlock = (c_minPositionsPerBlock + numFrames - 1) / numFrames;
+    const int atomsPerBlock    = std::clamp(minAtomsPerBlock, 1, std::max(numAtoms_, 1));
+    const int numBlocks        = (numAtoms_ + atomsPerBlock - 1) / atomsPerBlock;
+
+    XDR*            xd           = gmx_fio_getxdr(fio_);
+    const gmx_off_t segmentStart = gmx_fio_ftell(fio_);
+    int32_t         magic        = c_segmentMagic;
+    int32_t         frames       = numFrames;
+    int32_t         blockAtoms   = atomsPerBlock;
+    int64_t         nextSegment  = 0;
+    serialize(xd, &magic);
+    serialize(xd, &frames);
+    serialize(xd, &blockAtoms);
+    serialize(xd, &nextSegment);
+    for (int f = 0; f < numFrames; f++)
+    {
+        serialize(xd, &steps_[f]);
+        serialize(xd, &times_[f]);
+        for (real& element : boxes_[f].toArrayRef())
+        {
+            serialize(xd, &element);
+        }
+    }
+
+    // The block offsets are known only after compression, write them afterwards
+    const gmx_off_t      tableStart = gmx_fio_ftell(fio_);
+    std::vector<int64_t> blockOffsets(numBlocks, 0);
+    for (int64_t& offset : blockOffsets)
+    {
+        serialize(xd, &offset);
+    }
+    for (int b = 0; b < numBlocks; b++)
+    {
+        blockOffsets[b]         = gmx_fio_ftell(fio_);
+        const int firstAtom     = b * atomsPerBlock;
+        const int numBlockAtoms = std::min(atomsPerBlock, numAtoms_ - firstAtom);
+        int       size          = numBlockAtoms * numFrames;
+        real      precision     = precision_;
+        // Gather the time series of the atoms in the block
+        blockPositions_.resize(size);
+        for (int a = 0; a < numBlockAtoms; a++)
+        {
+            for (int f = 0; f < numFrames; f++)
+            {
+                blockPositions_[static_cast<size_t>(a) * numFrames + f] =
+                        positions_[static_cast<size_t>(f) * numAtoms_ + firstAtom + a];
+            }
+        }
+        real* data = blockPositions_[0].as_vec();
+        if (xdr3drcoord(xd, data, &size, &precision, compressionMagic(size)) == 0)
+        {
+            GMX_THROW(FileIOError("Could not write positions to an atom-major trajectory file"));
+        }
+    }
+    nextSegment = gmx_fio_ftell(fio_);
+
+    // Complete the segment header last, so that readers ignore partially written segments
+    seek(fio_, tableStart);
+    for (int64_t& offset : blockOffsets)
+    {
+        serialize(xd, &offset);
+    }
+    seek(fio_, segmentStart + c_segmentHeaderBytes - sizeof(int64_t));
+    serialize(xd, &nextSegment);
+    seek(fio_, nextSegment);
+    if (gmx_fio_flush(fio_) != 0)
+    {
+        GMX_THROW(FileIOError("Could not write an atom-major trajectory file"));
+    }
+
+    steps_.clear();
+    times_.clear();
+    boxes_.clear();
+    positions_.clear();
+}
+
+AtomMajorTrajectoryWriter::AtomMajorTrajectoryWriter(const std::filesystem::path& filename,
+                                                     ArrayRef<const int>          atomIndices,
+                                                     real                         precision,
+                                                     size_t                       maxSegmentBytes) :
+    impl_(new Impl(filename, atomIndices, precision, maxSegmentBytes))
+{
+}
+
+AtomMajorTrajectoryWriter::~AtomMajorTrajectoryWriter() = default;
+
+void AtomMajorTrajectoryWriter::writeFrame(int64_t              step,
+                                           real                 time,
+                                           const matrix         box,
+                                           ArrayRef<const RVec> x)
+{
+    impl_->writeFrame(step, time, box, x);
+}
+
+void AtomMajorTrajectoryWriter::finish()
+{
+    impl_->writeSegment();
+}
+
+/********************************************************************
+ * AtomMajorTrajectoryReader
+ */
+
+/*! \internal \brief Implementation class for AtomMajorTrajectoryReader.
+ */
+class AtomMajorTrajectoryReader::Impl
+{
+public:
+    explicit Impl(const std::filesystem::path& filename);
+    ~Impl();
+
+    //! Reads the time series of \p atoms
+    std::vector<RVec> readTimeSeries(ArrayRef<const int> atoms);
+
+    //! Location of the data of a segment
+    struct Segment
+    {
+        //! The index of the first frame in the segment
+        int64_t firstFrame;
+        //! The number of frames in the segment
+        int numFrames;
+        //! The number of atoms in each block
+        int atomsPerBlock;
+        //! The file offsets of the blocks
+        std::vector<int64_t> blockOffsets;
+    };
+
+    //! The name of the file, for error messages
+    std::filesystem::path filename_;
+    //! The file
+    t_fileio* fio_;
+    //! The precision of the positions
+    real precision_ = 0;
+    //! The global indices of the stored atoms
+    std::vector<int> atomIndices_;
+    //! The steps of all frames
+    std::vector<int64_t> steps_;
+    //! The times of all frames
+    std::vector<real> times_;
+    //! The boxes of all frames
+    std::vector<Matrix3x3> boxes_;
+    //! The segments
+    std::vector<Segment> segments_;
+};
+
+AtomMajorTrajectoryReader::Impl::Impl(const std::filesystem::path& filename) :
+    filename_(filename), fio_(gmx_fio_open(filename, "r"))
+{
+    const gmx_off_t fileSize = std::filesystem::file_size(filename);
+    XDR*            xd       = gmx_fio_getxdr(fio_);
+    int32_t         magic    = 0;
+    int32_t         version  = 0;
+    int32_t         numAtoms = 0;
+    if (fileSize < 3 * static_cast<gmx_off_t>(sizeof(int32_t)) || xdr_int32(xd, &magic) == 0
+        || magic != c_fileMagic)
+    {
+        gmx_fio_close(fio_);
+        GMX_THROW(FileIOError(formatString("%s is not an atom-major trajectory file",
+                                           filename.string().c_str())));
+    }
+    try
+    {
+        serialize(xd, &version);
+        if (version != c_fileVersion)
+        {
+            GMX_THROW(FileIOError(formatString("%s has unsupported format version %d",
+                                               filename.string().c_str(),
+                                               version)));
+        }
+        serialize(xd, &numAtoms);
+        serialize(xd, &precision_);
+        const gmx_off_t indicesBytes = static_cast<gmx_off_t>(numAtoms) * sizeof(int32_t);
+        if (numAtoms < 0 || gmx_fio_ftell(fio_) + indicesBytes > fileSize)
+        {
+            GMX_THROW(FileIOError(
+                    formatString("%s has an invalid header", filename.string().c_str())));
+        }
+        atomIndices_.resize(numAtoms);
+        for (int& index : atomIndices_)
+        {
+            int32_t value;
+            serialize(xd, &value);
+            index = value;
+        }
+
+        gmx_off_t segmentStart = gmx_fio_ftell(fio_);
+        while (segmentStart + c_segmentHeaderBytes <= fileSize)
+        {
+            Segment segment;
+            int32_t numFrames, atomsPerBlock;
+            int64_t nextSegment;
+            serialize(xd, &magic);
+            serialize(xd, &numFrames);
+            serialize(xd, &atomsPerBlock);
+            serialize(xd, &nextSegment);
+            if (magic != c_segmentMagic || numFrames <= 0 || atomsPerBlock <= 0)
+            {
+                GMX_THROW(FileIOError(formatString("%s has an invalid segment at offset %ld",
+                                                   filename.string().c_str(),
+                                                   static_cast<long>(segmentStart))));
+            }
+            if (nextSegment <= segmentStart || nextSegment > fileSize)
+            {
+                // The segment was not completely written
+                break;
+            }
+            segment.firstFrame    = steps_.size();
+            segment.numFrames     = numFrames;
+            segment.atomsPerBlock = atomsPerBlock;
+            for (int f = 0; f < numFrames; f++)
+            {
+                int64_t   step;
+                real      time;
+                Matrix3x3 box;
+                serialize(xd, &step);
+                serialize(xd, &time);
+                for (real& element : box.toArrayRef())
+                {
+                    serialize(xd, &element);
+                }
+                steps_.push_back(step);
+                times_.push_back(time);
+                boxes_.push_back(box);
+            }
+            segment.blockOffsets.resize((numAtoms + atomsPerBlock - 1) / atomsPerBlock);
+            for (int64_t& offset : segment.blockOffsets)
+            {
+                serialize(xd, &offset);
+            }
+            segments_.push_back(std::move(segment));
+            segmentStart = nextSegment;
+            seek(fio_, segmentStart);
+        }
+    }
+    catch (...)
+    {
+        gmx_fio_close(fio_);
+        throw;
+    }
+}
+
+AtomMajorTrajectoryReader::Impl::~Impl()
+{
+    gmx_fio_close(fio_);
+}
+
+std::vector<RVec> AtomMajorTrajectoryReader::Impl::readTimeSeries(ArrayRef<const int> atoms)
+{
+    const size_t numFrames = steps_.size();
+    for (const int atom : atoms)
+    {
+        if (atom < 0 || atom >= gmx::ssize(atomIndices_))
+        {
+            GMX_THROW(RangeError(formatString(
+                    "Atom %d is not stored in %s", atom, filename_.string().c_str())));
+        }
+    }
+    // Process the requested atoms in the order of their blocks in the file
+    std::vector<size_t> order(atoms.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [atoms](size_t a, size_t b) {
+        return atoms[a] < atoms[b];
+    });
+
+    std::vector<RVec> timeSeries(atoms.size() * numFrames);
+    std::vector<RVec> block;
+    XDR*              xd = gmx_fio_getxdr(fio_);
+    for (const Segment& segment : segments_)
+    {
+        size_t i = 0;
+        while (i < order.size())
+        {
+            const int blockIndex      = atoms[order[i]] / segment.atomsPerBlock;
+            const int firstAtom       = blockIndex * segment.atomsPerBlock;
+            const int numAtomsInBlock =
+                    std::min<int>(segment.atomsPerBlock, atomIndices_.size() - firstAtom);
+            int size = numAtomsInBlock * segment.numFrames;
+
+            // Check the size before decoding, the decoder does not check it
+            int32_t storedSize;
+            seek(fio_, segment.blockOffsets[blockIndex]);
+            serialize(xd, &storedSize);
+            seek(fio_, segment.blockOffsets[blockIndex]);
+            block.resize(size);
+            real  precision = precision_;
+            real* data      = block.data()->as_vec();
+            if (storedSize != size
+                || xdr3drcoord(xd, data, &size, &precision, compressionMagic(size)) == 0)
+            {
+                GMX_THROW(FileIOError(formatString("Could not read positions from %s",
+                                                   filename_.string().c_str())));
+            }
+            for (; i < order.size() && atoms[order[i]] / segment.atomsPerBlock == blockIndex; i++)
+            {
+                std::copy_n(block.begin() + (atoms[order[i]] - firstAtom) * segment.numFrames,
+                            segment.numFrames,
+                            timeSeries.begin() + order[i] * numFrames + segment.firstFrame);
+            }
+        }
+    }
+    return timeSeries;
+}
+
+AtomMajorTrajectoryReader::AtomMajorTrajectoryReader(const std::filesystem::path& filename) :
+    impl_(new Impl(filename))
+{
+}
+
+AtomMajorTrajectoryReader::~AtomMajorTrajectoryReader() = default;
+
+int AtomMajorTrajectoryReader::numAtoms() const
+{
+    return impl_->atomIndices_.size();
+}
+
+int64_t AtomMajorTrajectoryReader::numFrames() const
+{
+    return impl_->steps_.size();
+}
+
+real AtomMajorTrajectoryReader::precision() const
+{
+    return impl_->precision_;
+}
+
+ArrayRef<const int> AtomMajorTrajectoryReader::atomIndices() const
+{
+    return impl_->atomIndices_;
+}
+
+ArrayRef<const int64_t> AtomMajorTrajectoryReader::steps() const
+{
+    return impl_->steps_;
+}
+
+ArrayRef<const real> AtomMajorTrajectoryReader::times() const
+{
+    return impl_->times_;
+}
+
+ArrayRef<const Matrix3x3> AtomMajorTrajectoryReader::boxes() const
+{
+    return impl_->boxes_;
+}
+
+std::vector<RVec> AtomMajorTrajectoryReader::readTimeSeries(ArrayRef<const int> atoms)
+{
+    return impl_->readTimeSeries(atoms);
+}
+
+} // namespace gmx
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares writing and reading of atom-major trajectory files.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_ATOMMAJORTRAJECTORY_H
+#define GMX_FILEIO_ATOMMAJORTRAJECTORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "gromacs/math/matrix.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+template<typename>
+class ArrayRef;
+
+/*! \libinternal \brief Writes an atom-major (transposed) trajectory file.
+ *
+ * Trajectory files are frame-major: reading the positions of a few atoms
+ * over time requires decoding every frame of the whole system. An
+ * atom-major file stores the trajectory in segments of consecutive frames.
+ * Within a segment, the time series of each atom is stored contiguously,
+ * compressed like the frames of an XTC file, in blocks of a few atoms.
+ * A table of block offsets per segment lets AtomMajorTrajectoryReader read
+ * only the blocks of the atoms it needs, in a single forward pass over the
+ * file.
+ *
+ * Frames are collected in memory until a segment is full, so the segment
+ * length follows from the memory that the writer may use. This memory is
+ * only allocated as frames are added, so short trajectories use less.
+ */
+class AtomMajorTrajectoryWriter
+{
+public:
+    /*! \brief Creates \p filename to store the positions of the atoms \p atomIndices.
+     *
+     * \param[in] filename         The name of the file
+     * \param[in] atomIndices      The (global) indices of the stored atoms
+     * \param[in] precision        The precision of the positions in 1/nm, as in XTC files
+     * \param[in] maxSegmentBytes  The maximum memory to use for collecting a segment
+     * \throws FileIOError when the file can not be created
+     */
+    AtomMajorTrajectoryWriter(const std::filesystem::path& filename,
+                              ArrayRef<const int>          atomIndices,
+                              real                         precision,
+                              size_t                       maxSegmentBytes);
+    /*! \brief Closes the file.
+     *
+     * Frames written after the last call to finish() are not stored.
+     */
+    ~AtomMajorTrajectoryWriter();
+
+    AtomMajorTrajectoryWriter(const AtomMajorTrajectoryWriter&)            = delete;
+    AtomMajorTrajectoryWriter& operator=(const AtomMajorTrajectoryWriter&) = delete;
+
+    /*! \brief Adds a frame with the positions \p x of the stored atoms.
+     *
+     * \throws FileIOError when a full segment can not be written
+     */
+    void writeFrame(int64_t step, real time, const matrix box, ArrayRef<const RVec> x);
+
+    /*! \brief Writes the frames that were not yet written to the file.
+     *
+     * \throws FileIOError when the segment can not be written
+     */
+    void finish();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/*! \libinternal \brief Reads time series of atoms from an atom-major trajectory file.
+ *
+ * Opening the file reads the frame information and the block offsets of
+ * all segments, but no positions. A trailing segment that was not
+ * completely written is ignored.
+ */
+class AtomMajorTrajectoryReader
+{
+public:
+    /*! \brief Opens \p filename and reads the frame information.
+     *
+     * \throws FileIOError when the file can not be opened or is not an atom-major trajectory
+     */
+    explicit AtomMajorTrajectoryReader(const std::filesystem::path& filename);
+    ~AtomMajorTrajectoryReader();
+
+    AtomMajorTrajectoryReader(const AtomMajorTrajectoryReader&)            = delete;
+    AtomMajorTrajectoryReader& operator=(const AtomMajorTrajectoryReader&) = delete;
+
+    //! Returns the number of stored atoms
+    int numAtoms() const;
+    //! Returns the number of frames
+    int64_t numFrames() const;
+    //! Returns the precision of the positions in 1/nm
+    real precision() const;
+    //! Returns the global indices of the stored atoms
+    ArrayRef<const int> atomIndices() const;
+    //! Returns the steps of all frames
+    ArrayRef<const int64_t> steps() const;
+    //! Returns the times of all frames
+    ArrayRef<const real> times() const;
+    //! Returns the boxes of all frames
+    ArrayRef<const Matrix3x3> boxes() const;
+
+    /*! \brief Reads the time series of the stored atoms with indices \p atoms.
+     *
+     * Atoms are given by their index in atomIndices(). Only the blocks
+     * holding these atoms are read and decoded, in file order.
+     *
+     * \returns the positions, the time series of atoms[i] starts at element
+     *          i * numFrames()
+     * \throws FileIOError when the data can not be read
+     */
+    std::vector<RVec> readTimeSeries(ArrayRef<const int> atoms);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace gmx
+
+#endif
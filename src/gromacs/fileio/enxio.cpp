@@ -965,16 +965,47 @@ static void convert_full_sums(ener_old_t* ener_old, t_enxframe* fr)
     ener_old->step_prev = fr->step;
 }
 
-gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
+/* Size in bytes of one XDR item of a subblock type, or 0 for variable size */
+static int enxsubblock_item_size(XdrDataType type)
+{
+    switch (type)
+    {
+        case XdrDataType::Float: return 4;
+        case XdrDataType::Double: return 8;
+        case XdrDataType::Int: return 4;
+        case XdrDataType::Int64: return 8;
+        /* XDR stores every char in 4 bytes */
+        case XdrDataType::Char: return 4;
+        default: return 0;
+    }
+}
+
+/* Seek forward over nbytes of data that should not be decoded,
+   returns FALSE when the file ends before that */
+static gmx_bool enx_skip(ener_file_t ef, gmx_off_t nbytes)
 {
-    int      file_version = -1;
-    int      i, b;
-    gmx_bool bRead, bOK, bOK1, bSane;
-    real     tmp1, tmp2, rdum;
+    if (nbytes == 0)
+    {
+        return TRUE;
+    }
+    FILE* fp = gmx_fio_getfp(ef->fio);
+    /* Read the last byte, since seeking beyond the end of file does not fail */
+    return gmx_fseek(fp, nbytes - 1, SEEK_CUR) == 0 && std::fgetc(fp) != EOF;
+}
+
+static gmx_bool do_enx_lowlevel(ener_file_t ef, t_enxframe* fr, const gmx_bool* bTerm, gmx_bool bBlocks)
+{
+    int       file_version = -1;
+    int       i, b;
+    gmx_bool  bRead, bOK, bOK1, bSane;
+    real      tmp1, tmp2, rdum;
+    gmx_off_t nskip = 0; /* bytes of unselected data to skip before the next read */
     /*int       d_size;*/
 
     bOK   = TRUE;
     bRead = gmx_fio_getread(ef->fio);
+    GMX_RELEASE_ASSERT(bRead || (bTerm == nullptr && bBlocks),
+                       "Energy terms and blocks can only be skipped when reading");
     if (!bRead)
     {
         fr->e_size = fr->nre * sizeof(fr->ener[0].e) * 4;
@@ -1039,14 +1070,30 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         fr->e_alloc = fr->nre;
     }
 
+    /* Old files need all terms to convert the sums */
+    if (file_version == 1 || ef->eo.bOldFileOpen)
+    {
+        bTerm = nullptr;
+    }
+    const gmx_off_t realSize = (gmx_fio_is_double(ef->fio) ? sizeof(double) : sizeof(float));
     for (i = 0; i < fr->nre; i++)
     {
+        const gmx_bool bSums = (file_version == 1 || (bRead && fr->nsum > 0) || fr->nsum > 1);
+
+        if (bTerm != nullptr && !bTerm[i])
+        {
+            nskip += (bSums ? 3 : 1) * realSize;
+            continue;
+        }
+        bOK   = bOK && enx_skip(ef, nskip);
+        nskip = 0;
+
         bOK = bOK && gmx_fio_do_real(ef->fio, fr->ener[i].e);
 
         /* Do not store sums of length 1,
          * since this does not add information.
          */
-        if (file_version == 1 || (bRead && fr->nsum > 0) || fr->nsum > 1)
+        if (bSums)
         {
             tmp1 = fr->ener[i].eav;
             bOK  = bOK && gmx_fio_do_real(ef->fio, tmp1);
@@ -1091,6 +1138,14 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         {
             t_enxsubblock* sub = &(fr->block[b].sub[i]); /* shortcut */
 
+            if (!bBlocks && enxsubblock_item_size(sub->type) > 0)
+            {
+                nskip += static_cast<gmx_off_t>(sub->nr) * enxsubblock_item_size(sub->type);
+                continue;
+            }
+            bOK   = bOK && enx_skip(ef, nskip);
+            nskip = 0;
+
             if (bRead)
             {
                 enxsubblock_alloc(sub);
@@ -1123,6 +1178,12 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
             bOK = bOK && bOK1;
         }
     }
+    bOK = bOK && enx_skip(ef, nskip);
+    if (!bBlocks)
+    {
+        /* The block data has not been read */
+        fr->nblock = 0;
+    }
 
     if (!bRead)
     {
@@ -1149,6 +1210,16 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
     return TRUE;
 }
 
+gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
+{
+    return do_enx_lowlevel(ef, fr, nullptr, TRUE);
+}
+
+gmx_bool do_enx_select(ener_file_t ef, t_enxframe* fr, const gmx_bool* bTerm, gmx_bool bBlocks)
+{
+    return do_enx_lowlevel(ef, fr, bTerm, bBlocks);
+}
+
 static real find_energy(const char* name, int nre, gmx_enxnm_t* enm, t_enxframe* fr)
 {
     int i;
@@ -178,6 +178,15 @@ void free_enxnms(int n, gmx_enxnm_t* nms);
 gmx_bool do_enx(ener_file_t ef, t_enxframe* fr);
 /* Reads enx_frames, memory in fr is (re)allocated if necessary */
 
+gmx_bool do_enx_select(ener_file_t ef, t_enxframe* fr, const gmx_bool* bTerm, gmx_bool bBlocks);
+/* Reads an enx_frame like do_enx, but only decodes the energy terms i
+ * with bTerm[i] set, and the blocks only when bBlocks is set.
+ * All other data is skipped by seeking over it in the file, using the
+ * sizes given in the frame header. The values of skipped terms in fr
+ * are left unchanged and fr->nblock is set to 0 when blocks are skipped.
+ * With bTerm=NULL all terms are read.
+ */
+
 void get_enx_state(const std::filesystem::path& fn,
                    real                         t,
                    const SimulationGroups&      groups,
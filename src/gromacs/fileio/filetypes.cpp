@@ -51,6 +51,7 @@ enum
     eftXDR,
     eftTNG,
     eftGEN,
+    eftBIN,
     eftNR
 };
 
@@ -146,7 +147,10 @@ static const t_deffile deffile[efNR] = {
     { eftASC, ".xpm", "root", nullptr, "X PixMap compatible matrix file" },
     { eftASC, "", "rundir", nullptr, "Run directory" },
     { eftASC, ".csv", "bench", nullptr, "CSV data file" },
-    { eftASC, ".inp", "topol-qmmm", nullptr, "Input file for QM program" }
+    { eftASC, ".inp", "topol-qmmm", nullptr, "Input file for QM program" },
+    { eftBIN, ".mrc", "density", nullptr, "MRC/CCP4 density map file" },
+    { eftBIN, ".h5md", "traj", nullptr, "Trajectory file (H5MD format)" },
+    { eftXDR, ".amt", "traj", nullptr, "Atom-major trajectory (portable xdr format)" }
 };
 
 const char* ftp2ext(int ftp)
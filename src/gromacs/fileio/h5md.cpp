@@ -43,8 +43,15 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/stringutil.h"
 
 #if GMX_USE_HDF5
 #    include <hdf5.h>
@@ -55,6 +62,506 @@ CLANG_DIAGNOSTIC_IGNORE("-Wmissing-noreturn")
 
 namespace gmx
 {
+
+#if GMX_USE_HDF5
+namespace
+{
+
+//! Target size in bytes of a chunk of the value dataset of a time series
+constexpr size_t c_targetChunkBytes = 1 << 20;
+//! Maximum size in bytes of the frames in a row of chunks, which are cached until they are complete
+constexpr size_t c_maxChunkRowBytes = 64 << 20;
+//! Maximum number of frames in a chunk
+constexpr hsize_t c_maxFramesPerChunk = 64;
+//! Number of frames in a chunk of the step and time datasets
+constexpr hsize_t c_stepChunkSize = 512;
+//! The deflate compression level, moderate to keep the cost of writing low
+constexpr unsigned int c_deflateLevel = 4;
+
+//! Returns the HDF5 memory type of real
+hid_t realType()
+{
+    return GMX_DOUBLE ? H5T_NATIVE_DOUBLE : H5T_NATIVE_FLOAT;
+}
+
+//! Returns \p id, throws FileIOError with \p message when \p id signals an HDF5 error
+template<typename T>
+T checkH5(T id, const std::string& message)
+{
+    if (id < 0)
+    {
+        GMX_THROW(FileIOError("H5MD: " + message));
+    }
+    return id;
+}
+
+//! Closes an HDF5 object when it goes out of scope
+class ScopedH5Object
+{
+public:
+    //! Takes ownership of \p id, which is closed with \p close
+    ScopedH5Object(hid_t id, herr_t (*close)(hid_t), const std::string& message) :
+        id_(checkH5(id, message)), close_(close)
+    {
+    }
+    ~ScopedH5Object() { close_(id_); }
+
+    ScopedH5Object(const ScopedH5Object&)            = delete;
+    ScopedH5Object& operator=(const ScopedH5Object&) = delete;
+
+    //! Returns the object
+    operator hid_t() const { return id_; }
+
+private:
+    hid_t id_;
+    herr_t (*close_)(hid_t);
+};
+
+//! Opens group \p name in \p parent, creates it when it does not exist
+hid_t openOrCreateGroup(hid_t parent, const char* name, bool* created = nullptr)
+{
+    const bool exists = checkH5(H5Lexists(parent, name, H5P_DEFAULT),
+                                formatString("Cannot look up group %s", name))
+                        > 0;
+    if (created)
+    {
+        *created = !exists;
+    }
+    if (exists)
+    {
+        return checkH5(H5Gopen2(parent, name, H5P_DEFAULT),
+                       formatString("Cannot open group %s", name));
+    }
+    return checkH5(H5Gcreate2(parent, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                   formatString("Cannot create group %s", name));
+}
+
+//! Writes the fixed-length string attributes \p values, as a scalar when \p asArray is false
+void writeStringAttribute(hid_t                           object,
+                          const char*                     name,
+                          const std::vector<std::string>& values,
+                          bool                            asArray)
+{
+    const std::string message = formatString("Cannot write attribute %s", name);
+    size_t            length  = 1;
+    for (const auto& value : values)
+    {
+        length = std::max(length, value.size() + 1);
+    }
+    std::vector<char> buffer(length * values.size(), '\0');
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        std::copy(values[i].begin(), values[i].end(), buffer.begin() + i * length);
+    }
+    ScopedH5Object type(H5Tcopy(H5T_C_S1), H5Tclose, message);
+    checkH5(H5Tset_size(type, length), message);
+    checkH5(H5Tset_strpad(type, H5T_STR_NULLTERM), message);
+    const hsize_t  size = values.size();
+    ScopedH5Object space(asArray ? H5Screate_simple(1, &size, nullptr) : H5Screate(H5S_SCALAR),
+                         H5Sclose,
+                         message);
+    ScopedH5Object attribute(
+            H5Acreate2(object, name, type, space, H5P_DEFAULT, H5P_DEFAULT), H5Aclose, message);
+    checkH5(H5Awrite(attribute, type, buffer.data()), message);
+}
+
+//! Writes the int attributes \p values, as a scalar when \p asArray is false
+void writeIntAttribute(hid_t object, const char* name, const std::vector<int>& values, bool asArray)
+{
+    const std::string message = formatString("Cannot write attribute %s", name);
+    const hsize_t     size    = values.size();
+    ScopedH5Object    space(asArray ? H5Screate_simple(1, &size, nullptr) : H5Screate(H5S_SCALAR),
+                         H5Sclose,
+                         message);
+    ScopedH5Object    attribute(
+            H5Acreate2(object, name, H5T_STD_I32LE, space, H5P_DEFAULT, H5P_DEFAULT),
+            H5Aclose,
+            message);
+    checkH5(H5Awrite(attribute, H5T_NATIVE_INT, values.data()), message);
+}
+
+/*! \brief Appends a frame to \p dataset, which holds \p frameIndex frames of \p frameDims
+ *
+ * The frame is written as a hyperslab, so that datasets could be shared
+ * between writers that each own a part of a frame.
+ */
+void appendFrame(hid_t                       dataset,
+                 hsize_t                     frameIndex,
+                 const std::vector<hsize_t>& frameDims,
+                 hid_t                       memoryType,
+                 const void*                 data)
+{
+    const std::string    message = "Cannot write frame";
+    std::vector<hsize_t> dims    = { frameIndex + 1 };
+    dims.insert(dims.end(), frameDims.begin(), frameDims.end());
+    checkH5(H5Dset_extent(dataset, dims.data()), message);
+
+    std::vector<hsize_t> start(dims.size(), 0);
+    std::vector<hsize_t> count = dims;
+    start[0]                   = frameIndex;
+    count[0]                   = 1;
+    ScopedH5Object fileSpace(H5Dget_space(dataset), H5Sclose, message);
+    checkH5(H5Sselect_hyperslab(
+                    fileSpace, H5S_SELECT_SET, start.data(), nullptr, count.data(), nullptr),
+            message);
+    ScopedH5Object memorySpace(
+            H5Screate_simple(count.size(), count.data(), nullptr), H5Sclose, message);
+    checkH5(H5Dwrite(dataset, memoryType, memorySpace, fileSpace, H5P_DEFAULT, data), message);
+}
+
+} // namespace
+
+/*! \internal \brief A time-dependent H5MD element: a group with a value, step and time dataset.
+ *
+ * The first dimension of all datasets is the frame index and can grow
+ * without limit.
+ */
+class H5mdTimeSeries
+{
+public:
+    /*! \brief Opens the element \p name in \p parent, creates it when it does not exist
+     *
+     * \param[in] parent     The group that holds the element
+     * \param[in] name       The name of the element
+     * \param[in] frameDims  The dimensions of the value of one frame
+     * \param[in] unit       The unit of the value
+     * \param[in] precision  The precision for lossy compression of the value, 0 for lossless
+     */
+    H5mdTimeSeries(hid_t                       parent,
+                   const char*                 name,
+                   const std::vector<hsize_t>& frameDims,
+                   const char*                 unit,
+                   real                        precision);
+    ~H5mdTimeSeries();
+
+    H5mdTimeSeries(const H5mdTimeSeries&)            = delete;
+    H5mdTimeSeries& operator=(const H5mdTimeSeries&) = delete;
+
+    //! Appends a frame with \p values, which holds all values of the frame
+    void write(int64_t step, real time, const real* values);
+
+private:
+    //! Removes the stored frames with a step of at least \p step
+    void removeFramesFromStep(int64_t step);
+
+    //! The element group
+    hid_t group_ = H5I_INVALID_HID;
+    //! The value dataset
+    hid_t value_ = H5I_INVALID_HID;
+    //! The step dataset
+    hid_t step_ = H5I_INVALID_HID;
+    //! The time dataset
+    hid_t time_ = H5I_INVALID_HID;
+    //! The dimensions of the value of one frame
+    std::vector<hsize_t> frameDims_;
+    //! The number of stored frames
+    hsize_t numFrames_ = 0;
+    //! Whether the frames that were already stored have been checked before the first write
+    bool checkedStoredFrames_ = false;
+};
+
+H5mdTimeSeries::H5mdTimeSeries(hid_t                       parent,
+                               const char*                 name,
+                               const std::vector<hsize_t>& frameDims,
+                               const char*                 unit,
+                               real                        precision) :
+    frameDims_(frameDims)
+{
+    const std::string message = formatString("Cannot set up time series %s", name);
+    bool              created;
+    group_ = openOrCreateGroup(parent, name, &created);
+
+    /* Chunk over several frames, so that time series of single atoms can be
+     * read without touching a chunk per frame, and over a range of atoms,
+     * so that the chunks of partially written frames that the chunk cache
+     * needs to hold stay within c_maxChunkRowBytes. */
+    const hsize_t numRows        = std::max<hsize_t>(frameDims_[0], 1);
+    size_t        valuesPerFrame = 1;
+    for (const auto dim : frameDims_)
+    {
+        valuesPerFrame *= std::max<hsize_t>(dim, 1);
+    }
+    const size_t  frameBytes     = valuesPerFrame * sizeof(real);
+    const hsize_t framesPerChunk =
+            std::clamp<hsize_t>(c_maxChunkRowBytes / frameBytes, 1, c_maxFramesPerChunk);
+    const size_t         rowBytes  = framesPerChunk * frameBytes / numRows;
+    std::vector<hsize_t> chunkDims = { framesPerChunk };
+    chunkDims.insert(chunkDims.end(), frameDims_.begin(), frameDims_.end());
+    chunkDims[1] = std::clamp<hsize_t>(c_targetChunkBytes / rowBytes, 1, numRows);
+    const size_t chunkBytes       = rowBytes * chunkDims[1];
+    const size_t numChunksInFrame = (numRows + chunkDims[1] - 1) / chunkDims[1];
+
+    ScopedH5Object valueAccess(H5Pcreate(H5P_DATASET_ACCESS), H5Pclose, message);
+    // The cache holds a row of chunks until all its frames are written, the
+    // number of hash slots should be well above the number of cached chunks
+    const size_t numCacheSlots = std::max<size_t>(521, 10 * numChunksInFrame + 1);
+    const size_t cacheBytes    = (numChunksInFrame + 1) * chunkBytes;
+    checkH5(H5Pset_chunk_cache(valueAccess, numCacheSlots, cacheBytes, 1.0), message);
+
+    if (!created)
+    {
+        value_ = checkH5(H5Dopen2(group_, "value", valueAccess), message);
+        step_  = checkH5(H5Dopen2(group_, "step", H5P_DEFAULT), message);
+        time_  = checkH5(H5Dopen2(group_, "time", H5P_DEFAULT), message);
+        ScopedH5Object       space(H5Dget_space(value_), H5Sclose, message);
+        std::vector<hsize_t> dims(1 + frameDims_.size());
+        const bool           sameRank =
+                (H5Sget_simple_extent_ndims(space) == static_cast<int>(dims.size()));
+        if (sameRank)
+        {
+            checkH5(H5Sget_simple_extent_dims(space, dims.data(), nullptr), message);
+        }
+        if (!sameRank || !std::equal(frameDims_.begin(), frameDims_.end(), dims.begin() + 1))
+        {
+            GMX_THROW(FileIOError(
+                    formatString("H5MD: Time series %s in the file has a different shape", name)));
+        }
+        numFrames_ = dims[0];
+        return;
+    }
+
+    std::vector<hsize_t> dims    = { 0 };
+    std::vector<hsize_t> maxDims = { H5S_UNLIMITED };
+    dims.insert(dims.end(), frameDims_.begin(), frameDims_.end());
+    maxDims.insert(maxDims.end(), frameDims_.begin(), frameDims_.end());
+    ScopedH5Object valueSpace(
+            H5Screate_simple(dims.size(), dims.data(), maxDims.data()), H5Sclose, message);
+    ScopedH5Object valueCreation(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, message);
+    checkH5(H5Pset_chunk(valueCreation, chunkDims.size(), chunkDims.data()), message);
+    if (precision > 0 && H5Zfilter_avail(H5Z_FILTER_SCALEOFFSET) > 0)
+    {
+        // Quantize to the precision, as XTC does, and store only the bits that are needed
+        const int decimals = static_cast<int>(std::ceil(std::log10(precision) - 0.001));
+        checkH5(H5Pset_scaleoffset(valueCreation, H5Z_SO_FLOAT_DSCALE, std::max(decimals, 0)),
+                message);
+    }
+    else if (H5Zfilter_avail(H5Z_FILTER_SHUFFLE) > 0)
+    {
+        // Grouping the bytes by significance lets deflate find the repeated exponents
+        checkH5(H5Pset_shuffle(valueCreation), message);
+    }
+    if (H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0)
+    {
+        checkH5(H5Pset_deflate(valueCreation, c_deflateLevel), message);
+    }
+    value_ = checkH5(H5Dcreate2(group_,
+                                "value",
+                                realType(),
+                                valueSpace,
+                                H5P_DEFAULT,
+                                valueCreation,
+                                valueAccess),
+                     message);
+    writeStringAttribute(value_, "unit", { unit }, false);
+
+    const hsize_t  stepDims    = 0;
+    const hsize_t  stepMaxDims = H5S_UNLIMITED;
+    ScopedH5Object stepSpace(H5Screate_simple(1, &stepDims, &stepMaxDims), H5Sclose, message);
+    ScopedH5Object stepCreation(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, message);
+    checkH5(H5Pset_chunk(stepCreation, 1, &c_stepChunkSize), message);
+    if (H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0)
+    {
+        checkH5(H5Pset_deflate(stepCreation, c_deflateLevel), message);
+    }
+    step_ = checkH5(H5Dcreate2(group_,
+                               "step",
+                               H5T_STD_I64LE,
+                               stepSpace,
+                               H5P_DEFAULT,
+                               stepCreation,
+                               H5P_DEFAULT),
+                    message);
+    time_ = checkH5(H5Dcreate2(group_,
+                               "time",
+                               realType(),
+                               stepSpace,
+                               H5P_DEFAULT,
+                               stepCreation,
+                               H5P_DEFAULT),
+                    message);
+    writeStringAttribute(time_, "unit", { "ps" }, false);
+    // Nothing was stored before
+    checkedStoredFrames_ = true;
+}
+
+H5mdTimeSeries::~H5mdTimeSeries()
+{
+    for (hid_t dataset : { value_, step_, time_ })
+    {
+        if (dataset >= 0)
+        {
+            H5Dclose(dataset);
+        }
+    }
+    H5Gclose(group_);
+}
+
+void H5mdTimeSeries::removeFramesFromStep(int64_t step)
+{
+    if (numFrames_ == 0)
+    {
+        return;
+    }
+    const std::string    message = "Cannot remove frames";
+    std::vector<int64_t> steps(numFrames_);
+    checkH5(H5Dread(step_, H5T_NATIVE_INT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, steps.data()), message);
+    const auto firstRemoved =
+            std::find_if(steps.begin(), steps.end(), [step](int64_t s) { return s >= step; });
+    numFrames_ = firstRemoved - steps.begin();
+
+    std::vector<hsize_t> dims = { numFrames_ };
+    checkH5(H5Dset_extent(step_, dims.data()), message);
+    checkH5(H5Dset_extent(time_, dims.data()), message);
+    dims.insert(dims.end(), frameDims_.begin(), frameDims_.end());
+    checkH5(H5Dset_extent(value_, dims.data()), message);
+}
+
+void H5mdTimeSeries::write(int64_t step, real time, const real* values)
+{
+    if (!checkedStoredFrames_)
+    {
+        removeFramesFromStep(step);
+        checkedStoredFrames_ = true;
+    }
+    appendFrame(value_, numFrames_, frameDims_, realType(), values);
+    appendFrame(step_, numFrames_, {}, H5T_NATIVE_INT64, &step);
+    appendFrame(time_, numFrames_, {}, realType(), &time);
+    numFrames_++;
+}
+
+/*! \internal \brief An H5MD particles group with time series of the box and the atom vectors.
+ */
+class H5mdParticlesGroup
+{
+public:
+    //! Opens or creates the particles group \p name in \p file
+    H5mdParticlesGroup(hid_t              file,
+                       const std::string& name,
+                       int                numAtoms,
+                       PbcType            pbcType,
+                       real               positionPrecision);
+    ~H5mdParticlesGroup();
+
+    H5mdParticlesGroup(const H5mdParticlesGroup&)            = delete;
+    H5mdParticlesGroup& operator=(const H5mdParticlesGroup&) = delete;
+
+    //! Writes a frame, quantities that are nullptr are skipped
+    void writeFrame(int64_t     step,
+                    real        time,
+                    const rvec* box,
+                    const rvec* x,
+                    const rvec* v,
+                    const rvec* f);
+
+private:
+    //! Writes \p data to \p timeSeries, creates the time series \p name in \p parent when needed
+    void writeTimeSeries(std::unique_ptr<H5mdTimeSeries>* timeSeries,
+                         hid_t                            parent,
+                         const char*                      name,
+                         const std::vector<hsize_t>&      frameDims,
+                         const char*                      unit,
+                         real                             precision,
+                         int64_t                          step,
+                         real                             time,
+                         const rvec*                      data);
+
+    //! The particles group
+    hid_t group_ = H5I_INVALID_HID;
+    //! The box group
+    hid_t boxGroup_ = H5I_INVALID_HID;
+    //! The number of atoms
+    int numAtoms_;
+    //! The precision of lossy position compression, 0 for lossless
+    real positionPrecision_;
+    //! The time series of the box edges
+    std::unique_ptr<H5mdTimeSeries> edges_;
+    //! The time series of the positions
+    std::unique_ptr<H5mdTimeSeries> position_;
+    //! The time series of the velocities
+    std::unique_ptr<H5mdTimeSeries> velocity_;
+    //! The time series of the forces
+    std::unique_ptr<H5mdTimeSeries> force_;
+};
+
+H5mdParticlesGroup::H5mdParticlesGroup(hid_t              file,
+                                       const std::string& name,
+                                       int                numAtoms,
+                                       PbcType            pbcType,
+                                       real               positionPrecision) :
+    numAtoms_(numAtoms), positionPrecision_(positionPrecision)
+{
+    if (numAtoms <= 0)
+    {
+        GMX_THROW(FileIOError("H5MD: A particles group needs at least one atom"));
+    }
+    const hid_t particles = openOrCreateGroup(file, "particles");
+    group_                = openOrCreateGroup(particles, name.c_str());
+    H5Gclose(particles);
+
+    bool created;
+    boxGroup_ = openOrCreateGroup(group_, "box", &created);
+    if (created)
+    {
+        std::vector<std::string> boundary(DIM, "periodic");
+        switch (pbcType)
+        {
+            case PbcType::No: boundary = { "none", "none", "none" }; break;
+            case PbcType::XY: boundary[ZZ] = "none"; break;
+            default: break;
+        }
+        writeIntAttribute(boxGroup_, "dimension", { DIM }, false);
+        writeStringAttribute(boxGroup_, "boundary", boundary, true);
+    }
+}
+
+H5mdParticlesGroup::~H5mdParticlesGroup()
+{
+    edges_.reset();
+    position_.reset();
+    velocity_.reset();
+    force_.reset();
+    H5Gclose(boxGroup_);
+    H5Gclose(group_);
+}
+
+void H5mdParticlesGroup::writeTimeSeries(std::unique_ptr<H5mdTimeSeries>* timeSeries,
+                                         hid_t                            parent,
+                                         const char*                      name,
+                                         const std::vector<hsize_t>&      frameDims,
+                                         const char*                      unit,
+                                         real                             precision,
+                                         int64_t                          step,
+                                         real                             time,
+                                         const rvec*                      data)
+{
+    if (data == nullptr)
+    {
+        return;
+    }
+    if (!*timeSeries)
+    {
+        *timeSeries = std::make_unique<H5mdTimeSeries>(parent, name, frameDims, unit, precision);
+    }
+    (*timeSeries)->write(step, time, data[0]);
+}
+
+void H5mdParticlesGroup::writeFrame(int64_t     step,
+                                    real        time,
+                                    const rvec* box,
+                                    const rvec* x,
+                                    const rvec* v,
+                                    const rvec* f)
+{
+    const std::vector<hsize_t> atomDims = { static_cast<hsize_t>(numAtoms_), DIM };
+    const real                 xPrec    = positionPrecision_;
+    writeTimeSeries(&edges_, boxGroup_, "edges", { DIM, DIM }, "nm", 0, step, time, box);
+    writeTimeSeries(&position_, group_, "position", atomDims, "nm", xPrec, step, time, x);
+    writeTimeSeries(&velocity_, group_, "velocity", atomDims, "nm ps-1", 0, step, time, v);
+    writeTimeSeries(&force_, group_, "force", atomDims, "kJ mol-1 nm-1", 0, step, time, f);
+}
+
+#endif // GMX_USE_HDF5
+
 H5md::H5md(const std::filesystem::path& fileName, const H5mdFileMode mode)
 {
 #if GMX_USE_HDF5
@@ -62,16 +569,29 @@ H5md::H5md(const std::filesystem::path& fileName, const H5mdFileMode mode)
      * still print error messages. */
     H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
 
+    const ScopedH5Object createProperties(
+            H5Pcreate(H5P_FILE_CREATE), H5Pclose, "Cannot create H5MD file creation properties");
     switch (mode)
     {
         case H5mdFileMode::Write:
             file_ = H5Fcreate(
-                    fileName.string().c_str(), H5F_ACC_TRUNC, H5Pcreate(H5P_FILE_CREATE), H5P_DEFAULT);
+                    fileName.string().c_str(), H5F_ACC_TRUNC, createProperties, H5P_DEFAULT);
             break;
         case H5mdFileMode::Read:
             file_ = H5Fopen(fileName.string().c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
             break;
-        default: throw NotImplementedError("Appending to H5MD is not implemented yet.");
+        case H5mdFileMode::Append:
+            if (std::filesystem::exists(fileName))
+            {
+                file_ = H5Fopen(fileName.string().c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+            }
+            else
+            {
+                file_ = H5Fcreate(
+                        fileName.string().c_str(), H5F_ACC_TRUNC, createProperties, H5P_DEFAULT);
+            }
+            break;
+        default: throw NotImplementedError("Unknown H5MD file mode.");
     }
     if (file_ == H5I_INVALID_HID)
     {
@@ -97,6 +617,8 @@ H5md::H5md(const std::filesystem::path& fileName, const H5mdFileMode mode)
 H5md::~H5md()
 {
 #if GMX_USE_HDF5
+    // The groups need to be closed before the file can be closed
+    particlesGroups_.clear();
     if (file_ != H5I_INVALID_HID)
     {
         H5Fclose(file_);
@@ -107,6 +629,88 @@ H5md::~H5md()
 #endif
 }
 
+void H5md::setAuthorAndCreator(const std::string& author,
+                               const std::string& creatorName,
+                               const std::string& creatorVersion)
+{
+#if GMX_USE_HDF5
+    bool           created;
+    ScopedH5Object h5md(
+            openOrCreateGroup(file_, "h5md", &created), H5Gclose, "Cannot open h5md group");
+    if (!created)
+    {
+        // Keep the metadata of the first part of an appended file
+        return;
+    }
+    writeIntAttribute(h5md, "version", { 1, 1 }, true);
+    ScopedH5Object authorGroup(
+            openOrCreateGroup(h5md, "author"), H5Gclose, "Cannot create author group");
+    writeStringAttribute(authorGroup, "name", { author }, false);
+    ScopedH5Object creatorGroup(
+            openOrCreateGroup(h5md, "creator"), H5Gclose, "Cannot create creator group");
+    writeStringAttribute(creatorGroup, "name", { creatorName }, false);
+    writeStringAttribute(creatorGroup, "version", { creatorVersion }, false);
+#else
+    GMX_UNUSED_VALUE(author);
+    GMX_UNUSED_VALUE(creatorName);
+    GMX_UNUSED_VALUE(creatorVersion);
+    throw FileIOError("GROMACS was compiled without HDF5 support, cannot handle this file type");
+#endif
+}
+
+void H5md::setUpParticlesGroup(const std::string& groupName,
+                               int                numAtoms,
+                               PbcType            pbcType,
+                               real               positionPrecision)
+{
+#if GMX_USE_HDF5
+    particlesGroups_[groupName] = std::make_unique<H5mdParticlesGroup>(
+            file_, groupName, numAtoms, pbcType, positionPrecision);
+#else
+    GMX_UNUSED_VALUE(groupName);
+    GMX_UNUSED_VALUE(numAtoms);
+    GMX_UNUSED_VALUE(pbcType);
+    GMX_UNUSED_VALUE(positionPrecision);
+    throw FileIOError("GROMACS was compiled without HDF5 support, cannot handle this file type");
+#endif
+}
+
+void H5md::writeParticlesFrame(const std::string& groupName,
+                               int64_t            step,
+                               real               time,
+                               const rvec*        box,
+                               const rvec*        x,
+                               const rvec*        v,
+                               const rvec*        f)
+{
+#if GMX_USE_HDF5
+    auto group = particlesGroups_.find(groupName);
+    if (group == particlesGroups_.end())
+    {
+        GMX_THROW(InternalError("H5MD particles group " + groupName + " was not set up"));
+    }
+    group->second->writeFrame(step, time, box, x, v, f);
+#else
+    GMX_UNUSED_VALUE(groupName);
+    GMX_UNUSED_VALUE(step);
+    GMX_UNUSED_VALUE(time);
+    GMX_UNUSED_VALUE(box);
+    GMX_UNUSED_VALUE(x);
+    GMX_UNUSED_VALUE(v);
+    GMX_UNUSED_VALUE(f);
+    throw FileIOError("GROMACS was compiled without HDF5 support, cannot handle this file type");
+#endif
+}
+
+void H5md::flush()
+{
+#if GMX_USE_HDF5
+    checkH5(H5Fflush(file_, H5F_SCOPE_LOCAL), "Cannot flush file");
+#else
+    throw FileIOError("GROMACS was compiled without HDF5 support, cannot handle this file type");
+#endif
+}
+
 } // namespace gmx
 
 CLANG_DIAGNOSTIC_RESET
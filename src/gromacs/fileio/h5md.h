@@ -42,7 +42,15 @@
 
 #include "config.h" // To define GMX_USE_HDF5
 
+#include <cstdint>
+
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
 
 enum class PbcType : int;
 
@@ -51,6 +59,8 @@ namespace gmx
 
 typedef int64_t hid_t;
 
+class H5mdParticlesGroup;
+
 enum class H5mdFileMode : char
 {
     Read  = 'r', //! Only read from the file.
@@ -68,6 +78,8 @@ class H5md
 private:
     hid_t file_;            //!< The HDF5 identifier of the file. This is the H5MD root.
     H5mdFileMode filemode_; //!< Whether the file is open for reading ('r'), writing ('w') or appending ('a')
+    //! The particles groups that frames can be written to, by name
+    std::map<std::string, std::unique_ptr<H5mdParticlesGroup>> particlesGroups_;
 #endif
 
 public:
@@ -85,6 +97,63 @@ public:
     H5md& operator=(const H5md&) = delete;
     H5md(H5md&&)                 = delete;
     H5md& operator=(H5md&&) = delete;
+
+    /*! \brief Write the H5MD metadata: the version of the format, the author and the creator.
+     *
+     * \param[in] author          Name of the author of the file.
+     * \param[in] creatorName     Name of the program that creates the file.
+     * \param[in] creatorVersion  Version of the program that creates the file.
+     * \throws FileIOError if the metadata cannot be written.
+     */
+    void setAuthorAndCreator(const std::string& author,
+                             const std::string& creatorName,
+                             const std::string& creatorVersion);
+
+    /*! \brief Prepare writing trajectory frames to the particles group \p groupName.
+     *
+     * The positions, velocities and forces are stored as time series in
+     * /particles/groupName/{position,velocity,force} and the box in
+     * /particles/groupName/box/edges, each with a value, step and time
+     * dataset. The time series are created when they are first written. The
+     * value datasets are chunked over several frames and a range of atoms,
+     * so that both frames and time series of single atoms can be read
+     * efficiently. All datasets are compressed losslessly with shuffle and
+     * deflate. With a positive \p positionPrecision, the positions are
+     * instead quantized to that precision with the scale-offset filter, as
+     * in XTC files, before deflate.
+     *
+     * When the file was opened for appending and already contains the
+     * group, writing continues after the stored frames. Stored frames with
+     * steps at or after the first written step are removed, as they belong
+     * to the part of a simulation that was not checkpointed.
+     *
+     * \param[in] groupName          Name of the particles group.
+     * \param[in] numAtoms           The number of atoms in each frame.
+     * \param[in] pbcType            The type of periodic boundary conditions.
+     * \param[in] positionPrecision  Precision of the positions in 1/nm, 0 for lossless storage.
+     * \throws FileIOError if the group cannot be created.
+     */
+    void setUpParticlesGroup(const std::string& groupName,
+                             int                numAtoms,
+                             PbcType            pbcType,
+                             real               positionPrecision);
+
+    /*! \brief Write a frame to the particles group \p groupName.
+     *
+     * Quantities that are nullptr are not written in this frame.
+     *
+     * \throws FileIOError if the frame cannot be written.
+     */
+    void writeParticlesFrame(const std::string& groupName,
+                             int64_t            step,
+                             real               time,
+                             const rvec*        box,
+                             const rvec*        x,
+                             const rvec*        v,
+                             const rvec*        f);
+
+    //! Write all buffered data to disk
+    void flush();
 };
 
 } // namespace gmx
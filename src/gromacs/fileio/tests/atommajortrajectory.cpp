@@ -0,0 +1,206 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for writing and reading atom-major trajectory files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/atommajortrajectory.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include <filesystem>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The precision of the written positions
+constexpr real c_precision = 1000;
+
+//! Returns the test position of atom \p a in frame \p f
+RVec testPosition(int f, int a)
+{
+    return { 0.5_real * a + 0.01_real * f, std::sin(0.1_real * f + a), -0.002_real * f * a };
+}
+
+class AtomMajorTrajectoryTest : public ::testing::Test
+{
+public:
+    /*! \brief Writes \p numFrames frames of \p numAtoms atoms
+     *
+     * \p maxSegmentBytes sets the segment length, \p finish whether the last segment is written.
+     */
+    void writeFile(int numAtoms, int numFrames, size_t maxSegmentBytes, bool finish = true)
+    {
+        std::vector<int> atomIndices(numAtoms);
+        for (int a = 0; a < numAtoms; a++)
+        {
+            atomIndices[a] = 2 * a;
+        }
+        AtomMajorTrajectoryWriter writer(filename_, atomIndices, c_precision, maxSegmentBytes);
+        std::vector<RVec>         x(numAtoms);
+        for (int f = 0; f < numFrames; f++)
+        {
+            for (int a = 0; a < numAtoms; a++)
+            {
+                x[a] = testPosition(f, a);
+            }
+            const matrix box = { { 1, 0, 0 }, { 0, 2, 0 }, { 0, 0, 3.0_real + f } };
+            writer.writeFrame(10 * f, 0.5_real * f, box, x);
+        }
+        if (finish)
+        {
+            writer.finish();
+        }
+    }
+
+    //! Checks that reading \p atoms returns their time series over \p numFrames frames
+    static void checkTimeSeries(AtomMajorTrajectoryReader* reader,
+                                ArrayRef<const int>        atoms,
+                                int                        numFrames)
+    {
+        const std::vector<RVec> timeSeries = reader->readTimeSeries(atoms);
+        ASSERT_EQ(atoms.size() * numFrames, timeSeries.size());
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            for (int f = 0; f < numFrames; f++)
+            {
+                const RVec ref = testPosition(f, atoms[i]);
+                const RVec x   = timeSeries[i * numFrames + f];
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_NEAR(ref[d], x[d], 0.5001 / c_precision)
+                            << "atom " << atoms[i] << " frame " << f << " dim " << d;
+                }
+            }
+        }
+    }
+
+    TestFileManager       fileManager_;
+    std::filesystem::path filename_ = fileManager_.getTemporaryFilePath("traj.amt");
+};
+
+TEST_F(AtomMajorTrajectoryTest, ReadsFrameInformation)
+{
+    writeFile(7, 5, 1 << 20);
+    AtomMajorTrajectoryReader reader(filename_);
+    EXPECT_EQ(7, reader.numAtoms());
+    EXPECT_EQ(5, reader.numFrames());
+    EXPECT_EQ(c_precision, reader.precision());
+    EXPECT_EQ(12, reader.atomIndices()[6]);
+    EXPECT_EQ(40, reader.steps()[4]);
+    EXPECT_EQ(2.0_real, reader.times()[4]);
+    EXPECT_EQ(7.0_real, reader.boxes()[4](ZZ, ZZ));
+    EXPECT_EQ(2.0_real, reader.boxes()[4](YY, YY));
+}
+
+TEST_F(AtomMajorTrajectoryTest, ReadsAtomSubset)
+{
+    writeFile(50, 40, 1 << 20);
+    AtomMajorTrajectoryReader reader(filename_);
+    const std::vector<int>    atoms = { 37, 2, 2, 49, 0 };
+    checkTimeSeries(&reader, atoms, 40);
+}
+
+TEST_F(AtomMajorTrajectoryTest, ReadsAcrossSegmentsAndBlocks)
+{
+    // Segments of 3 frames, the last one partial, and many atoms per block
+    writeFile(500, 11, 3 * 500 * sizeof(RVec));
+    AtomMajorTrajectoryReader reader(filename_);
+    EXPECT_EQ(11, reader.numFrames());
+    std::vector<int> atoms;
+    for (int a = 0; a < 500; a += 7)
+    {
+        atoms.push_back(a);
+    }
+    atoms.push_back(499);
+    checkTimeSeries(&reader, atoms, 11);
+}
+
+TEST_F(AtomMajorTrajectoryTest, IgnoresFramesThatWereNotFinished)
+{
+    writeFile(4, 10, 4 * 4 * sizeof(RVec), false);
+    AtomMajorTrajectoryReader reader(filename_);
+    EXPECT_EQ(8, reader.numFrames());
+    const std::vector<int> atoms = { 3 };
+    checkTimeSeries(&reader, atoms, 8);
+}
+
+TEST_F(AtomMajorTrajectoryTest, IgnoresIncompleteSegment)
+{
+    writeFile(20, 10, 5 * 20 * sizeof(RVec));
+    const auto size = std::filesystem::file_size(filename_);
+    std::filesystem::resize_file(filename_, size - 10);
+    AtomMajorTrajectoryReader reader(filename_);
+    EXPECT_EQ(5, reader.numFrames());
+}
+
+TEST_F(AtomMajorTrajectoryTest, ThrowsOnOtherFile)
+{
+    FILE* fp = std::fopen(filename_.string().c_str(), "w");
+    std::fputs("not an atom-major trajectory", fp);
+    std::fclose(fp);
+    EXPECT_THROW_GMX(AtomMajorTrajectoryReader reader(filename_), FileIOError);
+}
+
+TEST_F(AtomMajorTrajectoryTest, ThrowsOnAtomOutOfRange)
+{
+    writeFile(3, 2, 1 << 20);
+    AtomMajorTrajectoryReader reader(filename_);
+    const std::vector<int>    atoms = { 3 };
+    EXPECT_THROW_GMX(reader.readTimeSeries(atoms), RangeError);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,228 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for reading selected terms from energy files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/enxio.h"
+
+#include <cstdint>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/trajectory/energyframe.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of energy terms in the test file
+constexpr int c_numTerms = 4;
+//! The number of frames in the test file
+constexpr int c_numFrames = 5;
+
+//! Returns the test value of energy term \p i in frame \p f, \p kind selects e, eav or esum
+real termValue(int f, int i, int kind)
+{
+    return 100 * f + 10 * i + kind;
+}
+
+class EnxioTest : public ::testing::Test
+{
+public:
+    //! Writes an energy file with sums in all but the first frame and a block with mixed types
+    void writeFile() const
+    {
+        ener_file_t ef = open_enx(filename_, "w");
+
+        std::vector<std::string> names;
+        gmx_enxnm_t*             nms;
+        snew(nms, c_numTerms);
+        for (int i = 0; i < c_numTerms; i++)
+        {
+            names.push_back("Term" + std::to_string(i));
+            nms[i].name = const_cast<char*>(names.back().c_str());
+            nms[i].unit = const_cast<char*>("kJ/mol");
+        }
+        int nre = c_numTerms;
+        do_enxnms(ef, &nre, &nms);
+        sfree(nms);
+
+        t_enxframe fr;
+        init_enxframe(&fr);
+        std::vector<t_energy> ener(c_numTerms);
+        fr.nre  = c_numTerms;
+        fr.ener = ener.data();
+        add_blocks_enxframe(&fr, 1);
+        fr.block[0].id = enxDH;
+        add_subblocks_enxblock(&fr.block[0], 3);
+
+        std::vector<float>         fval(3);
+        std::vector<int64_t>       lval(2);
+        std::vector<unsigned char> cval(5);
+        for (int f = 0; f < c_numFrames; f++)
+        {
+            fr.t      = f;
+            fr.step   = f;
+            fr.nsteps = 1;
+            fr.nsum   = (f == 0 ? 1 : 2);
+            for (int i = 0; i < c_numTerms; i++)
+            {
+                ener[i].e    = termValue(f, i, 0);
+                ener[i].eav  = termValue(f, i, 1);
+                ener[i].esum = termValue(f, i, 2);
+            }
+            for (auto& v : fval)
+            {
+                v = f;
+            }
+            for (auto& v : lval)
+            {
+                v = f;
+            }
+            for (auto& v : cval)
+            {
+                v = f;
+            }
+            fr.block[0].sub[0].type = XdrDataType::Float;
+            fr.block[0].sub[0].nr   = fval.size();
+            fr.block[0].sub[0].fval = fval.data();
+            fr.block[0].sub[1].type = XdrDataType::Int64;
+            fr.block[0].sub[1].nr   = lval.size();
+            fr.block[0].sub[1].lval = lval.data();
+            fr.block[0].sub[2].type = XdrDataType::Char;
+            fr.block[0].sub[2].nr   = cval.size();
+            fr.block[0].sub[2].cval = cval.data();
+            do_enx(ef, &fr);
+        }
+        for (int s = 0; s < 3; s++)
+        {
+            fr.block[0].sub[s].fval = nullptr;
+            fr.block[0].sub[s].lval = nullptr;
+            fr.block[0].sub[s].cval = nullptr;
+        }
+        fr.ener = nullptr;
+        free_enxframe(&fr);
+        done_ener_file(ef);
+    }
+
+    //! Reads all frames with the given selection and checks the selected values
+    void readAndCheck(const gmx_bool* bTerm, gmx_bool bBlocks) const
+    {
+        ener_file_t  ef = open_enx(filename_, "r");
+        int          nre;
+        gmx_enxnm_t* nms = nullptr;
+        do_enxnms(ef, &nre, &nms);
+        ASSERT_EQ(c_numTerms, nre);
+        free_enxnms(nre, nms);
+
+        t_enxframe fr;
+        init_enxframe(&fr);
+        int f = 0;
+        while (do_enx_select(ef, &fr, bTerm, bBlocks))
+        {
+            EXPECT_EQ(f, fr.step);
+            for (int i = 0; i < c_numTerms; i++)
+            {
+                if (bTerm[i])
+                {
+                    EXPECT_EQ(termValue(f, i, 0), fr.ener[i].e);
+                    if (f > 0)
+                    {
+                        EXPECT_EQ(termValue(f, i, 1), fr.ener[i].eav);
+                        EXPECT_EQ(termValue(f, i, 2), fr.ener[i].esum);
+                    }
+                }
+            }
+            if (bBlocks)
+            {
+                ASSERT_EQ(1, fr.nblock);
+                EXPECT_EQ(f, fr.block[0].sub[0].fval[2]);
+                EXPECT_EQ(f, fr.block[0].sub[1].lval[1]);
+                EXPECT_EQ(f, fr.block[0].sub[2].cval[4]);
+            }
+            else
+            {
+                EXPECT_EQ(0, fr.nblock);
+            }
+            f++;
+        }
+        EXPECT_EQ(c_numFrames, f);
+        free_enxframe(&fr);
+        done_ener_file(ef);
+    }
+
+    TestFileManager       fileManager_;
+    std::filesystem::path filename_ = fileManager_.getTemporaryFilePath("ener.edr");
+};
+
+TEST_F(EnxioTest, ReadsAllTermsAndBlocks)
+{
+    writeFile();
+    const gmx_bool bTerm[c_numTerms] = { TRUE, TRUE, TRUE, TRUE };
+    readAndCheck(bTerm, TRUE);
+}
+
+TEST_F(EnxioTest, SkipsUnselectedTerms)
+{
+    writeFile();
+    const gmx_bool bTerm[c_numTerms] = { FALSE, TRUE, FALSE, TRUE };
+    readAndCheck(bTerm, TRUE);
+}
+
+TEST_F(EnxioTest, SkipsTermsAndBlocks)
+{
+    writeFile();
+    const gmx_bool bTerm[c_numTerms] = { FALSE, FALSE, TRUE, FALSE };
+    readAndCheck(bTerm, FALSE);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
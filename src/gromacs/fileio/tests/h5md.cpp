@@ -43,9 +43,19 @@
 #include "config.h"
 
 #if GMX_USE_HDF5
+#    include <cstdint>
+
+#    include <algorithm>
+#    include <string>
+#    include <type_traits>
+#    include <vector>
+
 #    include <gtest/gtest.h>
+#    include <hdf5.h>
 
 #    include "gromacs/fileio/h5md.h"
+#    include "gromacs/math/vectypes.h"
+#    include "gromacs/mdtypes/md_enums.h"
 #    include "gromacs/utility/exceptions.h"
 #    include "gromacs/utility/smalloc.h"
 
@@ -77,6 +87,191 @@ TEST(H5mdIoTest, CanCreateAndCloseH5mdFile)
     }
 }
 
+//! The number of atoms in the written frames
+constexpr int c_numAtoms = 5;
+
+//! Returns the test value of component \p d of atom \p a in frame \p f of quantity \p q
+real testValue(int f, int a, int d, int q)
+{
+    return 1.2345678_real * f + 0.1_real * a + 0.01_real * d - q;
+}
+
+//! Returns the test vectors of quantity \p q in frame \p f
+std::vector<RVec> testVectors(int f, int q)
+{
+    std::vector<RVec> vectors(c_numAtoms);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            vectors[a][d] = testValue(f, a, d, q);
+        }
+    }
+    return vectors;
+}
+
+//! Reads the whole dataset \p path in the particles group "system" of \p filename
+template<typename T>
+std::vector<T> readDataset(const std::filesystem::path& filename, const std::string& path)
+{
+    const hid_t realType   = GMX_DOUBLE ? H5T_NATIVE_DOUBLE : H5T_NATIVE_FLOAT;
+    const hid_t memoryType = std::is_same_v<T, int64_t> ? H5T_NATIVE_INT64 : realType;
+    hid_t       file       = H5Fopen(filename.string().c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t       dataset    = H5Dopen2(file, ("/particles/system/" + path).c_str(), H5P_DEFAULT);
+    hid_t       space      = H5Dget_space(dataset);
+    hssize_t    size       = H5Sget_simple_extent_npoints(space);
+    EXPECT_GE(size, 0) << path;
+    std::vector<T> values(std::max<hssize_t>(size, 0) * H5Tget_size(memoryType) / sizeof(T));
+    if (!values.empty())
+    {
+        EXPECT_GE(H5Dread(dataset, memoryType, H5S_ALL, H5S_ALL, H5P_DEFAULT, values.data()), 0);
+    }
+    H5Sclose(space);
+    H5Dclose(dataset);
+    H5Fclose(file);
+    return values;
+}
+
+//! Returns whether the object \p path exists in \p filename
+bool objectExists(const std::filesystem::path& filename, const char* path)
+{
+    hid_t file   = H5Fopen(filename.string().c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    bool  exists = H5Lexists(file, path, H5P_DEFAULT) > 0;
+    H5Fclose(file);
+    return exists;
+}
+
+//! Writes the frames \p firstFrame to \p lastFrame with step 10 * frame to group "system"
+void writeFrames(H5md* file, int firstFrame, int lastFrame, bool writeVelocities)
+{
+    for (int f = firstFrame; f <= lastFrame; f++)
+    {
+        const matrix            box = { { 1, 0, 0 }, { 0, 2, 0 }, { 0, 0, 3.0_real + f } };
+        const std::vector<RVec> x   = testVectors(f, 0);
+        const std::vector<RVec> v   = testVectors(f, 1);
+        file->writeParticlesFrame("system",
+                                  10 * f,
+                                  0.5_real * f,
+                                  box,
+                                  as_rvec_array(x.data()),
+                                  writeVelocities ? as_rvec_array(v.data()) : nullptr,
+                                  nullptr);
+    }
+}
+
+TEST(H5mdIoTest, WritesParticlesFrames)
+{
+    TestFileManager       fileManager;
+    std::filesystem::path filename = fileManager.getTemporaryFilePath("frames.h5md");
+    {
+        H5md file(filename, H5mdFileMode::Write);
+        file.setAuthorAndCreator("author", "creator", "1.0");
+        file.setUpParticlesGroup("system", c_numAtoms, PbcType::XY, 0);
+        writeFrames(&file, 0, 2, true);
+    }
+
+    const auto steps = readDataset<int64_t>(filename, "position/step");
+    EXPECT_EQ(steps, (std::vector<int64_t>{ 0, 10, 20 }));
+    const auto times = readDataset<real>(filename, "velocity/time");
+    ASSERT_EQ(3, times.size());
+    EXPECT_EQ(1.0_real, times[2]);
+
+    const auto x = readDataset<RVec>(filename, "position/value");
+    const auto v = readDataset<RVec>(filename, "velocity/value");
+    ASSERT_EQ(3 * c_numAtoms * DIM, x.size() * DIM);
+    ASSERT_EQ(x.size(), v.size());
+    for (int f = 0; f < 3; f++)
+    {
+        const std::vector<RVec> refX = testVectors(f, 0);
+        const std::vector<RVec> refV = testVectors(f, 1);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(refX[a][d], x[f * c_numAtoms + a][d]);
+                EXPECT_EQ(refV[a][d], v[f * c_numAtoms + a][d]);
+            }
+        }
+    }
+    const auto box = readDataset<real>(filename, "box/edges/value");
+    ASSERT_EQ(3 * DIM * DIM, box.size());
+    EXPECT_EQ(5.0_real, box[2 * DIM * DIM + DIM * DIM - 1]);
+
+    EXPECT_TRUE(objectExists(filename, "/h5md/creator"));
+    EXPECT_FALSE(objectExists(filename, "/particles/system/force"));
+}
+
+TEST(H5mdIoTest, QuantizesPositionsToPrecision)
+{
+    TestFileManager       fileManager;
+    std::filesystem::path filename = fileManager.getTemporaryFilePath("compressed.h5md");
+    {
+        H5md file(filename, H5mdFileMode::Write);
+        file.setUpParticlesGroup("system", c_numAtoms, PbcType::Xyz, 1000);
+        writeFrames(&file, 0, 3, false);
+    }
+
+    const auto x = readDataset<RVec>(filename, "position/value");
+    ASSERT_EQ(4 * c_numAtoms, x.size());
+    for (int f = 0; f < 4; f++)
+    {
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(testValue(f, a, d, 0), x[f * c_numAtoms + a][d], 0.51e-3);
+            }
+        }
+    }
+    EXPECT_FALSE(objectExists(filename, "/particles/system/velocity"));
+}
+
+TEST(H5mdIoTest, AppendingReplacesFramesFromFirstNewStep)
+{
+    TestFileManager       fileManager;
+    std::filesystem::path filename = fileManager.getTemporaryFilePath("append.h5md");
+    {
+        H5md file(filename, H5mdFileMode::Write);
+        file.setUpParticlesGroup("system", c_numAtoms, PbcType::Xyz, 0);
+        writeFrames(&file, 0, 3, false);
+    }
+    {
+        H5md file(filename, H5mdFileMode::Append);
+        file.setUpParticlesGroup("system", c_numAtoms, PbcType::Xyz, 0);
+        // Continue from frame 1, as from a checkpoint written at step 10
+        writeFrames(&file, 1, 2, false);
+    }
+
+    const auto steps = readDataset<int64_t>(filename, "position/step");
+    EXPECT_EQ(steps, (std::vector<int64_t>{ 0, 10, 20 }));
+    const auto x = readDataset<RVec>(filename, "position/value");
+    ASSERT_EQ(3 * c_numAtoms, x.size());
+    EXPECT_EQ(testVectors(2, 0)[c_numAtoms - 1][ZZ], x[3 * c_numAtoms - 1][ZZ]);
+    const auto box = readDataset<real>(filename, "box/edges/value");
+    EXPECT_EQ(3 * DIM * DIM, box.size());
+}
+
+TEST(H5mdIoTest, AppendingToMissingFileCreatesIt)
+{
+    TestFileManager       fileManager;
+    std::filesystem::path filename = fileManager.getTemporaryFilePath("new.h5md");
+    {
+        H5md file(filename, H5mdFileMode::Append);
+        file.setUpParticlesGroup("system", c_numAtoms, PbcType::Xyz, 0);
+        writeFrames(&file, 0, 0, false);
+    }
+    EXPECT_EQ(1, readDataset<int64_t>(filename, "position/step").size());
+}
+
+TEST(H5mdIoTest, ThrowsOnUnknownParticlesGroup)
+{
+    TestFileManager       fileManager;
+    std::filesystem::path filename = fileManager.getTemporaryFilePath("unknown.h5md");
+    H5md                  file(filename, H5mdFileMode::Write);
+    EXPECT_THROW_GMX(file.writeParticlesFrame("system", 0, 0, nullptr, nullptr, nullptr, nullptr),
+                     InternalError);
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
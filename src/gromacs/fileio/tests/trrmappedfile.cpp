@@ -0,0 +1,276 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for memory-mapped reading of trr files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trrmappedfile.h"
+
+#include <cstdint>
+
+#include <filesystem>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the test file
+constexpr int c_numAtoms = 5;
+//! The number of frames in the test file
+constexpr int c_numFrames = 4;
+
+//! Returns the test value of component \p d of vector \p a of quantity \p kind in frame \p f
+real vectorValue(int f, int a, int d, int kind)
+{
+    return 1000 * f + 100 * kind + 10 * a + d + 0.5;
+}
+
+//! Returns the test vectors of quantity \p kind in frame \p f
+std::vector<RVec> testVectors(int f, int kind)
+{
+    std::vector<RVec> vectors(c_numAtoms);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            vectors[a][d] = vectorValue(f, a, d, kind);
+        }
+    }
+    return vectors;
+}
+
+class TrrMappedFileTest : public ::testing::Test
+{
+public:
+    //! Writes frames \p begin to \p end, odd frames have no velocities
+    void writeFrames(int begin, int end, const char* mode) const
+    {
+        t_fileio* fio = gmx_trr_open(filename_, mode);
+        for (int f = begin; f < end; f++)
+        {
+            matrix     box = { { f + 1.0_real, 0, 0 }, { 0, 2, 0 }, { 0, 0, 3 } };
+            const auto x   = testVectors(f, 0);
+            const auto v   = testVectors(f, 1);
+            const auto fv  = testVectors(f, 2);
+            gmx_trr_write_frame(fio,
+                                10 * f,
+                                0.5 * f,
+                                0.1 * f,
+                                box,
+                                c_numAtoms,
+                                as_rvec_array(x.data()),
+                                f % 2 == 0 ? as_rvec_array(v.data()) : nullptr,
+                                as_rvec_array(fv.data()));
+        }
+        gmx_trr_close(fio);
+    }
+
+    //! Checks the header and data of \p frame against frame \p f as written
+    static void checkFrame(const TrrFrameView& frame, int f)
+    {
+        const gmx_trr_header_t& header = frame.header;
+        EXPECT_EQ(c_numAtoms, header.natoms);
+        EXPECT_EQ(10 * f, header.step);
+        EXPECT_REAL_EQ(0.5 * f, header.t);
+        EXPECT_REAL_EQ(0.1 * f, header.lambda);
+
+        ASSERT_NE(nullptr, frame.box);
+        std::vector<RVec> box(DIM);
+        convertTrrVectors(frame.box, header.bDouble, box);
+        EXPECT_EQ(f + 1.0_real, box[XX][XX]);
+        EXPECT_EQ(3.0_real, box[ZZ][ZZ]);
+
+        std::vector<RVec> vectors(c_numAtoms);
+        ASSERT_NE(nullptr, frame.x);
+        convertTrrVectors(frame.x, header.bDouble, vectors);
+        checkVectors(vectors, f, 0);
+        if (f % 2 == 0)
+        {
+            ASSERT_NE(nullptr, frame.v);
+            convertTrrVectors(frame.v, header.bDouble, vectors);
+            checkVectors(vectors, f, 1);
+        }
+        else
+        {
+            EXPECT_EQ(nullptr, frame.v);
+        }
+        ASSERT_NE(nullptr, frame.f);
+        convertTrrVectors(frame.f, header.bDouble, vectors);
+        checkVectors(vectors, f, 2);
+    }
+
+    //! Checks that \p vectors match quantity \p kind of frame \p f
+    static void checkVectors(ArrayRef<const RVec> vectors, int f, int kind)
+    {
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(vectorValue(f, a, d, kind), vectors[a][d]);
+            }
+        }
+    }
+
+    TestFileManager       fileManager_;
+    std::filesystem::path filename_ = fileManager_.getTemporaryFilePath("traj.trr");
+};
+
+TEST_F(TrrMappedFileTest, ReadsAllFrames)
+{
+    writeFrames(0, c_numFrames, "w");
+    TrrMappedFile file(filename_);
+    EXPECT_EQ(c_numFrames, file.numFrames());
+    for (int f = 0; f < c_numFrames; f++)
+    {
+        SCOPED_TRACE(f);
+        checkFrame(file.frame(f), f);
+    }
+    EXPECT_FALSE(file.hasFrame(c_numFrames));
+    EXPECT_EQ(TrrMappedFile::EndStatus::None, file.endStatus());
+}
+
+TEST_F(TrrMappedFileTest, ReadsFramesInAnyOrder)
+{
+    writeFrames(0, c_numFrames, "w");
+    TrrMappedFile file(filename_);
+    ASSERT_TRUE(file.hasFrame(2));
+    checkFrame(file.frame(2), 2);
+    checkFrame(file.frame(0), 0);
+    ASSERT_TRUE(file.hasFrame(3));
+    checkFrame(file.frame(3), 3);
+    checkFrame(file.frame(1), 1);
+}
+
+TEST_F(TrrMappedFileTest, ReadsFramesAppendedAfterOpening)
+{
+    writeFrames(0, 2, "w");
+    TrrMappedFile file(filename_);
+    EXPECT_TRUE(file.hasFrame(1));
+    EXPECT_FALSE(file.hasFrame(2));
+    writeFrames(2, c_numFrames, "a");
+    ASSERT_TRUE(file.hasFrame(c_numFrames - 1));
+    for (int f = 0; f < c_numFrames; f++)
+    {
+        SCOPED_TRACE(f);
+        checkFrame(file.frame(f), f);
+    }
+}
+
+// When the file can not be mapped again, reading continues with the XDR reader from this offset
+TEST_F(TrrMappedFileTest, XdrReaderContinuesFromNextFrameOffset)
+{
+    writeFrames(0, c_numFrames, "w");
+    TrrMappedFile file(filename_);
+    ASSERT_TRUE(file.hasFrame(1));
+    t_fileio* fio = gmx_trr_open(filename_, "r");
+    ASSERT_EQ(0, gmx_fio_seek(fio, file.nextFrameOffset()));
+    gmx_trr_header_t header;
+    gmx_bool         bOK;
+    ASSERT_TRUE(gmx_trr_read_frame_header(fio, &header, &bOK));
+    EXPECT_TRUE(bOK);
+    EXPECT_EQ(20, header.step);
+    gmx_trr_close(fio);
+
+    EXPECT_EQ(c_numFrames, file.numFrames());
+    EXPECT_EQ(static_cast<int64_t>(std::filesystem::file_size(filename_)), file.nextFrameOffset());
+}
+
+TEST_F(TrrMappedFileTest, DetectsIncompleteData)
+{
+    writeFrames(0, c_numFrames, "w");
+    std::filesystem::resize_file(filename_, std::filesystem::file_size(filename_) - 4);
+    TrrMappedFile file(filename_);
+    EXPECT_EQ(c_numFrames - 1, file.numFrames());
+    EXPECT_EQ(TrrMappedFile::EndStatus::IncompleteData, file.endStatus());
+    EXPECT_REAL_EQ(0.5 * (c_numFrames - 1), file.incompleteFrameHeader().t);
+}
+
+TEST_F(TrrMappedFileTest, DetectsIncompleteHeader)
+{
+    writeFrames(0, 1, "w");
+    const auto frameSize = std::filesystem::file_size(filename_);
+    writeFrames(1, 2, "a");
+    std::filesystem::resize_file(filename_, frameSize + 20);
+    TrrMappedFile file(filename_);
+    EXPECT_EQ(1, file.numFrames());
+    EXPECT_EQ(TrrMappedFile::EndStatus::IncompleteHeader, file.endStatus());
+}
+
+TEST_F(TrrMappedFileTest, HandlesEmptyFile)
+{
+    writeFrames(0, 0, "w");
+    TrrMappedFile file(filename_);
+    EXPECT_EQ(0, file.numFrames());
+    EXPECT_EQ(TrrMappedFile::EndStatus::None, file.endStatus());
+}
+
+TEST(TrrConversionTest, ConvertsBigEndianFloatsAndDoubles)
+{
+    // 1, -2 and 0.5 as big-endian IEEE floats and doubles
+    const unsigned char floats[]  = { 0x3f, 0x80, 0, 0, 0xc0, 0, 0, 0, 0x3f, 0, 0, 0 };
+    const unsigned char doubles[] = { 0x3f, 0xf0, 0, 0, 0, 0, 0, 0, 0xc0, 0, 0, 0,
+                                      0,    0,    0, 0, 0x3f, 0xe0, 0, 0, 0, 0, 0, 0 };
+    std::vector<RVec>   vectors(1);
+    convertTrrVectors(reinterpret_cast<const char*>(floats), false, vectors);
+    EXPECT_EQ(1.0_real, vectors[0][XX]);
+    EXPECT_EQ(-2.0_real, vectors[0][YY]);
+    EXPECT_EQ(0.5_real, vectors[0][ZZ]);
+    vectors[0] = { 0, 0, 0 };
+    convertTrrVectors(reinterpret_cast<const char*>(doubles), true, vectors);
+    EXPECT_EQ(1.0_real, vectors[0][XX]);
+    EXPECT_EQ(-2.0_real, vectors[0][YY]);
+    EXPECT_EQ(0.5_real, vectors[0][ZZ]);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2026- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for writing xtc frames that were encoded in memory.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcio.h"
+
+#include <cmath>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of frames in the test files
+constexpr int c_numFrames = 3;
+
+//! Returns the test positions of \p numAtoms atoms in frame \p f
+std::vector<RVec> testPositions(int numAtoms, int f)
+{
+    std::vector<RVec> positions(numAtoms);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            positions[a][d] = 0.1 * (a % 23) + 0.5 * std::sin(0.7 * a + d + 0.1 * f);
+        }
+    }
+    return positions;
+}
+
+//! Returns the contents of the file \p path
+std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+//! The parameter is the number of atoms
+class XtcEncodingTest : public ::testing::TestWithParam<int>
+{
+};
+
+TEST_P(XtcEncodingTest, WritesSameFileAsWriteXtc)
+{
+    const int numAtoms = GetParam();
+    matrix    box      = { { 3, 0, 0 }, { 0, 3.5, 0 }, { 0.5, 0, 4 } };
+
+    TestFileManager             fileManager;
+    const std::filesystem::path directFileName  = fileManager.getTemporaryFilePath("direct.xtc");
+    const std::filesystem::path encodedFileName = fileManager.getTemporaryFilePath("encoded.xtc");
+
+    t_fileio*         directFile  = open_xtc(directFileName, "w");
+    t_fileio*         encodedFile = open_xtc(encodedFileName, "w");
+    std::vector<char> buffer;
+    for (int f = 0; f < c_numFrames; f++)
+    {
+        const auto x = testPositions(numAtoms, f);
+        EXPECT_EQ(1,
+                  write_xtc(directFile, numAtoms, 10 * f, 0.5 * f, box, as_rvec_array(x.data()), 1000));
+        EXPECT_TRUE(
+                encode_xtc(&buffer, numAtoms, 10 * f, 0.5 * f, box, as_rvec_array(x.data()), 1000));
+        EXPECT_EQ(0, buffer.size() % 4) << "XDR data should be a multiple of four bytes";
+        EXPECT_EQ(1, write_encoded_xtc(encodedFile, buffer));
+    }
+    close_xtc(directFile);
+    close_xtc(encodedFile);
+
+    const std::string directContents  = readFile(directFileName);
+    const std::string encodedContents = readFile(encodedFileName);
+    EXPECT_FALSE(directContents.empty());
+    EXPECT_TRUE(directContents == encodedContents) << "The files should be identical";
+}
+
+// With up to 9 atoms the positions are not compressed
+INSTANTIATE_TEST_SUITE_P(Works, XtcEncodingTest, ::testing::Values(1, 9, 10, 1000));
+
+} // namespace
+} // namespace test
+} // namespace gmx
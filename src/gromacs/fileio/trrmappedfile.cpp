@@ -0,0 +1,606 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements memory-mapped reading of trr files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "trrmappedfile.h"
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if HAVE_MMAP
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The magic number at the start of each trr frame
+constexpr int c_trrMagicNumber = 1993;
+
+//! Returns \p value with reversed byte order
+inline uint32_t swapBytes(uint32_t value)
+{
+    return (value >> 24) | ((value >> 8) & 0xff00U) | ((value << 8) & 0xff0000U) | (value << 24);
+}
+
+//! Returns \p value with reversed byte order
+inline uint64_t swapBytes(uint64_t value)
+{
+    return (static_cast<uint64_t>(swapBytes(static_cast<uint32_t>(value))) << 32)
+           | swapBytes(static_cast<uint32_t>(value >> 32));
+}
+
+/*! \brief Converts \p count big-endian values of type \p FileReal to real.
+ *
+ * The loop has no dependencies between iterations and no branches, so that
+ * compilers turn it into SIMD byte shuffles.
+ */
+template<typename FileReal, typename Bits>
+void convertBigEndian(const char* gmx_restrict data, real* gmx_restrict dest, size_t count)
+{
+    static_assert(sizeof(FileReal) == sizeof(Bits), "Bits should match the size of FileReal");
+    for (size_t i = 0; i < count; i++)
+    {
+        Bits bits;
+        std::memcpy(&bits, data + i * sizeof(Bits), sizeof(Bits));
+#if !GMX_INTEGER_BIG_ENDIAN
+        bits = swapBytes(bits);
+#endif
+        FileReal value;
+        std::memcpy(&value, &bits, sizeof(Bits));
+        dest[i] = value;
+    }
+}
+
+//! Outcome of parsing a frame from the mapped data
+enum class ParseResult
+{
+    Complete,
+    EndOfFile,
+    IncompleteHeader,
+    IncompleteData
+};
+
+//! Reads big-endian XDR values from a range of memory
+class XdrMemoryReader
+{
+public:
+    //! Start reading \p data of \p size bytes at \p position
+    XdrMemoryReader(const char* data, size_t size, size_t position) :
+        data_(data), size_(size), position_(position)
+    {
+    }
+
+    //! Reads an int, returns false when the data ends before it
+    bool readInt(int* value)
+    {
+        if (!haveBytes(sizeof(uint32_t)))
+        {
+            return false;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, data_ + position_, sizeof(bits));
+#if !GMX_INTEGER_BIG_ENDIAN
+        bits = swapBytes(bits);
+#endif
+        std::memcpy(value, &bits, sizeof(bits));
+        position_ += sizeof(bits);
+        return true;
+    }
+
+    //! Reads a single or double precision real, returns false when the data ends before it
+    bool readReal(bool bDouble, real* value)
+    {
+        const size_t numBytes = bDouble ? sizeof(double) : sizeof(float);
+        if (!haveBytes(numBytes))
+        {
+            return false;
+        }
+        if (bDouble)
+        {
+            convertBigEndian<double, uint64_t>(data_ + position_, value, 1);
+        }
+        else
+        {
+            convertBigEndian<float, uint32_t>(data_ + position_, value, 1);
+        }
+        position_ += numBytes;
+        return true;
+    }
+
+    //! Skips \p numBytes bytes, returns false when the data ends before that
+    bool skip(size_t numBytes)
+    {
+        if (!haveBytes(numBytes))
+        {
+            return false;
+        }
+        position_ += numBytes;
+        return true;
+    }
+
+    //! Returns the current position
+    size_t position() const { return position_; }
+
+    //! Returns the data at the current position
+    const char* current() const { return data_ + position_; }
+
+private:
+    //! Returns whether \p numBytes more bytes can be read
+    bool haveBytes(size_t numBytes) const { return size_ - position_ >= numBytes; }
+
+    const char* data_;
+    size_t      size_;
+    size_t      position_;
+};
+
+} // namespace
+
+void convertTrrVectors(const char* data, bool bDouble, ArrayRef<RVec> dest)
+{
+    real*        values    = reinterpret_cast<real*>(dest.data());
+    const size_t numValues = dest.size() * DIM;
+    if (bDouble)
+    {
+        convertBigEndian<double, uint64_t>(data, values, numValues);
+    }
+    else
+    {
+        convertBigEndian<float, uint32_t>(data, values, numValues);
+    }
+}
+
+class TrrMappedFile::Impl
+{
+public:
+    explicit Impl(const std::filesystem::path& filename);
+    ~Impl();
+
+    //! Returns the current size of the file
+    size_t currentFileSize() const;
+    //! Maps the whole file, replacing an earlier mapping
+    void map();
+    //! Parses the frame starting at \p offset into \p frame
+    ParseResult parseFrame(size_t offset, TrrFrameView* frame, size_t* frameEnd) const;
+    //! Indexes the next frame, returns whether there was a complete frame
+    bool indexNextFrame();
+
+    //! Index entry of a frame
+    struct FrameEntry
+    {
+        //! The frame header
+        gmx_trr_header_t header;
+        //! Offsets of the box, x, v and f data relative to the start of the file, 0 when absent
+        size_t boxOffset, xOffset, vOffset, fOffset;
+    };
+
+    //! The name of the file
+    std::filesystem::path filename_;
+#if HAVE_MMAP
+    //! The file descriptor of the mapped file
+    int fileDescriptor_ = -1;
+    //! The start of the mapping, nullptr for an empty file
+    void* mapping_ = nullptr;
+#else
+    //! The file contents
+    std::vector<char> buffer_;
+#endif
+    //! The start of the file contents
+    const char* data_ = nullptr;
+    //! The size of the mapped file contents
+    size_t size_ = 0;
+    //! The indexed frames
+    std::vector<FrameEntry> frames_;
+    //! The offset of the first frame that is not yet indexed
+    size_t nextFrameOffset_ = 0;
+    //! Why the last attempt at indexing a frame failed
+    EndStatus endStatus_ = EndStatus::None;
+    //! The header of the incomplete last frame
+    gmx_trr_header_t incompleteFrameHeader_;
+};
+
+TrrMappedFile::Impl::Impl(const std::filesystem::path& filename) : filename_(filename)
+{
+#if HAVE_MMAP
+    fileDescriptor_ = open(filename.string().c_str(), O_RDONLY);
+    if (fileDescriptor_ < 0)
+    {
+        GMX_THROW(FileIOError(formatString("Could not open file '%s' for reading: %s",
+                                           filename.string().c_str(),
+                                           std::strerror(errno))));
+    }
+#else
+    if (!gmx_fexist(filename))
+    {
+        GMX_THROW(FileIOError(formatString("Error while reading '%s' - file not found.",
+                                           filename.string().c_str())));
+    }
+#endif
+    std::memset(&incompleteFrameHeader_, 0, sizeof(incompleteFrameHeader_));
+    map();
+}
+
+TrrMappedFile::Impl::~Impl()
+{
+#if HAVE_MMAP
+    if (mapping_ != nullptr)
+    {
+        munmap(mapping_, size_);
+    }
+    close(fileDescriptor_);
+#endif
+}
+
+size_t TrrMappedFile::Impl::currentFileSize() const
+{
+#if HAVE_MMAP
+    struct stat fileStatus;
+    if (fstat(fileDescriptor_, &fileStatus) != 0)
+    {
+        GMX_THROW(FileIOError(formatString("Could not determine the size of file '%s': %s",
+                                           filename_.string().c_str(),
+                                           std::strerror(errno))));
+    }
+    return fileStatus.st_size;
+#else
+    std::error_code errorCode;
+    const auto      fileSize = std::filesystem::file_size(filename_, errorCode);
+    if (errorCode)
+    {
+        GMX_THROW(FileIOError(formatString("Could not determine the size of file '%s': %s",
+                                           filename_.string().c_str(),
+                                           errorCode.message().c_str())));
+    }
+    return fileSize;
+#endif
+}
+
+void TrrMappedFile::Impl::map()
+{
+    const size_t fileSize = currentFileSize();
+#if HAVE_MMAP
+    // An empty file can not be mapped and has no frames
+    void* mapping = nullptr;
+    if (fileSize > 0)
+    {
+        mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor_, 0);
+        if (mapping == MAP_FAILED)
+        {
+            // Keep the previous mapping, so that the indexed frames stay valid
+            GMX_THROW(FileIOError(formatString("Could not map file '%s': %s",
+                                               filename_.string().c_str(),
+                                               std::strerror(errno))));
+        }
+    }
+    if (mapping_ != nullptr)
+    {
+        munmap(mapping_, size_);
+    }
+    mapping_ = mapping;
+#    ifdef POSIX_MADV_SEQUENTIAL
+    if (mapping_ != nullptr)
+    {
+        // Trajectories are mostly read front to back, so let the kernel read ahead
+        posix_madvise(mapping_, fileSize, POSIX_MADV_SEQUENTIAL);
+    }
+#    endif
+    data_ = static_cast<const char*>(mapping_);
+#else
+    buffer_.resize(fileSize);
+    FILE*        fp       = gmx_ffopen(filename_, "rb");
+    const size_t readSize = std::fread(buffer_.data(), 1, buffer_.size(), fp);
+    gmx_ffclose(fp);
+    if (readSize != buffer_.size())
+    {
+        GMX_THROW(FileIOError(formatString("Could not read the whole file '%s'",
+                                           filename_.string().c_str())));
+    }
+    data_ = buffer_.data();
+#endif
+    size_ = fileSize;
+}
+
+ParseResult TrrMappedFile::Impl::parseFrame(size_t        offset,
+                                            TrrFrameView* frame,
+                                            size_t*       frameEnd) const
+{
+    static bool     bFirst = true;
+    XdrMemoryReader reader(data_, size_, offset);
+
+    int magic;
+    if (!reader.readInt(&magic))
+    {
+        return ParseResult::EndOfFile;
+    }
+    if (magic != c_trrMagicNumber)
+    {
+        GMX_THROW(FileIOError(formatString(
+                "Failed to find GROMACS magic number in trr frame header of '%s', so this is not "
+                "a trr file!",
+                filename_.string().c_str())));
+    }
+
+    // The version string is stored as its length including the terminating
+    // zero, followed by an XDR string: its length and the characters padded
+    // to a multiple of four bytes.
+    int versionStringSize, versionLength;
+    if (!reader.readInt(&versionStringSize) || !reader.readInt(&versionLength) || versionLength < 0)
+    {
+        return ParseResult::IncompleteHeader;
+    }
+    const char* versionString = reader.current();
+    if (!reader.skip((static_cast<size_t>(versionLength) + 3) & ~size_t(3)))
+    {
+        return ParseResult::IncompleteHeader;
+    }
+
+    gmx_trr_header_t* sh = &frame->header;
+    std::memset(sh, 0, sizeof(*sh));
+    int  xSize, vSize, fSize, step;
+    bool bOK = reader.readInt(&sh->ir_size) && reader.readInt(&sh->e_size)
+               && reader.readInt(&sh->box_size) && reader.readInt(&sh->vir_size)
+               && reader.readInt(&sh->pres_size) && reader.readInt(&sh->top_size)
+               && reader.readInt(&sh->sym_size) && reader.readInt(&xSize) && reader.readInt(&vSize)
+               && reader.readInt(&fSize) && reader.readInt(&sh->natoms);
+    if (!bOK)
+    {
+        return ParseResult::IncompleteHeader;
+    }
+    sh->x_size = xSize;
+    sh->v_size = vSize;
+    sh->f_size = fSize;
+    if (sh->natoms < 0)
+    {
+        GMX_THROW(FileIOError(formatString("Negative number of atoms in trr frame header of '%s'",
+                                           filename_.string().c_str())));
+    }
+
+    size_t floatSize = 0;
+    if (sh->box_size)
+    {
+        floatSize = sh->box_size / (DIM * DIM);
+    }
+    else if (sh->x_size)
+    {
+        floatSize = sh->x_size / (static_cast<unsigned int>(sh->natoms) * DIM);
+    }
+    else if (sh->v_size)
+    {
+        floatSize = sh->v_size / (static_cast<unsigned int>(sh->natoms) * DIM);
+    }
+    else if (sh->f_size)
+    {
+        floatSize = sh->f_size / (static_cast<unsigned int>(sh->natoms) * DIM);
+    }
+    else
+    {
+        GMX_THROW(FileIOError(formatString("Can not determine precision of trr file '%s'",
+                                           filename_.string().c_str())));
+    }
+    if (floatSize != sizeof(float) && floatSize != sizeof(double))
+    {
+        GMX_THROW(FileIOError(formatString("Float size %zu in trr file '%s'. Maybe different CPU?",
+                                           floatSize,
+                                           filename_.string().c_str())));
+    }
+    sh->bDouble = (floatSize == sizeof(double));
+
+    bOK = reader.readInt(&step) && reader.readInt(&sh->nre) && reader.readReal(sh->bDouble, &sh->t)
+          && reader.readReal(sh->bDouble, &sh->lambda);
+    if (!bOK)
+    {
+        return ParseResult::IncompleteHeader;
+    }
+    sh->step = step;
+
+    if (bFirst)
+    {
+        fprintf(stderr,
+                "trr version: %.*s (%s precision)\n",
+                versionLength,
+                versionString,
+                sh->bDouble ? "double" : "single");
+        bFirst = false;
+    }
+    if (sh->ir_size)
+    {
+        GMX_THROW(FileIOError("inputrec in trr file"));
+    }
+    if (sh->e_size)
+    {
+        GMX_THROW(FileIOError("energies in trr file"));
+    }
+    if (sh->top_size)
+    {
+        GMX_THROW(FileIOError("topology in trr file"));
+    }
+    if (sh->sym_size)
+    {
+        GMX_THROW(FileIOError("symbol table in trr file"));
+    }
+
+    const size_t matrixSize  = DIM * DIM * floatSize;
+    const size_t vectorsSize = static_cast<size_t>(sh->natoms) * DIM * floatSize;
+    // Assigns the data at the current position to \p data and skips it
+    auto takeData = [&reader](bool bPresent, size_t numBytes, const char** data) {
+        *data = nullptr;
+        if (!bPresent)
+        {
+            return true;
+        }
+        *data = reader.current();
+        return reader.skip(numBytes);
+    };
+    const char* unused;
+    bOK = takeData(sh->box_size != 0, matrixSize, &frame->box)
+          && takeData(sh->vir_size != 0, matrixSize, &unused)
+          && takeData(sh->pres_size != 0, matrixSize, &unused)
+          && takeData(sh->x_size != 0, vectorsSize, &frame->x)
+          && takeData(sh->v_size != 0, vectorsSize, &frame->v)
+          && takeData(sh->f_size != 0, vectorsSize, &frame->f);
+    if (!bOK)
+    {
+        return ParseResult::IncompleteData;
+    }
+    *frameEnd = reader.position();
+
+    return ParseResult::Complete;
+}
+
+bool TrrMappedFile::Impl::indexNextFrame()
+{
+    TrrFrameView frame;
+    size_t       frameEnd = 0;
+    ParseResult  result   = parseFrame(nextFrameOffset_, &frame, &frameEnd);
+    if (result != ParseResult::Complete && currentFileSize() > size_)
+    {
+        // The file is still being written, continue with the new contents
+        try
+        {
+            map();
+        }
+        catch (const FileIOError&)
+        {
+            endStatus_ = EndStatus::MappingFailed;
+            return false;
+        }
+        result = parseFrame(nextFrameOffset_, &frame, &frameEnd);
+    }
+    switch (result)
+    {
+        case ParseResult::Complete: break;
+        case ParseResult::EndOfFile: endStatus_ = EndStatus::None; return false;
+        case ParseResult::IncompleteHeader: endStatus_ = EndStatus::IncompleteHeader; return false;
+        case ParseResult::IncompleteData:
+            endStatus_             = EndStatus::IncompleteData;
+            incompleteFrameHeader_ = frame.header;
+            return false;
+    }
+
+    // Store offsets, as the data pointers change when the file is mapped again
+    auto offsetOf = [this](const char* data) { return data ? size_t(data - data_) : size_t(0); };
+    frames_.push_back({ frame.header,
+                        offsetOf(frame.box),
+                        offsetOf(frame.x),
+                        offsetOf(frame.v),
+                        offsetOf(frame.f) });
+    nextFrameOffset_ = frameEnd;
+    endStatus_       = EndStatus::None;
+
+    return true;
+}
+
+TrrMappedFile::TrrMappedFile(const std::filesystem::path& filename) :
+    impl_(std::make_unique<Impl>(filename))
+{
+}
+
+TrrMappedFile::~TrrMappedFile() = default;
+
+bool TrrMappedFile::hasFrame(int64_t index)
+{
+    while (static_cast<int64_t>(impl_->frames_.size()) <= index)
+    {
+        if (!impl_->indexNextFrame())
+        {
+            return false;
+        }
+    }
+    return index >= 0;
+}
+
+int64_t TrrMappedFile::numFrames()
+{
+    while (impl_->indexNextFrame()) {}
+    return impl_->frames_.size();
+}
+
+TrrFrameView TrrMappedFile::frame(int64_t index) const
+{
+    GMX_ASSERT(index >= 0 && index < static_cast<int64_t>(impl_->frames_.size()),
+               "Frame should have been indexed");
+    const Impl::FrameEntry& entry = impl_->frames_[index];
+    auto pointerTo = [this](size_t offset) { return offset ? impl_->data_ + offset : nullptr; };
+
+    TrrFrameView view;
+    view.header = entry.header;
+    view.box    = pointerTo(entry.boxOffset);
+    view.x      = pointerTo(entry.xOffset);
+    view.v      = pointerTo(entry.vOffset);
+    view.f      = pointerTo(entry.fOffset);
+
+    return view;
+}
+
+TrrMappedFile::EndStatus TrrMappedFile::endStatus() const
+{
+    return impl_->endStatus_;
+}
+
+int64_t TrrMappedFile::nextFrameOffset() const
+{
+    return impl_->nextFrameOffset_;
+}
+
+const gmx_trr_header_t& TrrMappedFile::incompleteFrameHeader() const
+{
+    return impl_->incompleteFrameHeader_;
+}
+
+} // namespace gmx
@@ -0,0 +1,172 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares memory-mapped reading of trr files.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_TRRMAPPEDFILE_H
+#define GMX_FILEIO_TRRMAPPEDFILE_H
+
+#include <cstdint>
+
+#include <filesystem>
+#include <memory>
+
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/math/vectypes.h"
+
+namespace gmx
+{
+template<typename>
+class ArrayRef;
+
+/*! \libinternal \brief Header and data of one frame of a memory-mapped trr file.
+ *
+ * The data pointers point into the mapping and are nullptr for quantities
+ * that are not present in the frame. The data is stored as big-endian XDR
+ * reals in the precision given by the header; use convertTrrVectors() to
+ * obtain it in host byte order.
+ */
+struct TrrFrameView
+{
+    //! The frame header
+    gmx_trr_header_t header;
+    //! The box, DIM vectors
+    const char* box = nullptr;
+    //! The coordinates, header.natoms vectors
+    const char* x = nullptr;
+    //! The velocities, header.natoms vectors
+    const char* v = nullptr;
+    //! The forces, header.natoms vectors
+    const char* f = nullptr;
+};
+
+/*! \brief Converts vectors stored in a trr file to host byte order and precision.
+ *
+ * \param[in]  data      Big-endian XDR data of a TrrFrameView, must hold dest.size() vectors
+ * \param[in]  bDouble   Whether the file stores double precision
+ * \param[out] dest      The converted vectors
+ */
+void convertTrrVectors(const char* data, bool bDouble, ArrayRef<RVec> dest);
+
+/*! \libinternal \brief Reads a trr file through a memory mapping of the whole file.
+ *
+ * Instead of decoding each frame through the XDR stream of t_fileio, the
+ * file is mapped into memory and frame offsets are indexed by walking the
+ * frame headers. Frames are then available for random access as views onto
+ * the mapping, and only the data that is actually used needs to be
+ * converted into host byte order. Skipping frames costs only the parsing of
+ * their header.
+ *
+ * Frames are indexed lazily, so the file can be read sequentially while it
+ * is still being written: when indexing reaches the end of the mapping, the
+ * file is mapped again if it has grown in the meantime.
+ *
+ * When memory mapping is not supported on the platform, the whole file is
+ * read into memory instead.
+ */
+class TrrMappedFile
+{
+public:
+    //! Describes why no more frames could be indexed.
+    enum class EndStatus
+    {
+        //! More frames might follow or the end of the file was reached between frames
+        None,
+        //! The file ends within a frame header
+        IncompleteHeader,
+        //! The file ends within the data of a frame
+        IncompleteData,
+        //! The file has grown, but could not be mapped again
+        MappingFailed
+    };
+
+    /*! \brief Opens and maps \p filename.
+     *
+     * \throws FileIOError when the file can not be opened or mapped
+     */
+    explicit TrrMappedFile(const std::filesystem::path& filename);
+    ~TrrMappedFile();
+
+    TrrMappedFile(const TrrMappedFile&)            = delete;
+    TrrMappedFile& operator=(const TrrMappedFile&) = delete;
+
+    /*! \brief Returns whether the file contains a complete frame with index \p index.
+     *
+     * Indexes the file up to that frame when needed.
+     * \throws FileIOError when the file is not a valid trr file
+     */
+    bool hasFrame(int64_t index);
+
+    /*! \brief Returns the number of complete frames in the file.
+     *
+     * Indexes the whole file.
+     * \throws FileIOError when the file is not a valid trr file
+     */
+    int64_t numFrames();
+
+    /*! \brief Returns the view of frame \p index, which must have been indexed with hasFrame().
+     *
+     * The view is valid until the next call to hasFrame() or numFrames(),
+     * which might map the file again.
+     */
+    TrrFrameView frame(int64_t index) const;
+
+    //! Returns why indexing stopped, only meaningful after hasFrame() returned false
+    EndStatus endStatus() const;
+
+    /*! \brief Returns the file offset of the first frame that has not been indexed
+     *
+     * When endStatus() is EndStatus::MappingFailed, the remaining frames can
+     * be read from this offset with the XDR reader.
+     */
+    int64_t nextFrameOffset() const;
+
+    /*! \brief Returns the header of the incomplete last frame
+     *
+     * Only valid when endStatus() is EndStatus::IncompleteData.
+     */
+    const gmx_trr_header_t& incompleteFrameHeader() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace gmx
+
+#endif
@@ -60,6 +60,7 @@
 #include "gromacs/fileio/tngio.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/trrmappedfile.h"
 #include "gromacs/fileio/xdrf.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/math/functions.h"
@@ -73,6 +74,7 @@
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
@@ -103,6 +105,8 @@ struct t_trxstatus
     gmx_tng_trajectory_t tng;
     int                  natoms;
     char*                persistent_line; /* Persistent line for reading g96 trajectories */
+    gmx::TrrMappedFile*  trrFile;         /* Mapped trr file, read instead of fio when set */
+    int64_t              trrFrame;        /* Index of the next frame to read from trrFile */
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t* vmdplugin;
 #endif
@@ -186,6 +190,8 @@ static void status_init(t_trxstatus* status)
     status->tf              = 0;
     status->persistent_line = nullptr;
     status->tng             = nullptr;
+    status->trrFile         = nullptr;
+    status->trrFrame        = 0;
 }
 
 
@@ -655,6 +661,7 @@ void close_trx(t_trxstatus* status)
         return;
     }
     gmx_tng_close(&status->tng);
+    delete status->trrFile;
     if (status->fio)
     {
         gmx_fio_close(status->fio);
@@ -691,6 +698,92 @@ t_trxstatus* open_trx(const std::filesystem::path& outfile, const char* filemode
     return stat;
 }
 
+/* Reads the next frame from a memory-mapped trr file. Only the data
+ * that is requested and present is converted, and not at all when the
+ * frame will be skipped based on its time.
+ */
+static gmx_bool gmx_next_mapped_frame(t_trxstatus* status, t_trxframe* fr)
+{
+    gmx::TrrMappedFile* trrFile = status->trrFile;
+
+    if (!trrFile->hasFrame(status->trrFrame))
+    {
+        switch (trrFile->endStatus())
+        {
+            case gmx::TrrMappedFile::EndStatus::None: break;
+            case gmx::TrrMappedFile::EndStatus::IncompleteHeader: fr->not_ok = HEADER_NOT_OK; break;
+            case gmx::TrrMappedFile::EndStatus::IncompleteData:
+                fr->time   = trrFile->incompleteFrameHeader().t;
+                fr->not_ok = DATA_NOT_OK;
+                break;
+            case gmx::TrrMappedFile::EndStatus::MappingFailed:
+                /* Continue with the XDR reader from the first frame not read */
+                gmx_fio_seek(status->fio, trrFile->nextFrameOffset());
+                delete status->trrFile;
+                status->trrFile = nullptr;
+                break;
+        }
+        return FALSE;
+    }
+    const gmx::TrrFrameView frame = trrFile->frame(status->trrFrame);
+    const gmx_trr_header_t& sh    = frame.header;
+    status->trrFrame++;
+
+    fr->bDouble   = sh.bDouble;
+    fr->natoms    = sh.natoms;
+    fr->bStep     = TRUE;
+    fr->step      = sh.step;
+    fr->bTime     = TRUE;
+    fr->time      = sh.t;
+    fr->bLambda   = TRUE;
+    fr->bFepState = TRUE;
+    fr->lambda    = sh.lambda;
+    fr->bBox      = sh.box_size > 0;
+    if (status->flags & (TRX_READ_X | TRX_NEED_X))
+    {
+        if (fr->x == nullptr)
+        {
+            snew(fr->x, sh.natoms);
+        }
+        fr->bX = sh.x_size > 0;
+    }
+    if (status->flags & (TRX_READ_V | TRX_NEED_V))
+    {
+        if (fr->v == nullptr)
+        {
+            snew(fr->v, sh.natoms);
+        }
+        fr->bV = sh.v_size > 0;
+    }
+    if (status->flags & (TRX_READ_F | TRX_NEED_F))
+    {
+        if (fr->f == nullptr)
+        {
+            snew(fr->f, sh.natoms);
+        }
+        fr->bF = sh.f_size > 0;
+    }
+
+    if (!(status->flags & TRX_DONT_SKIP) && check_times2(sh.t, status->t0, sh.bDouble) != 0)
+    {
+        /* read_next_frame() will skip this frame or stop reading */
+        return TRUE;
+    }
+    auto convert = [&sh](const char* data, rvec* dest, int numVectors) {
+        if (data != nullptr && dest != nullptr)
+        {
+            auto destRef = gmx::arrayRefFromArray(reinterpret_cast<gmx::RVec*>(dest), numVectors);
+            gmx::convertTrrVectors(data, sh.bDouble, destRef);
+        }
+    };
+    convert(frame.box, fr->box, DIM);
+    convert(frame.x, fr->x, sh.natoms);
+    convert(frame.v, fr->v, sh.natoms);
+    convert(frame.f, fr->f, sh.natoms);
+
+    return TRUE;
+}
+
 static gmx_bool gmx_next_frame(t_trxstatus* status, t_trxframe* fr)
 {
     gmx_trr_header_t sh;
@@ -858,7 +951,16 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
         auto startTime = timeValue(TimeControl::Begin);
         switch (ftp)
         {
-            case efTRR: bRet = gmx_next_frame(status, fr); break;
+            case efTRR:
+                if (status->trrFile)
+                {
+                    bRet = gmx_next_mapped_frame(status, fr);
+                }
+                if (!status->trrFile)
+                {
+                    bRet = gmx_next_frame(status, fr);
+                }
+                break;
             case efCPT:
                 /* Checkpoint files can not contain mulitple frames */
                 break;
@@ -981,7 +1083,19 @@ bool read_first_frame(const gmx_output_env_t*      oenv,
     }
     switch (ftp)
     {
-        case efTRR: break;
+        case efTRR:
+#if HAVE_MMAP
+            try
+            {
+                (*status)->trrFile = new gmx::TrrMappedFile(fn);
+            }
+            catch (const gmx::FileIOError&)
+            {
+                /* The file can not be mapped, read it with the XDR reader */
+                (*status)->trrFile = nullptr;
+            }
+#endif
+            break;
         case efCPT:
             read_checkpoint_trxframe(fio, fr);
             bFirst = FALSE;
@@ -1155,6 +1269,7 @@ void rewind_trj(t_trxstatus* status)
     initcount(status);
 
     gmx_fio_rewind(status->fio);
+    status->trrFrame = 0;
 }
 
 /***** T O P O L O G Y   S T U F F ******/
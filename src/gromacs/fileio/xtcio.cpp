@@ -38,6 +38,8 @@
 #include <cstdio>
 #include <cstring>
 
+#include <limits>
+
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
 #include "gromacs/fileio/xdrf.h"
@@ -234,6 +236,49 @@ int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* bo
     return bOK; /* 0 if bad, 1 if writing went well */
 }
 
+bool encode_xtc(std::vector<char>* buffer, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec)
+{
+    int      magic_number = (natoms > XTC_1995_MAX_NATOMS) ? XTC_NEW_MAGIC : XTC_MAGIC;
+    gmx_bool bDum;
+
+    /* The compressed coordinates take at most 1.2 ints per coordinate,
+     * the headers and the compression parameters fit in the margin.
+     */
+    const std::size_t maxSize = static_cast<std::size_t>(natoms) * DIM * sizeof(int) * 6 / 5 + 256;
+    if (maxSize > std::numeric_limits<unsigned int>::max())
+    {
+        return false;
+    }
+    buffer->resize(maxSize);
+
+    XDR xd;
+    xdrmem_create(&xd, buffer->data(), static_cast<unsigned int>(maxSize), XDR_ENCODE);
+    bool bOK = (xtc_header(&xd, &magic_number, &natoms, &step, &time, FALSE, &bDum) != 0);
+    if (bOK)
+    {
+        bOK = (xtc_coord(&xd, &natoms, const_cast<rvec*>(box), const_cast<rvec*>(x), &prec, magic_number, FALSE) != 0);
+    }
+    if (bOK)
+    {
+        buffer->resize(xdr_getpos(&xd));
+    }
+    xdr_destroy(&xd);
+
+    return bOK;
+}
+
+int write_encoded_xtc(t_fileio* fio, const std::vector<char>& buffer)
+{
+    XDR* xd = gmx_fio_getxdr(fio);
+    /* The encoded frame is a multiple of four bytes, so this adds no padding */
+    if (xdr_opaque(xd, const_cast<char*>(buffer.data()), static_cast<unsigned int>(buffer.size())) == 0)
+    {
+        return 0;
+    }
+
+    return (gmx_fio_flush(fio) == 0) ? 1 : 0;
+}
+
 int read_first_xtc(t_fileio* fio, int* natoms, int64_t* step, real* time, matrix box, rvec** x, real* prec, gmx_bool* bOK)
 {
     int  magic;
@@ -38,6 +38,7 @@
 #include <cstdint>
 
 #include <filesystem>
+#include <vector>
 
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/basedefinitions.h"
@@ -78,4 +79,14 @@ int read_next_xtc(struct t_fileio* fio, int natoms, int64_t* step, real* time, m
 int write_xtc(struct t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec);
 /* Write a frame to xtc file */
 
+bool encode_xtc(std::vector<char>* buffer, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec);
+/* Encode a frame into buffer, with the same contents as write_xtc() would write.
+ * This does not need a file, so frames can be encoded concurrently.
+ * Returns false when encoding failed or the frame is too large to encode
+ * in memory, the frame should then be written with write_xtc().
+ */
+
+int write_encoded_xtc(struct t_fileio* fio, const std::vector<char>& buffer);
+/* Write a frame encoded by encode_xtc() to xtc file */
+
 #endif
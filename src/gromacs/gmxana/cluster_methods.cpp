@@ -514,7 +514,7 @@ static void dump_nnb(FILE* fp, const char* title, int n1, t_nnb* nnb)
 void gromos(int n1, real** mat, real rmsdcut, t_clusters* clust)
 {
     t_nnb* nnb;
-    int    i, j, k, j1, maxval;
+    int    i, j, k, maxval;
 
     /* Put all neighbors nearer than rmsdcut in the list */
     fprintf(stderr, "Making list of neighbors within cutoff ");
@@ -546,6 +546,13 @@ void gromos(int n1, real** mat, real rmsdcut, t_clusters* clust)
     }
     fprintf(stderr, "%3d%%\n", 100);
 
+    gromos_neighbors(n1, nnb, clust);
+}
+
+void gromos_neighbors(int n1, t_nnb* nnb, t_clusters* clust)
+{
+    int i, j, k, j1;
+
     /* sort neighbor list on number of neighbors, largest first */
     std::sort(nnb, nnb + n1, nrnb_comp);
 
@@ -71,4 +71,11 @@ void jarvis_patrick(int n1, real** mat, int M, int P, real rmsdcut, t_clusters*
 
 void gromos(int n1, real** mat, real rmsdcut, t_clusters* clust);
 
+/*! \brief Gromos clustering of n1 structures from lists of their neighbors within the cut-off
+ *
+ * Each list should contain the structure itself and be sorted in
+ * increasing order. The lists are freed.
+ */
+void gromos_neighbors(int n1, t_nnb* nnb, t_clusters* clust);
+
 #endif
@@ -0,0 +1,252 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements multithreaded accumulation of density grids for the analysis tools.
+ */
+#include "gmxpre.h"
+
+#include "densitygrid.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <vector>
+
+#include "gromacs/fileio/mrcdensitymap.h"
+#include "gromacs/fileio/mrcdensitymapheader.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/units.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/inmemoryserializer.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The range of the spread Gaussians in multiples of sigma
+constexpr double c_spreadWidthMultiplesOfSigma = 4.0;
+
+/*! \brief The number of add() calls after which the spread Gaussians are flushed
+ *
+ * GaussTransform3D accumulates in single precision. Moving its content to the
+ * double precision thread grids regularly keeps the relative rounding errors
+ * independent of the number of frames.
+ */
+constexpr int c_numAddsPerFlush = 16;
+
+} // namespace
+
+DensityGridAccumulator::DensityGridAccumulator(const IVec& numBins, real sigma, int numThreads) :
+    numBins_(numBins),
+    numThreads_(std::max(numThreads, 1)),
+    sum_(numBins[ZZ], numBins[YY], numBins[XX])
+{
+    threadGrids_.reserve(numThreads_);
+    for (int t = 0; t < numThreads_; t++)
+    {
+        threadGrids_.emplace_back(numBins[ZZ], numBins[YY], numBins[XX]);
+    }
+    if (sigma > 0)
+    {
+        const dynamicExtents3D extents(numBins[ZZ], numBins[YY], numBins[XX]);
+        const GaussianSpreadKernelParameters::Shape shape{ DVec(sigma, sigma, sigma),
+                                                           c_spreadWidthMultiplesOfSigma };
+        threadGaussTransforms_.reserve(numThreads_);
+        for (int t = 0; t < numThreads_; t++)
+        {
+            threadGaussTransforms_.emplace_back(extents, shape);
+        }
+    }
+}
+
+DensityGridAccumulator::~DensityGridAccumulator() = default;
+
+int DensityGridAccumulator::add(ArrayRef<const RVec> latticePositions, real weight)
+{
+    const int  numPositions = latticePositions.ssize();
+    const bool spread       = !threadGaussTransforms_.empty();
+    int        numOutside   = 0;
+
+#pragma omp parallel num_threads(numThreads_) reduction(+ : numOutside)
+    {
+        try
+        {
+            const int thread = gmx_omp_get_thread_num();
+            auto&     grid   = threadGrids_[thread];
+#pragma omp for schedule(static)
+            for (int i = 0; i < numPositions; i++)
+            {
+                const RVec& c       = latticePositions[i];
+                const int   ix      = static_cast<int>(std::floor(c[XX]));
+                const int   iy      = static_cast<int>(std::floor(c[YY]));
+                const int   iz      = static_cast<int>(std::floor(c[ZZ]));
+                const bool  outside = (ix < 0 || ix >= numBins_[XX] || iy < 0 || iy >= numBins_[YY]
+                                      || iz < 0 || iz >= numBins_[ZZ]);
+                if (outside)
+                {
+                    numOutside++;
+                }
+                if (spread)
+                {
+                    /* GaussTransform3D puts lattice points at integer coordinates,
+                     * our bin centers are at half-integer coordinates.
+                     */
+                    const RVec shifted(c[XX] - 0.5_real, c[YY] - 0.5_real, c[ZZ] - 0.5_real);
+                    threadGaussTransforms_[thread].add({ shifted, weight });
+                }
+                else if (!outside)
+                {
+                    grid(iz, iy, ix) += weight;
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    if (spread && ++numAddsSinceFlush_ >= c_numAddsPerFlush)
+    {
+        flushGaussTransforms();
+    }
+
+    return numOutside;
+}
+
+void DensityGridAccumulator::flushGaussTransforms()
+{
+    if (threadGaussTransforms_.empty() || numAddsSinceFlush_ == 0)
+    {
+        return;
+    }
+#pragma omp parallel for num_threads(numThreads_) schedule(static)
+    for (int thread = 0; thread < numThreads_; thread++)
+    {
+        const auto spreadView = threadGaussTransforms_[thread].constView();
+        auto&      grid       = threadGrids_[thread];
+        for (int z = 0; z < numBins_[ZZ]; z++)
+        {
+            for (int y = 0; y < numBins_[YY]; y++)
+            {
+                for (int x = 0; x < numBins_[XX]; x++)
+                {
+                    grid(z, y, x) += spreadView(z, y, x);
+                }
+            }
+        }
+        threadGaussTransforms_[thread].setZero();
+    }
+    numAddsSinceFlush_ = 0;
+}
+
+const MultiDimArray<std::vector<double>, dynamicExtents3D>& DensityGridAccumulator::result()
+{
+    flushGaussTransforms();
+
+    ArrayRef<double> sum     = sum_.toArrayRef();
+    const int        numBins = sum.ssize();
+#pragma omp parallel for num_threads(numThreads_) schedule(static)
+    for (int i = 0; i < numBins; i++)
+    {
+        double binSum = 0;
+        for (const auto& grid : threadGrids_)
+        {
+            binSum += grid.toArrayRef()[i];
+        }
+        sum[i] = binSum;
+    }
+
+    return sum_;
+}
+
+void writeDensityGridMrc(const std::filesystem::path&                                filename,
+                         const MultiDimArray<std::vector<double>, dynamicExtents3D>& grid,
+                         const RVec&                                                 origin,
+                         const RVec&                                                 binWidth)
+{
+    const std::array<int32_t, DIM> numBins = { static_cast<int32_t>(grid.extent(2)),
+                                               static_cast<int32_t>(grid.extent(1)),
+                                               static_cast<int32_t>(grid.extent(0)) };
+
+    // The mrc format stores lengths in Ångström
+    MrcDensityMapHeader header;
+    header.numColumnRowSection_ = numBins;
+    header.extent_              = numBins;
+    for (int d = 0; d < DIM; d++)
+    {
+        header.cellLength_[d]            = numBins[d] * binWidth[d] * c_nm2A;
+        header.userDefinedFloat_[12 + d] = origin[d] * c_nm2A;
+    }
+
+    std::vector<float> data(grid.toArrayRef().begin(), grid.toArrayRef().end());
+    if (!data.empty())
+    {
+        const auto [minimum, maximum] = std::minmax_element(data.begin(), data.end());
+        double sum                    = 0;
+        double sumSquares             = 0;
+        for (const float value : data)
+        {
+            sum += value;
+            sumSquares += square(value);
+        }
+        header.dataStatistics_.min_  = *minimum;
+        header.dataStatistics_.max_  = *maximum;
+        header.dataStatistics_.mean_ = sum / data.size();
+        header.dataStatistics_.rms_  = std::sqrt(sumSquares / data.size());
+    }
+
+    InMemorySerializer serializer;
+    MrcDensityMapOfFloatWriter(header, data).write(&serializer);
+    const std::vector<char> buffer = serializer.finishAndGetBuffer();
+
+    FILE* fp = gmx_ffopen(filename, "wb");
+    if (std::fwrite(buffer.data(), 1, buffer.size(), fp) != buffer.size())
+    {
+        gmx_ffclose(fp);
+        GMX_THROW(FileIOError(formatString("Could not write density map to %s",
+                                           filename.string().c_str())));
+    }
+    gmx_ffclose(fp);
+}
+
+} // namespace gmx
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares multithreaded accumulation of density grids for the analysis tools.
+ */
+#ifndef GMX_GMXANA_DENSITYGRID_H
+#define GMX_GMXANA_DENSITYGRID_H
+
+#include <filesystem>
+#include <vector>
+
+#include "gromacs/math/gausstransform.h"
+#include "gromacs/math/multidimarray.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdspan/extensions.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+template<typename>
+class ArrayRef;
+
+/*! \internal \brief Accumulates positions over many frames on a three-dimensional grid.
+ *
+ * Positions are given in lattice coordinates, that is, position c falls into
+ * bin floor(c) and bin i has its center at lattice coordinate i + 0.5.
+ * Without a spreading width, each position adds its weight to the bin it
+ * falls into. With a spreading width, a normalized Gaussian with the weight as
+ * amplitude is spread onto the bin centers with GaussTransform3D, so that the
+ * total weight is conserved for positions away from the grid edges.
+ *
+ * Every OpenMP thread accumulates into a private grid. The thread grids are
+ * summed only when the result is requested, so adding positions never needs
+ * synchronization between threads.
+ *
+ * The grid layout is the one of GaussTransform3D and the mrc file format:
+ * indexed as [z][y][x], with x running fastest.
+ */
+class DensityGridAccumulator
+{
+public:
+    /*! \brief Construct a zero grid.
+     *
+     * \param[in] numBins     The number of bins along x, y and z
+     * \param[in] sigma       Gaussian spreading width in bins, 0 for plain binning
+     * \param[in] numThreads  The number of threads that add positions
+     */
+    DensityGridAccumulator(const IVec& numBins, real sigma, int numThreads);
+    ~DensityGridAccumulator();
+
+    /*! \brief Add \p weight at all \p latticePositions.
+     *
+     * With plain binning, positions outside of the grid are skipped. With
+     * spreading, only the part of their Gaussian that overlaps the grid is added.
+     * \returns the number of positions outside of the grid
+     */
+    int add(ArrayRef<const RVec> latticePositions, real weight);
+
+    //! Return the grid summed over all threads
+    const MultiDimArray<std::vector<double>, dynamicExtents3D>& result();
+
+private:
+    //! Adds the not yet accumulated spread Gaussians of all threads to the thread grids
+    void flushGaussTransforms();
+
+    //! The number of bins along x, y and z
+    IVec numBins_;
+    //! The number of threads that accumulate into their own grids
+    int numThreads_;
+    //! The grid of each thread
+    std::vector<MultiDimArray<std::vector<double>, dynamicExtents3D>> threadGrids_;
+    //! Single precision spreading lattices of each thread, empty without spreading
+    std::vector<GaussTransform3D> threadGaussTransforms_;
+    //! The number of add() calls since the spreading lattices were flushed
+    int numAddsSinceFlush_ = 0;
+    //! The sum of the thread grids
+    MultiDimArray<std::vector<double>, dynamicExtents3D> sum_;
+};
+
+/*! \brief Write a density grid to an mrc/ccp4 file.
+ *
+ * \param[in] filename The name of the file
+ * \param[in] grid     The grid, indexed as [z][y][x]
+ * \param[in] origin   The position of the lower corner of the grid in nm
+ * \param[in] binWidth The width of the bins in nm
+ * \throws FileIOError when the file cannot be written
+ */
+void writeDensityGridMrc(const std::filesystem::path&                                filename,
+                         const MultiDimArray<std::vector<double>, dynamicExtents3D>& grid,
+                         const RVec&                                                 origin,
+                         const RVec&                                                 binWidth);
+
+} // namespace gmx
+
+#endif
@@ -33,6 +33,8 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cctype>
 #include <cmath>
 #include <cstdint>
@@ -43,6 +45,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -58,13 +61,21 @@
 #include "gromacs/math/utilities.h"
 #include "gromacs/mdlib/energyoutput.h"
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/random/seed.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformintdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/trajectory/energyframe.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/snprintf.h"
@@ -2183,6 +2194,475 @@ static double bar_err(int nbmin, int nbmax, const double* partsum)
     return std::sqrt(svar / (nbmax + 1 - nbmin));
 }
 
+namespace
+{
+
+#if GMX_SIMD_HAVE_DOUBLE
+//! The number of samples the MBAR sums process at once
+constexpr int c_mbarSimdWidth = GMX_SIMD_DOUBLE_WIDTH;
+#else
+//! The number of samples the MBAR sums process at once
+constexpr int c_mbarSimdWidth = 1;
+#endif
+
+//! The number of samples per thread task in the MBAR denominator sums, multiple of the SIMD width
+constexpr int c_mbarBlockSize = 256;
+
+//! Reduced potential of padding and unused samples, gives zero weight in all sums
+constexpr double c_mbarExcluded = 1e30;
+
+/*! \brief Multistate Bennett acceptance ratio estimator
+ *
+ * Stores the reduced potential differences u_kn = beta (H_k - H_i)(x_n)
+ * of every sample n, drawn from state i, in every state k. Samples are
+ * ordered by the state they were drawn from. The potentials of one
+ * state are stored contiguously, padded to the SIMD width, so both the
+ * sums over states per sample and the sums over samples per state are
+ * vectorized log-sum-exp reductions.
+ *
+ * The free energies are solved by direct iteration of the MBAR
+ * self-consistent equations, Shirts & Chodera,
+ * J. Chem. Phys. 129, 124105 (2008).
+ */
+class MbarEstimator
+{
+public:
+    //! Allocates storage for \p numSamples samples drawn from each state
+    explicit MbarEstimator(const std::vector<int>& numSamples) :
+        numStates_(numSamples.size()),
+        numSamples_(numSamples),
+        sampleStart_(numSamples.size() + 1, 0)
+    {
+        for (int k = 0; k < numStates_; k++)
+        {
+            sampleStart_[k + 1] = sampleStart_[k] + numSamples_[k];
+        }
+        stride_ = ((sampleStart_[numStates_] + c_mbarSimdWidth - 1) / c_mbarSimdWidth)
+                  * c_mbarSimdWidth;
+        u_.resize(static_cast<size_t>(numStates_) * stride_, c_mbarExcluded);
+    }
+
+    //! Returns the number of states
+    int numStates() const { return numStates_; }
+    //! Returns the index of the first sample drawn from state \p k, \p k may be numStates()
+    int firstSampleOfState(int k) const { return sampleStart_[k]; }
+    //! Returns the number of samples padded to the SIMD width
+    int paddedNumSamples() const { return stride_; }
+
+    //! Returns the reduced potentials in \p state of the samples drawn from \p sampledState
+    double* reducedPotentials(int state, int sampledState)
+    {
+        return u_.data() + static_cast<size_t>(state) * stride_ + sampleStart_[sampledState];
+    }
+
+    /*! \brief Solves the MBAR equations, returns the number of iterations
+     *
+     * \param[in]     logWeight  Log of the multiplicity of each sample, or empty for
+     *                           using all samples once
+     * \param[in,out] f          The reduced free energies, the input is used as
+     *                           starting point, the output has f[0] = 0
+     * \param[in]     tol        Convergence tolerance on the change in f, in kT
+     * \param[in]     maxIter    Maximum number of iterations
+     * \param[out]    converged  Whether the iteration converged
+     */
+    int solve(gmx::ArrayRef<const double> logWeight,
+              std::vector<double>*        f,
+              double                      tol,
+              int                         maxIter,
+              bool*                       converged) const
+    {
+        std::vector<double, gmx::AlignedAllocator<double>> logDenominator(stride_);
+        std::vector<double> fNew(numStates_);
+
+        *converged = false;
+        int iter   = 0;
+        while (iter < maxIter && !*converged)
+        {
+            computeLogDenominators(*f, logDenominator.data());
+
+#pragma omp parallel for schedule(dynamic) if (numStates_ > 1)
+            for (int k = 0; k < numStates_; k++)
+            {
+                try
+                {
+                    fNew[k] = -logSumExpOfState(k, logDenominator.data(), logWeight);
+                }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+            }
+
+            double maxChange = 0;
+            for (int k = 0; k < numStates_; k++)
+            {
+                fNew[k] -= fNew[0];
+                maxChange = std::max(maxChange, std::abs(fNew[k] - (*f)[k]));
+            }
+            f->swap(fNew);
+            *converged = (maxChange < tol);
+            iter++;
+        }
+
+        return iter;
+    }
+
+private:
+    /*! \brief Computes for each sample n: ln sum_k N_k exp(f_k - u_kn)
+     *
+     * Two passes over the states per block of samples: first the maximum
+     * exponent, then the sum of the exponentials relative to that.
+     */
+    void computeLogDenominators(gmx::ArrayRef<const double> f, double* logDenominator) const
+    {
+        std::vector<double> c(numStates_);
+        for (int k = 0; k < numStates_; k++)
+        {
+            c[k] = std::log(static_cast<double>(numSamples_[k])) + f[k];
+        }
+
+        const int numBlocks = (stride_ + c_mbarBlockSize - 1) / c_mbarBlockSize;
+
+#pragma omp parallel for schedule(static)
+        for (int b = 0; b < numBlocks; b++)
+        {
+            try
+            {
+                alignas(GMX_SIMD_ALIGNMENT) double sum[c_mbarBlockSize];
+
+                const int start = b * c_mbarBlockSize;
+                const int end   = std::min(start + c_mbarBlockSize, stride_);
+                double*   L     = logDenominator + start;
+                const int n     = end - start;
+
+                for (int s = 0; s < n; s++)
+                {
+                    L[s]   = -c_mbarExcluded;
+                    sum[s] = 0;
+                }
+                for (int k = 0; k < numStates_; k++)
+                {
+                    const double* uk = u_.data() + static_cast<size_t>(k) * stride_ + start;
+#if GMX_SIMD_HAVE_DOUBLE
+                    const gmx::SimdDouble ck(c[k]);
+                    for (int s = 0; s < n; s += GMX_SIMD_DOUBLE_WIDTH)
+                    {
+                        gmx::store(L + s, gmx::max(gmx::load<gmx::SimdDouble>(L + s),
+                                                   ck - gmx::load<gmx::SimdDouble>(uk + s)));
+                    }
+#else
+                    for (int s = 0; s < n; s++)
+                    {
+                        L[s] = std::max(L[s], c[k] - uk[s]);
+                    }
+#endif
+                }
+                for (int k = 0; k < numStates_; k++)
+                {
+                    const double* uk = u_.data() + static_cast<size_t>(k) * stride_ + start;
+#if GMX_SIMD_HAVE_DOUBLE
+                    const gmx::SimdDouble ck(c[k]);
+                    for (int s = 0; s < n; s += GMX_SIMD_DOUBLE_WIDTH)
+                    {
+                        gmx::SimdDouble x = ck - gmx::load<gmx::SimdDouble>(uk + s)
+                                            - gmx::load<gmx::SimdDouble>(L + s);
+                        gmx::store(sum + s, gmx::load<gmx::SimdDouble>(sum + s) + gmx::exp(x));
+                    }
+#else
+                    for (int s = 0; s < n; s++)
+                    {
+                        sum[s] += std::exp(c[k] - uk[s] - L[s]);
+                    }
+#endif
+                }
+                for (int s = 0; s < n; s++)
+                {
+                    /* padding samples should get zero weight */
+                    L[s] = (start + s < sampleStart_[numStates_] ? L[s] + std::log(sum[s])
+                                                                 : c_mbarExcluded);
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+    }
+
+    //! Returns ln sum_n w_n exp(-u_kn - L_n) for state \p k
+    double logSumExpOfState(int                         k,
+                            const double*               logDenominator,
+                            gmx::ArrayRef<const double> logWeight) const
+    {
+        const double* uk      = u_.data() + static_cast<size_t>(k) * stride_;
+        const bool    weights = !logWeight.empty();
+
+#if GMX_SIMD_HAVE_DOUBLE
+        alignas(GMX_SIMD_ALIGNMENT) double buffer[GMX_SIMD_DOUBLE_WIDTH];
+
+        gmx::SimdDouble maxExponent(-c_mbarExcluded);
+        for (int n = 0; n < stride_; n += GMX_SIMD_DOUBLE_WIDTH)
+        {
+            gmx::SimdDouble x = gmx::load<gmx::SimdDouble>(uk + n)
+                                + gmx::load<gmx::SimdDouble>(logDenominator + n);
+            if (weights)
+            {
+                x = x - gmx::load<gmx::SimdDouble>(logWeight.data() + n);
+            }
+            maxExponent = gmx::max(maxExponent, -x);
+        }
+        gmx::store(buffer, maxExponent);
+        double m = buffer[0];
+        for (int i = 1; i < GMX_SIMD_DOUBLE_WIDTH; i++)
+        {
+            m = std::max(m, buffer[i]);
+        }
+
+        const gmx::SimdDouble mSimd(m);
+        gmx::SimdDouble       sum(0.0);
+        for (int n = 0; n < stride_; n += GMX_SIMD_DOUBLE_WIDTH)
+        {
+            gmx::SimdDouble x = gmx::load<gmx::SimdDouble>(uk + n)
+                                + gmx::load<gmx::SimdDouble>(logDenominator + n);
+            if (weights)
+            {
+                x = x - gmx::load<gmx::SimdDouble>(logWeight.data() + n);
+            }
+            sum = sum + gmx::exp(-x - mSimd);
+        }
+
+        return m + std::log(gmx::reduce(sum));
+#else
+        double m = -c_mbarExcluded;
+        for (int n = 0; n < stride_; n++)
+        {
+            m = std::max(m, -uk[n] - logDenominator[n] + (weights ? logWeight[n] : 0));
+        }
+        double sum = 0;
+        for (int n = 0; n < stride_; n++)
+        {
+            sum += std::exp(-uk[n] - logDenominator[n] + (weights ? logWeight[n] : 0) - m);
+        }
+
+        return m + std::log(sum);
+#endif
+    }
+
+    //! The number of states
+    int numStates_;
+    //! The number of samples drawn from each state
+    std::vector<int> numSamples_;
+    //! The index of the first sample of each state, the last entry is the total
+    std::vector<int> sampleStart_;
+    //! The padded number of samples, the stride between states in u_
+    int stride_;
+    //! The reduced potentials, state-major
+    std::vector<double, gmx::AlignedAllocator<double>> u_;
+};
+
+} // namespace
+
+/* return the index of the state with lambda vector lambda, -1 when not present */
+static int mbar_state_index(const std::vector<lambda_data_t*>& states, const lambda_vec_t* lambda)
+{
+    for (size_t k = 0; k < states.size(); k++)
+    {
+        if (lambda_vec_same(states[k]->lambda, lambda))
+        {
+            return static_cast<int>(k);
+        }
+    }
+    return -1;
+}
+
+/* Collect the Delta H samples of all lambda states into an MBAR estimator.
+   Returns nullptr, after printing the reason, when the data can not be
+   used for MBAR. */
+static std::unique_ptr<MbarEstimator> mbar_create(sim_data_t*                  sd,
+                                                  std::vector<lambda_data_t*>* states)
+{
+    lambda_data_t* bl_head = sd->lb;
+
+    states->clear();
+    for (lambda_data_t* bl = bl_head->next; bl != bl_head; bl = bl->next)
+    {
+        states->push_back(bl);
+    }
+    const int nstates = states->size();
+
+    /* check that all states have Delta H samples to all other states */
+    std::vector<int> numSamples(nstates, -1);
+    for (int i = 0; i < nstates; i++)
+    {
+        lambda_data_t* bl = (*states)[i];
+
+        if (bl->temp != (*states)[0]->temp)
+        {
+            printf("\nMBAR: not all simulations have the same temperature, skipping MBAR.\n");
+            return nullptr;
+        }
+        for (int k = 0; k < nstates; k++)
+        {
+            sample_coll_t* sc = lambda_data_find_sample_coll(bl, (*states)[k]->lambda);
+            if (sc == nullptr)
+            {
+                if (k == i)
+                {
+                    /* the energy difference to the own state is zero */
+                    continue;
+                }
+                char descX[STRLEN], descY[STRLEN];
+                snprint_lambda_vec(descX, STRLEN, "X", (*states)[k]->lambda);
+                snprint_lambda_vec(descY, STRLEN, "Y", bl->lambda);
+                printf("\nMBAR: could not find a set for foreign lambda (state X below)\nin the "
+                       "files for main lambda (state Y below), skipping MBAR.\n"
+                       "MBAR needs Delta H to all states, see the .mdp option "
+                       "calc-lambda-neighbors.\n\n%s\n%s\n",
+                       descX,
+                       descY);
+                return nullptr;
+            }
+            for (int j = 0; j < sc->nsamples; j++)
+            {
+                if (sc->r[j].use && sc->s[j]->hist)
+                {
+                    printf("\nMBAR: histogram data can not be used, skipping MBAR.\n");
+                    return nullptr;
+                }
+            }
+            if (numSamples[i] < 0)
+            {
+                numSamples[i] = sc->ntot;
+            }
+            else if (numSamples[i] != sc->ntot)
+            {
+                printf("\nMBAR: the number of Delta H samples differs between foreign lambdas\n"
+                       "of the same main lambda, skipping MBAR.\n");
+                return nullptr;
+            }
+        }
+        if (numSamples[i] <= 0)
+        {
+            printf("\nMBAR: no samples for a lambda state, skipping MBAR.\n");
+            return nullptr;
+        }
+    }
+
+    auto mbar = std::make_unique<MbarEstimator>(numSamples);
+
+    const double beta = 1 / (gmx::c_boltz * (*states)[0]->temp);
+    for (int i = 0; i < nstates; i++)
+    {
+        lambda_data_t* bl = (*states)[i];
+        for (int k = 0; k < nstates; k++)
+        {
+            double*        u  = mbar->reducedPotentials(k, i);
+            sample_coll_t* sc = lambda_data_find_sample_coll(bl, (*states)[k]->lambda);
+            if (sc == nullptr)
+            {
+                std::fill(u, u + numSamples[i], 0.0);
+                continue;
+            }
+            int n = 0;
+            for (int j = 0; j < sc->nsamples; j++)
+            {
+                if (sc->r[j].use)
+                {
+                    for (int m = sc->r[j].start; m < sc->r[j].end; m++)
+                    {
+                        u[n++] = beta * sc->s[j]->du[m];
+                    }
+                }
+            }
+        }
+    }
+
+    return mbar;
+}
+
+/* Compute the MBAR free energies, in kT, and their bootstrap errors.
+   The bootstrap replicas resample the samples of each state with
+   replacement and are computed in parallel. */
+static int mbar_calc(const MbarEstimator& mbar,
+                     double               tol,
+                     int                  nbootstrap,
+                     int                  seed,
+                     std::vector<double>* f,
+                     std::vector<double>* f_err,
+                     std::vector<double>* df_err)
+{
+    const int nstates  = mbar.numStates();
+    const int max_iter = 100000;
+    bool      converged;
+
+    int niter = mbar.solve({}, f, tol, max_iter, &converged);
+    if (!converged)
+    {
+        printf("\nWARNING: MBAR did not converge in %d iterations\n", niter);
+    }
+
+    f_err->assign(nstates, 0.0);
+    df_err->assign(nstates, 0.0);
+    if (nbootstrap < 2)
+    {
+        return niter;
+    }
+
+    std::vector<double> f_sum(nstates, 0.0), f_sum2(nstates, 0.0);
+    std::vector<double> df_sum(nstates, 0.0), df_sum2(nstates, 0.0);
+    std::vector<std::vector<double>> f_boot(nbootstrap);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < nbootstrap; b++)
+    {
+        try
+        {
+            gmx::ThreeFry2x64<64> rng(seed, gmx::RandomDomain::Other);
+            rng.restart(b, 0);
+
+            std::vector<int> count(mbar.paddedNumSamples(), 0);
+            for (int k = 0; k < nstates; k++)
+            {
+                const int start = mbar.firstSampleOfState(k);
+                const int end   = mbar.firstSampleOfState(k + 1);
+                gmx::UniformIntDistribution<int> dist(start, end - 1);
+                for (int n = start; n < end; n++)
+                {
+                    count[dist(rng)]++;
+                }
+            }
+            std::vector<double, gmx::AlignedAllocator<double>> logWeight(count.size());
+            for (size_t n = 0; n < count.size(); n++)
+            {
+                logWeight[n] =
+                        (count[n] > 0 ? std::log(static_cast<double>(count[n])) : -c_mbarExcluded);
+            }
+
+            f_boot[b] = *f;
+            bool bootConverged;
+            mbar.solve(logWeight, &f_boot[b], tol, max_iter, &bootConverged);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    for (int b = 0; b < nbootstrap; b++)
+    {
+        for (int k = 1; k < nstates; k++)
+        {
+            double df = f_boot[b][k] - f_boot[b][k - 1];
+            f_sum[k] += f_boot[b][k];
+            f_sum2[k] += f_boot[b][k] * f_boot[b][k];
+            df_sum[k] += df;
+            df_sum2[k] += df * df;
+        }
+    }
+    for (int k = 1; k < nstates; k++)
+    {
+        double fav  = f_sum[k] / nbootstrap;
+        double dfav = df_sum[k] / nbootstrap;
+        double fvar  = (f_sum2[k] / nbootstrap - fav * fav) * nbootstrap / (nbootstrap - 1);
+        double dfvar = (df_sum2[k] / nbootstrap - dfav * dfav) * nbootstrap / (nbootstrap - 1);
+        (*f_err)[k]  = std::sqrt(std::max(0.0, fvar));
+        (*df_err)[k] = std::sqrt(std::max(0.0, dfvar));
+    }
+
+    return niter;
+}
+
 
 /* Seek the end of an identifier (consecutive non-spaces), followed by
    an optional number of spaces or '='-signs. Returns a pointer to the
@@ -3442,12 +3922,30 @@ int gmx_bar(int argc, char* argv[])
 
         "To get a visual estimate of the phase space overlap, use the ",
         "[TT]-oh[tt] option to write series of histograms, together with the ",
-        "[TT]-nbin[tt] option.[PAR]"
+        "[TT]-nbin[tt] option.[PAR]",
+
+        "With [TT]-mbar[tt] the free energies of all states are also estimated ",
+        "with the multistate Bennett acceptance ratio (MBAR) method, ",
+        "Shirts & Chodera, J. Chem. Phys. 129, 124105 (2008), which uses ",
+        "the energy differences of every sample to all states. This requires ",
+        "[GRK]Delta[grk]H to all [GRK]lambda[grk] states for every simulation ",
+        "(see the [REF].mdp[ref] option [TT]calc-lambda-neighbors[tt]) and ",
+        "does not work with histograms. The MBAR equations are solved ",
+        "iteratively, starting from the BAR estimates. Errors are estimated ",
+        "from [TT]-nbootstrap[tt] bootstrap replicas, which resample the ",
+        "samples of each state with replacement. Note that this assumes ",
+        "uncorrelated samples. The MBAR free energy differences between ",
+        "neighboring states can be written with [TT]-om[tt]. The BAR pairs, ",
+        "the MBAR sums and the bootstrap replicas are computed in parallel ",
+        "using [TT]-nt[tt] threads.[PAR]"
     };
     static real begin = 0, end = -1, temp = -1;
     int         nd = 2, nbmin = 5, nbmax = 5;
     int         nbin     = 100;
     gmx_bool    use_dhdl = FALSE;
+    gmx_bool    use_mbar = FALSE;
+    int         nbootstrap = 0, seed = 0;
+    int         nthreads   = -1;
     t_pargs     pa[]     = {
         { "-b", FALSE, etREAL, { &begin }, "Begin time for BAR" },
         { "-e", FALSE, etREAL, { &end }, "End time for BAR" },
@@ -3460,14 +3958,25 @@ int gmx_bar(int argc, char* argv[])
           FALSE,
           etBOOL,
           { &use_dhdl },
-          "Whether to linearly extrapolate dH/dl values to use as energies" }
+          "Whether to linearly extrapolate dH/dl values to use as energies" },
+        { "-mbar", FALSE, etBOOL, { &use_mbar }, "Also estimate the free energies with MBAR" },
+        { "-nbootstrap",
+          FALSE,
+          etINT,
+          { &nbootstrap },
+          "Number of bootstrap replicas for the MBAR error estimate" },
+        { "-seed", FALSE, etINT, { &seed }, "Random seed for bootstrapping, 0 means generate" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to use" },
+#endif
     };
 
     t_filenm fnm[] = { { efXVG, "-f", "dhdl", ffOPTRDMULT },
                        { efEDR, "-g", "ener", ffOPTRDMULT },
                        { efXVG, "-o", "bar", ffOPTWR },
                        { efXVG, "-oi", "barint", ffOPTWR },
-                       { efXVG, "-oh", "histogram", ffOPTWR } };
+                       { efXVG, "-oh", "histogram", ffOPTWR },
+                       { efXVG, "-om", "mbar", ffOPTWR } };
 #define NFILE asize(fnm)
 
     int        f;
@@ -3493,12 +4002,16 @@ int gmx_bar(int argc, char* argv[])
     double   sum_histrange_err = 0.; /* histogram range error */
     double   stat_err          = 0.; /* statistical error */
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(
                 &argc, argv, PCA_CAN_VIEW, NFILE, fnm, asize(pa), pa, asize(desc), desc, 0, nullptr, &oenv))
     {
         return 0;
     }
 
+    gmx_omp_set_num_threads(nthreads);
+
     gmx::ArrayRef<const std::string> xvgFiles = opt2fnsIfOptionSet("-f", NFILE, fnm);
     gmx::ArrayRef<const std::string> edrFiles = opt2fnsIfOptionSet("-g", NFILE, fnm);
 
@@ -3600,16 +4113,49 @@ int gmx_bar(int argc, char* argv[])
         nbmin = nbmax;
     }
 
-    /* first calculate results */
-    bEE      = TRUE;
-    disc_err = FALSE;
-    for (f = 0; f < nresults; f++)
+    /* first calculate results, the pairs are independent */
     {
-        /* Determine the free energy difference with a factor of 10
-         * more accuracy than requested for printing.
+        const int                 npartsum = (nbmax + 1) * (nbmax + 1);
+        std::vector<double>       result_partsum(static_cast<size_t>(nresults) * npartsum, 0.0);
+        std::vector<unsigned int> result_EE(nresults, TRUE);
+
+#pragma omp parallel for schedule(dynamic)
+        for (f = 0; f < nresults; f++)
+        {
+            try
+            {
+                /* Determine the free energy difference with a factor of 10
+                 * more accuracy than requested for printing.
+                 */
+                gmx_bool bEEf;
+                calc_bar(&(results[f]),
+                         0.1 * prec,
+                         nbmin,
+                         nbmax,
+                         &bEEf,
+                         result_partsum.data() + f * npartsum);
+                result_EE[f] = bEEf;
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        /* sum in the serial order for reproducible results */
+        for (f = 0; f < nresults; f++)
+        {
+            for (int i = 0; i < npartsum; i++)
+            {
+                partsum[i] += result_partsum[f * npartsum + i];
+            }
+        }
+        /* as before the pairs were run in parallel, the last pair decides
+         * whether the error estimates are printed
          */
-        calc_bar(&(results[f]), 0.1 * prec, nbmin, nbmax, &bEE, partsum);
+        bEE = (nresults == 0 || result_EE[nresults - 1]);
+    }
 
+    disc_err = FALSE;
+    for (f = 0; f < nresults; f++)
+    {
         if (results[f].dg_disc_err > prec / 10.)
         {
             disc_err = TRUE;
@@ -3801,6 +4347,93 @@ int gmx_bar(int argc, char* argv[])
     }
     printf("\n");
 
+    if (use_mbar)
+    {
+        std::vector<lambda_data_t*>    states;
+        std::unique_ptr<MbarEstimator> mbar = mbar_create(&sim_data, &states);
+
+        if (mbar)
+        {
+            std::vector<double> f_mbar(states.size(), 0.0), f_err, df_err;
+
+            if (!use_dhdl)
+            {
+                /* start from the BAR results, states not connected to the
+                 * first state by BAR pairs start at zero
+                 */
+                std::vector<bool> bKnown(states.size(), false);
+                bKnown[0] = true;
+                for (f = 0; f < nresults; f++)
+                {
+                    const int a = mbar_state_index(states, results[f].a->native_lambda);
+                    const int b = mbar_state_index(states, results[f].b->native_lambda);
+                    if (a >= 0 && b >= 0 && bKnown[a] && !bKnown[b])
+                    {
+                        f_mbar[b] = f_mbar[a] + results[f].dg;
+                        bKnown[b] = true;
+                    }
+                }
+            }
+            if (nbootstrap > 1 && seed == 0)
+            {
+                seed = static_cast<int>(gmx::makeRandomSeed());
+            }
+            int niter = mbar_calc(*mbar, 0.01 * prec, nbootstrap, seed, &f_mbar, &f_err, &df_err);
+            gmx_bool mbarEE = (nbootstrap > 1);
+
+            printf("\nMBAR results in kJ/mol (%d iterations", niter);
+            if (mbarEE)
+            {
+                printf(", errors from %d bootstrap replicas, seed %d", nbootstrap, seed);
+            }
+            printf("):\n\n");
+            for (size_t k = 1; k < states.size(); k++)
+            {
+                printf("point ");
+                lambda_vec_print_short(states[k - 1]->lambda, buf);
+                lambda_vec_print_short(states[k]->lambda, buf2);
+                printf("%s - %s", buf, buf2);
+                printf(",   DG ");
+                printf(dgformat, (f_mbar[k] - f_mbar[k - 1]) * kT);
+                if (mbarEE)
+                {
+                    printf(" +/- ");
+                    printf(dgformat, df_err[k] * kT);
+                }
+                printf("\n");
+            }
+            printf("\n");
+            if (opt2bSet("-om", NFILE, fnm))
+            {
+                sprintf(buf, "%s (%s)", "\\DeltaG", "kT");
+                FILE* fpm = xvgropen_type(opt2fn("-om", NFILE, fnm),
+                                          "MBAR free energy differences",
+                                          "\\lambda",
+                                          buf,
+                                          exvggtXYDY,
+                                          oenv);
+                for (size_t k = 1; k < states.size(); k++)
+                {
+                    lambda_vec_print_intermediate(states[k - 1]->lambda, states[k]->lambda, buf);
+                    fprintf(fpm, xvg3format, buf, f_mbar[k] - f_mbar[k - 1], df_err[k]);
+                }
+                xvgrclose(fpm);
+            }
+            printf("total ");
+            lambda_vec_print_short(states.front()->lambda, buf);
+            lambda_vec_print_short(states.back()->lambda, buf2);
+            printf("%s - %s", buf, buf2);
+            printf(",   DG ");
+            printf(dgformat, f_mbar.back() * kT);
+            if (mbarEE)
+            {
+                printf(" +/- ");
+                printf(dgformat, f_err.back() * kT);
+            }
+            printf("\n\n");
+        }
+    }
+
 
     if (fpi != nullptr)
     {
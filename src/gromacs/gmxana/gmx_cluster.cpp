@@ -33,6 +33,8 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cinttypes>
 #include <cmath>
 #include <cstdio>
@@ -41,8 +43,11 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <numeric>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "gromacs/commandline/filenm.h"
@@ -68,15 +73,19 @@
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
 #include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/topology/atoms.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/path.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
@@ -213,7 +222,7 @@ static rvec** read_whole_trj(const char*             fn,
         }
         if (clusterIndex >= max_nf)
         {
-            max_nf += 10;
+            max_nf = std::max(10, 2 * max_nf);
             srenew(xx, max_nf);
             srenew(*time, max_nf);
             srenew(*boxes, max_nf);
@@ -242,6 +251,423 @@ static rvec** read_whole_trj(const char*             fn,
     return xx;
 }
 
+//! Frees the frames \p xx of read_whole_trj() and sets \p xx to nullptr
+static void free_whole_trj(rvec*** xx, int nframe)
+{
+    for (int i = 0; i < nframe; i++)
+    {
+        sfree((*xx)[i]);
+    }
+    sfree(*xx);
+    *xx = nullptr;
+}
+
+namespace
+{
+
+/*! \brief Fit group coordinates of all frames, stored for fast pairwise RMSD evaluation
+ *
+ * The coordinates are multiplied by the square root of the fit weights and
+ * stored as separate x, y and z arrays padded to the SIMD width, so the
+ * weighted inner products of two frames vectorize. With fitting, the RMSD
+ * after optimal superposition follows from the largest eigenvalue of the
+ * quaternion matrix of the inner products (the QCP method), so no rotation
+ * matrix is constructed or applied. The frames should be centered on the
+ * weighted center of the fit group. Evaluating RMSDs is thread safe.
+ */
+class RmsdFrameStore
+{
+public:
+    RmsdFrameStore(int numFrames, rvec** xx, int ifsize, const int* fitidx, const real* mass, bool bFit);
+
+    //! Returns the (fitted) RMSD between frames \p a and \p b
+    real rmsd(int a, int b) const;
+    //! Returns the number of frames
+    int numFrames() const { return numFrames_; }
+
+private:
+    //! Returns the coordinates of dimension \p d of \p frame
+    const real* coordinates(int frame, int d) const
+    {
+        return coordinates_.data() + (static_cast<int64_t>(frame) * DIM + d) * paddedSize_;
+    }
+
+    int  numFrames_;
+    int  paddedSize_;
+    bool bFit_;
+    //! Inverse of the sum of the fit weights
+    double invTotalWeight_;
+    //! Weighted coordinates per frame and dimension
+    std::vector<real, gmx::AlignedAllocator<real>> coordinates_;
+    //! Weighted sum of the squared coordinates per frame
+    std::vector<double> squaredNorms_;
+};
+
+RmsdFrameStore::RmsdFrameStore(int numFrames, rvec** xx, int ifsize, const int* fitidx, const real* mass, bool bFit) :
+    numFrames_(numFrames),
+    paddedSize_(ifsize),
+    bFit_(bFit),
+    invTotalWeight_(0),
+    squaredNorms_(numFrames, 0.0)
+{
+#if GMX_SIMD_HAVE_REAL
+    paddedSize_ = ((ifsize + GMX_SIMD_REAL_WIDTH - 1) / GMX_SIMD_REAL_WIDTH) * GMX_SIMD_REAL_WIDTH;
+#endif
+    coordinates_.resize(static_cast<int64_t>(numFrames) * DIM * paddedSize_, 0.0_real);
+
+    std::vector<real> sqrtWeights(ifsize);
+    double            totalWeight = 0;
+    for (int i = 0; i < ifsize; i++)
+    {
+        sqrtWeights[i] = std::sqrt(mass[fitidx[i]]);
+        totalWeight += mass[fitidx[i]];
+    }
+    invTotalWeight_ = 1.0 / totalWeight;
+
+    for (int f = 0; f < numFrames; f++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            real* x = coordinates_.data() + (static_cast<int64_t>(f) * DIM + d) * paddedSize_;
+            for (int i = 0; i < ifsize; i++)
+            {
+                x[i] = sqrtWeights[i] * xx[f][fitidx[i]][d];
+                squaredNorms_[f] += static_cast<double>(x[i]) * x[i];
+            }
+        }
+    }
+}
+
+/*! \brief Returns the largest eigenvalue of the symmetric quaternion matrix of inner products \p s
+ *
+ * This is the largest inner product that can be obtained by rotating the
+ * first structure onto the second. The eigenvalue is the largest root of
+ * the characteristic polynomial, found with Newton iterations starting
+ * from \p upperBound, the mean of the squared norms of the structures.
+ */
+double maxRotatedInnerProduct(const double s[DIM][DIM], double upperBound)
+{
+    const double k[4][4] = {
+        { s[XX][XX] + s[YY][YY] + s[ZZ][ZZ], s[YY][ZZ] - s[ZZ][YY], s[ZZ][XX] - s[XX][ZZ], s[XX][YY] - s[YY][XX] },
+        { s[YY][ZZ] - s[ZZ][YY], s[XX][XX] - s[YY][YY] - s[ZZ][ZZ], s[XX][YY] + s[YY][XX], s[ZZ][XX] + s[XX][ZZ] },
+        { s[ZZ][XX] - s[XX][ZZ], s[XX][YY] + s[YY][XX], -s[XX][XX] + s[YY][YY] - s[ZZ][ZZ], s[YY][ZZ] + s[ZZ][YY] },
+        { s[XX][YY] - s[YY][XX], s[ZZ][XX] + s[XX][ZZ], s[YY][ZZ] + s[ZZ][YY], -s[XX][XX] - s[YY][YY] + s[ZZ][ZZ] }
+    };
+
+    /* The matrix is traceless, so its characteristic polynomial is
+     * lambda^4 + c2 lambda^2 + c1 lambda + c0 with c2 = -tr(K^2)/2,
+     * c1 = -tr(K^3)/3 and c0 = det(K).
+     */
+    double traceK2 = 0;
+    double traceK3 = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            traceK2 += k[i][j] * k[j][i];
+            for (int l = 0; l < 4; l++)
+            {
+                traceK3 += k[i][j] * k[j][l] * k[l][i];
+            }
+        }
+    }
+    const double c2 = -0.5 * traceK2;
+    const double c1 = -traceK3 / 3;
+
+    const double s0  = k[0][0] * k[1][1] - k[1][0] * k[0][1];
+    const double s1  = k[0][0] * k[1][2] - k[1][0] * k[0][2];
+    const double s2  = k[0][0] * k[1][3] - k[1][0] * k[0][3];
+    const double s3  = k[0][1] * k[1][2] - k[1][1] * k[0][2];
+    const double s4  = k[0][1] * k[1][3] - k[1][1] * k[0][3];
+    const double s5  = k[0][2] * k[1][3] - k[1][2] * k[0][3];
+    const double m5  = k[2][2] * k[3][3] - k[3][2] * k[2][3];
+    const double m4  = k[2][1] * k[3][3] - k[3][1] * k[2][3];
+    const double m3  = k[2][1] * k[3][2] - k[3][1] * k[2][2];
+    const double m2  = k[2][0] * k[3][3] - k[3][0] * k[2][3];
+    const double m1  = k[2][0] * k[3][2] - k[3][0] * k[2][2];
+    const double m0  = k[2][0] * k[3][1] - k[3][0] * k[2][1];
+    const double c0  = s0 * m5 - s1 * m4 + s2 * m3 + s3 * m2 - s4 * m1 + s5 * m0;
+
+    double lambda = upperBound;
+    for (int iter = 0; iter < 50; iter++)
+    {
+        const double lambda2    = lambda * lambda;
+        const double value      = (lambda2 + c2) * lambda2 + c1 * lambda + c0;
+        const double derivative = (4 * lambda2 + 2 * c2) * lambda + c1;
+        if (derivative == 0)
+        {
+            break;
+        }
+        const double delta = value / derivative;
+        lambda -= delta;
+        if (std::abs(delta) <= 1e-11 * std::abs(lambda))
+        {
+            break;
+        }
+    }
+    return lambda;
+}
+
+real RmsdFrameStore::rmsd(int a, int b) const
+{
+    if (a == b)
+    {
+        return 0;
+    }
+    /* Use the same order of the operations for both orders of the frames */
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+    const real* ax = coordinates(a, XX);
+    const real* ay = coordinates(a, YY);
+    const real* az = coordinates(a, ZZ);
+    const real* bx = coordinates(b, XX);
+    const real* by = coordinates(b, YY);
+    const real* bz = coordinates(b, ZZ);
+
+    double msd;
+    if (!bFit_)
+    {
+        real sum = 0;
+#if GMX_SIMD_HAVE_REAL
+        using gmx::load;
+        using gmx::SimdReal;
+        SimdReal sumS = gmx::setZero();
+        for (int i = 0; i < paddedSize_; i += GMX_SIMD_REAL_WIDTH)
+        {
+            const SimdReal dx = load<SimdReal>(ax + i) - load<SimdReal>(bx + i);
+            const SimdReal dy = load<SimdReal>(ay + i) - load<SimdReal>(by + i);
+            const SimdReal dz = load<SimdReal>(az + i) - load<SimdReal>(bz + i);
+            sumS              = gmx::fma(dx, dx, gmx::fma(dy, dy, gmx::fma(dz, dz, sumS)));
+        }
+        sum = gmx::reduce(sumS);
+#else
+        for (int i = 0; i < paddedSize_; i++)
+        {
+            sum += gmx::square(ax[i] - bx[i]) + gmx::square(ay[i] - by[i]) + gmx::square(az[i] - bz[i]);
+        }
+#endif
+        msd = sum;
+    }
+    else
+    {
+        /* The MSD is a small difference of the large norms and inner products,
+         * so the inner products are accumulated in double, as the norms are.
+         */
+        double s[DIM][DIM];
+#if GMX_SIMD_HAVE_FLOAT && GMX_SIMD_HAVE_DOUBLE && !GMX_DOUBLE \
+        && GMX_SIMD_FLOAT_WIDTH == 2 * GMX_SIMD_DOUBLE_WIDTH
+        using gmx::load;
+        using gmx::SimdDouble;
+        using gmx::SimdFloat;
+        const real* const aDims[DIM] = { ax, ay, az };
+        const real* const bDims[DIM] = { bx, by, bz };
+        SimdDouble        sS[DIM][DIM];
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                sS[d][e] = gmx::setZero();
+            }
+        }
+        for (int i = 0; i < paddedSize_; i += GMX_SIMD_FLOAT_WIDTH)
+        {
+            /* Both halves of the float registers, converted to double */
+            SimdDouble aS[2][DIM];
+            SimdDouble bS[2][DIM];
+            for (int d = 0; d < DIM; d++)
+            {
+                gmx::cvtF2DD(load<SimdFloat>(aDims[d] + i), &aS[0][d], &aS[1][d]);
+                gmx::cvtF2DD(load<SimdFloat>(bDims[d] + i), &bS[0][d], &bS[1][d]);
+            }
+            for (int h = 0; h < 2; h++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    for (int e = 0; e < DIM; e++)
+                    {
+                        sS[d][e] = gmx::fma(aS[h][d], bS[h][e], sS[d][e]);
+                    }
+                }
+            }
+        }
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                s[d][e] = gmx::reduce(sS[d][e]);
+            }
+        }
+#elif GMX_SIMD_HAVE_REAL && GMX_DOUBLE
+        using gmx::load;
+        using gmx::SimdReal;
+        SimdReal sS[DIM][DIM];
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                sS[d][e] = gmx::setZero();
+            }
+        }
+        for (int i = 0; i < paddedSize_; i += GMX_SIMD_REAL_WIDTH)
+        {
+            const SimdReal aS[DIM] = { load<SimdReal>(ax + i), load<SimdReal>(ay + i), load<SimdReal>(az + i) };
+            const SimdReal bS[DIM] = { load<SimdReal>(bx + i), load<SimdReal>(by + i), load<SimdReal>(bz + i) };
+            for (int d = 0; d < DIM; d++)
+            {
+                for (int e = 0; e < DIM; e++)
+                {
+                    sS[d][e] = gmx::fma(aS[d], bS[e], sS[d][e]);
+                }
+            }
+        }
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                s[d][e] = gmx::reduce(sS[d][e]);
+            }
+        }
+#else
+        const real* const aDims[DIM] = { ax, ay, az };
+        const real* const bDims[DIM] = { bx, by, bz };
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                double sum = 0;
+                for (int i = 0; i < paddedSize_; i++)
+                {
+                    sum += static_cast<double>(aDims[d][i]) * bDims[e][i];
+                }
+                s[d][e] = sum;
+            }
+        }
+#endif
+        const double normSum = squaredNorms_[a] + squaredNorms_[b];
+        msd                  = normSum - 2 * maxRotatedInnerProduct(s, 0.5 * normSum);
+    }
+    return std::sqrt(std::max(msd, 0.0) * invTotalWeight_);
+}
+
+} // namespace
+
+/* Fill the RMSD matrix, with the frame pairs distributed over the threads */
+static void calc_rmsd_matrix(const RmsdFrameStore& frames, t_mat* rms)
+{
+    const int nf   = frames.numFrames();
+    int64_t   nrms = (static_cast<int64_t>(nf) * static_cast<int64_t>(nf - 1)) / 2;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i1 = 0; i1 < nf; i1++)
+    {
+        try
+        {
+            for (int i2 = i1 + 1; i2 < nf; i2++)
+            {
+                rms->mat[i1][i2] = frames.rmsd(i1, i2);
+            }
+#pragma omp critical
+            {
+                nrms -= nf - i1 - 1;
+                fprintf(stderr,
+                        "\r# RMSD calculations left: "
+                        "%" PRId64 "   ",
+                        nrms);
+                fflush(stderr);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    for (int i1 = 0; i1 < nf; i1++)
+    {
+        for (int i2 = i1 + 1; i2 < nf; i2++)
+        {
+            set_mat_entry(rms, i1, i2, rms->mat[i1][i2]);
+        }
+    }
+}
+
+/* Make the lists of frames within rmsdcut of each frame, including the frame
+ * itself, without storing the RMSD matrix. Since the RMSD is a metric, the
+ * difference of the RMSDs of two frames to a pivot frame is a lower bound for
+ * their RMSD, so with the frames sorted on the RMSD to the pivot only a window
+ * of frames needs to be checked for each frame.
+ */
+static t_nnb* make_rmsd_neighbor_lists(const RmsdFrameStore& frames, real rmsdcut, int64_t* npairs)
+{
+    const int nf = frames.numFrames();
+    /* Margin for rounding errors in the pivot RMSDs */
+    const real windowSize = rmsdcut * (1 + 1e-3) + 1e-5;
+
+    std::vector<real> pivotRmsd(nf);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < nf; i++)
+    {
+        pivotRmsd[i] = frames.rmsd(0, i);
+    }
+    std::vector<int> order(nf);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&pivotRmsd](int a, int b) { return pivotRmsd[a] < pivotRmsd[b]; });
+
+    std::vector<std::vector<std::pair<int, int>>> threadPairs(gmx_omp_get_max_threads());
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int p = 0; p < nf; p++)
+    {
+        try
+        {
+            std::vector<std::pair<int, int>>& pairs = threadPairs[gmx_omp_get_thread_num()];
+            const int                         i     = order[p];
+            for (int q = p + 1; q < nf && pivotRmsd[order[q]] - pivotRmsd[i] <= windowSize; q++)
+            {
+                const int j = order[q];
+                if (frames.rmsd(i, j) < rmsdcut)
+                {
+                    pairs.emplace_back(i, j);
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    t_nnb* nnb;
+    snew(nnb, nf);
+    std::vector<int> count(nf, rmsdcut > 0 ? 1 : 0);
+    *npairs = 0;
+    for (const auto& pairs : threadPairs)
+    {
+        for (const auto& pair : pairs)
+        {
+            count[pair.first]++;
+            count[pair.second]++;
+        }
+        *npairs += gmx::ssize(pairs);
+    }
+    for (int i = 0; i < nf; i++)
+    {
+        snew(nnb[i].nb, count[i]);
+        if (rmsdcut > 0)
+        {
+            nnb[i].nb[nnb[i].nr++] = i;
+        }
+    }
+    for (const auto& pairs : threadPairs)
+    {
+        for (const auto& pair : pairs)
+        {
+            nnb[pair.first].nb[nnb[pair.first].nr++]   = pair.second;
+            nnb[pair.second].nb[nnb[pair.second].nr++] = pair.first;
+        }
+    }
+    for (int i = 0; i < nf; i++)
+    {
+        std::sort(nnb[i].nb, nnb[i].nb + nnb[i].nr);
+    }
+
+    return nnb;
+}
+
 static int plot_clusters(int nf, real** mat, t_clusters* clust, int minstruct)
 {
     int  i, j, ncluster, ci;
@@ -402,36 +828,36 @@ static void ana_trans(t_clusters*             clust,
     sfree(axis);
 }
 
-static void analyze_clusters(int                     nf,
-                             t_clusters*             clust,
-                             real**                  rmsd,
-                             int                     natom,
-                             t_atoms*                atoms,
-                             rvec*                   xtps,
-                             real*                   mass,
-                             rvec**                  xx,
-                             real*                   time,
-                             matrix*                 boxes,
-                             int*                    frameindices,
-                             int                     ifsize,
-                             int*                    fitidx,
-                             int                     iosize,
-                             int*                    outidx,
-                             const char*             trxfn,
-                             const char*             sizefn,
-                             const char*             transfn,
-                             const char*             ntransfn,
-                             const char*             clustidfn,
-                             const char*             clustndxfn,
-                             gmx_bool                bAverage,
-                             int                     write_ncl,
-                             int                     write_nst,
-                             real                    rmsmin,
-                             gmx_bool                bFit,
-                             FILE*                   log,
-                             t_rgb                   rlo,
-                             t_rgb                   rhi,
-                             const gmx_output_env_t* oenv)
+static void analyze_clusters(int                                 nf,
+                             t_clusters*                         clust,
+                             const std::function<real(int, int)>& rmsd,
+                             int                                 natom,
+                             t_atoms*                            atoms,
+                             rvec*                               xtps,
+                             real*                               mass,
+                             rvec**                              xx,
+                             real*                               time,
+                             matrix*                             boxes,
+                             int*                                frameindices,
+                             int                                 ifsize,
+                             int*                                fitidx,
+                             int                                 iosize,
+                             int*                                outidx,
+                             const char*                         trxfn,
+                             const char*                         sizefn,
+                             const char*                         transfn,
+                             const char*                         ntransfn,
+                             const char*                         clustidfn,
+                             const char*                         clustndxfn,
+                             gmx_bool                            bAverage,
+                             int                                 write_ncl,
+                             int                                 write_nst,
+                             real                                rmsmin,
+                             gmx_bool                            bFit,
+                             FILE*                               log,
+                             t_rgb                               rlo,
+                             t_rgb                               rhi,
+                             const gmx_output_env_t*             oenv)
 {
     FILE*        size_fp = nullptr;
     FILE*        ndxfn   = nullptr;
@@ -617,11 +1043,11 @@ static void analyze_clusters(int                     nf,
                 {
                     if (i < i1)
                     {
-                        r += rmsd[structure[i]][structure[i1]];
+                        r += rmsd(structure[i], structure[i1]);
                     }
                     else
                     {
-                        r += rmsd[structure[i1]][structure[i]];
+                        r += rmsd(structure[i1], structure[i]);
                     }
                 }
                 r /= (nstr - 1);
@@ -708,7 +1134,7 @@ static void analyze_clusters(int                     nf,
                         {
                             if (bWrite[i1])
                             {
-                                bWrite[i] = rmsd[structure[i1]][structure[i]] > rmsmin;
+                                bWrite[i] = rmsd(structure[i1], structure[i]) > rmsmin;
                             }
                         }
                     }
@@ -875,6 +1301,17 @@ int gmx_cluster(int argc, char* argv[])
         "   [TT]-nst[tt] and [TT]-rmsmin[tt]). The center of a cluster is the",
         "   structure with the smallest average RMSD from all other structures",
         "   of the cluster.",
+        "",
+
+        "The RMS deviations between the structures are computed in parallel",
+        "with [TT]-nt[tt] threads. For long trajectories the RMSD matrix",
+        "does not fit in memory. With [TT]-sparse[tt], the gromos method",
+        "only stores the pairs of structures within [TT]cutoff[tt] of each",
+        "other. Since the RMSD satisfies the triangle inequality, only pairs",
+        "with similar RMSD to the first structure are then compared.",
+        "The matrix outputs [TT]-o[tt], [TT]-om[tt] and [TT]-dist[tt] are",
+        "not written in this mode, and the middle structure of each cluster",
+        "is determined by computing the RMSDs within the cluster again.",
     };
 
     FILE *  fp, *log;
@@ -883,10 +1320,10 @@ int gmx_cluster(int argc, char* argv[])
 
     matrix      box;
     matrix*     boxes = nullptr;
-    rvec *      xtps, *usextps, *x1, **xx = nullptr;
+    rvec *      xtps, *usextps, **xx = nullptr;
     const char *fn, *trx_out_fn;
     t_clusters  clust;
-    t_mat *     rms, *orig = nullptr;
+    t_mat *     rms = nullptr, *orig = nullptr;
     real*       eigenvalues;
     t_topology  top;
     PbcType     pbcType;
@@ -896,7 +1333,7 @@ int gmx_cluster(int argc, char* argv[])
     int      isize = 0, ifsize = 0, iosize = 0;
     int *    index = nullptr, *fitidx = nullptr, *outidx = nullptr, *frameindices = nullptr;
     char*    grpname;
-    real     rmsd, **d1, **d2, *time = nullptr, time_invfac, *mass = nullptr;
+    real **  d1, **d2, *time = nullptr, time_invfac, *mass = nullptr;
     char     buf[STRLEN], buf1[80];
     gmx_bool bAnalyze, bUseRmsdCut, bJP_RMSD = FALSE, bReadMat, bReadTraj, bPBC = TRUE;
 
@@ -921,10 +1358,11 @@ int gmx_cluster(int argc, char* argv[])
     static t_rgb rhi_bot = { 0.0, 0.0, 1.0 };
     static int   nlevels = 40, skip = 1;
     static real  scalemax = -1.0, rmsdcut = 0.1, rmsmin = 0.0;
-    gmx_bool     bRMSdist = FALSE, bBinary = FALSE, bAverage = FALSE, bFit = TRUE;
+    gmx_bool     bRMSdist = FALSE, bBinary = FALSE, bAverage = FALSE, bFit = TRUE, bSparse = FALSE;
     static int   niter = 10000, nrandom = 0, seed = 0, write_ncl = 0, write_nst = 1, minstruct = 1;
     static real  kT = 1e-3;
     static int   M = 10, P = 3;
+    static int   nthreads = -1;
     gmx_output_env_t* oenv;
     gmx_rmpbc_t       gpbc = nullptr;
 
@@ -1003,7 +1441,15 @@ int gmx_cluster(int argc, char* argv[])
           { &kT },
           "Boltzmann weighting factor for Monte Carlo optimization "
           "(zero turns off uphill steps)" },
-        { "-pbc", FALSE, etBOOL, { &bPBC }, "PBC check" }
+        { "-pbc", FALSE, etBOOL, { &bPBC }, "PBC check" },
+        { "-sparse",
+          FALSE,
+          etBOOL,
+          { &bSparse },
+          "Only store the RMSDs below the cut-off (gromos method only)" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to start" },
+#endif
     };
     t_filenm fnm[] = {
         { efTRX, "-f", nullptr, ffOPTRD },         { efTPS, "-s", nullptr, ffREAD },
@@ -1017,6 +1463,8 @@ int gmx_cluster(int argc, char* argv[])
     };
 #define NFILE asize(fnm)
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(&argc,
                            argv,
                            PCA_CAN_VIEW | PCA_CAN_TIME | PCA_TIME_UNIT,
@@ -1033,6 +1481,8 @@ int gmx_cluster(int argc, char* argv[])
         return 0;
     }
 
+    gmx_omp_set_num_threads(nthreads);
+
     /* parse options */
     bReadMat  = opt2bSet("-dm", NFILE, fnm);
     bReadTraj = opt2bSet("-f", NFILE, fnm) || !bReadMat;
@@ -1074,6 +1524,13 @@ int gmx_cluster(int argc, char* argv[])
 
     bAnalyze = (method == m_linkage || method == m_jarvis_patrick || method == m_gromos);
 
+    if (bSparse && (method != m_gromos || bReadMat || bRMSdist || bBinary))
+    {
+        gmx_fatal(FARGS,
+                  "-sparse is only supported with the gromos method and RMS deviations "
+                  "computed from a trajectory, without -dm, -dista and -binary");
+    }
+
     /* Open log file */
     log = ftp2FILE(efLOG, NFILE, fnm, "w");
 
@@ -1215,7 +1672,9 @@ int gmx_cluster(int argc, char* argv[])
         }
     }
 
-    std::vector<t_matrix> readmat;
+    std::vector<t_matrix>         readmat;
+    std::optional<RmsdFrameStore> frameStore;
+    t_nnb*                        nnb = nullptr;
     if (bReadMat)
     {
         fprintf(stderr, "Reading rms distance matrix ");
@@ -1249,42 +1708,35 @@ int gmx_cluster(int argc, char* argv[])
 
         nlevels = gmx::ssize(readmat[0].map);
     }
+    else if (bSparse)
+    {
+        fprintf(stderr, "Computing RMS deviations below %g nm between %d structures\n", rmsdcut, nf);
+        frameStore.emplace(nf, xx, ifsize, fitidx, mass, bFit);
+        if (!trx_out_fn)
+        {
+            /* The store holds all that is needed, do not keep two copies */
+            free_whole_trj(&xx, nf);
+        }
+        nnb = make_rmsd_neighbor_lists(*frameStore, rmsdcut, &nrms);
+    }
     else /* !bReadMat */
     {
-        rms  = init_mat(nf, method == m_diagonalize);
-        nrms = (static_cast<int64_t>(nf) * static_cast<int64_t>(nf - 1)) / 2;
+        rms = init_mat(nf, method == m_diagonalize);
         if (!bRMSdist)
         {
             fprintf(stderr, "Computing %dx%d RMS deviation matrix\n", nf, nf);
-            /* Initialize work array */
-            snew(x1, isize);
-            for (i1 = 0; i1 < nf; i1++)
+            frameStore.emplace(nf, xx, ifsize, fitidx, mass, bFit);
+            if (!trx_out_fn)
             {
-                for (i2 = i1 + 1; i2 < nf; i2++)
-                {
-                    for (i = 0; i < isize; i++)
-                    {
-                        copy_rvec(xx[i1][i], x1[i]);
-                    }
-                    if (bFit)
-                    {
-                        do_fit(isize, mass, xx[i2], x1);
-                    }
-                    rmsd = rmsdev(isize, mass, xx[i2], x1);
-                    set_mat_entry(rms, i1, i2, rmsd);
-                }
-                nrms -= nf - i1 - 1;
-                fprintf(stderr,
-                        "\r# RMSD calculations left: "
-                        "%" PRId64 "   ",
-                        nrms);
-                fflush(stderr);
+                free_whole_trj(&xx, nf);
             }
-            sfree(x1);
+            calc_rmsd_matrix(*frameStore, rms);
+            frameStore.reset();
         }
         else /* bRMSdist */
         {
             fprintf(stderr, "Computing %dx%d RMS distance deviation matrix\n", nf, nf);
+            nrms = (static_cast<int64_t>(nf) * static_cast<int64_t>(nf - 1)) / 2;
 
             /* Initiate work arrays */
             snew(d1, isize);
@@ -1320,31 +1772,40 @@ int gmx_cluster(int argc, char* argv[])
         }
         fprintf(stderr, "\n\n");
     }
-    ffprintf_gg(stderr, log, buf, "The RMSD ranges from %g to %g nm\n", rms->minrms, rms->maxrms);
-    ffprintf_g(stderr, log, buf, "Average RMSD is %g\n", 2 * rms->sumrms / (nf * (nf - 1)));
-    ffprintf_d(stderr, log, buf, "Number of structures for matrix %d\n", nf);
-    ffprintf_g(stderr, log, buf, "Energy of the matrix is %g.\n", mat_energy(rms));
-    if (bUseRmsdCut && (rmsdcut < rms->minrms || rmsdcut > rms->maxrms))
+    if (bSparse)
     {
-        fprintf(stderr,
-                "WARNING: rmsd cutoff %g is outside range of rmsd values "
-                "%g to %g\n",
-                rmsdcut,
-                rms->minrms,
-                rms->maxrms);
+        sprintf(buf, "Found %" PRId64 " pairs of structures within the cutoff\n", nrms);
+        ffprintf(stderr, log, buf);
+        ffprintf_d(stderr, log, buf, "Number of structures %d\n", nf);
     }
-    if (bAnalyze && (rmsmin < rms->minrms))
+    else
     {
-        fprintf(stderr, "WARNING: rmsd minimum %g is below lowest rmsd value %g\n", rmsmin, rms->minrms);
+        ffprintf_gg(stderr, log, buf, "The RMSD ranges from %g to %g nm\n", rms->minrms, rms->maxrms);
+        ffprintf_g(stderr, log, buf, "Average RMSD is %g\n", 2 * rms->sumrms / (nf * (nf - 1)));
+        ffprintf_d(stderr, log, buf, "Number of structures for matrix %d\n", nf);
+        ffprintf_g(stderr, log, buf, "Energy of the matrix is %g.\n", mat_energy(rms));
+        if (bUseRmsdCut && (rmsdcut < rms->minrms || rmsdcut > rms->maxrms))
+        {
+            fprintf(stderr,
+                    "WARNING: rmsd cutoff %g is outside range of rmsd values "
+                    "%g to %g\n",
+                    rmsdcut,
+                    rms->minrms,
+                    rms->maxrms);
+        }
+        if (bAnalyze && (rmsmin < rms->minrms))
+        {
+            fprintf(stderr, "WARNING: rmsd minimum %g is below lowest rmsd value %g\n", rmsmin, rms->minrms);
+        }
+
+        /* Plot the rmsd distribution */
+        rmsd_distribution(opt2fn("-dist", NFILE, fnm), rms, oenv);
     }
     if (bAnalyze && (rmsmin > rmsdcut))
     {
         fprintf(stderr, "WARNING: rmsd minimum %g is above rmsd cutoff %g\n", rmsmin, rmsdcut);
     }
 
-    /* Plot the rmsd distribution */
-    rmsd_distribution(opt2fn("-dist", NFILE, fnm), rms, oenv);
-
     if (bBinary)
     {
         for (i1 = 0; (i1 < nf); i1++)
@@ -1398,7 +1859,16 @@ int gmx_cluster(int argc, char* argv[])
         case m_jarvis_patrick:
             jarvis_patrick(rms->nn, rms->mat, M, P, bJP_RMSD ? rmsdcut : -1, &clust);
             break;
-        case m_gromos: gromos(rms->nn, rms->mat, rmsdcut, &clust); break;
+        case m_gromos:
+            if (bSparse)
+            {
+                gromos_neighbors(nf, nnb, &clust);
+            }
+            else
+            {
+                gromos(rms->nn, rms->mat, rmsdcut, &clust);
+            }
+            break;
         default: gmx_fatal(FARGS, "DEATH HORROR unknown method \"%s\"", methodname[0]);
     }
 
@@ -1409,13 +1879,16 @@ int gmx_cluster(int argc, char* argv[])
 
     if (bAnalyze)
     {
-        if (minstruct > 1)
-        {
-            ncluster = plot_clusters(nf, rms->mat, &clust, minstruct);
-        }
-        else
+        if (!bSparse)
         {
-            mark_clusters(nf, rms->mat, rms->maxrms, &clust);
+            if (minstruct > 1)
+            {
+                ncluster = plot_clusters(nf, rms->mat, &clust, minstruct);
+            }
+            else
+            {
+                mark_clusters(nf, rms->mat, rms->maxrms, &clust);
+            }
         }
         init_t_atoms(&useatoms, isize, FALSE);
         snew(usextps, isize);
@@ -1428,9 +1901,18 @@ int gmx_cluster(int argc, char* argv[])
             copy_rvec(xtps[index[i]], usextps[i]);
         }
         useatoms.nr = isize;
+        std::function<real(int, int)> clusterRmsd;
+        if (bSparse)
+        {
+            clusterRmsd = [&frameStore](int a, int b) { return frameStore->rmsd(a, b); };
+        }
+        else
+        {
+            clusterRmsd = [rms](int a, int b) { return rms->mat[a][b]; };
+        }
         analyze_clusters(nf,
                          &clust,
-                         rms->mat,
+                         clusterRmsd,
                          isize,
                          &useatoms,
                          usextps,
@@ -1478,68 +1960,22 @@ int gmx_cluster(int argc, char* argv[])
         }
     }
 
-    fp = opt2FILE("-o", NFILE, fnm, "w");
-    fprintf(stderr, "Writing rms distance/clustering matrix ");
-    if (bReadMat)
+    if (!bSparse)
     {
-        write_xpm(fp,
-                  0,
-                  readmat[0].title,
-                  readmat[0].legend,
-                  readmat[0].label_x,
-                  readmat[0].label_y,
-                  nf,
-                  nf,
-                  readmat[0].axis_x.data(),
-                  readmat[0].axis_y.data(),
-                  rms->mat,
-                  0.0,
-                  rms->maxrms,
-                  rlo_top,
-                  rhi_top,
-                  &nlevels);
-    }
-    else
-    {
-        auto timeLabel = output_env_get_time_label(oenv);
-        auto title = gmx::formatString("RMS%sDeviation / Cluster Index", bRMSdist ? " Distance " : " ");
-        if (minstruct > 1)
-        {
-            write_xpm_split(fp,
-                            0,
-                            title,
-                            "RMSD (nm)",
-                            timeLabel,
-                            timeLabel,
-                            nf,
-                            nf,
-                            time,
-                            time,
-                            rms->mat,
-                            0.0,
-                            rms->maxrms,
-                            &nlevels,
-                            rlo_top,
-                            rhi_top,
-                            0.0,
-                            ncluster,
-                            &ncluster,
-                            TRUE,
-                            rlo_bot,
-                            rhi_bot);
-        }
-        else
+        fp = opt2FILE("-o", NFILE, fnm, "w");
+        fprintf(stderr, "Writing rms distance/clustering matrix ");
+        if (bReadMat)
         {
             write_xpm(fp,
                       0,
-                      title,
-                      "RMSD (nm)",
-                      timeLabel,
-                      timeLabel,
+                      readmat[0].title,
+                      readmat[0].legend,
+                      readmat[0].label_x,
+                      readmat[0].label_y,
                       nf,
                       nf,
-                      time,
-                      time,
+                      readmat[0].axis_x.data(),
+                      readmat[0].axis_y.data(),
                       rms->mat,
                       0.0,
                       rms->maxrms,
@@ -1547,9 +1983,58 @@ int gmx_cluster(int argc, char* argv[])
                       rhi_top,
                       &nlevels);
         }
+        else
+        {
+            auto timeLabel = output_env_get_time_label(oenv);
+            auto title = gmx::formatString("RMS%sDeviation / Cluster Index", bRMSdist ? " Distance " : " ");
+            if (minstruct > 1)
+            {
+                write_xpm_split(fp,
+                                0,
+                                title,
+                                "RMSD (nm)",
+                                timeLabel,
+                                timeLabel,
+                                nf,
+                                nf,
+                                time,
+                                time,
+                                rms->mat,
+                                0.0,
+                                rms->maxrms,
+                                &nlevels,
+                                rlo_top,
+                                rhi_top,
+                                0.0,
+                                ncluster,
+                                &ncluster,
+                                TRUE,
+                                rlo_bot,
+                                rhi_bot);
+            }
+            else
+            {
+                write_xpm(fp,
+                          0,
+                          title,
+                          "RMSD (nm)",
+                          timeLabel,
+                          timeLabel,
+                          nf,
+                          nf,
+                          time,
+                          time,
+                          rms->mat,
+                          0.0,
+                          rms->maxrms,
+                          rlo_top,
+                          rhi_top,
+                          &nlevels);
+            }
+        }
+        fprintf(stderr, "\n");
+        gmx_ffclose(fp);
     }
-    fprintf(stderr, "\n");
-    gmx_ffclose(fp);
     if (nullptr != orig)
     {
         fp             = opt2FILE("-om", NFILE, fnm, "w");
@@ -1576,13 +2061,19 @@ int gmx_cluster(int argc, char* argv[])
         sfree(orig);
     }
     /* now show what we've done */
-    do_view(oenv, opt2fn("-o", NFILE, fnm), "-nxy");
+    if (!bSparse)
+    {
+        do_view(oenv, opt2fn("-o", NFILE, fnm), "-nxy");
+    }
     do_view(oenv, opt2fn_null("-sz", NFILE, fnm), "-nxy");
     if (method == m_diagonalize)
     {
         do_view(oenv, opt2fn_null("-ev", NFILE, fnm), "-nxy");
     }
-    do_view(oenv, opt2fn("-dist", NFILE, fnm), "-nxy");
+    if (!bSparse)
+    {
+        do_view(oenv, opt2fn("-dist", NFILE, fnm), "-nxy");
+    }
     if (bAnalyze)
     {
         do_view(oenv, opt2fn_null("-tr", NFILE, fnm), "-nxy");
@@ -33,6 +33,8 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -42,6 +44,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <string>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/commandline/pargs.h"
@@ -61,6 +64,8 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
+#include "gromacs/random/normaldistribution.h"
+#include "gromacs/random/threefry.h"
 #include "gromacs/topology/atoms.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
@@ -71,6 +76,7 @@
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
@@ -112,6 +118,318 @@ void throwErrorIfIndexOutOfBounds(ArrayRef<const int> indices, const int numAtom
     }
 };
 
+//! Number of frames that are multiplied with the subspace basis in one blocked product
+constexpr int c_streamingFrameBlockSize = 32;
+//! Number of coordinates each thread processes at a time in the blocked products
+constexpr int64_t c_streamingCoordinateChunkSize = 512;
+//! Number of basis vectors added to the requested eigenvectors to speed up convergence
+constexpr int c_streamingOversampling = 10;
+//! Seed for the random starting basis, fixed to make the analysis reproducible
+constexpr uint64_t c_streamingRandomSeed = 1234567;
+
+/*! \brief Computes the largest eigenpairs of a covariance matrix without storing the matrix.
+ *
+ * The covariance matrix C = 1/n sum_f x_f x_f^T is only applied to a basis Q
+ * through products with blocks of frames, Y += X^T (X Q), so memory and time
+ * scale linearly with the number of degrees of freedom. The basis starts out
+ * random and is replaced by the orthonormalized product after each pass over
+ * the trajectory (randomized subspace iteration). After the last pass the
+ * eigenpairs are extracted with a Rayleigh-Ritz projection onto the basis.
+ *
+ * Each of the numVectors basis vectors is stored contiguously, so the
+ * products reduce to dot products and axpy operations over chunks of
+ * coordinates, which are distributed over the OpenMP threads.
+ */
+class StreamingCovarianceEigensolver
+{
+public:
+    /*! \brief Sets up a random basis
+     *
+     * \param[in] ndim        Number of degrees of freedom
+     * \param[in] numVectors  Number of basis vectors, at most \p ndim
+     */
+    StreamingCovarianceEigensolver(int64_t ndim, int numVectors);
+
+    //! Adds the (mass-weighted) deviations of a frame from the average to the current pass
+    void addFrame(ArrayRef<const RVec> deviations, ArrayRef<const real> sqrtm);
+    /*! \brief Finishes a pass over \p numFrames frames
+     *
+     * Unless this is the last pass, the basis is replaced by the
+     * orthonormalized product of the covariance matrix and the basis.
+     */
+    void finishPass(int numFrames, bool lastPass);
+    /*! \brief Extracts the largest eigenpairs after the last pass
+     *
+     * \param[in]  numEigenvectors Number of eigenpairs to return
+     * \param[out] eigenvalues     The eigenvalues in decreasing order
+     * \param[out] eigenvectors    The eigenvectors as rows of length ndim
+     * \returns The largest residual norm |Cv - lambda v| of the eigenvectors
+     */
+    double computeEigenpairs(int numEigenvectors, real* eigenvalues, real* eigenvectors) const;
+    //! Returns the trace of the covariance matrix of the last pass
+    double trace() const { return trace_; }
+
+private:
+    //! Multiplies the buffered block of frames with the basis and adds the result to the product
+    void multiplyFrameBlock();
+    //! Replaces the basis by the orthonormalized product
+    void orthonormalizeProduct();
+    //! Returns the dot product of two vectors of length ndim_
+    double dot(const double* a, const double* b) const;
+
+    //! Number of degrees of freedom
+    int64_t ndim_;
+    //! Number of basis vectors
+    int numVectors_;
+    //! The orthonormal basis, vector after vector
+    std::vector<double> basis_;
+    //! The product of the covariance matrix and the basis, vector after vector
+    std::vector<double> product_;
+    //! Buffered deviations of up to c_streamingFrameBlockSize frames
+    std::vector<double> frameBlock_;
+    //! Number of frames in frameBlock_
+    int numFramesInBlock_ = 0;
+    //! Projections of the buffered frames on the basis, per thread
+    std::vector<std::vector<double>> threadProjections_;
+    //! Sum of the squared deviations over the frames of the current pass
+    double sumSquaredDeviations_ = 0;
+    //! Trace of the covariance matrix of the last finished pass
+    double trace_ = 0;
+};
+
+StreamingCovarianceEigensolver::StreamingCovarianceEigensolver(int64_t ndim, int numVectors) :
+    ndim_(ndim),
+    numVectors_(numVectors),
+    basis_(ndim * numVectors),
+    product_(ndim * numVectors, 0.0),
+    frameBlock_(ndim * c_streamingFrameBlockSize),
+    threadProjections_(gmx_omp_get_max_threads(),
+                       std::vector<double>(c_streamingFrameBlockSize * numVectors))
+{
+    DefaultRandomEngine        rng(c_streamingRandomSeed);
+    NormalDistribution<double> normalDist;
+    for (double& value : basis_)
+    {
+        value = normalDist(rng);
+    }
+    // Orthonormalize the random start vectors
+    std::swap(basis_, product_);
+    orthonormalizeProduct();
+}
+
+void StreamingCovarianceEigensolver::addFrame(ArrayRef<const RVec> deviations, ArrayRef<const real> sqrtm)
+{
+    double* frame = frameBlock_.data() + numFramesInBlock_ * ndim_;
+    for (Index i = 0; i < deviations.ssize(); i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            const double value     = deviations[i][d] * sqrtm[i];
+            frame[DIM * i + d]     = value;
+            sumSquaredDeviations_ += value * value;
+        }
+    }
+    numFramesInBlock_++;
+    if (numFramesInBlock_ == c_streamingFrameBlockSize)
+    {
+        multiplyFrameBlock();
+    }
+}
+
+void StreamingCovarianceEigensolver::multiplyFrameBlock()
+{
+    const int     numFrames  = numFramesInBlock_;
+    const int     numVectors = numVectors_;
+    const int64_t numChunks  = (ndim_ + c_streamingCoordinateChunkSize - 1) / c_streamingCoordinateChunkSize;
+
+    // Projections W = X Q^T, accumulated per thread over chunks of coordinates.
+    // The team can be smaller than requested, so only the buffers of the
+    // threads that took part are summed.
+    const int numThreads     = threadProjections_.size();
+    int       numThreadsUsed = 0;
+#pragma omp parallel num_threads(numThreads)
+    {
+        try
+        {
+#pragma omp atomic
+            numThreadsUsed++;
+            std::vector<double>& projections = threadProjections_[gmx_omp_get_thread_num()];
+            std::fill(projections.begin(), projections.end(), 0.0);
+#pragma omp for schedule(static)
+            for (int64_t chunk = 0; chunk < numChunks; chunk++)
+            {
+                const int64_t begin = chunk * c_streamingCoordinateChunkSize;
+                const int64_t end   = std::min(begin + c_streamingCoordinateChunkSize, ndim_);
+                for (int f = 0; f < numFrames; f++)
+                {
+                    const double* frame = frameBlock_.data() + f * ndim_;
+                    for (int v = 0; v < numVectors; v++)
+                    {
+                        const double* vector = basis_.data() + v * ndim_;
+                        double        sum    = 0;
+                        for (int64_t i = begin; i < end; i++)
+                        {
+                            sum += frame[i] * vector[i];
+                        }
+                        projections[f * numVectors + v] += sum;
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    std::vector<double>& projections = threadProjections_[0];
+    for (int t = 1; t < numThreadsUsed; t++)
+    {
+        for (std::size_t k = 0; k < projections.size(); k++)
+        {
+            projections[k] += threadProjections_[t][k];
+        }
+    }
+
+    // Product Y += X^T W, each thread updating its own chunks of coordinates
+#pragma omp parallel for schedule(static)
+    for (int64_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        try
+        {
+            const int64_t begin = chunk * c_streamingCoordinateChunkSize;
+            const int64_t end   = std::min(begin + c_streamingCoordinateChunkSize, ndim_);
+            for (int v = 0; v < numVectors; v++)
+            {
+                double* product = product_.data() + v * ndim_;
+                for (int f = 0; f < numFrames; f++)
+                {
+                    const double* frame      = frameBlock_.data() + f * ndim_;
+                    const double  projection = projections[f * numVectors + v];
+                    for (int64_t i = begin; i < end; i++)
+                    {
+                        product[i] += projection * frame[i];
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    numFramesInBlock_ = 0;
+}
+
+double StreamingCovarianceEigensolver::dot(const double* a, const double* b) const
+{
+    double sum = 0;
+#pragma omp parallel for reduction(+ : sum) schedule(static)
+    for (int64_t i = 0; i < ndim_; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void StreamingCovarianceEigensolver::orthonormalizeProduct()
+{
+    // Gram-Schmidt, repeated once to restore orthogonality lost to rounding
+    for (int v = 0; v < numVectors_; v++)
+    {
+        double*      vector        = product_.data() + v * ndim_;
+        const double originalNorm2 = dot(vector, vector);
+        for (int repeat = 0; repeat < 2; repeat++)
+        {
+            for (int p = 0; p < v; p++)
+            {
+                const double* previous = product_.data() + p * ndim_;
+                const double  overlap  = dot(previous, vector);
+#pragma omp parallel for schedule(static)
+                for (int64_t i = 0; i < ndim_; i++)
+                {
+                    vector[i] -= overlap * previous[i];
+                }
+            }
+        }
+        const double norm2 = dot(vector, vector);
+        // A vector in the span of the previous ones carries no information,
+        // which happens when there are fewer frames than basis vectors
+        const double scale = (norm2 > 1e-20 * originalNorm2 && norm2 > 0) ? 1 / std::sqrt(norm2) : 0;
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < ndim_; i++)
+        {
+            vector[i] *= scale;
+        }
+    }
+    std::swap(basis_, product_);
+    std::fill(product_.begin(), product_.end(), 0.0);
+}
+
+void StreamingCovarianceEigensolver::finishPass(int numFrames, bool lastPass)
+{
+    if (numFramesInBlock_ > 0)
+    {
+        multiplyFrameBlock();
+    }
+    const double invNumFrames = 1.0 / numFrames;
+    for (double& value : product_)
+    {
+        value *= invNumFrames;
+    }
+    trace_                = sumSquaredDeviations_ * invNumFrames;
+    sumSquaredDeviations_ = 0;
+    if (!lastPass)
+    {
+        orthonormalizeProduct();
+    }
+}
+
+double StreamingCovarianceEigensolver::computeEigenpairs(int   numEigenvectors,
+                                                         real* eigenvalues,
+                                                         real* eigenvectors) const
+{
+    const int n = numVectors_;
+
+    // Rayleigh-Ritz: the projection Q^T C Q of the covariance matrix on the basis
+    std::vector<real> projected(n * n);
+    for (int a = 0; a < n; a++)
+    {
+        for (int b = a; b < n; b++)
+        {
+            const double* basisA   = basis_.data() + a * ndim_;
+            const double* basisB   = basis_.data() + b * ndim_;
+            const double* productA = product_.data() + a * ndim_;
+            const double* productB = product_.data() + b * ndim_;
+            const real    value    = 0.5 * (dot(basisA, productB) + dot(basisB, productA));
+            projected[a * n + b]   = value;
+            projected[b * n + a]   = value;
+        }
+    }
+    std::vector<real> ritzValues(n);
+    std::vector<real> ritzVectors(n * n);
+    eigensolver(projected.data(), n, 0, n, ritzValues.data(), ritzVectors.data());
+
+    // The eigenvectors are Q u and, since C Q = Y, C Q u = Y u
+    double              maxResidual = 0;
+    std::vector<double> residual(ndim_);
+    for (int m = 0; m < numEigenvectors; m++)
+    {
+        const int   ritz         = n - 1 - m;
+        const real* coefficients = ritzVectors.data() + ritz * n;
+        real*       eigenvector  = eigenvectors + m * ndim_;
+        eigenvalues[m]           = ritzValues[ritz];
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < ndim_; i++)
+        {
+            double vectorValue  = 0;
+            double productValue = 0;
+            for (int v = 0; v < n; v++)
+            {
+                vectorValue += coefficients[v] * basis_[v * ndim_ + i];
+                productValue += coefficients[v] * product_[v * ndim_ + i];
+            }
+            eigenvector[i] = vectorValue;
+            residual[i]    = productValue - ritzValues[ritz] * vectorValue;
+        }
+        maxResidual = std::max(maxResidual, std::sqrt(dot(residual.data(), residual.data())));
+    }
+    return maxResidual;
+}
+
 } // namespace
 
 } // namespace gmx
@@ -150,10 +468,21 @@ int gmx_covar(int argc, char* argv[])
         "of atoms involved. It is easy to run out of memory, in which",
         "case this tool will probably exit with a 'Segmentation fault'. You",
         "should consider carefully whether a reduced set of atoms will meet",
-        "your needs for lower costs."
+        "your needs for lower costs.",
+        "[PAR]",
+        "For large systems, option [TT]-nev[tt] computes only the given number",
+        "of largest eigenvalues and eigenvectors with a randomized subspace",
+        "iteration. The covariance matrix is then never stored: the trajectory",
+        "is read [TT]-niter[tt] times and each block of frames is multiplied",
+        "with the current subspace, so memory and time only increase linearly",
+        "with the number of atoms. The largest residual norm of the eigenvectors",
+        "is reported in the log file, more iterations reduce it.",
+        "The products are computed in parallel with [TT]-nt[tt] threads.",
+        "Options [TT]-ascii[tt], [TT]-xpm[tt] and [TT]-xpma[tt] need the full",
+        "matrix and can not be used with [TT]-nev[tt]."
     };
     static gmx_bool bFit = TRUE, bRef = FALSE, bM = FALSE, bPBC = TRUE;
-    static int      end  = -1;
+    static int      end  = -1, nev = 0, niter = 4, nthreads = -1;
     t_pargs         pa[] = {
         { "-fit", FALSE, etBOOL, { &bFit }, "Fit to a reference structure" },
         { "-ref",
@@ -164,7 +493,16 @@ int gmx_covar(int argc, char* argv[])
           "average" },
         { "-mwa", FALSE, etBOOL, { &bM }, "Mass-weighted covariance analysis" },
         { "-last", FALSE, etINT, { &end }, "Last eigenvector to write away (-1 is till the last)" },
-        { "-pbc", FALSE, etBOOL, { &bPBC }, "Apply corrections for periodic boundary conditions" }
+        { "-pbc", FALSE, etBOOL, { &bPBC }, "Apply corrections for periodic boundary conditions" },
+        { "-nev",
+          FALSE,
+          etINT,
+          { &nev },
+          "Compute only this many eigenvectors without storing the covariance matrix (0: all)" },
+        { "-niter", FALSE, etINT, { &niter }, "Number of passes over the trajectory for [TT]-nev[tt]" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to start" },
+#endif
     };
     FILE*             out = nullptr; /* initialization makes all compilers happy */
     t_trxstatus*      status;
@@ -173,11 +511,12 @@ int gmx_covar(int argc, char* argv[])
     t_atoms*          atoms;
     rvec *            x, *xread, *xref, *xav, *xproj;
     matrix            box, zerobox;
-    real *            sqrtm, *mat, *eigenvalues, sum, trace, inv_nframes;
-    real              t, tstart, tend, **mat2;
+    real *            sqrtm, *mat = nullptr, *eigenvalues = nullptr, sum, trace = 0, inv_nframes;
+    real              t, tstart = 0, tend = 0, **mat2;
+    double            residual = 0;
     real              xj, *w_rls = nullptr;
     real              min, max, *axis;
-    int               natoms, nat, nframes0, nframes, nlevels;
+    int               natoms, nat, nframes0, nframes = 0, nlevels;
     int64_t           ndim, i, j, k, l;
     int               WriteXref;
     const char *      fitfile, *trxfile, *ndxfile;
@@ -186,7 +525,7 @@ int gmx_covar(int argc, char* argv[])
     char *            fitname, *ananame;
     int               d, dj, nfit;
     int *             index, *ifit;
-    gmx_bool          bDiffMass1, bDiffMass2;
+    gmx_bool          bDiffMass1, bDiffMass2, bStream;
     t_rgb             rlo, rmi, rhi;
     real*             eigenvectors;
     gmx_output_env_t* oenv;
@@ -201,12 +540,16 @@ int gmx_covar(int argc, char* argv[])
     };
 #define NFILE asize(fnm)
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(
                 &argc, argv, PCA_CAN_TIME | PCA_TIME_UNIT, NFILE, fnm, asize(pa), pa, asize(desc), desc, 0, nullptr, &oenv))
     {
         return 0;
     }
 
+    gmx_omp_set_num_threads(nthreads);
+
     clear_mat(zerobox);
 
     fitfile    = ftp2fn(efTPS, NFILE, fnm);
@@ -220,6 +563,18 @@ int gmx_covar(int argc, char* argv[])
     xpmfile    = opt2fn_null("-xpm", NFILE, fnm);
     xpmafile   = opt2fn_null("-xpma", NFILE, fnm);
 
+    bStream = (nev > 0);
+    if (bStream && (asciifile || xpmfile || xpmafile))
+    {
+        gmx_fatal(FARGS,
+                  "Options -ascii, -xpm and -xpma need the full covariance matrix and can not be "
+                  "used with -nev\n");
+    }
+    if (bStream && niter < 1)
+    {
+        gmx_fatal(FARGS, "Need at least one pass over the trajectory (-niter)\n");
+    }
+
     read_tps_conf(fitfile, &top, &pbcType, &xref, nullptr, box, TRUE);
     atoms = &top.atoms;
 
@@ -312,11 +667,14 @@ int gmx_covar(int argc, char* argv[])
     snew(x, natoms);
     snew(xav, natoms);
     ndim = natoms * DIM;
-    if (std::sqrt(static_cast<real>(INT64_MAX)) < static_cast<real>(ndim))
+    if (!bStream)
     {
-        gmx_fatal(FARGS, "Number of degrees of freedoms to large for matrix.\n");
+        if (std::sqrt(static_cast<real>(INT64_MAX)) < static_cast<real>(ndim))
+        {
+            gmx_fatal(FARGS, "Number of degrees of freedoms to large for matrix.\n");
+        }
+        snew(mat, ndim * ndim);
     }
-    snew(mat, ndim * ndim);
 
     fprintf(stderr, "Calculating the average structure ...\n");
     nframes0 = 0;
@@ -369,18 +727,9 @@ int gmx_covar(int argc, char* argv[])
             opt2fn("-av", NFILE, fnm), "Average structure", atoms, xread, nullptr, PbcType::No, zerobox, natoms, index);
     sfree(xread);
 
-    fprintf(stderr,
-            "Constructing covariance matrix (%dx%d) ...\n",
-            static_cast<int>(ndim),
-            static_cast<int>(ndim));
-    nframes = 0;
-    nat     = read_first_x(oenv, &status, trxfile, &t, &xread, box);
-    tstart  = t;
-    do
+    /* calculate x: the deviation of the (fitted) structure of the selected atoms */
+    auto calculateDeviations = [&]()
     {
-        nframes++;
-        tend = t;
-        /* calculate x: a (fitted) structure of the selected atoms */
         if (bPBC)
         {
             gmx_rmpbc_apply(gpbc, nat, box, xread);
@@ -392,37 +741,89 @@ int gmx_covar(int argc, char* argv[])
         }
         if (bRef)
         {
-            for (i = 0; i < natoms; i++)
+            for (int i = 0; i < natoms; i++)
             {
                 rvec_sub(xread[index[i]], xref[index[i]], x[i]);
             }
         }
         else
         {
-            for (i = 0; i < natoms; i++)
+            for (int i = 0; i < natoms; i++)
             {
                 rvec_sub(xread[index[i]], xav[i], x[i]);
             }
         }
+    };
 
-        for (j = 0; j < natoms; j++)
+    if (bStream)
+    {
+        nev                  = std::min<int64_t>(nev, ndim);
+        const int numVectors = std::min<int64_t>(nev + gmx::c_streamingOversampling, ndim);
+        fprintf(stderr,
+                "Computing %d eigenvectors of the covariance matrix (%dx%d) in %d passes ...\n",
+                nev,
+                static_cast<int>(ndim),
+                static_cast<int>(ndim),
+                niter);
+        gmx::StreamingCovarianceEigensolver solver(ndim, numVectors);
+        for (int pass = 0; pass < niter; pass++)
         {
-            for (dj = 0; dj < DIM; dj++)
+            nframes = 0;
+            nat     = read_first_x(oenv, &status, trxfile, &t, &xread, box);
+            tstart  = t;
+            do
             {
-                k  = ndim * (DIM * j + dj);
-                xj = x[j][dj];
-                for (i = j; i < natoms; i++)
+                nframes++;
+                tend = t;
+                calculateDeviations();
+                solver.addFrame(gmx::constArrayRefFromArray(reinterpret_cast<const gmx::RVec*>(x), natoms),
+                                gmx::constArrayRefFromArray(sqrtm, natoms));
+            } while (read_next_x(oenv, status, &t, xread, box) && (bRef || nframes < nframes0));
+            close_trx(status);
+            sfree(xread);
+            solver.finishPass(nframes, pass == niter - 1);
+        }
+        trace = solver.trace();
+        fprintf(stderr, "\nTrace of the covariance matrix: %g (%snm^2)\n", trace, bM ? "u " : "");
+
+        snew(eigenvalues, nev);
+        snew(mat, nev * ndim);
+        residual = solver.computeEigenpairs(nev, eigenvalues, mat);
+    }
+    else
+    {
+        fprintf(stderr,
+                "Constructing covariance matrix (%dx%d) ...\n",
+                static_cast<int>(ndim),
+                static_cast<int>(ndim));
+        nframes = 0;
+        nat     = read_first_x(oenv, &status, trxfile, &t, &xread, box);
+        tstart  = t;
+        do
+        {
+            nframes++;
+            tend = t;
+            calculateDeviations();
+
+            for (j = 0; j < natoms; j++)
+            {
+                for (dj = 0; dj < DIM; dj++)
                 {
-                    l = k + DIM * i;
-                    for (d = 0; d < DIM; d++)
+                    k  = ndim * (DIM * j + dj);
+                    xj = x[j][dj];
+                    for (i = j; i < natoms; i++)
                     {
-                        mat[l + d] += x[i][d] * xj;
+                        l = k + DIM * i;
+                        for (d = 0; d < DIM; d++)
+                        {
+                            mat[l + d] += x[i][d] * xj;
+                        }
                     }
                 }
             }
-        }
-    } while (read_next_x(oenv, status, &t, xread, box) && (bRef || nframes < nframes0));
-    close_trx(status);
+        } while (read_next_x(oenv, status, &t, xread, box) && (bRef || nframes < nframes0));
+        close_trx(status);
+    }
     gmx_rmpbc_done(gpbc);
 
     fprintf(stderr, "Read %d frames\n", nframes);
@@ -441,38 +842,41 @@ int gmx_covar(int argc, char* argv[])
         xproj = xav;
     }
 
-    /* correct the covariance matrix for the mass */
-    inv_nframes = 1.0 / nframes;
-    for (j = 0; j < natoms; j++)
+    if (!bStream)
     {
-        for (dj = 0; dj < DIM; dj++)
+        /* correct the covariance matrix for the mass */
+        inv_nframes = 1.0 / nframes;
+        for (j = 0; j < natoms; j++)
         {
-            for (i = j; i < natoms; i++)
+            for (dj = 0; dj < DIM; dj++)
             {
-                k = ndim * (DIM * j + dj) + DIM * i;
-                for (d = 0; d < DIM; d++)
+                for (i = j; i < natoms; i++)
                 {
-                    mat[k + d] = mat[k + d] * inv_nframes * sqrtm[i] * sqrtm[j];
+                    k = ndim * (DIM * j + dj) + DIM * i;
+                    for (d = 0; d < DIM; d++)
+                    {
+                        mat[k + d] = mat[k + d] * inv_nframes * sqrtm[i] * sqrtm[j];
+                    }
                 }
             }
         }
-    }
 
-    /* symmetrize the matrix */
-    for (j = 0; j < ndim; j++)
-    {
-        for (i = j; i < ndim; i++)
+        /* symmetrize the matrix */
+        for (j = 0; j < ndim; j++)
         {
-            mat[ndim * i + j] = mat[ndim * j + i];
+            for (i = j; i < ndim; i++)
+            {
+                mat[ndim * i + j] = mat[ndim * j + i];
+            }
         }
-    }
 
-    trace = 0;
-    for (i = 0; i < ndim; i++)
-    {
-        trace += mat[i * ndim + i];
+        trace = 0;
+        for (i = 0; i < ndim; i++)
+        {
+            trace += mat[i * ndim + i];
+        }
+        fprintf(stderr, "\nTrace of the covariance matrix: %g (%snm^2)\n", trace, bM ? "u " : "");
     }
-    fprintf(stderr, "\nTrace of the covariance matrix: %g (%snm^2)\n", trace, bM ? "u " : "");
 
     if (asciifile)
     {
@@ -619,35 +1023,53 @@ int gmx_covar(int argc, char* argv[])
     }
 
 
-    /* call diagonalization routine */
+    if (bStream)
+    {
+        sum = 0;
+        for (i = 0; i < nev; i++)
+        {
+            sum += eigenvalues[i];
+        }
+        fprintf(stderr,
+                "\nSum of the %d largest eigenvalues: %g (%snm^2), %.1f%% of the trace\n",
+                nev,
+                sum,
+                bM ? "u " : "",
+                trace > 0 ? 100 * sum / trace : 0.0);
+        fprintf(stderr, "Largest residual norm of the eigenvectors: %g (%snm^2)\n", residual, bM ? "u " : "");
+    }
+    else
+    {
+        /* call diagonalization routine */
 
-    snew(eigenvalues, ndim);
-    snew(eigenvectors, ndim * ndim);
+        snew(eigenvalues, ndim);
+        snew(eigenvectors, ndim * ndim);
 
-    std::memcpy(eigenvectors, mat, ndim * ndim * sizeof(real));
-    fprintf(stderr, "\nDiagonalizing ...\n");
-    fflush(stderr);
-    eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
-    sfree(eigenvectors);
+        std::memcpy(eigenvectors, mat, ndim * ndim * sizeof(real));
+        fprintf(stderr, "\nDiagonalizing ...\n");
+        fflush(stderr);
+        eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
+        sfree(eigenvectors);
 
-    /* now write the output */
+        /* now write the output */
 
-    sum = 0;
-    for (i = 0; i < ndim; i++)
-    {
-        sum += eigenvalues[i];
-    }
-    fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n", sum, bM ? "u " : "");
-    if (std::abs(trace - sum) > 0.01 * trace)
-    {
-        fprintf(stderr,
-                "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
+        sum = 0;
+        for (i = 0; i < ndim; i++)
+        {
+            sum += eigenvalues[i];
+        }
+        fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n", sum, bM ? "u " : "");
+        if (std::abs(trace - sum) > 0.01 * trace)
+        {
+            fprintf(stderr,
+                    "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
+        }
     }
 
     /* Set 'end', the maximum eigenvector and -value index used for output */
     if (end == -1)
     {
-        if (nframes - 1 < ndim)
+        if (nframes - 1 < (bStream ? nev : ndim))
         {
             end = nframes - 1;
             fprintf(stderr, "\nWARNING: there are fewer frames in your trajectory than there are\n");
@@ -656,9 +1078,13 @@ int gmx_covar(int argc, char* argv[])
         }
         else
         {
-            end = ndim;
+            end = bStream ? nev : ndim;
         }
     }
+    else if (bStream)
+    {
+        end = std::min(end, nev);
+    }
 
     fprintf(stderr, "\nWriting eigenvalues to %s\n", eigvalfile);
 
@@ -666,7 +1092,7 @@ int gmx_covar(int argc, char* argv[])
     out = xvgropen(eigvalfile, "Eigenvalues of the covariance matrix", "Eigenvector index", str, oenv);
     for (i = 0; (i < end); i++)
     {
-        fprintf(out, "%10d %g\n", static_cast<int>(i + 1), eigenvalues[ndim - 1 - i]);
+        fprintf(out, "%10d %g\n", static_cast<int>(i + 1), bStream ? eigenvalues[i] : eigenvalues[ndim - 1 - i]);
     }
     xvgrclose(out);
 
@@ -692,8 +1118,9 @@ int gmx_covar(int argc, char* argv[])
         WriteXref = eWXR_NOFIT;
     }
 
+    /* The streaming eigenvectors are stored in decreasing order, the others in increasing order */
     write_eigenvectors(
-            eigvecfile, natoms, mat, TRUE, 1, end, WriteXref, x, bDiffMass1, xproj, bM, eigenvalues);
+            eigvecfile, natoms, mat, !bStream, 1, end, WriteXref, x, bDiffMass1, xproj, bM, eigenvalues);
 
     out = gmx_ffopen(logfile, "w");
 
@@ -735,9 +1162,25 @@ int gmx_covar(int argc, char* argv[])
     {
         fprintf(out, "Fit is %smass weighted\n", bDiffMass1 ? "" : "non-");
     }
-    fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim), static_cast<int>(ndim));
-    fprintf(out, "Trace of the covariance matrix before diagonalizing: %g\n", trace);
-    fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n", sum);
+    if (bStream)
+    {
+        fprintf(out,
+                "Computed the %d largest eigenvalues of the %dx%d covariance matrix\n"
+                "with %d passes of randomized subspace iteration\n",
+                nev,
+                static_cast<int>(ndim),
+                static_cast<int>(ndim),
+                niter);
+        fprintf(out, "Trace of the covariance matrix: %g\n", trace);
+        fprintf(out, "Sum of the computed eigenvalues: %g\n", sum);
+        fprintf(out, "Largest residual norm of the eigenvectors: %g\n\n", residual);
+    }
+    else
+    {
+        fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim), static_cast<int>(ndim));
+        fprintf(out, "Trace of the covariance matrix before diagonalizing: %g\n", trace);
+        fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n", sum);
+    }
 
     fprintf(out, "Wrote %d eigenvalues to %s\n", static_cast<int>(end), eigvalfile);
     if (WriteXref == eWXR_YES)
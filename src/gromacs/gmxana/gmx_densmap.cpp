@@ -33,12 +33,16 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cmath>
 #include <cstdio>
 #include <cstring>
 
+#include <algorithm>
 #include <filesystem>
 #include <string>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/commandline/pargs.h"
@@ -63,9 +67,12 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 
+#include "densitygrid.h"
+
 struct gmx_output_env_t;
 
 int gmx_densmap(int argc, char* argv[])
@@ -103,11 +110,16 @@ int gmx_densmap(int argc, char* argv[])
         "Option [TT]count[tt] produces the count for each grid cell.",
         "When you do not want the scale in the output to go",
         "from zero to the maximum density, you can set the maximum",
-        "with the option [TT]-dmax[tt]."
+        "with the option [TT]-dmax[tt].",
+        "[PAR]",
+        "The atoms of each frame are binned by multiple threads into private grids,",
+        "which are summed after the last frame. The number of threads is set",
+        "with [TT]-nt[tt]."
     };
     static int         n1 = 0, n2 = 0;
     static real        xmin = -1, xmax = -1, bin = 0.02, dmin = 0, dmax = 0, amax = 0, rmax = 0;
     static gmx_bool    bMirror = FALSE, bSums = FALSE;
+    static int         nthreads = -1;
     static const char* eaver[] = { nullptr, "z", "y", "x", nullptr };
     static const char* eunit[] = { nullptr, "nm-3", "nm-2", "count", nullptr };
 
@@ -125,6 +137,9 @@ int gmx_densmap(int argc, char* argv[])
         { "-unit", FALSE, etENUM, { eunit }, "Unit for the output" },
         { "-dmin", FALSE, etREAL, { &dmin }, "Minimum density in output" },
         { "-dmax", FALSE, etREAL, { &dmax }, "Maximum density in output (0 means calculate it)" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to bin with" },
+#endif
     };
     gmx_bool          bXmin, bXmax, bRadial;
     FILE*             fp;
@@ -156,11 +171,15 @@ int gmx_densmap(int argc, char* argv[])
 
     npargs = asize(pa);
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(
                 &argc, argv, PCA_CAN_TIME | PCA_CAN_VIEW, NFILE, fnm, npargs, pa, asize(desc), desc, 0, nullptr, &oenv))
     {
         return 0;
     }
+    nthreads = std::max(nthreads, 1);
+    gmx_omp_set_num_threads(nthreads);
 
     bXmin   = opt2parg_bSet("-xmin", npargs, pa);
     bXmax   = opt2parg_bSet("-xmax", npargs, pa);
@@ -272,17 +291,17 @@ int gmx_densmap(int argc, char* argv[])
         }
     }
 
-    snew(grid, n1);
-    for (i = 0; i < n1; i++)
-    {
-        snew(grid[i], n2);
-    }
+    /* The two map directions are the x and y lattice directions of the accumulator */
+    gmx::DensityGridAccumulator accumulator(gmx::IVec(n1, n2, 1), 0, nthreads);
+    std::vector<gmx::RVec>      latticePositions;
+    latticePositions.reserve(nindex);
 
     box1 = 0;
     box2 = 0;
     nfr  = 0;
     do
     {
+        latticePositions.clear();
         if (!bRadial)
         {
             box1 += box[c1][c1];
@@ -319,9 +338,10 @@ int gmx_densmap(int argc, char* argv[])
                     {
                         m2 += 1;
                     }
-                    grid[static_cast<int>(m1 * n1)][static_cast<int>(m2 * n2)] += invcellvol;
+                    latticePositions.emplace_back(m1 * n1, m2 * n2, 0);
                 }
             }
+            accumulator.add(latticePositions, invcellvol);
         }
         else
         {
@@ -369,14 +389,26 @@ int gmx_densmap(int argc, char* argv[])
                     {
                         r += rmax;
                     }
-                    grid[static_cast<int>((axial + amax) * invspa)][static_cast<int>(r * invspz)] += 1;
+                    latticePositions.emplace_back((axial + amax) * invspa, r * invspz, 0);
                 }
             }
+            accumulator.add(latticePositions, 1);
         }
         nfr++;
     } while (read_next_x(oenv, status, &t, x, box));
     close_trx(status);
 
+    const auto& sum = accumulator.result();
+    snew(grid, n1);
+    for (i = 0; i < n1; i++)
+    {
+        snew(grid[i], n2);
+        for (j = 0; j < n2; j++)
+        {
+            grid[i][j] = sum(0, j, i);
+        }
+    }
+
     /* normalize gridpoints */
     maxgrid = 0;
     if (!bRadial)
@@ -1865,6 +1865,7 @@ int gmx_energy(int argc, char* argv[])
     real                     Vaver;
     int *                    set     = nullptr, i, j, nset, sss;
     gmx_bool*                bIsEner = nullptr;
+    gmx_bool*                bReadTerm;
     std::vector<std::string> leg;
     char                     buf[256];
     gmx_output_env_t*        oenv;
@@ -2009,6 +2010,13 @@ int gmx_energy(int argc, char* argv[])
         get_dhdl_parms(ftp2fn(efTPR, NFILE, fnm), ir);
     }
 
+    /* Only the selected energy terms are read from the file */
+    snew(bReadTerm, nre);
+    for (i = 0; i < nset; i++)
+    {
+        bReadTerm[set[i]] = TRUE;
+    }
+
     /* Initiate energies and set them to zero */
     edat.nsteps    = 0;
     edat.npoints   = 0;
@@ -2030,7 +2038,14 @@ int gmx_energy(int argc, char* argv[])
          */
         do
         {
-            bCont = do_enx(fp, &(frame[NEXT]));
+            if (bDHDL)
+            {
+                bCont = do_enx(fp, &(frame[NEXT]));
+            }
+            else
+            {
+                bCont = do_enx_select(fp, &(frame[NEXT]), bReadTerm, FALSE);
+            }
             if (bCont)
             {
                 timecheck = check_times(frame[NEXT].t);
@@ -2205,6 +2220,7 @@ int gmx_energy(int argc, char* argv[])
 
     fprintf(stderr, "\n");
     done_ener_file(fp);
+    sfree(bReadTerm);
     if (out)
     {
         xvgrclose(out);
@@ -33,6 +33,8 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -41,6 +43,7 @@
 #include <algorithm>
 #include <array>
 #include <filesystem>
+#include <numeric>
 #include <string>
 #include <vector>
 
@@ -59,6 +62,7 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
+#include "gromacs/selection/nbsearch.h"
 #include "gromacs/topology/atoms.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
@@ -70,20 +74,49 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
 
 struct gmx_output_env_t;
 
+//! Returns the coordinates of the \p n atoms in \p index, for use as search positions
+static std::vector<gmx::RVec> group_coordinates(const rvec x[], int n, const int index[])
+{
+    std::vector<gmx::RVec> xGroup(n);
+    for (int i = 0; i < n; i++)
+    {
+        copy_rvec(x[index[i]], xGroup[i]);
+    }
+
+    return xGroup;
+}
+
+/*! \brief Returns whether \p pair is nearer than \p nearest, which can be invalid
+ *
+ * Equal distances are ordered as in a loop over the test positions with
+ * an inner loop over the reference positions, so the result does not
+ * depend on the order in which the search returns the pairs.
+ */
+static bool is_nearer_pair(const gmx::AnalysisNeighborhoodPair& pair,
+                           const gmx::AnalysisNeighborhoodPair& nearest)
+{
+    if (!nearest.isValid() || pair.distance2() != nearest.distance2())
+    {
+        return !nearest.isValid() || pair.distance2() < nearest.distance2();
+    }
+    return pair.testIndex() < nearest.testIndex()
+           || (pair.testIndex() == nearest.testIndex() && pair.refIndex() < nearest.refIndex());
+}
 
 static void
 periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], real* rmin, real* rmax, int* min_ind)
 {
 #define NSHIFT_MAX 26
-    int  nsz, nshift, sx, sy, sz, i, j, s;
-    real sqr_box, r2min, r2max, r2;
-    rvec shift[NSHIFT_MAX], d0, d;
+    int  nsz, nshift, sx, sy, sz, i;
+    real sqr_box, r2min, r2max;
+    rvec shift[NSHIFT_MAX];
 
     sqr_box = std::min(norm2(box[XX]), norm2(box[YY]));
     if (pbcType == PbcType::Xyz)
@@ -119,31 +152,64 @@ periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], r
         }
     }
 
-    r2min = sqr_box;
-    r2max = 0;
+    /* The maximum internal distance needs all pairs */
+    const std::vector<gmx::RVec> xGroup = group_coordinates(x, n, index);
+    r2max                               = 0;
+#pragma omp parallel for reduction(max : r2max) schedule(dynamic, 64)
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+        {
+            r2max = std::max(r2max, distance2(xGroup[i], xGroup[j]));
+        }
+    }
 
+    /* The periodic images of the group are the test positions of a search
+     * in the non-periodic coordinates of the group. The cutoff is doubled
+     * until a pair is found or all distances shorter than the shortest box
+     * vector have been checked.
+     */
+    std::vector<gmx::RVec> xShifted(static_cast<size_t>(n) * nshift);
     for (i = 0; i < n; i++)
     {
-        for (j = i + 1; j < n; j++)
+        for (int s = 0; s < nshift; s++)
         {
-            rvec_sub(x[index[i]], x[index[j]], d0);
-            r2 = norm2(d0);
-            if (r2 > r2max)
-            {
-                r2max = r2;
-            }
-            for (s = 0; s < nshift; s++)
+            rvec_add(xGroup[i], shift[s], xShifted[i * nshift + s]);
+        }
+    }
+    std::vector<gmx::AnalysisNeighborhoodPair> pairs;
+    r2min       = sqr_box;
+    real radius = std::sqrt(sqr_box) / 16;
+    while (true)
+    {
+        gmx::AnalysisNeighborhood nb;
+        nb.setCutoff(radius);
+        gmx::AnalysisNeighborhoodSearch search = nb.initSearch(nullptr, xGroup);
+        search.findAllPairs(xShifted, &pairs, gmx_omp_get_max_threads());
+        bool bFound = false;
+        for (const gmx::AnalysisNeighborhoodPair& pair : pairs)
+        {
+            const int  i     = pair.testIndex() / nshift;
+            const int  j     = pair.refIndex();
+            const int  first = std::min(i, j);
+            const int  last  = std::max(i, j);
+            const real r2    = pair.distance2();
+            if (i != j
+                && (r2 < r2min
+                    || (bFound && r2 == r2min
+                        && (first < min_ind[0] || (first == min_ind[0] && last < min_ind[1])))))
             {
-                rvec_add(d0, shift[s], d);
-                r2 = norm2(d);
-                if (r2 < r2min)
-                {
-                    r2min      = r2;
-                    min_ind[0] = i;
-                    min_ind[1] = j;
-                }
+                r2min      = r2;
+                min_ind[0] = first;
+                min_ind[1] = last;
+                bFound     = true;
             }
         }
+        if (bFound || radius * radius >= sqr_box)
+        {
+            break;
+        }
+        radius = std::min(2 * radius, std::sqrt(sqr_box));
     }
 
     *rmin = std::sqrt(r2min);
@@ -241,6 +307,137 @@ static void periodic_mindist_plot(const char*             trxfn,
             index[ind_minj] + 1);
 }
 
+//! Cutoff below which the neighborhood search gets inefficient
+constexpr real c_minSearchRadius = 0.1;
+
+//! Number of pairs below which calc_dist() does not start threads
+constexpr int64_t c_minPairsForThreads = 10000;
+
+/*! \brief Returns a search cutoff that includes all pairs of atoms of two groups
+ *
+ * This is the diagonal of the bounding box of the groups, which is also
+ * an upper bound for the distances with periodicity.
+ */
+static real all_pairs_radius(const rvec x[],
+                             int        nx1,
+                             const int  index1[],
+                             int        nx2,
+                             const int  index2[])
+{
+    rvec lower, upper;
+    copy_rvec(x[nx1 > 0 ? index1[0] : index2[0]], lower);
+    copy_rvec(lower, upper);
+    for (int g = 0; g < 2; g++)
+    {
+        const int  n     = (g == 0 ? nx1 : nx2);
+        const int* index = (g == 0 ? index1 : index2);
+        for (int i = 0; i < n; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                lower[d] = std::min(lower[d], x[index[i]][d]);
+                upper[d] = std::max(upper[d], x[index[i]][d]);
+            }
+        }
+    }
+    rvec diagonal;
+    rvec_sub(upper, lower, diagonal);
+
+    /* Avoid a zero cutoff, which would mean no cutoff at all */
+    return std::max(1.001_real * norm(diagonal), c_minSearchRadius);
+}
+
+/*! \brief Computes the minimum distance and the contacts between two groups by searching pairs
+ *
+ * Atoms of the second group are searched for around the first group.
+ * Contacts are counted within \p rcut. When no pair is found within the
+ * cutoff, the cutoff is doubled until the minimum distance has been found.
+ * The results are as with calc_dist(), but the maximum distance is not
+ * computed.
+ */
+static void calc_mindist_search(real         rcut,
+                                const t_pbc* pbc,
+                                const rvec   x[],
+                                int          nx1,
+                                int          nx2,
+                                const int    index1[],
+                                const int    index2[],
+                                gmx_bool     bGroup,
+                                real*        rmin,
+                                int*         nmin,
+                                int*         nmax,
+                                int*         ixmin,
+                                int*         jxmin)
+{
+    const std::vector<gmx::RVec> x1        = group_coordinates(x, nx1, index1);
+    const std::vector<gmx::RVec> x2        = group_coordinates(x, nx2, index2);
+    const real                   maxRadius = all_pairs_radius(x, nx1, index1, nx2, index2);
+    const real                   rcut2     = gmx::square(rcut);
+
+    std::vector<int>                           numContacts(nx2, 0);
+    std::vector<int>                           numSelf(nx2, 0);
+    std::vector<gmx::AnalysisNeighborhoodPair> pairs;
+    gmx::AnalysisNeighborhoodPair              nearest;
+    real radius = std::min(std::max(rcut, c_minSearchRadius), maxRadius);
+    for (bool bFirst = true; !nearest.isValid(); bFirst = false)
+    {
+        gmx::AnalysisNeighborhood nb;
+        nb.setCutoff(radius);
+        gmx::AnalysisNeighborhoodSearch search = nb.initSearch(pbc, x1);
+        search.findAllPairs(x2, &pairs, gmx_omp_get_max_threads());
+        for (const gmx::AnalysisNeighborhoodPair& pair : pairs)
+        {
+            const int j = pair.testIndex();
+            /* Contacts only need to be counted in the first search */
+            if (index1[pair.refIndex()] == index2[j])
+            {
+                if (bFirst)
+                {
+                    numSelf[j]++;
+                }
+                continue;
+            }
+            if (bFirst && pair.distance2() <= rcut2)
+            {
+                numContacts[j]++;
+            }
+            if (is_nearer_pair(pair, nearest))
+            {
+                nearest = pair;
+            }
+        }
+        if (radius >= maxRadius)
+        {
+            break;
+        }
+        radius = std::min(2 * radius, maxRadius);
+    }
+
+    for (int j = 0; j < nx2; j++)
+    {
+        const int nmin_j = numContacts[j];
+        const int nmax_j = nx1 - numSelf[j] - nmin_j;
+        if (bGroup)
+        {
+            *nmin += (nmin_j > 0 ? 1 : 0);
+            *nmax += (nmax_j > 0 ? 1 : 0);
+        }
+        else
+        {
+            *nmin += nmin_j;
+            *nmax += nmax_j;
+        }
+    }
+    real rmin2 = 1e12;
+    if (nearest.isValid())
+    {
+        rmin2  = nearest.distance2();
+        *ixmin = index1[nearest.refIndex()];
+        *jxmin = index2[nearest.testIndex()];
+    }
+    *rmin = std::sqrt(rmin2);
+}
+
 static void calc_dist(real     rcut,
                       gmx_bool bPBC,
                       PbcType  pbcType,
@@ -251,6 +448,7 @@ static void calc_dist(real     rcut,
                       int      index1[],
                       int      index2[],
                       gmx_bool bGroup,
+                      gmx_bool bMin,
                       real*    rmin,
                       real*    rmax,
                       int*     nmin,
@@ -260,13 +458,10 @@ static void calc_dist(real     rcut,
                       int*     ixmax,
                       int*     jxmax)
 {
-    int   i, j, i0 = 0, j1;
-    int   ix, jx;
+    int   i0 = 0, j1;
     int*  index3;
-    rvec  dx;
-    real  r2, rmin2, rmax2, rcut2;
+    real  rmin2, rmax2, rcut2;
     t_pbc pbc;
-    int   nmin_j, nmax_j;
 
     *ixmin = -1;
     *jxmin = -1;
@@ -282,6 +477,30 @@ static void calc_dist(real     rcut,
     {
         set_pbc(&pbc, pbcType, box);
     }
+
+    /* The minimum distance and the contacts can be found with a
+     * neighborhood search, the maximum distance needs all pairs.
+     * A single pair is cheaper to compute directly.
+     */
+    if (bMin && index2 && static_cast<int64_t>(nx1) * nx2 > 1)
+    {
+        calc_mindist_search(rcut,
+                            bPBC ? &pbc : nullptr,
+                            x,
+                            nx1,
+                            nx2,
+                            index1,
+                            index2,
+                            bGroup,
+                            rmin,
+                            nmin,
+                            nmax,
+                            ixmin,
+                            jxmin);
+        *rmax = 0;
+        return;
+    }
+
     if (index2)
     {
         i0     = 0;
@@ -295,23 +514,31 @@ static void calc_dist(real     rcut,
     }
     GMX_RELEASE_ASSERT(index1 != nullptr, "Need a valid index for plotting distances");
 
-    rmin2 = 1e12;
-    rmax2 = -1e12;
+    /* Determine the extremes per atom of the second group in parallel,
+     * combining them in the same order as a serial loop would.
+     */
+    struct PairExtremes
+    {
+        real rmin2 = 1e12;
+        real rmax2 = -1e12;
+        int  ixmin = -1;
+        int  ixmax = -1;
+        int  nmin  = 0;
+        int  nmax  = 0;
+    };
+    std::vector<PairExtremes> extremes(j1);
 
-    for (j = 0; (j < j1); j++)
+#pragma omp parallel for schedule(static) if (static_cast<int64_t>(j1) * nx1 >= c_minPairsForThreads)
+    for (int j = 0; j < j1; j++)
     {
-        jx = index3[j];
-        if (index2 == nullptr)
-        {
-            i0 = j + 1;
-        }
-        nmin_j = 0;
-        nmax_j = 0;
-        for (i = i0; (i < nx1); i++)
+        PairExtremes& e  = extremes[j];
+        const int     jx = index3[j];
+        for (int i = (index2 == nullptr ? j + 1 : i0); i < nx1; i++)
         {
-            ix = index1[i];
+            const int ix = index1[i];
             if (ix != jx)
             {
+                rvec dx;
                 if (bPBC)
                 {
                     pbc_dx(&pbc, x[ix], x[jx], dx);
@@ -320,50 +547,149 @@ static void calc_dist(real     rcut,
                 {
                     rvec_sub(x[ix], x[jx], dx);
                 }
-                r2 = iprod(dx, dx);
-                if (r2 < rmin2)
+                const real r2 = iprod(dx, dx);
+                if (r2 < e.rmin2)
                 {
-                    rmin2  = r2;
-                    *ixmin = ix;
-                    *jxmin = jx;
+                    e.rmin2 = r2;
+                    e.ixmin = ix;
                 }
-                if (r2 > rmax2)
+                if (r2 > e.rmax2)
                 {
-                    rmax2  = r2;
-                    *ixmax = ix;
-                    *jxmax = jx;
+                    e.rmax2 = r2;
+                    e.ixmax = ix;
                 }
                 if (r2 <= rcut2)
                 {
-                    nmin_j++;
+                    e.nmin++;
                 }
                 else
                 {
-                    nmax_j++;
+                    e.nmax++;
                 }
             }
         }
+    }
+
+    rmin2 = 1e12;
+    rmax2 = -1e12;
+    for (int j = 0; j < j1; j++)
+    {
+        const PairExtremes& e = extremes[j];
+        if (e.rmin2 < rmin2)
+        {
+            rmin2  = e.rmin2;
+            *ixmin = e.ixmin;
+            *jxmin = index3[j];
+        }
+        if (e.rmax2 > rmax2)
+        {
+            rmax2  = e.rmax2;
+            *ixmax = e.ixmax;
+            *jxmax = index3[j];
+        }
         if (bGroup)
         {
-            if (nmin_j > 0)
+            if (e.nmin > 0)
             {
                 (*nmin)++;
             }
-            if (nmax_j > 0)
+            if (e.nmax > 0)
             {
                 (*nmax)++;
             }
         }
         else
         {
-            *nmin += nmin_j;
-            *nmax += nmax_j;
+            *nmin += e.nmin;
+            *nmax += e.nmax;
         }
     }
     *rmin = std::sqrt(rmin2);
     *rmax = std::sqrt(rmax2);
 }
 
+/*! \brief Computes the minimum distance of each residue of the first group to a second group
+ *
+ * The atoms of the residues are searched for around the second group,
+ * doubling the cutoff for residues without any atom within it.
+ * The minima are stored in \p mindres, when they are smaller.
+ */
+static void calc_residue_mindist_search(real       rcut,
+                                        gmx_bool   bPBC,
+                                        PbcType    pbcType,
+                                        matrix     box,
+                                        rvec       x[],
+                                        int        nres,
+                                        const int* residue,
+                                        const int* index1,
+                                        int        nx2,
+                                        const int* index2,
+                                        real*      mindres)
+{
+    t_pbc pbc;
+    if (bPBC)
+    {
+        set_pbc(&pbc, pbcType, box);
+    }
+    const int                    nx1       = residue[nres];
+    const std::vector<gmx::RVec> x1        = group_coordinates(x, nx1, index1);
+    const std::vector<gmx::RVec> x2        = group_coordinates(x, nx2, index2);
+    const real                   maxRadius = all_pairs_radius(x, nx1, index1, nx2, index2);
+
+    std::vector<int> residueOfAtom(nx1);
+    for (int res = 0; res < nres; res++)
+    {
+        std::fill(residueOfAtom.begin() + residue[res],
+                  residueOfAtom.begin() + residue[res + 1],
+                  res);
+    }
+
+    std::vector<int> remaining(nres);
+    std::iota(remaining.begin(), remaining.end(), 0);
+    std::vector<real>                          resmin2(nres, 1e12);
+    std::vector<int>                           testAtoms;
+    std::vector<gmx::AnalysisNeighborhoodPair> pairs;
+    real radius = std::min(std::max(rcut, c_minSearchRadius), maxRadius);
+    while (!remaining.empty())
+    {
+        testAtoms.clear();
+        for (int res : remaining)
+        {
+            for (int i = residue[res]; i < residue[res + 1]; i++)
+            {
+                testAtoms.push_back(i);
+            }
+        }
+        gmx::AnalysisNeighborhood nb;
+        nb.setCutoff(radius);
+        gmx::AnalysisNeighborhoodSearch search = nb.initSearch(bPBC ? &pbc : nullptr, x2);
+        search.findAllPairs(gmx::AnalysisNeighborhoodPositions(x1).indexed(testAtoms),
+                            &pairs,
+                            gmx_omp_get_max_threads());
+        for (const gmx::AnalysisNeighborhoodPair& pair : pairs)
+        {
+            const int i = testAtoms[pair.testIndex()];
+            if (index1[i] != index2[pair.refIndex()])
+            {
+                resmin2[residueOfAtom[i]] = std::min(resmin2[residueOfAtom[i]], pair.distance2());
+            }
+        }
+
+        /* The last search finds all pairs */
+        const bool bLast      = (radius >= maxRadius);
+        auto       unresolved = std::partition(remaining.begin(),
+                                         remaining.end(),
+                                         [&resmin2, radius, bLast](int res)
+                                         { return !bLast && resmin2[res] > gmx::square(radius); });
+        for (auto res = unresolved; res != remaining.end(); ++res)
+        {
+            mindres[*res] = std::min(mindres[*res], std::sqrt(resmin2[*res]));
+        }
+        remaining.erase(unresolved, remaining.end());
+        radius = std::min(2 * radius, maxRadius);
+    }
+}
+
 static void dist_plot(const char*             fn,
                       const char*             afile,
                       const char*             dfile,
@@ -528,6 +854,7 @@ static void dist_plot(const char*             fn,
                           index[0],
                           index[0],
                           bGroup,
+                          bMin,
                           &dmin,
                           &dmax,
                           &nmin,
@@ -558,6 +885,7 @@ static void dist_plot(const char*             fn,
                                   index[i],
                                   index[k],
                                   bGroup,
+                                  bMin,
                                   &dmin,
                                   &dmax,
                                   &nmin,
@@ -590,6 +918,7 @@ static void dist_plot(const char*             fn,
                           index[0],
                           index[i],
                           bGroup,
+                          bMin,
                           &dmin,
                           &dmax,
                           &nmin,
@@ -603,7 +932,21 @@ static void dist_plot(const char*             fn,
                 {
                     fprintf(num, "  %8d", bMin ? nmin : nmax);
                 }
-                if (nres)
+                if (nres && bMin)
+                {
+                    calc_residue_mindist_search(rcut,
+                                                bPBC,
+                                                pbcType,
+                                                box,
+                                                x0,
+                                                nres,
+                                                residue,
+                                                index[0],
+                                                gnx[i],
+                                                index[i],
+                                                mindres[i - 1]);
+                }
+                else if (nres)
                 {
                     for (j = 0; j < nres; j++)
                     {
@@ -617,6 +960,7 @@ static void dist_plot(const char*             fn,
                                   &(index[0][residue[j]]),
                                   index[i],
                                   bGroup,
+                                  bMin,
                                   &dmin,
                                   &dmax,
                                   &nmin,
@@ -784,6 +1128,10 @@ int gmx_mindist(int argc, char* argv[])
         "with [TT]-s[tt], either as a .tpr file or a .pdb file with CRYST1 fields.",
         "It also plots the maximum distance within the group and the lengths",
         "of the three box vectors.[PAR]",
+        "Minimum distances, contacts and periodic image distances are found with",
+        "a grid-based neighborhood search, in parallel when multiple threads are",
+        "used, so the cost per frame scales linearly with the number of atoms.",
+        "The maximum distances of [TT]-max[tt] and [TT]-pi[tt] need all pairs of atoms.[PAR]",
         "Also [gmx-distance] and [gmx-pairdist] calculate distances."
     };
 
@@ -792,6 +1140,7 @@ int gmx_mindist(int argc, char* argv[])
     real     rcutoff          = 0.6;
     int      ng               = 1;
     gmx_bool bEachResEachTime = FALSE, bPrintResName = FALSE;
+    int      nthreads         = -1;
     t_pargs  pa[] = {
         { "-matrix", FALSE, etBOOL, { &bMat }, "Calculate half a matrix of group-group distances" },
         { "-max", FALSE, etBOOL, { &bMax }, "Calculate *maximum* distance instead of minimum" },
@@ -814,7 +1163,10 @@ int gmx_mindist(int argc, char* argv[])
           etBOOL,
           { &bEachResEachTime },
           "When writing per-residue distances, write distance for each time point" },
-        { "-printresname", FALSE, etBOOL, { &bPrintResName }, "Write residue names" }
+        { "-printresname", FALSE, etBOOL, { &bPrintResName }, "Write residue names" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to start" },
+#endif
     };
     gmx_output_env_t* oenv;
     t_topology*       top     = nullptr;
@@ -834,6 +1186,8 @@ int gmx_mindist(int argc, char* argv[])
                        { efTRO, "-ox", "mindist", ffOPTWR }, { efXVG, "-or", "mindistres", ffOPTWR } };
 #define NFILE asize(fnm)
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(&argc,
                            argv,
                            PCA_CAN_VIEW | PCA_CAN_TIME | PCA_TIME_UNIT,
@@ -850,6 +1204,8 @@ int gmx_mindist(int argc, char* argv[])
         return 0;
     }
 
+    gmx_omp_set_num_threads(nthreads);
+
     trxfnm  = ftp2fn(efTRX, NFILE, fnm);
     ndxfnm  = ftp2fn_null(efNDX, NFILE, fnm);
     distfnm = opt2fn("-od", NFILE, fnm);
@@ -33,26 +33,34 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cmath>
 #include <cstdlib>
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
+#include "gromacs/commandline/filenm.h"
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/math/vec.h"
-#include "gromacs/mdspan/mdspan.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
-#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/gmxomp.h"
+
+#include "densitygrid.h"
 
 static const double bohr =
         0.529177249; /* conversion factor to compensate for VMD plugin conversion... */
@@ -109,7 +117,20 @@ int gmx_spatial(int argc, char* argv[])
         "that are going to be used in the first and subsequent run through [gmx-trjconv].",
         "However, be sure to set the [TT]-nab[tt] option to a sufficiently high value since",
         "memory is allocated for cube bins based on the initial coordinates and the [TT]-nab[tt]",
-        "option value."
+        "option value.",
+        "",
+        "Smoothing and other output",
+        "^^^^^^^^^^^^^^^^^^^^^^^^^^",
+        "",
+        "With [TT]-sigma[tt] larger than zero, each atom is spread as a normalized Gaussian",
+        "of that width onto the bin centers instead of being counted in a single bin.",
+        "This gives smooth isosurfaces with fewer frames. Note that the occupied region,",
+        "and thereby the cube size, then extends up to four times [TT]-sigma[tt] further.",
+        "With [TT]-mrc[tt], the normalized density on the whole allocated grid is",
+        "additionally written as an mrc/ccp4 density map, with coordinates in Angstrom.",
+        "",
+        "The frames are accumulated into a private grid per thread, which are summed",
+        "at the end. The number of threads is set with [TT]-nt[tt]."
     };
     const char* bugs[] = {
         "When the allocated memory is not large enough, an error may occur "
@@ -123,6 +144,8 @@ int gmx_spatial(int argc, char* argv[])
     static real     rBINWIDTH    = 0.05; /* nm */
     static gmx_bool bCALCDIV     = TRUE;
     static int      iNAB         = 16;
+    static real     sigma        = 0;
+    static int      nthreads     = -1;
 
     t_pargs pa[] = { { "-pbc",
                        FALSE,
@@ -149,7 +172,17 @@ int gmx_spatial(int argc, char* argv[])
                        FALSE,
                        etINT,
                        { &iNAB },
-                       "Number of additional bins to ensure proper memory allocation" } };
+                       "Number of additional bins to ensure proper memory allocation" },
+                     { "-sigma",
+                       FALSE,
+                       etREAL,
+                       { &sigma },
+                       "Width (nm) of the Gaussian each atom is spread with, 0 counts atoms in "
+                       "single bins" },
+#if GMX_OPENMP
+                     { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to accumulate with" },
+#endif
+    };
 
     double            MINBIN[3];
     double            MAXBIN[3];
@@ -171,18 +204,21 @@ int gmx_spatial(int argc, char* argv[])
     FILE*             flp;
     int               minx, miny, minz, maxx, maxy, maxz;
     int               numfr, numcu;
-    int               maxval, minval;
-    int64_t           tot;
+    double            maxval, minval;
+    double            tot;
     double            norm;
     gmx_output_env_t* oenv;
     gmx_rmpbc_t       gpbc = nullptr;
 
     t_filenm fnm[] = { { efTPS, nullptr, nullptr, ffREAD }, /* this is for the topology */
                        { efTRX, "-f", nullptr, ffREAD },    /* and this for the trajectory */
-                       { efNDX, nullptr, nullptr, ffOPTRD } };
+                       { efNDX, nullptr, nullptr, ffOPTRD },
+                       { efMRC, "-mrc", "spatial", ffOPTWR } };
 
 #define NFILE asize(fnm)
 
+    nthreads = gmx_omp_get_max_threads();
+
     /* This is the routine responsible for adding default options,
      * calling the X/motif interface, etc. */
     if (!parse_common_args(
@@ -190,6 +226,12 @@ int gmx_spatial(int argc, char* argv[])
     {
         return 0;
     }
+    nthreads = std::max(nthreads, 1);
+    gmx_omp_set_num_threads(nthreads);
+    if (sigma < 0)
+    {
+        gmx_fatal(FARGS, "-sigma should not be negative");
+    }
 
     read_tps_conf(ftp2fn(efTPS, NFILE, fnm), &top, &pbcType, &xtop, nullptr, box, TRUE);
     sfree(xtop);
@@ -241,13 +283,11 @@ int gmx_spatial(int argc, char* argv[])
         MINBIN[i] -= iNAB * rBINWIDTH;
         nbin[i] = static_cast<int>(std::ceil((MAXBIN[i] - MINBIN[i]) / rBINWIDTH));
     }
-    std::vector<int> binData(nbin[XX] * nbin[YY] * nbin[ZZ], 0);
-    gmx::basic_mdspan<int, gmx::extents<gmx::dynamic_extent, gmx::dynamic_extent, gmx::dynamic_extent>> bin(
-            binData.data(), nbin[XX], nbin[YY], nbin[ZZ]);
+    gmx::DensityGridAccumulator accumulator(
+            gmx::IVec(nbin[XX], nbin[YY], nbin[ZZ]), sigma / rBINWIDTH, nthreads);
+    std::vector<gmx::RVec> latticePositions(nidx);
     copy_mat(box, box_pbc);
     numfr = 0;
-    minx = miny = minz = std::numeric_limits<int>::max();
-    maxx = maxy = maxz = std::numeric_limits<int>::min();
 
     if (bPBC)
     {
@@ -267,11 +307,26 @@ int gmx_spatial(int argc, char* argv[])
 
         for (int i = 0; i < nidx; i++)
         {
-            int x = static_cast<int>(std::floor((fr.x[index[i]][XX] - MINBIN[XX]) / rBINWIDTH));
-            int y = static_cast<int>(std::floor((fr.x[index[i]][YY] - MINBIN[YY]) / rBINWIDTH));
-            int z = static_cast<int>(std::floor((fr.x[index[i]][ZZ] - MINBIN[ZZ]) / rBINWIDTH));
-            if (x < 0 || x >= nbin[XX] || y < 0 || y >= nbin[YY] || z < 0 || z >= nbin[ZZ])
+            for (int d = 0; d < DIM; d++)
+            {
+                latticePositions[i][d] = (fr.x[index[i]][d] - MINBIN[d]) / rBINWIDTH;
+            }
+        }
+        if (accumulator.add(latticePositions, 1) > 0)
+        {
+            for (int i = 0; i < nidx; i++)
             {
+                bool bInside = true;
+                for (int d = 0; d < DIM; d++)
+                {
+                    const int b = static_cast<int>(std::floor(latticePositions[i][d]));
+                    bInside     = bInside && b >= 0 && b < nbin[d];
+                }
+                if (bInside)
+                {
+                    continue;
+                }
+                const real* x = fr.x[index[i]];
                 printf("There was an item outside of the allocated memory. Increase the value "
                        "given with the -nab option.\n");
                 printf("Memory was allocated for [%f,%f,%f]\tto\t[%f,%f,%f]\n",
@@ -281,38 +336,10 @@ int gmx_spatial(int argc, char* argv[])
                        MAXBIN[XX],
                        MAXBIN[YY],
                        MAXBIN[ZZ]);
-                printf("Memory was required for [%f,%f,%f]\n",
-                       fr.x[index[i]][XX],
-                       fr.x[index[i]][YY],
-                       fr.x[index[i]][ZZ]);
-                exit(1);
-            }
-
-            bin[x][y][z]++;
-            if (x < minx)
-            {
-                minx = x;
-            }
-            if (x > maxx)
-            {
-                maxx = x;
-            }
-            if (y < miny)
-            {
-                miny = y;
-            }
-            if (y > maxy)
-            {
-                maxy = y;
-            }
-            if (z < minz)
-            {
-                minz = z;
-            }
-            if (z > maxz)
-            {
-                maxz = z;
+                printf("Memory was required for [%f,%f,%f]\n", x[XX], x[YY], x[ZZ]);
+                break;
             }
+            exit(1);
         }
         numfr++;
         /* printf("%f\t%f\t%f\n",box[XX][XX],box[YY][YY],box[ZZ][ZZ]); */
@@ -324,6 +351,30 @@ int gmx_spatial(int argc, char* argv[])
         gmx_rmpbc_done(gpbc);
     }
 
+    const auto& grid = accumulator.result();
+
+    /* Find the bins with non-zero occupancy */
+    minx = miny = minz = std::numeric_limits<int>::max();
+    maxx = maxy = maxz = std::numeric_limits<int>::min();
+    for (int k = 0; k < nbin[ZZ]; k++)
+    {
+        for (int j = 0; j < nbin[YY]; j++)
+        {
+            for (int i = 0; i < nbin[XX]; i++)
+            {
+                if (grid(k, j, i) > 0)
+                {
+                    minx = std::min(minx, i);
+                    maxx = std::max(maxx, i);
+                    miny = std::min(miny, j);
+                    maxy = std::max(maxy, j);
+                    minz = std::min(minz, k);
+                    maxz = std::max(maxz, k);
+                }
+            }
+        }
+    }
+
     if (!bCUTDOWN)
     {
         minx = miny = minz = 0;
@@ -393,39 +444,7 @@ int gmx_spatial(int argc, char* argv[])
     }
 
     tot = 0;
-    for (int i = 0; i < nbin[XX]; i++)
-    {
-        if (!(i < minx || i > maxx))
-        {
-            continue;
-        }
-        for (int j = 0; j < nbin[YY]; j++)
-        {
-            if (!(j < miny || j > maxy))
-            {
-                continue;
-            }
-            for (int k = 0; k < nbin[ZZ]; k++)
-            {
-                if (!(k < minz || k > maxz))
-                {
-                    continue;
-                }
-                int binValue = bin[i][j][k];
-                GMX_RELEASE_ASSERT(
-                        binValue == 0,
-                        gmx::formatString("A bin was not empty when it should have been empty. "
-                                          "Programming error.\n bin[%d][%d][%d] was = %d\n",
-                                          i,
-                                          j,
-                                          k,
-                                          binValue)
-                                .c_str());
-            }
-        }
-    }
-
-    minval = 999;
+    minval = std::numeric_limits<double>::max();
     maxval = 0;
     for (int i = outputStarts[XX]; i < outputEnds[XX]; i++)
     {
@@ -433,7 +452,7 @@ int gmx_spatial(int argc, char* argv[])
         {
             for (int k = outputStarts[ZZ]; k < outputEnds[ZZ]; k++)
             {
-                int binValue = bin[i][j][k];
+                double binValue = grid(k, j, i);
                 tot += binValue;
                 if (binValue > maxval)
                 {
@@ -465,7 +484,7 @@ int gmx_spatial(int argc, char* argv[])
         {
             for (int k = outputStarts[ZZ]; k < outputEnds[ZZ]; k++)
             {
-                fprintf(flp, "%12.6f ", static_cast<double>(norm * bin[i][j][k]) / numfr);
+                fprintf(flp, "%12.6f ", norm * grid(k, j, i) / numfr);
             }
             fprintf(flp, "\n");
         }
@@ -473,6 +492,19 @@ int gmx_spatial(int argc, char* argv[])
     }
     gmx_ffclose(flp);
 
+    if (opt2bSet("-mrc", NFILE, fnm))
+    {
+        gmx::MultiDimArray<std::vector<double>, gmx::dynamicExtents3D> density = grid;
+        for (double& value : density.toArrayRef())
+        {
+            value *= norm / numfr;
+        }
+        gmx::writeDensityGridMrc(opt2fn("-mrc", NFILE, fnm),
+                                 density,
+                                 gmx::RVec(MINBIN[XX], MINBIN[YY], MINBIN[ZZ]),
+                                 gmx::RVec(rBINWIDTH, rBINWIDTH, rBINWIDTH));
+    }
+
     if (bCALCDIV)
     {
         printf("Counts per frame in all %d cubes divided by %le\n", numcu, 1.0 / norm);
@@ -485,9 +517,9 @@ int gmx_spatial(int argc, char* argv[])
     {
         printf("grid.cube contains counts per frame in all %d cubes\n", numcu);
         printf("Raw data: average %le, min %le, max %le\n",
-               static_cast<double>(tot) / numfr / numcu,
-               static_cast<double>(minval) / numfr,
-               static_cast<double>(maxval) / numfr);
+               tot / numfr / numcu,
+               minval / numfr,
+               maxval / numfr);
     }
 
     return 0;
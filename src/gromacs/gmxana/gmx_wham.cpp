@@ -74,6 +74,8 @@
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
 #include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
@@ -195,9 +197,7 @@ typedef struct
 
     double dt; //!< timestep in the input data. Can be adapted with gmx wham option -dt
 
-    /*! \brief TRUE, if any data point of the histogram is within min and max, otherwise FALSE */
-    gmx_bool** bContrib;
-    real**     ztime; //!< input data z(t) as a function of time. Required to compute ACTs
+    real** ztime; //!< input data z(t) as a function of time. Required to compute ACTs
 
     /*! \brief average force estimated from average displacement, fAv=dzAv*k
      *
@@ -343,7 +343,6 @@ static t_UmbrellaWindow* initUmbrellaWindows(int nwin)
         win[i].k = win[i].pos = win[i].z = nullptr;
         win[i].N = win[i].Ntot = nullptr;
         win[i].g = win[i].tau = win[i].tausmooth = nullptr;
-        win[i].bContrib                          = nullptr;
         win[i].ztime                             = nullptr;
         win[i].forceAv                           = nullptr;
         win[i].aver = win[i].sigma = nullptr;
@@ -372,13 +371,6 @@ static void freeUmbrellaWindows(t_UmbrellaWindow* win, int nwin)
                 sfree(win[i].cum[j]);
             }
         }
-        if (win[i].bContrib)
-        {
-            for (j = 0; j < win[i].nPull; j++)
-            {
-                sfree(win[i].bContrib[j]);
-            }
-        }
         sfree(win[i].Histo);
         sfree(win[i].cum);
         sfree(win[i].k);
@@ -389,7 +381,6 @@ static void freeUmbrellaWindows(t_UmbrellaWindow* win, int nwin)
         sfree(win[i].g);
         sfree(win[i].tau);
         sfree(win[i].tausmooth);
-        sfree(win[i].bContrib);
         sfree(win[i].ztime);
         sfree(win[i].forceAv);
         sfree(win[i].aver);
@@ -509,7 +500,7 @@ static void enforceEqualWeights(t_UmbrellaWindow* window, int nWindows)
 
 /*! \brief Simple linear interpolation between two given tabulated points
  */
-static double tabulated_pot(double dist, t_UmbrellaOptions* opt)
+static double tabulated_pot(double dist, const t_UmbrellaOptions* opt)
 {
     int    jl, ju;
     double pl, pu, dz, dp;
@@ -533,176 +524,274 @@ static double tabulated_pot(double dist, t_UmbrellaOptions* opt)
 }
 
 
-/*! \brief
- * Check which bins substiantially contribute (accelerates WHAM)
+#if GMX_SIMD_HAVE_DOUBLE
+//! Nr of bins processed together in the WHAM iterations
+constexpr int c_whamSimdWidth = GMX_SIMD_DOUBLE_WIDTH;
+#else
+//! Nr of bins processed together in the WHAM iterations
+constexpr int c_whamSimdWidth = 1;
+#endif
+
+//! Nr of bins for which calc_profile accumulates the denominators in one pass over the histograms
+constexpr int c_whamBinBlockSize = 128;
+
+//! Vector of doubles aligned for SIMD loads
+using AlignedDoubleVector = std::vector<double, gmx::AlignedAllocator<double>>;
+
+/*! \brief Boltzmann factors of the umbrella potentials of all histograms
  *
- * Don't worry, that routine does not mean we compute the PMF in limited precision.
- * After rapid convergence (using only substiantal contributions), we always switch to
- * full precision.
+ * The umbrella potentials enter the WHAM equations only through exp(-U/kT),
+ * which does not change during the iterations. They are therefore computed
+ * once and stored contiguously with one row of nBinPadded values per histogram,
+ * so the iterations reduce to SIMD sums over the rows. Each row is scaled by
+ * exp(s), with s the smallest U/kT in the row, to avoid that histograms far
+ * outside of min and max underflow to zero.
  */
-static void setup_acc_wham(const double* profile, t_UmbrellaWindow* window, int nWindows, t_UmbrellaOptions* opt)
+typedef struct WhamMatrix
+{
+    int                 nHist;      //!< nr of histograms, summed over all windows
+    int                 nBin;       //!< nr of bins, identical to opt->bins
+    int                 nBinPadded; //!< nr of bins padded to the SIMD width
+    std::vector<int>    histWin;    //!< window index of each histogram
+    std::vector<int>    histPull;   //!< pull coordinate index within the window of each histogram
+    std::vector<double> logScale;   //!< the scaling s of each row
+    AlignedDoubleVector boltzmann;  //!< exp(-U/kT + s), nHist rows of nBinPadded
+    //! as boltzmann, but zero where the bin does not contribute substantially (rapid WHAM)
+    AlignedDoubleVector boltzmannContrib;
+    AlignedDoubleVector numerator;    //!< sum of the histograms divided by g, padded
+    AlignedDoubleVector profile;      //!< padded copy of the profile, used in calc_z
+    std::vector<double> coeff;        //!< N/g exp(z - s) for each histogram, used in calc_profile
+    double              contribLimit; //!< smaller contributions are neglected with rapid WHAM
+} t_WhamMatrix;
+
+//! Return the umbrella potential over kT of pull coordinate \p j of \p window in bin \p k
+static double umbrellaPotentialOverKT(const t_UmbrellaWindow*  window,
+                                      int                      j,
+                                      int                      k,
+                                      const t_UmbrellaOptions* opt)
 {
-    int        i, j, k, nGrptot = 0, nContrib = 0, nTot = 0;
-    double     U, min = opt->min, dz = opt->dz, temp, ztot_half, distance, ztot, contrib1, contrib2;
-    gmx_bool   bAnyContrib;
-    static int bFirst = 1;
-    static double wham_contrib_lim;
+    double ztot      = opt->max - opt->min;
+    double ztot_half = ztot / 2;
+    double temp      = (1.0 * k + 0.5) * opt->dz + opt->min;
+    double distance  = temp - window->pos[j]; /* distance to umbrella center */
+    double U;
 
-    if (bFirst)
-    {
-        for (i = 0; i < nWindows; ++i)
+    if (opt->bCycl)
+    {                             /* in cyclic wham:             */
+        if (distance > ztot_half) /*    |distance| < ztot_half   */
+        {
+            distance -= ztot;
+        }
+        else if (distance < -ztot_half)
         {
-            nGrptot += window[i].nPull;
+            distance += ztot;
         }
-        wham_contrib_lim = opt->Tolerance / nGrptot;
     }
 
-    ztot      = opt->max - opt->min;
-    ztot_half = ztot / 2;
+    if (!opt->bTab)
+    {
+        U = 0.5 * window->k[j] * gmx::square(distance); /* harmonic potential assumed. */
+    }
+    else
+    {
+        U = tabulated_pot(distance, opt); /* Use tabulated potential     */
+    }
+    return U / (gmx::c_boltz * opt->Temperature);
+}
 
-    for (i = 0; i < nWindows; ++i)
+/*! \brief Set up the Boltzmann factors for all histograms of \p window
+ *
+ * Only depends on the positions and force constants of the histograms, so it can
+ * be called before the statistical inefficiencies g are known. Must be called
+ * again whenever these change, followed by setup_wham_numerator().
+ */
+static void setup_wham_matrix(t_WhamMatrix*            m,
+                              const t_UmbrellaWindow*  window,
+                              int                      nWindows,
+                              const t_UmbrellaOptions* opt)
+{
+    m->histWin.clear();
+    m->histPull.clear();
+    for (int i = 0; i < nWindows; ++i)
     {
-        if (!window[i].bContrib)
+        for (int j = 0; j < window[i].nPull; ++j)
         {
-            snew(window[i].bContrib, window[i].nPull);
+            m->histWin.push_back(i);
+            m->histPull.push_back(j);
         }
-        for (j = 0; j < window[i].nPull; ++j)
+    }
+    m->nHist      = m->histWin.size();
+    m->nBin       = opt->bins;
+    m->nBinPadded = ((opt->bins + c_whamSimdWidth - 1) / c_whamSimdWidth) * c_whamSimdWidth;
+    m->logScale.assign(m->nHist, 0.);
+    m->boltzmann.assign(static_cast<size_t>(m->nHist) * m->nBinPadded, 0.);
+    m->coeff.assign(m->nHist, 0.);
+    m->profile.assign(m->nBinPadded, 0.);
+    m->contribLimit = opt->Tolerance / m->nHist;
+
+#pragma omp parallel for schedule(static)
+    for (int h = 0; h < m->nHist; ++h)
+    {
+        try
         {
-            if (!window[i].bContrib[j])
+            const t_UmbrellaWindow* win = window + m->histWin[h];
+            const int               j   = m->histPull[h];
+            double* row = m->boltzmann.data() + static_cast<size_t>(h) * m->nBinPadded;
+            double  s   = 1e20;
+
+            for (int k = 0; k < m->nBin; ++k)
             {
-                snew(window[i].bContrib[j], opt->bins);
+                row[k] = umbrellaPotentialOverKT(win, j, k, opt);
+                s      = std::min(s, row[k]);
             }
-            bAnyContrib = FALSE;
-            for (k = 0; k < opt->bins; ++k)
+            for (int k = 0; k < m->nBin; ++k)
             {
-                temp     = (1.0 * k + 0.5) * dz + min;
-                distance = temp - window[i].pos[j]; /* distance to umbrella center */
-                if (opt->bCycl)
-                {                             /* in cyclic wham:             */
-                    if (distance > ztot_half) /*    |distance| < ztot_half   */
-                    {
-                        distance -= ztot;
-                    }
-                    else if (distance < -ztot_half)
-                    {
-                        distance += ztot;
-                    }
-                }
-                /* Note: there are two contributions to bin k in the wham equations:
-                   i)  N[j]*exp(- U/(c_boltz*opt->Temperature) + window[i].z[j])
-                   ii) exp(- U/(c_boltz*opt->Temperature))
-                   where U is the umbrella potential
-                   If any of these number is larger wham_contrib_lim, I set contrib=TRUE
-                 */
-
-                if (!opt->bTab)
-                {
-                    U = 0.5 * window[i].k[j] * gmx::square(distance); /* harmonic potential assumed. */
-                }
-                else
-                {
-                    U = tabulated_pot(distance, opt); /* Use tabulated potential     */
-                }
-                contrib1 = profile[k] * std::exp(-U / (gmx::c_boltz * opt->Temperature));
-                contrib2 = window[i].N[j]
-                           * std::exp(-U / (gmx::c_boltz * opt->Temperature) + window[i].z[j]);
-                window[i].bContrib[j][k] = (contrib1 > wham_contrib_lim || contrib2 > wham_contrib_lim);
-                bAnyContrib              = bAnyContrib || window[i].bContrib[j][k];
-                if (window[i].bContrib[j][k])
-                {
-                    nContrib++;
-                }
-                nTot++;
+                row[k] = std::exp(-row[k] + s);
             }
-            /* If this histo is far outside min and max all bContrib may be FALSE,
-               causing a floating point exception later on. To avoid that, switch
-               them all to true.*/
-            if (!bAnyContrib)
+            m->logScale[h] = s;
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    m->boltzmannContrib = m->boltzmann;
+}
+
+/*! \brief Set up the WHAM numerator, the sum of all histograms weighted by bsWeight/g
+ *
+ * Must be called after setup_wham_matrix() and again whenever N, g, bsWeight
+ * or the histograms change.
+ */
+static void setup_wham_numerator(t_WhamMatrix* m, const t_UmbrellaWindow* window)
+{
+    m->numerator.assign(m->nBinPadded, 0.);
+    for (int h = 0; h < m->nHist; ++h)
+    {
+        const t_UmbrellaWindow* win  = window + m->histWin[h];
+        const int               j    = m->histPull[h];
+        const double            invg = 1.0 / win->g[j] * win->bsWeight[j];
+        for (int k = 0; k < m->nBin; ++k)
+        {
+            m->numerator[k] += invg * win->Histo[j][k];
+        }
+    }
+}
+
+/*! \brief
+ * Check which bins substiantially contribute (accelerates WHAM)
+ *
+ * Don't worry, that routine does not mean we compute the PMF in limited precision.
+ * After rapid convergence (using only substiantal contributions), we always switch to
+ * full precision.
+ * Bins that do not contribute are set to zero in m->boltzmannContrib.
+ */
+static void setup_acc_wham(const double*           profile,
+                           const t_UmbrellaWindow* window,
+                           t_WhamMatrix*           m,
+                           const t_UmbrellaOptions* opt,
+                           gmx_bool                bPrint)
+{
+    static gmx_bool bFirst   = TRUE;
+    int             nContrib = 0, nTot = 0;
+
+#pragma omp parallel for schedule(static) reduction(+ : nContrib, nTot)
+    for (int h = 0; h < m->nHist; ++h)
+    {
+        const t_UmbrellaWindow* win = window + m->histWin[h];
+        const int               j   = m->histPull[h];
+        const double* row = m->boltzmann.data() + static_cast<size_t>(h) * m->nBinPadded;
+        double* rowContrib = m->boltzmannContrib.data() + static_cast<size_t>(h) * m->nBinPadded;
+        /* Note: there are two contributions to bin k in the wham equations:
+           i)  N[j]*exp(- U/(c_boltz*opt->Temperature) + window[i].z[j])
+           ii) exp(- U/(c_boltz*opt->Temperature))
+           where U is the umbrella potential
+           If any of these number is larger wham_contrib_lim, I set contrib=TRUE
+         */
+        const double scale1      = std::exp(-m->logScale[h]);
+        const double scale2      = win->N[j] * std::exp(win->z[j] - m->logScale[h]);
+        gmx_bool     bAnyContrib = FALSE;
+        for (int k = 0; k < m->nBin; ++k)
+        {
+            double   contrib1 = profile[k] * row[k] * scale1;
+            double   contrib2 = row[k] * scale2;
+            gmx_bool bContrib = (contrib1 > m->contribLimit || contrib2 > m->contribLimit);
+            rowContrib[k]     = bContrib ? row[k] : 0.;
+            bAnyContrib       = bAnyContrib || bContrib;
+            if (bContrib)
             {
-                for (k = 0; k < opt->bins; ++k)
-                {
-                    window[i].bContrib[j][k] = TRUE;
-                }
+                nContrib++;
             }
+            nTot++;
+        }
+        /* If this histo is far outside min and max all bContrib may be FALSE,
+           causing a floating point exception later on. To avoid that, switch
+           them all to true.*/
+        if (!bAnyContrib)
+        {
+            std::copy(row, row + m->nBin, rowContrib);
         }
     }
-    if (bFirst)
+    if (bFirst && bPrint)
     {
         printf("Initialized rapid wham stuff (contrib tolerance %g)\n"
                "Evaluating only %d of %d expressions.\n\n",
-               wham_contrib_lim,
+               m->contribLimit,
                nContrib,
                nTot);
+        bFirst = FALSE;
     }
 
-    if (opt->verbose)
+    if (opt->verbose && bPrint)
     {
         printf("Updated rapid wham stuff. (evaluating only %d of %d contributions)\n", nContrib, nTot);
     }
-    bFirst = 0;
 }
 
 //! Compute the PMF (one of the two main WHAM routines)
-static void calc_profile(double* profile, t_UmbrellaWindow* window, int nWindows, t_UmbrellaOptions* opt, gmx_bool bExact)
+static void calc_profile(double*                 profile,
+                         const t_UmbrellaWindow* window,
+                         t_WhamMatrix*           m,
+                         gmx_bool                bExact)
 {
-    double ztot_half, ztot, min = opt->min, dz = opt->dz;
-
-    ztot      = opt->max - opt->min;
-    ztot_half = ztot / 2;
+    for (int h = 0; h < m->nHist; ++h)
+    {
+        const t_UmbrellaWindow* win = window + m->histWin[h];
+        const int               j   = m->histPull[h];
+        m->coeff[h] = 1.0 / win->g[j] * win->bsWeight[j] * win->N[j]
+                      * std::exp(win->z[j] - m->logScale[h]);
+    }
+    const double* boltzmann = bExact ? m->boltzmann.data() : m->boltzmannContrib.data();
+    const int     nBlock    = (m->nBinPadded + c_whamBinBlockSize - 1) / c_whamBinBlockSize;
 
-#pragma omp parallel
+#pragma omp parallel for schedule(static)
+    for (int b = 0; b < nBlock; ++b)
     {
         try
         {
-            int nthreads  = gmx_omp_get_max_threads();
-            int thread_id = gmx_omp_get_thread_num();
-            int i;
-            int i0 = thread_id * opt->bins / nthreads;
-            int i1 = std::min(opt->bins, ((thread_id + 1) * opt->bins) / nthreads);
+            const int i0 = b * c_whamBinBlockSize;
+            const int n  = std::min(c_whamBinBlockSize, m->nBinPadded - i0);
 
-            for (i = i0; i < i1; ++i)
+            alignas(GMX_SIMD_ALIGNMENT) double denom[c_whamBinBlockSize] = { 0 };
+            for (int h = 0; h < m->nHist; ++h)
             {
-                int    j, k;
-                double num, denom, invg, temp = 0, distance, U = 0;
-                num = denom = 0.;
-                for (j = 0; j < nWindows; ++j)
+                const double* row = boltzmann + static_cast<size_t>(h) * m->nBinPadded + i0;
+#if GMX_SIMD_HAVE_DOUBLE
+                const gmx::SimdDouble coeff(m->coeff[h]);
+                for (int i = 0; i < n; i += GMX_SIMD_DOUBLE_WIDTH)
                 {
-                    for (k = 0; k < window[j].nPull; ++k)
-                    {
-                        invg = 1.0 / window[j].g[k] * window[j].bsWeight[k];
-                        temp = (1.0 * i + 0.5) * dz + min;
-                        num += invg * window[j].Histo[k][i];
-
-                        if (!(bExact || window[j].bContrib[k][i]))
-                        {
-                            continue;
-                        }
-                        distance = temp - window[j].pos[k]; /* distance to umbrella center */
-                        if (opt->bCycl)
-                        {                             /* in cyclic wham:             */
-                            if (distance > ztot_half) /*    |distance| < ztot_half   */
-                            {
-                                distance -= ztot;
-                            }
-                            else if (distance < -ztot_half)
-                            {
-                                distance += ztot;
-                            }
-                        }
-
-                        if (!opt->bTab)
-                        {
-                            U = 0.5 * window[j].k[k] * gmx::square(distance); /* harmonic potential assumed. */
-                        }
-                        else
-                        {
-                            U = tabulated_pot(distance, opt); /* Use tabulated potential     */
-                        }
-                        denom += invg * window[j].N[k]
-                                 * std::exp(-U / (gmx::c_boltz * opt->Temperature) + window[j].z[k]);
-                    }
+                    gmx::store(denom + i,
+                               gmx::fma(coeff,
+                                        gmx::load<gmx::SimdDouble>(row + i),
+                                        gmx::load<gmx::SimdDouble>(denom + i)));
+                }
+#else
+                for (int i = 0; i < n; ++i)
+                {
+                    denom[i] += m->coeff[h] * row[i];
                 }
-                profile[i] = num / denom;
+#endif
+            }
+            for (int i = i0; i < std::min(i0 + n, m->nBin); ++i)
+            {
+                profile[i] = m->numerator[i] / denom[i - i0];
             }
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
@@ -710,93 +799,46 @@ static void calc_profile(double* profile, t_UmbrellaWindow* window, int nWindows
 }
 
 //! Compute the free energy offsets z (one of the two main WHAM routines)
-static double calc_z(const double* profile, t_UmbrellaWindow* window, int nWindows, t_UmbrellaOptions* opt, gmx_bool bExact)
+static double calc_z(const double* profile, t_UmbrellaWindow* window, t_WhamMatrix* m, gmx_bool bExact)
 {
-    double min = opt->min, dz = opt->dz, ztot_half, ztot;
     double maxglob = -1e20;
 
-    ztot      = opt->max - opt->min;
-    ztot_half = ztot / 2;
+    std::copy(profile, profile + m->nBin, m->profile.begin());
+    const double* boltzmann = bExact ? m->boltzmann.data() : m->boltzmannContrib.data();
+    const double* prof      = m->profile.data();
 
-#pragma omp parallel
+#pragma omp parallel for schedule(static) reduction(max : maxglob)
+    for (int h = 0; h < m->nHist; ++h)
     {
-        try
+        const double* row = boltzmann + static_cast<size_t>(h) * m->nBinPadded;
+        double        total;
+#if GMX_SIMD_HAVE_DOUBLE
+        gmx::SimdDouble sum(0.0);
+        for (int k = 0; k < m->nBinPadded; k += GMX_SIMD_DOUBLE_WIDTH)
         {
-            int    nthreads  = gmx_omp_get_max_threads();
-            int    thread_id = gmx_omp_get_thread_num();
-            int    i;
-            int    i0     = thread_id * nWindows / nthreads;
-            int    i1     = std::min(nWindows, ((thread_id + 1) * nWindows) / nthreads);
-            double maxloc = -1e20;
-
-            for (i = i0; i < i1; ++i)
-            {
-                double total = 0, temp, distance, U = 0;
-                int    j, k;
-
-                for (j = 0; j < window[i].nPull; ++j)
-                {
-                    total = 0;
-                    for (k = 0; k < window[i].nBin; ++k)
-                    {
-                        if (!(bExact || window[i].bContrib[j][k]))
-                        {
-                            continue;
-                        }
-                        temp     = (1.0 * k + 0.5) * dz + min;
-                        distance = temp - window[i].pos[j]; /* distance to umbrella center */
-                        if (opt->bCycl)
-                        {                             /* in cyclic wham:             */
-                            if (distance > ztot_half) /*    |distance| < ztot_half   */
-                            {
-                                distance -= ztot;
-                            }
-                            else if (distance < -ztot_half)
-                            {
-                                distance += ztot;
-                            }
-                        }
-
-                        if (!opt->bTab)
-                        {
-                            U = 0.5 * window[i].k[j] * gmx::square(distance); /* harmonic potential assumed. */
-                        }
-                        else
-                        {
-                            U = tabulated_pot(distance, opt); /* Use tabulated potential     */
-                        }
-                        total += profile[k] * std::exp(-U / (gmx::c_boltz * opt->Temperature));
-                    }
-                    /* Avoid floating point exception if window is far outside min and max */
-                    if (total != 0.0)
-                    {
-                        total = -std::log(total);
-                    }
-                    else
-                    {
-                        total = 1000.0;
-                    }
-                    temp = std::abs(total - window[i].z[j]);
-                    if (temp > maxloc)
-                    {
-                        maxloc = temp;
-                    }
-                    window[i].z[j] = total;
-                }
-            }
-            /* Now get maximum maxloc from the threads and put in maxglob */
-            if (maxloc > maxglob)
-            {
-#pragma omp critical
-                {
-                    if (maxloc > maxglob)
-                    {
-                        maxglob = maxloc;
-                    }
-                }
-            }
+            sum = gmx::fma(
+                    gmx::load<gmx::SimdDouble>(row + k), gmx::load<gmx::SimdDouble>(prof + k), sum);
         }
-        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        total = gmx::reduce(sum);
+#else
+        total = 0;
+        for (int k = 0; k < m->nBin; ++k)
+        {
+            total += row[k] * prof[k];
+        }
+#endif
+        /* Avoid floating point exception if window is far outside min and max */
+        if (total != 0.0)
+        {
+            total = m->logScale[h] - std::log(total);
+        }
+        else
+        {
+            total = 1000.0;
+        }
+        double* z = window[m->histWin[h]].z + m->histPull[h];
+        maxglob   = std::max(maxglob, std::abs(total - *z));
+        *z        = total;
     }
 
     return maxglob;
@@ -956,7 +998,6 @@ static void copy_pullgrp_to_synthwindow(t_UmbrellaWindow* synthWindow, t_Umbrell
     synthWindow->pos[0]      = thisWindow->pos[pullid];
     synthWindow->z[0]        = thisWindow->z[pullid];
     synthWindow->k[0]        = thisWindow->k[pullid];
-    synthWindow->bContrib[0] = thisWindow->bContrib[pullid];
     synthWindow->g[0]        = thisWindow->g[pullid];
     synthWindow->bsWeight[0] = thisWindow->bsWeight[pullid];
 }
@@ -1108,7 +1149,6 @@ static void create_synthetic_histo(t_UmbrellaWindow*  synthWindow,
     synthWindow->pos[0]      = thisWindow->pos[pullid];
     synthWindow->z[0]        = thisWindow->z[pullid];
     synthWindow->k[0]        = thisWindow->k[pullid];
-    synthWindow->bContrib[0] = thisWindow->bContrib[pullid];
     synthWindow->g[0]        = thisWindow->g[pullid];
     synthWindow->bsWeight[0] = thisWindow->bsWeight[pullid];
 
@@ -1284,7 +1324,56 @@ static void setRandomBsWeights(t_UmbrellaWindow* synthwin, int nAllPull, t_Umbre
     sfree(r);
 }
 
-//! The main bootstrapping routine
+/*! \brief Run WHAM on one set of bootstrapped histograms, using \p profile as initial guess
+ *
+ * Returns the number of iterations, the final maximum change is returned in \p maxchange.
+ * With \p bPrint, the progress is printed like for the WHAM on the original histograms.
+ */
+static int bootstrap_wham(double*                  bsProfile,
+                          const double*            profile,
+                          t_UmbrellaWindow*        synthWindow,
+                          int                      nAllPull,
+                          t_WhamMatrix*            whamMatrix,
+                          const t_UmbrellaOptions* opt,
+                          gmx_bool                 bPrint,
+                          double*                  maxchange)
+{
+    int      i      = 0;
+    gmx_bool bExact = FALSE;
+
+    setup_wham_matrix(whamMatrix, synthWindow, nAllPull, opt);
+    setup_wham_numerator(whamMatrix, synthWindow);
+    *maxchange = 1e20;
+    std::memcpy(bsProfile, profile, opt->bins * sizeof(double)); /* use profile as guess */
+    do
+    {
+        if ((i % opt->stepUpdateContrib) == 0)
+        {
+            setup_acc_wham(bsProfile, synthWindow, whamMatrix, opt, bPrint);
+        }
+        if (*maxchange < opt->Tolerance)
+        {
+            bExact = TRUE;
+        }
+        if (bPrint && ((i % opt->stepchange) == 0 || i == 1) && i != 0)
+        {
+            printf("\t%4d) Maximum change %e\n", i, *maxchange);
+        }
+        calc_profile(bsProfile, synthWindow, whamMatrix, bExact);
+        i++;
+    } while ((*maxchange = calc_z(bsProfile, synthWindow, whamMatrix, bExact)) > opt->Tolerance
+             || !bExact);
+
+    return i;
+}
+
+/*! \brief The main bootstrapping routine
+ *
+ * The bootstraps are processed in batches of one bootstrap per OpenMP thread.
+ * The synthetic histograms of a batch are generated serially, so the random
+ * number sequence and hence the result do not depend on the number of threads.
+ * The WHAM iterations of the bootstraps in a batch then run concurrently.
+ */
 static void do_bootstrapping(const char*        fnres,
                              const char*        fnprof,
                              const char*        fnhist,
@@ -1295,12 +1384,11 @@ static void do_bootstrapping(const char*        fnres,
                              int                nWindows,
                              t_UmbrellaOptions* opt)
 {
-    t_UmbrellaWindow* synthWindow;
-    double *          bsProfile, *bsProfiles_av, *bsProfiles_av2, maxchange = 1e20, tmp, stddev;
-    int               i, j, *randomArray = nullptr, winid, pullid, ib;
-    int               iAllPull, nAllPull, *allPull_winId, *allPull_pullId;
-    FILE*             fp;
-    gmx_bool          bExact = FALSE;
+    t_UmbrellaWindow** synthWindows;
+    double **          bsProfiles, *bsProfiles_av, *bsProfiles_av2, *maxchange, tmp, stddev;
+    int                i, j, *randomArray = nullptr, winid, pullid, ib, ibatch, nBatch, nThisBatch;
+    int                iAllPull, nAllPull, *allPull_winId, *allPull_pullId, *nIter;
+    FILE*              fp;
 
     /* init random generator */
     if (opt->bsSeed == 0)
@@ -1309,9 +1397,17 @@ static void do_bootstrapping(const char*        fnres,
     }
     opt->rng.seed(opt->bsSeed);
 
-    snew(bsProfile, opt->bins);
+    nBatch = std::max(1, std::min(gmx_omp_get_max_threads(), opt->nBootStrap));
+    snew(bsProfiles, nBatch);
+    for (ibatch = 0; ibatch < nBatch; ibatch++)
+    {
+        snew(bsProfiles[ibatch], opt->bins);
+    }
     snew(bsProfiles_av, opt->bins);
     snew(bsProfiles_av2, opt->bins);
+    snew(maxchange, nBatch);
+    snew(nIter, nBatch);
+    std::vector<t_WhamMatrix> whamMatrices(nBatch);
 
     /* Create array of all pull groups. Note that different windows
        may have different nr of pull groups
@@ -1335,24 +1431,28 @@ static void do_bootstrapping(const char*        fnres,
         }
     }
 
-    /* setup stuff for synthetic windows */
-    snew(synthWindow, nAllPull);
-    for (i = 0; i < nAllPull; i++)
+    /* setup stuff for synthetic windows, one set for each bootstrap in a batch */
+    snew(synthWindows, nBatch);
+    for (ibatch = 0; ibatch < nBatch; ibatch++)
     {
-        synthWindow[i].nPull = 1;
-        synthWindow[i].nBin  = opt->bins;
-        snew(synthWindow[i].Histo, 1);
-        if (opt->bsMethod == bsMethod_traj || opt->bsMethod == bsMethod_trajGauss)
+        snew(synthWindows[ibatch], nAllPull);
+        for (i = 0; i < nAllPull; i++)
         {
-            snew(synthWindow[i].Histo[0], opt->bins);
+            t_UmbrellaWindow* synthWindow = synthWindows[ibatch] + i;
+            synthWindow->nPull            = 1;
+            synthWindow->nBin             = opt->bins;
+            snew(synthWindow->Histo, 1);
+            if (opt->bsMethod == bsMethod_traj || opt->bsMethod == bsMethod_trajGauss)
+            {
+                snew(synthWindow->Histo[0], opt->bins);
+            }
+            snew(synthWindow->N, 1);
+            snew(synthWindow->pos, 1);
+            snew(synthWindow->z, 1);
+            snew(synthWindow->k, 1);
+            snew(synthWindow->g, 1);
+            snew(synthWindow->bsWeight, 1);
         }
-        snew(synthWindow[i].N, 1);
-        snew(synthWindow[i].pos, 1);
-        snew(synthWindow[i].z, 1);
-        snew(synthWindow[i].k, 1);
-        snew(synthWindow[i].bContrib, 1);
-        snew(synthWindow[i].g, 1);
-        snew(synthWindow[i].bsWeight, 1);
     }
 
     switch (opt->bsMethod)
@@ -1363,11 +1463,14 @@ static void do_bootstrapping(const char*        fnres,
             break;
         case bsMethod_BayesianHist:
             /* just copy all histogams into synthWindow array */
-            for (i = 0; i < nAllPull; i++)
+            for (ibatch = 0; ibatch < nBatch; ibatch++)
             {
-                winid  = allPull_winId[i];
-                pullid = allPull_pullId[i];
-                copy_pullgrp_to_synthwindow(synthWindow + i, window + winid, pullid);
+                for (i = 0; i < nAllPull; i++)
+                {
+                    winid  = allPull_winId[i];
+                    pullid = allPull_pullId[i];
+                    copy_pullgrp_to_synthwindow(synthWindows[ibatch] + i, window + winid, pullid);
+                }
             }
             break;
         case bsMethod_traj:
@@ -1377,94 +1480,114 @@ static void do_bootstrapping(const char*        fnres,
 
     /* do bootstrapping */
     fp = xvgropen(fnprof, "Bootstrap profiles", xlabel, ylabel, opt->oenv);
-    for (ib = 0; ib < opt->nBootStrap; ib++)
+    for (ib = 0; ib < opt->nBootStrap; ib += nBatch)
     {
-        printf("  *******************************************\n"
-               "  ******** Start bootstrap nr %d ************\n"
-               "  *******************************************\n",
-               ib + 1);
+        nThisBatch = std::min(nBatch, opt->nBootStrap - ib);
 
-        switch (opt->bsMethod)
+        /* generate the histograms of this batch in order of the bootstraps */
+        for (ibatch = 0; ibatch < nThisBatch; ibatch++)
         {
-            case bsMethod_hist:
-                /* bootstrap complete histograms from given histograms */
-                srenew(randomArray, nAllPull);
-                getRandomIntArray(nAllPull, opt->histBootStrapBlockLength, randomArray, &opt->rng);
-                for (i = 0; i < nAllPull; i++)
-                {
-                    winid  = allPull_winId[randomArray[i]];
-                    pullid = allPull_pullId[randomArray[i]];
-                    copy_pullgrp_to_synthwindow(synthWindow + i, window + winid, pullid);
-                }
-                break;
-            case bsMethod_BayesianHist:
-                /* keep histos, but assign random weights ("Bayesian bootstrap") */
-                setRandomBsWeights(synthWindow, nAllPull, opt);
-                break;
-            case bsMethod_traj:
-            case bsMethod_trajGauss:
-                /* create new histos from given histos, that is generate new hypothetical
-                   trajectories */
-                for (i = 0; i < nAllPull; i++)
-                {
-                    winid  = allPull_winId[i];
-                    pullid = allPull_pullId[i];
-                    create_synthetic_histo(synthWindow + i, window + winid, pullid, opt);
-                }
-                break;
-        }
+            t_UmbrellaWindow* synthWindow = synthWindows[ibatch];
 
-        /* write histos in case of verbose output */
-        if (opt->bs_verbose)
-        {
-            print_histograms(fnhist, synthWindow, nAllPull, ib, opt, xlabel);
+            printf("  *******************************************\n"
+                   "  ******** Start bootstrap nr %d ************\n"
+                   "  *******************************************\n",
+                   ib + ibatch + 1);
+
+            switch (opt->bsMethod)
+            {
+                case bsMethod_hist:
+                    /* bootstrap complete histograms from given histograms */
+                    srenew(randomArray, nAllPull);
+                    getRandomIntArray(
+                            nAllPull, opt->histBootStrapBlockLength, randomArray, &opt->rng);
+                    for (i = 0; i < nAllPull; i++)
+                    {
+                        winid  = allPull_winId[randomArray[i]];
+                        pullid = allPull_pullId[randomArray[i]];
+                        copy_pullgrp_to_synthwindow(synthWindow + i, window + winid, pullid);
+                    }
+                    break;
+                case bsMethod_BayesianHist:
+                    /* keep histos, but assign random weights ("Bayesian bootstrap") */
+                    setRandomBsWeights(synthWindow, nAllPull, opt);
+                    /* start each bootstrap from the converged offsets of the given histograms */
+                    for (i = 0; i < nAllPull; i++)
+                    {
+                        synthWindow[i].z[0] = window[allPull_winId[i]].z[allPull_pullId[i]];
+                    }
+                    break;
+                case bsMethod_traj:
+                case bsMethod_trajGauss:
+                    /* create new histos from given histos, that is generate new hypothetical
+                       trajectories */
+                    for (i = 0; i < nAllPull; i++)
+                    {
+                        winid  = allPull_winId[i];
+                        pullid = allPull_pullId[i];
+                        create_synthetic_histo(synthWindow + i, window + winid, pullid, opt);
+                    }
+                    break;
+            }
+
+            /* write histos in case of verbose output */
+            if (opt->bs_verbose)
+            {
+                print_histograms(fnhist, synthWindow, nAllPull, ib + ibatch, opt, xlabel);
+            }
         }
 
         /* do wham */
-        i         = 0;
-        bExact    = FALSE;
-        maxchange = 1e20;
-        std::memcpy(bsProfile, profile, opt->bins * sizeof(double)); /* use profile as guess */
-        do
+#pragma omp parallel for schedule(dynamic) if (nThisBatch > 1)
+        for (ibatch = 0; ibatch < nThisBatch; ibatch++)
         {
-            if ((i % opt->stepUpdateContrib) == 0)
+            try
             {
-                setup_acc_wham(bsProfile, synthWindow, nAllPull, opt);
+                nIter[ibatch] = bootstrap_wham(bsProfiles[ibatch],
+                                               profile,
+                                               synthWindows[ibatch],
+                                               nAllPull,
+                                               &whamMatrices[ibatch],
+                                               opt,
+                                               nThisBatch == 1,
+                                               &maxchange[ibatch]);
             }
-            if (maxchange < opt->Tolerance)
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        for (ibatch = 0; ibatch < nThisBatch; ibatch++)
+        {
+            double* bsProfile = bsProfiles[ibatch];
+
+            if (nThisBatch > 1)
             {
-                bExact = TRUE;
+                printf("\tBootstrap nr %d:", ib + ibatch + 1);
             }
-            if (((i % opt->stepchange) == 0 || i == 1) && i != 0)
+            printf("\tConverged in %d iterations. Final maximum change %g\n",
+                   nIter[ibatch],
+                   maxchange[ibatch]);
+
+            if (opt->bLog)
             {
-                printf("\t%4d) Maximum change %e\n", i, maxchange);
+                prof_normalization_and_unit(bsProfile, opt);
             }
-            calc_profile(bsProfile, synthWindow, nAllPull, opt, bExact);
-            i++;
-        } while ((maxchange = calc_z(bsProfile, synthWindow, nAllPull, opt, bExact)) > opt->Tolerance
-                 || !bExact);
-        printf("\tConverged in %d iterations. Final maximum change %g\n", i, maxchange);
-
-        if (opt->bLog)
-        {
-            prof_normalization_and_unit(bsProfile, opt);
-        }
 
-        /* symmetrize profile around z=0 */
-        if (opt->bSym)
-        {
-            symmetrizeProfile(bsProfile, opt);
-        }
+            /* symmetrize profile around z=0 */
+            if (opt->bSym)
+            {
+                symmetrizeProfile(bsProfile, opt);
+            }
 
-        /* save stuff to get average and stddev */
-        for (i = 0; i < opt->bins; i++)
-        {
-            tmp = bsProfile[i];
-            bsProfiles_av[i] += tmp;
-            bsProfiles_av2[i] += tmp * tmp;
-            fprintf(fp, "%e\t%e\n", (i + 0.5) * opt->dz + opt->min, tmp);
+            /* save stuff to get average and stddev */
+            for (i = 0; i < opt->bins; i++)
+            {
+                tmp = bsProfile[i];
+                bsProfiles_av[i] += tmp;
+                bsProfiles_av2[i] += tmp * tmp;
+                fprintf(fp, "%e\t%e\n", (i + 0.5) * opt->dz + opt->min, tmp);
+            }
+            fprintf(fp, "%s\n", output_env_get_print_xvgr_codes(opt->oenv) ? "&" : "");
         }
-        fprintf(fp, "%s\n", output_env_get_print_xvgr_codes(opt->oenv) ? "&" : "");
     }
     xvgrclose(fp);
 
@@ -1734,7 +1857,10 @@ static void read_tpr_header(const char* fn, t_UmbrellaHeader* header, t_Umbrella
         printf("\tUse option -v to see this output for all input tpr files\n\n");
     }
 
-    first = 0;
+    if (first)
+    {
+        first = 0;
+    }
 }
 
 //! Read pullx.xvg or pullf.xvg
@@ -1915,7 +2041,6 @@ static void read_pull_xf(const char*        fn,
         snew(window->Ntot, window->nPull);
         snew(window->g, window->nPull);
         snew(window->bsWeight, window->nPull);
-        window->bContrib = nullptr;
 
         if (opt->bCalcTauInt)
         {
@@ -2110,7 +2235,46 @@ static void read_pull_xf(const char*        fn,
     }
 }
 
-//! read pullf-files.dat or pullx-files.dat and tpr-files.dat
+/*! \brief Read the \p i'th pair of tpr and pullx/pullf file
+ *
+ * Reads the data into \p window, or only determines the range of the data
+ * in \p mintmp and \p maxtmp when \p window is nullptr.
+ */
+static void read_tpr_pullxf_pair(char**             fnTprs,
+                                 char**             fnPull,
+                                 int                i,
+                                 t_UmbrellaHeader*  header,
+                                 t_UmbrellaWindow*  window,
+                                 t_UmbrellaOptions* opt,
+                                 real*              mintmp,
+                                 real*              maxtmp)
+{
+    if (whaminFileType(fnTprs[i]) != whamin_tpr)
+    {
+        gmx_fatal(FARGS, "Expected the %d'th file in input file to be a tpr file\n", i);
+    }
+    read_tpr_header(fnTprs[i], header, opt, (opt->nCoordsel > 0) ? &opt->coordsel[i] : nullptr);
+    if (whaminFileType(fnPull[i]) != whamin_pullxf)
+    {
+        gmx_fatal(
+                FARGS, "Expected the %d'th file in input file to be a xvg (pullx/pullf) file\n", i);
+    }
+    read_pull_xf(fnPull[i],
+                 header,
+                 window,
+                 opt,
+                 window == nullptr,
+                 mintmp,
+                 maxtmp,
+                 (opt->nCoordsel > 0) ? &opt->coordsel[i] : nullptr);
+}
+
+/*! \brief read pullf-files.dat or pullx-files.dat and tpr-files.dat
+ *
+ * The first tpr and pullx/pullf file pair is read on its own, since it prints
+ * the layout of the files. Without -v, the other files are then read concurrently
+ * into their own windows. \p header returns the header of the last tpr file.
+ */
 static void read_tpr_pullxf_files(char**             fnTprs,
                                   char**             fnPull,
                                   int                nfiles,
@@ -2118,47 +2282,52 @@ static void read_tpr_pullxf_files(char**             fnTprs,
                                   t_UmbrellaWindow*  window,
                                   t_UmbrellaOptions* opt)
 {
-    int  i;
-    real mintmp, maxtmp;
+    int               i;
+    t_UmbrellaHeader* headers;
+    real *            mintmp, *maxtmp;
+    const int         nfilesParallel = opt->verbose ? 0 : nfiles - 1;
 
     printf("Reading %d tpr and pullx/pullf files\n", nfiles);
 
+    snew(headers, nfiles);
+
     /* min and max not given? */
     if (opt->bAuto)
     {
         printf("Automatic determination of boundaries...\n");
+        snew(mintmp, nfiles);
+        snew(maxtmp, nfiles);
+        for (i = 0; i < nfiles - nfilesParallel; i++)
+        {
+            read_tpr_pullxf_pair(
+                    fnTprs, fnPull, i, &headers[i], nullptr, opt, &mintmp[i], &maxtmp[i]);
+        }
+#pragma omp parallel for schedule(dynamic)
+        for (i = nfiles - nfilesParallel; i < nfiles; i++)
+        {
+            try
+            {
+                read_tpr_pullxf_pair(
+                        fnTprs, fnPull, i, &headers[i], nullptr, opt, &mintmp[i], &maxtmp[i]);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
         opt->min = 1e20;
         opt->max = -1e20;
         for (i = 0; i < nfiles; i++)
         {
-            if (whaminFileType(fnTprs[i]) != whamin_tpr)
-            {
-                gmx_fatal(FARGS, "Expected the %d'th file in input file to be a tpr file\n", i);
-            }
-            read_tpr_header(fnTprs[i], header, opt, (opt->nCoordsel > 0) ? &opt->coordsel[i] : nullptr);
-            if (whaminFileType(fnPull[i]) != whamin_pullxf)
-            {
-                gmx_fatal(FARGS,
-                          "Expected the %d'th file in input file to be a xvg (pullx/pullf) file\n",
-                          i);
-            }
-            read_pull_xf(fnPull[i],
-                         header,
-                         nullptr,
-                         opt,
-                         TRUE,
-                         &mintmp,
-                         &maxtmp,
-                         (opt->nCoordsel > 0) ? &opt->coordsel[i] : nullptr);
-            if (maxtmp > opt->max)
+            if (maxtmp[i] > opt->max)
             {
-                opt->max = maxtmp;
+                opt->max = maxtmp[i];
             }
-            if (mintmp < opt->min)
+            if (mintmp[i] < opt->min)
             {
-                opt->min = mintmp;
+                opt->min = mintmp[i];
             }
+            sfree(headers[i].pcrd);
         }
+        sfree(mintmp);
+        sfree(maxtmp);
         printf("\nDetermined boundaries to %f and %f\n\n", opt->min, opt->max);
         if (opt->bBoundsOnly)
         {
@@ -2169,27 +2338,23 @@ static void read_tpr_pullxf_files(char**             fnTprs,
     /* store stepsize in profile */
     opt->dz = (opt->max - opt->min) / opt->bins;
 
-    bool foundData = false;
-    for (i = 0; i < nfiles; i++)
+    for (i = 0; i < nfiles - nfilesParallel; i++)
     {
-        if (whaminFileType(fnTprs[i]) != whamin_tpr)
-        {
-            gmx_fatal(FARGS, "Expected the %d'th file in input file to be a tpr file\n", i);
-        }
-        read_tpr_header(fnTprs[i], header, opt, (opt->nCoordsel > 0) ? &opt->coordsel[i] : nullptr);
-        if (whaminFileType(fnPull[i]) != whamin_pullxf)
+        read_tpr_pullxf_pair(fnTprs, fnPull, i, &headers[i], window + i, opt, nullptr, nullptr);
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (i = nfiles - nfilesParallel; i < nfiles; i++)
+    {
+        try
         {
-            gmx_fatal(
-                    FARGS, "Expected the %d'th file in input file to be a xvg (pullx/pullf) file\n", i);
+            read_tpr_pullxf_pair(fnTprs, fnPull, i, &headers[i], window + i, opt, nullptr, nullptr);
         }
-        read_pull_xf(fnPull[i],
-                     header,
-                     window + i,
-                     opt,
-                     FALSE,
-                     nullptr,
-                     nullptr,
-                     (opt->nCoordsel > 0) ? &opt->coordsel[i] : nullptr);
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    bool foundData = false;
+    for (i = 0; i < nfiles; i++)
+    {
         if (window[i].Ntot[0] == 0)
         {
             fprintf(stderr, "\nWARNING, no data points read from file %s (check -b option)\n", fnPull[i]);
@@ -2206,6 +2371,13 @@ static void read_tpr_pullxf_files(char**             fnTprs,
                   "-b option?\n");
     }
 
+    *header = headers[nfiles - 1];
+    for (i = 0; i < nfiles - 1; i++)
+    {
+        sfree(headers[i].pcrd);
+    }
+    sfree(headers);
+
     for (i = 0; i < nfiles; i++)
     {
         sfree(fnTprs[i]);
@@ -2750,7 +2922,9 @@ static void guessPotByIntegration(t_UmbrellaWindow* window, int nWindows, t_Umbr
     {
         pot[j] = std::exp(-pot[j] / (gmx::c_boltz * opt->Temperature));
     }
-    calc_z(pot, window, nWindows, opt, TRUE);
+    t_WhamMatrix whamMatrix;
+    setup_wham_matrix(&whamMatrix, window, nWindows, opt);
+    calc_z(pot, window, &whamMatrix, TRUE);
 
     sfree(pot);
     sfree(f);
@@ -3013,13 +3187,24 @@ int gmx_wham(int argc, char* argv[])
         "",
         "With [TT]-vbs[tt] (verbose bootstrapping), the histograms of each bootstrap are written, ",
         "and, with bootstrap method [TT]traj[tt], the cumulative distribution functions of ",
-        "the histograms."
+        "the histograms.",
+        "",
+        "Parallelization",
+        "^^^^^^^^^^^^^^^",
+        "",
+        "With OpenMP, the input files are read concurrently (except with [TT]-v[tt]), ",
+        "the WHAM iterations are parallelized over the bins and histograms, and the ",
+        "bootstraps are computed concurrently in batches of one bootstrap per thread. ",
+        "The number of threads can be set with [TT]-nt[tt]. The synthetic histograms ",
+        "are always generated in the same order, so the results do not depend on the ",
+        "number of threads."
     };
 
     const char* en_unit[]       = { nullptr, "kJ", "kCal", "kT", nullptr };
     const char* en_unit_label[] = { "", "E (kJ mol\\S-1\\N)", "E (kcal mol\\S-1\\N)", "E (kT)", nullptr };
     const char* en_bsMethod[] = { nullptr, "b-hist", "hist", "traj", "traj-gauss", nullptr };
     static t_UmbrellaOptions opt;
+    int                      nthreads = -1;
 
     t_pargs pa[] = {
         { "-min", FALSE, etREAL, { &opt.min }, "Minimum coordinate in profile" },
@@ -3111,6 +3296,9 @@ int gmx_wham(int argc, char* argv[])
           etINT,
           { &opt.stepUpdateContrib },
           "HIDDENUpdate table with significan contributions to WHAM every ... iterations" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to use" },
+#endif
     };
 
     t_filenm fnm[] = {
@@ -3173,12 +3361,16 @@ int gmx_wham(int argc, char* argv[])
     opt.stepchange            = 100;
     opt.stepUpdateContrib     = 100;
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(
                 &argc, argv, 0, NFILE, fnm, asize(pa), pa, asize(desc), desc, 0, nullptr, &opt.oenv))
     {
         return 0;
     }
 
+    gmx_omp_set_num_threads(nthreads);
+
     opt.unit     = nenum(en_unit);
     opt.bsMethod = nenum(en_bsMethod);
 
@@ -3343,12 +3535,15 @@ int gmx_wham(int argc, char* argv[])
     {
         opt.stepchange = 1;
     }
+    t_WhamMatrix whamMatrix;
+    setup_wham_matrix(&whamMatrix, window, nwins, &opt);
+    setup_wham_numerator(&whamMatrix, window);
     i = 0;
     do
     {
         if ((i % opt.stepUpdateContrib) == 0)
         {
-            setup_acc_wham(profile, window, nwins, &opt);
+            setup_acc_wham(profile, window, &whamMatrix, &opt, TRUE);
         }
         if (maxchange < opt.Tolerance)
         {
@@ -3356,13 +3551,13 @@ int gmx_wham(int argc, char* argv[])
             /* if (opt.verbose) */
             printf("Switched to exact iteration in iteration %d\n", i);
         }
-        calc_profile(profile, window, nwins, &opt, bExact);
+        calc_profile(profile, window, &whamMatrix, bExact);
         if (((i % opt.stepchange) == 0 || i == 1) && i != 0)
         {
             printf("\t%4d) Maximum change %e\n", i, maxchange);
         }
         i++;
-    } while ((maxchange = calc_z(profile, window, nwins, &opt, bExact)) > opt.Tolerance || !bExact);
+    } while ((maxchange = calc_z(profile, window, &whamMatrix, bExact)) > opt.Tolerance || !bExact);
     printf("Converged in %d iterations. Final maximum change %g\n", i, maxchange);
 
     /* calc error from Kumar's formula */
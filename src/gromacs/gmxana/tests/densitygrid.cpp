@@ -0,0 +1,141 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2017- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the density grid accumulation of the analysis tools.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxana/densitygrid.h"
+
+#include <numeric>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Returns positions in lattice coordinates spread over a grid of 8x6x4 bins
+std::vector<RVec> testPositions()
+{
+    std::vector<RVec> positions;
+    for (int i = 0; i < 100; i++)
+    {
+        positions.emplace_back((i * 0.37_real) - 8 * static_cast<int>(i * 0.37_real / 8),
+                               (i * 0.53_real) - 6 * static_cast<int>(i * 0.53_real / 6),
+                               (i * 0.11_real) - 4 * static_cast<int>(i * 0.11_real / 4));
+    }
+    return positions;
+}
+
+TEST(DensityGridAccumulator, BinsPositions)
+{
+    const IVec             numBins(8, 6, 4);
+    DensityGridAccumulator accumulator(numBins, 0, 1);
+    std::vector<RVec>      positions = testPositions();
+    positions.emplace_back(-0.5, 1, 1);
+    positions.emplace_back(1, 1, 4.5);
+
+    EXPECT_EQ(2, accumulator.add(positions, 2));
+    EXPECT_EQ(0, accumulator.add(arrayRefFromArray(positions.data(), 1), 1));
+
+    const auto& grid = accumulator.result();
+    EXPECT_EQ(4, grid.extent(0));
+    EXPECT_EQ(6, grid.extent(1));
+    EXPECT_EQ(8, grid.extent(2));
+    int expectedInFirstBin = 1;
+    for (const RVec& x : positions)
+    {
+        if (x[XX] >= 0 && x[XX] < 1 && x[YY] >= 0 && x[YY] < 1 && x[ZZ] >= 0 && x[ZZ] < 1)
+        {
+            expectedInFirstBin += 2;
+        }
+    }
+    EXPECT_EQ(expectedInFirstBin, grid(0, 0, 0));
+    const auto values = grid.toArrayRef();
+    EXPECT_EQ(201, std::accumulate(values.begin(), values.end(), 0.0));
+}
+
+TEST(DensityGridAccumulator, SpreadingConservesWeight)
+{
+    const IVec             numBins(32, 32, 32);
+    DensityGridAccumulator accumulator(numBins, 1.5, 1);
+    std::vector<RVec>      positions = { { 10, 10, 10 }, { 23.3, 24.7, 22.2 } };
+    for (int i = 0; i < 20; i++)
+    {
+        accumulator.add(positions, 0.5);
+    }
+
+    const auto& grid   = accumulator.result();
+    const auto  values = grid.toArrayRef();
+    EXPECT_NEAR(20, std::accumulate(values.begin(), values.end(), 0.0), 0.01);
+    // The bins with centers at 9.5 and 10.5 are equally close to the first position
+    EXPECT_FLOAT_EQ(grid(9, 9, 9), grid(10, 10, 10));
+}
+
+TEST(DensityGridAccumulator, ResultDoesNotDependOnThreadCount)
+{
+    const IVec              numBins(8, 6, 4);
+    const std::vector<RVec> positions = testPositions();
+    for (const real sigma : { 0.0_real, 1.0_real })
+    {
+        DensityGridAccumulator serial(numBins, sigma, 1);
+        DensityGridAccumulator parallel(numBins, sigma, 3);
+        serial.add(positions, 1);
+        parallel.add(positions, 1);
+
+        const auto serialValues   = serial.result().toArrayRef();
+        const auto parallelValues = parallel.result().toArrayRef();
+        ASSERT_EQ(serialValues.size(), parallelValues.size());
+        for (size_t i = 0; i < serialValues.size(); i++)
+        {
+            EXPECT_DOUBLE_EQ_TOL(
+                    serialValues[i], parallelValues[i], relativeToleranceAsFloatingPoint(1, 1e-6));
+        }
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
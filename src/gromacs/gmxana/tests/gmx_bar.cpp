@@ -0,0 +1,156 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2026- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx bar.
+ *
+ * \ingroup module_gmxana
+ */
+
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/refdata.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/xvgtest.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief Test fixture for gmx bar
+ *
+ * bar_lambda0.xvg to bar_lambda3.xvg contain 200 uncorrelated samples at
+ * each of four lambda states of a 3D harmonic oscillator with force
+ * constant 200 (1 + 3 lambda) kJ/mol/nm^2 at 300 K, with Delta H to all
+ * states. The exact free energy difference between the first and the last
+ * state is 1.5 kT ln(4) = 2.079 kT.
+ */
+class GmxBarTest : public CommandLineTestBase
+{
+public:
+    GmxBarTest() { setInputs(); }
+    //! Initializes the test to compare against the reference data in \p referenceDataName
+    explicit GmxBarTest(const std::string& referenceDataName) :
+        CommandLineTestBase(referenceDataName)
+    {
+        setInputs();
+    }
+
+    void setInputs()
+    {
+        CommandLine& cmdline = commandLine();
+        cmdline.append("-f");
+        for (int i = 0; i < 4; i++)
+        {
+            const std::string fileName = "bar_lambda" + std::to_string(i) + ".xvg";
+            cmdline.append(TestFileManager::getInputFilePath(fileName).string());
+        }
+        cmdline.addOption("-prec", 4);
+        setOutputFile("-o", "bar.xvg", XvgMatch());
+        setOutputFile("-oi", "barint.xvg", XvgMatch());
+    }
+
+    void runTest(const CommandLine& args, int numThreads)
+    {
+        CommandLine& cmdline = commandLine();
+        cmdline.merge(args);
+#if GMX_OPENMP
+        cmdline.addOption("-nt", numThreads);
+#else
+        GMX_UNUSED_VALUE(numThreads);
+#endif
+        ASSERT_EQ(0, gmx_bar(cmdline.argc(), cmdline.argv()));
+        checkOutputFiles();
+    }
+};
+
+TEST_F(GmxBarTest, BarWorks)
+{
+    const char* const cmdline[] = { "bar", "-nombar" };
+    runTest(CommandLine(cmdline), 1);
+}
+
+TEST_F(GmxBarTest, MbarWorks)
+{
+    setOutputFile("-om", "mbar.xvg", XvgMatch());
+    const char* const cmdline[] = { "bar", "-mbar", "-nbootstrap", "20", "-seed", "5" };
+    runTest(CommandLine(cmdline), 1);
+}
+
+/*! \brief Runs gmx bar with several threads
+ *
+ * The BAR pairs, the MBAR sums and the bootstrap replicas are computed in
+ * parallel, so each test compares against the reference data of the
+ * GmxBarTest test with the same name.
+ */
+class GmxBarThreadsTest : public GmxBarTest
+{
+public:
+    GmxBarThreadsTest() :
+        GmxBarTest(formatString("GmxBarTest_%s.xml",
+                                ::testing::UnitTest::GetInstance()->current_test_info()->name()))
+    {
+    }
+};
+
+TEST_F(GmxBarThreadsTest, BarWorks)
+{
+    const char* const cmdline[] = { "bar", "-nombar" };
+    runTest(CommandLine(cmdline), 3);
+}
+
+TEST_F(GmxBarThreadsTest, MbarWorks)
+{
+    setOutputFile("-om", "mbar.xvg", XvgMatch());
+    const char* const cmdline[] = { "bar", "-mbar", "-nbootstrap", "20", "-seed", "5" };
+    runTest(CommandLine(cmdline), 3);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
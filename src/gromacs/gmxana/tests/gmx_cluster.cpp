@@ -0,0 +1,162 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2026- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx cluster.
+ */
+#include "gmxpre.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxana/gmx_ana.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/textblockmatchers.h"
+#include "testutils/xvgtest.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief Test fixture for gmx cluster
+ *
+ * The trajectory has 200 frames of a chain of 20 beads with a few
+ * dominant modes of motion, see the gmx covar tests. The reference data
+ * were generated with the RMSD calculation that fitted each pair of frames
+ * explicitly, before the RMSDs were computed with the QCP method.
+ *
+ * gmx cluster keeps its options in static variables, so all options that
+ * differ between the tests are set explicitly.
+ */
+class GmxClusterTest : public CommandLineTestBase
+{
+public:
+    GmxClusterTest() { setInputs(); }
+    //! Initializes the test to compare against the reference data in \p referenceDataName
+    explicit GmxClusterTest(const std::string& referenceDataName) :
+        CommandLineTestBase(referenceDataName)
+    {
+        setInputs();
+    }
+
+    void setInputs()
+    {
+        setInputFile("-f", "covar_traj.xtc");
+        setInputFile("-s", "covar_coords.gro");
+        setOutputFile("-g", "cluster.log", NoTextMatch());
+        setOutputFile("-clid", "clust-id.xvg", XvgMatch());
+        setOutputFile("-sz", "clust-size.xvg", XvgMatch());
+    }
+
+    /*! \brief Runs gmx cluster with \p method and \p cutoff, with or without fitting
+     *
+     * With \p sparse, only the RMSDs below the cutoff are stored and the
+     * matrix outputs are not written.
+     */
+    void runTest(const char* method, double cutoff, bool fit, bool sparse = false)
+    {
+        CommandLine& cmdline = commandLine();
+        cmdline.addOption("-method", method);
+        cmdline.addOption("-cutoff", cutoff);
+        cmdline.addOption(fit ? "-fit" : "-nofit");
+        if (sparse)
+        {
+            cmdline.addOption("-sparse");
+        }
+        else
+        {
+            cmdline.addOption("-nosparse");
+            setOutputFile("-o", "rmsd-clust.xpm", NoTextMatch());
+            setOutputFile(
+                    "-dist",
+                    "rmsd-dist.xvg",
+                    XvgMatch().tolerance(relativeToleranceAsFloatingPoint(1, 1e-4)));
+        }
+
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin("0\n0\n");
+        ASSERT_EQ(0, gmx_cluster(cmdline.argc(), cmdline.argv()));
+        checkOutputFiles();
+    }
+};
+
+TEST_F(GmxClusterTest, GromosWithFit)
+{
+    runTest("gromos", 0.05, true);
+}
+
+TEST_F(GmxClusterTest, GromosWithoutFit)
+{
+    runTest("gromos", 0.05, false);
+}
+
+TEST_F(GmxClusterTest, LinkageWithFit)
+{
+    runTest("linkage", 0.05, true);
+}
+
+/*! \brief Test fixture for the gromos method with -sparse
+ *
+ * The parameter tells whether the cluster structures are written, which
+ * needs all frames after the RMSDs are computed. The structures are not
+ * checked, so both cases compare against the same reference data.
+ */
+class GmxClusterSparseTest : public GmxClusterTest, public ::testing::WithParamInterface<bool>
+{
+public:
+    GmxClusterSparseTest() : GmxClusterTest("GmxClusterSparseTest_GromosWithFit.xml") {}
+};
+
+TEST_P(GmxClusterSparseTest, GromosWithFit)
+{
+    if (GetParam())
+    {
+        commandLine().addOption("-cl", fileManager().getTemporaryFilePath("clusters.pdb").string());
+    }
+    runTest("gromos", 0.05, true, true);
+}
+
+INSTANTIATE_TEST_SUITE_P(WritingClusters, GmxClusterSparseTest, ::testing::Bool());
+
+} // namespace
+} // namespace test
+} // namespace gmx
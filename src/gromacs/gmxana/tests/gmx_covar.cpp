@@ -0,0 +1,204 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2026- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx covar.
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cmath>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxana/eigio.h"
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/refdata.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Number of eigenvectors compared between the two solvers
+constexpr int c_numEigenvectors = 4;
+
+//! Eigenvalues and eigenvectors written by gmx covar
+struct CovarEigenpairs
+{
+    //! The eigenvalues in decreasing order
+    std::vector<real> eigenvalues;
+    //! The eigenvectors, each of length DIM times the number of atoms
+    std::vector<std::vector<real>> eigenvectors;
+};
+
+/*! \brief Test fixture for comparing the streaming eigensolver of gmx covar
+ * with the diagonalization of the full covariance matrix.
+ *
+ * covar_traj.xtc contains 200 frames of a chain of 20 beads with four
+ * dominant modes of motion, with variances of 0.02, 0.01, 0.005 and
+ * 0.002 nm^2, on top of noise that is uncorrelated between the
+ * coordinates. The parameter is the number of OpenMP threads.
+ */
+class GmxCovarTest : public CommandLineTestBase, public ::testing::WithParamInterface<int>
+{
+public:
+    //! All thread counts compare against the same reference data
+    GmxCovarTest() :
+        CommandLineTestBase("GmxCovarTest_StreamingEigenpairsMatchFullDiagonalization.xml")
+    {
+    }
+
+    /*! \brief Runs gmx covar and reads back the first c_numEigenvectors eigenpairs
+     *
+     * \param[in] name       Prefix for the output files
+     * \param[in] nev        Value for -nev, 0 diagonalizes the full matrix
+     * \param[in] numThreads Number of OpenMP threads
+     *
+     * gmx covar keeps its options in static variables, so all options
+     * that differ between the runs are set explicitly.
+     */
+    CovarEigenpairs runCovar(const std::string& name, int nev, int numThreads)
+    {
+        CommandLine cmdline;
+        cmdline.append("covar");
+        cmdline.addOption("-f", TestFileManager::getInputFilePath("covar_traj.xtc").string());
+        cmdline.addOption("-s", TestFileManager::getInputFilePath("covar_coords.gro").string());
+        cmdline.addOption("-nofit");
+        cmdline.addOption("-nev", nev);
+        cmdline.addOption("-last", c_numEigenvectors);
+        cmdline.addOption("-o", fileManager().getTemporaryFilePath(name + ".xvg").string());
+        cmdline.addOption("-v", fileManager().getTemporaryFilePath(name + ".trr").string());
+        cmdline.addOption("-av", fileManager().getTemporaryFilePath(name + ".pdb").string());
+        cmdline.addOption("-l", fileManager().getTemporaryFilePath(name + ".log").string());
+#if GMX_OPENMP
+        cmdline.addOption("-nt", numThreads);
+#else
+        GMX_UNUSED_VALUE(numThreads);
+#endif
+
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin("0\n");
+        EXPECT_EQ(0, gmx_covar(cmdline.argc(), cmdline.argv()));
+
+        int    natoms;
+        bool   bFit, bDMR, bDMA;
+        rvec*  xref;
+        rvec*  xav;
+        int    nvec;
+        int*   eignr;
+        rvec** eigvec;
+        real*  eigval;
+        read_eigenvectors(fileManager().getTemporaryFilePath(name + ".trr").string().c_str(),
+                          &natoms,
+                          &bFit,
+                          &xref,
+                          &bDMR,
+                          &xav,
+                          &bDMA,
+                          &nvec,
+                          &eignr,
+                          &eigvec,
+                          &eigval);
+        CovarEigenpairs result;
+        for (int v = 0; v < nvec; v++)
+        {
+            result.eigenvalues.push_back(eigval[v]);
+            std::vector<real> eigenvector;
+            for (int a = 0; a < natoms; a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    eigenvector.push_back(eigvec[v][a][d]);
+                }
+            }
+            result.eigenvectors.push_back(eigenvector);
+            sfree(eigvec[v]);
+        }
+        sfree(eigvec);
+        sfree(eignr);
+        sfree(eigval);
+        sfree(xav);
+        sfree(xref);
+        return result;
+    }
+};
+
+TEST_P(GmxCovarTest, StreamingEigenpairsMatchFullDiagonalization)
+{
+    const int             numThreads = GetParam();
+    const CovarEigenpairs full       = runCovar("full", 0, 1);
+    const CovarEigenpairs streaming  = runCovar("streaming", c_numEigenvectors, numThreads);
+
+    ASSERT_EQ(c_numEigenvectors, static_cast<int>(full.eigenvalues.size()));
+    ASSERT_EQ(c_numEigenvectors, static_cast<int>(streaming.eigenvalues.size()));
+    for (int v = 0; v < c_numEigenvectors; v++)
+    {
+        SCOPED_TRACE("Eigenvector " + std::to_string(v + 1));
+        EXPECT_REAL_EQ_TOL(full.eigenvalues[v],
+                           streaming.eigenvalues[v],
+                           relativeToleranceAsFloatingPoint(full.eigenvalues[0], 1e-4));
+        // The sign of an eigenvector is arbitrary
+        double overlap = 0;
+        for (std::size_t i = 0; i < full.eigenvectors[v].size(); i++)
+        {
+            overlap += full.eigenvectors[v][i] * streaming.eigenvectors[v][i];
+        }
+        EXPECT_REAL_EQ_TOL(1.0, std::fabs(overlap), absoluteTolerance(1e-4));
+    }
+
+    TestReferenceChecker checker(rootChecker());
+    checker.setDefaultTolerance(relativeToleranceAsFloatingPoint(1, 1e-4));
+    checker.checkSequence(
+            streaming.eigenvalues.begin(), streaming.eigenvalues.end(), "Eigenvalues");
+}
+
+INSTANTIATE_TEST_SUITE_P(WithThreads, GmxCovarTest, ::testing::Values(1, 2));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -40,6 +40,8 @@
 
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <cstdio>
 #include <cstdlib>
 
@@ -49,13 +51,16 @@
 
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/path.h"
+#include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/textreader.h"
 
 #include "testutils/cmdlinetest.h"
 #include "testutils/refdata.h"
 #include "testutils/stdiohelper.h"
+#include "testutils/testasserts.h"
 #include "testutils/testfilemanager.h"
 #include "testutils/textblockmatchers.h"
 #include "testutils/xvgtest.h"
@@ -200,7 +205,176 @@ TEST_F(MindistTest, matrixWorks)
     runTest(CommandLine(cmdline), stdIn);
 }
 
-// TODO test periodic image - needs a tpr?
+//! Runs gmx mindist on larger systems, where the neighborhood search matters
+class MindistSearchTest : public gmx::test::CommandLineTestBase
+{
+public:
+    MindistSearchTest(const char* trajectory, const char* structure, const char* index)
+    {
+        setInputs(trajectory, structure, index);
+    }
+    //! Initializes the test to compare against the reference data in \p referenceDataName
+    MindistSearchTest(const std::string& referenceDataName,
+                      const char*        trajectory,
+                      const char*        structure,
+                      const char*        index) :
+        CommandLineTestBase(referenceDataName)
+    {
+        setInputs(trajectory, structure, index);
+    }
+
+    void setInputs(const char* trajectory, const char* structure, const char* index)
+    {
+        setInputFile("-f", trajectory);
+        setInputFile("-s", structure);
+        if (index != nullptr)
+        {
+            setInputFile("-n", index);
+        }
+    }
+
+    void runTest(const CommandLine& args, const char* stringForStdin, int numThreads = 1)
+    {
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin(stringForStdin);
+
+        CommandLine& cmdline = commandLine();
+        cmdline.merge(args);
+#if GMX_OPENMP
+        cmdline.addOption("-nt", numThreads);
+#else
+        GMX_UNUSED_VALUE(numThreads);
+#endif
+        ASSERT_EQ(0, gmx_mindist(cmdline.argc(), cmdline.argv()));
+        checkOutputFiles();
+    }
+
+    //! Distances from the search can differ in the last bits from those of all pairs
+    static XvgMatch distanceMatch()
+    {
+        return XvgMatch().tolerance(gmx::test::relativeToleranceAsFloatingPoint(1, 1e-5));
+    }
+
+    //! Returns the name of the reference data of the test with the current name in \p fixture
+    static std::string serialReferenceDataName(const char* fixture)
+    {
+        return formatString(
+                "%s_%s.xml", fixture, ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    }
+};
+
+/*! \brief Tests a solvated peptide in a triclinic box
+ *
+ * The index groups are 0: System, 1: Protein, 2: Water, 3: some_water_subset.
+ * The reference data were computed by looping over all pairs of atoms.
+ */
+class MindistSolvatedTest : public MindistSearchTest
+{
+public:
+    MindistSolvatedTest() :
+        MindistSearchTest("alanine_vsite_solvated.xtc",
+                          "alanine_vsite_solvated.gro",
+                          "alanine_vsite_solvated.ndx")
+    {
+    }
+};
+
+TEST_F(MindistSolvatedTest, ContactsWork)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    setOutputFile("-on", "ncontacts.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.35" };
+    runTest(CommandLine(cmdline), "1 2");
+}
+
+// The atoms in both groups are not counted as contacts with themselves
+TEST_F(MindistSolvatedTest, OverlappingGroupsWork)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    setOutputFile("-on", "ncontacts.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.3", "-group" };
+    runTest(CommandLine(cmdline), "3 2");
+}
+
+TEST_F(MindistSolvatedTest, NoPbcWorks)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    setOutputFile("-on", "ncontacts.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.35", "-nopbc" };
+    runTest(CommandLine(cmdline), "1 2");
+}
+
+// Minimum distance of each water molecule to the peptide
+TEST_F(MindistSolvatedTest, ResidueMindistWorks)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    setOutputFile("-or", "mindistres.xvg", distanceMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.35" };
+    runTest(CommandLine(cmdline), "2 1", 2);
+}
+
+//! Tests the distance of a protein to its periodic images in a box with a height of 3 nm
+class MindistPeriodicImageTest : public MindistSearchTest
+{
+public:
+    MindistPeriodicImageTest() : MindistSearchTest("lysozyme-traj.gro", "lysozyme.pdb", nullptr) {}
+};
+
+TEST_F(MindistPeriodicImageTest, Works)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    const char* const cmdline[] = { "mindist", "-pi" };
+    runTest(CommandLine(cmdline), "1");
+}
+
+/*! \brief Runs the solvated peptide with several threads
+ *
+ * Each test compares against the reference data of the MindistSolvatedTest
+ * test with the same name.
+ */
+class MindistSolvatedThreadsTest : public MindistSearchTest
+{
+public:
+    MindistSolvatedThreadsTest() :
+        MindistSearchTest(serialReferenceDataName("MindistSolvatedTest"),
+                          "alanine_vsite_solvated.xtc",
+                          "alanine_vsite_solvated.gro",
+                          "alanine_vsite_solvated.ndx")
+    {
+    }
+};
+
+TEST_F(MindistSolvatedThreadsTest, ContactsWork)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    setOutputFile("-on", "ncontacts.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.35" };
+    runTest(CommandLine(cmdline), "1 2", 2);
+}
+
+/*! \brief Runs the periodic image distance with several threads
+ *
+ * Each test compares against the reference data of the
+ * MindistPeriodicImageTest test with the same name.
+ */
+class MindistPeriodicImageThreadsTest : public MindistSearchTest
+{
+public:
+    MindistPeriodicImageThreadsTest() :
+        MindistSearchTest(serialReferenceDataName("MindistPeriodicImageTest"),
+                          "lysozyme-traj.gro",
+                          "lysozyme.pdb",
+                          nullptr)
+    {
+    }
+};
+
+TEST_F(MindistPeriodicImageThreadsTest, Works)
+{
+    setOutputFile("-od", "mindist.xvg", distanceMatch());
+    const char* const cmdline[] = { "mindist", "-pi" };
+    runTest(CommandLine(cmdline), "1", 2);
+}
 
 } // namespace
 } // namespace test
@@ -0,0 +1,224 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2026- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx wham.
+ *
+ * \ingroup module_gmxana
+ */
+
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/gmxpreprocess/grompp.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/refdata.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/xvgtest.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Number of umbrella windows in the test set
+const int c_numWindows = 4;
+
+/*! \brief Test fixture for gmx wham
+ *
+ * wham_pullx0.xvg to wham_pullx3.xvg contain 200 uncorrelated positions of
+ * umbrella windows with a force constant of 500 kJ/mol/nm^2 at 300 K, centered
+ * at 1.0 to 1.3 nm, on a linear PMF with a slope of 10 kJ/mol/nm. The matching
+ * tpr files are generated from the lysozyme system with a distance pull
+ * coordinate.
+ */
+class GmxWhamTest : public CommandLineTestBase
+{
+public:
+    GmxWhamTest() { setInputs(); }
+    //! Initializes the test to compare against the reference data in \p referenceDataName
+    explicit GmxWhamTest(const std::string& referenceDataName) :
+        CommandLineTestBase(referenceDataName)
+    {
+        setInputs();
+    }
+
+    void setInputs()
+    {
+        std::string tprFiles;
+        std::string pullxFiles;
+        for (int i = 0; i < c_numWindows; i++)
+        {
+            const std::string window = std::to_string(i);
+            tprFiles += generateTpr(i) + "\n";
+            pullxFiles += TestFileManager::getInputFilePath("wham_pullx" + window + ".xvg").string()
+                          + "\n";
+        }
+        const std::string tprList = fileManager().getTemporaryFilePath("tpr-files.dat").string();
+        const std::string pullxList =
+                fileManager().getTemporaryFilePath("pullx-files.dat").string();
+        TextWriter::writeFileFromString(tprList, tprFiles);
+        TextWriter::writeFileFromString(pullxList, pullxFiles);
+
+        CommandLine& cmdline = commandLine();
+        cmdline.addOption("-it", tprList);
+        cmdline.addOption("-ix", pullxList);
+        cmdline.addOption("-min", 0.85);
+        cmdline.addOption("-max", 1.35);
+        cmdline.addOption("-bins", 25);
+        cmdline.addOption("-temp", 300);
+        setOutputFile("-o", "profile.xvg", profileMatch());
+        setOutputFile("-hist", "histo.xvg", XvgMatch());
+    }
+
+    void runTest(const CommandLine& args, int numThreads)
+    {
+        CommandLine& cmdline = commandLine();
+        cmdline.merge(args);
+#if GMX_OPENMP
+        cmdline.addOption("-nt", numThreads);
+#else
+        GMX_UNUSED_VALUE(numThreads);
+#endif
+        ASSERT_EQ(0, gmx_wham(cmdline.argc(), cmdline.argv()));
+        checkOutputFiles();
+    }
+
+    //! The profiles converge to the WHAM tolerance, not to the last bit
+    static XvgMatch profileMatch()
+    {
+        XvgMatch match;
+        match.tolerance(relativeToleranceAsFloatingPoint(1, 1e-4));
+        return match;
+    }
+
+private:
+    //! Writes a tpr with the umbrella restraint of window \p window and returns its name
+    std::string generateTpr(int window)
+    {
+        const std::string name = "window" + std::to_string(window);
+        const std::string mdpFileName = fileManager().getTemporaryFilePath(name + ".mdp").string();
+        const std::string tprFileName = fileManager().getTemporaryFilePath(name + ".tpr").string();
+        TextWriter::writeFileFromString(mdpFileName,
+                                        "pull                 = yes\n"
+                                        "pull-ngroups         = 2\n"
+                                        "pull-ncoords         = 1\n"
+                                        "pull-group1-name     = Backbone\n"
+                                        "pull-group2-name     = SideChain\n"
+                                        "pull-group1-pbcatom  = 90\n"
+                                        "pull-group2-pbcatom  = 77\n"
+                                        "pull-pbc-ref-prev-step-com = yes\n"
+                                        "pull-coord1-groups   = 1 2\n"
+                                        "pull-coord1-type     = umbrella\n"
+                                        "pull-coord1-geometry = distance\n"
+                                        "pull-coord1-k        = 500\n"
+                                        "pull-coord1-init     = "
+                                                + std::to_string(1.0 + 0.1 * window) + "\n");
+        CommandLine caller;
+        caller.append("grompp");
+        caller.addOption("-f", mdpFileName);
+        caller.addOption("-p", TestFileManager::getInputFilePath("lysozyme.top").string());
+        caller.addOption("-c", TestFileManager::getInputFilePath("lysozyme.pdb").string());
+        caller.addOption("-po", fileManager().getTemporaryFilePath(name + "out.mdp").string());
+        caller.addOption("-o", tprFileName);
+        EXPECT_EQ(0, gmx_grompp(caller.argc(), caller.argv()));
+        return tprFileName;
+    }
+};
+
+TEST_F(GmxWhamTest, Works)
+{
+    const char* const cmdline[] = { "wham" };
+    runTest(CommandLine(cmdline), 1);
+}
+
+TEST_F(GmxWhamTest, BootstrapWorks)
+{
+    setOutputFile("-bsres", "bsResult.xvg", profileMatch());
+    // The individual bootstrap profiles are only written, not checked
+    commandLine().addOption("-bsprof", fileManager().getTemporaryFilePath("bsProfs.xvg").string());
+    const char* const cmdline[] = {
+        "wham", "-nBootstrap", "4", "-bs-method", "b-hist", "-bs-seed", "7"
+    };
+    runTest(CommandLine(cmdline), 1);
+}
+
+/*! \brief Runs gmx wham with several threads
+ *
+ * The windows are read, the WHAM iterations are done and the bootstraps run
+ * in parallel, so each test compares against the reference data of the
+ * GmxWhamTest test with the same name.
+ */
+class GmxWhamThreadsTest : public GmxWhamTest
+{
+public:
+    GmxWhamThreadsTest() :
+        GmxWhamTest(formatString("GmxWhamTest_%s.xml",
+                                 ::testing::UnitTest::GetInstance()->current_test_info()->name()))
+    {
+    }
+};
+
+TEST_F(GmxWhamThreadsTest, Works)
+{
+    const char* const cmdline[] = { "wham" };
+    runTest(CommandLine(cmdline), 3);
+}
+
+TEST_F(GmxWhamThreadsTest, BootstrapWorks)
+{
+    setOutputFile("-bsres", "bsResult.xvg", profileMatch());
+    commandLine().addOption("-bsprof", fileManager().getTemporaryFilePath("bsProfs.xvg").string());
+    const char* const cmdline[] = {
+        "wham", "-nBootstrap", "4", "-bs-method", "b-hist", "-bs-seed", "7"
+    };
+    runTest(CommandLine(cmdline), 3);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
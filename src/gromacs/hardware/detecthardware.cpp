@@ -61,6 +61,7 @@
 #include "gromacs/utility/inmemoryserializer.h"
 #include "gromacs/utility/logger.h"
 #include "gromacs/utility/physicalnodecommunicator.h"
+#include "gromacs/utility/stringutil.h"
 
 #include "architecture.h"
 #include "device_information.h"
@@ -319,8 +320,8 @@ static void gmx_collect_hardware_mpi(const gmx::CpuInfo&             cpuInfo,
     hardwareInfo->ncore_min            = nCores;
     hardwareInfo->ncore_max            = nCores;
     hardwareInfo->nProcessingUnits_tot = nProcessingUnits;
-    hardwareInfo->nProcessingUnits_tot = nProcessingUnits;
-    hardwareInfo->nProcessingUnits_tot = nProcessingUnits;
+    hardwareInfo->nProcessingUnits_min = nProcessingUnits;
+    hardwareInfo->nProcessingUnits_max = nProcessingUnits;
     hardwareInfo->maxThreads_tot       = maxThreads;
     hardwareInfo->maxThreads_min       = maxThreads;
     hardwareInfo->maxThreads_max       = maxThreads;
@@ -370,6 +371,21 @@ std::unique_ptr<gmx_hw_info_t> gmx_detect_hardware(const PhysicalNodeCommunicato
     return hardwareInfo;
 }
 
+std::string hardwareFingerprint(const gmx_hw_info_t& hardwareInformation)
+{
+    std::string fingerprint =
+            formatString("cpu '%s' cores %d processing-units %d simd %d",
+                         hardwareInformation.cpuInfo->brandString().c_str(),
+                         hardwareInformation.ncore_max,
+                         hardwareInformation.nProcessingUnits_max,
+                         hardwareInformation.simd_suggest_max);
+    for (const auto& deviceInfo : hardwareInformation.deviceInfoList)
+    {
+        fingerprint += " gpu '" + getDeviceInformationString(*deviceInfo) + "'";
+    }
+    return fingerprint;
+}
+
 void logHardwareDetectionWarnings(const gmx::MDLogger& mdlog, const gmx_hw_info_t& hardwareInformation)
 {
     for (const std::string& warningString : hardwareInformation.hardwareDetectionWarnings_)
@@ -35,6 +35,7 @@
 #define GMX_HARDWARE_DETECTHARDWARE_H
 
 #include <memory>
+#include <string>
 
 #include "gromacs/utility/gmxmpi.h"
 
@@ -60,6 +61,16 @@ class PhysicalNodeCommunicator;
 std::unique_ptr<gmx_hw_info_t> gmx_detect_hardware(const PhysicalNodeCommunicator& physicalNodeComm,
                                                    MPI_Comm libraryCommWorld);
 
+/*! \brief Return a description of the hardware of a node for identifying tuning results
+ *
+ * The description contains the CPU model, the core, processing unit and
+ * SIMD support counts and the detected GPUs. Only quantities that are
+ * the same for a single process and for a run over multiple identical
+ * nodes are used, so the result can be compared between tools and mdrun.
+ *
+ * \param[in] hardwareInformation  The hardwareInformation */
+std::string hardwareFingerprint(const gmx_hw_info_t& hardwareInformation);
+
 /*! \brief Issue warnings to mdlog that were decided during detection
  *
  * \param[in] mdlog                Logger
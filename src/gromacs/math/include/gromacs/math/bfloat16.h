@@ -0,0 +1,115 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares conversion functions between floating point values and bfloat16.
+ *
+ * bfloat16 has the same exponent range as single precision float,
+ * but only 8 significant bits. It is used to reduce the volume of
+ * communicated data where the reduced precision is acceptable.
+ *
+ * \inlibraryapi
+ * \ingroup module_math
+ */
+#ifndef GMX_MATH_BFLOAT16_H
+#define GMX_MATH_BFLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace gmx
+{
+
+/*! \brief The maximum relative rounding error of a conversion to bfloat16
+ *
+ * With rounding to nearest, the error is at most half a unit in the last place.
+ */
+static constexpr double c_bfloat16MaxRelativeError = 1.0 / 256;
+
+//! Returns \p value converted to bfloat16 with rounding to nearest, ties to even
+static inline uint16_t floatToBfloat16(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    if ((bits & 0x7fffffffU) > 0x7f800000U)
+    {
+        // Return a quiet NaN, rounding could otherwise turn a NaN into infinity
+        return static_cast<uint16_t>((bits >> 16U) | 0x0040U);
+    }
+
+    bits += 0x7fffU + ((bits >> 16U) & 1U);
+
+    return static_cast<uint16_t>(bits >> 16U);
+}
+
+//! Returns the bfloat16 value \p value converted to float, this conversion is exact
+static inline float bfloat16ToFloat(uint16_t value)
+{
+    const uint32_t bits = static_cast<uint32_t>(value) << 16U;
+    float          result;
+    std::memcpy(&result, &bits, sizeof(result));
+
+    return result;
+}
+
+/*! \brief Converts \p count values from \p in to bfloat16 and stores them in \p out
+ *
+ * \tparam T  The input type, float or double
+ */
+template<typename T>
+static inline void packToBfloat16(const T* in, int count, uint16_t* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        out[i] = floatToBfloat16(static_cast<float>(in[i]));
+    }
+}
+
+/*! \brief Converts \p count bfloat16 values from \p in and stores them in \p out
+ *
+ * \tparam T  The output type, float or double
+ */
+template<typename T>
+static inline void unpackFromBfloat16(const uint16_t* in, int count, T* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        out[i] = bfloat16ToFloat(in[i]);
+    }
+}
+
+} // namespace gmx
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the bfloat16 conversion functions.
+ *
+ * \ingroup module_math
+ */
+#include "gmxpre.h"
+
+#include "gromacs/math/bfloat16.h"
+
+#include <cmath>
+
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+TEST(Bfloat16, ConvertsExactlyRepresentableValues)
+{
+    const float smallest = std::numeric_limits<float>::min();
+    for (float value : { 0.0F, -0.0F, 1.0F, -2.5F, 0.15625F, 65536.0F, -smallest })
+    {
+        EXPECT_EQ(value, bfloat16ToFloat(floatToBfloat16(value)));
+    }
+}
+
+TEST(Bfloat16, RoundsToNearest)
+{
+    // 1 + 2^-8 is halfway between 1 and 1 + 2^-7, ties round to even
+    EXPECT_EQ(1.0F, bfloat16ToFloat(floatToBfloat16(1.00390625F)));
+    // 1 + 3*2^-8 is halfway between 1 + 2^-7 and 1 + 2^-6
+    EXPECT_EQ(1.015625F, bfloat16ToFloat(floatToBfloat16(1.01171875F)));
+    // Just above halfway rounds up
+    EXPECT_EQ(1.0078125F, bfloat16ToFloat(floatToBfloat16(1.004F)));
+}
+
+TEST(Bfloat16, RelativeErrorIsWithinBound)
+{
+    for (float value = -1000.0F; value < 1000.0F; value += 0.731F)
+    {
+        const float converted = bfloat16ToFloat(floatToBfloat16(value));
+        EXPECT_LE(std::abs(converted - value), c_bfloat16MaxRelativeError * std::abs(value));
+    }
+}
+
+TEST(Bfloat16, KeepsSpecialValues)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    EXPECT_EQ(infinity, bfloat16ToFloat(floatToBfloat16(infinity)));
+    EXPECT_EQ(-infinity, bfloat16ToFloat(floatToBfloat16(-infinity)));
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_TRUE(std::isnan(bfloat16ToFloat(floatToBfloat16(nan))));
+}
+
+TEST(Bfloat16, PacksAndUnpacksArrays)
+{
+    const std::vector<real> values = { 1.0, -0.5, 2.0e-3, 123.0 };
+    std::vector<uint16_t>   packed(values.size());
+    std::vector<real>       unpacked(values.size());
+
+    packToBfloat16(values.data(), static_cast<int>(values.size()), packed.data());
+    unpackFromBfloat16(packed.data(), static_cast<int>(packed.size()), unpacked.data());
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        EXPECT_NEAR(values[i], unpacked[i], c_bfloat16MaxRelativeError * std::abs(values[i]));
+    }
+}
+
+} // namespace
+
+} // namespace test
+
+} // namespace gmx
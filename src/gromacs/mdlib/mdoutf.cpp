@@ -50,6 +50,7 @@
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/filetypes.h"
 #include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/h5md.h"
 #include "gromacs/fileio/tngio.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xtcio.h"
@@ -91,6 +92,7 @@ struct gmx_mdoutf
     t_fileio*                      fp_xtc;
     gmx_tng_trajectory_t           tng;
     gmx_tng_trajectory_t           tng_low_prec;
+    gmx::H5md*                     h5md; /* H5MD output of the full and compressed trajectory */
     int                            x_compression_precision; /* only used by XTC output */
     ener_file_t                    fp_ene;
     const char*                    fn_cpt;
@@ -140,6 +142,7 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
     of->fp_xtc       = nullptr;
     of->tng          = nullptr;
     of->tng_low_prec = nullptr;
+    of->h5md         = nullptr;
     of->fp_dhdl      = nullptr;
 
     of->eIntegrator             = ir->eI;
@@ -253,6 +256,28 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
         {
             snew(of->f_global, top_global.natoms);
         }
+
+        if ((EI_DYNAMICS(ir->eI) || EI_ENERGY_MINIMIZATION(ir->eI))
+            && opt2bSet("-h5md", nfile, fnm))
+        {
+            /* The H5MD file holds the full precision frames in the particles
+               group "system" and the compressed positions in "compressed" */
+            of->h5md = new gmx::H5md(opt2fn("-h5md", nfile, fnm),
+                                     restartWithAppending ? gmx::H5mdFileMode::Append
+                                                          : gmx::H5mdFileMode::Write);
+            char username[256];
+            gmx_getusername(username, sizeof(username));
+            of->h5md->setAuthorAndCreator(
+                    username, gmx::getProgramContext().displayName(), gmx_version());
+            of->h5md->setUpParticlesGroup("system", of->natoms_global, ir->pbcType, 0);
+            if (EI_DYNAMICS(ir->eI) && ir->nstxout_compressed > 0)
+            {
+                of->h5md->setUpParticlesGroup("compressed",
+                                              of->natoms_x_compressed,
+                                              ir->pbcType,
+                                              ir->x_compression_precision);
+            }
+        }
     }
 
     if (bCiteTng)
@@ -528,6 +553,10 @@ void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
 {
     fflush_tng(of->tng);
     fflush_tng(of->tng_low_prec);
+    if (of->h5md)
+    {
+        of->h5md->flush();
+    }
     /* Write the checkpoint file.
      * When simulations share the state, an MPI barrier is applied before
      * renaming old and new checkpoint files to minimize the risk of
@@ -681,6 +710,10 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                                v,
                                f);
             }
+            if (of->h5md)
+            {
+                of->h5md->writeParticlesFrame("system", step, t, state_local->box, x, v, f);
+            }
         }
         if (mdof_flags & MDOF_X_COMPRESSED)
         {
@@ -727,6 +760,11 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                            xxtc,
                            nullptr,
                            nullptr);
+            if (of->h5md)
+            {
+                of->h5md->writeParticlesFrame(
+                        "compressed", step, t, state_local->box, xxtc, nullptr, nullptr);
+            }
             if (of->natoms_x_compressed != of->natoms_global)
             {
                 sfree(xxtc);
@@ -816,6 +854,7 @@ void done_mdoutf(gmx_mdoutf_t of)
 
     gmx_tng_close(&of->tng);
     gmx_tng_close(&of->tng_low_prec);
+    delete of->h5md;
 
     sfree(of);
 }
@@ -46,6 +46,8 @@
 
 #include "legacymdrunoptions.h"
 
+#include "config.h"
+
 #include <cstdlib>
 #include <cstring>
 
@@ -160,6 +162,12 @@ int LegacyMdrunOptions::updateFromCommandLine(int argc, char** argv, ArrayRef<co
         }
     }
 
+    if (!GMX_USE_HDF5 && opt2bSet("-h5md", gmx::ssize(filenames), filenames.data()))
+    {
+        gmx_fatal(FARGS,
+                  "-h5md can not be used, because GROMACS was compiled without HDF5 support");
+    }
+
     mdrunOptions.rerun            = opt2bSet("-rerun", gmx::ssize(filenames), filenames.data());
     mdrunOptions.ntompOptionIsSet = opt2parg_bSet("-ntomp", asize(pa), pa);
 
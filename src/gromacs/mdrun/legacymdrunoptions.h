@@ -107,6 +107,7 @@ public:
     std::vector<t_filenm> filenames = { { { efTPR, nullptr, nullptr, ffREAD },
                                           { efTRN, "-o", nullptr, ffWRITE },
                                           { efCOMPRESSED, "-x", nullptr, ffOPTWR },
+                                          { efH5MD, "-h5md", "traj", ffOPTWR },
                                           { efCPT, "-cpi", nullptr, ffOPTRD | ffALLOW_MISSING },
                                           { efCPT, "-cpo", nullptr, ffOPTWR },
                                           { efSTO, "-c", "confout", ffWRITE },
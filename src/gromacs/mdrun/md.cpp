@@ -565,8 +565,16 @@ void gmx::LegacySimulator::do_md()
     pme_load_balancing_t* pme_loadbal = nullptr;
     if (bPMETune)
     {
-        pme_loadbal_init(
-                &pme_loadbal, cr_, mdLog_, *ir, state_->box, *fr_->ic, *fr_->nbv, fr_->pmedata, fr_->nbv->useGpu());
+        pme_loadbal_init(&pme_loadbal,
+                         cr_,
+                         mdLog_,
+                         *ir,
+                         state_->box,
+                         *fr_->ic,
+                         *fr_->nbv,
+                         fr_->pmedata,
+                         fr_->nbv->useGpu(),
+                         mdrunOptions_.pmeTuningCacheKey);
     }
 
     if (!ir->bContinuation)
@@ -74,6 +74,7 @@
 #include "gromacs/ewald/pme_gpu_program.h"
 #include "gromacs/ewald/pme_only.h"
 #include "gromacs/ewald/pme_pp_comm_gpu.h"
+#include "gromacs/ewald/pme_tuning_cache.h"
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/filetypes.h"
 #include "gromacs/fileio/gmxfio.h"
@@ -678,6 +679,121 @@ static void override_nsteps_cmdline(const gmx::MDLogger& mdlog, int64_t nsteps_c
 namespace gmx
 {
 
+/*! \brief Look up the PP-PME settings stored in the PME tuning cache for this run
+ *
+ * When the environment variable GMX_PME_TUNING_CACHE names a cache file,
+ * settings are looked up using a hash of the run input file, the hardware
+ * fingerprint and the requested rank and thread layout. The cache key is
+ * stored in \p mdrunOptions so that PME load balancing can store its result.
+ * Should only be called on the simulation main rank, before the number of
+ * thread-MPI ranks and the use of GPUs for PME is decided.
+ *
+ * \returns The stored settings, empty when absent or not usable with \p ir.
+ */
+static std::optional<PmeTuningRunSettings>
+lookUpPmeTuningCache(const MDLogger&      mdlog,
+                     const char*          tprFileName,
+                     const gmx_hw_info_t& hwinfo,
+                     int                  numRanks,
+                     int                  numPmeRanksRequested,
+                     int                  numThreadsRequested,
+                     const t_inputrec&    ir,
+                     MdrunOptions*        mdrunOptions)
+{
+    const char* cacheFile = getenv("GMX_PME_TUNING_CACHE");
+    if (cacheFile == nullptr || cacheFile[0] == '\0' || !mdrunOptions->tunePme
+        || mdrunOptions->reproducible || !EI_DYNAMICS(ir.eI) || !usingPme(ir.coulombtype))
+    {
+        return std::nullopt;
+    }
+
+    mdrunOptions->pmeTuningCacheKey = makePmeTuningRunKey(pmeTuningFileHash(tprFileName),
+                                                          hardwareFingerprint(hwinfo),
+                                                          numRanks,
+                                                          numPmeRanksRequested,
+                                                          numThreadsRequested);
+
+    auto settings = readPmeTuningRunSettings(cacheFile, mdrunOptions->pmeTuningCacheKey);
+    if (!settings)
+    {
+        return std::nullopt;
+    }
+
+    /* Check that the stored cut-offs fulfill the same requirements as the tpr input */
+    constexpr double c_cutoffTolerance = 1e-5;
+    bool             settingsAreValid  = (settings->rcoulomb + c_cutoffTolerance >= settings->rvdw);
+    if (usingLJPme(ir.vdwtype) || ir.vdwtype != VanDerWaalsType::Cut)
+    {
+        settingsAreValid = settingsAreValid
+                           && std::abs(settings->rcoulomb - settings->rvdw) < c_cutoffTolerance;
+    }
+    if ((ir.vdw_modifier == InteractionModifiers::PotSwitch
+         || ir.vdw_modifier == InteractionModifiers::ForceSwitch)
+        && settings->rvdw <= ir.rvdw_switch)
+    {
+        settingsAreValid = false;
+    }
+    if (!settingsAreValid)
+    {
+        GMX_LOG(mdlog.warning)
+                .asParagraph()
+                .appendTextFormatted(
+                        "Ignoring the PME settings stored for this run in the PME tuning cache\n"
+                        "%s, as the cut-offs rcoulomb %.3f nm and rvdw %.3f nm are not valid\n"
+                        "for the run input.",
+                        cacheFile,
+                        settings->rcoulomb,
+                        settings->rvdw);
+        return std::nullopt;
+    }
+
+    GMX_LOG(mdlog.info)
+            .asParagraph()
+            .appendTextFormatted(
+                    "Using the PME settings stored for this run input, hardware and rank layout\n"
+                    "in the PME tuning cache %s:\n"
+                    "  PME ranks %d, pme grid %d %d %d, rcoulomb %.3f nm, rvdw %.3f nm\n"
+                    "PME tuning is turned off.",
+                    cacheFile,
+                    settings->numPmeRanks,
+                    settings->nkx,
+                    settings->nky,
+                    settings->nkz,
+                    settings->rcoulomb,
+                    settings->rvdw);
+
+    return settings;
+}
+
+/*! \brief Apply PP-PME settings from the PME tuning cache
+ *
+ * Replaces the cut-off radii and PME grid in \p ir, and the number of PME
+ * ranks when that was not set by the user, and turns PME tuning off.
+ * The pair-list buffer is kept, so rlist stays consistent with the new
+ * cut-offs also without a Verlet buffer tolerance. With a tolerance,
+ * rlist is set again later by prepare_verlet_scheme().
+ */
+static void applyPmeTuningRunSettings(const PmeTuningRunSettings& settings,
+                                      DomdecOptions*              domdecOptions,
+                                      MdrunOptions*               mdrunOptions,
+                                      t_inputrec*                 ir)
+{
+    ir->rlist    = std::max(ir->rlist + static_cast<real>(settings.rcoulomb) - ir->rcoulomb,
+                         ir->rlist + static_cast<real>(settings.rvdw) - ir->rvdw);
+    ir->nkx      = settings.nkx;
+    ir->nky      = settings.nky;
+    ir->nkz      = settings.nkz;
+    ir->rcoulomb = settings.rcoulomb;
+    ir->rvdw     = settings.rvdw;
+    GMX_RELEASE_ASSERT(ir->rlist >= std::max(ir->rcoulomb, ir->rvdw),
+                       "The pair-list cut-off should not be shorter than the interaction cut-offs");
+    if (domdecOptions->numPmeRanks == -1)
+    {
+        domdecOptions->numPmeRanks = settings.numPmeRanks;
+    }
+    mdrunOptions->tunePme = false;
+}
+
 /*! \brief Return whether GPU acceleration of nonbondeds is supported with the given settings.
  *
  * If not, and if a warning may be issued, logs a warning about
@@ -1012,6 +1128,30 @@ int Mdrunner::mdrunner()
         // largest supported by GROMACS, so no need for any particular check here.
     }
 
+    /* Apply the settings stored by earlier tuning, before they are used
+     * to decide the number of ranks and where PME runs */
+    std::optional<PmeTuningRunSettings> pmeTuningSettings;
+    if (isSimulationMainRank)
+    {
+        int numRanksRequested = hw_opt.nthreads_tmpi;
+#if GMX_LIB_MPI
+        MPI_Comm_size(simulationCommunicator, &numRanksRequested);
+#endif
+        pmeTuningSettings = lookUpPmeTuningCache(mdlog,
+                                                 ftp2fn(efTPR, filenames.size(), filenames.data()),
+                                                 *hwinfo_,
+                                                 numRanksRequested,
+                                                 domdecOptions.numPmeRanks,
+                                                 hw_opt.nthreads_omp,
+                                                 *inputrec,
+                                                 &mdrunOptions);
+        if (pmeTuningSettings)
+        {
+            applyPmeTuningRunSettings(
+                    *pmeTuningSettings, &domdecOptions, &mdrunOptions, inputrec.get());
+        }
+    }
+
     /* Check and update the hardware options for internal consistency */
     checkAndUpdateHardwareOptions(
             mdlog, &hw_opt, isSimulationMainRank, domdecOptions.numPmeRanks, inputrec.get());
@@ -1092,6 +1232,35 @@ int Mdrunner::mdrunner()
     GMX_RELEASE_ASSERT(inputrec != nullptr, "All ranks should have a valid inputrec now");
     partialDeserializedTpr.reset(nullptr);
 
+    if (PAR(cr))
+    {
+        /* The non-main ranks re-read the inputrec from the tpr contents,
+         * so they need to apply the cached settings as well */
+        int keyLength = mdrunOptions.pmeTuningCacheKey.size();
+        gmx_bcast(sizeof(keyLength), &keyLength, cr->mpiDefaultCommunicator);
+        mdrunOptions.pmeTuningCacheKey.resize(keyLength);
+        gmx_bcast(keyLength, mdrunOptions.pmeTuningCacheKey.data(), cr->mpiDefaultCommunicator);
+        bool havePmeTuningSettings = pmeTuningSettings.has_value();
+        gmx_bcast(sizeof(havePmeTuningSettings),
+                  &havePmeTuningSettings,
+                  cr->mpiDefaultCommunicator);
+        if (havePmeTuningSettings)
+        {
+            if (!MAIN(cr))
+            {
+                pmeTuningSettings.emplace();
+            }
+            gmx_bcast(sizeof(*pmeTuningSettings),
+                      &pmeTuningSettings.value(),
+                      cr->mpiDefaultCommunicator);
+            if (!MAIN(cr))
+            {
+                applyPmeTuningRunSettings(
+                        *pmeTuningSettings, &domdecOptions, &mdrunOptions, inputrec.get());
+            }
+        }
+    }
+
     // Note that these variables describe only their own node.
     //
     // Note that when bonded interactions run on a GPU they always run
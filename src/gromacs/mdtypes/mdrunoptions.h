@@ -48,6 +48,8 @@
 #ifndef GMX_MDTYPES_MDRUNOPTIONS_H
 #define GMX_MDTYPES_MDRUNOPTIONS_H
 
+#include <string>
+
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
 
@@ -119,6 +121,8 @@ struct MdrunOptions
     TimingOptions timingOptions;
     //! If true and supported, will tune the PP-PME load balance
     gmx_bool tunePme = TRUE;
+    //! Key of this run in the PME tuning cache, empty when the cache is not used
+    std::string pmeTuningCacheKey;
     //! True if the user explicitly set the -ntomp command line option
     gmx_bool ntompOptionIsSet = FALSE;
     //! Options for IMD
@@ -72,7 +72,8 @@ PmeLoadBalanceHelper::PmeLoadBalanceHelper(bool                 isVerbose,
                                            const MDLogger&      mdlog,
                                            const t_inputrec*    inputrec,
                                            gmx_wallcycle*       wcycle,
-                                           t_forcerec*          fr) :
+                                           t_forcerec*          fr,
+                                           const std::string&   pmeTuningCacheKey) :
     pme_loadbal_(nullptr),
     nextNSStep_(-1),
     isVerbose_(isVerbose),
@@ -83,7 +84,8 @@ PmeLoadBalanceHelper::PmeLoadBalanceHelper(bool                 isVerbose,
     mdlog_(mdlog),
     inputrec_(inputrec),
     wcycle_(wcycle),
-    fr_(fr)
+    fr_(fr),
+    pmeTuningCacheKey_(pmeTuningCacheKey)
 {
 }
 
@@ -92,8 +94,16 @@ void PmeLoadBalanceHelper::setup()
     const auto* box = statePropagatorData_->constBox();
     GMX_RELEASE_ASSERT(box[0][0] != 0 && box[1][1] != 0 && box[2][2] != 0,
                        "PmeLoadBalanceHelper cannot be initialized with zero box.");
-    pme_loadbal_init(
-            &pme_loadbal_, cr_, mdlog_, *inputrec_, box, *fr_->ic, *fr_->nbv, fr_->pmedata, fr_->nbv->useGpu());
+    pme_loadbal_init(&pme_loadbal_,
+                     cr_,
+                     mdlog_,
+                     *inputrec_,
+                     box,
+                     *fr_->ic,
+                     *fr_->nbv,
+                     fr_->pmedata,
+                     fr_->nbv->useGpu(),
+                     pmeTuningCacheKey_);
 }
 
 void PmeLoadBalanceHelper::run(gmx::Step step, gmx::Time gmx_unused time)
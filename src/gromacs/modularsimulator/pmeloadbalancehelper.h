@@ -43,6 +43,8 @@
 #ifndef GMX_MODULARSIMULATOR_PMELOADBALANCEHELPER_H
 #define GMX_MODULARSIMULATOR_PMELOADBALANCEHELPER_H
 
+#include <string>
+
 #include "modularsimulatorinterfaces.h"
 
 struct gmx_wallcycle;
@@ -82,7 +84,8 @@ public:
                          const MDLogger&      mdlog,
                          const t_inputrec*    inputrec,
                          gmx_wallcycle*       wcycle,
-                         t_forcerec*          fr);
+                         t_forcerec*          fr,
+                         const std::string&   pmeTuningCacheKey);
 
     //! Initialize the load balancing object
     void setup();
@@ -133,6 +136,8 @@ private:
     gmx_wallcycle* wcycle_;
     //! Parameters for force calculations.
     t_forcerec* fr_;
+    //! Key under which the tuned PME settings of this run are cached, can be empty
+    const std::string pmeTuningCacheKey_;
 };
 
 } // namespace gmx
@@ -580,15 +580,16 @@ ModularSimulatorAlgorithm ModularSimulatorAlgorithmBuilder::build()
                                                  legacySimulatorData_->fr_,
                                                  legacySimulatorData_->runScheduleWork_->simulationWork))
     {
-        algorithm.pmeLoadBalanceHelper_ =
-                std::make_unique<PmeLoadBalanceHelper>(legacySimulatorData_->mdrunOptions_.verbose,
-                                                       algorithm.statePropagatorData_.get(),
-                                                       legacySimulatorData_->fpLog_,
-                                                       legacySimulatorData_->cr_,
-                                                       legacySimulatorData_->mdLog_,
-                                                       legacySimulatorData_->inputRec_,
-                                                       legacySimulatorData_->wallCycleCounters_,
-                                                       legacySimulatorData_->fr_);
+        algorithm.pmeLoadBalanceHelper_ = std::make_unique<PmeLoadBalanceHelper>(
+                legacySimulatorData_->mdrunOptions_.verbose,
+                algorithm.statePropagatorData_.get(),
+                legacySimulatorData_->fpLog_,
+                legacySimulatorData_->cr_,
+                legacySimulatorData_->mdLog_,
+                legacySimulatorData_->inputRec_,
+                legacySimulatorData_->wallCycleCounters_,
+                legacySimulatorData_->fr_,
+                legacySimulatorData_->mdrunOptions_.pmeTuningCacheKey);
         registerWithInfrastructureAndSignallers(algorithm.pmeLoadBalanceHelper_.get());
     }
 
@@ -97,6 +97,8 @@
  *       other fields.
  *    -# The gmx::SelectionTreeElement::evaluate field is set to the correct
  *       evaluation function from evaluate.h.
+ *    -# Dynamic boolean expressions that only combine numeric comparisons
+ *       are marked to be evaluated with a gmx::SelectionBooleanProgram.
  *    .
  *  -# The evaluation function of all elements is replaced with the
  *     analyze_static() function to be able to initialize the element before
@@ -112,6 +114,8 @@
  *     \c SEL_CDATA_EVALMAX flag, which makes dynamic child expressions
  *     of \c BOOL_OR expressions evaluate to empty groups, while subexpressions
  *     of \c BOOL_AND are evaluated to largest possible groups.
+ *     Boolean expressions marked for a program are not short-circuiting:
+ *     all their dynamic children are evaluated in the same group.
  *     Memory is also allocated to store the results of the evaluation.
  *     For each element, analyze_static() calls the actual evaluation function
  *     after the element has been properly initialized.
@@ -128,7 +132,8 @@
  *     evaluated before they are referred to, the evaluation group/function is
  *     cleared.  At the same time, position calculation data is initialized for
  *     for selection method elements that require it.  Compiler data is also
- *     freed as it is no longer needed.
+ *     freed as it is no longer needed.  The final boolean programs are
+ *     also built in this pass.
  *  -# A final pass initializes the total masses and charges in the
  *     \c gmx_ana_selection_t data structures.
  *
@@ -261,6 +266,13 @@
  * in the first child. These are followed by the dynamic expressions, in the
  * order provided by the user.
  *
+ * Dynamic \ref BOOL_AND and \ref BOOL_OR elements that only combine numeric
+ * comparisons (possibly through other boolean elements) hold a
+ * gmx::SelectionBooleanProgram, and are evaluated with
+ * _gmx_sel_evaluate_boolean_program().  Negations and boolean children
+ * without a static part are flattened into the program of the topmost
+ * element; they are kept for printing purposes, but are not evaluated.
+ *
  *
  * \subsection selcompiler_tree_arith Arithmetic elements
  *
@@ -348,7 +360,9 @@ enum
      */
     SEL_CDATA_STATICMULTIEVALSUBEXPR = 64,
     /** Whether this expression is a part of a common subexpression. */
-    SEL_CDATA_COMMONSUBEXPR = 128
+    SEL_CDATA_COMMONSUBEXPR = 128,
+    /** Whether a boolean expression is evaluated with a gmx::SelectionBooleanProgram. */
+    SEL_CDATA_BOOLPROGRAM = 512
 };
 
 /*! \internal \brief
@@ -441,6 +455,10 @@ void _gmx_selelem_print_compiler_info(FILE* fp, const SelectionTreeElement& sel,
     {
         fprintf(fp, "Sc");
     }
+    if (sel.cdata->flags & SEL_CDATA_BOOLPROGRAM)
+    {
+        fprintf(fp, "P");
+    }
     if (!sel.cdata->flags)
     {
         fprintf(fp, "0");
@@ -1257,6 +1275,203 @@ static void init_item_evaloutput(const SelectionTreeElementPointer& sel)
 }
 
 
+/********************************************************************
+ * BOOLEAN PROGRAM INITIALIZATION
+ ********************************************************************/
+
+/*! \brief
+ * Checks whether an element can be an operand of a boolean program.
+ *
+ * \param[in] sel Element to check.
+ * \returns   true if \p sel is static, a numeric comparison, or a boolean
+ *      expression with only such operands.
+ *
+ * Operands of a boolean program are all evaluated in the same group, without
+ * the short-circuiting of _gmx_sel_evaluate_and() and _gmx_sel_evaluate_or().
+ * Only comparisons are accepted as dynamic operands, because they are cheap
+ * to evaluate for each atom; more expensive expressions such as distance
+ * based ones benefit more from being evaluated only in the smaller groups
+ * left by the short-circuiting.
+ */
+static bool is_boolean_program_operand(const SelectionTreeElementPointer& sel)
+{
+    if (!(sel->flags & SEL_DYNAMIC))
+    {
+        return true;
+    }
+    switch (sel->type)
+    {
+        case SEL_EXPRESSION: return sel->u.expr.method->name == sm_compare.name;
+
+        case SEL_BOOLEAN:
+        {
+            SelectionTreeElementPointer child = sel->child;
+            while (child)
+            {
+                if (!is_boolean_program_operand(child))
+                {
+                    return false;
+                }
+                child = child->next;
+            }
+            return true;
+        }
+
+        default: return false;
+    }
+}
+
+/*! \brief
+ * Appends the instructions for evaluating the value of an element to a program.
+ *
+ * \param[in,out] program Program to append to.
+ * \param[in]     sel     Element to append.
+ * \param[in]     depth   Number of bitmasks on the evaluation stack before
+ *     \p sel is evaluated.
+ * \param[in]     bInline Whether to inline \ref BOOL_NOT elements and
+ *     elements with \ref SEL_CDATA_BOOLPROGRAM that have no static part.
+ *
+ * Elements that are not inlined are evaluated as operands of the program.
+ * The program of an inlined element is freed.
+ */
+static void append_boolean_program(gmx::SelectionBooleanProgram*      program,
+                                   const SelectionTreeElementPointer& sel,
+                                   int                                depth,
+                                   bool                               bInline)
+{
+    using Operation = gmx::SelectionBooleanProgram::Operation;
+
+    if (bInline && sel->type == SEL_BOOLEAN && sel->u.boolt == BOOL_NOT)
+    {
+        append_boolean_program(program, sel->child, depth, bInline);
+        program->code.push_back({ Operation::Not, 0 });
+        return;
+    }
+    if (bInline && sel->type == SEL_BOOLEAN && (sel->cdata->flags & SEL_CDATA_BOOLPROGRAM)
+        && (sel->child->flags & SEL_DYNAMIC))
+    {
+        int                         count = 0;
+        SelectionTreeElementPointer child = sel->child;
+        while (child)
+        {
+            append_boolean_program(program, child, depth + count, bInline);
+            ++count;
+            child = child->next;
+        }
+        const Operation op = (sel->u.boolt == BOOL_AND ? Operation::And : Operation::Or);
+        program->code.push_back({ op, count });
+        sel->booleanProgram.reset();
+        return;
+    }
+    program->operands.push_back(sel);
+    program->code.push_back({ Operation::Load, static_cast<int>(program->operands.size()) - 1 });
+    program->stackDepth = std::max(program->stackDepth, depth + 1);
+}
+
+/*! \brief
+ * Builds the program for a boolean expression.
+ *
+ * \param[in,out] sel     \ref SEL_BOOLEAN element with
+ *     \ref SEL_CDATA_BOOLPROGRAM.
+ * \param[in]     bInline Whether to flatten the child boolean expressions
+ *     into the program (see append_boolean_program()).
+ *
+ * The static children, if any, are not part of the program:
+ * static analysis combines them into the first child, which
+ * _gmx_sel_evaluate_boolean_program() handles separately.
+ */
+static void build_boolean_program(const SelectionTreeElementPointer& sel, bool bInline)
+{
+    using Operation = gmx::SelectionBooleanProgram::Operation;
+
+    auto                        program = std::make_unique<gmx::SelectionBooleanProgram>();
+    int                         count   = 0;
+    SelectionTreeElementPointer child   = sel->child;
+    while (child && !(child->flags & SEL_DYNAMIC))
+    {
+        child = child->next;
+    }
+    while (child)
+    {
+        append_boolean_program(program.get(), child, count, bInline);
+        ++count;
+        child = child->next;
+    }
+    const Operation op = (sel->u.boolt == BOOL_AND ? Operation::And : Operation::Or);
+    program->code.push_back({ op, count });
+    sel->booleanProgram = std::move(program);
+}
+
+/*! \brief
+ * Marks boolean expressions that are evaluated with a program.
+ *
+ * \param[in,out] sel Root of the selection subtree to process.
+ *
+ * Sets \ref SEL_CDATA_BOOLPROGRAM for each dynamic \ref BOOL_AND and
+ * \ref BOOL_OR element whose operands are all accepted by
+ * is_boolean_program_operand(), and builds a program for it that has only
+ * the direct children as operands.
+ * analyze_static() uses this program, so that the memory for the children
+ * and their minimum and maximum groups are computed for the evaluation
+ * groups used by _gmx_sel_evaluate_boolean_program().
+ * The final programs are built by postprocess_item_boolean_program().
+ */
+static void init_item_boolean_program(const SelectionTreeElementPointer& sel)
+{
+    if (sel->type != SEL_SUBEXPRREF)
+    {
+        SelectionTreeElementPointer child = sel->child;
+        while (child)
+        {
+            init_item_boolean_program(child);
+            child = child->next;
+        }
+    }
+
+    if (sel->type == SEL_BOOLEAN && sel->u.boolt != BOOL_NOT && (sel->flags & SEL_DYNAMIC)
+        && is_boolean_program_operand(sel))
+    {
+        sel->cdata->flags |= SEL_CDATA_BOOLPROGRAM;
+        build_boolean_program(sel, false);
+    }
+}
+
+/*! \brief
+ * Flattens boolean expressions into their final programs.
+ *
+ * \param[in,out] sel Root of the selection subtree to process.
+ *
+ * For each topmost element with \ref SEL_CDATA_BOOLPROGRAM, the program is
+ * rebuilt such that negations and boolean expressions without a static
+ * part are evaluated by the same program, and the evaluation function is
+ * replaced with _gmx_sel_evaluate_boolean_program().
+ * Should be called after the static analysis, because the static parts are
+ * only known after it.
+ */
+static void postprocess_item_boolean_program(const SelectionTreeElementPointer& sel)
+{
+    if (sel->type == SEL_BOOLEAN && (sel->cdata->flags & SEL_CDATA_BOOLPROGRAM))
+    {
+        build_boolean_program(sel, true);
+        sel->cdata->evaluate = &_gmx_sel_evaluate_boolean_program;
+        for (const SelectionTreeElementPointer& operand : sel->booleanProgram->operands)
+        {
+            postprocess_item_boolean_program(operand);
+        }
+        return;
+    }
+    if (sel->type != SEL_SUBEXPRREF)
+    {
+        SelectionTreeElementPointer child = sel->child;
+        while (child)
+        {
+            postprocess_item_boolean_program(child);
+            child = child->next;
+        }
+    }
+}
+
+
 /********************************************************************
  * COMPILER DATA INITIALIZATION
  ********************************************************************/
@@ -1982,7 +2197,9 @@ static void evaluate_boolean_minmax_grps(const SelectionTreeElementPointer& sel,
 
         case BOOL_OR:
             /* We can assume here that the gmin of children do not overlap
-             * because of the way _gmx_sel_evaluate_or() works. */
+             * because of the way _gmx_sel_evaluate_or() works.
+             * With a boolean program, all children are evaluated in the same
+             * group, so the groups may overlap. */
             GMX_ASSERT(g != nullptr, "Need a valid group");
             gmx_ana_index_reserve(gmin, g->isize);
             gmx_ana_index_reserve(gmax, g->isize);
@@ -1991,7 +2208,14 @@ static void evaluate_boolean_minmax_grps(const SelectionTreeElementPointer& sel,
             child = sel->child->next;
             while (child && gmin->isize < g->isize)
             {
-                gmx_ana_index_merge(gmin, gmin, child->cdata->gmin);
+                if (sel->cdata->flags & SEL_CDATA_BOOLPROGRAM)
+                {
+                    gmx_ana_index_union(gmin, gmin, child->cdata->gmin);
+                }
+                else
+                {
+                    gmx_ana_index_merge(gmin, gmin, child->cdata->gmin);
+                }
                 gmx_ana_index_union(gmax, gmax, child->cdata->gmax);
                 child = child->next;
             }
@@ -2126,14 +2350,22 @@ static void analyze_static(gmx_sel_evaluate_t* data, const SelectionTreeElementP
                 /* Evaluate the selection.
                  * If the type is boolean, we must explicitly handle the
                  * static part evaluated in evaluate_boolean_static_part()
-                 * here because g may be larger. */
+                 * here because g may be larger.
+                 * Boolean programs are only used as the evaluation function
+                 * after the analysis, because the static part is evaluated
+                 * above with the original evaluation function. */
+                gmx_ana_index_t* evalGroup = g;
                 if (sel->u.boolt == BOOL_AND && sel->child->type == SEL_CONST)
                 {
-                    sel->cdata->evaluate(data, sel, sel->child->v.u.g);
+                    evalGroup = sel->child->v.u.g;
+                }
+                if (sel->cdata->flags & SEL_CDATA_BOOLPROGRAM)
+                {
+                    _gmx_sel_evaluate_boolean_program(data, sel, evalGroup);
                 }
                 else
                 {
-                    sel->cdata->evaluate(data, sel, g);
+                    sel->cdata->evaluate(data, sel, evalGroup);
                 }
 
                 /* Evaluate minimal and maximal selections */
@@ -2673,6 +2905,7 @@ void compileSelection(SelectionCollection* coll)
     while (item)
     {
         init_item_evalfunc(item);
+        init_item_boolean_program(item);
         setup_memory_pooling(item, sc->mempool);
         init_item_evaloutput(item);
         item = item->next;
@@ -2784,6 +3017,7 @@ void compileSelection(SelectionCollection* coll)
     {
         init_root_item(item, &sc->gall);
         postprocess_item_subexpressions(item);
+        postprocess_item_boolean_program(item);
         init_item_comg(item, &sc->pcc, post, flags);
         free_item_compilerdata(item);
         item = item->next;
@@ -54,12 +54,14 @@
 #include "evaluate.h"
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 
 #include <algorithm>
 #include <memory>
 
+#include "gromacs/math/functions.h"
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/selection/indexutil.h"
@@ -343,6 +345,10 @@ void _gmx_sel_print_evalfunc_name(FILE* fp, gmx::sel_evalfunc evalfunc)
     {
         fprintf(fp, "or");
     }
+    else if (evalfunc == &_gmx_sel_evaluate_boolean_program)
+    {
+        fprintf(fp, "bool_program");
+    }
     else if (evalfunc == &_gmx_sel_evaluate_arithmetic)
     {
         fprintf(fp, "arithmetic");
@@ -1141,6 +1147,216 @@ void _gmx_sel_evaluate_or(gmx_sel_evaluate_t*                     data,
 }
 
 
+//! Number of atoms stored in one word of a boolean program bitmask.
+static const int c_booleanMaskWordBits = 64;
+
+/*! \brief
+ * Sets the bits of a bitmask for atoms of a group that are in another group.
+ *
+ * \param[out] mask  Bitmask over the atoms of \p g.
+ * \param[in]  g     Group that defines the bit positions.
+ * \param[in]  sub   Group whose atoms should have their bits set.
+ *
+ * Both groups should be sorted.  Atoms in \p sub that are not in \p g are
+ * ignored.
+ */
+static void set_boolean_mask(uint64_t* mask, const gmx_ana_index_t* g, const gmx_ana_index_t* sub)
+{
+    std::fill(mask, mask + gmx::divideRoundUp(g->isize, c_booleanMaskWordBits), 0);
+    int j = 0;
+    for (int i = 0; i < sub->isize && j < g->isize; ++i)
+    {
+        const int atom = sub->index[i];
+        while (j < g->isize && g->index[j] < atom)
+        {
+            ++j;
+        }
+        if (j < g->isize && g->index[j] == atom)
+        {
+            mask[j / c_booleanMaskWordBits] |= uint64_t(1) << (j % c_booleanMaskWordBits);
+            ++j;
+        }
+    }
+}
+
+/*! \brief
+ * Stores the atoms of a group whose bits are set in a bitmask.
+ *
+ * \param[out] dest  Array with space for \p g->isize atoms.
+ * \param[in]  mask  Bitmask over the atoms of \p g.
+ * \param[in]  g     Group that defines the bit positions.
+ * \returns    Number of atoms stored in \p dest.
+ *
+ * Words without set bits are skipped, and the atoms within other words are
+ * stored without branching.
+ */
+static int compact_boolean_mask(int* dest, const uint64_t* mask, const gmx_ana_index_t* g)
+{
+    const int wordCount = gmx::divideRoundUp(g->isize, c_booleanMaskWordBits);
+    int       count     = 0;
+    for (int w = 0; w < wordCount; ++w)
+    {
+        const uint64_t word = mask[w];
+        if (word == 0)
+        {
+            continue;
+        }
+        const int  first = w * c_booleanMaskWordBits;
+        const int  end   = std::min(c_booleanMaskWordBits, g->isize - first);
+        const int* atoms = g->index + first;
+        for (int b = 0; b < end; ++b)
+        {
+            dest[count] = atoms[b];
+            count += static_cast<int>((word >> b) & 1);
+        }
+    }
+    return count;
+}
+
+/*!
+ * \param[in] data Data for the current frame.
+ * \param[in] sel Selection element being evaluated.
+ * \param[in] g   Group for which \p sel should be evaluated.
+ * \returns   0 on success, a non-zero error code on error.
+ *
+ * Evaluates a \ref BOOL_AND or \ref BOOL_OR element, together with the
+ * boolean expressions the compiler has flattened into its
+ * gmx::SelectionBooleanProgram.
+ *
+ * If the first child is static, it is evaluated first in the group \p g.
+ * For \ref BOOL_AND, the operands are then evaluated in the intersection
+ * of \p g and the static group, and for \ref BOOL_OR in the part of \p g
+ * that is not in the static group.  Otherwise, the operands are evaluated
+ * in \p g.  Unlike in _gmx_sel_evaluate_and() and _gmx_sel_evaluate_or(),
+ * each operand is evaluated in this same group.  Each value is converted to
+ * a bitmask over \p g, and the program combines the bitmasks word by word
+ * instead of intersecting and merging index groups.
+ *
+ * This function is used as gmx::SelectionTreeElement::evaluate for
+ * \ref SEL_BOOLEAN elements that have a program.
+ */
+void _gmx_sel_evaluate_boolean_program(gmx_sel_evaluate_t*                     data,
+                                       const gmx::SelectionTreeElementPointer& sel,
+                                       gmx_ana_index_t*                        g)
+{
+    gmx::SelectionBooleanProgram& program = *sel->booleanProgram;
+    using Operation                       = gmx::SelectionBooleanProgram::Operation;
+
+    const int wordCount = gmx::divideRoundUp(g->isize, c_booleanMaskWordBits);
+    program.masks.resize((program.stackDepth + 2) * wordCount);
+    uint64_t* domainMask = program.masks.data();
+    uint64_t* staticMask = domainMask + wordCount;
+    uint64_t* stack      = staticMask + wordCount;
+
+    /* Find the group where the operands are evaluated */
+    gmx_ana_index_t                    domain;
+    const SelectionTreeElementPointer& child       = sel->child;
+    const bool                         bStaticPart = !(child->flags & SEL_DYNAMIC);
+    if (bStaticPart)
+    {
+        MempoolSelelemReserver reserver;
+        if (child->evaluate)
+        {
+            reserver.reserve(child, g->isize);
+            child->evaluate(data, child, g);
+        }
+        set_boolean_mask(staticMask, g, child->v.u.g);
+        for (int w = 0; w < wordCount; ++w)
+        {
+            domainMask[w] = (sel->u.boolt == BOOL_AND ? staticMask[w] : ~staticMask[w]);
+        }
+        if (wordCount > 0 && g->isize % c_booleanMaskWordBits != 0)
+        {
+            domainMask[wordCount - 1] &=
+                    (uint64_t(1) << (g->isize % c_booleanMaskWordBits)) - 1;
+        }
+        program.domain.resize(g->isize);
+        gmx_ana_index_set(&domain,
+                          compact_boolean_mask(program.domain.data(), domainMask, g),
+                          program.domain.data(),
+                          0);
+    }
+    else
+    {
+        std::fill(domainMask, domainMask + wordCount, ~uint64_t(0));
+        if (wordCount > 0 && g->isize % c_booleanMaskWordBits != 0)
+        {
+            domainMask[wordCount - 1] = (uint64_t(1) << (g->isize % c_booleanMaskWordBits)) - 1;
+        }
+        gmx_ana_index_set(&domain, g->isize, g->index, 0);
+    }
+
+    /* Evaluate the operands and combine them */
+    uint64_t* result = stack;
+    if (domain.isize > 0)
+    {
+        int depth = 0;
+        for (const gmx::SelectionBooleanProgram::Instruction& instr : program.code)
+        {
+            switch (instr.op)
+            {
+                case Operation::Load:
+                {
+                    const SelectionTreeElementPointer& operand = program.operands[instr.operand];
+                    MempoolSelelemReserver             reserver(operand, domain.isize);
+                    operand->evaluate(data, operand, &domain);
+                    set_boolean_mask(stack + depth * wordCount, g, operand->v.u.g);
+                    ++depth;
+                    break;
+                }
+                case Operation::Not:
+                {
+                    uint64_t* mask = stack + (depth - 1) * wordCount;
+                    for (int w = 0; w < wordCount; ++w)
+                    {
+                        mask[w] = domainMask[w] & ~mask[w];
+                    }
+                    break;
+                }
+                case Operation::And:
+                case Operation::Or:
+                {
+                    depth -= instr.operand - 1;
+                    uint64_t* mask = stack + (depth - 1) * wordCount;
+                    for (int k = 1; k < instr.operand; ++k)
+                    {
+                        const uint64_t* other = mask + k * wordCount;
+                        if (instr.op == Operation::And)
+                        {
+                            for (int w = 0; w < wordCount; ++w)
+                            {
+                                mask[w] &= other[w];
+                            }
+                        }
+                        else
+                        {
+                            for (int w = 0; w < wordCount; ++w)
+                            {
+                                mask[w] |= other[w];
+                            }
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        GMX_ASSERT(depth == 1, "Boolean program should leave a single bitmask");
+    }
+    else
+    {
+        std::fill(result, result + wordCount, 0);
+    }
+    if (bStaticPart && sel->u.boolt == BOOL_OR)
+    {
+        for (int w = 0; w < wordCount; ++w)
+        {
+            result[w] |= staticMask[w];
+        }
+    }
+    sel->v.u.g->isize = compact_boolean_mask(sel->v.u.g->index, result, g);
+}
+
+
 /********************************************************************
  * ARITHMETIC EVALUATION
  ********************************************************************/
@@ -192,6 +192,10 @@ void _gmx_sel_evaluate_and(gmx_sel_evaluate_t*                     data,
 void _gmx_sel_evaluate_or(gmx_sel_evaluate_t*                     data,
                           const gmx::SelectionTreeElementPointer& sel,
                           gmx_ana_index_t*                        g);
+/** Evaluates a boolean AND or OR subtree using its flattened program. */
+void _gmx_sel_evaluate_boolean_program(gmx_sel_evaluate_t*                     data,
+                                       const gmx::SelectionTreeElementPointer& sel,
+                                       gmx_ana_index_t*                        g);
 /*@}*/
 
 #endif
@@ -67,12 +67,15 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/position.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/classhelpers.h"
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/stringutil.h"
@@ -83,6 +86,22 @@ namespace gmx
 namespace
 {
 
+#if GMX_SIMD_HAVE_REAL
+//! Number of reference positions that each grid cell is padded to.
+constexpr int c_gridCellPadding = GMX_SIMD_REAL_WIDTH;
+#else
+//! Number of reference positions that each grid cell is padded to.
+constexpr int c_gridCellPadding = 1;
+#endif
+
+/*! \brief
+ * Coordinate used for padding the grid cells.
+ *
+ * Chosen such that the padding never falls within the cutoff, while the
+ * squared distances still fit into a real.
+ */
+constexpr real c_gridPaddingCoordinate = 1e10;
+
 /*! \brief
  * Computes the bounding box for a set of positions.
  *
@@ -127,7 +146,6 @@ class AnalysisNeighborhoodSearchImpl
 public:
     typedef AnalysisNeighborhoodPairSearch::ImplPointer PairSearchImplPointer;
     typedef std::vector<PairSearchImplPointer>          PairSearchList;
-    typedef std::vector<std::vector<int>>               CellList;
 
     explicit AnalysisNeighborhoodSearchImpl(real cutoff);
     ~AnalysisNeighborhoodSearchImpl();
@@ -147,6 +165,14 @@ public:
                                const t_pbc*                         pbc,
                                const AnalysisNeighborhoodPositions& positions);
     PairSearchImplPointer getPairSearch();
+    /*! \brief
+     * Finds all pairs for a set of test positions.
+     *
+     * Implements AnalysisNeighborhoodSearch::findAllPairs().
+     */
+    void findAllPairs(const AnalysisNeighborhoodPositions&   positions,
+                      std::vector<AnalysisNeighborhoodPair>* pairs,
+                      int                                    threadCount) const;
 
     real cutoffSquared() const { return cutoff2_; }
     bool usesGridSearch() const { return bGrid_; }
@@ -209,8 +235,16 @@ private:
      *
      * \p cell should satisfy the conditions that \p mapPointToGridCell()
      * produces.
+     * The cell contents are only available after sortGridCells().
      */
     void addToGridCell(const rvec cell, int i);
+    /*! \brief
+     * Stores the positions added with addToGridCell() contiguously by cell.
+     *
+     * Within each cell, the positions are in the order of their indices.
+     * Each cell is padded to a multiple of the SIMD width.
+     */
+    void sortGridCells();
     /*! \brief
      * Initializes a cell pair loop for a dimension.
      *
@@ -267,6 +301,23 @@ private:
      * \returns    Grid cell index corresponding to `cell`.
      */
     int shiftCell(const ivec cell, rvec shift) const;
+    /*! \brief
+     * Finds all reference positions within the cutoff from a test position.
+     *
+     * \param[in]     x         Test position.
+     * \param[in]     testIndex Test index to store in the found pairs.
+     * \param[in]     excl      Excluded reference IDs for \p x (sorted).
+     * \param[in,out] pairs     Found pairs are appended here.
+     *
+     * Finds the same pairs in the same order as
+     * AnalysisNeighborhoodPairSearchImpl::searchNext().
+     */
+    void findTestPositionPairs(const rvec                             x,
+                               int                                    testIndex,
+                               ArrayRef<const int>                    excl,
+                               std::vector<AnalysisNeighborhoodPair>* pairs) const;
+    //! Checks whether reference position \p j is in the exclusion list \p excl.
+    bool isExcluded(ArrayRef<const int> excl, int j) const;
 
     //! Whether to try grid searching.
     bool bTryGrid_;
@@ -321,8 +372,27 @@ private:
     real cellShiftYX_;
     //! Number of cells along each dimension.
     ivec ncelldim_;
-    //! Data structure to hold the grid cell contents.
-    CellList cells_;
+    //! Total number of grid cells.
+    int totalCellCount_;
+    //! Grid cell index for each reference position (used during init()).
+    std::vector<int> refCellIndex_;
+    /*! \brief
+     * Start of each grid cell in the cell arrays below.
+     *
+     * Has one extra entry at the end, such that the padded cell `ci`
+     * spans `[cellStart_[ci], cellStart_[ci + 1])`.
+     */
+    std::vector<int> cellStart_;
+    //! End of the actual (non-padding) positions in each grid cell.
+    std::vector<int> cellEnd_;
+    //! Reference position indices sorted by grid cell (-1 for padding).
+    std::vector<int> cellRefIndices_;
+    //! X coordinates of the reference positions sorted by grid cell.
+    std::vector<real, AlignedAllocator<real>> cellRefX_;
+    //! Y coordinates of the reference positions sorted by grid cell.
+    std::vector<real, AlignedAllocator<real>> cellRefY_;
+    //! Z coordinates of the reference positions sorted by grid cell.
+    std::vector<real, AlignedAllocator<real>> cellRefZ_;
 
     std::mutex     createPairSearchMutex_;
     PairSearchList pairSearchList_;
@@ -442,6 +512,7 @@ AnalysisNeighborhoodSearchImpl::AnalysisNeighborhoodSearchImpl(real cutoff)
     clear_rvec(cellSize_);
     clear_rvec(invCellSize_);
     clear_ivec(ncelldim_);
+    totalCellCount_ = 0;
 }
 
 AnalysisNeighborhoodSearchImpl::~AnalysisNeighborhoodSearchImpl()
@@ -546,17 +617,7 @@ bool AnalysisNeighborhoodSearchImpl::initGridCells(const matrix box, bool bSingl
     {
         return false;
     }
-    // Never decrease the size of the cell vector to avoid reallocating
-    // memory for the nested vectors.  The actual size of the vector is not
-    // used outside this function.
-    if (cells_.size() < static_cast<size_t>(totalCellCount))
-    {
-        cells_.resize(totalCellCount);
-    }
-    for (int ci = 0; ci < totalCellCount; ++ci)
-    {
-        cells_[ci].clear();
-    }
+    totalCellCount_ = totalCellCount;
     return true;
 }
 
@@ -720,8 +781,40 @@ int AnalysisNeighborhoodSearchImpl::getGridCellIndex(const rvec cell) const
 
 void AnalysisNeighborhoodSearchImpl::addToGridCell(const rvec cell, int i)
 {
-    const int ci = getGridCellIndex(cell);
-    cells_[ci].push_back(i);
+    refCellIndex_[i] = getGridCellIndex(cell);
+}
+
+void AnalysisNeighborhoodSearchImpl::sortGridCells()
+{
+    // Count the positions in each cell, and compute the padded cell starts.
+    cellEnd_.assign(totalCellCount_, 0);
+    for (int i = 0; i < nref_; ++i)
+    {
+        ++cellEnd_[refCellIndex_[i]];
+    }
+    cellStart_.resize(totalCellCount_ + 1);
+    int start = 0;
+    for (int ci = 0; ci < totalCellCount_; ++ci)
+    {
+        const int count = cellEnd_[ci];
+        cellStart_[ci]  = start;
+        cellEnd_[ci]    = start;
+        start += ((count + c_gridCellPadding - 1) / c_gridCellPadding) * c_gridCellPadding;
+    }
+    cellStart_[totalCellCount_] = start;
+
+    cellRefIndices_.assign(start, -1);
+    cellRefX_.assign(start, c_gridPaddingCoordinate);
+    cellRefY_.assign(start, c_gridPaddingCoordinate);
+    cellRefZ_.assign(start, c_gridPaddingCoordinate);
+    for (int i = 0; i < nref_; ++i)
+    {
+        const int j        = cellEnd_[refCellIndex_[i]]++;
+        cellRefIndices_[j] = i;
+        cellRefX_[j]       = xref_[i][XX];
+        cellRefY_[j]       = xref_[i][YY];
+        cellRefZ_[j]       = xref_[i][ZZ];
+    }
 }
 
 void AnalysisNeighborhoodSearchImpl::initCellRange(const rvec centerCell, ivec currCell, ivec upperBound, int dim) const
@@ -924,6 +1017,7 @@ void AnalysisNeighborhoodSearchImpl::init(AnalysisNeighborhood::SearchMode     m
     {
         xrefAlloc_.resize(nref_);
         xref_ = as_rvec_array(xrefAlloc_.data());
+        refCellIndex_.resize(nref_);
 
         for (int i = 0; i < nref_; ++i)
         {
@@ -932,6 +1026,7 @@ void AnalysisNeighborhoodSearchImpl::init(AnalysisNeighborhood::SearchMode     m
             mapPointToGridCell(positions.x_[ii], refcell, xrefAlloc_[i]);
             addToGridCell(refcell, i);
         }
+        sortGridCells();
     }
     else if (refIndices_ != nullptr)
     {
@@ -958,6 +1053,174 @@ void AnalysisNeighborhoodSearchImpl::init(AnalysisNeighborhood::SearchMode     m
     }
 }
 
+bool AnalysisNeighborhoodSearchImpl::isExcluded(ArrayRef<const int> excl, int j) const
+{
+    if (excl.empty())
+    {
+        return false;
+    }
+    const int index = (refIndices_ != nullptr ? refIndices_[j] : j);
+    return std::binary_search(excl.begin(), excl.end(), refExclusionIds_[index]);
+}
+
+void AnalysisNeighborhoodSearchImpl::findTestPositionPairs(const rvec          x,
+                                                           int                 testIndex,
+                                                           ArrayRef<const int> excl,
+                                                           std::vector<AnalysisNeighborhoodPair>* pairs) const
+{
+    if (!bGrid_)
+    {
+        for (int i = 0; i < nref_; ++i)
+        {
+            if (isExcluded(excl, i))
+            {
+                continue;
+            }
+            rvec dx;
+            if (pbc_.pbcType != PbcType::No)
+            {
+                pbc_dx(&pbc_, xref_[i], x, dx);
+            }
+            else
+            {
+                rvec_sub(xref_[i], x, dx);
+            }
+            const real r2 = bXY_ ? dx[XX] * dx[XX] + dx[YY] * dx[YY] : norm2(dx);
+            if (r2 <= cutoff2_)
+            {
+                pairs->emplace_back(i, testIndex, r2, dx);
+            }
+        }
+        return;
+    }
+
+    rvec xtest, testcell;
+    ivec currCell, cellBound;
+    mapPointToGridCell(x, testcell, xtest);
+    initCellRange(testcell, currCell, cellBound, ZZ);
+    initCellRange(testcell, currCell, cellBound, YY);
+    initCellRange(testcell, currCell, cellBound, XX);
+
+    // The distances are recomputed exactly as in
+    // AnalysisNeighborhoodPairSearchImpl::searchNext() for the final check,
+    // so the SIMD filter only needs to be conservative.
+    const auto addPairIfWithin = [&](int j, const rvec shift)
+    {
+        const int i = cellRefIndices_[j];
+        if (isExcluded(excl, i))
+        {
+            return;
+        }
+        rvec dx;
+        rvec_sub(xref_[i], xtest, dx);
+        rvec_sub(dx, shift, dx);
+        const real r2 = bXY_ ? dx[XX] * dx[XX] + dx[YY] * dx[YY] : norm2(dx);
+        if (r2 <= cutoff2_)
+        {
+            pairs->emplace_back(i, testIndex, r2, dx);
+        }
+    };
+#if GMX_SIMD_HAVE_REAL
+    const real     filterCutoff2 = cutoff2_ * (1 + 10 * GMX_REAL_EPS);
+    const SimdReal cutoff2S(filterCutoff2);
+    const SimdReal xtestS(xtest[XX]);
+    const SimdReal ytestS(xtest[YY]);
+    const SimdReal ztestS(xtest[ZZ]);
+#endif
+    do
+    {
+        rvec      shift;
+        const int ci        = shiftCell(currCell, shift);
+        const int cellStart = cellStart_[ci];
+        const int cellEnd   = cellEnd_[ci];
+#if GMX_SIMD_HAVE_REAL
+        const SimdReal shiftXS(shift[XX]);
+        const SimdReal shiftYS(shift[YY]);
+        const SimdReal shiftZS(shift[ZZ]);
+        for (int j = cellStart; j < cellEnd; j += GMX_SIMD_REAL_WIDTH)
+        {
+            const SimdReal dx = load<SimdReal>(cellRefX_.data() + j) - xtestS - shiftXS;
+            const SimdReal dy = load<SimdReal>(cellRefY_.data() + j) - ytestS - shiftYS;
+            SimdReal       r2 = dx * dx + dy * dy;
+            if (!bXY_)
+            {
+                const SimdReal dz = load<SimdReal>(cellRefZ_.data() + j) - ztestS - shiftZS;
+                r2                = r2 + dz * dz;
+            }
+            if (anyTrue(r2 <= cutoff2S))
+            {
+                alignas(GMX_SIMD_ALIGNMENT) real r2Buffer[GMX_SIMD_REAL_WIDTH];
+                store(r2Buffer, r2);
+                const int laneCount = std::min(GMX_SIMD_REAL_WIDTH, cellEnd - j);
+                for (int l = 0; l < laneCount; ++l)
+                {
+                    if (r2Buffer[l] <= filterCutoff2)
+                    {
+                        addPairIfWithin(j + l, shift);
+                    }
+                }
+            }
+        }
+#else
+        for (int j = cellStart; j < cellEnd; ++j)
+        {
+            addPairIfWithin(j, shift);
+        }
+#endif
+    } while (nextCell(testcell, currCell, cellBound));
+}
+
+void AnalysisNeighborhoodSearchImpl::findAllPairs(const AnalysisNeighborhoodPositions& positions,
+                                                  std::vector<AnalysisNeighborhoodPair>* pairs,
+                                                  int threadCount) const
+{
+    GMX_RELEASE_ASSERT(excls_ == nullptr || positions.exclusionIds_ != nullptr,
+                       "Exclusion IDs must be set when exclusions are enabled");
+    // As in AnalysisNeighborhoodPairSearchImpl::startSearch(), a single
+    // indexed position keeps its index as the test index.
+    const int firstTestIndex = std::max(positions.index_, 0);
+    const int testPosCount   = (positions.index_ < 0 ? positions.count_ : positions.index_ + 1);
+    const int searchCount    = testPosCount - firstTestIndex;
+    threadCount              = std::max(1, std::min(threadCount, searchCount));
+
+    pairs->clear();
+    // Each thread handles a contiguous block of test positions, and the
+    // blocks are concatenated in order, so the output does not depend on
+    // the number of threads.
+    std::vector<std::vector<AnalysisNeighborhoodPair>> threadPairs(threadCount - 1);
+#pragma omp parallel for num_threads(threadCount) schedule(static)
+    for (int thread = 0; thread < threadCount; ++thread)
+    {
+        try
+        {
+            std::vector<AnalysisNeighborhoodPair>* threadOutput =
+                    (thread == 0 ? pairs : &threadPairs[thread - 1]);
+            const int start = firstTestIndex + (searchCount * thread) / threadCount;
+            const int end   = firstTestIndex + (searchCount * (thread + 1)) / threadCount;
+            for (int testIndex = start; testIndex < end; ++testIndex)
+            {
+                const int index =
+                        (positions.indices_ != nullptr ? positions.indices_[testIndex] : testIndex);
+                ArrayRef<const int> excl;
+                if (excls_ != nullptr)
+                {
+                    const int exclIndex = positions.exclusionIds_[index];
+                    if (exclIndex < excls_->ssize())
+                    {
+                        excl = (*excls_)[exclIndex];
+                    }
+                }
+                findTestPositionPairs(positions.x_[index], testIndex, excl, threadOutput);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    for (const auto& threadOutput : threadPairs)
+    {
+        pairs->insert(pairs->end(), threadOutput.begin(), threadOutput.end());
+    }
+}
+
 /********************************************************************
  * AnalysisNeighborhoodPairSearchImpl
  */
@@ -1088,10 +1351,11 @@ bool AnalysisNeighborhoodPairSearchImpl::searchNext(Action action)
                 {
                     continue;
                 }
-                const int cellSize = gmx::ssize(search_.cells_[ci]);
+                const int cellStart = search_.cellStart_[ci];
+                const int cellSize  = search_.cellEnd_[ci] - cellStart;
                 for (; cai < cellSize; ++cai)
                 {
-                    const int i = search_.cells_[ci][cai];
+                    const int i = search_.cellRefIndices_[cellStart + cai];
                     if (selfSearchMode_ && ci == testCellIndex_ && i >= testIndex_)
                     {
                         continue;
@@ -1394,6 +1658,14 @@ AnalysisNeighborhoodPair AnalysisNeighborhoodSearch::nearestPoint(const Analysis
     return AnalysisNeighborhoodPair(closestPoint, 0, minDist2, dx);
 }
 
+void AnalysisNeighborhoodSearch::findAllPairs(const AnalysisNeighborhoodPositions&   positions,
+                                              std::vector<AnalysisNeighborhoodPair>* pairs,
+                                              int                                    threadCount) const
+{
+    GMX_RELEASE_ASSERT(impl_, "Accessing an invalid search object");
+    impl_->findAllPairs(positions, pairs, threadCount);
+}
+
 AnalysisNeighborhoodPairSearch AnalysisNeighborhoodSearch::startSelfPairSearch() const
 {
     GMX_RELEASE_ASSERT(impl_, "Accessing an invalid search object");
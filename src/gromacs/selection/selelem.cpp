@@ -169,6 +169,7 @@ SelectionTreeElement::~SelectionTreeElement()
     /* Free the children.
      * Must be done before freeing other data, because the children may hold
      * references to data in this element. */
+    booleanProgram.reset();
     child.reset();
 
     freeValues();
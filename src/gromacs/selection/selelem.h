@@ -48,10 +48,12 @@
 #ifndef GMX_SELECTION_SELELEM_H
 #define GMX_SELECTION_SELELEM_H
 
+#include <cstdint>
 #include <cstdio>
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "gromacs/selection/indexutil.h"
 #include "gromacs/utility/classhelpers.h"
@@ -273,6 +275,53 @@ struct SelectionLocation
     int endIndex;
 };
 
+/*! \internal
+ * \brief
+ * Flattened evaluation program for a dynamic boolean expression subtree.
+ *
+ * The compiler builds this for \ref BOOL_AND and \ref BOOL_OR elements whose
+ * dynamic operands are all numeric comparisons or other such boolean
+ * expressions.  The static part in the first child is evaluated as in
+ * _gmx_sel_evaluate_and() and _gmx_sel_evaluate_or().  All other operands
+ * (elements that are not boolean expressions themselves) are evaluated once
+ * in the remaining group, after which the postfix \a code combines them as
+ * bitmasks over the evaluation group, 64 atoms per word.
+ * See _gmx_sel_evaluate_boolean_program().
+ */
+struct SelectionBooleanProgram
+{
+    //! Operation performed by a single instruction.
+    enum class Operation
+    {
+        Load, //!< Evaluate an operand and push its bitmask.
+        Not,  //!< Complement the topmost bitmask.
+        And,  //!< Replace the topmost bitmasks with their intersection.
+        Or    //!< Replace the topmost bitmasks with their union.
+    };
+    //! Single instruction of the program.
+    struct Instruction
+    {
+        //! Operation to perform.
+        Operation op;
+        /*! \brief
+         * Index into \a operands for Operation::Load, or the number of
+         * bitmasks to combine for Operation::And and Operation::Or.
+         */
+        int operand;
+    };
+
+    //! Instructions in postfix order.
+    std::vector<Instruction> code;
+    //! Leaf elements of the subtree, in evaluation order.
+    std::vector<SelectionTreeElementPointer> operands;
+    //! Maximum number of bitmasks on the evaluation stack.
+    int stackDepth = 0;
+    //! Scratch storage for the bitmasks.
+    std::vector<uint64_t> masks;
+    //! Scratch storage for the group where the operands are evaluated.
+    std::vector<int> domain;
+};
+
 /*! \internal \brief
  * Represents an element of a selection expression.
  */
@@ -470,6 +519,13 @@ public:
     struct gmx_sel_mempool_t* mempool;
     //! Internal data for the selection compiler.
     t_compiler_data* cdata;
+    /*! \brief
+     * Flattened program for evaluating a boolean subtree.
+     *
+     * Only set by the compiler for \ref SEL_BOOLEAN elements evaluated with
+     * _gmx_sel_evaluate_boolean_program().
+     */
+    std::unique_ptr<SelectionBooleanProgram> booleanProgram;
 
     /*! \brief The first child element.
      *
@@ -546,6 +546,39 @@ static void evaluate_compare_int(gmx_ana_index_t* g, gmx_ana_selvalue_t* out, vo
     out->u.g->isize = ig;
 }
 
+/*! \brief
+ * Selects the atoms for which a comparison of two real-valued operands holds.
+ *
+ * \param[in]  g       Evaluation index group.
+ * \param[in]  left    Left operand values.
+ * \param[in]  lstride 1 if \p left has a value for each atom, 0 otherwise.
+ * \param[in]  right   Right operand values.
+ * \param[in]  rstride 1 if \p right has a value for each atom, 0 otherwise.
+ * \param[out] index   Output atom indices (can be the same as \p g->index).
+ * \param[in]  compare Comparison to evaluate for each atom.
+ * \returns    The number of selected atoms.
+ *
+ * The comparison is passed as a functor to get a separate loop without
+ * branches in the loop body for each operator.
+ */
+template<typename Compare>
+static int select_compare_real(const gmx_ana_index_t* g,
+                               const real*            left,
+                               int                    lstride,
+                               const real*            right,
+                               int                    rstride,
+                               int*                   index,
+                               Compare                compare)
+{
+    int ig = 0;
+    for (int i = 0; i < g->isize; ++i)
+    {
+        index[ig] = g->index[i];
+        ig += compare(left[i * lstride], right[i * rstride]) ? 1 : 0;
+    }
+    return ig;
+}
+
 /*! \brief
  * Implementation for evaluate_compare() if either value is non-integer.
  *
@@ -563,6 +596,45 @@ static void evaluate_compare_real(gmx_ana_index_t* g, gmx_ana_selvalue_t* out, v
     real                  a, b;
     bool                  bAccept;
 
+    if ((d->right.flags & CMP_REALVAL) && d->cmpt != CMP_INVALID)
+    {
+        const real* left    = d->left.r;
+        const int   lstride = (d->left.flags & CMP_SINGLEVAL) ? 0 : 1;
+        const real* right   = d->right.r;
+        const int   rstride = (d->right.flags & CMP_SINGLEVAL) ? 0 : 1;
+        int*        index   = out->u.g->index;
+        switch (d->cmpt)
+        {
+            case CMP_LESS:
+                ig = select_compare_real(
+                        g, left, lstride, right, rstride, index, [](real l, real r) { return l < r; });
+                break;
+            case CMP_LEQ:
+                ig = select_compare_real(
+                        g, left, lstride, right, rstride, index, [](real l, real r) { return l <= r; });
+                break;
+            case CMP_GTR:
+                ig = select_compare_real(
+                        g, left, lstride, right, rstride, index, [](real l, real r) { return l > r; });
+                break;
+            case CMP_GEQ:
+                ig = select_compare_real(
+                        g, left, lstride, right, rstride, index, [](real l, real r) { return l >= r; });
+                break;
+            case CMP_EQUAL:
+                ig = select_compare_real(g, left, lstride, right, rstride, index, [](real l, real r) {
+                    return gmx_within_tol(l, r, GMX_REAL_EPS);
+                });
+                break;
+            default:
+                ig = select_compare_real(g, left, lstride, right, rstride, index, [](real l, real r) {
+                    return !gmx_within_tol(l, r, GMX_REAL_EPS);
+                });
+                break;
+        }
+        out->u.g->isize = ig;
+        return;
+    }
     for (i = i1 = i2 = ig = 0; i < g->isize; ++i)
     {
         a       = d->left.r[i1];
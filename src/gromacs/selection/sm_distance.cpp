@@ -43,12 +43,22 @@
  */
 #include "gmxpre.h"
 
+#include <cmath>
+#include <cstdlib>
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/indexutil.h"
 #include "gromacs/selection/nbsearch.h"
 #include "gromacs/selection/position.h"
 #include "gromacs/selection/selparam.h"
 #include "gromacs/selection/selvalue.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/real.h"
@@ -58,6 +68,70 @@
 
 struct gmx_mtop_t;
 
+/*! \brief
+ * Default skin (in nm) added to the cutoff for the candidate lists.
+ *
+ * Can be changed with the GMX_SELECTION_DISTANCE_SKIN environment variable;
+ * zero disables the candidate lists.
+ */
+static const real c_defaultDistanceSkin = 0.1;
+
+/*! \internal
+ * \brief
+ * Verlet-style candidate lists for distance-based selection methods.
+ *
+ * Instead of searching the neighbors from scratch in every frame, the
+ * reference positions are put on a search grid with the cutoff increased by
+ * a skin, and for each test position, the reference positions within this
+ * longer cutoff are stored.  In later frames, it is sufficient to check the
+ * stored candidates, as long as the reference positions, the test position
+ * and the box have together moved less than the skin since the search was
+ * built (see get_candidates()).  Otherwise, the list for the test position
+ * is recomputed, and the whole search is rebuilt once the reference
+ * positions have moved by more than half the skin.
+ *
+ * \ingroup module_selection
+ */
+struct t_distance_candidates
+{
+    t_distance_candidates() :
+        skin(0), bBuilt(false), generation(0), buildPbcType(PbcType::No), refDisplacement(0)
+    {
+        clear_mat(buildBox);
+    }
+
+    /** Skin added to the cutoff; zero if the candidate lists are not used. */
+    real skin;
+    /** Neighborhood search data with the cutoff increased by \p skin. */
+    gmx::AnalysisNeighborhood nb;
+    /** Search against \p buildRefX. */
+    gmx::AnalysisNeighborhoodSearch nbsearch;
+    /** Whether \p nbsearch has been built. */
+    bool bBuilt;
+    /** Incremented every time \p nbsearch is rebuilt. */
+    int generation;
+    /** Reference positions when \p nbsearch was built. */
+    std::vector<gmx::RVec> buildRefX;
+    /** PBC type when \p nbsearch was built. */
+    PbcType buildPbcType;
+    /** Box when \p nbsearch was built. */
+    matrix buildBox;
+    /** Largest displacement of a reference position since the build. */
+    real refDisplacement;
+    /** Lower corner of the bounding box of the current reference positions. */
+    gmx::RVec refLower;
+    /** Upper corner of the bounding box of the current reference positions. */
+    gmx::RVec refUpper;
+    /** Candidate reference positions for each test position reference ID. */
+    std::vector<std::vector<int>> candidates;
+    /** Test position for which each list in \p candidates was computed. */
+    std::vector<gmx::RVec> candidateX;
+    /** Value of \p generation for each list in \p candidates (-1 if none). */
+    std::vector<int> candidateGeneration;
+    /** Temporary list for test positions without a reference ID. */
+    std::vector<int> scratch;
+};
+
 /*! \internal
  * \brief
  * Data structure for distance-based selection method.
@@ -78,6 +152,8 @@ struct t_methoddata_distance
     gmx::AnalysisNeighborhood nb;
     /** Neighborhood search for an invididual frame. */
     gmx::AnalysisNeighborhoodSearch nbsearch;
+    /** Candidate lists reused between frames (if a cutoff is set). */
+    t_distance_candidates cand;
 };
 
 /*! \brief
@@ -125,15 +201,15 @@ static void free_data_common(void* data);
  */
 static void init_frame_common(const gmx::SelMethodEvalContext& context, void* data);
 /** Evaluates the \p distance selection method. */
-static void evaluate_distance(const gmx::SelMethodEvalContext& /*context*/,
-                              gmx_ana_pos_t*      pos,
-                              gmx_ana_selvalue_t* out,
-                              void*               data);
+static void evaluate_distance(const gmx::SelMethodEvalContext& context,
+                              gmx_ana_pos_t*                   pos,
+                              gmx_ana_selvalue_t*              out,
+                              void*                            data);
 /** Evaluates the \p within selection method. */
-static void evaluate_within(const gmx::SelMethodEvalContext& /*context*/,
-                            gmx_ana_pos_t*      pos,
-                            gmx_ana_selvalue_t* out,
-                            void*               data);
+static void evaluate_within(const gmx::SelMethodEvalContext& context,
+                            gmx_ana_pos_t*                   pos,
+                            gmx_ana_selvalue_t*              out,
+                            void*                            data);
 
 /** Parameters for the \p distance selection method. */
 static gmx_ana_selparam_t smparams_distance[] = {
@@ -247,6 +323,20 @@ static void init_common(const gmx_mtop_t* /* top */, int /* npar */, gmx_ana_sel
         GMX_THROW(gmx::InvalidInputError("Distance cutoff should be > 0"));
     }
     d->nb.setCutoff(d->cutoff);
+    if (d->cutoff > 0)
+    {
+        real        skin   = c_defaultDistanceSkin;
+        const char* envVar = std::getenv("GMX_SELECTION_DISTANCE_SKIN");
+        if (envVar != nullptr)
+        {
+            skin = std::max(static_cast<real>(std::strtod(envVar, nullptr)), 0.0_real);
+        }
+        d->cand.skin = skin;
+        if (skin > 0)
+        {
+            d->cand.nb.setCutoff(d->cutoff + skin);
+        }
+    }
 }
 
 /*!
@@ -260,13 +350,216 @@ static void free_data_common(void* data)
     delete static_cast<t_methoddata_distance*>(data);
 }
 
+/*! \brief
+ * Returns whether the candidate lists can be used with the given PBC.
+ */
+static bool use_candidates(const t_methoddata_distance& d, const t_pbc* pbc)
+{
+    return d.cand.skin > 0 && (pbc == nullptr || pbc->pbcType != PbcType::Screw);
+}
+
+/*! \brief
+ * Builds the candidate search for the current reference positions.
+ */
+static void build_candidate_search(t_methoddata_distance* d, const t_pbc* pbc)
+{
+    t_distance_candidates& c = d->cand;
+    c.buildRefX.assign(d->p.x, d->p.x + d->p.count());
+    c.buildPbcType = (pbc != nullptr ? pbc->pbcType : PbcType::No);
+    if (pbc != nullptr)
+    {
+        copy_mat(pbc->box, c.buildBox);
+    }
+    else
+    {
+        clear_mat(c.buildBox);
+    }
+    c.nbsearch.reset();
+    gmx::AnalysisNeighborhoodPositions pos(as_rvec_array(c.buildRefX.data()), c.buildRefX.size());
+    c.nbsearch        = c.nb.initSearch(pbc, pos);
+    c.bBuilt          = true;
+    c.refDisplacement = 0;
+    ++c.generation;
+}
+
+/*! \brief
+ * Bounds how much a change in the box can change a pair distance.
+ *
+ * \param[in] c      Candidate lists (for the box at build time).
+ * \param[in] pbc    Current PBC information.
+ * \param[in] extent Upper bound for the distance between any test and
+ *     reference position without PBC, plus the cutoff.
+ *
+ * A pair within the cutoff is shifted by at most a certain number of each
+ * box vector, which can be bounded from \p extent.  The distance for the
+ * same shift in the box at build time differs by at most that number times
+ * the change in the box vector.
+ */
+static real box_change_bound(const t_distance_candidates& c, const t_pbc* pbc, real extent)
+{
+    if (pbc == nullptr || pbc->pbcType == PbcType::No)
+    {
+        return 0;
+    }
+    matrix delta;
+    m_sub(pbc->box, c.buildBox, delta);
+    const int npbcdim = numPbcDimensions(pbc->pbcType);
+    real      shiftCount[DIM];
+    real      bound = 0;
+    for (int d = npbcdim - 1; d >= 0; --d)
+    {
+        real maxShift = extent;
+        for (int e = d + 1; e < npbcdim; ++e)
+        {
+            maxShift += shiftCount[e] * std::fabs(pbc->box[e][d]);
+        }
+        shiftCount[d] = std::floor(maxShift / pbc->box[d][d]);
+        bound += shiftCount[d] * norm(delta[d]);
+    }
+    return bound;
+}
+
 static void init_frame_common(const gmx::SelMethodEvalContext& context, void* data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
 
-    d->nbsearch.reset();
-    gmx::AnalysisNeighborhoodPositions pos(d->p.x, d->p.count());
-    d->nbsearch = d->nb.initSearch(context.pbc_, pos);
+    if (!use_candidates(*d, context.pbc_))
+    {
+        d->nbsearch.reset();
+        gmx::AnalysisNeighborhoodPositions pos(d->p.x, d->p.count());
+        d->nbsearch = d->nb.initSearch(context.pbc_, pos);
+        return;
+    }
+
+    t_distance_candidates& c       = d->cand;
+    const int              nref    = d->p.count();
+    const PbcType          pbcType = (context.pbc_ != nullptr ? context.pbc_->pbcType : PbcType::No);
+    bool bRebuild = (!c.bBuilt || gmx::ssize(c.buildRefX) != nref || pbcType != c.buildPbcType);
+    real maxDisplacement2 = 0;
+    if (!bRebuild)
+    {
+        for (int i = 0; i < nref; ++i)
+        {
+            maxDisplacement2 = std::max(maxDisplacement2, distance2(d->p.x[i], c.buildRefX[i]));
+        }
+        c.refDisplacement = std::sqrt(maxDisplacement2);
+        bRebuild          = (c.refDisplacement > 0.5 * c.skin);
+    }
+    if (bRebuild)
+    {
+        build_candidate_search(d, context.pbc_);
+    }
+    for (int dd = 0; dd < DIM; ++dd)
+    {
+        c.refLower[dd] = (nref > 0 ? d->p.x[0][dd] : 0);
+        c.refUpper[dd] = c.refLower[dd];
+    }
+    for (int i = 1; i < nref; ++i)
+    {
+        for (int dd = 0; dd < DIM; ++dd)
+        {
+            c.refLower[dd] = std::min(c.refLower[dd], d->p.x[i][dd]);
+            c.refUpper[dd] = std::max(c.refUpper[dd], d->p.x[i][dd]);
+        }
+    }
+}
+
+/*! \brief
+ * Prepares the candidate lists for evaluating a set of test positions.
+ *
+ * \returns The part of the skin that remains for the test position
+ *     displacements.
+ *
+ * Rebuilds the search if the reference positions and the box have changed
+ * too much for the lists to be usable.
+ */
+static real prepare_candidates(t_methoddata_distance* d, const t_pbc* pbc, const gmx_ana_pos_t* pos)
+{
+    t_distance_candidates& c = d->cand;
+    if (d->p.count() == 0 || pos->count() == 0)
+    {
+        return 0;
+    }
+    gmx::RVec lower(c.refLower), upper(c.refUpper);
+    for (int b = 0; b < pos->count(); ++b)
+    {
+        for (int dd = 0; dd < DIM; ++dd)
+        {
+            lower[dd] = std::min(lower[dd], pos->x[b][dd]);
+            upper[dd] = std::max(upper[dd], pos->x[b][dd]);
+        }
+    }
+    const real extent = std::sqrt(distance2(lower, upper)) + d->cutoff;
+    real       slack  = c.skin - c.refDisplacement - box_change_bound(c, pbc, extent);
+    if (slack < 0)
+    {
+        build_candidate_search(d, pbc);
+        slack = c.skin;
+    }
+    return slack;
+}
+
+/*! \brief
+ * Returns the candidate reference positions for a test position.
+ *
+ * \param[in,out] d     Method data.
+ * \param[in]     pos   Test positions.
+ * \param[in]     b     Index of the test position in \p pos.
+ * \param[in]     slack Value returned by prepare_candidates().
+ *
+ * The stored list is used if the test position has moved less than
+ * \p slack since the list was computed; then every reference position that
+ * is now within the cutoff was within the extended cutoff when the list was
+ * computed.
+ */
+static gmx::ArrayRef<const int>
+get_candidates(t_methoddata_distance* d, const gmx_ana_pos_t* pos, int b, real slack)
+{
+    t_distance_candidates& c     = d->cand;
+    const int              refid = pos->m.refid[b];
+    std::vector<int>*      list  = &c.scratch;
+    if (refid >= 0)
+    {
+        if (refid >= gmx::ssize(c.candidates))
+        {
+            c.candidates.resize(refid + 1);
+            c.candidateX.resize(refid + 1);
+            c.candidateGeneration.resize(refid + 1, -1);
+        }
+        list = &c.candidates[refid];
+        if (c.candidateGeneration[refid] == c.generation
+            && distance2(pos->x[b], c.candidateX[refid]) <= gmx::square(slack))
+        {
+            return *list;
+        }
+        c.candidateGeneration[refid] = c.generation;
+        copy_rvec(pos->x[b], c.candidateX[refid]);
+    }
+    list->clear();
+    gmx::AnalysisNeighborhoodPairSearch pairSearch = c.nbsearch.startPairSearch(pos->x[b]);
+    gmx::AnalysisNeighborhoodPair       pair;
+    while (pairSearch.findNextPair(&pair))
+    {
+        list->push_back(pair.refIndex());
+    }
+    return *list;
+}
+
+/*! \brief
+ * Computes the squared distance between a reference and a test position.
+ */
+static real pair_distance2(const t_pbc* pbc, const rvec xref, const rvec xtest)
+{
+    rvec dx;
+    if (pbc != nullptr)
+    {
+        pbc_dx(pbc, xref, xtest, dx);
+    }
+    else
+    {
+        rvec_sub(xref, xtest, dx);
+    }
+    return norm2(dx);
 }
 
 /*!
@@ -276,17 +569,35 @@ static void init_frame_common(const gmx::SelMethodEvalContext& context, void* da
  * Calculates the distance of each position from \c t_methoddata_distance::p
  * and puts them in \p out->u.r.
  */
-static void evaluate_distance(const gmx::SelMethodEvalContext& /*context*/,
-                              gmx_ana_pos_t*      pos,
-                              gmx_ana_selvalue_t* out,
-                              void*               data)
+static void evaluate_distance(const gmx::SelMethodEvalContext& context,
+                              gmx_ana_pos_t*                   pos,
+                              gmx_ana_selvalue_t*              out,
+                              void*                            data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
 
     out->nr = pos->count();
+    if (!use_candidates(*d, context.pbc_))
+    {
+        for (int i = 0; i < pos->count(); ++i)
+        {
+            out->u.r[i] = d->nbsearch.minimumDistance(pos->x[i]);
+        }
+        return;
+    }
+    const real slack   = prepare_candidates(d, context.pbc_, pos);
+    const real cutoff2 = gmx::square(d->cutoff);
     for (int i = 0; i < pos->count(); ++i)
     {
-        out->u.r[i] = d->nbsearch.minimumDistance(pos->x[i]);
+        real minDist2 = cutoff2;
+        if (d->p.count() > 0)
+        {
+            for (int j : get_candidates(d, pos, i, slack))
+            {
+                minDist2 = std::min(minDist2, pair_distance2(context.pbc_, d->p.x[j], pos->x[i]));
+            }
+        }
+        out->u.r[i] = std::sqrt(minDist2);
     }
 }
 
@@ -297,19 +608,40 @@ static void evaluate_distance(const gmx::SelMethodEvalContext& /*context*/,
  * Finds the atoms that are closer than the defined cutoff to
  * \c t_methoddata_distance::xref and puts them in \p out.g.
  */
-static void evaluate_within(const gmx::SelMethodEvalContext& /*context*/,
-                            gmx_ana_pos_t*      pos,
-                            gmx_ana_selvalue_t* out,
-                            void*               data)
+static void evaluate_within(const gmx::SelMethodEvalContext& context,
+                            gmx_ana_pos_t*                   pos,
+                            gmx_ana_selvalue_t*              out,
+                            void*                            data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
 
     out->u.g->isize = 0;
+    if (!use_candidates(*d, context.pbc_))
+    {
+        for (int b = 0; b < pos->count(); ++b)
+        {
+            if (d->nbsearch.isWithin(pos->x[b]))
+            {
+                gmx_ana_pos_add_to_group(out->u.g, pos, b);
+            }
+        }
+        return;
+    }
+    if (d->p.count() == 0)
+    {
+        return;
+    }
+    const real slack   = prepare_candidates(d, context.pbc_, pos);
+    const real cutoff2 = gmx::square(d->cutoff);
     for (int b = 0; b < pos->count(); ++b)
     {
-        if (d->nbsearch.isWithin(pos->x[b]))
+        for (int j : get_candidates(d, pos, b, slack))
         {
-            gmx_ana_pos_add_to_group(out->u.g, pos, b);
+            if (pair_distance2(context.pbc_, d->p.x[j], pos->x[b]) <= cutoff2)
+            {
+                gmx_ana_pos_add_to_group(out->u.g, pos, b);
+                break;
+            }
         }
     }
 }
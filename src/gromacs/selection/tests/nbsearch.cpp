@@ -404,6 +404,8 @@ public:
                                    const gmx::ArrayRef<const int>&           refIndices,
                                    const gmx::ArrayRef<const int>&           testIndices,
                                    bool                                      selfPairs);
+    static void testFindAllPairs(gmx::AnalysisNeighborhoodSearch*          search,
+                                 const gmx::AnalysisNeighborhoodPositions& pos);
 
     gmx::AnalysisNeighborhood nb_;
 };
@@ -639,6 +641,32 @@ void NeighborhoodSearchTest::testPairSearchFull(gmx::AnalysisNeighborhoodSearch*
     }
 }
 
+void NeighborhoodSearchTest::testFindAllPairs(gmx::AnalysisNeighborhoodSearch*          search,
+                                              const gmx::AnalysisNeighborhoodPositions& pos)
+{
+    // The correctness of the pairs is tested in testPairSearchFull(), so
+    // it is sufficient to check that the batched search matches it.
+    std::vector<gmx::AnalysisNeighborhoodPair> expected;
+    gmx::AnalysisNeighborhoodPairSearch        pairSearch = search->startPairSearch(pos);
+    gmx::AnalysisNeighborhoodPair              pair;
+    while (pairSearch.findNextPair(&pair))
+    {
+        expected.push_back(pair);
+    }
+    std::vector<gmx::AnalysisNeighborhoodPair> pairs;
+    for (int threadCount : { 1, 3 })
+    {
+        search->findAllPairs(pos, &pairs, threadCount);
+        ASSERT_EQ(expected.size(), pairs.size()) << "Thread count: " << threadCount;
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            EXPECT_EQ(expected[i].refIndex(), pairs[i].refIndex());
+            EXPECT_EQ(expected[i].testIndex(), pairs[i].testIndex());
+            EXPECT_EQ(expected[i].distance2(), pairs[i].distance2());
+        }
+    }
+}
+
 /********************************************************************
  * Test data generation
  */
@@ -887,6 +915,7 @@ TEST_F(NeighborhoodSearchTest, SimpleSearch)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 
     search.reset();
     testPairSearchIndexed(&nb_, data, 123);
@@ -906,6 +935,7 @@ TEST_F(NeighborhoodSearchTest, SimpleSearchXY)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchBox)
@@ -921,6 +951,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchBox)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 
     search.reset();
     testPairSearchIndexed(&nb_, data, 456);
@@ -936,6 +967,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchTriclinic)
     ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
 
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearch2DPBC)
@@ -951,6 +983,7 @@ TEST_F(NeighborhoodSearchTest, GridSearch2DPBC)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchNoPBC)
@@ -963,6 +996,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchNoPBC)
     ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
 
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchXYBox)
@@ -979,6 +1013,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchXYBox)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testFindAllPairs(&search, data.testPositions());
 }
 
 TEST_F(NeighborhoodSearchTest, SimpleSelfPairsSearch)
@@ -1115,6 +1150,7 @@ TEST_F(NeighborhoodSearchTest, SimpleSearchExclusions)
                        {},
                        {},
                        false);
+    testFindAllPairs(&search, data.testPositions().exclusionIds(helper.testPosIds()));
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchExclusions)
@@ -1138,6 +1174,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchExclusions)
                        {},
                        {},
                        false);
+    testFindAllPairs(&search, data.testPositions().exclusionIds(helper.testPosIds()));
 }
 
 } // namespace
@@ -42,9 +42,11 @@
 
 #include "gromacs/selection/selectioncollection.h"
 
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 
+#include <algorithm>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -54,8 +56,12 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/math/vec.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
 #include "gromacs/selection/indexutil.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/selection/selectionenums.h"
@@ -652,6 +658,215 @@ TEST_F(SelectionCollectionTest, HandlesFramesWithTooSmallAtomSubsets4)
     EXPECT_THROW_GMX(sc_.evaluate(topManager_.frame(), nullptr), gmx::InconsistentInputError);
 }
 
+TEST_F(SelectionCollectionTest, HandlesDistanceSelectionsOverMovingFrames)
+{
+    // Distance-based selections reuse candidate lists between frames, so
+    // check them against a brute-force search over frames where the atoms
+    // move, atoms jump over the periodic boundary, and the box changes.
+    const int  atomCount = 300;
+    const int  refCount  = 30;
+    const real cutoff    = 0.5;
+    topManager_.requestFrame();
+    topManager_.initAtoms(atomCount);
+    ASSERT_NO_FATAL_FAILURE(setTopology());
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString(
+                                "within 0.5 of atomnr 1 to 30;"
+                                "mindistance from atomnr 1 to 30 cutoff 0.8 < 0.5"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+
+    gmx::DefaultRandomEngine           rng(1234);
+    gmx::UniformRealDistribution<real> dist;
+    t_trxframe*                        frame = topManager_.frame();
+    matrix                             box   = { { 3, 0, 0 }, { 0, 3, 0 }, { 0.5, 0.5, 3 } };
+    for (int i = 0; i < atomCount; ++i)
+    {
+        for (int d = 0; d < DIM; ++d)
+        {
+            frame->x[i][d] = 3 * dist(rng);
+        }
+    }
+    for (int frameIndex = 0; frameIndex < 30; ++frameIndex)
+    {
+        SCOPED_TRACE(gmx::formatString("Frame %d", frameIndex));
+        // The reference atoms move slowly, so that the search is only
+        // rebuilt every few frames, while the other atoms move fast, so
+        // that their candidate lists often need to be updated.
+        for (int i = 0; i < atomCount; ++i)
+        {
+            const real step = (i < refCount ? 0.02 : 0.2);
+            for (int d = 0; d < DIM; ++d)
+            {
+                frame->x[i][d] += step * (dist(rng) - 0.5);
+            }
+        }
+        if (frameIndex == 10)
+        {
+            rvec_inc(frame->x[0], box[XX]);
+            rvec_dec(frame->x[100], box[ZZ]);
+        }
+        if (frameIndex >= 15)
+        {
+            msmul(box, 1.001, box);
+        }
+        t_pbc pbc;
+        set_pbc(&pbc, PbcType::Xyz, box);
+        ASSERT_NO_THROW_GMX(sc_.evaluate(frame, &pbc));
+
+        std::vector<int> expected;
+        for (int i = 0; i < atomCount; ++i)
+        {
+            for (int j = 0; j < refCount; ++j)
+            {
+                rvec dx;
+                pbc_dx(&pbc, frame->x[j], frame->x[i], dx);
+                if (norm2(dx) <= cutoff * cutoff)
+                {
+                    expected.push_back(i);
+                    break;
+                }
+            }
+        }
+        for (const gmx::Selection& sel : sel_)
+        {
+            gmx::ArrayRef<const int> atoms = sel.atomIndices();
+            EXPECT_EQ(expected, std::vector<int>(atoms.begin(), atoms.end())) << sel.selectionText();
+        }
+    }
+}
+
+TEST_F(SelectionCollectionTest, HandlesArithmeticSelectionsForManyAtoms)
+{
+    // Check arithmetic expressions and real-valued comparisons against a
+    // direct calculation, also when evaluated for only a subset of the atoms.
+    const int atomCount = 700;
+    topManager_.requestFrame();
+    topManager_.initAtoms(atomCount);
+    ASSERT_NO_FATAL_FAILURE(setTopology());
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString(
+                                "x * (y - 1) + z / 2 - x^2 < 1;"
+                                "y < 1.5 and -(x - z) * 2 > 0.5;"
+                                "value = x * y; z > 1 and value - z / 2 > 0.5 and value < 2"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_EQ(3U, sel_.size());
+
+    gmx::DefaultRandomEngine           rng(4321);
+    gmx::UniformRealDistribution<real> dist;
+    t_trxframe*                        frame = topManager_.frame();
+    for (int frameIndex = 0; frameIndex < 3; ++frameIndex)
+    {
+        SCOPED_TRACE(gmx::formatString("Frame %d", frameIndex));
+        for (int i = 0; i < atomCount; ++i)
+        {
+            for (int d = 0; d < DIM; ++d)
+            {
+                frame->x[i][d] = 3 * dist(rng);
+            }
+        }
+        ASSERT_NO_THROW_GMX(sc_.evaluate(frame, nullptr));
+
+        for (int s = 0; s < 3; ++s)
+        {
+            gmx::ArrayRef<const int> atoms = sel_[s].atomIndices();
+            for (int i = 0; i < atomCount; ++i)
+            {
+                const real x = frame->x[i][XX];
+                const real y = frame->x[i][YY];
+                const real z = frame->x[i][ZZ];
+                // Atoms with values very close to a threshold are skipped,
+                // as the result may depend on rounding.
+                real value  = 0.0;
+                real value2 = 1.0;
+                bool bIn    = true;
+                switch (s)
+                {
+                    case 0: value = x * (y - 1) + z / 2 - x * x - 1; break;
+                    case 1:
+                        bIn   = (y < 1.5);
+                        value = 0.5 - 2 * (z - x);
+                        break;
+                    case 2:
+                        value2 = x * y - 2;
+                        bIn    = (z > 1 && value2 < 0);
+                        value  = 0.5 - (x * y - z / 2);
+                        break;
+                }
+                if (std::fabs(value) < 1e-4 || std::fabs(value2) < 1e-4)
+                {
+                    continue;
+                }
+                const bool bExpected = bIn && value < 0;
+                const bool bSelected = std::binary_search(atoms.begin(), atoms.end(), i);
+                EXPECT_EQ(bExpected, bSelected) << sel_[s].selectionText() << ", atom " << i;
+            }
+        }
+    }
+}
+
+TEST_F(SelectionCollectionTest, HandlesBooleanSelectionsForManyAtoms)
+{
+    // Boolean combinations of comparisons are evaluated as bitmasks over
+    // blocks of atoms, so check them against a direct calculation with
+    // enough atoms for several blocks, with and without static parts.
+    const int atomCount = 700;
+    topManager_.requestFrame();
+    topManager_.initAtoms(atomCount);
+    ASSERT_NO_FATAL_FAILURE(setTopology());
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString(
+                                "x < 1.5 and (y > 1 or not z < 2);"
+                                "atomnr 1 to 400 and (x < 1 or y < 1) and not z > 2.5;"
+                                "atomnr 100 to 300 or x < 0.5 and y > 2"
+                                " or atomnr 500 to 650 and z < 1;"
+                                "not (x < 1 or y < 1) and atomnr 50 to 600"
+                                " and not atomnr 200 to 250"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_EQ(4U, sel_.size());
+
+    gmx::DefaultRandomEngine           rng(1234);
+    gmx::UniformRealDistribution<real> dist;
+    t_trxframe*                        frame = topManager_.frame();
+    for (int frameIndex = 0; frameIndex < 3; ++frameIndex)
+    {
+        SCOPED_TRACE(gmx::formatString("Frame %d", frameIndex));
+        for (int i = 0; i < atomCount; ++i)
+        {
+            for (int d = 0; d < DIM; ++d)
+            {
+                frame->x[i][d] = 3 * dist(rng);
+            }
+        }
+        ASSERT_NO_THROW_GMX(sc_.evaluate(frame, nullptr));
+
+        for (int s = 0; s < 4; ++s)
+        {
+            gmx::ArrayRef<const int> atoms = sel_[s].atomIndices();
+            for (int i = 0; i < atomCount; ++i)
+            {
+                const real x  = frame->x[i][XX];
+                const real y  = frame->x[i][YY];
+                const real z  = frame->x[i][ZZ];
+                const int  nr = i + 1;
+                bool       bExpected = false;
+                switch (s)
+                {
+                    case 0: bExpected = x < 1.5 && (y > 1 || !(z < 2)); break;
+                    case 1: bExpected = nr <= 400 && (x < 1 || y < 1) && !(z > 2.5); break;
+                    case 2:
+                        bExpected = (nr >= 100 && nr <= 300) || (x < 0.5 && y > 2)
+                                    || (nr >= 500 && nr <= 650 && z < 1);
+                        break;
+                    case 3:
+                        bExpected = !(x < 1 || y < 1) && nr >= 50 && nr <= 600
+                                    && !(nr >= 200 && nr <= 250);
+                        break;
+                }
+                const bool bSelected = std::binary_search(atoms.begin(), atoms.end(), i);
+                EXPECT_EQ(bExpected, bSelected) << sel_[s].selectionText() << ", atom " << i;
+            }
+            EXPECT_TRUE(std::is_sorted(atoms.begin(), atoms.end())) << sel_[s].selectionText();
+        }
+    }
+}
+
 // TODO: Tests for more evaluation errors
 
 
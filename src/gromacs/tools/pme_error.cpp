@@ -57,6 +57,7 @@
 #include "gromacs/fileio/filetypes.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/gmxlib/network.h"
+#include "gromacs/math/bfloat16.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/units.h"
 #include "gromacs/math/vec.h"
@@ -121,6 +122,7 @@ struct PmeErrorInputs
     real*    e_dir;          /* Direct space part of PME error with these settings */
     real*    e_rec;          /* Reciprocal space part of PME error                 */
     gmx_bool bTUNE;          /* flag for tuning */
+    gmx_bool bBf16Comm;      /* flag for estimating the bfloat16 grid comm. error  */
 };
 
 
@@ -795,6 +797,52 @@ static real estimate_reciprocal(PmeErrorInputs* info,
 }
 
 
+/* Estimate the additional reciprocal space error when the PME grid overlap
+ * and FFT transpose communication uses bfloat16 (GMX_PME_GRID_COMM_BF16).
+ * The rounding errors are assumed to be uncorrelated, with a relative RMS error
+ * of c_bfloat16MaxRelativeError/sqrt(3) per communication step, and to add
+ * the same relative error to the reciprocal space forces. We assume the worst
+ * case of 2D PME decomposition, where the grid data is communicated twice for
+ * the overlap regions and four times for the FFT transposes.
+ * The RMS reciprocal space force is that of randomly distributed charges.
+ */
+static real estimate_bf16_comm(PmeErrorInputs* info)
+{
+    const int numCommSteps = 6;
+    rvec      gridpx, gridpxy, gridp, tmpvec;
+    double    sum = 0;
+
+    for (int nx = -info->nkx[0] / 2; nx < info->nkx[0] / 2 + 1; nx++)
+    {
+        svmul(nx, info->recipbox[XX], gridpx);
+        for (int ny = -info->nky[0] / 2; ny < info->nky[0] / 2 + 1; ny++)
+        {
+            svmul(ny, info->recipbox[YY], tmpvec);
+            rvec_add(gridpx, tmpvec, gridpxy);
+            for (int nz = -info->nkz[0] / 2; nz < info->nkz[0] / 2 + 1; nz++)
+            {
+                if (0 == nx && 0 == ny && 0 == nz)
+                {
+                    continue;
+                }
+                svmul(nz, info->recipbox[ZZ], tmpvec);
+                rvec_add(gridpxy, tmpvec, gridp);
+                const real m2   = norm2(gridp);
+                const real beta = info->ewald_beta[0];
+                sum += std::exp(-2.0 * M_PI * M_PI * m2 / (beta * beta)) / m2;
+            }
+        }
+    }
+
+    /* The mean square reciprocal space force on a charge */
+    const double f2 = (info->q2all / info->q2allnr) * 4.0 * info->q2all * sum
+                      / (info->volume * info->volume);
+
+    return gmx::c_one4PiEps0 * gmx::c_bfloat16MaxRelativeError / std::sqrt(3.0)
+           * std::sqrt(numCommSteps * f2);
+}
+
+
 /* Allocate memory for the PmeErrorInputs struct: */
 static void create_info(PmeErrorInputs* info)
 {
@@ -997,6 +1045,12 @@ static void estimate_PME_error(PmeErrorInputs*   info,
         fflush(fp_out);
         fprintf(stderr, "Direct space error est. : %10.3e kJ/(mol*nm)\n", info->e_dir[0]);
         fprintf(stderr, "Reciprocal sp. err. est.: %10.3e kJ/(mol*nm)\n", info->e_rec[0]);
+        if (info->bBf16Comm)
+        {
+            const real e_bf16 = estimate_bf16_comm(info);
+            fprintf(fp_out, "BF16 grid comm. err. est: %10.3e kJ/(mol*nm)\n", e_bf16);
+            fprintf(stderr, "BF16 grid comm. err. est: %10.3e kJ/(mol*nm)\n", e_bf16);
+        }
     }
 
     i = 0;
@@ -1076,6 +1130,12 @@ static void estimate_PME_error(PmeErrorInputs*   info,
             fprintf(fp_out, "Reciprocal sp. err. est.: %10.3e kJ/(mol*nm)\n", info->e_rec[0]);
             fprintf(stderr, "Direct space error est. : %10.3e kJ/(mol*nm)\n", info->e_dir[0]);
             fprintf(stderr, "Reciprocal sp. err. est.: %10.3e kJ/(mol*nm)\n", info->e_rec[0]);
+            if (info->bBf16Comm)
+            {
+                const real e_bf16 = estimate_bf16_comm(info);
+                fprintf(fp_out, "BF16 grid comm. err. est: %10.3e kJ/(mol*nm)\n", e_bf16);
+                fprintf(stderr, "BF16 grid comm. err. est: %10.3e kJ/(mol*nm)\n", e_bf16);
+            }
             fprintf(fp_out, "Ewald_rtol              : %g\n", info->ewald_rtol[0]);
             fprintf(fp_out, "Ewald parameter beta    : %g\n", info->ewald_beta[0]);
             fflush(fp_out);
@@ -1095,6 +1155,9 @@ int gmx_pme_error(int argc, char* argv[])
         "is computationally demanding. However, a good a approximation is to",
         "just use a fraction of the particles for this term which can be",
         "indicated by the flag [TT]-self[tt].[PAR]",
+        "With [TT]-bf16comm[tt], the additional error is estimated for the case that",
+        "the PME grid communication uses bfloat16, as set by the environment variable",
+        "GMX_PME_GRID_COMM_BF16. This assumes the worst case of 2D PME decomposition.[PAR]",
     };
 
     real           fs        = 0.0; /* 0 indicates: not set by the user */
@@ -1106,8 +1169,9 @@ int gmx_pme_error(int argc, char* argv[])
     FILE*          fp = nullptr;
     unsigned long  PCA_Flags;
     gmx_bool       bTUNE    = FALSE;
-    gmx_bool       bVerbose = FALSE;
-    int            seed     = 0;
+    gmx_bool       bVerbose  = FALSE;
+    gmx_bool       bBf16Comm = FALSE;
+    int            seed      = 0;
 
 
     static t_filenm fnm[] = { { efTPR, "-s", nullptr, ffREAD },
@@ -1140,6 +1204,11 @@ int gmx_pme_error(int argc, char* argv[])
           { &seed },
           "Random number seed used for Monte Carlo algorithm when [TT]-self[tt] is set to "
           "a value between 0.0 and 1.0" },
+        { "-bf16comm",
+          FALSE,
+          etBOOL,
+          { &bBf16Comm },
+          "Estimate the additional error with bfloat16 PME grid communication" },
         { "-v", FALSE, etBOOL, { &bVerbose }, "Be loud and noisy" }
     };
 
@@ -1177,8 +1246,9 @@ int gmx_pme_error(int argc, char* argv[])
         /* Determine the volume of the simulation box */
         info.volume = det(state.box);
         calc_recipbox(state.box, info.recipbox);
-        info.natoms = mtop.natoms;
-        info.bTUNE  = bTUNE;
+        info.natoms    = mtop.natoms;
+        info.bTUNE     = bTUNE;
+        info.bBf16Comm = bBf16Comm;
     }
 
     /* Check consistency if the user provided fourierspacing */
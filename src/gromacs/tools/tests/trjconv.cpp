@@ -45,19 +45,25 @@
 
 #include <cstring>
 
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/gmxpreprocess/grompp.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
 
 #include "testutils/cmdlinetest.h"
 #include "testutils/simulationdatabase.h"
 #include "testutils/stdiohelper.h"
+#include "testutils/testfilemanager.h"
 #include "testutils/textblockmatchers.h"
 #include "testutils/trajectoryreader.h"
 
@@ -220,6 +226,161 @@ INSTANTIATE_TEST_SUITE_P(Works,
                          ::testing::Combine(::testing::ValuesIn(trajectoryFileNames),
                                             ::testing::Values(-1, 0, 0.3, 1, 999999)),
                          nameOfTrjconvDumpTest);
+
+//! Options of a trjconv run with the groups to select and the output file extension
+struct TrjconvThreadsTestParameters
+{
+    //! Name of the test case
+    const char* name;
+    //! The options besides the input and output files and -nt
+    std::vector<std::string> options;
+    //! The index groups to select, one per line
+    const char* groups;
+    //! The extension of the output file
+    const char* extension;
+};
+
+class TrjconvWithThreads :
+    public gmx::test::CommandLineTestBase,
+    public ::testing::WithParamInterface<TrjconvThreadsTestParameters>
+{
+public:
+    //! Generates the tpr file, needed for -pbc cluster and mol
+    static void SetUpTestSuite()
+    {
+        s_tprFileManager = new TestFileManager();
+        const std::string mdpFileName =
+                s_tprFileManager->getTemporaryFilePath("alanine_vsite_solvated.mdp").string();
+        TextWriter::writeFileFromString(mdpFileName, "");
+        s_tprFileName =
+                s_tprFileManager->getTemporaryFilePath("alanine_vsite_solvated.tpr").string();
+
+        CommandLine caller;
+        caller.append("grompp");
+        caller.addOption("-f", mdpFileName);
+        caller.addOption(
+                "-p", TestFileManager::getInputFilePath("alanine_vsite_solvated.top").string());
+        caller.addOption(
+                "-c", TestFileManager::getInputFilePath("alanine_vsite_solvated.gro").string());
+        caller.addOption("-o", s_tprFileName);
+        caller.addOption("-po",
+                         s_tprFileManager->getTemporaryFilePath("alanine_vsite_solvated_out.mdp")
+                                 .string());
+        ASSERT_EQ(0, gmx_grompp(caller.argc(), caller.argv()));
+    }
+    static void TearDownTestSuite()
+    {
+        delete s_tprFileManager;
+        s_tprFileManager = nullptr;
+    }
+
+    /*! \brief Runs trjconv on \p numThreads threads
+     *
+     * \returns The contents of the output files, in the order they were
+     * written. With -sep and -split these are the numbered files.
+     */
+    std::vector<std::string> convert(int numThreads)
+    {
+        const TrjconvThreadsTestParameters& params = GetParam();
+
+        CommandLine cmdline;
+        cmdline.append("trjconv");
+        cmdline.addOption("-s", s_tprFileName);
+        cmdline.addOption(
+                "-f", TestFileManager::getInputFilePath("alanine_vsite_solvated.xtc").string());
+        for (const auto& option : params.options)
+        {
+            cmdline.append(option);
+        }
+        cmdline.addOption("-nt", numThreads);
+        // With -sep and -split, trjconv appends the file number to the base name
+        auto outputFileName = [&params, numThreads](const std::string& fileNumber)
+        { return formatString("out%d%s.%s", numThreads, fileNumber.c_str(), params.extension); };
+        cmdline.addOption("-o", fileManager().getTemporaryFilePath(outputFileName("")).string());
+
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin(params.groups);
+        EXPECT_EQ(0, gmx_trjconv(cmdline.argc(), cmdline.argv()));
+
+        std::vector<std::string> contents;
+        readOutputFile(outputFileName(""), &contents);
+        int fileNumber = 0;
+        while (readOutputFile(outputFileName(std::to_string(fileNumber)), &contents))
+        {
+            fileNumber++;
+        }
+        return contents;
+    }
+
+private:
+    //! Appends the contents of \p fileName to \p contents, returns whether the file exists
+    bool readOutputFile(const std::string& fileName, std::vector<std::string>* contents)
+    {
+        std::ifstream stream(fileManager().getTemporaryFilePath(fileName), std::ios::binary);
+        if (!stream)
+        {
+            return false;
+        }
+        contents->emplace_back(std::istreambuf_iterator<char>(stream),
+                               std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    //! Manages the generated tpr file
+    static TestFileManager* s_tprFileManager;
+    //! Name of the generated tpr file
+    static std::string s_tprFileName;
+};
+
+TestFileManager* TrjconvWithThreads::s_tprFileManager = nullptr;
+std::string      TrjconvWithThreads::s_tprFileName;
+
+TEST_P(TrjconvWithThreads, WritesSameOutputAsSingleThread)
+{
+    if (!GMX_OPENMP)
+    {
+        GTEST_SKIP() << "Cannot use more threads without OpenMP";
+    }
+    const std::vector<std::string> referenceContents = convert(1);
+    const std::vector<std::string> threadedContents  = convert(3);
+
+    ASSERT_FALSE(referenceContents.empty()) << "Output should be written";
+    ASSERT_EQ(referenceContents.size(), threadedContents.size())
+            << "The same number of output files should be written";
+    for (size_t i = 0; i < referenceContents.size(); i++)
+    {
+        EXPECT_FALSE(referenceContents[i].empty()) << "Output file " << i << " is empty";
+        EXPECT_TRUE(referenceContents[i] == threadedContents[i])
+                << "Output file " << i << " differs";
+    }
+}
+
+//! The trjconv runs that are compared, these need several batches of frames
+const TrjconvThreadsTestParameters trjconvThreadsTestParameters[] = {
+    { "CenterAtom",
+      { "-center", "-pbc", "atom", "-ur", "compact", "-skip", "2" },
+      "System\nProtein\n",
+      "xtc" },
+    { "NoJump", { "-pbc", "nojump" }, "System\n", "xtc" },
+    { "Cluster", { "-pbc", "cluster" }, "Protein\nSystem\n", "xtc" },
+    { "Fit", { "-fit", "rot+trans" }, "Backbone\nSystem\n", "trr" },
+    { "ProgressiveFit", { "-fit", "progressive" }, "Backbone\nSystem\n", "xtc" },
+    { "Dump", { "-pbc", "mol", "-dump", "13" }, "System\n", "gro" },
+    { "Sep", { "-pbc", "mol", "-sep", "-skip", "4" }, "System\n", "gro" },
+    { "Split", { "-pbc", "whole", "-split", "10" }, "System\n", "xtc" },
+};
+
+//! Help GoogleTest name our test cases
+std::string nameOfTrjconvWithThreadsTest(
+        const testing::TestParamInfo<TrjconvThreadsTestParameters>& info)
+{
+    return info.param.name;
+}
+
+INSTANTIATE_TEST_SUITE_P(Works,
+                         TrjconvWithThreads,
+                         ::testing::ValuesIn(trjconvThreadsTestParameters),
+                         nameOfTrjconvWithThreadsTest);
 } // namespace
 } // namespace test
 } // namespace gmx
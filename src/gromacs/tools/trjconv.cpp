@@ -35,6 +35,8 @@
 
 #include "trjconv.h"
 
+#include "config.h"
+
 #include <cinttypes>
 #include <cmath>
 #include <cstdio>
@@ -42,10 +44,12 @@
 #include <cstring>
 
 #include <algorithm>
+#include <array>
 #include <filesystem>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/commandline/pargs.h"
@@ -79,9 +83,11 @@
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
@@ -287,6 +293,44 @@ static void copyTrxframeDeeply(const t_trxframe& input, t_trxframe* copy)
     }
 }
 
+/*! \brief A frame that passes through the reading, transforming and writing stages
+ *
+ * The reading stage stores a copy of each frame that is to be written.
+ * The transforming stage modifies this copy and sets up the output frame,
+ * which the writing stage writes.
+ */
+struct TrjconvFrameJob
+{
+    //! The frame as read, after the modifications that depend on earlier frames
+    t_trxframe frame;
+    //! The frame to write, refers to the coordinates of \c frame or of the buffers below
+    t_trxframe frout;
+    //! The time of the output frame
+    real outputTime;
+    //! The number of frames written before this one
+    int outputFrame;
+    //! Whether reading printed progress since the previous output frame
+    bool readHasPrinted;
+    //! Output buffers, used when writing a subset or a reordering of the atoms
+    std::vector<gmx::RVec> x, v, f;
+    //! The compressed output frame, when writing xtc
+    std::vector<char> encodedFrame;
+    //! Whether \c encodedFrame holds the output frame
+    bool haveEncodedFrame = false;
+};
+
+//! A batch of frames that pass through a stage together
+struct TrjconvFrameBatch
+{
+    //! Storage for the frames, of which the first \c numFrames are in use
+    std::vector<TrjconvFrameJob> jobs;
+    //! The number of frames in the batch
+    int numFrames = 0;
+};
+
+//! The memory the frames of all batches together may use, in bytes
+static constexpr std::size_t c_maxFrameBatchesMemory = 512 * 1024 * 1024;
+
 //! Swap the contents of \c a and \c b
 static void swapFrames(t_trxframe* a, t_trxframe* b)
 {
@@ -464,7 +508,15 @@ int gmx_trjconv(int argc, char* argv[])
         "Option [TT]-drop[tt] reads an [REF].xvg[ref] file with times and values.",
         "When options [TT]-dropunder[tt] and/or [TT]-dropover[tt] are set,",
         "frames with a value below and above the value of the respective options",
-        "will not be written."
+        "will not be written.[PAR]",
+
+        "Reading and writing frames and transforming them run concurrently.",
+        "Each frame is transformed by one thread, the number of threads is set",
+        "with [TT]-nt[tt]. With [REF].xtc[ref] output the transforming threads",
+        "also compress the frames. Progressive fitting and [TT]-pbc nojump[tt] depend",
+        "on the preceding frame and are therefore done while reading.",
+        "At most three frames per thread are held in memory, fewer for large",
+        "systems, so that these frames use at most 512 MB."
     };
 
     int pbc_enum;
@@ -520,6 +572,7 @@ int gmx_trjconv(int argc, char* argv[])
     char*    exec_command = nullptr;
     real     dropunder = 0, dropover = 0;
     gmx_bool bRound = FALSE;
+    int      nthreads     = -1;
 
     t_pargs pa[] = {
         { "-skip", FALSE, etINT, { &skip_nr }, "Only write every nr-th frame" },
@@ -583,7 +636,10 @@ int gmx_trjconv(int argc, char* argv[])
           "Add CONECT PDB records when writing [REF].pdb[ref] files. Useful "
           "for visualization of non-standard molecules, e.g. "
           "coarse grained ones. Can only be done when a topology (tpr) file "
-          "is present" }
+          "is present" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &nthreads }, "Number of threads to transform frames with" },
+#endif
     };
 #define NPA asize(pa)
 
@@ -591,12 +647,11 @@ int gmx_trjconv(int argc, char* argv[])
     t_trxstatus* trxout = nullptr;
     t_trxstatus* trxin;
     int          file_nr;
-    t_trxframe   fr, frout, nextFrame, previousFrame, *frameToDump = nullptr;
+    t_trxframe   fr, nextFrame, previousFrame, *frameToDump = nullptr;
     int          flags;
-    rvec *       xmem = nullptr, *vmem = nullptr, *fmem = nullptr;
     rvec *       xp    = nullptr, x_shift, hbox;
     real*        w_rls = nullptr;
-    int          m, i, d, frame, outframe, natoms, nout, ncent, newstep = 0, model_nr;
+    int          i, frame, outframe, natoms, nout, ncent, newstep = 0, model_nr;
     t_topology*  top     = nullptr;
     gmx_conect   gc      = nullptr;
     PbcType      pbcType = PbcType::Unset;
@@ -637,6 +692,8 @@ int gmx_trjconv(int argc, char* argv[])
                        { efXVG, "-drop", "drop", ffOPTRD } };
 #define NFILE asize(fnm)
 
+    nthreads = gmx_omp_get_max_threads();
+
     if (!parse_common_args(&argc,
                            argv,
                            PCA_CAN_BEGIN | PCA_CAN_END | PCA_CAN_VIEW | PCA_TIME_UNIT,
@@ -652,6 +709,8 @@ int gmx_trjconv(int argc, char* argv[])
     {
         return 0;
     }
+    nthreads = std::max(nthreads, 1);
+    gmx_omp_set_num_threads(nthreads);
     fprintf(stdout,
             "Note that major changes are planned in future for "
             "trjconv, to improve usability and utility.\n");
@@ -1096,19 +1155,6 @@ int gmx_trjconv(int argc, char* argv[])
                 default: gmx_incons("Illegal output file format");
             }
 
-            if (bCopy)
-            {
-                snew(xmem, nout);
-                if (bVels)
-                {
-                    snew(vmem, nout);
-                }
-                if (bForce)
-                {
-                    snew(fmem, nout);
-                }
-            }
-
             /* Start the big loop over frames */
             file_nr  = 0;
             frame    = 0;
@@ -1124,534 +1170,710 @@ int gmx_trjconv(int argc, char* argv[])
             // ensure the internal allocations have been made. The
             // content will be overwritten before it is read.
             copyTrxframeDeeply(fr, &nextFrame);
-            /* Main loop over frames */
-            do
+
+            /* The frames pass through three stages: reading, transforming and
+             * writing. Reading also does the modifications that depend on the
+             * preceding frame (-pbc nojump, progressive fit). Reading and writing
+             * are sequential, the transformations are independent between frames.
+             * While one thread reads a batch of frames and another writes
+             * the previous batch in order, all threads transform the current
+             * batch. Each batch holds one frame per thread, or fewer when
+             * the frames of the three batches would not fit in
+             * c_maxFrameBatchesMemory.
+             */
+            std::array<TrjconvFrameBatch, 3> batches;
+
+            const int         readerThread   = std::min(1, nthreads - 1);
+            const std::size_t vectorsPerAtom = 1 + (fr.bV ? 1 : 0) + (fr.bF ? 1 : 0);
+            // A frame is stored as read and as output, plus the compressed output for xtc
+            const std::size_t frameMemory =
+                    (static_cast<std::size_t>(natoms) + nout) * vectorsPerAtom * sizeof(rvec)
+                    + (ftp == efXTC ? static_cast<std::size_t>(nout) * sizeof(rvec) : 0);
+            const int batchSize = static_cast<int>(std::clamp<std::size_t>(
+                    c_maxFrameBatchesMemory / (batches.size() * frameMemory), 1, nthreads));
+
+            for (auto& batch : batches)
             {
-                if (!fr.bStep)
+                batch.jobs.resize(batchSize);
+                for (auto& job : batch.jobs)
                 {
-                    /* set the step */
-                    fr.step = newstep;
-                    newstep++;
+                    clear_trxframe(&job.frame, true);
                 }
-                // Read the next frame now, so that we know whether
-                // one exists.
-                bHaveNextFrame = read_next_frame(oenv, trxin, &nextFrame);
+            }
+            // The removal of periodicity uses graphs with per-frame state,
+            // so every thread needs its own. With progressive fitting the
+            // reading stage removes periodicity with the one of thread 0,
+            // but then the transforming stage does not.
+            std::vector<gmx_rmpbc_t> threadGpbc(nthreads, nullptr);
+            if (bRmPBC)
+            {
+                threadGpbc[0] = gpbc;
+                for (int t = 1; t < nthreads; t++)
+                {
+                    threadGpbc[t] = gmx_rmpbc_init(&top->idef, pbcType, top->atoms.nr);
+                }
+            }
 
+            bool haveFrameToRead = true;
 
-                if (bSetBox)
+            /* Reads frames into batch until it is full or no frames are left,
+             * and stores copies of the frames that are to be written.
+             */
+            auto readBatch = [&](TrjconvFrameBatch* batch)
+            {
+                batch->numFrames = 0;
+                while (haveFrameToRead && batch->numFrames < batchSize)
                 {
-                    /* generate new box */
-                    if (!fr.bBox)
+                    if (!fr.bStep)
                     {
-                        clear_mat(fr.box);
+                        /* set the step */
+                        fr.step = newstep;
+                        newstep++;
                     }
-                    for (m = 0; m < DIM; m++)
+                    // Read the next frame now, so that we know whether
+                    // one exists.
+                    bHaveNextFrame = read_next_frame(oenv, trxin, &nextFrame);
+
+
+                    if (bSetBox)
                     {
-                        if (newbox[m] >= 0)
+                        /* generate new box */
+                        if (!fr.bBox)
                         {
-                            fr.box[m][m] = newbox[m];
+                            clear_mat(fr.box);
                         }
-                        else
+                        for (int m = 0; m < DIM; m++)
                         {
-                            if (!fr.bBox)
+                            if (newbox[m] >= 0)
                             {
-                                gmx_fatal(FARGS, "Cannot preserve a box that does not exist.\n");
+                                fr.box[m][m] = newbox[m];
+                            }
+                            else
+                            {
+                                if (!fr.bBox)
+                                {
+                                    gmx_fatal(FARGS,
+                                              "Cannot preserve a box that does not exist.\n");
+                                }
                             }
                         }
                     }
-                }
 
-                if (bTrans)
-                {
-                    for (i = 0; i < natoms; i++)
+                    if (bTrans)
                     {
-                        rvec_inc(fr.x[i], trans);
+                        for (int i = 0; i < natoms; i++)
+                        {
+                            rvec_inc(fr.x[i], trans);
+                        }
                     }
-                }
 
-                if (bTDump)
-                {
-                    // Check we haven't already decided to dump the
-                    // first frame.
-                    if (!bDumpFrame)
+                    if (bTDump)
                     {
-                        // Have we reached the dump time?
-                        if (fr.time >= tdump)
+                        // Check we haven't already decided to dump the
+                        // first frame.
+                        if (!bDumpFrame)
                         {
-                            bDumpFrame = true;
-                            // Do we dump this frame or the previous one?
-                            GMX_RELEASE_ASSERT(tdump - previousFrame.time >= 0,
-                                               "The previous frame should have triggered the "
-                                               "decision on which frame to dump");
-                            const real timeFromCurrentFrame  = fr.time - tdump;
-                            const real timeFromPreviousFrame = tdump - previousFrame.time;
-                            if (timeFromCurrentFrame > timeFromPreviousFrame)
+                            // Have we reached the dump time?
+                            if (fr.time >= tdump)
                             {
-                                frameToDump = &previousFrame;
+                                bDumpFrame = true;
+                                // Do we dump this frame or the previous one?
+                                GMX_RELEASE_ASSERT(tdump - previousFrame.time >= 0,
+                                                   "The previous frame should have triggered the "
+                                                   "decision on which frame to dump");
+                                const real timeFromCurrentFrame  = fr.time - tdump;
+                                const real timeFromPreviousFrame = tdump - previousFrame.time;
+                                if (timeFromCurrentFrame > timeFromPreviousFrame)
+                                {
+                                    frameToDump = &previousFrame;
+                                }
+                                else
+                                {
+                                    frameToDump = &fr;
+                                }
                             }
-                            else
+                            // Have we run out of frames?
+                            else if (!bHaveNextFrame)
                             {
+                                // Dump this frame, because it is the last frame
+                                bDumpFrame  = true;
                                 frameToDump = &fr;
                             }
                         }
-                        // Have we run out of frames?
-                        else if (!bHaveNextFrame)
-                        {
-                            // Dump this frame, because it is the last frame
-                            bDumpFrame  = true;
-                            frameToDump = &fr;
-                        }
                     }
-                }
-                else
-                {
-                    // Ensure we clear the flag from last iteration when using -fr
-                    bDumpFrame = false;
-                }
-
-                /* determine if an atom jumped across the box and reset it if so */
-                if (bNoJump && (bTPS || frame != 0))
-                {
-                    for (d = 0; d < DIM; d++)
+                    else
                     {
-                        hbox[d] = 0.5 * fr.box[d][d];
+                        // Ensure we clear the flag from last iteration when using -fr
+                        bDumpFrame = false;
                     }
-                    for (i = 0; i < natoms; i++)
+
+                    /* determine if an atom jumped across the box and reset it if so */
+                    if (bNoJump && (bTPS || frame != 0))
                     {
-                        if (bReset)
+                        for (int d = 0; d < DIM; d++)
                         {
-                            rvec_dec(fr.x[i], x_shift);
+                            hbox[d] = 0.5 * fr.box[d][d];
                         }
-                        for (m = DIM - 1; m >= 0; m--)
+                        for (int i = 0; i < natoms; i++)
                         {
-                            if (hbox[m] > 0)
+                            if (bReset)
                             {
-                                while (fr.x[i][m] - xp[i][m] <= -hbox[m])
+                                rvec_dec(fr.x[i], x_shift);
+                            }
+                            for (int m = DIM - 1; m >= 0; m--)
+                            {
+                                if (hbox[m] > 0)
                                 {
-                                    for (d = 0; d <= m; d++)
+                                    while (fr.x[i][m] - xp[i][m] <= -hbox[m])
                                     {
-                                        fr.x[i][d] += fr.box[m][d];
+                                        for (int d = 0; d <= m; d++)
+                                        {
+                                            fr.x[i][d] += fr.box[m][d];
+                                        }
                                     }
-                                }
-                                while (fr.x[i][m] - xp[i][m] > hbox[m])
-                                {
-                                    for (d = 0; d <= m; d++)
+                                    while (fr.x[i][m] - xp[i][m] > hbox[m])
                                     {
-                                        fr.x[i][d] -= fr.box[m][d];
+                                        for (int d = 0; d <= m; d++)
+                                        {
+                                            fr.x[i][d] -= fr.box[m][d];
+                                        }
                                     }
                                 }
                             }
                         }
                     }
-                }
-                else if (bCluster)
-                {
-                    calc_pbc_cluster(ecenter, ifit, top, pbcType, fr.x, ind_fit, fr.box);
-                }
-
-                if (bPFit)
-                {
-                    /* Now modify the coords according to the flags,
-                       for normal fit, this is only done for output frames */
-                    if (bRmPBC)
+                    else if (bCluster && bPFit)
                     {
-                        gmx_rmpbc_trxfr(gpbc, &fr);
+                        /* Without progressive fitting, clustering is done
+                         * when transforming the frames that are written */
+                        calc_pbc_cluster(ecenter, ifit, top, pbcType, fr.x, ind_fit, fr.box);
                     }
 
-                    reset_x_ndim(nfitdim, ifit, ind_fit, natoms, nullptr, fr.x, w_rls);
-                    do_fit(natoms, w_rls, xp, fr.x);
-                }
-
-                /* store this set of coordinates for future use */
-                if (bPFit || bNoJump)
-                {
-                    if (xp == nullptr)
+                    if (bPFit)
                     {
-                        snew(xp, natoms);
+                        /* Now modify the coords according to the flags,
+                           for normal fit, this is only done for output frames */
+                        if (bRmPBC)
+                        {
+                            gmx_rmpbc_trxfr(gpbc, &fr);
+                        }
+
+                        reset_x_ndim(nfitdim, ifit, ind_fit, natoms, nullptr, fr.x, w_rls);
+                        do_fit(natoms, w_rls, xp, fr.x);
                     }
-                    for (i = 0; (i < natoms); i++)
+
+                    /* store this set of coordinates for future use */
+                    if (bPFit || bNoJump)
                     {
-                        copy_rvec(fr.x[i], xp[i]);
-                        rvec_inc(fr.x[i], x_shift);
+                        if (xp == nullptr)
+                        {
+                            snew(xp, natoms);
+                        }
+                        for (int i = 0; (i < natoms); i++)
+                        {
+                            copy_rvec(fr.x[i], xp[i]);
+                            rvec_inc(fr.x[i], x_shift);
+                        }
                     }
-                }
 
-                if (frindex)
-                {
-                    /* see if we have a frame from the frame index group */
-                    for (i = 0; i < nrfri && !bDumpFrame; i++)
+                    if (frindex)
                     {
-                        bDumpFrame = frame == frindex[i];
+                        /* see if we have a frame from the frame index group */
+                        for (int i = 0; i < nrfri && !bDumpFrame; i++)
+                        {
+                            bDumpFrame = frame == frindex[i];
+                        }
+                    }
+                    if (debug && bDumpFrame)
+                    {
+                        fprintf(debug, "dumping %d\n", frame);
                     }
-                }
-                if (debug && bDumpFrame)
-                {
-                    fprintf(debug, "dumping %d\n", frame);
-                }
 
-                bWriteFrame = ((!bTDump && (frindex == nullptr) && frame % skip_nr == 0) || bDumpFrame);
+                    bWriteFrame = ((!bTDump && (frindex == nullptr) && frame % skip_nr == 0)
+                                   || bDumpFrame);
 
-                if (bWriteFrame && (bDropUnder || bDropOver))
-                {
-                    while (dropval[0][drop1] < fr.time && drop1 + 1 < ndrop)
+                    if (bWriteFrame && (bDropUnder || bDropOver))
                     {
-                        drop0 = drop1;
-                        drop1++;
+                        while (dropval[0][drop1] < fr.time && drop1 + 1 < ndrop)
+                        {
+                            drop0 = drop1;
+                            drop1++;
+                        }
+                        if (std::abs(dropval[0][drop0] - fr.time)
+                            < std::abs(dropval[0][drop1] - fr.time))
+                        {
+                            dropuse = drop0;
+                        }
+                        else
+                        {
+                            dropuse = drop1;
+                        }
+                        if ((bDropUnder && dropval[1][dropuse] < dropunder)
+                            || (bDropOver && dropval[1][dropuse] > dropover))
+                        {
+                            bWriteFrame = FALSE;
+                        }
                     }
-                    if (std::abs(dropval[0][drop0] - fr.time) < std::abs(dropval[0][drop1] - fr.time))
+
+                    if (bWriteFrame)
                     {
-                        dropuse = drop0;
+                        /* We should avoid modifying the input frame,
+                         * but since here we don't have the output frame yet,
+                         * we introduce a temporary output frame time variable.
+                         */
+                        real frout_time;
+
+                        frout_time = bTDump ? frameToDump->time : fr.time;
+
+                        /* calc new time */
+                        if (bTimeStep)
+                        {
+                            frout_time = tzero + frame * timestep;
+                        }
+                        else if (bSetTime)
+                        {
+                            frout_time += tshift;
+                        }
+
+                        if (bTDump)
+                        {
+                            fprintf(stderr,
+                                    "\nDumping frame at t= %g %s\n",
+                                    output_env_conv_time(oenv, frout_time),
+                                    output_env_get_time_unit(oenv).c_str());
+                        }
+
+                        /* check for writing at each delta_t */
+                        bDoIt = (delta_t == 0);
+                        if (!bDoIt)
+                        {
+                            if (!bRound)
+                            {
+                                bDoIt = bRmod(frout_time, tzero, delta_t);
+                            }
+                            else
+                            {
+                                /* round() is not C89 compatible, so we do this:  */
+                                bDoIt = bRmod(std::floor(frout_time + 0.5),
+                                              std::floor(tzero + 0.5),
+                                              std::floor(delta_t + 0.5));
+                            }
+                        }
+
+                        /* Flag whenever the reading routine prints, so that we print after it and do not mangle the line */
+                        if (trxio_should_print_count(oenv, trxin))
+                        {
+                            bFrameReadHasPrinted = true;
+                        }
+
+                        if (bDoIt || bTDump)
+                        {
+                            TrjconvFrameJob* job = &batch->jobs[batch->numFrames++];
+                            copyTrxframeDeeply(bTDump ? *frameToDump : fr, &job->frame);
+                            job->outputTime     = frout_time;
+                            job->outputFrame    = outframe++;
+                            job->readHasPrinted = bFrameReadHasPrinted;
+                            bFrameReadHasPrinted = false;
+                        }
                     }
-                    else
+                    frame++;
+                    if (bTDump && !bDumpFrame)
                     {
-                        dropuse = drop1;
+                        // Save the current frame so that we can dump it
+                        // next step if it later proves to be the one
+                        // whose time was nearest the dump time.
+                        swapFrames(&fr, &previousFrame);
                     }
-                    if ((bDropUnder && dropval[1][dropuse] < dropunder)
-                        || (bDropOver && dropval[1][dropuse] > dropover))
+                    // Now that we are done with the current frame, we
+                    // swap it for the previously-read subsequent frame.
+                    if (bHaveNextFrame)
                     {
-                        bWriteFrame = FALSE;
+                        swapFrames(&fr, &nextFrame);
                     }
+                    haveFrameToRead = !(bTDump && bDumpFrame) && bHaveNextFrame;
                 }
+            };
+
+            /* Applies the transformations that only depend on the frame itself
+             * and sets up the output frame of job.
+             */
+            auto transformFrame = [&](TrjconvFrameJob* job, gmx_rmpbc_t frameGpbc)
+            {
+                t_trxframe& jobFrame = job->frame;
 
-                if (bWriteFrame)
+                if (!bPFit)
                 {
-                    /* We should avoid modifying the input frame,
-                     * but since here we don't have the output frame yet,
-                     * we introduce a temporary output frame time variable.
-                     */
-                    real frout_time;
+                    /* Now modify the coords according to the flags,
+                       for PFit we did this already! */
 
-                    frout_time = bTDump ? frameToDump->time : fr.time;
+                    if (bCluster)
+                    {
+                        calc_pbc_cluster(
+                                ecenter, ifit, top, pbcType, jobFrame.x, ind_fit, jobFrame.box);
+                    }
 
-                    /* calc new time */
-                    if (bTimeStep)
+                    if (bRmPBC)
                     {
-                        frout_time = tzero + frame * timestep;
+                        gmx_rmpbc_trxfr(frameGpbc, &jobFrame);
                     }
-                    else if (bSetTime)
+
+                    if (bReset)
                     {
-                        frout_time += tshift;
+                        reset_x_ndim(nfitdim, ifit, ind_fit, natoms, nullptr, jobFrame.x, w_rls);
+                        if (bFit)
+                        {
+                            do_fit_ndim(nfitdim, natoms, w_rls, xp, jobFrame.x);
+                        }
+                        if (!bCenter)
+                        {
+                            for (int i = 0; i < natoms; i++)
+                            {
+                                rvec_inc(jobFrame.x[i], x_shift);
+                            }
+                        }
                     }
 
-                    if (bTDump)
+                    if (bCenter)
                     {
-                        fprintf(stderr,
-                                "\nDumping frame at t= %g %s\n",
-                                output_env_conv_time(oenv, frout_time),
-                                output_env_get_time_unit(oenv).c_str());
+                        center_x(ecenter, jobFrame.x, jobFrame.box, natoms, ncent, cindex);
                     }
+                }
 
-                    /* check for writing at each delta_t */
-                    bDoIt = (delta_t == 0);
-                    if (!bDoIt)
+                auto positionsArrayRef =
+                        gmx::arrayRefFromArray(reinterpret_cast<gmx::RVec*>(jobFrame.x), natoms);
+                if (bPBCcomAtom)
+                {
+                    switch (unitcell_enum)
                     {
-                        if (!bRound)
+                        case euRect:
+                            put_atoms_in_box(pbcType, jobFrame.box, positionsArrayRef);
+                            break;
+                        case euTric:
+                            put_atoms_in_triclinic_unitcell(
+                                    ecenter, jobFrame.box, positionsArrayRef);
+                            break;
+                        case euCompact:
+                            put_atoms_in_compact_unitcell(
+                                    pbcType, ecenter, jobFrame.box, positionsArrayRef);
+                            break;
+                    }
+                }
+                if (bPBCcomRes)
+                {
+                    put_residue_com_in_box(unitcell_enum,
+                                           ecenter,
+                                           natoms,
+                                           atoms->atom,
+                                           pbcType,
+                                           jobFrame.box,
+                                           jobFrame.x);
+                }
+                if (bPBCcomMol)
+                {
+                    put_molecule_com_in_box(unitcell_enum,
+                                            ecenter,
+                                            &top->mols,
+                                            natoms,
+                                            atoms->atom,
+                                            pbcType,
+                                            jobFrame.box,
+                                            jobFrame.x);
+                }
+                /* Copy the input trxframe struct to the output trxframe struct */
+                t_trxframe& frout = job->frout;
+                frout             = jobFrame;
+                frout.time        = job->outputTime;
+                frout.bV          = (frout.bV && bVels);
+                frout.bF          = (frout.bF && bForce);
+                frout.natoms      = nout;
+                if (bNeedPrec && (bSetXtcPrec || !jobFrame.bPrec))
+                {
+                    frout.bPrec = TRUE;
+                    frout.prec  = prec;
+                }
+                if (bCopy)
+                {
+                    job->x.resize(nout);
+                    frout.x = as_rvec_array(job->x.data());
+                    if (frout.bV)
+                    {
+                        job->v.resize(nout);
+                        frout.v = as_rvec_array(job->v.data());
+                    }
+                    if (frout.bF)
+                    {
+                        job->f.resize(nout);
+                        frout.f = as_rvec_array(job->f.data());
+                    }
+                    for (int i = 0; i < nout; i++)
+                    {
+                        copy_rvec(jobFrame.x[index[i]], frout.x[i]);
+                        if (frout.bV)
                         {
-                            bDoIt = bRmod(frout_time, tzero, delta_t);
+                            copy_rvec(jobFrame.v[index[i]], frout.v[i]);
                         }
-                        else
+                        if (frout.bF)
                         {
-                            /* round() is not C89 compatible, so we do this:  */
-                            bDoIt = bRmod(std::floor(frout_time + 0.5),
-                                          std::floor(tzero + 0.5),
-                                          std::floor(delta_t + 0.5));
+                            copy_rvec(jobFrame.f[index[i]], frout.f[i]);
                         }
                     }
+                }
 
-                    /* Flag whenever the reading routine prints, so that we print after it and do not mangle the line */
-                    if (trxio_should_print_count(oenv, trxin))
+                if (opt2parg_bSet("-shift", NPA, pa))
+                {
+                    for (int i = 0; i < nout; i++)
                     {
-                        bFrameReadHasPrinted = true;
+                        for (int d = 0; d < DIM; d++)
+                        {
+                            frout.x[i][d] += job->outputFrame * shift[d];
+                        }
                     }
+                }
 
-                    if (bDoIt || bTDump)
-                    {
-                        // Whenever a frame is output, store the frame and time to be printed at the next opportunity
-                        frameNumberToPrint = outframe;
-                        frameTimeToPrint   = frout_time;
+                /* Compressing is the most expensive part of writing xtc, so do it here */
+                job->haveEncodedFrame = (ftp == efXTC && frout.bX
+                                         && encode_xtc(&job->encodedFrame,
+                                                       frout.natoms,
+                                                       frout.step,
+                                                       frout.time,
+                                                       frout.box,
+                                                       frout.x,
+                                                       frout.bPrec ? frout.prec : 1000.0));
+            };
+
+            /* Writes the output frames of batch in order */
+            auto writeBatch = [&](TrjconvFrameBatch* batch)
+            {
+                for (int j = 0; j < batch->numFrames; j++)
+                {
+                    TrjconvFrameJob* job   = &batch->jobs[j];
+                    t_trxframe&      frout = job->frout;
 
-                        if (!bPFit)
-                        {
-                            /* Now modify the coords according to the flags,
-                               for PFit we did this already! */
+                    // Whenever a frame is output, store the frame and time to be printed at the next opportunity
+                    frameNumberToPrint = job->outputFrame;
+                    frameTimeToPrint   = job->outputTime;
 
-                            if (bRmPBC)
-                            {
-                                gmx_rmpbc_trxfr(gpbc, &fr);
-                            }
+                    if (!bRound)
+                    {
+                        bSplitHere = bSplit && bRmod(frout.time, tzero, split_t);
+                    }
+                    else
+                    {
+                        /* round() is not C89 compatible, so we do this: */
+                        bSplitHere = bSplit
+                                     && bRmod(std::floor(frout.time + 0.5),
+                                              std::floor(tzero + 0.5),
+                                              std::floor(split_t + 0.5));
+                    }
+                    if (bSeparate || bSplitHere)
+                    {
+                        mk_filenm(outf_base, ftp2ext(ftp), nzero, file_nr, out_file2);
+                    }
 
-                            if (bReset)
+                    std::string title;
+                    switch (ftp)
+                    {
+                        case efTNG:
+                            write_tng_frame(trxout, &frout);
+                            // TODO when trjconv behaves better: work how to read and write lambda
+                            break;
+                        case efTRR:
+                        case efXTC:
+                            if (bSplitHere)
                             {
-                                reset_x_ndim(nfitdim, ifit, ind_fit, natoms, nullptr, fr.x, w_rls);
-                                if (bFit)
+                                if (trxout)
                                 {
-                                    do_fit_ndim(nfitdim, natoms, w_rls, xp, fr.x);
+                                    close_trx(trxout);
                                 }
-                                if (!bCenter)
+                                trxout = open_trx(out_file2, filemode);
+                            }
+                            if (job->haveEncodedFrame)
+                            {
+                                t_fileio* fio = trx_get_fileio(trxout);
+                                if (write_encoded_xtc(fio, job->encodedFrame) == 0)
                                 {
-                                    for (i = 0; i < natoms; i++)
-                                    {
-                                        rvec_inc(fr.x[i], x_shift);
-                                    }
+                                    gmx_fatal(FARGS,
+                                              "Error writing frame to %s",
+                                              gmx_fio_getname(fio).string().c_str());
                                 }
                             }
-
-                            if (bCenter)
+                            else
                             {
-                                center_x(ecenter, fr.x, fr.box, natoms, ncent, cindex);
+                                write_trxframe(trxout, &frout, gc);
                             }
-                        }
-
-                        auto positionsArrayRef =
-                                gmx::arrayRefFromArray(reinterpret_cast<gmx::RVec*>(fr.x), natoms);
-                        if (bPBCcomAtom)
-                        {
-                            switch (unitcell_enum)
+                            break;
+                        case efGRO:
+                        case efG96:
+                        case efPDB:
+                            // Only add a generator statement if title is empty,
+                            // to avoid multiple generated-by statements from various programs
+                            if (std::strlen(top_title) == 0)
                             {
-                                case euRect:
-                                    put_atoms_in_box(pbcType, fr.box, positionsArrayRef);
-                                    break;
-                                case euTric:
-                                    put_atoms_in_triclinic_unitcell(ecenter, fr.box, positionsArrayRef);
-                                    break;
-                                case euCompact:
-                                    put_atoms_in_compact_unitcell(
-                                            pbcType, ecenter, fr.box, positionsArrayRef);
-                                    break;
+                                sprintf(top_title, "Generated by trjconv");
                             }
-                        }
-                        if (bPBCcomRes)
-                        {
-                            put_residue_com_in_box(
-                                    unitcell_enum, ecenter, natoms, atoms->atom, pbcType, fr.box, fr.x);
-                        }
-                        if (bPBCcomMol)
-                        {
-                            put_molecule_com_in_box(
-                                    unitcell_enum, ecenter, &top->mols, natoms, atoms->atom, pbcType, fr.box, fr.x);
-                        }
-                        /* Copy the input trxframe struct to the output trxframe struct */
-                        frout        = bTDump ? *frameToDump : fr;
-                        frout.time   = frout_time;
-                        frout.bV     = (frout.bV && bVels);
-                        frout.bF     = (frout.bF && bForce);
-                        frout.natoms = nout;
-                        if (bNeedPrec && (bSetXtcPrec || !fr.bPrec))
-                        {
-                            frout.bPrec = TRUE;
-                            frout.prec  = prec;
-                        }
-                        if (bCopy)
-                        {
-                            frout.x = xmem;
-                            if (frout.bV)
+                            if (frout.bTime)
                             {
-                                frout.v = vmem;
+                                sprintf(timestr, " t= %9.5f", frout.time);
                             }
-                            if (frout.bF)
+                            else
                             {
-                                frout.f = fmem;
+                                std::strcpy(timestr, "");
                             }
-                            for (i = 0; i < nout; i++)
+                            if (frout.bStep)
                             {
-                                copy_rvec(fr.x[index[i]], frout.x[i]);
-                                if (frout.bV)
-                                {
-                                    copy_rvec(fr.v[index[i]], frout.v[i]);
-                                }
-                                if (frout.bF)
-                                {
-                                    copy_rvec(fr.f[index[i]], frout.f[i]);
-                                }
+                                sprintf(stepstr, " step= %" PRId64, frout.step);
                             }
-                        }
-
-                        if (opt2parg_bSet("-shift", NPA, pa))
-                        {
-                            for (i = 0; i < nout; i++)
+                            else
                             {
-                                for (d = 0; d < DIM; d++)
-                                {
-                                    frout.x[i][d] += outframe * shift[d];
-                                }
+                                std::strcpy(stepstr, "");
                             }
-                        }
-
-                        if (!bRound)
-                        {
-                            bSplitHere = bSplit && bRmod(frout.time, tzero, split_t);
-                        }
-                        else
-                        {
-                            /* round() is not C89 compatible, so we do this: */
-                            bSplitHere = bSplit
-                                         && bRmod(std::floor(frout.time + 0.5),
-                                                  std::floor(tzero + 0.5),
-                                                  std::floor(split_t + 0.5));
-                        }
-                        if (bSeparate || bSplitHere)
-                        {
-                            mk_filenm(outf_base, ftp2ext(ftp), nzero, file_nr, out_file2);
-                        }
-
-                        std::string title;
-                        switch (ftp)
-                        {
-                            case efTNG:
-                                write_tng_frame(trxout, &frout);
-                                // TODO when trjconv behaves better: work how to read and write lambda
-                                break;
-                            case efTRR:
-                            case efXTC:
-                                if (bSplitHere)
-                                {
-                                    if (trxout)
+                            title = gmx::formatString("%s%s%s", top_title, timestr, stepstr);
+                            if (bSeparate || bSplitHere)
+                            {
+                                out = gmx_ffopen(out_file2, "w");
+                            }
+                            switch (ftp)
+                            {
+                                case efGRO:
+                                    write_hconf_p(out,
+                                                  title.c_str(),
+                                                  &useatoms,
+                                                  frout.x,
+                                                  frout.bV ? frout.v : nullptr,
+                                                  frout.box);
+                                    break;
+                                case efPDB:
+                                    fprintf(out, "REMARK    GENERATED BY TRJCONV\n");
+                                    /* if reading from pdb, we want to keep the original
+                                       model numbering else we write the output frame
+                                       number plus one, because model 0 is not allowed in pdb */
+                                    if (ftpin == efPDB && job->frame.bStep
+                                        && job->frame.step > model_nr)
                                     {
-                                        close_trx(trxout);
+                                        model_nr = job->frame.step;
                                     }
-                                    trxout = open_trx(out_file2, filemode);
-                                }
-                                write_trxframe(trxout, &frout, gc);
-                                break;
-                            case efGRO:
-                            case efG96:
-                            case efPDB:
-                                // Only add a generator statement if title is empty,
-                                // to avoid multiple generated-by statements from various programs
-                                if (std::strlen(top_title) == 0)
-                                {
-                                    sprintf(top_title, "Generated by trjconv");
-                                }
-                                if (frout.bTime)
-                                {
-                                    sprintf(timestr, " t= %9.5f", frout.time);
-                                }
-                                else
-                                {
-                                    std::strcpy(timestr, "");
-                                }
-                                if (frout.bStep)
-                                {
-                                    sprintf(stepstr, " step= %" PRId64, frout.step);
-                                }
-                                else
-                                {
-                                    std::strcpy(stepstr, "");
-                                }
-                                title = gmx::formatString("%s%s%s", top_title, timestr, stepstr);
-                                if (bSeparate || bSplitHere)
-                                {
-                                    out = gmx_ffopen(out_file2, "w");
-                                }
-                                switch (ftp)
-                                {
-                                    case efGRO:
-                                        write_hconf_p(out,
-                                                      title.c_str(),
-                                                      &useatoms,
-                                                      frout.x,
-                                                      frout.bV ? frout.v : nullptr,
-                                                      frout.box);
-                                        break;
-                                    case efPDB:
-                                        fprintf(out, "REMARK    GENERATED BY TRJCONV\n");
-                                        /* if reading from pdb, we want to keep the original
-                                           model numbering else we write the output frame
-                                           number plus one, because model 0 is not allowed in pdb */
-                                        if (ftpin == efPDB && fr.bStep && fr.step > model_nr)
-                                        {
-                                            model_nr = fr.step;
-                                        }
-                                        else
+                                    else
+                                    {
+                                        model_nr++;
+                                    }
+                                    write_pdbfile(out,
+                                                  title.c_str(),
+                                                  &useatoms,
+                                                  frout.x,
+                                                  frout.pbcType,
+                                                  frout.box,
+                                                  ' ',
+                                                  model_nr,
+                                                  gc);
+                                    break;
+                                case efG96:
+                                    const char* outputTitle = "";
+                                    if (bSeparate || bTDump)
+                                    {
+                                        outputTitle = title.c_str();
+                                        if (bTPS)
                                         {
-                                            model_nr++;
+                                            frout.bAtoms = TRUE;
                                         }
-                                        write_pdbfile(out,
-                                                      title.c_str(),
-                                                      &useatoms,
-                                                      frout.x,
-                                                      frout.pbcType,
-                                                      frout.box,
-                                                      ' ',
-                                                      model_nr,
-                                                      gc);
-                                        break;
-                                    case efG96:
-                                        const char* outputTitle = "";
-                                        if (bSeparate || bTDump)
+                                        frout.atoms = &useatoms;
+                                        frout.bStep = FALSE;
+                                        frout.bTime = FALSE;
+                                    }
+                                    else
+                                    {
+                                        if (job->outputFrame == 0)
                                         {
                                             outputTitle = title.c_str();
-                                            if (bTPS)
-                                            {
-                                                frout.bAtoms = TRUE;
-                                            }
-                                            frout.atoms = &useatoms;
-                                            frout.bStep = FALSE;
-                                            frout.bTime = FALSE;
-                                        }
-                                        else
-                                        {
-                                            if (outframe == 0)
-                                            {
-                                                outputTitle = title.c_str();
-                                            }
-                                            frout.bAtoms = FALSE;
-                                            frout.bStep  = TRUE;
-                                            frout.bTime  = TRUE;
                                         }
-                                        write_g96_conf(out, outputTitle, &frout, -1, nullptr);
-                                }
-                                if (bSeparate || bSplitHere)
-                                {
-                                    gmx_ffclose(out);
-                                    out = nullptr;
-                                }
-                                break;
-                            default: gmx_fatal(FARGS, "DHE, ftp=%d\n", ftp);
-                        }
-                        if (bSeparate || bSplitHere)
+                                        frout.bAtoms = FALSE;
+                                        frout.bStep  = TRUE;
+                                        frout.bTime  = TRUE;
+                                    }
+                                    write_g96_conf(out, outputTitle, &frout, -1, nullptr);
+                            }
+                            if (bSeparate || bSplitHere)
+                            {
+                                gmx_ffclose(out);
+                                out = nullptr;
+                            }
+                            break;
+                        default: gmx_fatal(FARGS, "DHE, ftp=%d\n", ftp);
+                    }
+                    if (bSeparate || bSplitHere)
+                    {
+                        file_nr++;
+                    }
+
+                    /* execute command */
+                    if (bExec)
+                    {
+                        char c[255];
+                        sprintf(c, "%s  %d", exec_command, file_nr - 1);
+                        /*fprintf(stderr,"Executing '%s'\n",c);*/
+                        if (0 != system(c))
                         {
-                            file_nr++;
+                            gmx_fatal(FARGS, "Error executing command: %s", c);
                         }
+                    }
+                    if (job->readHasPrinted)
+                    {
+                        fprintf(stderr,
+                                " ->  frame %6d time %8.3f      \r",
+                                frameNumberToPrint,
+                                output_env_conv_time(oenv, frameTimeToPrint));
+                        fflush(stderr);
+                    }
+                }
+            };
 
-                        /* execute command */
-                        if (bExec)
+            /* Main loop over batches of frames */
+            int currentBatch = 0;
+            readBatch(&batches[currentBatch]);
+            while (batches[currentBatch].numFrames > 0
+                   || batches[(currentBatch + 2) % 3].numFrames > 0)
+            {
+                TrjconvFrameBatch* current  = &batches[currentBatch];
+                TrjconvFrameBatch* next     = &batches[(currentBatch + 1) % 3];
+                TrjconvFrameBatch* previous = &batches[(currentBatch + 2) % 3];
+#pragma omp parallel num_threads(nthreads)
+                {
+                    try
+                    {
+                        const int thread = gmx_omp_get_thread_num();
+                        if (thread == 0)
                         {
-                            char c[255];
-                            sprintf(c, "%s  %d", exec_command, file_nr - 1);
-                            /*fprintf(stderr,"Executing '%s'\n",c);*/
-                            if (0 != system(c))
-                            {
-                                gmx_fatal(FARGS, "Error executing command: %s", c);
-                            }
+                            writeBatch(previous);
                         }
-                        outframe++;
-                        if (bFrameReadHasPrinted)
+                        if (thread == readerThread)
                         {
-                            fprintf(stderr,
-                                    " ->  frame %6d time %8.3f      \r",
-                                    frameNumberToPrint,
-                                    output_env_conv_time(oenv, frameTimeToPrint));
-                            fflush(stderr);
-                            bFrameReadHasPrinted = false;
+                            readBatch(next);
+                        }
+#pragma omp for schedule(dynamic)
+                        for (int j = 0; j < current->numFrames; j++)
+                        {
+                            transformFrame(&current->jobs[j], threadGpbc[thread]);
                         }
                     }
+                    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
                 }
-                frame++;
-                if (bTDump && !bDumpFrame)
+                previous->numFrames = 0;
+                currentBatch        = (currentBatch + 1) % 3;
+            }
+
+            for (int t = 1; t < nthreads; t++)
+            {
+                if (threadGpbc[t])
                 {
-                    // Save the current frame so that we can dump it
-                    // next step if it later proves to be the one
-                    // whose time was nearest the dump time.
-                    swapFrames(&fr, &previousFrame);
+                    gmx_rmpbc_done(threadGpbc[t]);
                 }
-                // Now that we are done with the current frame, we
-                // swap it for the previously-read subsequent frame.
-                if (bHaveNextFrame)
+            }
+            for (auto& batch : batches)
+            {
+                for (auto& job : batch.jobs)
                 {
-                    swapFrames(&fr, &nextFrame);
+                    done_frame(&job.frame);
                 }
-            } while (!(bTDump && bDumpFrame) && bHaveNextFrame);
+            }
             fprintf(stderr,
                     "\nLast written: frame %6d time %8.3f\n",
                     frameNumberToPrint,
@@ -1691,9 +1913,6 @@ int gmx_trjconv(int argc, char* argv[])
         sfree(top);
     }
     sfree(xp);
-    sfree(xmem);
-    sfree(vmem);
-    sfree(fmem);
     sfree(grpnm);
     sfree(index);
     sfree(cindex);
@@ -46,8 +46,10 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <memory>
 #include <numeric>
 #include <string>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/fileio/filetypes.h"
@@ -63,9 +65,12 @@
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/ewald/pme.h"
+#include "gromacs/ewald/pme_tuning_cache.h"
 #include "gromacs/fft/calcgrid.h"
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/tpxio.h"
+#include "gromacs/hardware/detecthardware.h"
+#include "gromacs/hardware/hw_info.h"
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/perf_est.h"
@@ -78,12 +83,14 @@
 #include "gromacs/timing/walltime_accounting.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/basenetwork.h"
 #include "gromacs/utility/baseversion.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/path.h"
+#include "gromacs/utility/physicalnodecommunicator.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
 
@@ -814,6 +821,49 @@ static std::string make_gpu_id_command_line(const char* eligible_gpu_ids)
     return std::string();
 }
 
+/* Store the best settings in the PME tuning cache read by mdrun */
+static void write_tuning_cache(const char*    cacheFile, /* The PME tuning cache file */
+                               const char*    fn_tpr,    /* The input tpr file */
+                               int            nnodes,    /* Total number of ranks */
+                               const char*    extraArgs, /* Arguments passed on to mdrun */
+                               int            best_npme, /* The best number of PME ranks */
+                               PmeTuneInputs* info,
+                               int            best_tpr) /* Index of the best settings in info */
+{
+    /* mdrun looks up the settings using the number of OpenMP threads it was
+     * asked for, so we need the value passed on to the benchmark runs */
+    int                            numThreadsRequested = 0;
+    const std::vector<std::string> args                = gmx::splitString(extraArgs);
+    for (size_t i = 0; i + 1 < args.size(); i++)
+    {
+        if (args[i] == "-ntomp")
+        {
+            numThreadsRequested = std::atoi(args[i + 1].c_str());
+        }
+    }
+
+    MPI_Comm                      communicator = GMX_LIB_MPI ? MPI_COMM_WORLD : MPI_COMM_NULL;
+    gmx::PhysicalNodeCommunicator physicalNodeComm(communicator, gmx_physicalnode_id_hash());
+    std::unique_ptr<gmx_hw_info_t> hwinfo = gmx_detect_hardware(physicalNodeComm, communicator);
+
+    const std::string key = gmx::makePmeTuningRunKey(gmx::pmeTuningFileHash(fn_tpr),
+                                                     gmx::hardwareFingerprint(*hwinfo),
+                                                     nnodes,
+                                                     -1,
+                                                     numThreadsRequested);
+
+    gmx::PmeTuningRunSettings settings;
+    settings.numPmeRanks = best_npme;
+    settings.nkx         = info->nkx[best_tpr];
+    settings.nky         = info->nky[best_tpr];
+    settings.nkz         = info->nkz[best_tpr];
+    settings.rcoulomb    = info->rcoulomb[best_tpr];
+    settings.rvdw        = info->rvdw[best_tpr];
+    gmx::writePmeTuningRunSettings(cacheFile, key, settings);
+
+    fprintf(stdout, "Stored the best settings in the PME tuning cache %s\n", cacheFile);
+}
+
 static void launch_simulation(gmx_bool    bLaunch,          /* Should the simulation be launched? */
                               FILE*       fp,               /* General log file */
                               gmx_bool    bThreads,         /* whether to use threads */
@@ -1919,7 +1969,8 @@ static gmx_bool is_launch_file(char* opt, gmx_bool bSet)
     /* Apart from the input .tpr and the output log files we need all options that
      * were set on the command line and that do not start with -b */
     if (0 == std::strncmp(opt, "-b", 2) || 0 == std::strncmp(opt, "-s", 2)
-        || 0 == std::strncmp(opt, "-err", 4) || 0 == std::strncmp(opt, "-p", 2))
+        || 0 == std::strncmp(opt, "-err", 4) || 0 == std::strncmp(opt, "-p", 2)
+        || 0 == std::strncmp(opt, "-tunecache", 10))
     {
         return FALSE;
     }
@@ -2224,6 +2275,12 @@ int gmx_tune_pme(int argc, char* argv[])
         "calls to",
         "mdrun that use this set appropriately. [TT]gmx-tune_pme[tt] does not support",
         "[TT]-gputasks[tt].[PAR]",
+        "With [TT]-tunecache[tt], the best settings are stored in a PME tuning cache file,",
+        "keyed by the input [REF].tpr[ref] file, the hardware and the number of ranks",
+        "and OpenMP threads. When this file is given to [gmx-mdrun] through the",
+        "environment variable GMX_PME_TUNING_CACHE, mdrun uses the stored number of",
+        "PME-only ranks (unless [TT]-npme[tt] is set), cut-off and PME grid",
+        "and skips its own PME tuning.[PAR]",
     };
 
     int   nnodes         = 1;
@@ -2275,6 +2332,7 @@ int gmx_tune_pme(int argc, char* argv[])
                               { efOUT, "-p", "perf", ffWRITE },
                               { efLOG, "-err", "bencherr", ffWRITE },
                               { efTPR, "-so", "tuned", ffWRITE },
+                              { efDAT, "-tunecache", "pmetune", ffOPTWR },
                               /* mdrun: */
                               { efTPR, "-s", nullptr, ffREAD },
                               { efTRN, "-o", nullptr, ffWRITE },
@@ -2752,6 +2810,17 @@ int gmx_tune_pme(int argc, char* argv[])
         bKeepTPR = analyze_data(
                 fp, opt2fn("-p", NFILE, fnm), perfdata, nnodes, ntprs, pmeentries, repeats, info, &best_tpr, &best_npme);
 
+        if (opt2bSet("-tunecache", NFILE, fnm))
+        {
+            write_tuning_cache(opt2fn("-tunecache", NFILE, fnm),
+                               opt2fn("-s", NFILE, fnm),
+                               nnodes,
+                               ExtraArgs,
+                               best_npme,
+                               info,
+                               best_tpr);
+        }
+
         /* Take the best-performing tpr file and enlarge nsteps to original value */
         if (bKeepTPR && !bOverwrite)
         {
@@ -57,10 +57,17 @@
 #include "modules/scattering.h"
 #include "modules/select.h"
 #include "modules/trajectory.h"
+#include "modules/transpose_trj.h"
 
+#include <utility>
+#include <vector>
+
+#include "gromacs/commandline/cmdlinemodule.h"
 #include "gromacs/commandline/cmdlinemodulemanager.h"
 #include "gromacs/trajectoryanalysis/cmdlinerunner.h"
 
+#include "multimodulerunner.h"
+
 namespace gmx
 {
 
@@ -77,14 +84,20 @@ namespace
  * `const char name[]`, `const char shortDescription[]`, and
  * `gmx::TrajectoryAnalysisModulePointer create()`.
  *
+ * The module is also added to \p entries, the modules that the
+ * multi-module runner can run.
+ *
  * \ingroup module_trajectoryanalysis
  */
 template<class ModuleInfo>
-void registerModule(CommandLineModuleManager* manager, CommandLineModuleGroup group)
+void registerModule(CommandLineModuleManager*                   manager,
+                    CommandLineModuleGroup                      group,
+                    std::vector<TrajectoryAnalysisModuleEntry>* entries)
 {
     TrajectoryAnalysisCommandLineRunner::registerModule(
             manager, ModuleInfo::name, ModuleInfo::shortDescription, &ModuleInfo::create);
     group.addModule(ModuleInfo::name);
+    entries->push_back({ ModuleInfo::name, &ModuleInfo::create });
 }
 
 } // namespace
@@ -94,21 +107,30 @@ void registerTrajectoryAnalysisModules(CommandLineModuleManager* manager)
 {
     using namespace gmx::analysismodules;
     CommandLineModuleGroup group = manager->addModuleGroup("Trajectory analysis");
-    registerModule<AngleInfo>(manager, group);
-    registerModule<ConvertTrjInfo>(manager, group);
-    registerModule<DistanceInfo>(manager, group);
-    registerModule<DsspInfo>(manager, group);
-    registerModule<ExtractClusterInfo>(manager, group);
-    registerModule<FreeVolumeInfo>(manager, group);
-    registerModule<HbondInfo>(manager, group);
-    registerModule<MsdInfo>(manager, group);
-    registerModule<PairDistanceInfo>(manager, group);
-    registerModule<RdfInfo>(manager, group);
-    registerModule<SasaInfo>(manager, group);
-    registerModule<ScatteringInfo>(manager, group);
-    registerModule<SelectInfo>(manager, group);
-    registerModule<TrajectoryInfo>(manager, group);
-    registerModule<GyrateInfo>(manager, group);
+
+    std::vector<TrajectoryAnalysisModuleEntry> entries;
+    registerModule<AngleInfo>(manager, group, &entries);
+    registerModule<ConvertTrjInfo>(manager, group, &entries);
+    registerModule<DistanceInfo>(manager, group, &entries);
+    registerModule<DsspInfo>(manager, group, &entries);
+    registerModule<ExtractClusterInfo>(manager, group, &entries);
+    registerModule<FreeVolumeInfo>(manager, group, &entries);
+    registerModule<HbondInfo>(manager, group, &entries);
+    registerModule<MsdInfo>(manager, group, &entries);
+    registerModule<PairDistanceInfo>(manager, group, &entries);
+    registerModule<RdfInfo>(manager, group, &entries);
+    registerModule<SasaInfo>(manager, group, &entries);
+    registerModule<ScatteringInfo>(manager, group, &entries);
+    registerModule<SelectInfo>(manager, group, &entries);
+    registerModule<TrajectoryInfo>(manager, group, &entries);
+    registerModule<TransposeTrjInfo>(manager, group, &entries);
+    registerModule<GyrateInfo>(manager, group, &entries);
+
+    const char* const multiModuleName        = "multi-analyze";
+    const char* const multiModuleDescription = "Run several trajectory analysis tools in one pass";
+    manager->addModule(createTrajectoryAnalysisMultiModuleRunner(
+            multiModuleName, multiModuleDescription, std::move(entries)));
+    group.addModule(multiModuleName);
 }
 //! \endcond
 
@@ -46,6 +46,7 @@
 #include "dssp.h"
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 
@@ -75,15 +76,19 @@
 #include "gromacs/selection/nbsearch.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/selection/selectionoption.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/atoms.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
 #include "gromacs/trajectoryanalysis/topologyinformation.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/real.h"
 
@@ -487,6 +492,43 @@ bool SecondaryStructuresData::hasBridges(BridgeTypes bridgeType) const
     }
 }
 
+//! Enum of the atoms whose coordinates enter the h-bond energy.
+enum class HBondEnergyAtom : std::size_t
+{
+    CA,
+    N,
+    H,
+    C,
+    O,
+    Count
+};
+
+/*! \brief
+ * Per-thread buffers for computing h-bond energies.
+ */
+struct HBondEnergyWork
+{
+    //! Acceptor candidates of the current donor, padded to the SIMD width.
+    std::vector<std::int32_t, AlignedAllocator<std::int32_t>> candidates;
+    //! Acceptors with negative h-bond energy, for all donors handled by this thread.
+    std::vector<std::int32_t> acceptors;
+    //! H-bond energies corresponding to acceptors.
+    std::vector<float> energies;
+};
+
+/*! \brief
+ * Location of the h-bonds of one donor in the per-thread buffers.
+ */
+struct DonorHBondRange
+{
+    //! Thread that computed the h-bonds.
+    int thread = 0;
+    //! First h-bond of the donor in the buffers of the thread.
+    std::size_t begin = 0;
+    //! One past the last h-bond of the donor in the buffers of the thread.
+    std::size_t end = 0;
+};
+
 /*! \brief
  * Class that provides search of specific h-bond patterns within residues.
  */
@@ -505,6 +547,10 @@ public:
      * empty after running analyseTopology(), then some error has occurred.
      */
     bool topologyIsIncorrect() const;
+    /*! \brief
+     * Function that sets the number of OpenMP threads used for the h-bond energy calculation.
+     */
+    void setThreadCount(int threadCount);
     /*! \brief
      * Complex function that provides h-bond patterns search and returns string of one-letter secondary structure definitions.
      */
@@ -547,10 +593,6 @@ private:
                                           std::size_t       atomB,
                                           const t_trxframe& fr,
                                           const t_pbc*      pbc);
-    /*! \brief
-     * Function that calculates atomic distances between atoms A and B based on atom indices (for atom B) and atom coordinates (for atom A).
-     */
-    static float calculateAtomicDistances(rvec atomA, std::size_t atomB, const t_trxframe& fr, const t_pbc* pbc);
     /*! \brief
      * Function that calculates Dihedral Angles based on atom indices.
      */
@@ -566,13 +608,38 @@ private:
     void calculateBends(const t_trxframe& fr, const t_pbc* pbc);
 
     /*! \brief
-     * Function that checks if H-Bond exist according to DSSP algorithm
+     * Function that collects the coordinates used in the h-bond energy of each residue, including
+     * the hydrogen pseudo-atoms.
+     */
+    void prepareHBondEnergyCoordinates(const t_trxframe& fr, const t_pbc* pbc);
+    /*! \brief
+     * Function that finds, for each residue, the residues whose CA atoms are within \p cutoff,
+     * using GROMACS neighbor search.
+     */
+    void findNeighborResidues(const t_pbc* pbc, real cutoff);
+    /*! \brief
+     * Function that checks if H-Bond exist according to DSSP algorithm for all pairs of residues
      * kCouplingConstant = 27.888,  //  = 332 * 0.42 * 0.2
      * E = k * (1/rON + 1/rCH - 1/rOH - 1/rCN) where CO comes from one AA and NH from another
      * if R is in A
      * Hbond exists if E < -0.5
+     *
+     * The energies of each donor are computed with SIMD over its acceptor candidates, and
+     * the donors are distributed over threads. The two lowest energies of each residue are
+     * then selected in the same order as when processing the pairs one by one.
      */
-    void calculateHBondEnergy(ResInfo* Donor, ResInfo* Acceptor, const t_trxframe& fr, const t_pbc* pbc);
+    void calculateHBondEnergies(const t_trxframe& fr, const t_pbc* pbc, bool nBSmode, real cutoff);
+    /*! \brief
+     * Function that computes the h-bond energies between \p donor and the acceptor candidates
+     * in \p work, and appends the negative ones to \p work.
+     *
+     * The candidates are padded to the SIMD width in place, so they are taken from \p work
+     * instead of being passed as a separate view.
+     */
+    void calculateDonorHBondEnergies(std::size_t      donor,
+                                     const t_pbc*     pbc,
+                                     bool             useSimd,
+                                     HBondEnergyWork* work) const;
     /*! \brief
      * Function that checks if H-Bond exist according to HBOND algorithm
      * H-Bond exists if distance between Donor and Acceptor
@@ -602,6 +669,23 @@ private:
     PPStretches polyProStretch_ = PPStretches::Default;
     //! Enum value that defines hydrogen bond definition. Set in initial options.
     HBondDefinition hbDef_ = HBondDefinition::Energy;
+    //! Number of OpenMP threads used for the h-bond energy calculation.
+    int threadCount_ = 1;
+    /*! \brief
+     * Coordinates of the backbone atoms in frameVector_ used in the h-bond energy.
+     *
+     * Stored with four floats per residue, for loading them with SIMD gather operations.
+     * The hydrogen coordinates include the construction of the pseudo-atoms.
+     */
+    gmx::EnumerationArray<HBondEnergyAtom, std::vector<float, AlignedAllocator<float>>> energyCoordinates_;
+    //! Start of the neighbor residues of each residue in neighborResidues_.
+    std::vector<std::size_t> neighborResidueStart_;
+    //! Residues whose CA atoms are within the neighbor-search cutoff, in increasing order per residue.
+    std::vector<std::int32_t> neighborResidues_;
+    //! Per-thread buffers for the h-bond energy calculation.
+    std::vector<HBondEnergyWork> energyWork_;
+    //! Location of the h-bonds of each donor in energyWork_.
+    std::vector<DonorHBondRange> donorHBondRanges_;
 };
 
 void SecondaryStructures::analyseTopology(const TopologyInformation& top,
@@ -676,8 +760,18 @@ bool SecondaryStructures::topologyIsIncorrect() const
     return (topologyVector_.empty());
 }
 
+void SecondaryStructures::setThreadCount(int threadCount)
+{
+    threadCount_ = std::max(1, threadCount);
+}
+
 void SecondaryStructures::analyzeHydrogenBondsInFrame(const t_trxframe& fr, const t_pbc* pbc, bool nBSmode, real cutoff)
 {
+    if (hbDef_ == HBondDefinition::Energy)
+    {
+        calculateHBondEnergies(fr, pbc, nBSmode, cutoff);
+        return;
+    }
     if (nBSmode)
     {
         std::vector<gmx::RVec> positionsCA;
@@ -704,23 +798,10 @@ void SecondaryStructures::analyzeHydrogenBondsInFrame(const t_trxframe& fr, cons
             {
                 continue;
             }
-            switch (hbDef_)
+            calculateHBondGeometry(donor, acceptor, fr, pbc);
+            if (acceptor->info_ != donor->nextResi_->info_)
             {
-                case HBondDefinition::Energy:
-                    calculateHBondEnergy(donor, acceptor, fr, pbc);
-                    if (acceptor->info_ != donor->nextResi_->info_)
-                    {
-                        calculateHBondEnergy(acceptor, donor, fr, pbc);
-                    }
-                    break;
-                case HBondDefinition::Geometry:
-                    calculateHBondGeometry(donor, acceptor, fr, pbc);
-                    if (acceptor->info_ != donor->nextResi_->info_)
-                    {
-                        calculateHBondGeometry(acceptor, donor, fr, pbc);
-                    }
-                    break;
-                default: continue;
+                calculateHBondGeometry(acceptor, donor, fr, pbc);
             }
         }
     }
@@ -730,29 +811,337 @@ void SecondaryStructures::analyzeHydrogenBondsInFrame(const t_trxframe& fr, cons
         {
             for (std::size_t acceptor = donor + 1; acceptor < frameVector_.size(); ++acceptor)
             {
-                switch (hbDef_)
+                calculateHBondGeometry(&frameVector_[donor], &frameVector_[acceptor], fr, pbc);
+                if (acceptor != donor + 1)
+                {
+                    calculateHBondGeometry(&frameVector_[acceptor], &frameVector_[donor], fr, pbc);
+                }
+            }
+        }
+    }
+}
+
+void SecondaryStructures::prepareHBondEnergyCoordinates(const t_trxframe& fr, const t_pbc* pbc)
+{
+    for (auto& coordinates : energyCoordinates_)
+    {
+        coordinates.resize(4 * frameVector_.size());
+    }
+    auto setCoordinates = [this](HBondEnergyAtom atom, std::size_t residue, const rvec x)
+    {
+        float* dest = &energyCoordinates_[atom][4 * residue];
+        dest[XX]    = x[XX];
+        dest[YY]    = x[YY];
+        dest[ZZ]    = x[ZZ];
+        dest[3]     = 0;
+    };
+    for (std::size_t i = 0; i < frameVector_.size(); ++i)
+    {
+        const ResInfo& residue = frameVector_[i];
+        setCoordinates(HBondEnergyAtom::CA, i, fr.x[residue.getIndex(BackboneAtomTypes::AtomCA)]);
+        setCoordinates(HBondEnergyAtom::N, i, fr.x[residue.getIndex(BackboneAtomTypes::AtomN)]);
+        setCoordinates(HBondEnergyAtom::C, i, fr.x[residue.getIndex(BackboneAtomTypes::AtomC)]);
+        setCoordinates(HBondEnergyAtom::O, i, fr.x[residue.getIndex(BackboneAtomTypes::AtomO)]);
+        gmx::RVec atomH = fr.x[residue.getIndex(BackboneAtomTypes::AtomH)];
+        // Without the previous residue, the hydrogen pseudo-atom coincides with N.
+        if (hMode_ == HydrogenMode::Dssp && residue.prevResi_ != nullptr
+            && residue.prevResi_->getIndex(BackboneAtomTypes::AtomC)
+            && residue.prevResi_->getIndex(BackboneAtomTypes::AtomO))
+        {
+            gmx::RVec prevCO = fr.x[residue.prevResi_->getIndex(BackboneAtomTypes::AtomC)];
+            prevCO -= fr.x[residue.prevResi_->getIndex(BackboneAtomTypes::AtomO)];
+            float prevCODist = calculateAtomicDistances(residue.prevResi_->getIndex(BackboneAtomTypes::AtomC),
+                                                        residue.prevResi_->getIndex(BackboneAtomTypes::AtomO),
+                                                        fr,
+                                                        pbc);
+            atomH += prevCO / prevCODist;
+        }
+        setCoordinates(HBondEnergyAtom::H, i, atomH);
+    }
+}
+
+void SecondaryStructures::findNeighborResidues(const t_pbc* pbc, real cutoff)
+{
+    const std::size_t residueCount = frameVector_.size();
+    std::vector<std::vector<std::int32_t>> neighbors(residueCount);
+    std::vector<gmx::RVec>                 positionsCA(residueCount);
+    for (std::size_t i = 0; i < residueCount; ++i)
+    {
+        const float* x = &energyCoordinates_[HBondEnergyAtom::CA][4 * i];
+        positionsCA[i] = { x[XX], x[YY], x[ZZ] };
+    }
+    AnalysisNeighborhood nb;
+    nb.setCutoff(cutoff);
+    gmx::AnalysisNeighborhoodSearch     search     = nb.initSearch(pbc, positionsCA);
+    gmx::AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(positionsCA);
+    gmx::AnalysisNeighborhoodPair       pair;
+    while (pairSearch.findNextPair(&pair))
+    {
+        if (pair.refIndex() != pair.testIndex())
+        {
+            neighbors[pair.refIndex()].push_back(pair.testIndex());
+        }
+    }
+    neighborResidueStart_.assign(1, 0);
+    neighborResidues_.clear();
+    for (auto& residueNeighbors : neighbors)
+    {
+        std::sort(residueNeighbors.begin(), residueNeighbors.end());
+        neighborResidues_.insert(neighborResidues_.end(), residueNeighbors.begin(), residueNeighbors.end());
+        neighborResidueStart_.push_back(neighborResidues_.size());
+    }
+}
+
+//! Inserts \p energy with \p partner into the two lowest energies in \p partners and \p energies.
+void insertHBondPartner(t_resinfo** partners, float* energies, t_resinfo* partner, float energy)
+{
+    if (energy < energies[0])
+    {
+        partners[1] = partners[0];
+        energies[1] = energies[0];
+        partners[0] = partner;
+        energies[0] = energy;
+    }
+    else if (energy < energies[1])
+    {
+        partners[1] = partner;
+        energies[1] = energy;
+    }
+}
+
+void SecondaryStructures::calculateHBondEnergies(const t_trxframe& fr, const t_pbc* pbc, bool nBSmode, real cutoff)
+{
+    prepareHBondEnergyCoordinates(fr, pbc);
+    if (nBSmode)
+    {
+        findNeighborResidues(pbc, cutoff);
+    }
+    // SIMD uses the minimum image along the box diagonal, which is only valid for rectangular boxes.
+    const bool useSimd = (pbc == nullptr || pbc->pbcType == PbcType::No
+                          || (pbc->pbcType == PbcType::Xyz && pbc->box[YY][XX] == 0
+                              && pbc->box[ZZ][XX] == 0 && pbc->box[ZZ][YY] == 0));
+
+    const int residueCount = frameVector_.size();
+    const int nthreads     = std::max(1, std::min(threadCount_, residueCount));
+    energyWork_.resize(nthreads);
+    for (auto& work : energyWork_)
+    {
+        work.acceptors.clear();
+        work.energies.clear();
+    }
+    donorHBondRanges_.resize(residueCount);
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 16)
+    for (int donor = 0; donor < residueCount; ++donor)
+    {
+        try
+        {
+            const int        thread = gmx_omp_get_thread_num();
+            HBondEnergyWork& work   = energyWork_[thread];
+            DonorHBondRange& range  = donorHBondRanges_[donor];
+            range.thread            = thread;
+            range.begin             = work.acceptors.size();
+            const ResInfo& donorRes = frameVector_[donor];
+            if (!donorRes.isProline_ && donorRes.hasIndex(BackboneAtomTypes::AtomN)
+                && donorRes.hasIndex(BackboneAtomTypes::AtomH))
+            {
+                // The pairs where the acceptor directly precedes the donor are skipped.
+                auto isCandidate = [this, donor](int acceptor)
                 {
-                    case HBondDefinition::Energy:
-                        calculateHBondEnergy(&frameVector_[donor], &frameVector_[acceptor], fr, pbc);
-                        if (acceptor != donor + 1)
+                    const ResInfo& acceptorRes = frameVector_[acceptor];
+                    return acceptor != donor && acceptor + 1 != donor
+                           && acceptorRes.hasIndex(BackboneAtomTypes::AtomC)
+                           && acceptorRes.hasIndex(BackboneAtomTypes::AtomO);
+                };
+                work.candidates.clear();
+                if (nBSmode)
+                {
+                    for (std::size_t i = neighborResidueStart_[donor]; i < neighborResidueStart_[donor + 1]; ++i)
+                    {
+                        if (isCandidate(neighborResidues_[i]))
                         {
-                            calculateHBondEnergy(&frameVector_[acceptor], &frameVector_[donor], fr, pbc);
+                            work.candidates.push_back(neighborResidues_[i]);
                         }
-                        break;
-                    case HBondDefinition::Geometry:
-                        calculateHBondGeometry(&frameVector_[donor], &frameVector_[acceptor], fr, pbc);
-                        if (acceptor != donor + 1)
+                    }
+                }
+                else
+                {
+                    for (int acceptor = 0; acceptor < residueCount; ++acceptor)
+                    {
+                        if (isCandidate(acceptor))
                         {
-                            calculateHBondGeometry(&frameVector_[acceptor], &frameVector_[donor], fr, pbc);
+                            work.candidates.push_back(acceptor);
                         }
-                        break;
-                    default: continue;
+                    }
                 }
+                calculateDonorHBondEnergies(donor, pbc, useSimd, &work);
             }
+            range.end = work.acceptors.size();
+            // The acceptors are in increasing order, as when looping over all pairs.
+            ResInfo& donorResidue = frameVector_[donor];
+            for (std::size_t i = range.begin; i < range.end; ++i)
+            {
+                insertHBondPartner(donorResidue.acceptor_,
+                                   donorResidue.acceptorEnergy_,
+                                   frameVector_[work.acceptors[i]].info_,
+                                   work.energies[i]);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    // The donors of each acceptor are inserted in increasing order.
+    for (int donor = 0; donor < residueCount; ++donor)
+    {
+        const DonorHBondRange& range = donorHBondRanges_[donor];
+        const HBondEnergyWork& work  = energyWork_[range.thread];
+        for (std::size_t i = range.begin; i < range.end; ++i)
+        {
+            ResInfo& acceptorResidue = frameVector_[work.acceptors[i]];
+            insertHBondPartner(acceptorResidue.donor_,
+                               acceptorResidue.donorEnergy_,
+                               frameVector_[donor].info_,
+                               work.energies[i]);
         }
     }
 }
 
+void SecondaryStructures::calculateDonorHBondEnergies(std::size_t      donor,
+                                                      const t_pbc*     pbc,
+                                                      bool             useSimd,
+                                                      HBondEnergyWork* work) const
+{
+    // Values are taken from original DSSP algorithm, file Secondary.cpp from https://github.com/PDB-REDO/libcifpp/releases/tag/v3.0.0
+    const float minEnergy           = -9.9;
+    const float minimalAtomDistance = 0.5;
+    const float kCouplingConstant   = 27.888;
+
+    const float*      donorCA = &energyCoordinates_[HBondEnergyAtom::CA][4 * donor];
+    const float*      donorN  = &energyCoordinates_[HBondEnergyAtom::N][4 * donor];
+    const float*      donorH  = &energyCoordinates_[HBondEnergyAtom::H][4 * donor];
+    const std::size_t count   = work->candidates.size();
+    std::size_t       i       = 0;
+#if GMX_SIMD_HAVE_FLOAT
+    if (useSimd)
+    {
+        using gmx::SimdFloat;
+        // Pad the candidates with copies of the last one, whose energies are not used.
+        const std::int32_t lastCandidate = count > 0 ? work->candidates[count - 1] : 0;
+        work->candidates.resize(
+                ((count + GMX_SIMD_FLOAT_WIDTH - 1) / GMX_SIMD_FLOAT_WIDTH) * GMX_SIMD_FLOAT_WIDTH,
+                lastCandidate);
+        const std::int32_t* candidates = work->candidates.data();
+
+        // pbc_dx() does not apply PBC to boxes with a zero diagonal element, e.g., to
+        // structures without box information.
+        const bool usePbc = (pbc != nullptr && pbc->pbcType == PbcType::Xyz && pbc->fbox_diag[XX] > 0
+                             && pbc->fbox_diag[YY] > 0 && pbc->fbox_diag[ZZ] > 0);
+        SimdFloat  box[DIM];
+        SimdFloat  invBox[DIM];
+        for (int d = 0; d < DIM; ++d)
+        {
+            box[d]    = SimdFloat(usePbc ? pbc->fbox_diag[d] : 0.0F);
+            invBox[d] = SimdFloat(usePbc ? 1.0F / pbc->fbox_diag[d] : 0.0F);
+        }
+        auto distance2 = [&box, &invBox](const float* xi, SimdFloat x, SimdFloat y, SimdFloat z)
+        {
+            SimdFloat dx = SimdFloat(xi[XX]) - x;
+            SimdFloat dy = SimdFloat(xi[YY]) - y;
+            SimdFloat dz = SimdFloat(xi[ZZ]) - z;
+            // Without PBC, the inverse box lengths are zero and this does nothing.
+            dx = fnma(box[XX], round(dx * invBox[XX]), dx);
+            dy = fnma(box[YY], round(dy * invBox[YY]), dy);
+            dz = fnma(box[ZZ], round(dz * invBox[ZZ]), dz);
+            return fma(dx, dx, fma(dy, dy, dz * dz));
+        };
+        const SimdFloat nm2ToA2(gmx::c_nm2A * gmx::c_nm2A);
+        const SimdFloat maxCA2(minimalCAdistance_ * minimalCAdistance_);
+        const SimdFloat minAtom2(minimalAtomDistance * minimalAtomDistance);
+        const SimdFloat coupling(kCouplingConstant);
+        const SimdFloat minEnergyS(minEnergy);
+
+        alignas(GMX_SIMD_ALIGNMENT) float energies[GMX_SIMD_FLOAT_WIDTH];
+        for (; i < count; i += GMX_SIMD_FLOAT_WIDTH)
+        {
+            SimdFloat x;
+            SimdFloat y;
+            SimdFloat z;
+            gatherLoadTranspose<4>(energyCoordinates_[HBondEnergyAtom::CA].data(), candidates + i, &x, &y, &z);
+            const SimdFloat rCA2 = distance2(donorCA, x, y, z) * nm2ToA2;
+            gatherLoadTranspose<4>(energyCoordinates_[HBondEnergyAtom::O].data(), candidates + i, &x, &y, &z);
+            const SimdFloat rNO2 = distance2(donorN, x, y, z) * nm2ToA2;
+            const SimdFloat rHO2 = distance2(donorH, x, y, z) * nm2ToA2;
+            gatherLoadTranspose<4>(energyCoordinates_[HBondEnergyAtom::C].data(), candidates + i, &x, &y, &z);
+            const SimdFloat rNC2 = distance2(donorN, x, y, z) * nm2ToA2;
+            const SimdFloat rHC2 = distance2(donorH, x, y, z) * nm2ToA2;
+
+            SimdFloat energy = coupling
+                               * (invsqrt(rNO2) + invsqrt(rHC2) - invsqrt(rHO2) - invsqrt(rNC2));
+            const auto tooClose = (rNO2 < minAtom2 || rHC2 < minAtom2 || rHO2 < minAtom2 || rNC2 < minAtom2);
+            energy = blend(energy, minEnergyS, tooClose);
+            energy = selectByMask(energy, rCA2 < maxCA2);
+            store(energies, energy);
+            const std::size_t end = std::min(i + GMX_SIMD_FLOAT_WIDTH, count);
+            for (std::size_t k = i; k < end; ++k)
+            {
+                if (energies[k - i] < 0)
+                {
+                    work->acceptors.push_back(candidates[k]);
+                    work->energies.push_back(energies[k - i]);
+                }
+            }
+        }
+    }
+#endif
+    auto distance = [pbc](const float* xi, const float* xj)
+    {
+        const rvec ri = { xi[XX], xi[YY], xi[ZZ] };
+        const rvec rj = { xj[XX], xj[YY], xj[ZZ] };
+        gmx::RVec  vectorBA = { 0, 0, 0 };
+        if (pbc != nullptr)
+        {
+            pbc_dx(pbc, ri, rj, vectorBA.as_vec());
+        }
+        else
+        {
+            rvec_sub(ri, rj, vectorBA.as_vec());
+        }
+        return static_cast<float>(vectorBA.norm() * gmx::c_nm2A);
+    };
+    // Only take a view of the candidates after they have been padded.
+    ArrayRef<const std::int32_t> acceptors = makeConstArrayRef(work->candidates).subArray(0, count);
+    for (; i < count; ++i)
+    {
+        const std::size_t acceptor   = acceptors[i];
+        const float*      acceptorCA = &energyCoordinates_[HBondEnergyAtom::CA][4 * acceptor];
+        const float*      acceptorC  = &energyCoordinates_[HBondEnergyAtom::C][4 * acceptor];
+        const float*      acceptorO  = &energyCoordinates_[HBondEnergyAtom::O][4 * acceptor];
+        if (distance(donorCA, acceptorCA) < minimalCAdistance_)
+        {
+            const float distanceNO  = distance(donorN, acceptorO);
+            const float distanceNC  = distance(donorN, acceptorC);
+            const float distanceHO  = distance(donorH, acceptorO);
+            const float distanceHC  = distance(donorH, acceptorC);
+            float       HbondEnergy = 0;
+            if ((distanceNO < minimalAtomDistance) || (distanceHC < minimalAtomDistance)
+                || (distanceHO < minimalAtomDistance) || (distanceNC < minimalAtomDistance))
+            {
+                HbondEnergy = minEnergy;
+            }
+            else
+            {
+                HbondEnergy =
+                        kCouplingConstant
+                        * ((1 / distanceNO) + (1 / distanceHC) - (1 / distanceHO) - (1 / distanceNC));
+            }
+            if (HbondEnergy < 0)
+            {
+                work->acceptors.push_back(acceptor);
+                work->energies.push_back(HbondEnergy);
+            }
+        }
+    }
+}
 
 bool SecondaryStructures::hasHBondBetween(std::size_t donor, std::size_t acceptor) const
 {
@@ -819,10 +1208,69 @@ BridgeTypes SecondaryStructures::calculateBridge(std::size_t residueA, std::size
 
 void SecondaryStructures::analyzeBridgesAndStrandsPatterns()
 {
+    // Residues that each residue has an h-bond to as a donor, and as an acceptor.
+    const std::size_t                     residueCount = frameVector_.size();
+    std::vector<std::vector<std::size_t>> acceptorsOf(residueCount);
+    std::vector<std::vector<std::size_t>> donorsOf(residueCount);
+    {
+        std::vector<std::pair<const t_resinfo*, std::size_t>> residuesByInfo;
+        for (std::size_t i = 0; i < residueCount; ++i)
+        {
+            residuesByInfo.emplace_back(frameVector_[i].info_, i);
+        }
+        std::sort(residuesByInfo.begin(), residuesByInfo.end());
+        for (std::size_t donor = 0; donor < residueCount; ++donor)
+        {
+            for (std::size_t k = 0; k < ResInfo::sc_maxDonorsPerResidue; ++k)
+            {
+                const t_resinfo* info = frameVector_[donor].acceptor_[k];
+                if (info == nullptr)
+                {
+                    continue;
+                }
+                auto range = std::equal_range(residuesByInfo.begin(),
+                                              residuesByInfo.end(),
+                                              std::make_pair(info, std::size_t(0)),
+                                              [](const auto& a, const auto& b)
+                                              { return a.first < b.first; });
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (hasHBondBetween(donor, it->second))
+                    {
+                        acceptorsOf[donor].push_back(it->second);
+                        donorsOf[it->second].push_back(donor);
+                    }
+                }
+            }
+        }
+    }
+    std::vector<std::size_t> partners;
     for (std::size_t i = 1; i + 4 < secondaryStructuresStatusVector_.size(); ++i)
     {
-        for (std::size_t j = i + 3; j + 1 < secondaryStructuresStatusVector_.size(); ++j)
+        // calculateBridge(i, j) requires an h-bond from i + 1 to j or j - 1, or from j or j + 1
+        // to i, so only those j need to be checked.
+        partners.clear();
+        for (const std::size_t acceptor : acceptorsOf[i + 1])
         {
+            partners.push_back(acceptor);
+            partners.push_back(acceptor + 1);
+        }
+        for (const std::size_t donor : donorsOf[i])
+        {
+            partners.push_back(donor);
+            if (donor > 0)
+            {
+                partners.push_back(donor - 1);
+            }
+        }
+        std::sort(partners.begin(), partners.end());
+        partners.erase(std::unique(partners.begin(), partners.end()), partners.end());
+        for (const std::size_t j : partners)
+        {
+            if (j < i + 3 || j + 1 >= secondaryStructuresStatusVector_.size())
+            {
+                continue;
+            }
             switch (calculateBridge(i, j))
             {
                 case BridgeTypes::ParallelBridge:
@@ -1075,16 +1523,6 @@ float SecondaryStructures::calculateAtomicDistances(std::size_t       atomA,
     return vectorBA.norm() * gmx::c_nm2A;
 }
 
-float SecondaryStructures::calculateAtomicDistances(rvec              atomA,
-                                                    std::size_t       atomB,
-                                                    const t_trxframe& fr,
-                                                    const t_pbc*      pbc)
-{
-    gmx::RVec vectorBA = { 0, 0, 0 };
-    pbc_dx(pbc, atomA, fr.x[atomB], vectorBA.as_vec());
-    return vectorBA.norm() * gmx::c_nm2A;
-}
-
 float SecondaryStructures::calculateDihedralAngle(int               atomA,
                                                   int               atomB,
                                                   int               atomC,
@@ -1322,112 +1760,6 @@ void SecondaryStructures::calculateBends(const t_trxframe& fr, const t_pbc* pbc)
     }
 }
 
-void SecondaryStructures::calculateHBondEnergy(ResInfo*          donor,
-                                               ResInfo*          acceptor,
-                                               const t_trxframe& fr,
-                                               const t_pbc*      pbc)
-{
-    if (!(donor->isProline_)
-        && (acceptor->hasIndex(BackboneAtomTypes::AtomC) && acceptor->hasIndex(BackboneAtomTypes::AtomO)
-            && donor->hasIndex(BackboneAtomTypes::AtomN) && donor->hasIndex(BackboneAtomTypes::AtomH)))
-    {
-        if (calculateAtomicDistances(donor->getIndex(BackboneAtomTypes::AtomCA),
-                                     acceptor->getIndex(BackboneAtomTypes::AtomCA),
-                                     fr,
-                                     pbc)
-            < minimalCAdistance_)
-        {
-            float distanceHO = 0;
-            float distanceHC = 0;
-            float distanceNO = calculateAtomicDistances(donor->getIndex(BackboneAtomTypes::AtomN),
-                                                        acceptor->getIndex(BackboneAtomTypes::AtomO),
-                                                        fr,
-                                                        pbc);
-            float distanceNC = calculateAtomicDistances(donor->getIndex(BackboneAtomTypes::AtomN),
-                                                        acceptor->getIndex(BackboneAtomTypes::AtomC),
-                                                        fr,
-                                                        pbc);
-            if (hMode_ == HydrogenMode::Dssp)
-            {
-                if (donor->prevResi_ != nullptr && donor->prevResi_->getIndex(BackboneAtomTypes::AtomC)
-                    && donor->prevResi_->getIndex(BackboneAtomTypes::AtomO))
-                {
-                    gmx::RVec atomH  = fr.x[donor->getIndex(BackboneAtomTypes::AtomH)];
-                    gmx::RVec prevCO = fr.x[donor->prevResi_->getIndex(BackboneAtomTypes::AtomC)];
-                    prevCO -= fr.x[donor->prevResi_->getIndex(BackboneAtomTypes::AtomO)];
-                    float prevCODist = calculateAtomicDistances(
-                            donor->prevResi_->getIndex(BackboneAtomTypes::AtomC),
-                            donor->prevResi_->getIndex(BackboneAtomTypes::AtomO),
-                            fr,
-                            pbc);
-                    atomH += prevCO / prevCODist;
-                    distanceHO = calculateAtomicDistances(
-                            atomH, acceptor->getIndex(BackboneAtomTypes::AtomO), fr, pbc);
-                    distanceHC = calculateAtomicDistances(
-                            atomH, acceptor->getIndex(BackboneAtomTypes::AtomC), fr, pbc);
-                }
-                else
-                {
-                    distanceHO = distanceNO;
-                    distanceHC = distanceNC;
-                }
-            }
-            else
-            {
-                distanceHO = calculateAtomicDistances(donor->getIndex(BackboneAtomTypes::AtomH),
-                                                      acceptor->getIndex(BackboneAtomTypes::AtomO),
-                                                      fr,
-                                                      pbc);
-                distanceHC = calculateAtomicDistances(donor->getIndex(BackboneAtomTypes::AtomH),
-                                                      acceptor->getIndex(BackboneAtomTypes::AtomC),
-                                                      fr,
-                                                      pbc);
-            }
-            // Values are taken from original DSSP algorithm, file Secondary.cpp from https://github.com/PDB-REDO/libcifpp/releases/tag/v3.0.0
-            float       HbondEnergy         = 0;
-            const float minEnergy           = -9.9;
-            const float minimalAtomDistance = 0.5;
-            const float kCouplingConstant   = 27.888;
-            if ((distanceNO < minimalAtomDistance) || (distanceHC < minimalAtomDistance)
-                || (distanceHO < minimalAtomDistance) || (distanceNC < minimalAtomDistance))
-            {
-                HbondEnergy = minEnergy;
-            }
-            else
-            {
-                HbondEnergy =
-                        kCouplingConstant
-                        * ((1 / distanceNO) + (1 / distanceHC) - (1 / distanceHO) - (1 / distanceNC));
-            }
-            if (HbondEnergy < donor->acceptorEnergy_[0])
-            {
-                donor->acceptor_[1]       = donor->acceptor_[0];
-                donor->acceptorEnergy_[1] = donor->acceptorEnergy_[0];
-                donor->acceptor_[0]       = acceptor->info_;
-                donor->acceptorEnergy_[0] = HbondEnergy;
-            }
-            else if (HbondEnergy < donor->acceptorEnergy_[1])
-            {
-                donor->acceptor_[1]       = acceptor->info_;
-                donor->acceptorEnergy_[1] = HbondEnergy;
-            }
-
-            if (HbondEnergy < acceptor->donorEnergy_[0])
-            {
-                acceptor->donor_[1]       = acceptor->donor_[0];
-                acceptor->donorEnergy_[1] = acceptor->donorEnergy_[0];
-                acceptor->donor_[0]       = donor->info_;
-                acceptor->donorEnergy_[0] = HbondEnergy;
-            }
-            else if (HbondEnergy < acceptor->donorEnergy_[1])
-            {
-                acceptor->donor_[1]       = donor->info_;
-                acceptor->donorEnergy_[1] = HbondEnergy;
-            }
-        }
-    }
-}
-
 void SecondaryStructures::calculateHBondGeometry(ResInfo*          donor,
                                                  ResInfo*          acceptor,
                                                  const t_trxframe& fr,
@@ -1522,6 +1854,8 @@ private:
     bool searchPolyPro_ = true;
     //! Real value that defines maximum distance from residue to its neighbor residue.
     real cutoff_ = 0.9;
+    //! Number of OpenMP threads for the h-bond energy calculation. Set in initial options.
+    int nthreads_ = 1;
     //! Enum value that defines polyproline helix stretch. Set in initial options.
     PPStretches polyProStretch_ = PPStretches::Default;
     //! Enum value that defines hydrogen bond definition. Set in initial options.
@@ -1575,6 +1909,8 @@ void Dssp::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
         "have a hydrogen bond instead of simply iterating over the residues among themselves.[PAR]"
         "[TT]-cutoff[tt] is a real value that defines maximum distance from residue to its "
         "neighbor residue used in [TT]-nb[tt]. Minimum (and also recommended) value is 0.9.[PAR]"
+        "[TT]-nt[tt] sets the number of OpenMP threads used to compute the hydrogen bond "
+        "energies of the residues with the \"energy\" definition.[PAR]"
         "[TT]-clear[tt] allows you to ignore the analysis of the secondary structure residues "
         "that are missing one or more critical atoms (CA, C, N, O or H). Always use this option "
         "together with [TT]-hmode dssp[tt] for structures that lack hydrogen atoms![PAR]"
@@ -1623,6 +1959,8 @@ void Dssp::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
             "Use GROMACS neighbor-search method"));
     options->addOption(RealOption("cutoff").store(&cutoff_).required().defaultValue(0.9).description(
             "Distance from residue to its neighbor residue in neighbor search. Must be >= 0.9"));
+    options->addOption(IntegerOption("nt").store(&nthreads_).description(
+            "Number of OpenMP threads for the h-bond energies (0: all)"));
     options->addOption(BooleanOption("clear")
                                .store(&clearStructure_)
                                .defaultValue(false)
@@ -1650,6 +1988,7 @@ void Dssp::optionsFinished(TrajectoryAnalysisSettings* /* settings */)
 void Dssp::initAnalysis(const TrajectoryAnalysisSettings& settings, const TopologyInformation& top)
 {
     patternSearch_.analyseTopology(top, sel_, hMode_, clearStructure_);
+    patternSearch_.setThreadCount(nthreads_ > 0 ? nthreads_ : gmx_omp_get_max_threads());
 
     if (patternSearch_.topologyIsIncorrect())
     {
@@ -51,6 +51,7 @@
 #include <filesystem>
 #include <initializer_list>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -61,6 +62,8 @@
 #include "gromacs/analysisdata/analysisdata.h"
 #include "gromacs/analysisdata/modules/histogram.h"
 #include "gromacs/analysisdata/modules/plot.h"
+#include "gromacs/analysisdata/paralleloptions.h"
+#include "gromacs/correlationfunctions/manyautocorrelation.h"
 #include "gromacs/math/units.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/math/vectypes.h"
@@ -142,29 +145,56 @@ struct HbondStorageFrame
 
 /*! \brief
  * Class that stores frame information in storage and, upon request, can return it.
+ *
+ * Hydrogen bonds are only kept separately for each frame if requested;
+ * otherwise, only the set of all different hydrogen bonds is kept, such that
+ * the memory use does not grow with the number of frames.
  */
 class HbondStorage
 {
 public:
+    /*! \brief
+     * Sets whether information needs to be stored separately for each frame.
+     */
+    void setStorePerFrame(bool storePerFrame) { storePerFrame_ = storePerFrame; }
     /*! \brief
      * Function that stores frame information in storage.
      */
     void addData(int frnr, const std::vector<HBond>& data);
     /*! \brief
      * Function that returns frame information from storage.
+     *
+     * Only available if information is stored separately for each frame.
      */
     const std::vector<HbondStorageFrame>& getData() const;
+    /*! \brief
+     * Function that returns all different hydrogen bonds from all frames.
+     *
+     * Only available if information is not stored separately for each frame.
+     */
+    std::vector<HBond> getMergedData() const;
 
 private:
+    //! Whether information is stored separately for each frame.
+    bool storePerFrame_ = false;
     /*! \brief
      * Vector that contains information from different frames.
      */
     std::vector<HbondStorageFrame> data_;
+    //! Set of all different hydrogen bonds from all frames.
+    std::set<HBond> mergedData_;
 };
 
 void HbondStorage::addData(int frnr, const std::vector<HBond>& data)
 {
-    data_.emplace_back(frnr, data);
+    if (storePerFrame_)
+    {
+        data_.emplace_back(frnr, data);
+    }
+    else
+    {
+        mergedData_.insert(data.begin(), data.end());
+    }
 }
 
 const std::vector<HbondStorageFrame>& HbondStorage::getData() const
@@ -172,6 +202,139 @@ const std::vector<HbondStorageFrame>& HbondStorage::getData() const
     return data_;
 }
 
+std::vector<HBond> HbondStorage::getMergedData() const
+{
+    return std::vector<HBond>(mergedData_.begin(), mergedData_.end());
+}
+
+/*! \brief
+ * Class that tracks the existence of hydrogen bonds over the trajectory.
+ *
+ * For each hydrogen bond, the frames where it exists are stored as
+ * run-length encoded intervals, so the memory use is proportional to the
+ * number of times hydrogen bonds form and break instead of the number of
+ * hydrogen bonds times the number of frames.
+ */
+class HbondExistenceStorage
+{
+public:
+    /*! \brief
+     * Adds the hydrogen bonds that exist in the next frame.
+     *
+     * \param[in] hbonds  Sorted hydrogen bonds without duplicates.
+     */
+    void addFrame(const std::vector<HBond>& hbonds);
+    //! Returns the number of frames added.
+    int frameCount() const { return frameCount_; }
+    /*! \brief
+     * Returns the number of uninterrupted existence periods for each length.
+     *
+     * Element \p i of the returned vector is the number of periods of
+     * \p i frames.
+     */
+    std::vector<int> lifetimeHistogram() const;
+    /*! \brief
+     * Computes the normalized hydrogen bond existence autocorrelation.
+     *
+     * \returns  Autocorrelation for lags from zero to half the number of
+     *     frames, averaged over all hydrogen bonds.
+     *
+     * The existence function of a limited number of hydrogen bonds at a
+     * time is expanded and correlated using FFT.
+     */
+    std::vector<real> autocorrelation() const;
+
+private:
+    //! Uninterrupted period of frames where a hydrogen bond exists.
+    struct Run
+    {
+        //! First frame of the period.
+        int start;
+        //! Number of frames in the period.
+        int length;
+    };
+
+    //! Existence periods for each hydrogen bond.
+    std::map<HBond, std::vector<Run>> runs_;
+    //! Number of frames added.
+    int frameCount_ = 0;
+};
+
+void HbondExistenceStorage::addFrame(const std::vector<HBond>& hbonds)
+{
+    for (const HBond& hbond : hbonds)
+    {
+        std::vector<Run>& runs = runs_[hbond];
+        if (!runs.empty() && runs.back().start + runs.back().length == frameCount_)
+        {
+            ++runs.back().length;
+        }
+        else
+        {
+            runs.push_back({ frameCount_, 1 });
+        }
+    }
+    ++frameCount_;
+}
+
+std::vector<int> HbondExistenceStorage::lifetimeHistogram() const
+{
+    std::vector<int> histogram(frameCount_ + 1, 0);
+    for (const auto& hbondRuns : runs_)
+    {
+        for (const Run& run : hbondRuns.second)
+        {
+            ++histogram[run.length];
+        }
+    }
+    return histogram;
+}
+
+std::vector<real> HbondExistenceStorage::autocorrelation() const
+{
+    //! Number of hydrogen bonds to correlate at a time.
+    const std::size_t c_batchSize = 32;
+
+    const int           lagCount = frameCount_ / 2 + 1;
+    std::vector<double> sums(lagCount, 0.0);
+    if (frameCount_ == 0)
+    {
+        return std::vector<real>(sums.begin(), sums.end());
+    }
+    std::vector<std::vector<real>> existence;
+    auto                           hbondRuns = runs_.begin();
+    while (hbondRuns != runs_.end())
+    {
+        existence.clear();
+        for (; hbondRuns != runs_.end() && existence.size() < c_batchSize; ++hbondRuns)
+        {
+            existence.emplace_back(frameCount_, 0.0_real);
+            for (const Run& run : hbondRuns->second)
+            {
+                std::fill_n(existence.back().begin() + run.start, run.length, 1.0_real);
+            }
+        }
+        many_auto_correl(&existence);
+        for (const auto& correlation : existence)
+        {
+            for (int lag = 0; lag < lagCount; ++lag)
+            {
+                sums[lag] += correlation[lag];
+            }
+        }
+    }
+    std::vector<real> result(lagCount, 0.0_real);
+    if (sums[0] > 0)
+    {
+        const double normalization = frameCount_ / sums[0];
+        for (int lag = 0; lag < lagCount; ++lag)
+        {
+            result[lag] = normalization * sums[lag] / (frameCount_ - lag);
+        }
+    }
+    return result;
+}
+
 struct t_acceptor
 {
     t_acceptor(int atomIndex) : ai(atomIndex) {}
@@ -256,14 +419,17 @@ private:
                                     const std::vector<int>*    selection);
     static void        linkDA(t_info* selectionTool);
     void               prepareForAnalysis(const TrajectoryAnalysisSettings& settings);
-    std::vector<HBond> prepareFrameData(const std::vector<HbondStorageFrame>& data) const;
     std::vector<HBond> prepareFrameData(const std::vector<HBond>& data) const;
+    void               writeLifetimes() const;
+    void               writeAutocorrelation() const;
     Selection          refSelection_, targetSelection_;
     std::string        fnmHbondOut_ = "hbond";
     std::string        fnmHbnumOut_;
     std::string        fnmHbdistOut_;
     std::string        fnmHbangOut_;
     std::string        fnmHbdanOut_;
+    std::string        fnmHblifeOut_;
+    std::string        fnmHbacOut_;
     t_info             refInfo_, targetInfo_;
     bool               isTwoDiffGroups_  = false;
     bool               acceptN_          = true;
@@ -280,6 +446,15 @@ private:
     AnalysisData                             dan_;
     AnalysisDataSimpleHistogramModulePointer histogramModuleDist_;
     AnalysisDataSimpleHistogramModulePointer histogramModuleAng_;
+
+    //! Existence of hydrogen bonds, only tracked for lifetime and autocorrelation output.
+    HbondExistenceStorage    existence_;
+    //! Time of the first frame.
+    real                     firstTime_ = 0;
+    //! Time between frames.
+    real                     timeStep_  = 0;
+    //! Plot settings for the output written after the analysis.
+    AnalysisDataPlotSettings plotSettings_;
 };
 
 Hbond::Hbond() :
@@ -328,7 +503,14 @@ void Hbond::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings*
         "[TT]-ang[tt] allows you to get a plot of the angular distribution of all hydrogen bonds "
         "at the output.[PAR]"
         "[TT]-dan[tt] allows you to get a plot of the number of analyzed donors and acceptors for "
-        "each frame at the output.[PAR]",
+        "each frame at the output.[PAR]"
+        "[TT]-life[tt] allows you to get a plot of the distribution of uninterrupted hydrogen "
+        "bond lifetimes, P(t), and of t P(t), whose integral is printed as the average lifetime. "
+        "[TT]-ac[tt] allows you to get a plot of the autocorrelation of the existence of the "
+        "hydrogen bonds, averaged over all hydrogen bonds and normalized to one at zero lag. "
+        "Both assume a constant time step between frames. For these, the frames where each "
+        "hydrogen bond exists are stored as uninterrupted intervals, so the memory use does "
+        "not grow with the number of frames the hydrogen bonds exist or are absent for.[PAR]",
         "[PAR]",
         "Note that this is a new implementation of the hbond utility added in",
         "GROMACS 2024. If you need the old one, use [TT]gmx hbond-legacy[tt]."
@@ -369,6 +551,18 @@ void Hbond::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings*
                     .store(&fnmHbdanOut_)
                     .defaultBasename("hbdan")
                     .description("Number of donors and acceptors analyzed for each frame."));
+    options->addOption(FileNameOption("life")
+                               .filetype(OptionFileType::Plot)
+                               .outputFile()
+                               .store(&fnmHblifeOut_)
+                               .defaultBasename("hblife")
+                               .description("Distribution of uninterrupted hydrogen bond lifetimes."));
+    options->addOption(FileNameOption("ac")
+                               .filetype(OptionFileType::Plot)
+                               .outputFile()
+                               .store(&fnmHbacOut_)
+                               .defaultBasename("hbac")
+                               .description("Autocorrelation of hydrogen bond existence."));
     options->addOption(SelectionOption("r")
                                .store(&refSelection_)
                                .required()
@@ -598,6 +792,8 @@ void Hbond::linkDA(t_info* selectionTool)
 
 void Hbond::prepareForAnalysis(const TrajectoryAnalysisSettings& settings)
 {
+    plotSettings_ = settings.plotSettings();
+    storage_.setStorePerFrame(perFrame_);
     if (!fnmHbnumOut_.empty())
     {
         hbnum_.setColumnCount(0, 1);
@@ -847,6 +1043,19 @@ void Hbond::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryA
     }
     storage_.addData(frnr, daMap);
 
+    if (!fnmHblifeOut_.empty() || !fnmHbacOut_.empty())
+    {
+        if (existence_.frameCount() == 0)
+        {
+            firstTime_ = fr.time;
+        }
+        else if (existence_.frameCount() == 1)
+        {
+            timeStep_ = fr.time - firstTime_;
+        }
+        existence_.addFrame(prepareFrameData(daMap));
+    }
+
     if (!fnmHbnumOut_.empty())
     {
 
@@ -887,44 +1096,6 @@ void Hbond::finishAnalysis(int /*nframes*/)
     please_cite(stdout, "Gorelov2024b");
 }
 
-std::vector<HBond> Hbond::prepareFrameData(const std::vector<HbondStorageFrame>& data) const
-{
-    std::vector<HBond> temp;
-    for (const auto& i : data)
-    {
-        for (const auto& j : i.hbondData_)
-        {
-            if (!isTwoDiffGroups_ && mergeHydrogens_ && j.acceptorIsAlsoDonor && j.acceptor < j.donor)
-            {
-                temp.emplace_back(!j);
-            }
-            else
-            {
-                temp.emplace_back(j);
-            }
-        }
-    }
-    std::sort(temp.begin(), temp.end());
-    temp.erase(std::unique(temp.begin(), temp.end()), temp.end());
-    if (isTwoDiffGroups_ && mergeHydrogens_)
-    {
-        printf("Merging hbonds with Acceptor and Donor swapped\n");
-        for (std::vector<HBond>::iterator i = temp.begin(); i != temp.end();)
-        {
-            auto find = std::equal_range(i, temp.end(), !(*i));
-            if (find.first != find.second)
-            {
-                i = temp.erase(find.first, find.second);
-            }
-            else
-            {
-                ++i;
-            }
-        }
-    }
-    return temp;
-}
-
 std::vector<HBond> Hbond::prepareFrameData(const std::vector<HBond>& data) const
 {
     std::vector<HBond> temp;
@@ -959,12 +1130,83 @@ std::vector<HBond> Hbond::prepareFrameData(const std::vector<HBond>& data) const
     return temp;
 }
 
+void Hbond::writeLifetimes() const
+{
+    const std::vector<int> histogram = existence_.lifetimeHistogram();
+    int                    maxLength = histogram.size() - 1;
+    while (maxLength > 0 && histogram[maxLength] == 0)
+    {
+        --maxLength;
+    }
+    double sum = 0;
+    for (int length = 1; length <= maxLength; ++length)
+    {
+        sum += histogram[length];
+    }
+    sum *= timeStep_;
+
+    AnalysisData                  lifetimeData;
+    AnalysisDataPlotModulePointer plotm(new AnalysisDataPlotModule(plotSettings_));
+    plotm->setFileName(fnmHblifeOut_);
+    plotm->setTitle("Uninterrupted hydrogen bond lifetime");
+    plotm->setXAxisIsTime();
+    plotm->setYLabel("()");
+    plotm->appendLegend("p(t)");
+    plotm->appendLegend("t p(t)");
+    plotm->setYFormat(10, 3, 'e');
+    lifetimeData.addModule(plotm);
+    lifetimeData.setColumnCount(0, 2);
+    AnalysisDataHandle dh       = lifetimeData.startData({});
+    double             integral = 0;
+    for (int length = 1; length <= maxLength; ++length)
+    {
+        const real t           = (length - 0.5) * timeStep_;
+        const real probability = (sum > 0 ? histogram[length] / sum : 0);
+        dh.startFrame(length - 1, t);
+        dh.setPoint(0, probability);
+        dh.setPoint(1, t * probability);
+        dh.finishFrame();
+        integral += t * probability;
+    }
+    dh.finishData();
+    printf("Average uninterrupted hydrogen bond lifetime = %.2f ps\n", integral * timeStep_);
+}
+
+void Hbond::writeAutocorrelation() const
+{
+    const std::vector<real> correlation = existence_.autocorrelation();
+
+    AnalysisData                  correlationData;
+    AnalysisDataPlotModulePointer plotm(new AnalysisDataPlotModule(plotSettings_));
+    plotm->setFileName(fnmHbacOut_);
+    plotm->setTitle("Hydrogen bond existence autocorrelation");
+    plotm->setXAxisIsTime();
+    plotm->setYLabel("C(t)");
+    plotm->setYFormat(10, 5);
+    correlationData.addModule(plotm);
+    correlationData.setColumnCount(0, 1);
+    AnalysisDataHandle dh = correlationData.startData({});
+    for (std::size_t lag = 0; lag < correlation.size(); ++lag)
+    {
+        dh.startFrame(lag, lag * timeStep_);
+        dh.setPoint(0, correlation[lag]);
+        dh.finishFrame();
+    }
+    dh.finishData();
+}
+
 void Hbond::writeOutput()
 {
-    std::vector<HbondStorageFrame> dataOut;
-    FILE*                          fp;
-    fp      = gmx_ffopen(fnmHbondOut_, "w");
-    dataOut = storage_.getData();
+    if (!fnmHblifeOut_.empty())
+    {
+        writeLifetimes();
+    }
+    if (!fnmHbacOut_.empty())
+    {
+        writeAutocorrelation();
+    }
+
+    FILE* fp = gmx_ffopen(fnmHbondOut_, "w");
     for (const auto& selGroup : { refInfo_, targetInfo_ })
     {
         // Print Selection Indices
@@ -1012,7 +1254,7 @@ void Hbond::writeOutput()
         {
             printf("Merging hbonds with Acceptor and Donor swapped\n");
         }
-        for (const auto& i : dataOut)
+        for (const auto& i : storage_.getData())
         {
             std::vector<HBond> tempFrameData = prepareFrameData(i.hbondData_);
             fprintf(fp, "[ hbonds_%s_frame_%i ]", selects.c_str(), i.frameNumber_);
@@ -1032,7 +1274,11 @@ void Hbond::writeOutput()
     }
     else
     {
-        std::vector<HBond> mergedFrameData = prepareFrameData(dataOut);
+        if (isTwoDiffGroups_ && mergeHydrogens_)
+        {
+            printf("Merging hbonds with Acceptor and Donor swapped\n");
+        }
+        std::vector<HBond> mergedFrameData = prepareFrameData(storage_.getMergedData());
         fprintf(fp, "[ hbonds_%s ]", selects.c_str());
         if (mergeHydrogens_)
         {
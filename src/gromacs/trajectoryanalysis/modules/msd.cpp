@@ -60,6 +60,7 @@
 #include "gromacs/analysisdata/modules/average.h"
 #include "gromacs/analysisdata/modules/plot.h"
 #include "gromacs/analysisdata/paralleloptions.h"
+#include "gromacs/fft/fft.h"
 #include "gromacs/fileio/oenv.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/math/functions.h"
@@ -78,6 +79,7 @@
 #include "gromacs/trajectoryanalysis/topologyinformation.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/classhelpers.h"
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/real.h"
@@ -107,35 +109,25 @@ constexpr double c_1DdiffusionDimensionFactor = 2.0;
  * and emit tau-averaged results once data is finished collecting. Displacements at each observed
  * time difference (tau) are recorded from the trajectory. Because it is not known in advance which
  * time differences will be observed from the trajectory, this data structure is built adaptively.
- * New columns corresponding to observed time differences are added as needed, and additional
- * observations at formerly observed time differences are added to those columns. Separate time lags
- * will likely have differing total data points.
- *
- * Data columns per tau are accessed via operator[], which always guarantees
- * a column is initialized and returns an MsdColumProxy to the column that can push data.
+ * Only the running sum and the number of data points are kept per tau, so the memory use does
+ * not grow with the number of time origins. Separate time lags will likely have differing total
+ * data points.
  */
 class MsdData
 {
 public:
-    //! Proxy to a MsdData tau column vector. Supports only push_back.
-    class MsdColumnProxy
-    {
-    public:
-        MsdColumnProxy(std::vector<double>* column) : column_(column) {}
-
-        void push_back(double value) { column_->push_back(value); }
-
-    private:
-        std::vector<double>* column_;
-    };
-    //! Returns a proxy to the column for the given tau index. Guarantees that the column is initialized.
-    MsdColumnProxy operator[](size_t index)
+    //! Adds a single MSD data point for the given tau index.
+    void addPoint(size_t index, double value) { addPoints(index, value, 1); }
+    //! Adds \p count MSD data points with sum \p sum for the given tau index.
+    void addPoints(size_t index, double sum, int64_t count)
     {
-        if (msds_.size() <= index)
+        if (sums_.size() <= index)
         {
-            msds_.resize(index + 1);
+            sums_.resize(index + 1, 0.0);
+            counts_.resize(index + 1, 0);
         }
-        return MsdColumnProxy(&msds_[index]);
+        sums_[index] += sum;
+        counts_[index] += count;
     }
     /*! \brief Compute per-tau MSDs averaged over all added points.
      *
@@ -147,24 +139,20 @@ public:
     [[nodiscard]] std::vector<real> averageMsds() const;
 
 private:
-    //! Results - first indexed by tau, then data points
-    std::vector<std::vector<double>> msds_;
+    //! Sum of the data points, indexed by tau
+    std::vector<double> sums_;
+    //! Number of data points, indexed by tau
+    std::vector<int64_t> counts_;
 };
 
 
 std::vector<real> MsdData::averageMsds() const
 {
     std::vector<real> msdSums;
-    msdSums.reserve(msds_.size());
-    for (gmx::ArrayRef<const double> msdValues : msds_)
+    msdSums.reserve(sums_.size());
+    for (size_t i = 0; i < sums_.size(); i++)
     {
-        if (msdValues.empty())
-        {
-            msdSums.push_back(0.0);
-            continue;
-        }
-        msdSums.push_back(std::accumulate(msdValues.begin(), msdValues.end(), 0.0, std::plus<>())
-                          / msdValues.size());
+        msdSums.push_back(counts_[i] > 0 ? sums_[i] / counts_[i] : 0.0);
     }
     return msdSums;
 }
@@ -249,6 +237,300 @@ enum class TwoDimDiffType : int
     Count,
 };
 
+//! Describes the algorithm used to compute MSDs.
+enum class MsdMethod : int
+{
+    Direct = 0,
+    Fft,
+    Log,
+    Count,
+};
+
+/*! \brief Computes sums of squared displacements over time origins using FFTs.
+ *
+ * For particle coordinates x_k in frames k = 0..N-1 and time origin weights w_k, which are 1 for
+ * restart frames and 0 otherwise, the sum over origins of the squared displacements at a lag of
+ * m frames is sum_k w_k (x_{k+m}^2 + x_k^2 - 2 x_k x_{k+m}). The first and last terms are
+ * correlations, which are computed for all lags at once with FFTs, and the middle term is a
+ * cumulative sum. This takes O(N log N) instead of O(N^2) operations per particle and gives the
+ * same results as comparing all frames against all restart frames. Coordinates are shifted by
+ * their average over the trajectory to reduce round-off errors.
+ */
+class MsdFftCalculator
+{
+public:
+    /*! \brief Sets up the FFTs for the given time origins.
+     *
+     * \param[in] isRestart  Whether each frame is a time origin
+     * \param[in] numLags    Number of lags to compute, should not be larger than the frame count
+     * \param[in] dimensions Which dimensions contribute to the MSD
+     */
+    MsdFftCalculator(const std::vector<bool>& isRestart,
+                     int                      numLags,
+                     const BasicVector<bool>& dimensions);
+    ~MsdFftCalculator();
+    GMX_DISALLOW_COPY_AND_ASSIGN(MsdFftCalculator);
+
+    /*! \brief Returns the squared displacements summed over origins and particles per lag.
+     *
+     * \param[in] frames         Coordinates, indexed by frame then particle
+     * \param[in] beginParticle  First particle to include
+     * \param[in] endParticle    End of the range of particles to include
+     */
+    std::vector<double> displacementSums(const std::vector<std::vector<RVec>>& frames,
+                                         int                                   beginParticle,
+                                         int                                   endParticle);
+    //! Returns the number of time origins that contribute to each lag.
+    ArrayRef<const int64_t> originCounts() const { return originCounts_; }
+
+private:
+    //! Stores the transform of the zero-padded \p values in \p transform.
+    void transform(ArrayRef<const double> values, std::vector<t_complex>* transform);
+
+    //! Number of frames
+    int numFrames_;
+    //! Number of lags to compute
+    int numLags_;
+    //! Which dimensions contribute to the MSD
+    BasicVector<bool> dimensions_;
+    //! Whether all frames are time origins
+    bool allFramesAreOrigins_;
+    //! Size of the FFTs, large enough to avoid periodic images for all lags
+    int fftSize_;
+    //! FFT setup
+    gmx_fft_t fft_ = nullptr;
+    //! Time origin weights per frame
+    std::vector<double> weights_;
+    //! Number of origins per lag
+    std::vector<int64_t> originCounts_;
+    //! Transform of the weights
+    std::vector<t_complex> weightTransform_;
+    //! Work buffers for real space data
+    std::vector<real>   realBuffer_;
+    std::vector<double> values_;
+    std::vector<double> weightedValues_;
+    std::vector<double> squaredValues_;
+    //! Work buffers for transforms
+    std::vector<t_complex> valueTransform_;
+    std::vector<t_complex> weightedValueTransform_;
+    //! Accumulated correlation in reciprocal space, real and imaginary parts
+    std::vector<double> correlationRe_;
+    std::vector<double> correlationIm_;
+};
+
+MsdFftCalculator::MsdFftCalculator(const std::vector<bool>& isRestart,
+                                   const int                numLags,
+                                   const BasicVector<bool>& dimensions) :
+    numFrames_(isRestart.size()),
+    numLags_(numLags),
+    dimensions_(dimensions),
+    allFramesAreOrigins_(std::all_of(isRestart.begin(), isRestart.end(), [](bool b) { return b; })),
+    fftSize_(1)
+{
+    GMX_RELEASE_ASSERT(numLags_ <= numFrames_, "Can not compute more lags than there are frames");
+    while (fftSize_ < numFrames_ + numLags_ - 1)
+    {
+        fftSize_ *= 2;
+    }
+    // Real to complex transforms need an even size.
+    fftSize_ = std::max(fftSize_, 2);
+    if (gmx_fft_init_1d_real(&fft_, fftSize_, GMX_FFT_FLAG_NONE) != 0)
+    {
+        GMX_THROW(InternalError("Could not set up the FFT for the MSD calculation"));
+    }
+
+    weights_.resize(numFrames_);
+    std::transform(isRestart.begin(), isRestart.end(), weights_.begin(), [](bool b) {
+        return b ? 1.0 : 0.0;
+    });
+    originCounts_.resize(numLags_);
+    int64_t count = 0;
+    for (int frame = 0; frame < numFrames_; frame++)
+    {
+        // Origins at frame k contribute to lags up to numFrames_ - 1 - k
+        count += isRestart[frame] ? 1 : 0;
+        if (numFrames_ - 1 - frame < numLags_)
+        {
+            originCounts_[numFrames_ - 1 - frame] = count;
+        }
+    }
+
+    const int numComplex = fftSize_ / 2 + 1;
+    realBuffer_.resize(fftSize_);
+    weightTransform_.resize(numComplex);
+    valueTransform_.resize(numComplex);
+    weightedValueTransform_.resize(numComplex);
+    correlationRe_.resize(numComplex);
+    correlationIm_.resize(numComplex);
+    values_.resize(numFrames_);
+    weightedValues_.resize(numFrames_);
+    squaredValues_.resize(numFrames_);
+    transform(weights_, &weightTransform_);
+}
+
+MsdFftCalculator::~MsdFftCalculator()
+{
+    gmx_fft_destroy(fft_);
+}
+
+void MsdFftCalculator::transform(ArrayRef<const double> values, std::vector<t_complex>* transform)
+{
+    std::copy(values.begin(), values.end(), realBuffer_.begin());
+    std::fill(realBuffer_.begin() + values.size(), realBuffer_.end(), 0.0_real);
+    if (gmx_fft_1d_real(fft_, GMX_FFT_REAL_TO_COMPLEX, realBuffer_.data(), transform->data()) != 0)
+    {
+        GMX_THROW(InternalError("FFT failed in the MSD calculation"));
+    }
+}
+
+std::vector<double> MsdFftCalculator::displacementSums(const std::vector<std::vector<RVec>>& frames,
+                                                       const int beginParticle,
+                                                       const int endParticle)
+{
+    std::fill(squaredValues_.begin(), squaredValues_.end(), 0.0);
+    std::fill(correlationRe_.begin(), correlationRe_.end(), 0.0);
+    std::fill(correlationIm_.begin(), correlationIm_.end(), 0.0);
+    for (int particle = beginParticle; particle < endParticle; particle++)
+    {
+        for (int dim = 0; dim < DIM; dim++)
+        {
+            if (!dimensions_[dim])
+            {
+                continue;
+            }
+            double average = 0;
+            for (int frame = 0; frame < numFrames_; frame++)
+            {
+                average += frames[frame][particle][dim];
+            }
+            average /= numFrames_;
+            for (int frame = 0; frame < numFrames_; frame++)
+            {
+                values_[frame]         = frames[frame][particle][dim] - average;
+                weightedValues_[frame] = weights_[frame] * values_[frame];
+                squaredValues_[frame] += values_[frame] * values_[frame];
+            }
+            // Accumulate -2 sum_k w_k x_k x_{k+m} as conj(F(w x)) F(x)
+            transform(values_, &valueTransform_);
+            if (!allFramesAreOrigins_)
+            {
+                transform(weightedValues_, &weightedValueTransform_);
+            }
+            const std::vector<t_complex>& weighted =
+                    allFramesAreOrigins_ ? valueTransform_ : weightedValueTransform_;
+            for (size_t i = 0; i < valueTransform_.size(); i++)
+            {
+                correlationRe_[i] -= 2.0
+                                     * (weighted[i].re * valueTransform_[i].re
+                                        + weighted[i].im * valueTransform_[i].im);
+                correlationIm_[i] -= 2.0
+                                     * (weighted[i].re * valueTransform_[i].im
+                                        - weighted[i].im * valueTransform_[i].re);
+            }
+        }
+    }
+    // Accumulate sum_k w_k x_{k+m}^2 as conj(F(w)) F(x^2)
+    transform(squaredValues_, &valueTransform_);
+    for (size_t i = 0; i < valueTransform_.size(); i++)
+    {
+        correlationRe_[i] += weightTransform_[i].re * valueTransform_[i].re
+                             + weightTransform_[i].im * valueTransform_[i].im;
+        correlationIm_[i] += weightTransform_[i].re * valueTransform_[i].im
+                             - weightTransform_[i].im * valueTransform_[i].re;
+    }
+    for (size_t i = 0; i < valueTransform_.size(); i++)
+    {
+        valueTransform_[i].re = correlationRe_[i];
+        valueTransform_[i].im = correlationIm_[i];
+    }
+    if (gmx_fft_1d_real(fft_, GMX_FFT_COMPLEX_TO_REAL, valueTransform_.data(), realBuffer_.data())
+        != 0)
+    {
+        GMX_THROW(InternalError("FFT failed in the MSD calculation"));
+    }
+
+    // Add sum_k w_k x_k^2 over the origins that have a partner at each lag
+    std::vector<double> sums(numLags_, 0.0);
+    double              originSquaredSum = 0;
+    for (int frame = 0; frame < numFrames_; frame++)
+    {
+        originSquaredSum += weights_[frame] * squaredValues_[frame];
+        const int lag = numFrames_ - 1 - frame;
+        if (lag > 0 && lag < numLags_)
+        {
+            // Round-off can make the result slightly negative for small displacements
+            sums[lag] = std::max(0.0, originSquaredSum + realBuffer_[lag] / fftSize_);
+        }
+    }
+    return sums;
+}
+
+//! Number of lags per level of the log-spaced tau correlator, should be even.
+constexpr int c_logTauPointsPerLevel = 16;
+//! Number of lags added by each level of the log-spaced tau correlator after the first.
+constexpr int c_logTauPointsPerExtraLevel = c_logTauPointsPerLevel / 2;
+
+/*! \brief Stored time origins for one level of the log-spaced tau correlator.
+ *
+ * Level l holds the coordinates of the last c_logTauPointsPerLevel frames with index a multiple
+ * of 2^l and computes the MSDs for lags of j 2^l frames, with j < c_logTauPointsPerLevel. Level 0
+ * covers all lags below c_logTauPointsPerLevel, all other levels the upper half of their lags.
+ * The memory use thus only grows logarithmically with the maximum lag.
+ */
+struct LogTauLevel
+{
+    //! Ring buffer with stored coordinates, indexed by position then particle
+    std::vector<std::vector<RVec>> frames;
+    //! Position in the ring buffer of the next frame
+    int next = 0;
+    //! Number of frames stored so far
+    int64_t numStored = 0;
+
+    //! Returns the coordinates stored \p framesBack frames ago.
+    ArrayRef<const RVec> storedFrame(int framesBack) const
+    {
+        return frames[(next - framesBack + c_logTauPointsPerLevel) % c_logTauPointsPerLevel];
+    }
+    //! Stores coordinates, overwriting the oldest ones when the buffer is full.
+    void store(ArrayRef<const RVec> coords)
+    {
+        if (frames.size() < c_logTauPointsPerLevel)
+        {
+            frames.emplace_back(coords.begin(), coords.end());
+        }
+        else
+        {
+            std::copy(coords.begin(), coords.end(), frames[next].begin());
+        }
+        next = (next + 1) % c_logTauPointsPerLevel;
+        numStored++;
+    }
+};
+
+//! Returns the log-spaced tau index for lag \p point at correlator level \p level.
+size_t logTauIndex(int level, int point)
+{
+    if (level == 0)
+    {
+        return point;
+    }
+    return c_logTauPointsPerLevel + (level - 1) * c_logTauPointsPerExtraLevel + point
+           - c_logTauPointsPerExtraLevel;
+}
+
+//! Returns the lag in frames for log-spaced tau index \p tauIndex.
+int64_t logTauLag(size_t tauIndex)
+{
+    if (tauIndex < c_logTauPointsPerLevel)
+    {
+        return tauIndex;
+    }
+    const int64_t level = 1 + (tauIndex - c_logTauPointsPerLevel) / c_logTauPointsPerExtraLevel;
+    const int64_t point = c_logTauPointsPerExtraLevel
+                          + (tauIndex - c_logTauPointsPerLevel) % c_logTauPointsPerExtraLevel;
+    return point << level;
+}
+
 /*! \brief Removes jumps across periodic boundaries for currentFrame, based on the positions in
  * previousFrame. Updates currentCoords in place.
  */
@@ -390,6 +672,8 @@ struct MsdGroupData
 
     //! Stored coordinates, indexed by frame then atom number.
     std::vector<std::vector<RVec>> frames;
+    //! Stored coordinates for the log-spaced tau correlator, indexed by level.
+    std::vector<LogTauLevel> logTauLevels;
 
     //! MSD result accumulator
     MsdData msds;
@@ -428,6 +712,18 @@ public:
     void writeOutput() override;
 
 private:
+    //! Adds the MSDs between \p coords and \p reference at \p tauIndex to the group and molecules.
+    void addDisplacements(MsdGroupData*        msdData,
+                          size_t               tauIndex,
+                          ArrayRef<const RVec> coords,
+                          ArrayRef<const RVec> reference);
+    //! Adds the MSDs from the stored log-spaced time origins for the current frame.
+    void addLogTauDisplacements(MsdGroupData*        msdData,
+                                int64_t              frameIndex,
+                                ArrayRef<const RVec> coords);
+    //! Computes the MSDs of all groups and molecules from the stored frames using FFTs.
+    void computeFftMsds();
+
     //! Selections for MSD output
     SelectionList selections_;
 
@@ -440,6 +736,10 @@ private:
     //! Method used to calculate MSD - changes based on dimensonality.
     std::function<double(ArrayRef<const RVec>, ArrayRef<const RVec>)> calcMsd_ =
             calcAverageDisplacement<true, true, true>;
+    //! Dimensions that contribute to the MSD.
+    BasicVector<bool> msdDimensions_ = { true, true, true };
+    //! Algorithm used to compute the MSDs, for -method
+    MsdMethod method_ = MsdMethod::Direct;
 
     //! Picoseconds between restarts
     double trestart_ = 10.0;
@@ -528,7 +828,17 @@ void Msd::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
         "sampling, often manifesting as a wobbly line on the MSD plot after a straighter region at",
         "lower time deltas. The [TT]-maxtau[TT] option can be used to cap the maximum time delta",
         "for frame comparison, which may improve performance and can be used to avoid",
-        "out-of-memory issues.[PAR]"
+        "out-of-memory issues.[PAR]",
+        "The algorithm is chosen with [TT]-method[tt]. With [TT]direct[tt], the default,",
+        "frames are compared directly as described above. [TT]fft[tt] gives the same results,",
+        "but computes the displacements for all time deltas at once using fast Fourier",
+        "transforms, which is much faster for long trajectories. This stores all frames",
+        "and requires frames at constant time intervals. [TT]log[tt] uses every frame as",
+        "a time origin and computes the MSD at logarithmically spaced time deltas, with",
+        "16 values below 16 frames and 8 values for each further doubling of the time delta.",
+        "It stores only a number of frames that grows with the logarithm of the maximum",
+        "time delta, so it can be used for trajectories of any length.",
+        "[TT]-trestart[tt] is not used with [TT]log[tt].[PAR]"
     };
     settings->setHelpText(desc);
 
@@ -552,6 +862,13 @@ void Msd::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
                                .store(&twoDimType_)
                                .defaultValue(TwoDimDiffType::Unused));
 
+    EnumerationArray<MsdMethod, const char*> enumMethodNames = { "direct", "fft", "log" };
+    options->addOption(EnumOption<MsdMethod>("method")
+                               .enumValue(enumMethodNames)
+                               .store(&method_)
+                               .defaultValue(MsdMethod::Direct)
+                               .description("Algorithm for computing the MSDs"));
+
     options->addOption(DoubleOption("trestart")
                                .description("Time between restarting points in trajectory (ps)")
                                .defaultValue(10.0)
@@ -619,11 +936,14 @@ void Msd::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolog
     {
         calcMsd_                             = oneDimensionalMsdFunctions[singleDimType_];
         diffusionCoefficientDimensionFactor_ = c_1DdiffusionDimensionFactor;
+        msdDimensions_                       = { false, false, false };
+        msdDimensions_[static_cast<int>(singleDimType_)] = true;
     }
     else if (twoDimType_ != TwoDimDiffType::Unused)
     {
         calcMsd_                             = twoDimensionalMsdFunctions[twoDimType_];
         diffusionCoefficientDimensionFactor_ = c_2DdiffusionDimensionFactor;
+        msdDimensions_[static_cast<int>(twoDimType_)] = false;
     }
 
     // TODO validate that we have mol info and not atom only - and masses, and topology.
@@ -688,18 +1008,18 @@ void Msd::analyzeFrame(int gmx_unused                frameNumber,
     {
         dt_ = time - times_[0];
         // Place conditions so they are only checked once
-        if (*dt_ > trestart_)
+        if (*dt_ > trestart_ && method_ != MsdMethod::Log)
         {
             std::string errorMessage = "-dt cannot be larger than -trestart (default 10 ps).";
             GMX_THROW(InconsistentInputError(errorMessage));
         }
-        if (!bRmod(trestart_, 0, *dt_))
+        if (!bRmod(trestart_, 0, *dt_) && method_ != MsdMethod::Log)
         {
             std::string errorMessage =
                     "-trestart (default 10 ps) must be divisible by -dt for useful results.";
             GMX_THROW(InconsistentInputError(errorMessage));
         }
-        if (*dt_ == trestart_)
+        if (*dt_ == trestart_ && method_ != MsdMethod::Log)
         {
             //\n included below to avoid conflict with other output
             fprintf(stderr,
@@ -707,13 +1027,25 @@ void Msd::analyzeFrame(int gmx_unused                frameNumber,
                     "will not be independent.\n");
         }
     }
+    // The times are rounded to integers, but can still carry rounding errors at large values
+    else if (dt_.has_value() && method_ != MsdMethod::Direct
+             && std::fabs(time - times_.back() - *dt_)
+                        > 1e-6 * *dt_ + 2 * GMX_REAL_EPS * std::fabs(time))
+    {
+        GMX_THROW(InconsistentInputError(formatString(
+                "-method fft and log require a constant time between frames, but frame at time %g "
+                "follows a frame at time %g while the first frames are %g ps apart.",
+                time,
+                times_.back(),
+                *dt_)));
+    }
 
     // Each frame gets an entry in times, but frameTimes only updates if we're at a restart.
     times_.push_back(time);
 
     // Each frame will get a tau between it and frame 0, and all other frame combos should be
-    // covered by this.
-    if (const double tau = time - times_[0]; tau <= maxTau_)
+    // covered by this. The log-spaced taus are set up at the end of the analysis.
+    if (const double tau = time - times_[0]; tau <= maxTau_ && method_ != MsdMethod::Log)
     {
         taus_.push_back(time - times_[0]);
     }
@@ -725,6 +1057,18 @@ void Msd::analyzeFrame(int gmx_unused                frameNumber,
 
         ArrayRef<const RVec> coords = msdData.coordinateManager_.buildCoordinates(sel, pbc);
 
+        if (method_ == MsdMethod::Fft)
+        {
+            // All frames are needed for the correlations computed at the end.
+            msdData.frames.emplace_back(coords.begin(), coords.end());
+            continue;
+        }
+        if (method_ == MsdMethod::Log)
+        {
+            addLogTauDisplacements(&msdData, times_.size() - 1, coords);
+            continue;
+        }
+
         // For each preceding frame, calculate tau and do comparison.
         for (size_t i = firstValidFrame_; i < msdData.frames.size(); i++)
         {
@@ -740,14 +1084,7 @@ void Msd::analyzeFrame(int gmx_unused                frameNumber,
                 continue;
             }
             int64_t tauIndex = gmx::roundToInt64(tau / *dt_);
-            msdData.msds[tauIndex].push_back(calcMsd_(coords, msdData.frames[i]));
-
-            for (size_t molInd = 0; molInd < molecules_.size(); molInd++)
-            {
-                molecules_[molInd].msdData[tauIndex].push_back(
-                        calcMsd_(arrayRefFromArray(&coords[molInd], 1),
-                                 arrayRefFromArray(&msdData.frames[i][molInd], 1)));
-            }
+            addDisplacements(&msdData, tauIndex, coords, msdData.frames[i]);
         }
 
 
@@ -759,6 +1096,119 @@ void Msd::analyzeFrame(int gmx_unused                frameNumber,
     }
 }
 
+void Msd::addDisplacements(MsdGroupData*        msdData,
+                           size_t               tauIndex,
+                           ArrayRef<const RVec> coords,
+                           ArrayRef<const RVec> reference)
+{
+    msdData->msds.addPoint(tauIndex, calcMsd_(coords, reference));
+
+    for (size_t molInd = 0; molInd < molecules_.size(); molInd++)
+    {
+        molecules_[molInd].msdData.addPoint(
+                tauIndex,
+                calcMsd_(arrayRefFromArray(&coords[molInd], 1),
+                         arrayRefFromArray(&reference[molInd], 1)));
+    }
+}
+
+void Msd::addLogTauDisplacements(MsdGroupData*        msdData,
+                                 int64_t              frameIndex,
+                                 ArrayRef<const RVec> coords)
+{
+    std::vector<LogTauLevel>& levels = msdData->logTauLevels;
+    if (levels.empty())
+    {
+        levels.emplace_back();
+    }
+    // Frames are stored after all comparisons, so new levels can copy the frames they need
+    // from the level below.
+    size_t numActiveLevels = 0;
+    for (size_t level = 0; frameIndex % (int64_t(1) << level) == 0; level++)
+    {
+        const int firstPoint = (level == 0) ? 1 : c_logTauPointsPerExtraLevel;
+        if (level == levels.size())
+        {
+            // A level is only needed once its shortest lag is reached. As frame 0 is stored on
+            // all levels, this happens at frame firstPoint * 2^level, when the frames of this
+            // level are still present in the buffer of the level below.
+            const int64_t firstLag = int64_t(firstPoint) << level;
+            if (frameIndex < firstLag || firstLag * dt_.value_or(0) > maxTau_)
+            {
+                break;
+            }
+            const LogTauLevel& lowerLevel = levels[level - 1];
+            LogTauLevel        newLevel;
+            for (int point = c_logTauPointsPerExtraLevel; point > 0; point--)
+            {
+                newLevel.store(lowerLevel.storedFrame(2 * point));
+            }
+            levels.push_back(std::move(newLevel));
+        }
+
+        const LogTauLevel& logTauLevel = levels[level];
+        for (int point = firstPoint;
+             point < c_logTauPointsPerLevel && point <= logTauLevel.numStored;
+             point++)
+        {
+            if ((int64_t(point) << level) * dt_.value_or(0) > maxTau_)
+            {
+                break;
+            }
+            addDisplacements(
+                    msdData, logTauIndex(level, point), coords, logTauLevel.storedFrame(point));
+        }
+        numActiveLevels++;
+    }
+    for (size_t level = 0; level < numActiveLevels; level++)
+    {
+        levels[level].store(coords);
+    }
+}
+
+void Msd::computeFftMsds()
+{
+    const int numFrames = times_.size();
+    const int numLags   = taus_.size();
+
+    std::vector<bool> isRestart(numFrames);
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        isRestart[frame] = bRmod(times_[frame], t0_, trestart_);
+    }
+    MsdFftCalculator              fftCalculator(isRestart, numLags, msdDimensions_);
+    const ArrayRef<const int64_t> originCounts = fftCalculator.originCounts();
+
+    for (MsdGroupData& msdData : groupData_)
+    {
+        const int           numParticles = msdData.frames.empty() ? 0 : msdData.frames[0].size();
+        std::vector<double> groupSums(numLags, 0.0);
+        if (molecules_.empty())
+        {
+            groupSums = fftCalculator.displacementSums(msdData.frames, 0, numParticles);
+        }
+        else
+        {
+            for (int molInd = 0; molInd < numParticles; molInd++)
+            {
+                const std::vector<double> sums =
+                        fftCalculator.displacementSums(msdData.frames, molInd, molInd + 1);
+                for (int lag = 0; lag < numLags; lag++)
+                {
+                    molecules_[molInd].msdData.addPoints(lag, sums[lag], originCounts[lag]);
+                    groupSums[lag] += sums[lag];
+                }
+            }
+        }
+        for (int lag = 0; lag < numLags; lag++)
+        {
+            msdData.msds.addPoints(lag, groupSums[lag] / numParticles, originCounts[lag]);
+        }
+        // The stored frames are no longer needed.
+        msdData.frames = {};
+    }
+}
+
 //! Calculate the tau index for fitting. If userFitTau < 0, uses the default fraction of max tau.
 static size_t calculateFitIndex(const int    userFitTau,
                                 const double defaultTauFraction,
@@ -772,13 +1222,59 @@ static size_t calculateFitIndex(const int    userFitTau,
     return std::min<size_t>(numTaus - 1, gmx::roundToInt(static_cast<double>(userFitTau) / dt));
 }
 
+/*! \brief Calculate the tau index for fitting with non-uniformly spaced taus.
+ *
+ * Returns the index of the tau closest to the requested one. If userFitTau < 0, uses the default
+ * fraction of max tau.
+ */
+static size_t calculateFitIndex(const int              userFitTau,
+                                const double           defaultTauFraction,
+                                ArrayRef<const double> taus)
+{
+    const double fitTau = (userFitTau < 0) ? defaultTauFraction * taus.back() : userFitTau;
+    const auto   upper  = std::lower_bound(taus.begin(), taus.end(), fitTau);
+    if (upper == taus.end())
+    {
+        return taus.size() - 1;
+    }
+    size_t index = std::distance(taus.begin(), upper);
+    if (index > 0 && fitTau - taus[index - 1] < taus[index] - fitTau)
+    {
+        index--;
+    }
+    return index;
+}
+
 
 void Msd::finishAnalysis(int gmx_unused nframes)
 {
     static constexpr double c_defaultStartFitIndexFraction = 0.1;
     static constexpr double c_defaultEndFitIndexFraction   = 0.9;
-    beginFitIndex_ = calculateFitIndex(beginFit_, c_defaultStartFitIndexFraction, taus_.size(), *dt_);
-    endFitIndex_   = calculateFitIndex(endFit_, c_defaultEndFitIndexFraction, taus_.size(), *dt_);
+    if (method_ == MsdMethod::Log)
+    {
+        const int64_t numFrames = times_.size();
+        for (size_t tauIndex = 0; logTauLag(tauIndex) < numFrames
+                                  && logTauLag(tauIndex) * dt_.value_or(0) <= maxTau_;
+             tauIndex++)
+        {
+            taus_.push_back(logTauLag(tauIndex) * dt_.value_or(0));
+        }
+    }
+    else if (method_ == MsdMethod::Fft)
+    {
+        computeFftMsds();
+    }
+    if (method_ == MsdMethod::Log)
+    {
+        beginFitIndex_ = calculateFitIndex(beginFit_, c_defaultStartFitIndexFraction, taus_);
+        endFitIndex_   = calculateFitIndex(endFit_, c_defaultEndFitIndexFraction, taus_);
+    }
+    else
+    {
+        beginFitIndex_ =
+                calculateFitIndex(beginFit_, c_defaultStartFitIndexFraction, taus_.size(), *dt_);
+        endFitIndex_ = calculateFitIndex(endFit_, c_defaultEndFitIndexFraction, taus_.size(), *dt_);
+    }
     const int numTausForFit = 1 + endFitIndex_ - beginFitIndex_;
 
     // These aren't used, except for correlationCoefficient, which is used to estimate error if
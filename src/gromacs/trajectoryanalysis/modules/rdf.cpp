@@ -77,6 +77,7 @@
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/stringutil.h"
@@ -204,6 +205,7 @@ private:
     bool          bNormalizationSet_;
     bool          bXY_;
     bool          bExclusions_;
+    int           nthreads_;
 
     // Pre-computed values for faster access during analysis.
     real cut2_;
@@ -225,6 +227,7 @@ Rdf::Rdf() :
     bNormalizationSet_(false),
     bXY_(false),
     bExclusions_(false),
+    nthreads_(1),
     cut2_(0.0),
     rmax2_(0.0),
     surfaceGroupCount_(0)
@@ -288,7 +291,11 @@ void Rdf::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
         "the volume of a bin is not easily computable.",
         "",
         "Option [TT]-cn[tt] produces the cumulative number RDF,",
-        "i.e. the average number of particles within a distance r."
+        "i.e. the average number of particles within a distance r.",
+        "",
+        "Without [TT]-surf[tt], the pair search in each frame can be split",
+        "over OpenMP threads with [TT]-nt[tt]. The results do not depend on",
+        "the number of threads."
     };
 
     settings->setHelpText(desc);
@@ -321,6 +328,8 @@ void Rdf::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
             "Shortest distance (nm) to be considered"));
     options->addOption(
             DoubleOption("rmax").store(&rmax_).description("Largest distance (nm) to calculate"));
+    options->addOption(IntegerOption("nt").store(&nthreads_).description(
+            "Number of OpenMP threads for the pair search (0: all)"));
 
     options->addOption(EnumOption<SurfaceType>("surf")
                                .enumValue(c_surfaceTypeNames)
@@ -474,6 +483,8 @@ public:
      * the RDF from these numbers.
      */
     std::vector<real> surfaceDist2_;
+    //! Pairs found by the neighborhood search (reused between frames).
+    std::vector<AnalysisNeighborhoodPair> pairs_;
 };
 
 TrajectoryAnalysisModuleDataPointer Rdf::startFrames(const AnalysisDataParallelOptions& opt,
@@ -578,9 +589,10 @@ void Rdf::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAna
         {
             // Standard neighborhood search over all pairs within the cutoff
             // for the -surf no case.
-            AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(sel[g]);
-            AnalysisNeighborhoodPair       pair;
-            while (pairSearch.findNextPair(&pair))
+            nbsearch.findAllPairs(sel[g],
+                                  &frameData.pairs_,
+                                  nthreads_ > 0 ? nthreads_ : gmx_omp_get_max_threads());
+            for (const AnalysisNeighborhoodPair& pair : frameData.pairs_)
             {
                 const real r2 = pair.distance2();
                 if (r2 > cut2_)
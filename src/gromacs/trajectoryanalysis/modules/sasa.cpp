@@ -80,6 +80,7 @@
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/real.h"
@@ -390,6 +391,7 @@ private:
 
     double solsize_;
     int    ndots_;
+    int    nthreads_;
     // double                  minarea_;
     double dgsDefault_;
     bool   bIncludeSolute_;
@@ -414,7 +416,13 @@ private:
 };
 
 Sasa::Sasa() :
-    solsize_(0.14), ndots_(24), dgsDefault_(0), bIncludeSolute_(true), mtop_(nullptr), atoms_(nullptr)
+    solsize_(0.14),
+    ndots_(24),
+    nthreads_(1),
+    dgsDefault_(0),
+    bIncludeSolute_(true),
+    mtop_(nullptr),
+    atoms_(nullptr)
 {
     // minarea_ = 0.5;
     registerAnalysisDataset(&area_, "area");
@@ -460,7 +468,11 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
         "to keep in mind that the results for volume and density are very",
         "approximate. For example, in ice Ih, one can easily fit water molecules in the",
         "pores which would yield a volume that is too low, and surface area and density",
-        "that are both too high."
+        "that are both too high.[PAR]",
+
+        "With [TT]-nt[tt], the atoms of each frame are distributed over",
+        "several OpenMP threads for the surface calculation; 0 uses all",
+        "available threads. The results do not depend on the number of threads."
     };
 
     settings->setHelpText(desc);
@@ -508,6 +520,8 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
             DoubleOption("probe").store(&solsize_).description("Radius of the solvent probe (nm)"));
     options->addOption(IntegerOption("ndots").store(&ndots_).description(
             "Number of dots per sphere, more dots means more accuracy"));
+    options->addOption(IntegerOption("nt").store(&nthreads_).description(
+            "Number of OpenMP threads for the surface calculation (0: all)"));
     options->addOption(
             BooleanOption("prot").store(&bIncludeSolute_).description("Output the protein to the Connolly [REF].pdb[ref] file too"));
     options->addOption(
@@ -645,6 +659,7 @@ void Sasa::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolo
 
     calculator_.setDotCount(ndots_);
     calculator_.setRadii(radii_);
+    calculator_.setThreadCount(nthreads_ > 0 ? nthreads_ : gmx_omp_get_max_threads());
 
     // Initialize all the output data objects and initialize the output plotters.
 
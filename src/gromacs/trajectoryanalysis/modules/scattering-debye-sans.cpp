@@ -72,5 +72,10 @@ double SansDebye::getScatteringLength(int i, double gmx_unused q)
     return scatterFactors_[static_cast<int>(isotopes_[i])];
 }
 
+Isotope SansDebye::getIsotope(int i) const
+{
+    return isotopes_[i];
+}
+
 
 } // namespace gmx
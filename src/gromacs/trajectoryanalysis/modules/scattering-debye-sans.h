@@ -65,6 +65,8 @@ public:
     SansDebye(std::vector<Isotope> isotopes);
     //! retrieves scattering length based on atom index
     double getScatteringLength(int i, double q) override;
+    //! retrieves the isotope of an atom
+    Isotope getIsotope(int i) const override;
 
 private:
     //! Vector containing enum of isotopes for each atom in selection
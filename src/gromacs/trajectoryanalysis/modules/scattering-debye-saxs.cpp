@@ -87,5 +87,10 @@ double SaxsDebye::getScatteringLength(int i, double q)
     return scattering;
 }
 
+Isotope SaxsDebye::getIsotope(int i) const
+{
+    return isotopes_[i];
+}
+
 
 } // namespace gmx
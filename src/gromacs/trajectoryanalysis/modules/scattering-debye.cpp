@@ -45,19 +45,244 @@
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 
 #include <algorithm>
 #include <iterator>
 #include <numeric>
+#include <utility>
+#include <vector>
 
+#include "gromacs/math/functions.h"
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
 
 namespace gmx
 {
 
+namespace
+{
+
+//! Number of positions in a block of the cache-blocked direct pair loop
+constexpr int c_debyeBlockSize = 1024;
+
+/*! \internal \brief
+ * Parameters for binning pair distances into type pair histograms
+ */
+struct DebyePairBinning
+{
+    //! PBC information, nullptr if PBC are not used
+    const t_pbc* pbc;
+    //! Whether the distances can be computed with SIMD (no PBC or a rectangular box)
+    bool useSimd;
+    //! Inverse of the histogram bin width
+    real invBinWidth;
+    //! Number of bins in the histogram of one type pair
+    int binCount;
+    //! Number of scattering types
+    int typeCount;
+};
+
+//! Returns the histogram bin of the distance between \p xi and \p xj.
+int pairDistanceBin(const DebyePairBinning& binning, const rvec xi, const rvec xj)
+{
+    RVec dx;
+    if (binning.pbc != nullptr)
+    {
+        pbc_dx(binning.pbc, xi, xj, dx);
+    }
+    else
+    {
+        rvec_sub(xi, xj, dx);
+    }
+    return std::min(static_cast<int>(dx.norm() * binning.invBinWidth), binning.binCount - 1);
+}
+
+#if GMX_SIMD_HAVE_REAL
+/*! \internal \brief
+ * Computes the histogram bins of the distances from one position with SIMD
+ *
+ * When SIMD is used, all pairs are binned with this code, also the pairs that
+ * do not fill a whole SIMD register. The bin of a pair thus does not depend on
+ * the index of the pair in a loop. This is required for the incremental update,
+ * which removes a pair from the histogram of the previous frame in a different
+ * loop than the one that added it. The arithmetic is symmetric in the two
+ * positions, so the order of the positions in the pair does not matter either.
+ */
+class SimdPairDistanceBinner
+{
+public:
+    //! Sets up the binning of the distances from \p xi.
+    SimdPairDistanceBinner(const DebyePairBinning& binning, const rvec xi) :
+        xi_(xi[XX]),
+        yi_(xi[YY]),
+        zi_(xi[ZZ]),
+        invBinWidth_(binning.invBinWidth),
+        maxBin_(binning.binCount - 1),
+        boxX_(0.0_real),
+        boxY_(0.0_real),
+        boxZ_(0.0_real),
+        invBoxX_(0.0_real),
+        invBoxY_(0.0_real),
+        invBoxZ_(0.0_real)
+    {
+        // pbc_dx() does not apply PBC to boxes with a zero diagonal element, e.g., to
+        // structures without box information.
+        const t_pbc* pbc = binning.pbc;
+        if (pbc != nullptr && pbc->pbcType == PbcType::Xyz && pbc->fbox_diag[XX] > 0
+            && pbc->fbox_diag[YY] > 0 && pbc->fbox_diag[ZZ] > 0)
+        {
+            boxX_    = SimdReal(pbc->fbox_diag[XX]);
+            boxY_    = SimdReal(pbc->fbox_diag[YY]);
+            boxZ_    = SimdReal(pbc->fbox_diag[ZZ]);
+            invBoxX_ = SimdReal(1.0_real / pbc->fbox_diag[XX]);
+            invBoxY_ = SimdReal(1.0_real / pbc->fbox_diag[YY]);
+            invBoxZ_ = SimdReal(1.0_real / pbc->fbox_diag[ZZ]);
+        }
+    }
+
+    //! Stores the bins of the distances to the positions \p xj, \p yj, \p zj in \p bins.
+    void storeBins(SimdReal xj, SimdReal yj, SimdReal zj, std::int32_t* bins) const
+    {
+        SimdReal dx = xi_ - xj;
+        SimdReal dy = yi_ - yj;
+        SimdReal dz = zi_ - zj;
+        // With zero inverse box lengths, i.e., without PBC, this leaves dx unchanged.
+        dx                = fnma(boxX_, round(dx * invBoxX_), dx);
+        dy                = fnma(boxY_, round(dy * invBoxY_), dy);
+        dz                = fnma(boxZ_, round(dz * invBoxZ_), dz);
+        const SimdReal r2 = fma(dx, dx, fma(dy, dy, dz * dz));
+        gmx::store(bins, cvttR2I(min(sqrt(r2) * invBinWidth_, maxBin_)));
+    }
+
+    //! Returns the bin of the distance to position \p j in \p positions.
+    int bin(const DebyePositionArrays& positions, int j) const
+    {
+        alignas(GMX_SIMD_ALIGNMENT) std::int32_t bins[GMX_SIMD_REAL_WIDTH];
+        storeBins(SimdReal(positions.x[j]),
+                  SimdReal(positions.y[j]),
+                  SimdReal(positions.z[j]),
+                  bins);
+        return bins[0];
+    }
+
+private:
+    //! Coordinates of the first position of the pairs
+    SimdReal xi_, yi_, zi_;
+    //! Inverse of the bin width
+    SimdReal invBinWidth_;
+    //! Index of the last bin
+    SimdReal maxBin_;
+    //! Box lengths, zero without PBC
+    SimdReal boxX_, boxY_, boxZ_;
+    //! Inverse box lengths, zero without PBC
+    SimdReal invBoxX_, invBoxY_, invBoxZ_;
+};
+#endif
+
+/*! \brief
+ * Adds \p weight to the histogram for each pair of position \p i in \p iPositions
+ * with the positions \p jBegin to \p jEnd in \p jPositions.
+ */
+void binPairs(const DebyePairBinning&    binning,
+              const DebyePositionArrays& iPositions,
+              int                        i,
+              const DebyePositionArrays& jPositions,
+              int                        jBegin,
+              int                        jEnd,
+              double                     weight,
+              double*                    hist)
+{
+    const rvec xi         = { iPositions.x[i], iPositions.y[i], iPositions.z[i] };
+    const int  typeOffset = iPositions.type[i] * binning.typeCount;
+    const int  binCount   = binning.binCount;
+#if GMX_SIMD_HAVE_REAL
+    if (binning.useSimd)
+    {
+        using gmx::load;
+        using gmx::SimdReal;
+        const SimdPairDistanceBinner binner(binning, xi);
+        int                          j = jBegin;
+        // Bin the pairs before the first aligned j one at a time.
+        for (; j < jEnd && j % GMX_SIMD_REAL_WIDTH != 0; ++j)
+        {
+            const int bin = binner.bin(jPositions, j);
+            hist[(typeOffset + jPositions.type[j]) * binCount + bin] += weight;
+        }
+        alignas(GMX_SIMD_ALIGNMENT) std::int32_t bins[GMX_SIMD_REAL_WIDTH];
+        for (; j + GMX_SIMD_REAL_WIDTH <= jEnd; j += GMX_SIMD_REAL_WIDTH)
+        {
+            binner.storeBins(load<SimdReal>(jPositions.x.data() + j),
+                             load<SimdReal>(jPositions.y.data() + j),
+                             load<SimdReal>(jPositions.z.data() + j),
+                             bins);
+            for (int k = 0; k < GMX_SIMD_REAL_WIDTH; ++k)
+            {
+                hist[(typeOffset + jPositions.type[j + k]) * binCount + bins[k]] += weight;
+            }
+        }
+        for (; j < jEnd; ++j)
+        {
+            const int bin = binner.bin(jPositions, j);
+            hist[(typeOffset + jPositions.type[j]) * binCount + bin] += weight;
+        }
+        return;
+    }
+#endif
+    for (int j = jBegin; j < jEnd; ++j)
+    {
+        const rvec xj  = { jPositions.x[j], jPositions.y[j], jPositions.z[j] };
+        const int  bin = pairDistanceBin(binning, xi, xj);
+        hist[(typeOffset + jPositions.type[j]) * binCount + bin] += weight;
+    }
+}
+
+//! Returns whether pair distances in \p pbc can be computed with SIMD.
+bool canUseSimdPairDistances(const t_pbc* pbc)
+{
+    if (pbc == nullptr || pbc->pbcType == PbcType::No)
+    {
+        return true;
+    }
+    return pbc->pbcType == PbcType::Xyz && pbc->box[YY][XX] == 0 && pbc->box[ZZ][XX] == 0
+           && pbc->box[ZZ][YY] == 0;
+}
+
+/*! \brief
+ * Adds the thread-local histograms to \p hist.
+ *
+ * The histogram of thread 0 is \p hist itself.
+ */
+void reduceThreadHistograms(std::vector<double>*                    hist,
+                            const std::vector<std::vector<double>>& threadHists)
+{
+    for (const auto& threadHist : threadHists)
+    {
+        for (size_t i = 0; i < hist->size(); ++i)
+        {
+            (*hist)[i] += threadHist[i];
+        }
+    }
+}
+
+} // namespace
+
+void DebyePositionArrays::resize(int newCount)
+{
+    count = newCount;
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    type.resize(count);
+    atom.resize(count);
+}
+
 void ComputeDebyeScattering::initPairDistHist()
 {
     // Calculate possible max Index
@@ -97,7 +322,7 @@ double ComputeDebyeScattering::getFormFactor(int i, int j, double q)
 
 void ComputeDebyeScattering::computeIntensity()
 {
-    intensity_.resize(qValues_.size());
+    intensity_.assign(qValues_.size(), 0.0);
 
     for (size_t qi = 0; qi < qValues_.size(); ++qi)
     {
@@ -135,31 +360,230 @@ double ComputeDebyeScattering::computeIntensityZeroQ()
     }
 }
 
-void ComputeDebyeScattering::computeDirectPairDistancesHistogram(t_pbc* pbc, Selection sel)
+void ComputeDebyeScattering::setPositions(const Selection& sel)
 {
+    if (isotopeTypes_.empty())
+    {
+        isotopeTypes_.resize(static_cast<int>(Isotope::Count), -1);
+    }
     const int posCount = sel.posCount();
-    for (auto i = 0; i < posCount; ++i)
+    positions_.resize(posCount);
+    for (int i = 0; i < posCount; ++i)
+    {
+        const SelectionPosition& pos  = sel.position(i);
+        const int                atom = pos.atomIndices()[0];
+        int&                     type = isotopeTypes_[static_cast<int>(getIsotope(atom))];
+        if (type < 0)
+        {
+            type = typeAtoms_.size();
+            typeAtoms_.push_back(atom);
+        }
+        positions_.x[i]    = pos.x()[XX];
+        positions_.y[i]    = pos.x()[YY];
+        positions_.z[i]    = pos.x()[ZZ];
+        positions_.type[i] = type;
+        positions_.atom[i] = atom;
+    }
+}
+
+void ComputeDebyeScattering::binAllPairs(const t_pbc* pbc)
+{
+    const int              typeCount = typeAtoms_.size();
+    const DebyePairBinning binning   = { pbc,
+                                         canUseSimdPairDistances(pbc),
+                                         static_cast<real>(1.0 / binWidth_),
+                                         static_cast<int>(maxHIndex_),
+                                         typeCount };
+    const int              posCount  = positions_.count;
+    const int blockCount = (posCount + c_debyeBlockSize - 1) / c_debyeBlockSize;
+    // Pairs of blocks, such that the j positions of a block pair stay in cache
+    // while all i positions in the block are processed.
+    std::vector<std::pair<int, int>> blockPairs;
+    for (int bi = 0; bi < blockCount; ++bi)
+    {
+        for (int bj = bi; bj < blockCount; ++bj)
+        {
+            blockPairs.emplace_back(bi, bj);
+        }
+    }
+    const int nthreads = std::max(1, std::min<int>(threadCount_, blockPairs.size()));
+    std::vector<std::vector<double>> threadHists(nthreads - 1,
+                                                 std::vector<double>(typePairHist_.size(), 0.0));
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+    for (size_t p = 0; p < blockPairs.size(); ++p)
     {
-        const SelectionPosition& pos_i = sel.position(i);
-        for (auto j = i + 1; j < posCount; ++j)
+        try
         {
-            PairDistValue            pairDist{};
-            const SelectionPosition& pos_j = sel.position(j);
-            pairDist.atomI                 = sel.position(i).atomIndices()[0];
-            pairDist.atomJ                 = sel.position(j).atomIndices()[0];
-            RVec distance_ij;
-            if (pbc != nullptr)
+            const int thread = gmx_omp_get_thread_num();
+            double* hist = (thread == 0 ? typePairHist_.data() : threadHists[thread - 1].data());
+            const int iBegin = blockPairs[p].first * c_debyeBlockSize;
+            const int iEnd   = std::min(iBegin + c_debyeBlockSize, posCount);
+            const int jBegin = blockPairs[p].second * c_debyeBlockSize;
+            const int jEnd   = std::min(jBegin + c_debyeBlockSize, posCount);
+            for (int i = iBegin; i < iEnd; ++i)
             {
-                pbc_dx(pbc, pos_i.x(), pos_j.x(), distance_ij);
+                const int jStart = std::max(jBegin, i + 1);
+                binPairs(binning, positions_, i, positions_, jStart, jEnd, 1.0, hist);
             }
-            else
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    reduceThreadHistograms(&typePairHist_, threadHists);
+}
+
+bool ComputeDebyeScattering::updateMovedPairs(const t_pbc* pbc)
+{
+    if (!previousValid_ || previousUsedPbc_ != (pbc != nullptr)
+        || previousPositions_.atom != positions_.atom)
+    {
+        return false;
+    }
+    if (pbc != nullptr)
+    {
+        for (int d = 0; d < DIM; ++d)
+        {
+            for (int e = 0; e < DIM; ++e)
+            {
+                if (pbc->box[d][e] != previousBox_[d][e])
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    std::vector<int> moved;
+    for (int i = 0; i < positions_.count; ++i)
+    {
+        if (positions_.x[i] != previousPositions_.x[i] || positions_.y[i] != previousPositions_.y[i]
+            || positions_.z[i] != previousPositions_.z[i])
+        {
+            moved.push_back(i);
+        }
+    }
+    // Each moved position costs two passes over all positions, so beyond
+    // this a full recomputation is cheaper.
+    if (4 * moved.size() > static_cast<size_t>(positions_.count))
+    {
+        return false;
+    }
+    if (moved.empty())
+    {
+        return true;
+    }
+
+    // The coordinates of positions that did not move are the same in both frames.
+    const int           movedCount = moved.size();
+    DebyePositionArrays unmoved;
+    DebyePositionArrays movedOld;
+    DebyePositionArrays movedNew;
+    unmoved.resize(positions_.count - movedCount);
+    movedOld.resize(movedCount);
+    movedNew.resize(movedCount);
+    auto copyPosition = [](const DebyePositionArrays& from, int i, DebyePositionArrays* to, int k)
+    {
+        to->x[k]    = from.x[i];
+        to->y[k]    = from.y[i];
+        to->z[k]    = from.z[i];
+        to->type[k] = from.type[i];
+        to->atom[k] = from.atom[i];
+    };
+    for (int i = 0, m = 0, u = 0; i < positions_.count; ++i)
+    {
+        if (m < movedCount && moved[m] == i)
+        {
+            copyPosition(previousPositions_, i, &movedOld, m);
+            copyPosition(positions_, i, &movedNew, m);
+            ++m;
+        }
+        else
+        {
+            copyPosition(positions_, i, &unmoved, u);
+            ++u;
+        }
+    }
+
+    const DebyePairBinning binning = { pbc,
+                                       canUseSimdPairDistances(pbc),
+                                       static_cast<real>(1.0 / binWidth_),
+                                       static_cast<int>(maxHIndex_),
+                                       static_cast<int>(typeAtoms_.size()) };
+    const int              nthreads = std::max(1, std::min(threadCount_, movedCount));
+    std::vector<std::vector<double>> threadHists(nthreads - 1,
+                                                 std::vector<double>(typePairHist_.size(), 0.0));
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 16)
+    for (int m = 0; m < movedCount; ++m)
+    {
+        try
+        {
+            const int thread = gmx_omp_get_thread_num();
+            double* hist = (thread == 0 ? typePairHist_.data() : threadHists[thread - 1].data());
+            // Remove the pairs with the old coordinates and add them with the new ones.
+            binPairs(binning, movedOld, m, unmoved, 0, unmoved.count, -1.0, hist);
+            binPairs(binning, movedOld, m, movedOld, m + 1, movedCount, -1.0, hist);
+            binPairs(binning, movedNew, m, unmoved, 0, unmoved.count, 1.0, hist);
+            binPairs(binning, movedNew, m, movedNew, m + 1, movedCount, 1.0, hist);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    reduceThreadHistograms(&typePairHist_, threadHists);
+    return true;
+}
+
+void ComputeDebyeScattering::computeFormFactorHistograms()
+{
+    const int typeCount = typeAtoms_.size();
+    auto      addTypePairs = [&](double q, std::vector<double>* values)
+    {
+        std::fill(values->begin(), values->end(), 0.0);
+        for (int a = 0; a < typeCount; ++a)
+        {
+            for (int b = 0; b < typeCount; ++b)
             {
-                rvec_sub(pos_i.x(), pos_j.x(), distance_ij);
+                const double  formFactor = getFormFactor(typeAtoms_[a], typeAtoms_[b], q);
+                const double* counts     = &typePairHist_[(a * typeCount + b) * maxHIndex_];
+                for (size_t hi = 0; hi < maxHIndex_; ++hi)
+                {
+                    (*values)[hi] += formFactor * counts[hi];
+                }
             }
-            pairDist.distanceIJ = distance_ij.norm();
-            addPairToHist(pairDist);
+        }
+    };
+    if (sfDepenOnQ_)
+    {
+        for (size_t qi = 0; qi < qValues_.size(); ++qi)
+        {
+            addTypePairs(qValues_[qi], &sfQDependDistValues_[qi]);
         }
     }
+    else
+    {
+        addTypePairs(0, &sfDistValues_);
+    }
+}
+
+void ComputeDebyeScattering::computeDirectPairDistancesHistogram(t_pbc* pbc, Selection sel)
+{
+    setPositions(sel);
+    const size_t typeCount = typeAtoms_.size();
+    const size_t histSize  = typeCount * typeCount * maxHIndex_;
+    if (!reuseHistogram_ || typePairHist_.size() != histSize || !updateMovedPairs(pbc))
+    {
+        typePairHist_.assign(histSize, 0.0);
+        binAllPairs(pbc);
+    }
+    if (reuseHistogram_)
+    {
+        std::swap(previousPositions_, positions_);
+        if (pbc != nullptr)
+        {
+            copy_mat(pbc->box, previousBox_);
+        }
+        previousUsedPbc_ = (pbc != nullptr);
+        previousValid_   = true;
+    }
+    computeFormFactorHistograms();
 }
 
 void ComputeDebyeScattering::computeMonteCarloPairDistancesHistogram(t_pbc*    pbc,
@@ -167,41 +591,38 @@ void ComputeDebyeScattering::computeMonteCarloPairDistancesHistogram(t_pbc*    p
                                                                      float     coverage,
                                                                      int       seed)
 {
+    setPositions(sel);
+    const int              typeCount = typeAtoms_.size();
+    const DebyePairBinning binning   = { pbc,
+                                         false,
+                                         static_cast<real>(1.0 / binWidth_),
+                                         static_cast<int>(maxHIndex_),
+                                         typeCount };
+    typePairHist_.assign(typeCount * typeCount * maxHIndex_, 0.0);
+    previousValid_ = false;
+    double* hist   = typePairHist_.data();
+
     const size_t                   posCount = sel.posCount();
     DefaultRandomEngine            rng(seed);
     UniformIntDistribution<size_t> distribution(0, posCount - 1);
     auto numPairs = static_cast<size_t>(coverage * posCount * (posCount - 1) * 0.5);
     for (size_t pair = 0; pair < numPairs; ++pair)
     {
-        PairDistValue pairDist{};
-        size_t        rand_i = distribution(rng);
-        size_t        rand_j = distribution(rng);
+        size_t rand_i = distribution(rng);
+        size_t rand_j = distribution(rng);
         if (rand_i != rand_j)
         {
-            const SelectionPosition& pos_i = sel.position(rand_i);
-            const SelectionPosition& pos_j = sel.position(rand_j);
-            pairDist.atomI                 = sel.position(rand_i).atomIndices()[0];
-            pairDist.atomJ                 = sel.position(rand_j).atomIndices()[0];
-            RVec distance_ij;
-            if (pbc != nullptr)
-            {
-                pbc_dx(pbc, pos_i.x(), pos_j.x(), distance_ij);
-            }
-            else
-            {
-                rvec_sub(pos_i.x(), pos_j.x(), distance_ij);
-            }
-            pairDist.distanceIJ = distance_ij.norm();
-            addPairToHist(pairDist);
+            binPairs(binning, positions_, rand_i, positions_, rand_j, rand_j + 1, 1.0, hist);
         }
     }
+    computeFormFactorHistograms();
 }
 
 void ComputeDebyeScattering::clearHist()
 {
     if (sfDepenOnQ_)
     {
-        for (auto QDList : sfQDependDistValues_)
+        for (auto& QDList : sfQDependDistValues_)
         {
             std::fill(QDList.begin(), QDList.end(), 0);
         }
@@ -212,20 +633,15 @@ void ComputeDebyeScattering::clearHist()
     }
 }
 
-void ComputeDebyeScattering::addPairToHist(PairDistValue pair)
+void ComputeDebyeScattering::setThreadCount(int threadCount)
 {
-    size_t hidx_ = std::floor(pair.distanceIJ / binWidth_);
-    if (sfDepenOnQ_)
-    {
-        for (size_t i = 0; i != qValues_.size(); ++i)
-        {
-            sfQDependDistValues_[i][hidx_] += getFormFactor(pair.atomI, pair.atomJ, qValues_[i]);
-        }
-    }
-    else
-    {
-        sfDistValues_[hidx_] += getFormFactor(pair.atomI, pair.atomJ, 0);
-    }
+    threadCount_ = std::max(1, threadCount);
+}
+
+void ComputeDebyeScattering::setHistogramReuse(bool reuse)
+{
+    reuseHistogram_ = reuse;
+    previousValid_  = false;
 }
 
 void ComputeDebyeScattering::setBinWidth(double binWidth)
@@ -53,6 +53,8 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/real.h"
 
 #include "isotope.h"
 #include "scatteringfactors.h"
@@ -61,16 +63,25 @@ namespace gmx
 {
 
 /*! \internal \brief
- * structure to store pair dist units
+ * Coordinates and scattering types of the positions in a selection, stored
+ * in structure-of-arrays form for binning pair distances with SIMD.
  */
-struct PairDistValue
+struct DebyePositionArrays
 {
-    //! index of atom i
-    std::size_t atomI;
-    //! index of atom j
-    std::size_t atomJ;
-    //! distance between atoms i and j
-    float distanceIJ;
+    //! Resizes all arrays.
+    void resize(int count);
+    //! Number of positions
+    int count = 0;
+    //! x coordinates
+    std::vector<real, AlignedAllocator<real>> x;
+    //! y coordinates
+    std::vector<real, AlignedAllocator<real>> y;
+    //! z coordinates
+    std::vector<real, AlignedAllocator<real>> z;
+    //! Index of the scattering type of each position
+    std::vector<int> type;
+    //! Index of the atom of each position
+    std::vector<int> atom;
 };
 
 /*! \internal \brief
@@ -89,6 +100,9 @@ public:
     //! retrieves scattering length based on atom index
     virtual double getScatteringLength(int i, double q) = 0;
 
+    //! retrieves the isotope of an atom, which determines its scattering length
+    virtual Isotope getIsotope(int i) const = 0;
+
     //! Compute Pair distances for atoms using Direct Method
     void computeDirectPairDistancesHistogram(t_pbc* pbc, Selection sel);
 
@@ -121,6 +135,19 @@ public:
     //! Clear histogram
     void clearHist();
 
+    //! Set number of OpenMP threads used for the direct pair distance histogram
+    void setThreadCount(int threadCount);
+
+    /*! \brief
+     * Set whether the direct histogram is updated incrementally between frames
+     *
+     * When enabled, only the pairs that involve positions whose coordinates
+     * changed since the previous frame are recomputed, as long as the box and
+     * the selected atoms stay the same and at most a quarter of the positions
+     * moved.  The result is identical to a full recomputation.
+     */
+    void setHistogramReuse(bool reuse);
+
 private:
     //! binwidth for P(r) hist
     double binWidth_ = 0.F;
@@ -138,8 +165,40 @@ private:
     std::vector<double> sfDistValues_;
     //! List of sf*distance values in hist in case of SAXS when SF depend on Q
     std::vector<std::vector<double>> sfQDependDistValues_;
-    //! add atom pair for histogram
-    void addPairToHist(PairDistValue pair);
+    //! Number of OpenMP threads for the direct method
+    int threadCount_ = 1;
+    //! Whether to update the direct histogram incrementally between frames
+    bool reuseHistogram_ = false;
+    //! Atom index of one atom of each scattering type, to look up the form factors
+    std::vector<int> typeAtoms_;
+    //! Index of the scattering type of each isotope, -1 if not seen
+    std::vector<int> isotopeTypes_;
+    /*! \brief
+     * Pair distance counts for each pair of scattering types
+     *
+     * Indexed as (typeI * number of types + typeJ) * maxHIndex_ + bin.
+     * Counts are stored as doubles, which are exact for any realistic count.
+     */
+    std::vector<double> typePairHist_;
+    //! Positions of the current frame
+    DebyePositionArrays positions_;
+    //! Positions used for typePairHist_ in the previous frame
+    DebyePositionArrays previousPositions_;
+    //! Box used for typePairHist_
+    matrix previousBox_ = { { 0 } };
+    //! Whether typePairHist_ can be updated incrementally
+    bool previousValid_ = false;
+    //! Whether PBC was used for typePairHist_
+    bool previousUsedPbc_ = false;
+
+    //! Collects the positions and scattering types of the selection
+    void setPositions(const Selection& sel);
+    //! Bins the pairs of all positions into typePairHist_
+    void binAllPairs(const t_pbc* pbc);
+    //! Updates typePairHist_ for the positions that moved, returns false if not possible
+    bool updateMovedPairs(const t_pbc* pbc);
+    //! Computes the form factor weighted histograms from typePairHist_
+    void computeFormFactorHistograms();
 
 protected:
     //! set if structure factor depend on Q value (e.g. for SAXS)
@@ -70,6 +70,7 @@
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/pleasecite.h"
 
 #include "scattering-debye-sans.h"
@@ -116,10 +117,12 @@ private:
     double                                               monteCarloCoverage_;
     double                                               binwidth_;
     int                                                  seed_;
+    int                                                  nthreads_;
     bool                                                 bNormalize_;
     bool                                                 bMonteCarloScattering_;
     bool                                                 bSeedSet_;
     bool                                                 bMonteCarloCoverageSet_;
+    bool                                                 bIncremental_;
     ScatterType                                          scatterEnum_;
     AnalysisData                                         intensity_;
     AnalysisDataAverageModulePointer                     averageModule_;
@@ -135,10 +138,12 @@ Scattering::Scattering() :
     monteCarloCoverage_(0.2),
     binwidth_(0.1),
     seed_(2023),
+    nthreads_(1),
     bNormalize_(true),
     bMonteCarloScattering_(false),
     bSeedSet_(false),
     bMonteCarloCoverageSet_(false),
+    bIncremental_(false),
     scatterEnum_(ScatterType::SANS),
     averageModule_(std::make_unique<AnalysisDataAverageModule>())
 {
@@ -153,6 +158,12 @@ void Scattering::initOptions(IOptionsContainer* options, TrajectoryAnalysisSetti
         "[THISMODULE] calculates SANS and SAXS scattering curves using Debye method.[PAR]",
         "The scattering intensity, I(q), as a function of scattering angle q",
         "with averaging over frames. [PAR]",
+        "With [TT]-nomc[tt], all pairs of positions are binned into a pair distance",
+        "histogram. This can use several OpenMP threads with [TT]-nt[tt]. With",
+        "[TT]-incremental[tt], the histogram of the previous frame is updated by",
+        "only recomputing the pairs of positions that moved, if the box did not",
+        "change and at most a quarter of the positions moved, e.g., when most of",
+        "the system is frozen. This gives the same result as binning all pairs.",
         "[PAR]",
         "Note that this is a new implementation of the SANS/SAXS utilities added in",
         "GROMACS 2024. If you need the old ones,",
@@ -189,6 +200,12 @@ void Scattering::initOptions(IOptionsContainer* options, TrajectoryAnalysisSetti
                                .store(&bMonteCarloScattering_)
                                .defaultValue(true)
                                .description("use Monte Carlo to scattering intensities"));
+    options->addOption(IntegerOption("nt").store(&nthreads_).description(
+            "Number of OpenMP threads for the direct method (0: all)"));
+    options->addOption(BooleanOption("incremental")
+                               .store(&bIncremental_)
+                               .defaultValue(false)
+                               .description("update the direct histogram only for moved positions"));
     options->addOption(EnumOption<ScatterType>("scattering-type")
                                .enumValue(ScatterTypeNames)
                                .store(&scatterEnum_)
@@ -251,6 +268,8 @@ void Scattering::initAnalysis(const TrajectoryAnalysisSettings& settings, const
         }
         computeScattering_[g]->setBinWidth(binwidth_);
         computeScattering_[g]->addQList(qList_);
+        computeScattering_[g]->setThreadCount(nthreads_ > 0 ? nthreads_ : gmx_omp_get_max_threads());
+        computeScattering_[g]->setHistogramReuse(bIncremental_);
     }
 
     if (!fnScattering_.empty())
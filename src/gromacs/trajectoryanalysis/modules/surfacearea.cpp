@@ -36,6 +36,7 @@
 #include "surfacearea.h"
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 
 #include <algorithm>
@@ -46,9 +47,14 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/nbsearch.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 
 using namespace gmx;
@@ -700,11 +706,126 @@ static std::vector<real> make_unsp(int densit, int cubus)
     return xus;
 }
 
+namespace
+{
+
+//! Number of surface dot visibility bits stored per mask word.
+constexpr int c_dotMaskBits = 64;
+
+/*! \internal \brief
+ * Unit sphere dots in the layouts needed by nsc_dclm_pbc().
+ */
+struct UnitSphereDots
+{
+    //! Dot coordinates as consecutive xyz triplets.
+    std::vector<real> xyz;
+    //! Number of dots.
+    int count = 0;
+    //! Dot count padded to a multiple of the SIMD width.
+    int paddedCount = 0;
+    //! X coordinates of the dots, zero-padded to \p paddedCount.
+    std::vector<real, AlignedAllocator<real>> x;
+    //! Y coordinates of the dots, zero-padded to \p paddedCount.
+    std::vector<real, AlignedAllocator<real>> y;
+    //! Z coordinates of the dots, zero-padded to \p paddedCount.
+    std::vector<real, AlignedAllocator<real>> z;
+    //! Initial visibility of each dot: one for real dots, zero for padding.
+    std::vector<real, AlignedAllocator<real>> visible;
+};
+
+UnitSphereDots makeUnitSphereDots(int densit)
+{
+    UnitSphereDots dots;
+    dots.xyz   = make_unsp(densit, 4);
+    dots.count = dots.xyz.size() / 3;
+#if GMX_SIMD_HAVE_REAL
+    const int simdWidth = GMX_SIMD_REAL_WIDTH;
+#else
+    const int simdWidth = 1;
+#endif
+    dots.paddedCount = ((dots.count + simdWidth - 1) / simdWidth) * simdWidth;
+    dots.x.resize(dots.paddedCount, 0.0_real);
+    dots.y.resize(dots.paddedCount, 0.0_real);
+    dots.z.resize(dots.paddedCount, 0.0_real);
+    dots.visible.resize(dots.paddedCount, 0.0_real);
+    for (int l = 0; l < dots.count; ++l)
+    {
+        dots.x[l]       = dots.xyz[3 * l];
+        dots.y[l]       = dots.xyz[3 * l + 1];
+        dots.z[l]       = dots.xyz[3 * l + 2];
+        dots.visible[l] = 1.0_real;
+    }
+    return dots;
+}
+
+/*! \internal \brief
+ * Neighbor sphere that covers part of the surface of the current sphere.
+ */
+struct CoveringNeighbor
+{
+    //! Vector from the current sphere to the neighbor.
+    real dx[DIM];
+    //! Dots with a larger projection on \p dx than this are covered.
+    real refdot;
+    //! Cosine of the half-angle of the covered cap; smaller covers more.
+    real capCosine;
+};
+
+/*! \internal \brief
+ * Thread-local work buffers for nsc_dclm_pbc().
+ */
+struct SurfaceDotWork
+{
+    //! Visibility (one or zero) of each (padded) dot of the current sphere.
+    std::vector<real, AlignedAllocator<real>> visible;
+    //! Neighbors that overlap the current sphere.
+    std::vector<CoveringNeighbor> neighbors;
+};
+
+/*! \brief
+ * Marks dots covered by \p neighbor as invisible and returns the number of
+ * dots still visible.
+ */
+int coverDots(const UnitSphereDots& dots, const CoveringNeighbor& neighbor, real* visible)
+{
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal dx(neighbor.dx[XX]);
+    const SimdReal dy(neighbor.dx[YY]);
+    const SimdReal dz(neighbor.dx[ZZ]);
+    const SimdReal refdot(neighbor.refdot);
+    SimdReal       visibleSum = setZero();
+    for (int l = 0; l < dots.paddedCount; l += GMX_SIMD_REAL_WIDTH)
+    {
+        const SimdReal dot = load<SimdReal>(dots.x.data() + l) * dx
+                             + load<SimdReal>(dots.y.data() + l) * dy
+                             + load<SimdReal>(dots.z.data() + l) * dz;
+        const SimdReal v = selectByNotMask(load<SimdReal>(visible + l), refdot < dot);
+        store(visible + l, v);
+        visibleSum = visibleSum + v;
+    }
+    return static_cast<int>(reduce(visibleSum));
+#else
+    int visibleCount = 0;
+    for (int l = 0; l < dots.count; ++l)
+    {
+        const real dot = dots.x[l] * neighbor.dx[XX] + dots.y[l] * neighbor.dx[YY]
+                         + dots.z[l] * neighbor.dx[ZZ];
+        if (dot > neighbor.refdot)
+        {
+            visible[l] = 0.0_real;
+        }
+        visibleCount += static_cast<int>(visible[l]);
+    }
+    return visibleCount;
+#endif
+}
+
+} // namespace
+
 static void nsc_dclm_pbc(const rvec*                 coords,
                          const ArrayRef<const real>& radius,
                          int                         nat,
-                         const real*                 xus,
-                         int                         n_dot,
+                         const UnitSphereDots&       unitDots,
                          int                         mode,
                          real*                       value_of_area,
                          real**                      at_area,
@@ -713,38 +834,22 @@ static void nsc_dclm_pbc(const rvec*                 coords,
                          int*                        nu_dots,
                          int                         index[],
                          AnalysisNeighborhood*       nb,
-                         const t_pbc*                pbc)
+                         const t_pbc*                pbc,
+                         int                         nthreads)
 {
-    const real dotarea = FOURPI / static_cast<real>(n_dot);
+    const int   n_dot   = unitDots.count;
+    const real* xus     = unitDots.xyz.data();
+    const real  dotarea = FOURPI / static_cast<real>(n_dot);
 
     if (debug)
     {
         fprintf(debug, "nsc_dclm: n_dot=%5d %9.3f\n", n_dot, dotarea);
     }
 
-    /* start with neighbour list */
-    /* calculate neighbour list with the box algorithm */
     if (nat == 0)
     {
         return;
     }
-    real  area = 0.0, vol = 0.0;
-    real *dots = nullptr, *atom_area = nullptr;
-    int   lfnr = 0, maxdots = 0;
-    if (mode & FLAG_VOLUME)
-    {
-        vol = 0.;
-    }
-    if (mode & FLAG_DOTS)
-    {
-        maxdots = (3 * n_dot * nat) / 10;
-        snew(dots, maxdots);
-        lfnr = 0;
-    }
-    if (mode & FLAG_ATOM_AREA)
-    {
-        snew(atom_area, nat);
-    }
 
     // Compute the center of the molecule for volume calculation.
     // In principle, the center should not influence the results, but that is
@@ -769,91 +874,121 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     pos.indexed(constArrayRefFromArray(index, nat));
     AnalysisNeighborhoodSearch nbsearch(nb->initSearch(pbc, pos));
 
-    std::vector<int> wkdot(n_dot);
+    // Per-atom results are stored and summed afterwards in atom order, so
+    // that the results do not depend on the number of threads.
+    const int             maskWordCount = (n_dot + c_dotMaskBits - 1) / c_dotMaskBits;
+    std::vector<real>     atomArea(nat);
+    std::vector<real>     atomVolume((mode & FLAG_VOLUME) ? nat : 0);
+    std::vector<int>      atomDotCount(nat);
+    std::vector<uint64_t> dotMasks((mode & FLAG_DOTS) ? nat * maskWordCount : 0);
 
+    nthreads = std::max(1, std::min(nthreads, nat));
+    std::vector<SurfaceDotWork> work(nthreads);
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 16)
     for (int i = 0; i < nat; ++i)
     {
-        const int                      iat  = index[i];
-        const real                     ai   = radius[iat];
-        const real                     aisq = ai * ai;
-        AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
-        AnalysisNeighborhoodPair       pair;
-        std::fill(wkdot.begin(), wkdot.end(), 1);
-        int currDotCount = n_dot;
-        while (currDotCount > 0 && pairSearch.findNextPair(&pair))
+        try
         {
-            const int  jat = index[pair.refIndex()];
-            const real aj  = radius[jat];
-            const real d2  = pair.distance2();
-            if (iat == jat || d2 > gmx::square(ai + aj))
+            SurfaceDotWork& threadWork = work[gmx_omp_get_thread_num()];
+            if (threadWork.visible.empty())
             {
-                continue;
+                threadWork.visible.resize(unitDots.paddedCount);
             }
-            const rvec& dx     = pair.dx();
-            const real  refdot = (d2 + aisq - aj * aj) / (2 * ai);
-            // TODO: Consider whether micro-optimizations from the old
-            // implementation would be useful, compared to the complexity that
-            // they bring: instead of this direct loop, the neighbors were
-            // stored into a temporary array, the loop order was
-            // reversed (first over dots, then over neighbors), and for each
-            // dot, it was first checked whether the same neighbor that
-            // resulted in marking the previous dot covered would also cover
-            // this dot. This presumably plays together with sorting of the
-            // surface dots (done in make_unsp) to avoid some of the looping.
-            // Alternatively, we could keep a skip list here to avoid
-            // repeatedly looping over dots that have already marked as
-            // covered.
-            for (int j = 0; j < n_dot; ++j)
+            real* visible = threadWork.visible.data();
+
+            const int                      iat  = index[i];
+            const real                     ai   = radius[iat];
+            const real                     aisq = ai * ai;
+            AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
+            AnalysisNeighborhoodPair       pair;
+            threadWork.neighbors.clear();
+            while (pairSearch.findNextPair(&pair))
             {
-                if (wkdot[j] && iprod(&xus[3 * j], dx) > refdot)
+                const int  jat = index[pair.refIndex()];
+                const real aj  = radius[jat];
+                const real d2  = pair.distance2();
+                if (iat == jat || d2 > gmx::square(ai + aj))
+                {
+                    continue;
+                }
+                CoveringNeighbor neighbor;
+                copy_rvec(pair.dx(), neighbor.dx);
+                neighbor.refdot = (d2 + aisq - aj * aj) / (2 * ai);
+                if (d2 > 0)
                 {
-                    --currDotCount;
-                    wkdot[j] = 0;
+                    neighbor.capCosine = neighbor.refdot * gmx::invsqrt(d2);
+                }
+                else
+                {
+                    neighbor.capCosine = (neighbor.refdot < 0 ? -1.0_real : 1.0_real);
+                }
+                threadWork.neighbors.push_back(neighbor);
+            }
+            // Process the neighbors covering the largest caps first, so that
+            // buried atoms are recognized after only a few neighbors.
+            std::sort(threadWork.neighbors.begin(),
+                      threadWork.neighbors.end(),
+                      [](const CoveringNeighbor& a, const CoveringNeighbor& b)
+                      { return a.capCosine < b.capCosine; });
+
+            std::copy(unitDots.visible.begin(), unitDots.visible.end(), visible);
+            int currDotCount = n_dot;
+            for (const CoveringNeighbor& neighbor : threadWork.neighbors)
+            {
+                currDotCount = coverDots(unitDots, neighbor, visible);
+                if (currDotCount == 0)
+                {
+                    break;
                 }
             }
-        }
 
-        const real a = aisq * dotarea * currDotCount;
-        area         = area + a;
-        if (mode & FLAG_ATOM_AREA)
-        {
-            atom_area[i] = a;
-        }
-        const real xi = coords[iat][XX];
-        const real yi = coords[iat][YY];
-        const real zi = coords[iat][ZZ];
-        if (mode & FLAG_DOTS)
-        {
-            for (int l = 0; l < n_dot; l++)
+            atomArea[i]     = aisq * dotarea * currDotCount;
+            atomDotCount[i] = currDotCount;
+            if ((mode & FLAG_DOTS) && currDotCount > 0)
             {
-                if (wkdot[l])
+                uint64_t* mask = &dotMasks[i * maskWordCount];
+                for (int l = 0; l < n_dot; l++)
                 {
-                    lfnr++;
-                    if (maxdots <= 3 * lfnr + 1)
+                    if (visible[l] != 0)
                     {
-                        maxdots = maxdots + n_dot * 3;
-                        srenew(dots, maxdots);
+                        mask[l / c_dotMaskBits] |= uint64_t(1) << (l % c_dotMaskBits);
                     }
-                    dots[3 * lfnr - 3] = ai * xus[3 * l] + xi;
-                    dots[3 * lfnr - 2] = ai * xus[1 + 3 * l] + yi;
-                    dots[3 * lfnr - 1] = ai * xus[2 + 3 * l] + zi;
                 }
             }
-        }
-        if (mode & FLAG_VOLUME)
-        {
-            real dx = 0.0, dy = 0.0, dz = 0.0;
-            for (int l = 0; l < n_dot; l++)
+            if (mode & FLAG_VOLUME)
             {
-                if (wkdot[l])
+                real dx = 0.0, dy = 0.0, dz = 0.0;
+                for (int l = 0; l < n_dot; l++)
                 {
-                    dx = dx + xus[3 * l];
-                    dy = dy + xus[1 + 3 * l];
-                    dz = dz + xus[2 + 3 * l];
+                    if (visible[l] != 0)
+                    {
+                        dx = dx + xus[3 * l];
+                        dy = dy + xus[1 + 3 * l];
+                        dz = dz + xus[2 + 3 * l];
+                    }
                 }
+                const real xi = coords[iat][XX];
+                const real yi = coords[iat][YY];
+                const real zi = coords[iat][ZZ];
+                atomVolume[i] = aisq
+                                * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs)
+                                   + ai * currDotCount);
             }
-            vol = vol + aisq * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs) + ai * currDotCount);
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    real area = 0.0, vol = 0.0;
+    int  lfnr = 0;
+    for (int i = 0; i < nat; ++i)
+    {
+        area = area + atomArea[i];
+        if (mode & FLAG_VOLUME)
+        {
+            vol = vol + atomVolume[i];
+        }
+        lfnr += atomDotCount[i];
     }
 
     if (mode & FLAG_VOLUME)
@@ -862,6 +997,25 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     }
     if (mode & FLAG_DOTS)
     {
+        real* dots = nullptr;
+        snew(dots, 3 * std::max(lfnr, 1));
+        real* dot = dots;
+        for (int i = 0; i < nat; ++i)
+        {
+            const uint64_t* mask = &dotMasks[i * maskWordCount];
+            const int       iat  = index[i];
+            const real      ai   = radius[iat];
+            for (int l = 0; l < n_dot; l++)
+            {
+                if (mask[l / c_dotMaskBits] & (uint64_t(1) << (l % c_dotMaskBits)))
+                {
+                    dot[XX] = ai * xus[3 * l] + coords[iat][XX];
+                    dot[YY] = ai * xus[1 + 3 * l] + coords[iat][YY];
+                    dot[ZZ] = ai * xus[2 + 3 * l] + coords[iat][ZZ];
+                    dot += DIM;
+                }
+            }
+        }
         GMX_RELEASE_ASSERT(nu_dots != nullptr, "Must have valid nu_dots pointer");
         *nu_dots = lfnr;
         GMX_RELEASE_ASSERT(lidots != nullptr, "Must have valid lidots pointer");
@@ -870,6 +1024,9 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     if (mode & FLAG_ATOM_AREA)
     {
         GMX_RELEASE_ASSERT(at_area != nullptr, "Must have valid at_area pointer");
+        real* atom_area = nullptr;
+        snew(atom_area, nat);
+        std::copy(atomArea.begin(), atomArea.end(), atom_area);
         *at_area = atom_area;
     }
     *value_of_area = area;
@@ -886,11 +1043,12 @@ namespace gmx
 class SurfaceAreaCalculator::Impl
 {
 public:
-    Impl() : flags_(0) {}
+    Impl() : flags_(0), threadCount_(1) {}
 
-    std::vector<real>            unitSphereDots_;
+    UnitSphereDots               unitSphereDots_;
     ArrayRef<const real>         radius_;
     int                          flags_;
+    int                          threadCount_;
     mutable AnalysisNeighborhood nb_;
 };
 
@@ -900,7 +1058,12 @@ SurfaceAreaCalculator::~SurfaceAreaCalculator() {}
 
 void SurfaceAreaCalculator::setDotCount(int dotCount)
 {
-    impl_->unitSphereDots_ = make_unsp(dotCount, 4);
+    impl_->unitSphereDots_ = makeUnitSphereDots(dotCount);
+}
+
+void SurfaceAreaCalculator::setThreadCount(int threadCount)
+{
+    impl_->threadCount_ = std::max(1, threadCount);
 }
 
 void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
@@ -997,8 +1160,7 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
     nsc_dclm_pbc(x,
                  impl_->radius_,
                  nat,
-                 &impl_->unitSphereDots_[0],
-                 impl_->unitSphereDots_.size() / 3,
+                 impl_->unitSphereDots_,
                  flags,
                  area,
                  at_area,
@@ -1007,7 +1169,8 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
                  n_dots,
                  index,
                  &impl_->nb_,
-                 pbc);
+                 pbc,
+                 impl_->threadCount_);
 }
 
 } // namespace gmx
@@ -103,6 +103,16 @@ public:
      * Does not throw.
      */
     void setRadii(const ArrayRef<const real>& radius);
+    /*! \brief
+     * Sets the number of OpenMP threads to split the atoms over.
+     *
+     * The atoms of one calculate() call are distributed over the threads.
+     * The results do not depend on the number of threads.
+     * Defaults to one thread.
+     *
+     * Does not throw.
+     */
+    void setThreadCount(int threadCount);
 
     /*! \brief
      * Requests calculation of volume.
@@ -0,0 +1,204 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::analysismodules::TransposeTrj.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+
+#include "gmxpre.h"
+
+#include "transpose_trj.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/fileio/atommajortrajectory.h"
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/filenameoption.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionoption.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+
+struct t_pbc;
+
+namespace gmx
+{
+
+namespace analysismodules
+{
+
+namespace
+{
+
+/*
+ * TransposeTrj
+ */
+
+class TransposeTrj : public TrajectoryAnalysisModule
+{
+public:
+    TransposeTrj();
+
+    void initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* settings) override;
+    void initAnalysis(const TrajectoryAnalysisSettings& settings, const TopologyInformation& top) override;
+    void analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAnalysisModuleData* pdata) override;
+
+    void finishAnalysis(int nframes) override;
+    void writeOutput() override;
+
+private:
+    Selection                                  sel_;
+    std::string                                fnOutput_;
+    real                                       precision_ = 1000;
+    int                                        memoryMB_  = 512;
+    std::unique_ptr<AtomMajorTrajectoryWriter> writer_;
+    std::vector<RVec>                          positions_;
+};
+
+TransposeTrj::TransposeTrj() {}
+
+
+void TransposeTrj::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* settings)
+{
+    static const char* const desc[] = {
+        "[THISMODULE] writes the positions of the selected atoms to an atom-major",
+        "trajectory file. Trajectory files store the system frame by frame, so",
+        "analyses that need the time series of a few atoms have to decode every",
+        "frame of the whole system. An atom-major file stores the time series of",
+        "each atom contiguously instead, so that the time series of any subset of",
+        "atoms can be read in a single pass that touches only the data of those",
+        "atoms.[PAR]",
+        "The trajectory is stored in segments of consecutive frames. The frames of",
+        "a segment are collected in memory, at most [TT]-mem[tt] MB, before the",
+        "time series of the atoms in the segment are written, compressed in blocks",
+        "of a few atoms with the XTC algorithm at precision [TT]-prec[tt].",
+        "A larger [TT]-mem[tt] gives fewer segments and thus fewer seeks when",
+        "reading.[PAR]",
+        "By default, the positions are written as they are in the input",
+        "trajectory. Use [TT]-rmpbc[tt] to make molecules whole, or use",
+        "[gmx-trjconv] first to remove jumps over the periodic boundaries",
+        "when needed.",
+    };
+
+    options->addOption(SelectionOption("select")
+                               .store(&sel_)
+                               .defaultSelectionText("all")
+                               .onlyAtoms()
+                               .onlyStatic()
+                               .description("Atoms to write to the file"));
+
+    options->addOption(FileNameOption("o")
+                               .legacyType(efAMT)
+                               .outputFile()
+                               .store(&fnOutput_)
+                               .defaultBasename("traj")
+                               .required()
+                               .description("Atom-major trajectory"));
+    options->addOption(RealOption("prec").store(&precision_).description(
+            "Precision of the positions in 1/nm, as for XTC output"));
+    options->addOption(IntegerOption("mem").store(&memoryMB_).description(
+            "Memory in MB for collecting the frames of a segment"));
+
+    settings->setHelpText(desc);
+    settings->setRmPBC(false);
+}
+
+void TransposeTrj::initAnalysis(const TrajectoryAnalysisSettings& /*settings*/,
+                                const TopologyInformation& /*top*/)
+{
+    if (precision_ <= 0)
+    {
+        GMX_THROW(InconsistentInputError("-prec must be positive"));
+    }
+    if (memoryMB_ <= 0)
+    {
+        GMX_THROW(InconsistentInputError("-mem must be positive"));
+    }
+    positions_.resize(sel_.atomCount());
+    writer_ = std::make_unique<AtomMajorTrajectoryWriter>(
+            fnOutput_, sel_.atomIndices(), precision_, static_cast<size_t>(memoryMB_) << 20);
+}
+
+void TransposeTrj::analyzeFrame(int /*frnr*/, const t_trxframe& fr, t_pbc* /* pbc */, TrajectoryAnalysisModuleData* /*pdata*/)
+{
+    for (int i = 0; i < sel_.posCount(); i++)
+    {
+        positions_[i] = sel_.position(i).x();
+    }
+    matrix box;
+    if (fr.bBox)
+    {
+        copy_mat(fr.box, box);
+    }
+    else
+    {
+        clear_mat(box);
+    }
+    writer_->writeFrame(fr.step, fr.time, box, positions_);
+}
+
+void TransposeTrj::finishAnalysis(int /*nframes*/)
+{
+    writer_->finish();
+    writer_.reset();
+}
+
+
+void TransposeTrj::writeOutput() {}
+
+} // namespace
+
+const char TransposeTrjInfo::name[] = "transpose-trj";
+const char TransposeTrjInfo::shortDescription[] =
+        "Writes an atom-major trajectory for fast per-atom time series access";
+
+TrajectoryAnalysisModulePointer TransposeTrjInfo::create()
+{
+    return TrajectoryAnalysisModulePointer(new TransposeTrj);
+}
+
+} // namespace analysismodules
+
+} // namespace gmx
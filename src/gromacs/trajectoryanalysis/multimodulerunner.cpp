@@ -0,0 +1,413 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the runner that feeds several analysis modules from a single
+ * trajectory pass.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "multimodulerunner.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gromacs/analysisdata/paralleloptions.h"
+#include "gromacs/commandline/cmdlinehelpwriter.h"
+#include "gromacs/commandline/cmdlinemodule.h"
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/commandline/cmdlineparser.h"
+#include "gromacs/options/behaviorcollection.h"
+#include "gromacs/options/filenameoptionmanager.h"
+#include "gromacs/options/options.h"
+#include "gromacs/options/timeunitmanager.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/selection/selectioncollection.h"
+#include "gromacs/selection/selectionoptionbehavior.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/trajectoryanalysis/analysismodule.h"
+#include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/trajectoryanalysis/topologyinformation.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "runnercommon.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Separates the options of the modules on the command line.
+const char c_moduleSeparator[] = "--";
+
+/********************************************************************
+ * ModuleOptionsSettings
+ */
+
+/*! \internal \brief
+ * Settings for initializing the options of one of the modules.
+ *
+ * The help texts of the modules are not used, as only the options of the
+ * command-line module itself are shown in its help.
+ */
+class ModuleOptionsSettings : public ICommandLineOptionsModuleSettings
+{
+public:
+    explicit ModuleOptionsSettings(OptionsBehaviorCollection* behaviors) : behaviors_(*behaviors)
+    {
+    }
+
+    void setHelpText(const ArrayRef<const char* const>& /*help*/) override {}
+    void setBugText(const ArrayRef<const char* const>& /*bug*/) override {}
+    void addOptionsBehavior(const OptionsBehaviorPointer& behavior) override
+    {
+        behaviors_.addBehavior(behavior);
+    }
+
+private:
+    OptionsBehaviorCollection& behaviors_;
+};
+
+/********************************************************************
+ * ModuleInstance
+ */
+
+/*! \internal \brief
+ * One of the modules run, with its own options and settings.
+ */
+struct ModuleInstance
+{
+    explicit ModuleInstance(TrajectoryAnalysisModulePointer module) :
+        module_(std::move(module)), behaviors_(&options_)
+    {
+        options_.addManager(&fileoptManager_);
+    }
+
+    TrajectoryAnalysisModulePointer     module_;
+    TrajectoryAnalysisSettings          settings_;
+    FileNameOptionManager               fileoptManager_;
+    Options                             options_;
+    OptionsBehaviorCollection           behaviors_;
+    TrajectoryAnalysisModuleDataPointer pdata_;
+};
+
+/********************************************************************
+ * MultiModuleRunner
+ */
+
+class MultiModuleRunner : public ICommandLineModule
+{
+public:
+    MultiModuleRunner(const char*                                name,
+                      const char*                                description,
+                      std::vector<TrajectoryAnalysisModuleEntry> modules) :
+        name_(name), description_(description), modules_(std::move(modules))
+    {
+    }
+
+    const char* name() const override { return name_; }
+    const char* shortDescription() const override { return description_; }
+
+    void init(CommandLineModuleSettings* /*settings*/) override {}
+    int  run(int argc, char* argv[]) override;
+    void writeHelp(const CommandLineHelpContext& context) const override;
+
+private:
+    //! Returns the help text, which lists the available modules.
+    std::string helpText() const;
+    //! Creates the module named \p name, throws if there is no such module.
+    TrajectoryAnalysisModulePointer createModule(const char* name) const;
+
+    const char*                                name_;
+    const char*                                description_;
+    std::vector<TrajectoryAnalysisModuleEntry> modules_;
+};
+
+std::string MultiModuleRunner::helpText() const
+{
+    const char* const desc[] = {
+        "[THISMODULE] runs several trajectory analysis tools in a single pass",
+        "over the trajectory. Each frame is read and decoded only once, and the",
+        "selections of all tools are compiled and evaluated together, so that",
+        "their position calculations can be shared.[PAR]",
+        "The options before the first [TT]--[tt] are common to all tools:",
+        "the input files, time control, periodic boundary treatment, index groups",
+        "and plot formatting. After each [TT]--[tt], give the name of a tool",
+        "followed by its own options, for example::",
+        "",
+        "  gmx multi-analyze -f traj.xtc -s topol.tpr \\",
+        "      -- sasa -surface Protein -o area.xvg \\",
+        "      -- gyrate -sel Protein -o gyrate.xvg",
+        "",
+        "Option [TT]-rmpbc[tt] applies to the shared frames and thereby to all tools,",
+        "and [TT]-pbc[tt] applies to all tools that let the user choose it.",
+        "Selections that are not given on the command line are asked for on the",
+        "standard input. [TT]-sf[tt] can only provide selections for",
+        "[TT]-fgroup[tt], as the tool options are not known yet when it is",
+        "processed.[PAR]",
+    };
+    std::vector<std::string> names;
+    for (const auto& entry : modules_)
+    {
+        names.push_back(formatString("[TT]%s[tt]", entry.name));
+    }
+    return joinStrings(desc, "\n") + "\nThe tools that can be run are: " + joinStrings(names, ", ")
+           + ".";
+}
+
+TrajectoryAnalysisModulePointer MultiModuleRunner::createModule(const char* name) const
+{
+    for (const auto& entry : modules_)
+    {
+        if (std::strcmp(entry.name, name) == 0)
+        {
+            return entry.factory();
+        }
+    }
+    GMX_THROW(InvalidInputError(formatString("'%s' is not a trajectory analysis tool", name)));
+}
+
+void MultiModuleRunner::writeHelp(const CommandLineHelpContext& context) const
+{
+    TrajectoryAnalysisSettings     settings;
+    TrajectoryAnalysisRunnerCommon common(&settings);
+    SelectionCollection            selections;
+    SelectionOptionBehavior        selectionOptionBehavior(&selections, common.topologyProvider());
+    TimeUnitBehavior               timeUnitBehavior;
+    Options                        options;
+    selectionOptionBehavior.initBehavior(&options);
+    common.initOptions(&options, &timeUnitBehavior);
+    selectionOptionBehavior.initOptions(&options);
+    CommandLineHelpWriter(options).setHelpText(helpText()).writeHelp(context);
+}
+
+int MultiModuleRunner::run(int argc, char* argv[])
+{
+    // Split the command line into the common part and one part per module.
+    std::vector<std::vector<char*>> parts(1);
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], c_moduleSeparator) == 0)
+        {
+            parts.emplace_back();
+        }
+        else
+        {
+            parts.back().push_back(argv[i]);
+        }
+    }
+    if (parts.size() < 2)
+    {
+        GMX_THROW(InvalidInputError(
+                formatString("No analysis tools given; give each tool with its options after '%s'",
+                             c_moduleSeparator)));
+    }
+
+    TrajectoryAnalysisSettings     settings;
+    TrajectoryAnalysisRunnerCommon common(&settings);
+    SelectionCollection            selections;
+    SelectionOptionBehavior        selectionOptionBehavior(&selections, common.topologyProvider());
+    TimeUnitBehavior               timeUnitBehavior;
+
+    /* All modules register their selection options with the manager of the
+     * common selection behavior, so that their selections end up in one
+     * collection that is compiled and evaluated once per frame. The options
+     * of the modules are created first, as the common options, e.g.
+     * -seltype, depend on which selection options there are.
+     */
+    std::vector<std::unique_ptr<ModuleInstance>> instances;
+    for (size_t p = 1; p < parts.size(); ++p)
+    {
+        std::vector<char*>& part = parts[p];
+        if (part.empty())
+        {
+            GMX_THROW(InvalidInputError(
+                    formatString("No tool name given after '%s'", c_moduleSeparator)));
+        }
+        auto& instance =
+                instances.emplace_back(std::make_unique<ModuleInstance>(createModule(part[0])));
+        selectionOptionBehavior.initBehavior(&instance->options_);
+        ModuleOptionsSettings moduleOptionsSettings(&instance->behaviors_);
+        instance->settings_.setOptionsModuleSettings(&moduleOptionsSettings);
+        instance->module_->initOptions(&instance->options_, &instance->settings_);
+        instance->settings_.setOptionsModuleSettings(nullptr);
+    }
+
+    // The selection option manager refers to the options until they have been compiled.
+    FileNameOptionManager fileoptManager;
+    Options               options;
+    options.addManager(&fileoptManager);
+    selectionOptionBehavior.initBehavior(&options);
+    common.initOptions(&options, &timeUnitBehavior);
+    selectionOptionBehavior.initOptions(&options);
+
+    int argcCommon = parts[0].size();
+    CommandLineParser(&options).parse(&argcCommon, parts[0].data());
+    timeUnitBehavior.optionsFinishing(&options);
+    options.finish();
+    common.optionsFinished();
+
+    for (size_t p = 1; p < parts.size(); ++p)
+    {
+        std::vector<char*>& part     = parts[p];
+        ModuleInstance*     instance = instances[p - 1].get();
+        try
+        {
+            int argcModule = part.size();
+            CommandLineParser(&instance->options_).parse(&argcModule, part.data());
+            timeUnitBehavior.optionsFinishing(&instance->options_);
+            instance->behaviors_.optionsFinishing();
+            instance->options_.finish();
+            common.applyCommonSettings(&instance->settings_);
+            instance->module_->optionsFinished(&instance->settings_);
+            instance->behaviors_.optionsFinished();
+        }
+        catch (GromacsException& ex)
+        {
+            ex.prependContext(formatString("In the options of '%s':", part[0]));
+            throw;
+        }
+
+        // The frames are read once for all modules, so they need to contain what any module needs.
+        settings.setFrameFlags(settings.frflags() | instance->settings_.frflags());
+        for (const unsigned long flag : { TrajectoryAnalysisSettings::efRequireTop,
+                                          TrajectoryAnalysisSettings::efUseTopX,
+                                          TrajectoryAnalysisSettings::efUseTopV })
+        {
+            if (instance->settings_.hasFlag(flag))
+            {
+                settings.setFlag(flag);
+            }
+        }
+    }
+    selectionOptionBehavior.optionsFinished();
+
+    common.initTopology();
+    const TopologyInformation& topology = common.topologyInformation();
+    for (auto& instance : instances)
+    {
+        instance->module_->initAnalysis(instance->settings_, topology);
+    }
+
+    common.initFirstFrame();
+    common.initFrameIndexGroup();
+    bool needPbc = settings.hasPBC();
+    for (auto& instance : instances)
+    {
+        instance->module_->initAfterFirstFrame(instance->settings_, common.frame());
+        needPbc = needPbc || instance->settings_.hasPBC();
+    }
+
+    t_pbc                       pbc;
+    int                         nframes = 0;
+    AnalysisDataParallelOptions dataOptions;
+    for (auto& instance : instances)
+    {
+        instance->pdata_ = instance->module_->startFrames(dataOptions, selections);
+    }
+    do
+    {
+        common.initFrame();
+        t_trxframe& frame = common.frame();
+        if (needPbc)
+        {
+            set_pbc(&pbc, topology.pbcType(), frame.box);
+        }
+
+        selections.evaluate(&frame, needPbc ? &pbc : nullptr);
+        for (auto& instance : instances)
+        {
+            t_pbc* ppbc = instance->settings_.hasPBC() ? &pbc : nullptr;
+            instance->module_->analyzeFrame(nframes, frame, ppbc, instance->pdata_.get());
+            instance->module_->finishFrameSerial(nframes);
+        }
+
+        ++nframes;
+    } while (common.readNextFrame());
+    for (auto& instance : instances)
+    {
+        instance->module_->finishFrames(instance->pdata_.get());
+        if (instance->pdata_ != nullptr)
+        {
+            instance->pdata_->finish();
+        }
+        instance->pdata_.reset();
+    }
+
+    if (common.hasTrajectory())
+    {
+        fprintf(stderr,
+                "Analyzed %d frames with %zu tools, last time %.3f\n",
+                nframes,
+                instances.size(),
+                common.frame().time);
+    }
+    else
+    {
+        fprintf(stderr, "Analyzed topology coordinates with %zu tools\n", instances.size());
+    }
+
+    // Restore the maximal groups for dynamic selections.
+    selections.evaluateFinal(nframes);
+
+    for (auto& instance : instances)
+    {
+        instance->module_->finishAnalysis(nframes);
+        instance->module_->writeOutput();
+    }
+
+    return 0;
+}
+
+} // namespace
+
+std::unique_ptr<ICommandLineModule>
+createTrajectoryAnalysisMultiModuleRunner(const char*                                name,
+                                          const char*                                description,
+                                          std::vector<TrajectoryAnalysisModuleEntry> modules)
+{
+    return std::make_unique<MultiModuleRunner>(name, description, std::move(modules));
+}
+
+} // namespace gmx
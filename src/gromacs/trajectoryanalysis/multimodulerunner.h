@@ -0,0 +1,95 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares a command-line runner that feeds several analysis modules from a
+ * single trajectory pass.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#ifndef GMX_TRAJECTORYANALYSIS_MULTIMODULERUNNER_H
+#define GMX_TRAJECTORYANALYSIS_MULTIMODULERUNNER_H
+
+#include <memory>
+#include <vector>
+
+#include "gromacs/trajectoryanalysis/cmdlinerunner.h"
+
+namespace gmx
+{
+
+class ICommandLineModule;
+
+/*! \internal
+ * \brief
+ * Name and factory of an analysis module that can be run by the multi-module runner.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+struct TrajectoryAnalysisModuleEntry
+{
+    //! Name used to select the module on the command line.
+    const char* name;
+    //! Function that creates the module.
+    TrajectoryAnalysisCommandLineRunner::ModuleFactoryMethod factory;
+};
+
+/*! \brief
+ * Creates a command-line module that runs several analysis modules in one pass.
+ *
+ * The arguments of the command-line module are split at `--`. The arguments
+ * before the first separator are the options common to all modules (input
+ * files, time control, PBC treatment, index groups and plot formatting).
+ * Each following part starts with the name of a module from \p modules,
+ * followed by the options of that module. All modules are then fed from a
+ * single read of the trajectory, and the selections of all modules are
+ * compiled into and evaluated with a single selection collection.
+ *
+ * \param[in] name        Name of the command-line module.
+ * \param[in] description One-line description of the command-line module.
+ * \param[in] modules     Modules that can be run.
+ * \returns   Command-line module that runs the modules given on its command line.
+ * \throws    std::bad_alloc if out of memory.
+ *
+ * \p name and \p description must be string constants or otherwise stay
+ * valid for the duration of the program execution.
+ */
+std::unique_ptr<ICommandLineModule>
+createTrajectoryAnalysisMultiModuleRunner(const char*                                name,
+                                          const char*                                description,
+                                          std::vector<TrajectoryAnalysisModuleEntry> modules);
+
+} // namespace gmx
+
+#endif
@@ -426,6 +426,22 @@ void TrajectoryAnalysisRunnerCommon::optionsFinished()
 }
 
 
+void TrajectoryAnalysisRunnerCommon::applyCommonSettings(TrajectoryAnalysisSettings* settings) const
+{
+    const TrajectoryAnalysisSettings& common = impl_->settings_;
+    settings->impl_->timeUnit                = common.impl_->timeUnit;
+    settings->impl_->plotSettings            = common.impl_->plotSettings;
+    if (!settings->hasFlag(TrajectoryAnalysisSettings::efNoUserPBC))
+    {
+        settings->setPBC(common.hasPBC());
+    }
+    if (!settings->hasFlag(TrajectoryAnalysisSettings::efNoUserRmPBC))
+    {
+        settings->setRmPBC(common.hasRmPBC());
+    }
+}
+
+
 void TrajectoryAnalysisRunnerCommon::initTopology()
 {
     const bool topologyRequired = impl_->settings_.hasFlag(TrajectoryAnalysisSettings::efRequireTop);
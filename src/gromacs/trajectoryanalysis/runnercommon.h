@@ -59,7 +59,8 @@ class TrajectoryAnalysisSettings;
  * \brief
  * Implements common trajectory analysis runner functionality.
  *
- * As there is currently only one runner (TrajectoryAnalysisCommandLineRunner),
+ * Used by TrajectoryAnalysisCommandLineRunner and by the runner that feeds
+ * several modules from a single trajectory pass (see multimodulerunner.h);
  * the division of responsibilities is not yet very clear.
  *
  * \ingroup module_trajectoryanalysis
@@ -88,6 +89,15 @@ public:
     void initOptions(IOptionsContainer* options, TimeUnitBehavior* timeUnitBehavior);
     //! Processes common option values after they have been parsed.
     void optionsFinished();
+    /*! \brief
+     * Copies the common option values to the settings of another module.
+     *
+     * Copies the time unit and plot settings, and the PBC settings
+     * unless the module does not let the user change them.
+     * Used for running several modules on the frames read by this object.
+     * Can be called after optionsFinished().
+     */
+    void applyCommonSettings(TrajectoryAnalysisSettings* settings) const;
     //! Load topology information if provided and/or required.
     void initTopology();
     /*! \brief
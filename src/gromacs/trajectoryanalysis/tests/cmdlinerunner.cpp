@@ -45,6 +45,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -53,15 +54,19 @@
 #include "gromacs/commandline/cmdlineoptionsmodule.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionoption.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/trajectoryanalysis/analysismodule.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/trajectoryanalysis/multimodulerunner.h"
 #include "gromacs/trajectoryanalysis/topologyinformation.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/exceptions.h"
 
 #include "testutils/cmdlinetest.h"
 #include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 
 struct t_pbc;
 
@@ -169,6 +174,93 @@ TEST_F(TrajectoryAnalysisCommandLineRunnerTest, FailsWithTrajectorySubsetWithout
     EXPECT_THROW_GMX(runTest(CommandLine(cmdline)), gmx::InconsistentInputError);
 }
 
+TEST(TrajectoryAnalysisMultiModuleRunnerTest, RunsModulesOnSharedFrames)
+{
+    using ::testing::_;
+    auto first  = std::make_unique<MockModule>();
+    auto second = std::make_unique<MockModule>();
+    EXPECT_CALL(*first, initOptions(_, _));
+    EXPECT_CALL(*first, initAnalysis(_, _));
+    EXPECT_CALL(*first, analyzeFrame(0, _, _, _));
+    EXPECT_CALL(*first, analyzeFrame(1, _, _, _));
+    EXPECT_CALL(*first, finishAnalysis(2));
+    EXPECT_CALL(*first, writeOutput());
+    EXPECT_CALL(*second, initOptions(_, _));
+    EXPECT_CALL(*second, initAnalysis(_, _));
+    EXPECT_CALL(*second, analyzeFrame(0, _, _, _));
+    EXPECT_CALL(*second, analyzeFrame(1, _, _, _));
+    EXPECT_CALL(*second, finishAnalysis(2));
+    EXPECT_CALL(*second, writeOutput());
+
+    std::vector<TrajectoryAnalysisModuleEntry> modules;
+    auto createFirst  = [&first]() { return TrajectoryAnalysisModulePointer(std::move(first)); };
+    auto createSecond = [&second]() { return TrajectoryAnalysisModulePointer(std::move(second)); };
+    modules.push_back({ "first", createFirst });
+    modules.push_back({ "second", createSecond });
+    const std::unique_ptr<ICommandLineModule> runner(
+            createTrajectoryAnalysisMultiModuleRunner("multi", "Description", std::move(modules)));
+
+    CommandLine cmdline;
+    cmdline.append("multi");
+    cmdline.addOption("-s", TestFileManager::getInputFilePath("simple.gro").string());
+    cmdline.addOption("-f", TestFileManager::getInputFilePath("simple-subset.gro").string());
+    cmdline.addOption("-fgroup", "atomnr 4 5 6 10 to 14");
+    cmdline.append("--");
+    cmdline.append("second");
+    cmdline.append("--");
+    cmdline.append("first");
+    EXPECT_NO_THROW_GMX(
+            ASSERT_EQ(0, test::CommandLineTestHelper::runModuleDirect(runner.get(), &cmdline)));
+}
+
+TEST(TrajectoryAnalysisMultiModuleRunnerTest, AppliesSelectionTypeToModuleSelections)
+{
+    using ::testing::_;
+    auto      module = std::make_unique<MockModule>();
+    Selection sel;
+    EXPECT_CALL(*module, initOptions(_, _))
+            .WillOnce([&sel](IOptionsContainer* options, TrajectoryAnalysisSettings* /*settings*/) {
+                options->addOption(SelectionOption("sel").store(&sel).required());
+            });
+    EXPECT_CALL(*module, initAnalysis(_, _));
+    // With -seltype res_com, the selection has one position per residue
+    EXPECT_CALL(*module, analyzeFrame(0, _, _, _))
+            .WillOnce(::testing::InvokeWithoutArgs([&sel]() { EXPECT_EQ(2, sel.posCount()); }));
+    EXPECT_CALL(*module, finishAnalysis(1));
+    EXPECT_CALL(*module, writeOutput());
+
+    std::vector<TrajectoryAnalysisModuleEntry> modules;
+    auto createModule = [&module]() { return TrajectoryAnalysisModulePointer(std::move(module)); };
+    modules.push_back({ "module", createModule });
+    const std::unique_ptr<ICommandLineModule> runner(
+            createTrajectoryAnalysisMultiModuleRunner("multi", "Description", std::move(modules)));
+
+    CommandLine cmdline;
+    cmdline.append("multi");
+    cmdline.addOption("-s", TestFileManager::getInputFilePath("simple.gro").string());
+    cmdline.addOption("-seltype", "res_com");
+    cmdline.append("--");
+    cmdline.append("module");
+    cmdline.addOption("-sel", "atomnr 1 to 6");
+    EXPECT_NO_THROW_GMX(
+            ASSERT_EQ(0, test::CommandLineTestHelper::runModuleDirect(runner.get(), &cmdline)));
+}
+
+TEST(TrajectoryAnalysisMultiModuleRunnerTest, DetectsUnknownModule)
+{
+    std::vector<TrajectoryAnalysisModuleEntry> modules;
+    const std::unique_ptr<ICommandLineModule> runner(
+            createTrajectoryAnalysisMultiModuleRunner("multi", "Description", std::move(modules)));
+
+    CommandLine cmdline;
+    cmdline.append("multi");
+    cmdline.addOption("-s", TestFileManager::getInputFilePath("simple.gro").string());
+    cmdline.append("--");
+    cmdline.append("unknown");
+    EXPECT_THROW_GMX(test::CommandLineTestHelper::runModuleDirect(runner.get(), &cmdline),
+                     InvalidInputError);
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
@@ -135,6 +135,53 @@ INSTANTIATE_TEST_SUITE_P(
                            ::testing::Values("energy", "geometry"),
                            ::testing::Values("clear", "noclear"),
                            ::testing::Values("polypro", "nopolypro")));
+
+//! Test parameters: the pair search option and the reference data of the matching serial test
+using DsspThreadsTestParams = std::tuple<const char*, const char*>;
+
+/*! \brief Test fixture for running the dssp analysis module with several threads.
+ *
+ * The results do not depend on the number of threads, so the tests compare
+ * against the reference data of the matching single-threaded
+ * MoleculeTests/DsspModuleTest.Works case.
+ */
+class DsspModuleThreadsTest :
+    public TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::DsspInfo>,
+    public ::testing::WithParamInterface<DsspThreadsTestParams>
+{
+public:
+    DsspModuleThreadsTest() : TrajectoryAnalysisModuleTestFixture(std::get<1>(GetParam())) {}
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+TEST_P(DsspModuleThreadsTest, GivesSameResult)
+{
+    const char* const cmdline[] = { "dssp" };
+    CommandLine       command(cmdline);
+    setTopology("RNAseA.pdb");
+    setTrajectory("RNAseA.pdb");
+    setOutputFile("-o", "RNAseA-threads.dat", ExactTextMatch());
+    // Not stored in the shared reference data
+    commandLine().addOption("-nt", 3);
+    command.addOption("-hmode", "dssp");
+    command.addOption(std::get<0>(GetParam()));
+    command.addOption("-cutoff", 0.9);
+    command.addOption("-hbond", "energy");
+    command.addOption("-clear");
+    command.addOption("-polypro");
+    setOutputFile("-num", "RNAseA-threads.xvg", test::XvgMatch());
+    runTest(command);
+}
+
+// The indices are those of RNAseA.pdb with -hmode dssp, -cutoff 0.9, -hbond energy,
+// -clear and -polypro in the MoleculeTests instantiation above
+INSTANTIATE_TEST_SUITE_P(
+        WithThreads,
+        DsspModuleThreadsTest,
+        ::testing::Values(
+                DsspThreadsTestParams{ "-nb", "MoleculeTests_DsspModuleTest_Works_64.xml" },
+                DsspThreadsTestParams{ "-nonb", "MoleculeTests_DsspModuleTest_Works_80.xml" }));
+
 } // namespace
 } // namespace test
 } // namespace gmx
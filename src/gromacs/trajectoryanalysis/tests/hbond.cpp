@@ -152,6 +152,31 @@ INSTANTIATE_TEST_SUITE_P(HBondTests,
                                                               std::make_tuple("Water", "Water")),
                                             ::testing::Values("nom", "m")));
 
+//! Test fixture for the hbond lifetime and existence autocorrelation output.
+using HbondLifetimeTest = TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::HbondInfo>;
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+TEST_F(HbondLifetimeTest, WritesLifetimesAndAutocorrelation)
+{
+    const char* const cmdline[] = { "hbond2", "-r", "Protein", "-t", "Water" };
+    CommandLine       command(cmdline);
+    setTrajectory("trpcage.xtc");
+    setTopology("trpcage.tpr");
+    setOutputFile("-o", "trpcage-life.ndx", ExactTextMatch());
+    setOutputFile("-life",
+                  "trpcage-life.xvg",
+                  test::XvgMatch().tolerance(gmx::test::relativeToleranceAsFloatingPoint(1, 1e-5)));
+    setOutputFile("-ac",
+                  "trpcage-ac.xvg",
+                  test::XvgMatch().tolerance(gmx::test::relativeToleranceAsFloatingPoint(1, 1e-5)));
+    excludeDataset("hbnum");
+    excludeDataset("hbdist");
+    excludeDataset("hbang");
+    excludeDataset("hbdan");
+    excludeDataset("histogram_dist");
+    excludeDataset("histogram_ang");
+    runTest(command);
+}
 
 } // namespace test
 } // namespace gmx
@@ -143,6 +143,12 @@ AbstractTrajectoryAnalysisModuleTestFixture::AbstractTrajectoryAnalysisModuleTes
 {
 }
 
+AbstractTrajectoryAnalysisModuleTestFixture::AbstractTrajectoryAnalysisModuleTestFixture(
+        const std::string& referenceDataName) :
+    CommandLineTestBase(referenceDataName), impl_(new Impl(this))
+{
+}
+
 AbstractTrajectoryAnalysisModuleTestFixture::~AbstractTrajectoryAnalysisModuleTestFixture() {}
 
 void AbstractTrajectoryAnalysisModuleTestFixture::setTopology(const char* filename)
@@ -42,6 +42,7 @@
 #define GMX_TRAJECTORYANALYSIS_TESTS_MODULETEST_H
 
 #include <memory>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -93,6 +94,16 @@ class AbstractTrajectoryAnalysisModuleTestFixture : public CommandLineTestBase
 {
 public:
     AbstractTrajectoryAnalysisModuleTestFixture();
+    /*! \brief
+     * Initializes the test to use reference data shared with other tests.
+     *
+     * \param[in] referenceDataName  Name of the reference data file.
+     *
+     * Options that should not be part of the shared reference data, such
+     * as the number of threads, can be added with commandLine() instead
+     * of passing them to runTest().
+     */
+    explicit AbstractTrajectoryAnalysisModuleTestFixture(const std::string& referenceDataName);
     ~AbstractTrajectoryAnalysisModuleTestFixture() override;
 
     /*! \brief
@@ -207,6 +218,9 @@ private:
 template<class ModuleInfo>
 class TrajectoryAnalysisModuleTestFixture : public AbstractTrajectoryAnalysisModuleTestFixture
 {
+public:
+    using AbstractTrajectoryAnalysisModuleTestFixture::AbstractTrajectoryAnalysisModuleTestFixture;
+
 protected:
     TrajectoryAnalysisModulePointer createModule() override { return ModuleInfo::create(); }
 };
@@ -150,6 +150,12 @@ class MsdModuleTest : public gmx::test::TrajectoryAnalysisModuleTestFixture<gmx:
 {
 public:
     MsdModuleTest() { setOutputFile("-o", "msd.xvg", MsdMatch()); }
+    //! Initializes the test to compare against the reference data in \p referenceDataName
+    explicit MsdModuleTest(const std::string& referenceDataName) :
+        TrajectoryAnalysisModuleTestFixture(referenceDataName)
+    {
+        setOutputFile("-o", "msd.xvg", MsdMatch());
+    }
     // Creates a TPR for the given starting structure and topology. Builds an mdp in place prior
     // to calling grompp. sets the -s input to the generated tpr
     void createTpr(const std::string& structure, const std::string& topology, const std::string& index)
@@ -176,6 +182,7 @@ public:
         auto ndx = std::filesystem::path(simDB).append(index);
         caller.addOption("-n", ndx.string().c_str());
         caller.addOption("-o", tpr.c_str());
+        caller.addOption("-po", fileManager().getTemporaryFilePath("out.mdp").string());
         ASSERT_EQ(0, gmx_grompp(caller.argc(), caller.argv()));
 
         // setInputFile() doesn't like the temporary tpr path.
@@ -253,6 +260,26 @@ TEST_F(MsdModuleTest, roundingFail)
     EXPECT_THROW_GMX(runTestAnticipatingException(CommandLine(cmdline)), gmx::ToleranceError);
 }
 
+// A trajectory with a dt of 0.1 ps gives the same error with all methods,
+// instead of failing the check for a constant time between frames
+TEST_F(MsdModuleTest, nonIntegralTimeStepFailsWithFft)
+{
+    setInputFile("-f", "msd_traj_dt01.xtc");
+    setInputFile("-s", "msd_coords.gro");
+    setInputFile("-n", "msd.ndx");
+    const char* const cmdline[] = { "-sel", "0", "-method", "fft" };
+    EXPECT_THROW_GMX(runTestAnticipatingException(CommandLine(cmdline)), gmx::ToleranceError);
+}
+
+TEST_F(MsdModuleTest, nonIntegralTimeStepFailsWithLog)
+{
+    setInputFile("-f", "msd_traj_dt01.xtc");
+    setInputFile("-s", "msd_coords.gro");
+    setInputFile("-n", "msd.ndx");
+    const char* const cmdline[] = { "-sel", "0", "-method", "log" };
+    EXPECT_THROW_GMX(runTestAnticipatingException(CommandLine(cmdline)), gmx::ToleranceError);
+}
+
 
 // -------------------------------------------------------------------------
 // These tests operate on a more realistic trajectory, with a solvated protein,
@@ -322,6 +349,70 @@ TEST_F(MsdModuleTest, notEnoughPointsForFitErrorEstimate)
     runTest(CommandLine(cmdline));
 }
 
+/*! \brief Test fixture for the FFT-based algorithm of gmx msd
+ *
+ * The FFT-based algorithm should reproduce the results of comparing the
+ * frames directly, so each test compares against the reference data of
+ * the MsdModuleTest test with the same name.
+ */
+class MsdModuleFftTest : public MsdModuleTest
+{
+public:
+    MsdModuleFftTest() :
+        MsdModuleTest(formatString("MsdModuleTest_%s.xml",
+                                   ::testing::UnitTest::GetInstance()->current_test_info()->name()))
+    {
+        // Not stored in the shared reference data
+        commandLine().addOption("-method", "fft");
+    }
+};
+
+TEST_F(MsdModuleFftTest, oneDimensionalDiffusionWithMaxTau)
+{
+    setInputFile("-f", "msd_traj.xtc");
+    setInputFile("-s", "msd_coords.gro");
+    setInputFile("-n", "msd.ndx");
+    const char* const cmdline[] = { "-trestart", "200", "-type", "x", "-sel", "0", "-maxtau", "5" };
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(MsdModuleFftTest, multipleGroupsWork)
+{
+    setAllInputs("alanine_vsite_solvated");
+    const char* const cmdline[] = { "-trestart", "2", "-sel", "1;2" };
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(MsdModuleFftTest, trestartGreaterThanDt)
+{
+    setAllInputs("alanine_vsite_solvated");
+    const char* const cmdline[] = { "-trestart", "10", "-sel", "2" };
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(MsdModuleFftTest, molTest)
+{
+    setAllInputs("alanine_vsite_solvated");
+    setOutputFile("-mol", "diff_mol.xvg", MsdMatch());
+    const char* const cmdline[] = { "-trestart", "10", "-sel", "3" };
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(MsdModuleTest, logSpacedTaus)
+{
+    setAllInputs("alanine_vsite_solvated");
+    const char* const cmdline[] = { "-sel", "2", "-method", "log" };
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(MsdModuleTest, logSpacedTausWithMaxTau)
+{
+    setAllInputs("alanine_vsite_solvated");
+    setOutputFile("-mol", "diff_mol.xvg", MsdMatch());
+    const char* const cmdline[] = { "-sel", "3", "-method", "log", "-maxtau", "20" };
+    runTest(CommandLine(cmdline));
+}
+
 } // namespace
 
 } // namespace gmx::test
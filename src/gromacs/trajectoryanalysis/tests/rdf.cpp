@@ -89,6 +89,31 @@ TEST_F(RdfModuleTest, BasicTest)
     runTest(CommandLine(cmdline));
 }
 
+/*! \brief Test fixture for the `rdf` analysis module with several threads.
+ *
+ * The results should not depend on the number of threads, so the tests
+ * compare against the reference data of RdfModuleTest.BasicTest.
+ */
+class RdfModuleThreadsTest :
+    public gmx::test::TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::RdfInfo>
+{
+public:
+    RdfModuleThreadsTest() : TrajectoryAnalysisModuleTestFixture("RdfModuleTest_BasicTest.xml") {}
+};
+
+TEST_F(RdfModuleThreadsTest, BasicTest)
+{
+    const char* const cmdline[] = {
+        "rdf", "-bin", "0.05", "-ref", "name OW", "-sel", "name OW", "not name OW"
+    };
+    setTopology("spc216.gro");
+    setOutputFile("-o", ".xvg", NoTextMatch());
+    excludeDataset("pairdist");
+    // Not stored in the shared reference data
+    commandLine().addOption("-nt", 3);
+    runTest(CommandLine(cmdline));
+}
+
 TEST_F(RdfModuleTest, SelectionsSolelyFromIndexFileWork)
 {
     const char* const cmdline[] = { "rdf",
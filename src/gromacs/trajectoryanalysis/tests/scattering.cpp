@@ -130,6 +130,65 @@ TEST_P(ScatteringModule, MCMode)
     runTest(command);
 }
 
+//! Test parameters: whether to update the histogram incrementally, number of threads
+using MovingResiduesTestParams = std::tuple<bool, int>;
+
+/*! \brief
+ * Test fixture for the direct method over a trajectory where only a few
+ * residues move between frames, such that the histogram can be updated
+ * incrementally.
+ *
+ * The pair distance counts are exact, so all variants share the same
+ * reference data.
+ */
+class ScatteringModuleMovingResidues :
+    public TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::ScatteringInfo>,
+    public ::testing::WithParamInterface<MovingResiduesTestParams>
+{
+public:
+    ScatteringModuleMovingResidues() :
+        TrajectoryAnalysisModuleTestFixture("ScatteringModuleMovingResidues.xml")
+    {
+    }
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+TEST_P(ScatteringModuleMovingResidues, GivesSameProfile)
+{
+    const auto [incremental, threads] = GetParam();
+    const char* const cmdline[]       = { "scattering" };
+    CommandLine       command(cmdline);
+    setTopology("lysozyme.pdb");
+    setTrajectory("lysozyme-partlymoving.pdb");
+    // These options are not stored in the shared reference data
+    commandLine().append(incremental ? "-incremental" : "-noincremental");
+    commandLine().addOption("-nt", threads);
+    command.addOption("-sel", "Protein");
+    command.addOption("-scattering-type", "saxs");
+    command.addOption("-nomc");
+    command.addOption("-binwidth", 0.0005);
+    command.addOption("-endq", 10.0);
+    command.addOption("-qspacing", 0.25);
+    // The fine bins and the large q values make a pair that ends up in
+    // a neighboring bin visible in the intensities.
+    // A few ULPs are needed for reading the reference values.
+    setDatasetTolerance("scattering", gmx::test::ulpTolerance(4));
+    runTest(command);
+}
+
+//! Help GoogleTest name our test cases
+std::string nameOfMovingResiduesTest(const testing::TestParamInfo<MovingResiduesTestParams>& info)
+{
+    return formatString("%s_%dThreads",
+                        std::get<0>(info.param) ? "IncrementalUpdate" : "FullRecompute",
+                        std::get<1>(info.param));
+}
+
+INSTANTIATE_TEST_SUITE_P(Works,
+                         ScatteringModuleMovingResidues,
+                         ::testing::Combine(::testing::Bool(), ::testing::Values(1, 3)),
+                         nameOfMovingResiduesTest);
+
 INSTANTIATE_TEST_SUITE_P(MoleculeTests,
                          ScatteringModule,
                          ::testing::Combine(::testing::Values("lysozyme.pdb"),
@@ -79,7 +79,14 @@ class SurfaceAreaTest : public ::testing::Test
 {
 public:
     SurfaceAreaTest() :
-        box_(), rng_(12345), area_(0.0), volume_(0.0), atomArea_(nullptr), dotCount_(0), dots_(nullptr)
+        box_(),
+        threadCount_(1),
+        rng_(12345),
+        area_(0.0),
+        volume_(0.0),
+        atomArea_(nullptr),
+        dotCount_(0),
+        dots_(nullptr)
     {
     }
     ~SurfaceAreaTest() override
@@ -149,6 +156,7 @@ public:
         gmx::SurfaceAreaCalculator calculator;
         calculator.setDotCount(ndots);
         calculator.setRadii(radius_);
+        calculator.setThreadCount(threadCount_);
         calculator.calculate(as_rvec_array(x_.data()),
                              bPBC ? &pbc : nullptr,
                              index_.size(),
@@ -163,6 +171,8 @@ public:
     real resultArea() const { return area_; }
     real resultVolume() const { return volume_; }
     real atomArea(int index) const { return atomArea_[index]; }
+    int  resultDotCount() const { return dotCount_; }
+    int  atomCount() const { return index_.size(); }
 
     void checkReference(gmx::test::TestReferenceChecker* checker, const char* id, bool checkDotCoordinates)
     {
@@ -195,6 +205,7 @@ public:
 
     gmx::test::TestReferenceData data_;
     matrix                       box_;
+    int                          threadCount_;
 
 private:
     static int dotComparer(const void* a, const void* b)
@@ -309,6 +320,38 @@ TEST_F(SurfaceAreaTest, Computes100Points)
     checkReference(&checker, "100Points", false);
 }
 
+TEST_F(SurfaceAreaTest, Computes100PointsWithThreads)
+{
+    // The results should not depend on the number of threads, so they are
+    // compared with a serial calculation instead of with reference data.
+    box_[XX][XX] = 10.0;
+    box_[YY][YY] = 10.0;
+    box_[ZZ][ZZ] = 10.0;
+    generateRandomPositions(100);
+    const int flags = FLAG_VOLUME | FLAG_ATOM_AREA | FLAG_DOTS;
+    ASSERT_NO_FATAL_FAILURE(calculate(24, flags, false));
+    const real        serialArea     = resultArea();
+    const real        serialVolume   = resultVolume();
+    const int         serialDotCount = resultDotCount();
+    std::vector<real> serialAtomArea;
+    for (int i = 0; i < atomCount(); ++i)
+    {
+        serialAtomArea.push_back(atomArea(i));
+    }
+
+    threadCount_ = 4;
+    ASSERT_NO_FATAL_FAILURE(calculate(24, flags, false));
+    // The contributions of the atoms are summed in a different order
+    const auto tolerance = relativeToleranceAsFloatingPoint(serialArea, 1e-6);
+    EXPECT_REAL_EQ_TOL(serialArea, resultArea(), tolerance);
+    EXPECT_REAL_EQ_TOL(serialVolume, resultVolume(), tolerance);
+    EXPECT_EQ(serialDotCount, resultDotCount());
+    for (int i = 0; i < atomCount(); ++i)
+    {
+        EXPECT_REAL_EQ_TOL(serialAtomArea[i], atomArea(i), tolerance) << "Atom " << i;
+    }
+}
+
 TEST_F(SurfaceAreaTest, Computes100PointsWithRectangularPBC)
 {
     // TODO: It would be nice to check that this produces the same result as
@@ -0,0 +1,122 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright 2025- The GROMACS Authors
+ * and the project initiators Erik Lindahl, Berk Hess and David van der Spoel.
+ * Consult the AUTHORS/COPYING files and https://www.gromacs.org for details.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * https://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at https://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out https://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for functionality of the "transpose-trj" trajectory analysis module.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "gromacs/trajectoryanalysis/modules/transpose_trj.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/atommajortrajectory.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/filematchers.h"
+#include "testutils/refdata.h"
+#include "testutils/testasserts.h"
+
+#include "moduletest.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+using gmx::test::CommandLine;
+
+//! Checks the atoms, frames and the time series of the first and last atom of an atom-major file
+class AtomMajorTrajectoryMatcher : public IFileMatcher
+{
+public:
+    void checkFile(const std::string& path, TestReferenceChecker* checker) override
+    {
+        AtomMajorTrajectoryReader reader(path);
+        checker->setDefaultTolerance(absoluteTolerance(0.5 / reader.precision()));
+        checker->checkSequence(reader.atomIndices().begin(), reader.atomIndices().end(), "Atoms");
+        checker->checkSequence(reader.steps().begin(), reader.steps().end(), "Steps");
+        const std::vector<int>  atoms      = { 0, reader.numAtoms() - 1 };
+        const std::vector<RVec> timeSeries = reader.readTimeSeries(atoms);
+        checker->checkSequence(timeSeries.begin(), timeSeries.end(), "TimeSeries");
+    }
+};
+
+//! Settings for AtomMajorTrajectoryMatcher
+class AtomMajorTrajectoryMatch : public IFileMatcherSettings
+{
+public:
+    FileMatcherPointer createFileMatcher() const override
+    {
+        return std::make_unique<AtomMajorTrajectoryMatcher>();
+    }
+};
+
+/********************************************************************
+ * Tests for gmx::analysismodules::TransposeTrj.
+ */
+
+//! Test fixture for the transpose-trj analysis module.
+typedef gmx::test::TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::TransposeTrjInfo> TransposeTrjModuleTest;
+
+TEST_F(TransposeTrjModuleTest, WritesAllAtoms)
+{
+    const char* const cmdline[] = { "transpose-trj" };
+    setTopology("msd_coords.gro");
+    setInputFile("-f", "msd_traj.xtc");
+    setOutputFile("-o", "test.amt", AtomMajorTrajectoryMatch());
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(TransposeTrjModuleTest, WritesAtomSubset)
+{
+    const char* const cmdline[] = { "transpose-trj", "-select", "atomnr 1 3", "-prec", "100" };
+    setTopology("msd_coords.gro");
+    setInputFile("-f", "msd_traj.xtc");
+    setOutputFile("-o", "test.amt", AtomMajorTrajectoryMatch());
+    runTest(CommandLine(cmdline));
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
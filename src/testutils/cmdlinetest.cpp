@@ -460,7 +460,11 @@ void CommandLineTestHelper::checkOutputFiles(TestReferenceChecker checker) const
 class CommandLineTestBase::Impl
 {
 public:
-    Impl() : helper_(&tempFiles_) { cmdline_.append("module"); }
+    explicit Impl(const std::string& referenceDataName) :
+        data_(referenceDataName), helper_(&tempFiles_)
+    {
+        cmdline_.append("module");
+    }
 
     TestReferenceData     data_;
     TestFileManager       tempFiles_;
@@ -472,7 +476,15 @@ public:
  * CommandLineTestBase
  */
 
-CommandLineTestBase::CommandLineTestBase() : impl_(new Impl) {}
+CommandLineTestBase::CommandLineTestBase() :
+    impl_(new Impl(TestFileManager::getTestSpecificFileName(".xml").string()))
+{
+}
+
+CommandLineTestBase::CommandLineTestBase(const std::string& referenceDataName) :
+    impl_(new Impl(referenceDataName))
+{
+}
 
 CommandLineTestBase::~CommandLineTestBase() {}
 
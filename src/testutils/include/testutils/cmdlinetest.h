@@ -395,6 +395,14 @@ class CommandLineTestBase : public ::testing::Test
 {
 public:
     CommandLineTestBase();
+    /*! \brief
+     * Initializes the test to use reference data shared with other tests.
+     *
+     * \param[in] referenceDataName  Name of the reference data file.
+     *
+     * \see TestReferenceData::TestReferenceData(std::string)
+     */
+    explicit CommandLineTestBase(const std::string& referenceDataName);
     ~CommandLineTestBase() override;
 
     /*! \brief